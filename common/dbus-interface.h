@@ -474,6 +474,26 @@
  */
 #define MAFW_PLAYLIST_METHOD_CREATE_PLAYLIST	"create_playlist"
 
+/**
+ * create_smart_playlist: %DBUS_MESSAGE_TYPE_METHOD
+ * @name: name of the playlist to create (%DBUS_TYPE_STRING)
+ * @container: object id of the container to browse (%DBUS_TYPE_STRING)
+ * @filter: filter to browse with, or empty (%DBUS_TYPE_STRING)
+ * @sort_criteria: sort criteria to browse with, or empty
+ *                 (%DBUS_TYPE_STRING)
+ *
+ * Creates a playlist @name holding the items browsing @container
+ * returns, and sends %MAFW_PLAYLIST_SIGNAL_PLAYLIST_CREATED.  The items
+ * are fetched in pages as they are read, and refreshed when the source
+ * tells @container has changed, each change sending contents_changed.
+ * The items of the playlist cannot be edited.  Fails with
+ * %MAFW_PLAYLIST_ERROR_INVALID_NAME if a playlist @name exists already.
+ *
+ * reply: %DBUS_MESSAGE_TYPE_METHOD_RETURN or %DBUS_MESSAGE_TYPE_ERROR
+ * @id: ID of the new playlist.
+ */
+#define MAFW_PLAYLIST_METHOD_CREATE_SMART_PLAYLIST	"create_smart_playlist"
+
 /**
  * duplicate_playlist: %DBUS_MESSAGE_TYPE_METHOD
  * @playlist_id: ID of the original playlist (%DBUS_TYPE_UINT32)
@@ -492,8 +512,13 @@
  *            (%DBUS_TYPE_STRING)
  * @base_uri: If not null, used as prefix to resolve relative paths found from
  *            playlist. (%DBUS_TYPE_STRING)
+ * @recursive: Optional, import the items of the subcontainers of a
+ *             container too (%DBUS_TYPE_BOOLEAN).
  *
  * Imports external playlists files and shares them in mafw environment.
+ * Containers are browsed in pages, if there are many items the new
+ * playlist is created (and "playlist_created" is emitted) before the
+ * import is finished.
  *
  * reply: %DBUS_MESSAGE_TYPE_METHOD_RETURN or %DBUS_MESSAGE_TYPE_ERROR
  * @id: ID of the playlist-import
@@ -510,6 +535,17 @@
  */
 #define MAFW_PLAYLIST_METHOD_PLAYLIST_IMPORTED	"playlist_imported"
 
+/**
+ * playlist_import_progress:
+ * @import_id: the import id (%DBUS_TYPE_UINT32).
+ * @count: number of entries collected so far (%DBUS_TYPE_UINT32).
+ *
+ * Sent to the requester periodically while a long import is running,
+ * before the final "playlist_imported".
+ */
+#define MAFW_PLAYLIST_METHOD_PLAYLIST_IMPORT_PROGRESS	\
+	"playlist_import_progress"
+
 /**
  * cancel_import:
  * @import_id: the identification number of the request to cancel
@@ -576,6 +612,123 @@
  */
 #define MAFW_PLAYLIST_METHOD_LIST_PLAYLISTS	"list_playlists"
 
+/**
+ * list_playlists_full: %DBUS_MESSAGE_TYPE_METHOD
+ * @inargs: an optional %DBUS_TYPE_ARRAY
+ *          of playlist IDs (%DBUS_TYPE_UINT32).
+ *
+ * Like list_playlists, but returns all properties of the playlists, so
+ * that clients don't need to query them one by one.
+ *
+ * reply: %DBUS_MESSAGE_TYPE_METHOD_RETURN or %DBUS_MESSAGE_TYPE_ERROR
+ * @outargs: a %DBUS_TYPE_ARRAY of %DBUS_TYPE_STRUCT of playlist ID
+ * (%DBUS_TYPE_UINT32), name (%DBUS_TYPE_STRING), size (%DBUS_TYPE_UINT32),
+ * repeat (%DBUS_TYPE_BOOLEAN), shuffled (%DBUS_TYPE_BOOLEAN), use count
+ * (%DBUS_TYPE_UINT32) and the time of the last modification in seconds
+ * since the Epoch (%DBUS_TYPE_UINT64).
+ */
+#define MAFW_PLAYLIST_METHOD_LIST_PLAYLISTS_FULL	"list_playlists_full"
+
+/**
+ * copy_range: %DBUS_MESSAGE_TYPE_METHOD
+ * @src_id: the playlist to copy from (%DBUS_TYPE_UINT32)
+ * @from: index of the first item to copy (%DBUS_TYPE_UINT32)
+ * @count: number of items to copy (%DBUS_TYPE_UINT32)
+ * @dst_id: the playlist to copy to, may be @src_id (%DBUS_TYPE_UINT32)
+ * @at: the items are inserted before this index of @dst_id
+ *      (%DBUS_TYPE_UINT32)
+ *
+ * Copies items between playlists in the daemon, without passing the
+ * object ids through the client.  @dst_id gets one contents_changed
+ * signal.
+ *
+ * reply: %DBUS_MESSAGE_TYPE_METHOD_RETURN or %DBUS_MESSAGE_TYPE_ERROR
+ */
+#define MAFW_PLAYLIST_METHOD_COPY_RANGE		"copy_range"
+
+/**
+ * concat: %DBUS_MESSAGE_TYPE_METHOD
+ * @src_ids: %DBUS_TYPE_ARRAY of playlist IDs (%DBUS_TYPE_UINT32)
+ * @dst_id: the playlist to append to (%DBUS_TYPE_UINT32)
+ *
+ * Appends the items of the @src_ids playlists, in order, to @dst_id,
+ * which gets one contents_changed signal.  Nothing is changed if any of
+ * the playlists doesn't exist.
+ *
+ * reply: %DBUS_MESSAGE_TYPE_METHOD_RETURN or %DBUS_MESSAGE_TYPE_ERROR
+ */
+#define MAFW_PLAYLIST_METHOD_CONCAT		"concat"
+
+/**
+ * get_quota: %DBUS_MESSAGE_TYPE_METHOD
+ * @client: unique bus name of a client, or empty for the caller
+ *          (%DBUS_TYPE_STRING)
+ *
+ * Tells the resources charged to @client and its limits.
+ *
+ * reply: %DBUS_MESSAGE_TYPE_METHOD_RETURN
+ * @outargs: the number of playlists (%DBUS_TYPE_UINT32), their items
+ * (%DBUS_TYPE_UINT32), the total length of the object ids of the items
+ * (%DBUS_TYPE_UINT64) and the number of requests being processed
+ * (%DBUS_TYPE_UINT32), followed by the limits of the same, zero meaning
+ * no limit.
+ */
+#define MAFW_PLAYLIST_METHOD_GET_QUOTA		"get_quota"
+
+/**
+ * backup_to: %DBUS_MESSAGE_TYPE_METHOD
+ * @path: absolute path of a directory (%DBUS_TYPE_STRING)
+ *
+ * Backs up all playlists into @path, replacing the backup there if any.
+ * The daemon keeps serving requests meanwhile, but the backup holds the
+ * playlists as they were when it was asked for.  Fails if @path is
+ * something else than a backup, or another backup is in progress.
+ *
+ * reply: %DBUS_MESSAGE_TYPE_METHOD_RETURN when the backup is complete,
+ * or %DBUS_MESSAGE_TYPE_ERROR
+ */
+#define MAFW_PLAYLIST_METHOD_BACKUP_TO		"backup_to"
+
+/**
+ * restore_from: %DBUS_MESSAGE_TYPE_METHOD
+ * @path: a directory written by backup_to (%DBUS_TYPE_STRING)
+ *
+ * Replaces all playlists with those backed up in @path, then sends
+ * %MAFW_PLAYLIST_SIGNAL_PLAYLISTS_RESTORED.  Nothing is changed if @path
+ * can't be read.
+ *
+ * reply: %DBUS_MESSAGE_TYPE_METHOD_RETURN or %DBUS_MESSAGE_TYPE_ERROR
+ */
+#define MAFW_PLAYLIST_METHOD_RESTORE_FROM	"restore_from"
+
+/**
+ * playlists_restored: %DBUS_MESSAGE_TYPE_SIGNAL
+ *
+ * Informs that all playlists have been replaced by restore_from.  It's
+ * sent instead of playlist_created and playlist_destroyed about each;
+ * clients are to list the playlists again.
+ */
+#define MAFW_PLAYLIST_SIGNAL_PLAYLISTS_RESTORED	"playlists_restored"
+
+/*----------------------------------------------------------------------------
+  Statistics interface
+  ----------------------------------------------------------------------------*/
+
+#define MAFW_PLAYLIST_STATS_INTERFACE	MAFW_PLAYLIST_INTERFACE ".Stats"
+
+/**
+ * get_stats: %DBUS_MESSAGE_TYPE_METHOD
+ *
+ * Retrieves the runtime statistics of the daemon: request counts and
+ * latencies, signals sent, playlist sizes, saving and importing.
+ *
+ * reply: %DBUS_MESSAGE_TYPE_METHOD_RETURN
+ * @outargs: a dictionary of counters (%DBUS_TYPE_ARRAY of
+ * %DBUS_TYPE_DICT_ENTRY of %DBUS_TYPE_STRING and %DBUS_TYPE_UINT64),
+ * times are in microseconds.
+ */
+#define MAFW_PLAYLIST_STATS_METHOD_GET		"get_stats"
+
 /*----------------------------------------------------------------------------
   Playlist interface
   ----------------------------------------------------------------------------*/
@@ -693,9 +846,81 @@
  * @last_index:	    Last index to return
  *
  * Gets the items between the specified indicies form the given playlist.
+ * The daemon reads long ranges a slice at a time, answering other
+ * requests in between, but the reply is still a consistent copy of the
+ * items of one generation of the playlist.
  */
 #define MAFW_PLAYLIST_METHOD_GET_ITEMS "get_items"
 
+/**
+ * get_items_paged:
+ * @generation:     generation returned with the previous page, or 0
+ *                  when starting.
+ * @first_index:    First index to return.
+ * @max_items:      Maximum number of items to return, 0 for no limit.
+ * @max_bytes:      Maximum size of the returned object ids in bytes,
+ *                  0 for the daemon's default.  The daemon may lower it.
+ *
+ * Gets the items from @first_index onwards in pages of bounded size.  At
+ * least one item is returned if there is any.  The reply consists of the
+ * current generation of the playlist, the index to continue from (or
+ * %MAFW_PLAYLIST_ITEMS_END if there are no more items) and the object ids.
+ * If @generation is not 0 and the playlist has changed since, the request
+ * fails with %MAFW_PLAYLIST_ERROR_INVALID_INDEX.
+ */
+#define MAFW_PLAYLIST_METHOD_GET_ITEMS_PAGED "get_items_paged"
+
+/**
+ * get_items_with_metadata:
+ * @first_index:    First index to return.
+ * @last_index:	    Last index to return
+ *
+ * Like get_items, but also returns the metadata the daemon has cached
+ * of the items, and the totals of the playlist.  The keys cached are
+ * configured by the MAFW_PLAYLIST_METADATA_KEYS environment variable of
+ * the daemon; if it's unset nothing is cached.  Records not cached yet
+ * are empty, and are fetched from the sources meanwhile, which is told
+ * by %MAFW_PLAYLIST_METADATA_CACHED.
+ *
+ * reply: %DBUS_MESSAGE_TYPE_METHOD_RETURN or %DBUS_MESSAGE_TYPE_ERROR
+ * @objectids: the items
+ * @metadata:  the serialized metadata of each item (array of byte
+ *             arrays, empty if not cached)
+ * @duration:  total duration of the items whose duration is known, in
+ *             seconds (%DBUS_TYPE_UINT64)
+ * @unknown:   number of items whose duration isn't known yet
+ *             (%DBUS_TYPE_UINT32)
+ */
+#define MAFW_PLAYLIST_METHOD_GET_ITEMS_WITH_METADATA "get_items_with_metadata"
+
+/**
+ * sync_since:
+ * @generation: the generation of the playlist the caller knows, or 0
+ *
+ * Tells how the items of the playlist have changed since @generation,
+ * for keeping a copy of them up to date cheaply.  The generation is
+ * the one returned by get_items_paged or a previous sync_since, and it
+ * survives the restart of the daemon.
+ *
+ * reply: %DBUS_MESSAGE_TYPE_METHOD_RETURN or %DBUS_MESSAGE_TYPE_ERROR
+ * @generation: the current generation (%DBUS_TYPE_UINT32)
+ * @full:       %TRUE if the changes are not known anymore (or @generation
+ *              was 0), then the caller has to fetch all items again
+ *              (%DBUS_TYPE_BOOLEAN)
+ * @changes:    unless @full, the changes in order, as an array of
+ *              (%DBUS_TYPE_UINT32 from, %DBUS_TYPE_UINT32 number of items
+ *              removed from there, string array object ids inserted in
+ *              their place) structures
+ */
+#define MAFW_PLAYLIST_METHOD_SYNC_SINCE "sync_since"
+
+/**
+ * MAFW_PLAYLIST_ITEMS_END:
+ *
+ * Continuation index of get_items_paged meaning the end of the playlist.
+ */
+#define MAFW_PLAYLIST_ITEMS_END 0xFFFFFFFF
+
 /**
  * get_starting:
  *
@@ -729,6 +954,23 @@
  */
 #define MAFW_PLAYLIST_METHOD_GET_NEXT "get_next"
 
+/**
+ * get_next_n:
+ * @index:    visual index of the current item
+ * @n:        number of items to look ahead
+ *
+ * Gets the visual indices and objectids of the next @n playable items, in
+ * the order they would be returned by successive get_next calls, taking
+ * shuffle and repeat into account.  The shuffled order revealed is final.
+ * Fewer items are returned if the end of the playlist is reached, and the
+ * daemon may also limit @n.
+ *
+ * reply: %DBUS_MESSAGE_TYPE_METHOD_RETURN or %DBUS_MESSAGE_TYPE_ERROR
+ * @indices: array of the visual indices of the items
+ * @objectids: array of the object ids of the items
+ */
+#define MAFW_PLAYLIST_METHOD_GET_NEXT_N "get_next_n"
+
 /**
  * get_prev:
  * @index:    visual index of the current item
@@ -770,6 +1012,80 @@
  */
 #define MAFW_PLAYLIST_METHOD_CLEAR "clear"
 
+/**
+ * apply_ops:
+ * @ops: array of (%DBUS_TYPE_UINT32 opcode, %DBUS_TYPE_UINT32 index,
+ *       %DBUS_TYPE_UINT32 argument, string array object ids) structures,
+ *       see the MAFW_PLAYLIST_OP_* constants for their meaning.
+ *
+ * Applies a sequence of edit operations on the playlist in order, as one
+ * transaction: either all of them are valid and all are applied, or none
+ * is.  The reply is an array of booleans telling which operations were
+ * valid.  A single %MAFW_PLAYLIST_CONTENTS_CHANGED signal covering every
+ * modified item is emitted after a successful transaction, plus one
+ * %MAFW_PLAYLIST_PROPERTY_CHANGED per property touched.
+ */
+#define MAFW_PLAYLIST_METHOD_APPLY_OPS "apply_ops"
+
+/*
+ * Opcodes of apply_ops.  Unused fields of an operation should be 0
+ * (respectively empty).
+ *
+ * INSERT:     insert the object ids at index.
+ * APPEND:     append the object ids.
+ * REMOVE:     remove argument (>= 1) items starting at index.
+ * MOVE:       move the item at index to position argument.
+ * CLEAR:      remove all items.
+ * SET_REPEAT: set the repeat mode to argument.
+ * SHUFFLE:    shuffle the playlist.
+ * UNSHUFFLE:  unshuffle the playlist.
+ */
+#define MAFW_PLAYLIST_OP_INSERT		0
+#define MAFW_PLAYLIST_OP_APPEND		1
+#define MAFW_PLAYLIST_OP_REMOVE		2
+#define MAFW_PLAYLIST_OP_MOVE		3
+#define MAFW_PLAYLIST_OP_CLEAR		4
+#define MAFW_PLAYLIST_OP_SET_REPEAT	5
+#define MAFW_PLAYLIST_OP_SHUFFLE	6
+#define MAFW_PLAYLIST_OP_UNSHUFFLE	7
+
+/**
+ * set_window:
+ * @first: visual index of the first item of the window
+ * @count: number of items in the window, 0 to unsubscribe
+ *
+ * Subscribes the caller to the changes of the items between @first and
+ * @first + @count, replacing its previous window of the playlist, if
+ * any.  Windows larger than %MAFW_PLAYLIST_WINDOW_MAX are cut to that
+ * size.  The daemon then sends %MAFW_PLAYLIST_WINDOW_CHANGED and
+ * %MAFW_PLAYLIST_WINDOW_SHIFTED signals to the caller only, when the
+ * window is affected.  The subscription ends when the caller leaves
+ * the bus or the playlist is destroyed.
+ *
+ * reply: %DBUS_MESSAGE_TYPE_METHOD_RETURN or %DBUS_MESSAGE_TYPE_ERROR
+ * @objectids: the current items of the window, fewer than @count if
+ *             the playlist ends earlier
+ */
+#define MAFW_PLAYLIST_METHOD_SET_WINDOW "set_window"
+
+/* The most items a set_window window covers. */
+#define MAFW_PLAYLIST_WINDOW_MAX	1024
+
+/**
+ * get_mirror:
+ *
+ * Asks for the shared memory mirror of the playlist (see
+ * common/mafw-mirror.h), which the daemon keeps up to date from then
+ * on.  Needs a connection able to pass file descriptors.
+ *
+ * reply: %DBUS_MESSAGE_TYPE_METHOD_RETURN or %DBUS_MESSAGE_TYPE_ERROR
+ * (%MAFW_PLAYLIST_ERROR_NOT_SUPPORTED)
+ * @fd:   the sealed memory segment (%DBUS_TYPE_UNIX_FD), to be mapped
+ *        read-only
+ * @size: its size (%DBUS_TYPE_UINT32)
+ */
+#define MAFW_PLAYLIST_METHOD_GET_MIRROR "get_mirror"
+
 /**
  * MAFW_PLAYLIST_CONTENTS_CHANGED:
  * A signal telling that the contents of a shared playlist have changed.
@@ -789,5 +1105,35 @@
  */
 #define MAFW_PLAYLIST_PROPERTY_CHANGED "property_changed"
 
+/**
+ * MAFW_PLAYLIST_WINDOW_CHANGED:
+ * A signal sent to the subscriber of a window (see set_window) telling
+ * that @count (%DBUS_TYPE_UINT32) items of the window from @first
+ * (%DBUS_TYPE_UINT32) on have been replaced by @objectids (string
+ * array).  If there are fewer @objectids than @count, the playlist ends
+ * there.
+ */
+#define MAFW_PLAYLIST_WINDOW_CHANGED "window_changed"
+
+/**
+ * MAFW_PLAYLIST_WINDOW_SHIFTED:
+ * A signal sent to the subscriber of a window (see set_window) telling
+ * that items were inserted or removed above it, so its items remain the
+ * same, but now start at @first (%DBUS_TYPE_UINT32).  The window follows
+ * its items.
+ */
+#define MAFW_PLAYLIST_WINDOW_SHIFTED "window_shifted"
+
+/**
+ * MAFW_PLAYLIST_METADATA_CACHED:
+ * A signal telling that metadata of items between @first and @last
+ * (%DBUS_TYPE_UINT32) have been (re)fetched into the cache of the
+ * daemon, see get_items_with_metadata.  It also carries the new totals
+ * of the playlist: @duration (%DBUS_TYPE_UINT64) and @unknown
+ * (%DBUS_TYPE_UINT32).  It is only sent about playlists whose items have
+ * been asked with metadata.
+ */
+#define MAFW_PLAYLIST_METADATA_CACHED "metadata_cached"
+
 #endif
 /* vi: set noexpandtab ts=8 sw=8 cino=t0,(0: */
@@ -0,0 +1,485 @@
+/*
+ * This file is a part of MAFW
+ *
+ * Copyright (C) 2007, 2008, 2009 Nokia Corporation, all rights reserved.
+ *
+ * Contact: Visa Smolander <visa.smolander@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+/* For memfd_create() and the file sealing fcntl()s. */
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <glib.h>
+
+#include "mafw-mirror.h"
+
+#undef G_LOG_DOMAIN
+#define G_LOG_DOMAIN "mafw-mirror"
+
+/*
+ * Layout of a segment: the Header, room for the offsets of @cap items in
+ * the string area (guint32 each), then the string area holding the
+ * NUL-terminated object ids, up to the end of the segment.  Patches
+ * append the new ids to the string area and leave the replaced ones
+ * there as garbage, until the next full publish compacts it.
+ */
+#define MIRROR_MAGIC	0x4d41464e
+
+/* How many times a reader retries when it races with an update. */
+#define MIRROR_RETRIES	4
+
+/* The smallest segment created. */
+#define MIRROR_MIN_SIZE	(64 * 1024)
+
+/*
+ * @magic:   MIRROR_MAGIC
+ * @seq:     incremented before and after each update, so it's odd
+ *           while the segment is being written
+ * @stale:   set when the segment is abandoned by the daemon
+ * @len:     number of items
+ * @gen:     generation of the items
+ * @flags:   MAFW_MIRROR_* flags
+ * @strings: used size of the string area
+ * @cap:     number of offsets there is room for
+ */
+typedef struct {
+	guint32 magic;
+	gint seq;
+	gint stale;
+	guint32 len;
+	guint32 gen;
+	guint32 flags;
+	guint32 strings;
+	guint32 cap;
+} Header;
+
+/*
+ * @fd:       the memfd, -1 on the reading side
+ * @size:     size of the segment
+ * @hdr:      the mapping
+ * @writable: if this is the publishing side
+ */
+struct _MafwMirror {
+	gint fd;
+	gsize size;
+	Header *hdr;
+	gboolean writable;
+};
+
+#define OFFSETS(hdr)	((guint32 *)((hdr) + 1))
+#define STRINGS(hdr)	((gchar *)(OFFSETS(hdr) + (hdr)->cap))
+
+/**
+ * mafw_mirror_supported:
+ *
+ * Tells whether mirrors can be created on this system.
+ */
+gboolean mafw_mirror_supported(void)
+{
+#ifdef HAVE_MEMFD_CREATE
+	return TRUE;
+#else
+	return FALSE;
+#endif
+}
+
+/**
+ * mafw_mirror_size_for:
+ * @oids: object ids
+ * @len:  number of @oids
+ *
+ * Returns the size of a segment suitable for publishing @oids, with
+ * some room to grow.
+ */
+gsize mafw_mirror_size_for(gchar *const *oids, guint len)
+{
+	gsize size, page;
+	guint i;
+
+	size = sizeof(Header) + len * sizeof(guint32);
+	for (i = 0; i < len; i++)
+		size += strlen(oids[i]) + 1;
+	size = MAX(size * 2, MIRROR_MIN_SIZE);
+	page = sysconf(_SC_PAGESIZE);
+	return (size + page - 1) / page * page;
+}
+
+/**
+ * mafw_mirror_create:
+ * @size: size of the segment
+ *
+ * Creates a segment to publish a playlist in.  The segment can't be
+ * resized, and the readers can't map it writable.
+ *
+ * Returns: a new #MafwMirror, or %NULL if it couldn't be created.
+ */
+MafwMirror *mafw_mirror_create(gsize size)
+{
+#ifdef HAVE_MEMFD_CREATE
+	MafwMirror *mirror;
+	Header *hdr;
+	gint fd, seals;
+
+	if ((fd = memfd_create("mafw-playlist",
+			       MFD_CLOEXEC | MFD_ALLOW_SEALING)) < 0) {
+		g_warning("memfd_create: %s", g_strerror(errno));
+		return NULL;
+	}
+	if (ftruncate(fd, size) < 0) {
+		g_warning("ftruncate: %s", g_strerror(errno));
+		close(fd);
+		return NULL;
+	}
+	hdr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (hdr == MAP_FAILED) {
+		g_warning("mmap: %s", g_strerror(errno));
+		close(fd);
+		return NULL;
+	}
+
+	/* Our own mapping stays writable, but no new one can be. */
+	seals = F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL;
+#ifdef F_SEAL_FUTURE_WRITE
+	seals |= F_SEAL_FUTURE_WRITE;
+#endif
+	if (fcntl(fd, F_ADD_SEALS, seals) < 0)
+		g_warning("sealing the mirror: %s", g_strerror(errno));
+
+	hdr->magic = MIRROR_MAGIC;
+	mirror = g_new0(MafwMirror, 1);
+	mirror->fd = fd;
+	mirror->size = size;
+	mirror->hdr = hdr;
+	mirror->writable = TRUE;
+	return mirror;
+#else
+	return NULL;
+#endif
+}
+
+/**
+ * mafw_mirror_publish:
+ * @mirror: a #MafwMirror created by mafw_mirror_create()
+ * @oids:   the items of the playlist
+ * @state:  the properties of the playlist, including the number of @oids
+ *
+ * Rewrites the contents of @mirror.  The room left is shared between
+ * the offsets and the strings of the items mafw_mirror_patch() may add.
+ *
+ * Returns: %FALSE if they don't fit, in which case @mirror is left as
+ * it was.
+ */
+gboolean mafw_mirror_publish(MafwMirror *mirror, gchar *const *oids,
+			     const MafwMirrorState *state)
+{
+	Header *hdr;
+	gsize need, strbytes, spare, off;
+	guint i;
+
+	g_return_val_if_fail(mirror->writable, FALSE);
+
+	need = sizeof(Header) + state->len * sizeof(guint32);
+	if (need > mirror->size)
+		return FALSE;
+	strbytes = 0;
+	for (i = 0; i < state->len; i++) {
+		strbytes += strlen(oids[i]) + 1;
+		if (need + strbytes > mirror->size)
+			return FALSE;
+	}
+
+	/* Give the offsets room for as many items as the rest would
+	 * hold if they were like the present ones. */
+	spare = (mirror->size - need - strbytes)
+		/ (sizeof(guint32) + (state->len
+				      ? strbytes / state->len : 32));
+
+	hdr = mirror->hdr;
+	g_atomic_int_inc(&hdr->seq);
+	hdr->cap = MIN(state->len + spare, G_MAXUINT32);
+	hdr->len = state->len;
+	hdr->gen = state->generation;
+	hdr->flags = state->flags;
+	off = 0;
+	for (i = 0; i < state->len; i++) {
+		gsize n;
+
+		n = strlen(oids[i]) + 1;
+		OFFSETS(hdr)[i] = off;
+		memcpy(STRINGS(hdr) + off, oids[i], n);
+		off += n;
+	}
+	hdr->strings = off;
+	g_atomic_int_inc(&hdr->seq);
+	return TRUE;
+}
+
+/**
+ * mafw_mirror_patch:
+ * @mirror:   a #MafwMirror published by mafw_mirror_publish()
+ * @oids:     the items of the playlist after the change
+ * @from:     visual index of the first item changed
+ * @nremove:  number of items removed at @from
+ * @nreplace: number of items of @oids which replaced them
+ * @state:    the properties of the playlist after the change
+ *
+ * Updates @mirror after the change described like by
+ * #MafwPlaylist::contents-changed, touching only the changed items and
+ * the offsets of the ones following them.  A change of the properties
+ * only has @nremove and @nreplace 0.
+ *
+ * Returns: %FALSE if the change doesn't fit in the room left or doesn't
+ * match the mirror, in which case @mirror is left as it was, and should
+ * be published anew.
+ */
+gboolean mafw_mirror_patch(MafwMirror *mirror, gchar *const *oids,
+			   guint from, guint nremove, guint nreplace,
+			   const MafwMirrorState *state)
+{
+	Header *hdr;
+	gsize need, off;
+	guint32 oldlen;
+	guint i;
+
+	g_return_val_if_fail(mirror->writable, FALSE);
+
+	hdr = mirror->hdr;
+	oldlen = hdr->len;
+	if (from > oldlen || nremove > oldlen - from
+	    || state->len != oldlen - nremove + nreplace
+	    || state->len > hdr->cap)
+		return FALSE;
+	need = sizeof(Header) + (gsize)hdr->cap * sizeof(guint32)
+		+ hdr->strings;
+	for (i = 0; i < nreplace; i++) {
+		need += strlen(oids[from + i]) + 1;
+		if (need > mirror->size)
+			return FALSE;
+	}
+
+	g_atomic_int_inc(&hdr->seq);
+	if (nremove != nreplace)
+		memmove(&OFFSETS(hdr)[from + nreplace],
+			&OFFSETS(hdr)[from + nremove],
+			(oldlen - from - nremove) * sizeof(guint32));
+	off = hdr->strings;
+	for (i = 0; i < nreplace; i++) {
+		gsize n;
+
+		n = strlen(oids[from + i]) + 1;
+		OFFSETS(hdr)[from + i] = off;
+		memcpy(STRINGS(hdr) + off, oids[from + i], n);
+		off += n;
+	}
+	hdr->strings = off;
+	hdr->len = state->len;
+	hdr->gen = state->generation;
+	hdr->flags = state->flags;
+	g_atomic_int_inc(&hdr->seq);
+	return TRUE;
+}
+
+/**
+ * mafw_mirror_map:
+ * @fd:   file descriptor of a segment, which is taken over
+ * @size: its size
+ *
+ * Maps a segment published by the daemon.
+ *
+ * Returns: a new #MafwMirror to read from, or %NULL on failure.
+ */
+MafwMirror *mafw_mirror_map(gint fd, gsize size)
+{
+	MafwMirror *mirror;
+	Header *hdr;
+
+	if (size < sizeof(Header)) {
+		close(fd);
+		return NULL;
+	}
+	hdr = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (hdr == MAP_FAILED) {
+		g_warning("mmap: %s", g_strerror(errno));
+		return NULL;
+	}
+	if (hdr->magic != MIRROR_MAGIC) {
+		munmap(hdr, size);
+		return NULL;
+	}
+
+	mirror = g_new0(MafwMirror, 1);
+	mirror->fd = -1;
+	mirror->size = size;
+	mirror->hdr = hdr;
+	return mirror;
+}
+
+/**
+ * mafw_mirror_read:
+ * @mirror: a #MafwMirror
+ * @first:  visual index of the first item to read
+ * @count:  number of items to read, may be 0
+ * @state:  where to store the properties of the playlist
+ * @oids:   where to store a %NULL-terminated array of the items read,
+ *          which is shorter than @count if the playlist ends earlier.
+ *          May be %NULL if @count is 0.
+ *
+ * Reads a consistent snapshot of the given items of the playlist.
+ *
+ * Returns: %FALSE if @mirror is stale or it's being updated too often
+ * to read it; then the reader should ask the daemon.
+ */
+gboolean mafw_mirror_read(MafwMirror *mirror, guint first, guint count,
+			  MafwMirrorState *state, gchar ***oids)
+{
+	const Header *hdr;
+	guint try;
+
+	hdr = mirror->hdr;
+	for (try = 0; try < MIRROR_RETRIES; try++) {
+		GPtrArray *items;
+		const guint32 *offsets;
+		const gchar *strings;
+		guint32 len, cap, nstrings;
+		gboolean torn;
+		gint seq;
+		guint i;
+
+		if (g_atomic_int_get(&hdr->stale))
+			return FALSE;
+		seq = g_atomic_int_get(&hdr->seq);
+		if (seq & 1)
+			continue;
+
+		/* Everything read must be checked, it may be garbage until
+		 * $seq is verified. */
+		len = hdr->len;
+		cap = hdr->cap;
+		nstrings = hdr->strings;
+		state->len = len;
+		state->generation = hdr->gen;
+		state->flags = hdr->flags;
+		if (len > cap
+		    || sizeof(Header) + (gsize)cap * sizeof(guint32)
+		    + nstrings > mirror->size) {
+			if (g_atomic_int_get(&hdr->seq) != seq)
+				continue;
+			return FALSE;
+		}
+
+		torn = FALSE;
+		items = NULL;
+		if (count) {
+			offsets = (const guint32 *)(hdr + 1);
+			strings = (const gchar *)(offsets + cap);
+			items = g_ptr_array_new();
+			for (i = first; i < len && i - first < count; i++) {
+				guint32 off;
+
+				off = offsets[i];
+				if (off >= nstrings) {
+					torn = TRUE;
+					break;
+				}
+				/* The writer may overwrite the terminator
+				 * while we copy, so bound the copy by the
+				 * segment.  $seq tells if it was torn. */
+				g_ptr_array_add(items,
+						g_strndup(strings + off,
+							  nstrings - off));
+			}
+			g_ptr_array_add(items, NULL);
+		}
+
+		if (torn || g_atomic_int_get(&hdr->seq) != seq) {
+			if (items)
+				g_strfreev((gchar **)g_ptr_array_free(items,
+								      FALSE));
+			continue;
+		}
+		if (oids)
+			*oids = items ? (gchar **)g_ptr_array_free(items,
+								   FALSE)
+				      : NULL;
+		return TRUE;
+	}
+	return FALSE;
+}
+
+/**
+ * mafw_mirror_is_stale:
+ * @mirror: a #MafwMirror
+ *
+ * Tells whether the daemon has abandoned @mirror.
+ */
+gboolean mafw_mirror_is_stale(MafwMirror *mirror)
+{
+	return g_atomic_int_get(&mirror->hdr->stale) != 0;
+}
+
+/**
+ * mafw_mirror_get_fd:
+ * @mirror: a #MafwMirror created by mafw_mirror_create()
+ *
+ * Returns the file descriptor of the segment, to be passed to readers.
+ */
+gint mafw_mirror_get_fd(MafwMirror *mirror)
+{
+	return mirror->fd;
+}
+
+/**
+ * mafw_mirror_get_size:
+ * @mirror: a #MafwMirror
+ *
+ * Returns the size of the segment.
+ */
+gsize mafw_mirror_get_size(MafwMirror *mirror)
+{
+	return mirror->size;
+}
+
+/**
+ * mafw_mirror_free:
+ * @mirror: a #MafwMirror
+ *
+ * Unmaps @mirror.  If it was created by mafw_mirror_create(), it's
+ * marked stale first, so the readers know they have to get a new one.
+ */
+void mafw_mirror_free(MafwMirror *mirror)
+{
+	if (mirror->writable)
+		g_atomic_int_set(&mirror->hdr->stale, 1);
+	munmap(mirror->hdr, mirror->size);
+	if (mirror->fd >= 0)
+		close(mirror->fd);
+	g_free(mirror);
+}
+
+/* vi: set noexpandtab ts=8 sw=8 cino=t0,(0: */
@@ -0,0 +1,78 @@
+/*
+ * This file is a part of MAFW
+ *
+ * Copyright (C) 2007, 2008, 2009 Nokia Corporation, all rights reserved.
+ *
+ * Contact: Visa Smolander <visa.smolander@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#ifndef __MAFW_MIRROR_H__
+#define __MAFW_MIRROR_H__
+
+#include <glib.h>
+
+/*
+ * Read-only mirrors of playlists in shared memory.  The playlist daemon
+ * publishes the items of a playlist in a sealed memory segment, which
+ * the clients map and read without a round trip to the daemon.  The
+ * segment is updated in place, guarded by a sequence counter (like a
+ * seqlock), so a reader can tell if it has raced with an update.  Edits
+ * patch only the items they change.  When the items outgrow the segment
+ * the daemon publishes them in a new one, and marks the old one stale.
+ */
+
+typedef struct _MafwMirror MafwMirror;
+
+/* MafwMirrorState.flags */
+#define MAFW_MIRROR_REPEAT	(1 << 0)
+#define MAFW_MIRROR_SHUFFLED	(1 << 1)
+
+/**
+ * MafwMirrorState:
+ * @len:        number of items
+ * @generation: generation of the items, see Pls
+ * @flags:      MAFW_MIRROR_* flags
+ *
+ * The properties of the playlist published along with its items.
+ */
+typedef struct {
+	guint len;
+	guint generation;
+	guint flags;
+} MafwMirrorState;
+
+extern gboolean mafw_mirror_supported(void);
+extern gsize mafw_mirror_size_for(gchar *const *oids, guint len);
+extern MafwMirror *mafw_mirror_create(gsize size);
+extern gboolean mafw_mirror_publish(MafwMirror *mirror, gchar *const *oids,
+				    const MafwMirrorState *state);
+extern gboolean mafw_mirror_patch(MafwMirror *mirror, gchar *const *oids,
+				  guint from, guint nremove, guint nreplace,
+				  const MafwMirrorState *state);
+extern MafwMirror *mafw_mirror_map(gint fd, gsize size);
+extern gboolean mafw_mirror_read(MafwMirror *mirror, guint first,
+				 guint count, MafwMirrorState *state,
+				 gchar ***oids);
+extern gboolean mafw_mirror_is_stale(MafwMirror *mirror);
+extern gint mafw_mirror_get_fd(MafwMirror *mirror);
+extern gsize mafw_mirror_get_size(MafwMirror *mirror);
+extern void mafw_mirror_free(MafwMirror *mirror);
+
+#endif
+/* vi: set noexpandtab ts=8 sw=8 cino=t0,(0: */
@@ -0,0 +1,364 @@
+/*
+ * This file is a part of MAFW
+ *
+ * Copyright (C) 2007, 2008, 2009 Nokia Corporation, all rights reserved.
+ *
+ * Contact: Visa Smolander <visa.smolander@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <glib.h>
+#include <dbus/dbus.h>
+
+#include "mafw-dbus.h"
+#include "mafw-session.h"
+
+#undef G_LOG_DOMAIN
+#define G_LOG_DOMAIN "mafw-session"
+
+#define MATCH_STR "type='signal',interface='org.freedesktop.DBus'," \
+			"member='NameOwnerChanged',arg0='%s',arg2=''"
+
+/* A subsystem interested in the disappearance of clients. */
+typedef struct {
+	MafwSessionVanishedFunc vanished;
+	gpointer user_data;
+} Subsystem;
+
+/* A resource held by a client.  Used both as the key and the value of
+ * Session.holds, so that g_hash_table_find() can return it. */
+typedef struct {
+	guint subsystem;
+	gpointer resource;
+	guint count;
+} Hold;
+
+/* The resources held by one client. */
+typedef struct {
+	gchar *client;
+	GHashTable *holds;
+} Session;
+
+/* The connection the matches are installed on. */
+static DBusConnection *Connection;
+/* Registered subsystems, a subsystem ID is its index + 1. */
+static GArray *Subsystems;
+/* Clients holding anything, keyed by their unique name. */
+static GHashTable *Sessions;
+/* The subsystem of mafw_session_watch(). */
+static guint Watched;
+
+static guint hold_hash(const Hold *hold)
+{
+	return g_direct_hash(hold->resource) ^ hold->subsystem;
+}
+
+static gboolean hold_equal(const Hold *a, const Hold *b)
+{
+	return a->subsystem == b->subsystem && a->resource == b->resource;
+}
+
+/* Installs or removes the NameOwnerChanged match of $client. */
+static void watch_client(const gchar *client, gboolean watch)
+{
+	gchar *match_str;
+
+	match_str = g_strdup_printf(MATCH_STR, client);
+	if (watch) {
+		DBusError err;
+
+		dbus_error_init(&err);
+		dbus_bus_add_match(Connection, match_str, &err);
+		if (dbus_error_is_set(&err)) {
+			g_critical("Unable to add match: %s", match_str);
+			dbus_error_free(&err);
+		}
+	} else
+		dbus_bus_remove_match(Connection, match_str, NULL);
+	g_free(match_str);
+}
+
+/* Destroys a session when its client doesn't hold anything anymore. */
+static void session_free(Session *session)
+{
+	watch_client(session->client, FALSE);
+	g_hash_table_destroy(session->holds);
+	g_free(session->client);
+	g_free(session);
+}
+
+static gboolean first_hold(gpointer key, gpointer value, gpointer unused)
+{
+	return TRUE;
+}
+
+/* Releases everything $client held, calling back the subsystems one
+ * resource at a time.  The match is removed before the last callback,
+ * just as if the client had released its resources itself. */
+static void client_vanished(const gchar *client)
+{
+	Session *session;
+
+	while ((session = g_hash_table_lookup(Sessions, client)) != NULL) {
+		Subsystem *subsys;
+		Hold *hold, held;
+
+		hold = g_hash_table_find(session->holds, first_hold, NULL);
+		g_assert(hold != NULL);
+		held = *hold;
+		g_hash_table_remove(session->holds, hold);
+		if (!g_hash_table_size(session->holds))
+			g_hash_table_remove(Sessions, client);
+
+		subsys = &g_array_index(Subsystems, Subsystem,
+					held.subsystem - 1);
+		if (subsys->vanished)
+			subsys->vanished(client, held.resource, held.count,
+					 subsys->user_data);
+	}
+}
+
+/* Watches the disappearance of the clients we know about. */
+static DBusHandlerResult handle_name_owner_changed(DBusConnection *conn,
+						   DBusMessage *msg,
+						   gpointer unused)
+{
+	gchar *name, *oldname, *newname;
+
+	if (!Sessions || !g_hash_table_size(Sessions))
+		return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+	if (!dbus_message_is_signal(msg, DBUS_INTERFACE_DBUS,
+				    "NameOwnerChanged"))
+		return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+
+	name = oldname = newname = NULL;
+	mafw_dbus_parse(msg,
+			DBUS_TYPE_STRING, &name,
+			DBUS_TYPE_STRING, &oldname,
+			DBUS_TYPE_STRING, &newname);
+	if (*oldname && !*newname)
+		client_vanished(name);
+	return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+}
+
+/**
+ * mafw_session_init:
+ * @conn: the connection clients reach us on
+ *
+ * Starts watching the clients of @conn.  Should be called by each
+ * subsystem before it uses the registry; calls with the same @conn after
+ * the first do nothing, another @conn replaces the watched one.
+ */
+void mafw_session_init(DBusConnection *conn)
+{
+	/* The daemon's subsystems share the connection; filter it once. */
+	if (conn != Connection) {
+		if (Connection)
+			dbus_connection_remove_filter(
+				Connection, handle_name_owner_changed, NULL);
+		if (!dbus_connection_add_filter(conn,
+						handle_name_owner_changed,
+						NULL, NULL))
+			g_assert_not_reached();
+		Connection = conn;
+	}
+	if (!Sessions)
+		Sessions = g_hash_table_new_full(g_str_hash, g_str_equal, NULL,
+						 (GDestroyNotify)session_free);
+}
+
+/**
+ * mafw_session_add_subsystem:
+ * @vanished:  called for each resource of a vanished client, or %NULL
+ * @user_data: passed to @vanished
+ *
+ * Registers a kind of resources clients may hold.
+ *
+ * Returns: the subsystem ID to use with the other functions.
+ */
+guint mafw_session_add_subsystem(MafwSessionVanishedFunc vanished,
+				 gpointer user_data)
+{
+	Subsystem subsys;
+
+	if (!Subsystems)
+		Subsystems = g_array_new(FALSE, FALSE, sizeof(Subsystem));
+	subsys.vanished = vanished;
+	subsys.user_data = user_data;
+	g_array_append_val(Subsystems, subsys);
+	return Subsystems->len;
+}
+
+/**
+ * mafw_session_hold:
+ * @subsystem: the subsystem @resource belongs to
+ * @client:    unique bus name of the client
+ * @resource:  the resource
+ *
+ * Records that @client holds @resource (once more).  The first resource
+ * held by a client starts watching it.
+ *
+ * Returns: how many times @client holds @resource now.
+ */
+guint mafw_session_hold(guint subsystem, const gchar *client,
+			gpointer resource)
+{
+	Session *session;
+	Hold key, *hold;
+
+	g_return_val_if_fail(Sessions != NULL, 0);
+	g_return_val_if_fail(subsystem > 0 && subsystem <= Subsystems->len, 0);
+
+	if (!(session = g_hash_table_lookup(Sessions, client))) {
+		session = g_new(Session, 1);
+		session->client = g_strdup(client);
+		session->holds = g_hash_table_new_full(
+						(GHashFunc)hold_hash,
+						(GEqualFunc)hold_equal,
+						NULL, g_free);
+		g_hash_table_insert(Sessions, session->client, session);
+		watch_client(client, TRUE);
+	}
+
+	key.subsystem = subsystem;
+	key.resource = resource;
+	if (!(hold = g_hash_table_lookup(session->holds, &key))) {
+		hold = g_new(Hold, 1);
+		*hold = key;
+		hold->count = 0;
+		g_hash_table_insert(session->holds, hold, hold);
+	}
+	return ++hold->count;
+}
+
+/**
+ * mafw_session_holds:
+ * @subsystem: the subsystem @resource belongs to
+ * @client:    unique bus name of the client
+ * @resource:  the resource
+ *
+ * Returns: how many times @client holds @resource.
+ */
+guint mafw_session_holds(guint subsystem, const gchar *client,
+			 gpointer resource)
+{
+	Session *session;
+	Hold key, *hold;
+
+	if (!Sessions || !(session = g_hash_table_lookup(Sessions, client)))
+		return 0;
+	key.subsystem = subsystem;
+	key.resource = resource;
+	hold = g_hash_table_lookup(session->holds, &key);
+	return hold ? hold->count : 0;
+}
+
+/**
+ * mafw_session_release:
+ * @subsystem: the subsystem @resource belongs to
+ * @client:    unique bus name of the client
+ * @resource:  the resource
+ *
+ * Records that @client holds @resource once less.  When the client
+ * doesn't hold anything anymore, it is not watched anymore.
+ *
+ * Returns: %TRUE if @client held @resource.
+ */
+gboolean mafw_session_release(guint subsystem, const gchar *client,
+			      gpointer resource)
+{
+	Session *session;
+	Hold key, *hold;
+
+	if (!Sessions || !(session = g_hash_table_lookup(Sessions, client)))
+		return FALSE;
+	key.subsystem = subsystem;
+	key.resource = resource;
+	if (!(hold = g_hash_table_lookup(session->holds, &key)))
+		return FALSE;
+	if (!--hold->count) {
+		g_hash_table_remove(session->holds, hold);
+		if (!g_hash_table_size(session->holds))
+			g_hash_table_remove(Sessions, client);
+	}
+	return TRUE;
+}
+
+/* Collects the sessions holding the resource in $key. */
+static void find_holders(const gchar *client, Session *session,
+			 gpointer *args)
+{
+	if (g_hash_table_lookup(session->holds, args[0]))
+		g_ptr_array_add(args[1], session);
+}
+
+/**
+ * mafw_session_forget:
+ * @subsystem: the subsystem @resource belongs to
+ * @resource:  the resource
+ *
+ * Drops @resource from every client holding it, without calling back
+ * the subsystem.  To be used when the resource itself goes away.
+ */
+void mafw_session_forget(guint subsystem, gpointer resource)
+{
+	GPtrArray *holders;
+	Hold key;
+	gpointer args[2];
+	guint i;
+
+	if (!Sessions)
+		return;
+	key.subsystem = subsystem;
+	key.resource = resource;
+	holders = g_ptr_array_new();
+	args[0] = &key;
+	args[1] = holders;
+	g_hash_table_foreach(Sessions, (GHFunc)find_holders, args);
+	for (i = 0; i < holders->len; i++) {
+		Session *session = holders->pdata[i];
+
+		g_hash_table_remove(session->holds, &key);
+		if (!g_hash_table_size(session->holds))
+			g_hash_table_remove(Sessions, session->client);
+	}
+	g_ptr_array_free(holders, TRUE);
+}
+
+/**
+ * mafw_session_watch:
+ * @client: unique bus name of the client
+ *
+ * Keeps watching @client until it leaves the bus, even when it doesn't
+ * hold anything.  For subsystems whose resources come and go quickly,
+ * such as requests in progress, so that the match of the client isn't
+ * added and removed for each of them.
+ */
+void mafw_session_watch(const gchar *client)
+{
+	if (!Watched)
+		Watched = mafw_session_add_subsystem(NULL, NULL);
+	if (!mafw_session_holds(Watched, client, NULL))
+		mafw_session_hold(Watched, client, NULL);
+}
+
+/* vi: set noexpandtab ts=8 sw=8 cino=t0,(0: */
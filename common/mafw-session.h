@@ -0,0 +1,67 @@
+/*
+ * This file is a part of MAFW
+ *
+ * Copyright (C) 2007, 2008, 2009 Nokia Corporation, all rights reserved.
+ *
+ * Contact: Visa Smolander <visa.smolander@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#ifndef __MAFW_SESSION_H__
+#define __MAFW_SESSION_H__
+
+#include <glib.h>
+#include <dbus/dbus.h>
+
+/*
+ * Registry of the resources D-Bus clients hold in a process, such as
+ * playlist use counts or activated extensions.  A single NameOwnerChanged
+ * match is installed for each client holding anything, and when the client
+ * disappears from the bus, the subsystems owning the resources are told to
+ * release them.
+ */
+
+/**
+ * MafwSessionVanishedFunc:
+ * @client:    unique bus name of the client which disappeared
+ * @resource:  the resource it held
+ * @count:     how many times it held @resource
+ * @user_data: data given to mafw_session_add_subsystem()
+ *
+ * Called for each resource a vanished client held.  By the time it is
+ * called, the client doesn't hold @resource anymore.
+ */
+typedef void (*MafwSessionVanishedFunc)(const gchar *client,
+					gpointer resource,
+					guint count,
+					gpointer user_data);
+
+extern void mafw_session_init(DBusConnection *conn);
+extern guint mafw_session_add_subsystem(MafwSessionVanishedFunc vanished,
+					gpointer user_data);
+extern guint mafw_session_hold(guint subsystem, const gchar *client,
+			       gpointer resource);
+extern guint mafw_session_holds(guint subsystem, const gchar *client,
+				gpointer resource);
+extern gboolean mafw_session_release(guint subsystem, const gchar *client,
+				     gpointer resource);
+extern void mafw_session_forget(guint subsystem, gpointer resource);
+extern void mafw_session_watch(const gchar *client);
+
+#endif
+/* vi: set noexpandtab ts=8 sw=8 cino=t0,(0: */
@@ -34,6 +34,8 @@
 #include "common/dbus-interface.h"
 
 #include "mafw-playlist-manager.h"
+#include "mafw-proxy-playlist-internal.h"
+#include "mafw-playlist-store.h"
 #include "mafw-marshal.h"
 
 /**
@@ -73,6 +75,16 @@
  * be accessed with mafw_playlist_manager_get().  While this object
  * must not be unref:ed by the caller, it is free to keep a copy of
  * the pointer.
+ *
+ * Products running a single application may do without the playlist
+ * daemon by setting the <envar>MAFW_PLAYLIST_EMBEDDED</envar>
+ * environment variable to a nonzero value.  The manager then keeps the
+ * playlists in-process, in the same files the daemon would use, and
+ * emits every signal right away.  The playlists are not shared with
+ * other processes then, which must not use the same playlist directory
+ * at the same time.  Importing playlists, quotas, windows, metadata and
+ * change logs are not available in this mode, and fail with
+ * %MAFW_PLAYLIST_ERROR_NOT_SUPPORTED.
  */
 
 /* Standard definitions */
@@ -110,6 +122,9 @@ typedef struct {
 
 /* Function prototypes */
 static GArray *do_get_playlists(GError **errp);
+static GArray *do_list_playlists_full(const guint *ids, guint nids,
+				      GError **errp);
+static GArray *parse_list(DBusMessage *reply);
 static void mafw_playlist_manager_finalize(MafwPlaylistManager *self);
 static DBusHandlerResult dbus_handler(DBusConnection *con, DBusMessage *msg,
 				      MafwPlaylistManager *self);
@@ -128,6 +143,8 @@ static GSignalDesc Signal_list_destroyed =
 	{ MAFW_PLAYLIST_SIGNAL_PLAYLIST_DESTROYED	};
 static GSignalDesc Signal_list_destruction_failed =
 	{ MAFW_PLAYLIST_SIGNAL_PLAYLIST_DESTRUCTION_FAILED	};
+static GSignalDesc Signal_import_progress =
+	{ "playlist-import-progress"			};
 
 /* Program code */
 /* Class construction */
@@ -194,6 +211,21 @@ static void mafw_playlist_manager_class_init(
 		mafw_marshal_VOID__OBJECT,
 		G_TYPE_NONE, 1, G_TYPE_OBJECT);
 
+/**
+ * MafwPlaylistManager::playlist-import-progress:
+ * @import_id: the identifier returned by mafw_playlist_manager_import().
+ * @count: number of entries collected so far.
+ *
+ * Emitted periodically while a long import started by this process is
+ * running.  The import is finished when its #MafwPlaylistManagerImportCb
+ * is called.
+ */
+	Signal_import_progress.id = g_signal_new(
+		Signal_import_progress.name, G_TYPE_FROM_CLASS(me),
+		G_SIGNAL_RUN_FIRST | G_SIGNAL_ACTION,
+		0, NULL, NULL,
+		mafw_marshal_VOID__UINT_UINT,
+		G_TYPE_NONE, 2, G_TYPE_UINT, G_TYPE_UINT);
 }
 
 /* Object construction */
@@ -228,6 +260,10 @@ static void mafw_playlist_manager_init(MafwPlaylistManager *self)
 	/* NOTE .playlists is not NULL-terminated. */
 	self->priv->playlists = g_ptr_array_new();
 
+	/* There's no daemon to talk to with the in-process store. */
+	if (playlist_store_enabled())
+		return;
+
 	/* Let dbus_handler() see all messages we're interested in. */
 	if ((dbus = mafw_dbus_session(NULL)) != NULL) {
 		DBusError dbe;
@@ -277,6 +313,22 @@ static void mafw_playlist_manager_finalize(
 }
 
 /* Private functions */
+/*
+ * Search .playlists for the object identified by $id.  Returns %NULL
+ * if there is none.  Doesn't alter refcounts.
+ */
+static MafwProxyPlaylist *find_playlist(MafwPlaylistManager *self, guint id)
+{
+	guint i;
+	GPtrArray *playlists;
+
+	playlists = self->priv->playlists;
+	for (i = 0; i < playlists->len; i++)
+		if (mafw_proxy_playlist_get_id(playlists->pdata[i]) == id)
+			return playlists->pdata[i];
+	return NULL;
+}
+
 /*
  * Search .playlists and add a new object if none of them is identified
  * by $id.  Returns either the found or the newly created playlist.
@@ -286,20 +338,19 @@ static MafwProxyPlaylist *register_playlist(
 					   MafwPlaylistManager *self,
 					   guint id)
 {
-	guint i;
 	GPtrArray *playlists;
 	MafwProxyPlaylist *playlist;
 
 	/* Check if an object with $id already exists in .playlists.
 	 * Create it only if it doesn't. */
 	playlists = self->priv->playlists;
-	for (i = 0; i < playlists->len; i++)
-		if (mafw_proxy_playlist_get_id(playlists->pdata[i]) == id)
-			/* Found it */
-			return playlists->pdata[i];
+	if ((playlist = find_playlist(self, id)) != NULL)
+		return playlist;
 
 	/* No more playlists, so add the new one. */
-	playlist = MAFW_PROXY_PLAYLIST(mafw_proxy_playlist_new(id));
+	playlist = MAFW_PROXY_PLAYLIST(playlist_store_enabled()
+				       ? proxy_playlist_new_embedded(id)
+				       : mafw_proxy_playlist_new(id));
 
         if (playlist) {
                 g_ptr_array_add(playlists, playlist);
@@ -310,6 +361,114 @@ static MafwProxyPlaylist *register_playlist(
 	return playlist;
 }
 
+/* Playlist $id is gone, forget about it and tell the UI. */
+static void playlist_destroyed(MafwPlaylistManager *self, guint id)
+{
+	guint i;
+	GPtrArray *playlists;
+	MafwProxyPlaylist *playlist;
+
+	/* Do we have an object for this playlist?
+	 * Remove it from .playlists at once. */
+	playlist = NULL;
+	playlists = self->priv->playlists;
+	for (i = 0; i < playlists->len; i++)
+		if (mafw_proxy_playlist_get_id(playlists->pdata[i]) == id) {
+			playlist = g_ptr_array_remove_index(playlists, i);
+			break;
+		}
+
+	/*
+	 * Don't send the signal unless we found it in our repo
+	 * because this case the UI cannot possible be interested
+	 * in its destruction because if it had a reference to it
+	 * we'd have it too.
+	 */
+	if (playlist) {
+		if (G_OBJECT(playlist)->ref_count > 1)
+			g_signal_emit(self, Signal_list_destroyed.id, 0,
+				      playlist);
+		g_object_unref(playlist);
+	}
+}
+
+/* Playlist $id couldn't be destroyed, tell the UI. */
+static void playlist_destruction_failed(MafwPlaylistManager *self, guint id)
+{
+	MafwProxyPlaylist *playlist;
+
+	/* Don't send the signal unless we found it in our repo,
+	 * see playlist_destroyed(). */
+	if ((playlist = find_playlist(self, id)) != NULL)
+		g_signal_emit(self, Signal_list_destruction_failed.id, 0,
+			      playlist);
+}
+
+/* Sets @errp and returns TRUE if the playlists are kept in-process,
+ * for the operations only the playlist daemon implements. */
+static gboolean daemon_only(GError **errp)
+{
+	if (!playlist_store_enabled())
+		return FALSE;
+	g_set_error(errp, MAFW_PLAYLIST_ERROR,
+		    MAFW_PLAYLIST_ERROR_NOT_SUPPORTED,
+		    "Not supported by the in-process playlist store");
+	return TRUE;
+}
+
+/* Our list of playlists may be outdated, because the daemon has been
+ * restarted or its playlists have been restored from a backup.  Drops
+ * those gone and invalidates the caches of the rest. */
+static void resync(MafwPlaylistManager *self)
+{
+	guint i;
+	GPtrArray *playlists;
+	GArray *ids;
+	GError *err = NULL;
+
+	/* An UI may have a `reference' to our priv->playlists array, so
+	 * we must not change it suddenly.  We query the list of
+	 * playlist ids from the playlist daemon first... */
+	if (!(ids = do_get_playlists(&err))) {
+		g_warning("Cannot re-fetch playlist ids: %s",
+			  err->message);
+		g_error_free(err);
+		return;
+	}
+	/* ... and now we have the new list of playlists.  Remove each
+	 * playlist (and emit a signal) from the old list which don't
+	 * exist in the new.  It can be slow, as this is not expected to
+	 * happen often. */
+	playlists = self->priv->playlists;
+	for (i = 0; i < playlists->len; ) {
+		guint j, id;
+		MafwProxyPlaylist *pls;
+
+		id = mafw_proxy_playlist_get_id(playlists->pdata[i]);
+		for (j = 0; j < ids->len; ++j)
+			if (g_array_index(ids, guint, j) == id)
+				break;
+		if (j < ids->len) {
+			/* The new daemon may have different
+			 * ideas about its properties.  The items
+			 * can be resynchronized with
+			 * mafw_proxy_playlist_sync_since(). */
+			proxy_playlist_invalidate_cache(
+						playlists->pdata[i]);
+			i++;
+			continue;
+		}
+		/* The next one takes its place. */
+		pls = g_ptr_array_remove_index(playlists, i);
+		g_assert(pls);
+		if (G_OBJECT(pls)->ref_count > 1)
+			g_signal_emit(self, Signal_list_destroyed.id,
+				      0, pls);
+		g_object_unref(pls);
+	}
+	g_array_free(ids, TRUE);
+}
+
 /* Watch incomming D-BUS signals and keep .playlists updated. */
 static DBusHandlerResult dbus_handler(DBusConnection *con, DBusMessage *msg,
 				      MafwPlaylistManager *self)
@@ -322,11 +481,7 @@ static DBusHandlerResult dbus_handler(DBusConnection *con, DBusMessage *msg,
 	if (dbus_message_is_signal(msg, DBUS_INTERFACE_DBUS,
 				   "NameOwnerChanged"))
 	{
-		guint i;
 		gchar *name, *oldname, *newname;
-		GPtrArray *playlists;
-		GArray *ids;
-		GError *err = NULL;
 
 		name = oldname = newname = NULL;
 		mafw_dbus_parse(msg,
@@ -337,38 +492,7 @@ static DBusHandlerResult dbus_handler(DBusConnection *con, DBusMessage *msg,
 		if (strcmp(name, MAFW_PLAYLIST_SERVICE) ||
 		    !newname || !newname[0])
 			return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
-		/* An UI may have a `reference' to our priv->playlists array, so
-		 * we must not change it suddenly.  We query the list of
-		 * playlist ids from the new playlist daemon first... */
-		if (!(ids = do_get_playlists(&err))) {
-			g_warning("Cannot re-fetch playlist ids: %s",
-				  err->message);
-			g_error_free(err);
-			return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
-		}
-		/* ... and now we have the new list of playlists.  Remove each
-		 * playlist (and emit a signal) from the old list which don't
-		 * exist in the new.  It can be slow, as this is not expected to
-		 * happen often. */
-		playlists = self->priv->playlists;
-		for (i = 0; i < playlists->len; ++i) {
-			guint j, id;
-			MafwProxyPlaylist *pls;
-
-			id = mafw_proxy_playlist_get_id(playlists->pdata[i]);
-			for (j = 0; j < ids->len; ++j)
-				if (g_array_index(ids, guint, i) == id)
-					break;
-			if (j < ids->len)
-				continue;
-			pls = g_ptr_array_remove_index(playlists, i);
-			g_assert(pls);
-			if (G_OBJECT(pls)->ref_count > 1)
-				g_signal_emit(self, Signal_list_destroyed.id,
-					      0, pls);
-			g_object_unref(pls);
-		}
-		g_array_free(ids, TRUE);
+		resync(self);
 		return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
 	}
 
@@ -388,71 +512,21 @@ static DBusHandlerResult dbus_handler(DBusConnection *con, DBusMessage *msg,
 		g_signal_emit(self, Signal_list_created.id, 0,
 			      register_playlist(self, id));
 	} else if (!strcmp(member, Signal_list_destroyed.name)) {
-		guint i;
-		GPtrArray *playlists;
 		guint id;
-		MafwProxyPlaylist *playlist;
 
 		/* Parse error is an impossible event, because
 		 * the message must have been sent by us. */
 		mafw_dbus_parse(msg, DBUS_TYPE_UINT32, &id);
-
-		/* Do we have an object for this playlist?
-		 * Remove it from .playlists at once. */
-		playlist = NULL;
-		playlists = self->priv->playlists;
-		for (i = 0; i < playlists->len; i++)
-			if (mafw_proxy_playlist_get_id(playlists->pdata[i])
-			    == id) {
-				playlist = g_ptr_array_remove_index(playlists,
-								    i);
-				break;
-			}
-
-		/*
-		 * Don't send the signal unless we found it in our repo
-		 * because this case the UI cannot possible be interested
-		 * in its destruction because if it had a reference to it
-		 * we'd have it too.
-		 */
-		if (playlist) {
-			if (G_OBJECT(playlist)->ref_count > 1)
-				g_signal_emit(self, Signal_list_destroyed.id, 0,
-					      playlist);
-			g_object_unref(playlist);
-		}
+		playlist_destroyed(self, id);
+	} else if (!strcmp(member, MAFW_PLAYLIST_SIGNAL_PLAYLISTS_RESTORED)) {
+		resync(self);
 	} else if (!strcmp(member, Signal_list_destruction_failed.name)) {
-		guint i;
-		GPtrArray *playlists;
 		guint id;
-		MafwProxyPlaylist *playlist;
 
 		/* Parse error is an impossible event, because
 		 * the message must have been sent by us. */
 		mafw_dbus_parse(msg, DBUS_TYPE_UINT32, &id);
-
-		/* Do we have an object for this playlist? */
-
-		playlist = NULL;
-		playlists = self->priv->playlists;
-		for (i = 0; i < playlists->len; i++)
-			if (mafw_proxy_playlist_get_id(playlists->pdata[i])
-			    == id) {
-				playlist = g_ptr_array_index(playlists, i);
-				break;
-			}
-		/*
-		 * Don't send the signal unless we found it in our repo
-		 * because this case the UI cannot possible be interested
-		 * in its destruction because if it had a reference to it
-		 * we'd have it too.
-		 */
-		if (playlist) {
-			g_signal_emit(self,
-                                              Signal_list_destruction_failed.id,
-                                              0,
-					      playlist);
-		}
+		playlist_destruction_failed(self, id);
 	} else if (!strcmp(member, MAFW_PLAYLIST_METHOD_PLAYLIST_IMPORTED)) {
 		guint new_id, import_id;
 		struct _import_req *req;
@@ -489,6 +563,19 @@ static DBusHandlerResult dbus_handler(DBusConnection *con, DBusMessage *msg,
 		g_hash_table_remove(import_requests,
 				    GUINT_TO_POINTER(import_id));
 		return DBUS_HANDLER_RESULT_HANDLED;
+	} else if (!strcmp(member,
+			   MAFW_PLAYLIST_METHOD_PLAYLIST_IMPORT_PROGRESS)) {
+		guint import_id, count;
+
+		mafw_dbus_parse(msg, DBUS_TYPE_UINT32, &import_id,
+				DBUS_TYPE_UINT32, &count);
+		if (!import_requests
+		    || !g_hash_table_lookup(import_requests,
+					    GUINT_TO_POINTER(import_id)))
+			return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+		g_signal_emit(self, Signal_import_progress.id, 0,
+			      import_id, count);
+		return DBUS_HANDLER_RESULT_HANDLED;
 	}
 	/*
 	 * Pretend we didn't handle the message, so other filters in
@@ -528,8 +615,21 @@ MafwProxyPlaylist *mafw_playlist_manager_create_playlist(
 {
 	DBusMessage *reply;
 	DBusConnection *dbus;
+	MafwProxyPlaylist *playlist;
+	gboolean created;
 	guint id;
 
+	if (playlist_store_enabled()) {
+		id = playlist_store_create(name, &created, errp);
+		if (id == MAFW_PROXY_PLAYLIST_INVALID_ID)
+			return NULL;
+		playlist = register_playlist(self, id);
+		if (created)
+			g_signal_emit(self, Signal_list_created.id, 0,
+				      playlist);
+		return g_object_ref(playlist);
+	}
+
 	/*
 	 * Ask the playlist daemon to create the playlist without checking
 	 * the existence of $name in .playlists.  This is because neither
@@ -556,6 +656,159 @@ MafwProxyPlaylist *mafw_playlist_manager_create_playlist(
 	return g_object_ref(register_playlist(self, id));
 }
 
+/* Stores the id of the playlist in the @reply of CREATE_PLAYLIST or
+ * DUP_PLAYLIST. */
+static void parse_create(GSimpleAsyncResult *res, DBusMessage *reply)
+{
+	guint id;
+
+	mafw_dbus_parse(reply, DBUS_TYPE_UINT32, &id);
+	g_simple_async_result_set_op_res_gssize(res, id);
+}
+
+/**
+ * mafw_playlist_manager_create_playlist_async:
+ * @self:      a #MafwPlaylistManager instance.
+ * @name:      name of the playlist.
+ * @callback:  function to call when the playlist has been created
+ * @user_data: data to pass to @callback
+ *
+ * Like mafw_playlist_manager_create_playlist(), but returns without
+ * waiting for the playlist daemon.  @callback is called from the main
+ * loop, and can get the playlist with
+ * mafw_playlist_manager_create_playlist_finish().  Like the asynchronous
+ * operations of #MafwProxyPlaylist, it completes in order with them.
+ */
+void mafw_playlist_manager_create_playlist_async(MafwPlaylistManager *self,
+						 gchar const *name,
+						 GAsyncReadyCallback callback,
+						 gpointer user_data)
+{
+	GSimpleAsyncResult *res;
+	DBusConnection *dbus;
+	MafwProxyPlaylist *playlist;
+	GError *error = NULL;
+
+	res = g_simple_async_result_new(G_OBJECT(self), callback, user_data,
+				mafw_playlist_manager_create_playlist_async);
+	if (playlist_store_enabled()) {
+		/* It's immediate, only the completion is deferred. */
+		playlist = mafw_playlist_manager_create_playlist(self, name,
+								 &error);
+		if (playlist) {
+			g_simple_async_result_set_op_res_gssize(res,
+				mafw_proxy_playlist_get_id(playlist));
+			g_object_unref(playlist);
+		} else {
+			g_simple_async_result_take_error(res, error);
+		}
+		g_simple_async_result_complete_in_idle(res);
+		g_object_unref(res);
+		return;
+	}
+
+	if (!(dbus = mafw_dbus_session(&error))) {
+		g_simple_async_result_take_error(res, error);
+		g_simple_async_result_complete_in_idle(res);
+		g_object_unref(res);
+		return;
+	}
+	proxy_playlist_call_async(dbus, mafw_dbus_method(
+				      MAFW_PLAYLIST_METHOD_CREATE_PLAYLIST,
+				      MAFW_DBUS_STRING(name)),
+				  res, parse_create);
+	dbus_connection_unref(dbus);
+}
+
+/**
+ * mafw_playlist_manager_create_playlist_finish:
+ * @self: a #MafwPlaylistManager instance.
+ * @res:  the #GAsyncResult passed to the callback
+ * @errp: a #GError to store an error if needed
+ *
+ * Finishes mafw_playlist_manager_create_playlist_async().
+ *
+ * Returns: a #MafwProxyPlaylist which has the name, to be
+ * g_object_unref()ed by the caller, or %NULL on error.
+ */
+MafwProxyPlaylist *mafw_playlist_manager_create_playlist_finish(
+					   MafwPlaylistManager *self,
+					   GAsyncResult *res,
+					   GError **errp)
+{
+	MafwProxyPlaylist *playlist;
+
+	g_return_val_if_fail(g_simple_async_result_is_valid(res,
+				G_OBJECT(self),
+				mafw_playlist_manager_create_playlist_async),
+			     NULL);
+	if (g_simple_async_result_propagate_error(G_SIMPLE_ASYNC_RESULT(res),
+						  errp))
+		return NULL;
+
+	/* See mafw_playlist_manager_create_playlist() about the signal. */
+	playlist = register_playlist(self,
+			g_simple_async_result_get_op_res_gssize(
+					G_SIMPLE_ASYNC_RESULT(res)));
+	return playlist ? g_object_ref(playlist) : NULL;
+}
+
+/**
+ * mafw_playlist_manager_create_smart_playlist:
+ * @self:          a #MafwPlaylistManager instance.
+ * @name:          name of the playlist.
+ * @container:     object id of the container to browse.
+ * @filter:        filter to browse with, or %NULL.
+ * @sort_criteria: sort criteria to browse with, or %NULL.
+ * @errp:          a #GError to store an error if needed
+ *
+ * Creates a smart playlist with @name, holding the items browsing
+ * @container with @filter and @sort_criteria returns.  The playlist
+ * daemon fetches the items in pages as they are read, so the size of
+ * the playlist grows while it is being read, and it refreshes them when
+ * the source tells @container has changed.  Either way the playlist
+ * emits #MafwPlaylist::contents-changed.  The items of a smart playlist
+ * cannot be edited, those requests fail with
+ * %MAFW_PLAYLIST_ERROR_NOT_SUPPORTED, but it can be shuffled and
+ * repeated like any other.  Unlike mafw_playlist_manager_create_playlist()
+ * it fails if a playlist @name exists already.
+ *
+ * Returns: the new #MafwProxyPlaylist, to be g_object_unref()ed by the
+ * caller, or %NULL on error.
+ */
+MafwProxyPlaylist *mafw_playlist_manager_create_smart_playlist(
+					   MafwPlaylistManager *self,
+					   gchar const *name,
+					   gchar const *container,
+					   gchar const *filter,
+					   gchar const *sort_criteria,
+					   GError **errp)
+{
+	DBusMessage *reply;
+	DBusConnection *dbus;
+	guint id;
+
+	if (daemon_only(errp))
+		return NULL;
+	if (!(dbus = mafw_dbus_session(errp)))
+		return NULL;
+	reply = mafw_dbus_call(dbus, mafw_dbus_method(
+				      MAFW_PLAYLIST_METHOD_CREATE_SMART_PLAYLIST,
+				      MAFW_DBUS_STRING(name),
+				      MAFW_DBUS_STRING(container),
+				      MAFW_DBUS_STRING(filter ? filter : ""),
+				      MAFW_DBUS_STRING(sort_criteria
+						       ? sort_criteria : "")),
+			       MAFW_PLAYLIST_ERROR, errp);
+	dbus_connection_unref(dbus);
+	if (!reply)
+		return NULL;
+
+	mafw_dbus_parse(reply, DBUS_TYPE_UINT32, &id);
+	dbus_message_unref(reply);
+	return g_object_ref(register_playlist(self, id));
+}
+
 /**
  * mafw_playlist_manager_destroy_playlist:
  * @self: the #MafwPlaylistManager object
@@ -582,6 +835,20 @@ gboolean mafw_playlist_manager_destroy_playlist(
 {
 	DBusMessage *msg;
 	DBusConnection *dbus;
+	gboolean in_use;
+	guint id;
+
+	if (playlist_store_enabled()) {
+		/* Drop the caller's reference first, like we would
+		 * before the signal of the daemon arrives. */
+		id = mafw_proxy_playlist_get_id(playlist);
+		g_object_unref(playlist);
+		if (playlist_store_destroy(id, &in_use))
+			playlist_destroyed(self, id);
+		else if (in_use)
+			playlist_destruction_failed(self, id);
+		return TRUE;
+	}
 
 	/* Send the destroy command to the daemon.  The NO_REPLY flag
 	 * needs to be set otherwise dbusd or someone becomes upset
@@ -636,6 +903,10 @@ MafwProxyPlaylist *mafw_playlist_manager_get_playlist(
 		if (mafw_proxy_playlist_get_id(playlists->pdata[i]) == id)
 			return g_object_ref(playlists->pdata[i]);
 
+	if (playlist_store_enabled())
+		return playlist_store_exists(id)
+			? g_object_ref(register_playlist(self, id)) : NULL;
+
 	/* Not found, ask the daemon. */
 	if (!(dbus = mafw_dbus_session(errp)))
 		return NULL;
@@ -697,6 +968,144 @@ static GArray *do_get_playlists(GError **errp)
 	return ids;
 }
 
+/* Returns a zero-terminated #GArray of #MafwPlaylistManagerInfo:s from
+ * the @reply of LIST_PLAYLISTS_FULL, or %NULL and sets @errp if it is
+ * not what we expect. */
+static GArray *parse_playlists_full(DBusMessage *reply, GError **errp)
+{
+	GArray *infos;
+	DBusMessageIter imsg, iary, istr;
+
+	if (!dbus_message_has_signature(reply, "a(usubbut)")) {
+		g_set_error(errp, MAFW_PLAYLIST_ERROR,
+			    MAFW_PLAYLIST_ERROR_NOT_SUPPORTED,
+			    "Unexpected reply signature: %s",
+			    dbus_message_get_signature(reply));
+		return NULL;
+	}
+	infos = g_array_new(TRUE, FALSE, sizeof(MafwPlaylistManagerInfo));
+	dbus_message_iter_init(reply, &imsg);
+	dbus_message_iter_recurse(&imsg, &iary);
+	while (dbus_message_iter_get_arg_type(&iary) != DBUS_TYPE_INVALID)
+	{
+		MafwPlaylistManagerInfo info;
+		const gchar *name;
+		dbus_bool_t repeat, shuffled;
+		dbus_uint64_t mtime;
+
+		dbus_message_iter_recurse(&iary, &istr);
+		dbus_message_iter_get_basic(&istr, &info.id);
+		dbus_message_iter_next(&istr);
+		dbus_message_iter_get_basic(&istr, &name);
+		dbus_message_iter_next(&istr);
+		dbus_message_iter_get_basic(&istr, &info.size);
+		dbus_message_iter_next(&istr);
+		dbus_message_iter_get_basic(&istr, &repeat);
+		dbus_message_iter_next(&istr);
+		dbus_message_iter_get_basic(&istr, &shuffled);
+		dbus_message_iter_next(&istr);
+		dbus_message_iter_get_basic(&istr, &info.use_count);
+		dbus_message_iter_next(&istr);
+		dbus_message_iter_get_basic(&istr, &mtime);
+
+		info.name = g_strdup(name);
+		info.repeat = repeat;
+		info.shuffled = shuffled;
+		info.last_modified = mtime;
+		g_array_append_val(infos, info);
+		dbus_message_iter_next(&iary);
+	}
+
+	return infos;
+}
+
+/* Returns a zero-terminated #GArray of #MafwPlaylistManagerInfo:s of the
+ * playlists listed in @ids, or of all playlists if @ids is %NULL.
+ * @errp is set in case of errors, to %MAFW_PLAYLIST_ERROR_NOT_SUPPORTED
+ * if the daemon predates LIST_PLAYLISTS_FULL. */
+static GArray *do_list_playlists_full(const guint *ids, guint nids,
+				      GError **errp)
+{
+	GArray *infos;
+	DBusMessage *msg, *reply;
+	DBusConnection *dbus;
+	DBusError dbe;
+
+	if (playlist_store_enabled())
+		return playlist_store_list_full(ids, nids);
+
+	if (!(dbus = mafw_dbus_session(errp)))
+		return NULL;
+	msg = ids
+		? mafw_dbus_method(MAFW_PLAYLIST_METHOD_LIST_PLAYLISTS_FULL,
+				   DBUS_TYPE_ARRAY, DBUS_TYPE_UINT32,
+				   ids, nids)
+		: mafw_dbus_method(MAFW_PLAYLIST_METHOD_LIST_PLAYLISTS_FULL);
+
+	/* Like mafw_dbus_call(), but tells an unknown method apart from
+	 * a missing daemon. */
+	dbus_error_init(&dbe);
+	reply = dbus_connection_send_with_reply_and_block(dbus, msg, -1,
+							  &dbe);
+	dbus_message_unref(msg);
+	dbus_connection_unref(dbus);
+	if (!reply) {
+		if (dbus_error_has_name(&dbe, DBUS_ERROR_UNKNOWN_METHOD)) {
+			g_set_error(errp, MAFW_PLAYLIST_ERROR,
+				    MAFW_PLAYLIST_ERROR_NOT_SUPPORTED,
+				    "%s", dbe.message);
+			dbus_error_free(&dbe);
+		} else
+			mafw_dbus_error_to_gerror(MAFW_PLAYLIST_ERROR, errp,
+						  &dbe);
+		return NULL;
+	}
+
+	infos = parse_playlists_full(reply, errp);
+	dbus_message_unref(reply);
+
+	return infos;
+}
+
+/* Creates the playlists of the daemon missing from .playlists the way
+ * older daemons let us, with LIST_PLAYLISTS, without their properties. */
+static gboolean register_ids(MafwPlaylistManager *self, GError **errp)
+{
+	GArray *ids;
+	guint i;
+
+	if (!(ids = do_get_playlists(errp)))
+		return FALSE;
+	for (i = 0; i < ids->len; i++)
+		register_playlist(self, g_array_index(ids, guint, i));
+	g_array_free(ids, TRUE);
+	return TRUE;
+}
+
+/*
+ * Creates the playlists of $infos missing from .playlists, then frees
+ * $infos.  Since we get all their properties in the same reply, prime
+ * the playlists with them, saving the caller a round trip per property
+ * and playlist.
+ */
+static void register_infos(MafwPlaylistManager *self, GArray *infos)
+{
+	guint i;
+
+	for (i = 0; i < infos->len; ++i) {
+		MafwPlaylistManagerInfo *info;
+		MafwProxyPlaylist *playlist;
+
+		info = &g_array_index(infos, MafwPlaylistManagerInfo, i);
+		playlist = register_playlist(self, info->id);
+		if (playlist)
+			proxy_playlist_prime_cache(playlist, info->size,
+						   info->repeat,
+						   info->shuffled);
+	}
+	mafw_playlist_manager_free_list_of_playlists_full(infos);
+}
+
 /**
  * mafw_playlist_manager_get_playlists:
  * @self: the #MafwPlaylistManager
@@ -715,61 +1124,175 @@ GPtrArray *mafw_playlist_manager_get_playlists(
 					   MafwPlaylistManager *self,
 					   GError **errp)
 {
-	GArray *ids;
-	guint i;
+	GArray *infos;
+	GError *error = NULL;
 
 	/* Query the daemon and create all playlists missing from .playlists.
 	 * After this call .playlist will be up to date as long as we exist. */
-	if (!(ids = do_get_playlists(errp)))
+	if ((infos = do_list_playlists_full(NULL, 0, &error)) != NULL) {
+		register_infos(self, infos);
+	} else if (g_error_matches(error, MAFW_PLAYLIST_ERROR,
+				   MAFW_PLAYLIST_ERROR_NOT_SUPPORTED)) {
+		g_error_free(error);
+		if (!register_ids(self, errp))
+			return NULL;
+	} else {
+		g_propagate_error(errp, error);
 		return NULL;
-
-	for (i = 0; i < ids->len; ++i)
-		register_playlist(self, g_array_index(ids, guint, i));
-	g_array_free(ids, TRUE);
+	}
 
 	/* Ownership of the list is retained. */
 	return self->priv->playlists;
 }
 
-/**
- * mafw_playlist_manager_list_playlists:
- * @self: a #MafwPlaylistManager
- * @errp: a #GError to store an error if needed
- *
- * List the playlist stored in the #MiasPlaylistManager
- *
- * Returns: %NULL on error and sets @errp.  Otherwise a zero-terminated
- * array of #MafwPlaylistManagerItem objects of the shared playlists the
- * framework currently knows about.  The list is not kept up to date with
- * respect to changes in the shared playlists and is not ordered by any
- * means.  It is the caller's responsibility to free the returned array,
- * for example with mafw_playlist_manager_free_list_of_playlists().
- */
-GArray *mafw_playlist_manager_list_playlists(
-					   MafwPlaylistManager *self,
-					   GError **errp)
+/* Creates the playlists in the @reply of LIST_PLAYLISTS of an older
+ * daemon right away, leaving no infos for the finish function. */
+static void parse_get_playlist_ids(GSimpleAsyncResult *res,
+				   DBusMessage *reply)
 {
+	MafwPlaylistManager *self;
 	GArray *playlists;
+	guint i;
+
+	self = MAFW_PLAYLIST_MANAGER(g_async_result_get_source_object(
+						G_ASYNC_RESULT(res)));
+	playlists = parse_list(reply);
+	for (i = 0; i < playlists->len; i++)
+		register_playlist(self, g_array_index(playlists,
+						      MafwPlaylistManagerItem,
+						      i).id);
+	mafw_playlist_manager_free_list_of_playlists(playlists);
+	g_object_unref(self);
+}
+
+/* Completes the GSimpleAsyncResult $res of get_playlists_async() with the
+ * reply of LIST_PLAYLISTS_FULL, or falls back to LIST_PLAYLISTS if the
+ * daemon doesn't know it. */
+static void got_playlists_full(DBusPendingCall *pending, gpointer res)
+{
 	DBusMessage *reply;
 	DBusConnection *dbus;
-	DBusMessageIter imsg, iary, istr;
+	GArray *infos;
+	GError *error = NULL;
 
-	if (!(dbus = mafw_dbus_session(errp)))
-		return NULL;
-	reply = mafw_dbus_call(dbus, mafw_dbus_method(
-				     MAFW_PLAYLIST_METHOD_LIST_PLAYLISTS),
-			       MAFW_PLAYLIST_ERROR, errp);
-	dbus_connection_unref(dbus);
-	if (!reply)
-		return NULL;
+	reply = dbus_pending_call_steal_reply(pending);
+	dbus_pending_call_unref(pending);
 
-	/* Parse $reply and fill $playlists with its contents. */
-	playlists = g_array_new(TRUE, FALSE,
-			       	sizeof(MafwPlaylistManagerItem));
-	dbus_message_iter_init(reply, &imsg);
-	g_assert(dbus_message_iter_get_arg_type(&imsg) == DBUS_TYPE_ARRAY);
-	dbus_message_iter_recurse(&imsg, &iary);
-	while (dbus_message_iter_get_arg_type(&iary) != DBUS_TYPE_INVALID)
+	if (dbus_message_is_error(reply, DBUS_ERROR_UNKNOWN_METHOD)
+	    && (dbus = mafw_dbus_session(&error)) != NULL) {
+		dbus_message_unref(reply);
+		proxy_playlist_call_async(dbus, mafw_dbus_method(
+					MAFW_PLAYLIST_METHOD_LIST_PLAYLISTS),
+					  res, parse_get_playlist_ids);
+		dbus_connection_unref(dbus);
+		return;
+	}
+
+	if (!error && !(error = mafw_dbus_is_error(reply, MAFW_PLAYLIST_ERROR))
+	    && (infos = parse_playlists_full(reply, &error)) != NULL)
+		g_simple_async_result_set_op_res_gpointer(res, infos,
+			(GDestroyNotify)
+			mafw_playlist_manager_free_list_of_playlists_full);
+	if (error)
+		g_simple_async_result_take_error(res, error);
+	dbus_message_unref(reply);
+	g_simple_async_result_complete(res);
+	g_object_unref(res);
+}
+
+/**
+ * mafw_playlist_manager_get_playlists_async:
+ * @self:      the #MafwPlaylistManager
+ * @callback:  function to call when the playlists are known
+ * @user_data: data to pass to @callback
+ *
+ * Like mafw_playlist_manager_get_playlists(), but returns without waiting
+ * for the playlist daemon.  @callback is called from the main loop, and
+ * can get the playlists with mafw_playlist_manager_get_playlists_finish().
+ */
+void mafw_playlist_manager_get_playlists_async(MafwPlaylistManager *self,
+					       GAsyncReadyCallback callback,
+					       gpointer user_data)
+{
+	GSimpleAsyncResult *res;
+	DBusConnection *dbus;
+	DBusPendingCall *pending;
+	GError *error = NULL;
+
+	res = g_simple_async_result_new(G_OBJECT(self), callback, user_data,
+				mafw_playlist_manager_get_playlists_async);
+	if (playlist_store_enabled()) {
+		g_simple_async_result_set_op_res_gpointer(res,
+			playlist_store_list_full(NULL, 0),
+			(GDestroyNotify)
+			mafw_playlist_manager_free_list_of_playlists_full);
+		g_simple_async_result_complete_in_idle(res);
+		g_object_unref(res);
+		return;
+	}
+
+	if (!(dbus = mafw_dbus_session(&error))) {
+		g_simple_async_result_take_error(res, error);
+		g_simple_async_result_complete_in_idle(res);
+		g_object_unref(res);
+		return;
+	}
+	mafw_dbus_send_async(dbus, &pending, mafw_dbus_method(
+				MAFW_PLAYLIST_METHOD_LIST_PLAYLISTS_FULL));
+	dbus_pending_call_set_notify(pending, got_playlists_full, res, NULL);
+	dbus_connection_unref(dbus);
+}
+
+/**
+ * mafw_playlist_manager_get_playlists_finish:
+ * @self: the #MafwPlaylistManager
+ * @res:  the #GAsyncResult passed to the callback
+ * @errp: a #GError to store the error if needed
+ *
+ * Finishes mafw_playlist_manager_get_playlists_async().
+ *
+ * Returns: %NULL on error, otherwise the same array as
+ * mafw_playlist_manager_get_playlists().  The caller may not modify nor
+ * free it.
+ */
+GPtrArray *mafw_playlist_manager_get_playlists_finish(
+					   MafwPlaylistManager *self,
+					   GAsyncResult *res,
+					   GError **errp)
+{
+	GSimpleAsyncResult *simple;
+	GArray *infos;
+
+	g_return_val_if_fail(g_simple_async_result_is_valid(res,
+				G_OBJECT(self),
+				mafw_playlist_manager_get_playlists_async),
+			     NULL);
+	simple = G_SIMPLE_ASYNC_RESULT(res);
+	if (g_simple_async_result_propagate_error(simple, errp))
+		return NULL;
+
+	/* register_infos() takes the infos over. */
+	infos = g_simple_async_result_get_op_res_gpointer(simple);
+	g_simple_async_result_set_op_res_gpointer(simple, NULL, NULL);
+	if (infos)
+		register_infos(self, infos);
+	return self->priv->playlists;
+}
+
+/* Returns a zero-terminated #GArray of #MafwPlaylistManagerItem:s from
+ * the @reply of LIST_PLAYLISTS. */
+static GArray *parse_list(DBusMessage *reply)
+{
+	GArray *playlists;
+	DBusMessageIter imsg, iary, istr;
+
+	/* Parse $reply and fill $playlists with its contents. */
+	playlists = g_array_new(TRUE, FALSE,
+			       	sizeof(MafwPlaylistManagerItem));
+	dbus_message_iter_init(reply, &imsg);
+	g_assert(dbus_message_iter_get_arg_type(&imsg) == DBUS_TYPE_ARRAY);
+	dbus_message_iter_recurse(&imsg, &iary);
+	while (dbus_message_iter_get_arg_type(&iary) != DBUS_TYPE_INVALID)
 	{
 		MafwPlaylistManagerItem plit;
 
@@ -790,11 +1313,135 @@ GArray *mafw_playlist_manager_list_playlists(
 		g_array_append_val(playlists, plit);
 		dbus_message_iter_next(&iary);
 	}
+
+	return playlists;
+}
+
+/**
+ * mafw_playlist_manager_list_playlists:
+ * @self: a #MafwPlaylistManager
+ * @errp: a #GError to store an error if needed
+ *
+ * List the playlist stored in the #MiasPlaylistManager
+ *
+ * Returns: %NULL on error and sets @errp.  Otherwise a zero-terminated
+ * array of #MafwPlaylistManagerItem objects of the shared playlists the
+ * framework currently knows about.  The list is not kept up to date with
+ * respect to changes in the shared playlists and is not ordered by any
+ * means.  It is the caller's responsibility to free the returned array,
+ * for example with mafw_playlist_manager_free_list_of_playlists().
+ */
+GArray *mafw_playlist_manager_list_playlists(
+					   MafwPlaylistManager *self,
+					   GError **errp)
+{
+	GArray *playlists;
+	DBusMessage *reply;
+	DBusConnection *dbus;
+
+	if (playlist_store_enabled())
+		return playlist_store_list();
+
+	if (!(dbus = mafw_dbus_session(errp)))
+		return NULL;
+	reply = mafw_dbus_call(dbus, mafw_dbus_method(
+				     MAFW_PLAYLIST_METHOD_LIST_PLAYLISTS),
+			       MAFW_PLAYLIST_ERROR, errp);
+	dbus_connection_unref(dbus);
+	if (!reply)
+		return NULL;
+
+	playlists = parse_list(reply);
 	dbus_message_unref(reply);
 
 	return playlists;
 }
 
+/* Stores the list in the @reply of LIST_PLAYLISTS. */
+static void parse_list_playlists(GSimpleAsyncResult *res,
+				 DBusMessage *reply)
+{
+	g_simple_async_result_set_op_res_gpointer(res, parse_list(reply),
+			(GDestroyNotify)
+			mafw_playlist_manager_free_list_of_playlists);
+}
+
+/**
+ * mafw_playlist_manager_list_playlists_async:
+ * @self:      a #MafwPlaylistManager
+ * @callback:  function to call with the list
+ * @user_data: data to pass to @callback
+ *
+ * Like mafw_playlist_manager_list_playlists(), but returns without
+ * waiting for the playlist daemon.  @callback is called from the main
+ * loop, and can get the list with
+ * mafw_playlist_manager_list_playlists_finish().
+ */
+void mafw_playlist_manager_list_playlists_async(MafwPlaylistManager *self,
+						GAsyncReadyCallback callback,
+						gpointer user_data)
+{
+	GSimpleAsyncResult *res;
+	DBusConnection *dbus;
+	GError *error = NULL;
+
+	res = g_simple_async_result_new(G_OBJECT(self), callback, user_data,
+				mafw_playlist_manager_list_playlists_async);
+	if (playlist_store_enabled()) {
+		g_simple_async_result_set_op_res_gpointer(res,
+			playlist_store_list(),
+			(GDestroyNotify)
+			mafw_playlist_manager_free_list_of_playlists);
+		g_simple_async_result_complete_in_idle(res);
+		g_object_unref(res);
+		return;
+	}
+
+	if (!(dbus = mafw_dbus_session(&error))) {
+		g_simple_async_result_take_error(res, error);
+		g_simple_async_result_complete_in_idle(res);
+		g_object_unref(res);
+		return;
+	}
+	proxy_playlist_call_async(dbus, mafw_dbus_method(
+					MAFW_PLAYLIST_METHOD_LIST_PLAYLISTS),
+				  res, parse_list_playlists);
+	dbus_connection_unref(dbus);
+}
+
+/**
+ * mafw_playlist_manager_list_playlists_finish:
+ * @self: a #MafwPlaylistManager
+ * @res:  the #GAsyncResult passed to the callback
+ * @errp: a #GError to store an error if needed
+ *
+ * Finishes mafw_playlist_manager_list_playlists_async().
+ *
+ * Returns: %NULL on error, otherwise the same as
+ * mafw_playlist_manager_list_playlists(), to be freed by the caller.
+ */
+GArray *mafw_playlist_manager_list_playlists_finish(
+					   MafwPlaylistManager *self,
+					   GAsyncResult *res,
+					   GError **errp)
+{
+	GSimpleAsyncResult *simple;
+	GArray *playlists;
+
+	g_return_val_if_fail(g_simple_async_result_is_valid(res,
+				G_OBJECT(self),
+				mafw_playlist_manager_list_playlists_async),
+			     NULL);
+	simple = G_SIMPLE_ASYNC_RESULT(res);
+	if (g_simple_async_result_propagate_error(simple, errp))
+		return NULL;
+
+	/* The caller takes the list over. */
+	playlists = g_simple_async_result_get_op_res_gpointer(simple);
+	g_simple_async_result_set_op_res_gpointer(simple, NULL, NULL);
+	return playlists;
+}
+
 /**
  * mafw_playlist_manager_free_list_of_playlists:
  * @playlist_list: an array of #MafwPlaylistManagerItem to free
@@ -817,48 +1464,93 @@ void mafw_playlist_manager_free_list_of_playlists(
 }
 
 /**
- * mafw_playlist_manager_import:
- * @self: a #MafwPlaylistManager instance.
- * @playlist: Uri to playlist, playlist object id or container objectid.
- * @cb: callback to be called, when it finished with the import, or error
- * occured
- * @base_uri: If not %NULL, used as prefix to resolve relative paths found from
- * playlist.
- * @user_data:     Optional user data pointer passed along with @browse_cb.
- * @error:	   Return location for a #GError, or %NULL
+ * mafw_playlist_manager_list_playlists_full:
+ * @self: a #MafwPlaylistManager
+ * @ids:  the IDs of the playlists to list, or %NULL for all playlists
+ * @nids: the number of elements in @ids
+ * @errp: a #GError to store an error if needed
  *
- * Imports external playlists files and shares them in mafw environment.
- * Returns: The identifier of the import session (which is also passed
- *          to @cb). If some arguments were invalid,
- *          %MAFW_PLAYLIST_MANAGER_INVALID_IMPORT_ID is returned.
+ * Like mafw_playlist_manager_list_playlists(), but returns every property
+ * of the playlists in one round trip.  Playlists the manager already has
+ * an object for are updated with the received properties, so subsequent
+ * mafw_playlist_get_size() and alike calls on them don't need to consult
+ * the daemon.  Non-existing playlists are omitted from the result.
+ *
+ * Returns: %NULL on error and sets @errp.  Otherwise a zero-terminated
+ * array of #MafwPlaylistManagerInfo structures, which should be freed
+ * with mafw_playlist_manager_free_list_of_playlists_full().
  */
-guint mafw_playlist_manager_import(MafwPlaylistManager *self,
-				    const gchar *playlist,
-				    const gchar *base_uri,
-				    MafwPlaylistManagerImportCb cb,
-				    gpointer user_data,
-				    GError **error)
+GArray *mafw_playlist_manager_list_playlists_full(
+					   MafwPlaylistManager *self,
+					   const guint *ids,
+					   guint nids,
+					   GError **errp)
+{
+	GArray *infos;
+	guint i;
+
+	if (!(infos = do_list_playlists_full(ids, nids, errp)))
+		return NULL;
+
+	for (i = 0; i < infos->len; i++) {
+		MafwPlaylistManagerInfo *info;
+		MafwProxyPlaylist *playlist;
+
+		info = &g_array_index(infos, MafwPlaylistManagerInfo, i);
+		if ((playlist = find_playlist(self, info->id)) != NULL)
+			proxy_playlist_prime_cache(playlist, info->size,
+						   info->repeat,
+						   info->shuffled);
+	}
+	return infos;
+}
+
+/**
+ * mafw_playlist_manager_free_list_of_playlists_full:
+ * @playlist_list: an array of #MafwPlaylistManagerInfo to free
+ * 		   or %NULL.
+ *
+ * Releases @playlist_list and all dynamically allocated structures
+ * contained therein.  If @playlist_list is %NULL it does nothing.
+ */
+void mafw_playlist_manager_free_list_of_playlists_full(
+					   GArray *playlist_list)
+{
+	guint i;
+
+	if (!playlist_list)
+		return;
+	for (i = 0; i < playlist_list->len; i++)
+		g_free(g_array_index(playlist_list,
+				     MafwPlaylistManagerInfo, i).name);
+	g_array_free(playlist_list, TRUE);
+}
+
+/* Sends the import request, with @recursive if it is not %NULL. */
+static guint do_import(const gchar *playlist, const gchar *base_uri,
+		       const gboolean *recursive,
+		       MafwPlaylistManagerImportCb cb, gpointer user_data,
+		       GError **error)
 {
 	DBusConnection *dbus;
-	DBusMessage *reply;
+	DBusMessage *msg, *reply;
 	guint import_id;
 
-	g_return_val_if_fail(self != NULL,
-                             MAFW_PLAYLIST_MANAGER_INVALID_IMPORT_ID);
-	g_return_val_if_fail(playlist != NULL && playlist[0] != '\0',
-				MAFW_PLAYLIST_MANAGER_INVALID_IMPORT_ID);
-	g_return_val_if_fail(cb != NULL,
-                             MAFW_PLAYLIST_MANAGER_INVALID_IMPORT_ID);
-
+	if (daemon_only(error))
+		return MAFW_PLAYLIST_MANAGER_INVALID_IMPORT_ID;
 	if (!(dbus = mafw_dbus_session(error)))
 		return MAFW_PLAYLIST_MANAGER_INVALID_IMPORT_ID;
 
-	reply = mafw_dbus_call(
-		dbus,
-		mafw_dbus_method(MAFW_PLAYLIST_METHOD_IMPORT_PLAYLIST,
-				  MAFW_DBUS_STRING(playlist),
-				  MAFW_DBUS_STRING(base_uri ? base_uri : "")),
-				  MAFW_SOURCE_ERROR, error);
+	if (recursive)
+		msg = mafw_dbus_method(MAFW_PLAYLIST_METHOD_IMPORT_PLAYLIST,
+				MAFW_DBUS_STRING(playlist),
+				MAFW_DBUS_STRING(base_uri ? base_uri : ""),
+				MAFW_DBUS_BOOLEAN(*recursive));
+	else
+		msg = mafw_dbus_method(MAFW_PLAYLIST_METHOD_IMPORT_PLAYLIST,
+				MAFW_DBUS_STRING(playlist),
+				MAFW_DBUS_STRING(base_uri ? base_uri : ""));
+	reply = mafw_dbus_call(dbus, msg, MAFW_SOURCE_ERROR, error);
 
 	if (reply) {
 		struct _import_req *new_req;
@@ -889,6 +1581,81 @@ guint mafw_playlist_manager_import(MafwPlaylistManager *self,
 	return import_id;
 }
 
+/**
+ * mafw_playlist_manager_import:
+ * @self: a #MafwPlaylistManager instance.
+ * @playlist: Uri to playlist, playlist object id or container objectid.
+ * @cb: callback to be called, when it finished with the import, or error
+ * occured
+ * @base_uri: If not %NULL, used as prefix to resolve relative paths found from
+ * playlist.
+ * @user_data:     Optional user data pointer passed along with @browse_cb.
+ * @error:	   Return location for a #GError, or %NULL
+ *
+ * Imports external playlists files and shares them in mafw environment.
+ * Large containers are imported page by page; the new playlist may be
+ * announced with #MafwPlaylistManager::playlist-created before @cb is
+ * called.
+ *
+ * Returns: The identifier of the import session (which is also passed
+ *          to @cb). If some arguments were invalid,
+ *          %MAFW_PLAYLIST_MANAGER_INVALID_IMPORT_ID is returned.
+ */
+guint mafw_playlist_manager_import(MafwPlaylistManager *self,
+				    const gchar *playlist,
+				    const gchar *base_uri,
+				    MafwPlaylistManagerImportCb cb,
+				    gpointer user_data,
+				    GError **error)
+{
+	g_return_val_if_fail(self != NULL,
+                             MAFW_PLAYLIST_MANAGER_INVALID_IMPORT_ID);
+	g_return_val_if_fail(playlist != NULL && playlist[0] != '\0',
+				MAFW_PLAYLIST_MANAGER_INVALID_IMPORT_ID);
+	g_return_val_if_fail(cb != NULL,
+                             MAFW_PLAYLIST_MANAGER_INVALID_IMPORT_ID);
+
+	return do_import(playlist, base_uri, NULL, cb, user_data, error);
+}
+
+/**
+ * mafw_playlist_manager_import_recursive:
+ * @self: a #MafwPlaylistManager instance.
+ * @playlist: Uri to playlist, playlist object id or container objectid.
+ * @base_uri: If not %NULL, used as prefix to resolve relative paths found from
+ * playlist.
+ * @recursive: if @playlist is a container, import the items of its
+ *             subcontainers too, instead of the subcontainers themselves.
+ * @cb: callback to be called, when it finished with the import, or error
+ * occured
+ * @user_data:     Optional user data pointer passed along with @cb.
+ * @error:	   Return location for a #GError, or %NULL
+ *
+ * Like mafw_playlist_manager_import(), but lets you choose how to import
+ * containers.
+ *
+ * Returns: The identifier of the import session, or
+ *          %MAFW_PLAYLIST_MANAGER_INVALID_IMPORT_ID.
+ */
+guint mafw_playlist_manager_import_recursive(MafwPlaylistManager *self,
+					      const gchar *playlist,
+					      const gchar *base_uri,
+					      gboolean recursive,
+					      MafwPlaylistManagerImportCb cb,
+					      gpointer user_data,
+					      GError **error)
+{
+	g_return_val_if_fail(self != NULL,
+                             MAFW_PLAYLIST_MANAGER_INVALID_IMPORT_ID);
+	g_return_val_if_fail(playlist != NULL && playlist[0] != '\0',
+				MAFW_PLAYLIST_MANAGER_INVALID_IMPORT_ID);
+	g_return_val_if_fail(cb != NULL,
+                             MAFW_PLAYLIST_MANAGER_INVALID_IMPORT_ID);
+
+	return do_import(playlist, base_uri, &recursive, cb, user_data,
+			 error);
+}
+
 /**
  * mafw_playlist_manager_cancel_import:
  * @self:      A MafwPlaylistManager instance.
@@ -905,6 +1672,8 @@ gboolean mafw_playlist_manager_cancel_import(MafwPlaylistManager *self,
 {
 	struct _import_req *req;
 
+	if (daemon_only(error))
+		return FALSE;
 	req = g_hash_table_lookup(import_requests,
 				  GUINT_TO_POINTER(import_id));
 	if (!req)
@@ -978,6 +1747,17 @@ MafwProxyPlaylist *mafw_playlist_manager_dup_playlist(
 	g_return_val_if_fail(playlist, NULL);
 	g_return_val_if_fail(new_name, NULL);
 
+	if (playlist_store_enabled()) {
+		new_id = playlist_store_dup(
+				mafw_proxy_playlist_get_id(playlist),
+				new_name, errp);
+		if (new_id == MAFW_PROXY_PLAYLIST_INVALID_ID)
+			return NULL;
+		playlist = register_playlist(self, new_id);
+		g_signal_emit(self, Signal_list_created.id, 0, playlist);
+		return g_object_ref(playlist);
+	}
+
         if (!(dbus = mafw_dbus_session(errp)))
                 return NULL;
 	id = mafw_proxy_playlist_get_id(playlist);
@@ -995,4 +1775,271 @@ MafwProxyPlaylist *mafw_playlist_manager_dup_playlist(
 
         return g_object_ref(register_playlist(self, new_id));
 }
+
+/**
+ * mafw_playlist_manager_dup_playlist_async:
+ * @self:      a #MafwPlaylistManager instance.
+ * @playlist:  playlist to duplicate
+ * @new_name:  name for the duplicated playlist.
+ * @callback:  function to call when the playlist has been duplicated
+ * @user_data: data to pass to @callback
+ *
+ * Like mafw_playlist_manager_dup_playlist(), but returns without waiting
+ * for the playlist daemon.  @callback is called from the main loop, and
+ * can get the new playlist with
+ * mafw_playlist_manager_dup_playlist_finish().
+ */
+void mafw_playlist_manager_dup_playlist_async(MafwPlaylistManager *self,
+					      MafwProxyPlaylist *playlist,
+					      gchar const *new_name,
+					      GAsyncReadyCallback callback,
+					      gpointer user_data)
+{
+	GSimpleAsyncResult *res;
+	DBusConnection *dbus;
+	MafwProxyPlaylist *dup;
+	GError *error = NULL;
+
+	g_return_if_fail(playlist);
+	g_return_if_fail(new_name);
+
+	res = g_simple_async_result_new(G_OBJECT(self), callback, user_data,
+				mafw_playlist_manager_dup_playlist_async);
+	if (playlist_store_enabled()) {
+		dup = mafw_playlist_manager_dup_playlist(self, playlist,
+							 new_name, &error);
+		if (dup) {
+			g_simple_async_result_set_op_res_gssize(res,
+				mafw_proxy_playlist_get_id(dup));
+			g_object_unref(dup);
+		} else {
+			g_simple_async_result_take_error(res, error);
+		}
+		g_simple_async_result_complete_in_idle(res);
+		g_object_unref(res);
+		return;
+	}
+
+	if (!(dbus = mafw_dbus_session(&error))) {
+		g_simple_async_result_take_error(res, error);
+		g_simple_async_result_complete_in_idle(res);
+		g_object_unref(res);
+		return;
+	}
+	proxy_playlist_call_async(dbus, mafw_dbus_method(
+				MAFW_PLAYLIST_METHOD_DUP_PLAYLIST,
+				MAFW_DBUS_UINT32(
+					mafw_proxy_playlist_get_id(playlist)),
+				MAFW_DBUS_STRING(new_name)),
+				  res, parse_create);
+	dbus_connection_unref(dbus);
+}
+
+/**
+ * mafw_playlist_manager_dup_playlist_finish:
+ * @self: a #MafwPlaylistManager instance.
+ * @res:  the #GAsyncResult passed to the callback
+ * @errp: a #GError to store an error if needed
+ *
+ * Finishes mafw_playlist_manager_dup_playlist_async().
+ *
+ * Returns: the new duplicated playlist, to be g_object_unref()ed by the
+ * caller, or %NULL on error.
+ */
+MafwProxyPlaylist *mafw_playlist_manager_dup_playlist_finish(
+					   MafwPlaylistManager *self,
+					   GAsyncResult *res,
+					   GError **errp)
+{
+	MafwProxyPlaylist *playlist;
+
+	g_return_val_if_fail(g_simple_async_result_is_valid(res,
+				G_OBJECT(self),
+				mafw_playlist_manager_dup_playlist_async),
+			     NULL);
+	if (g_simple_async_result_propagate_error(G_SIMPLE_ASYNC_RESULT(res),
+						  errp))
+		return NULL;
+
+	playlist = register_playlist(self,
+			g_simple_async_result_get_op_res_gssize(
+					G_SIMPLE_ASYNC_RESULT(res)));
+	return playlist ? g_object_ref(playlist) : NULL;
+}
+
+/* Forgets the cached properties of $dst, which the daemon has just
+ * changed, before its signals arrive.  The caller may have its own proxy
+ * of the playlist besides ours, whose cache is stale all the same. */
+static void invalidate_target(MafwPlaylistManager *self,
+			      MafwProxyPlaylist *dst)
+{
+	MafwProxyPlaylist *ours;
+
+	proxy_playlist_invalidate_cache(dst);
+	ours = find_playlist(self, mafw_proxy_playlist_get_id(dst));
+	if (ours && ours != dst)
+		proxy_playlist_invalidate_cache(ours);
+}
+
+/**
+ * mafw_playlist_manager_copy_range:
+ * @self:  A MafwPlaylistManager instance.
+ * @src:   the playlist to copy from
+ * @from:  index of the first item of @src to copy
+ * @count: number of items to copy
+ * @dst:   the playlist to copy to, may be @src
+ * @at:    the items are inserted before this index of @dst
+ * @errp:  a #GError to store an error if needed
+ *
+ * Copies @count items of @src to @dst, in the daemon, without fetching
+ * them.  @dst emits #MafwPlaylist::contents-changed once.
+ *
+ * Returns: %TRUE on success.
+ */
+gboolean mafw_playlist_manager_copy_range(MafwPlaylistManager *self,
+					  MafwProxyPlaylist *src,
+					  guint from, guint count,
+					  MafwProxyPlaylist *dst, guint at,
+					  GError **errp)
+{
+	DBusMessage *reply;
+	DBusConnection *dbus;
+
+	g_return_val_if_fail(src, FALSE);
+	g_return_val_if_fail(dst, FALSE);
+
+	if (playlist_store_enabled())
+		return playlist_store_copy_range(
+				mafw_proxy_playlist_get_id(src), from, count,
+				dst, at, errp);
+
+	if (!(dbus = mafw_dbus_session(errp)))
+		return FALSE;
+	reply = mafw_dbus_call(dbus, mafw_dbus_method(
+				MAFW_PLAYLIST_METHOD_COPY_RANGE,
+				MAFW_DBUS_UINT32(
+					mafw_proxy_playlist_get_id(src)),
+				MAFW_DBUS_UINT32(from),
+				MAFW_DBUS_UINT32(count),
+				MAFW_DBUS_UINT32(
+					mafw_proxy_playlist_get_id(dst)),
+				MAFW_DBUS_UINT32(at)),
+			       MAFW_PLAYLIST_ERROR, errp);
+	dbus_connection_unref(dbus);
+	if (!reply)
+		return FALSE;
+	dbus_message_unref(reply);
+	invalidate_target(self, dst);
+	return TRUE;
+}
+
+/**
+ * mafw_playlist_manager_concat:
+ * @self:   A MafwPlaylistManager instance.
+ * @srcs:   the playlists to append
+ * @nsrcs:  length of @srcs
+ * @dst:    the playlist to append to, it may be among @srcs too
+ * @errp:   a #GError to store an error if needed
+ *
+ * Appends the items of every playlist in @srcs, in order, to @dst in the
+ * daemon.  @dst emits #MafwPlaylist::contents-changed once.  If any of
+ * the playlists is gone, nothing is changed.
+ *
+ * Returns: %TRUE on success.
+ */
+gboolean mafw_playlist_manager_concat(MafwPlaylistManager *self,
+				      MafwProxyPlaylist **srcs, guint nsrcs,
+				      MafwProxyPlaylist *dst,
+				      GError **errp)
+{
+	DBusMessage *reply;
+	DBusConnection *dbus;
+	dbus_uint32_t *ids;
+	guint i;
+
+	g_return_val_if_fail(srcs || !nsrcs, FALSE);
+	g_return_val_if_fail(dst, FALSE);
+
+	ids = g_new(dbus_uint32_t, nsrcs);
+	for (i = 0; i < nsrcs; i++)
+		ids[i] = mafw_proxy_playlist_get_id(srcs[i]);
+	if (playlist_store_enabled()) {
+		gboolean ok;
+
+		ok = playlist_store_concat(ids, nsrcs, dst, errp);
+		g_free(ids);
+		return ok;
+	}
+
+	if (!(dbus = mafw_dbus_session(errp))) {
+		g_free(ids);
+		return FALSE;
+	}
+	reply = mafw_dbus_call(dbus, mafw_dbus_method(
+				MAFW_PLAYLIST_METHOD_CONCAT,
+				DBUS_TYPE_ARRAY, DBUS_TYPE_UINT32, ids, nsrcs,
+				MAFW_DBUS_UINT32(
+					mafw_proxy_playlist_get_id(dst))),
+			       MAFW_PLAYLIST_ERROR, errp);
+	g_free(ids);
+	dbus_connection_unref(dbus);
+	if (!reply)
+		return FALSE;
+	dbus_message_unref(reply);
+	invalidate_target(self, dst);
+	return TRUE;
+}
+
+/**
+ * mafw_playlist_manager_get_quota:
+ * @self:   A MafwPlaylistManager instance.
+ * @client: unique bus name of a client, or %NULL for this process
+ * @usage:  where to store the resources charged to @client, or %NULL
+ * @limits: where to store the limits of them, or %NULL
+ * @errp:   a #GError to store an error if needed
+ *
+ * Queries the quota of a client in the playlist daemon.  Playlists are
+ * charged to the client creating them.  Fields of @limits which are
+ * zero are not enforced.  Requests over the limits fail with
+ * %MAFW_PLAYLIST_ERROR_QUOTA_EXCEEDED.
+ *
+ * Returns: %TRUE on success.
+ */
+gboolean mafw_playlist_manager_get_quota(MafwPlaylistManager *self,
+					 const gchar *client,
+					 MafwPlaylistManagerQuota *usage,
+					 MafwPlaylistManagerQuota *limits,
+					 GError **errp)
+{
+	DBusMessage *reply;
+	DBusConnection *dbus;
+	MafwPlaylistManagerQuota u, l;
+
+	if (daemon_only(errp))
+		return FALSE;
+	if (!(dbus = mafw_dbus_session(errp)))
+		return FALSE;
+	reply = mafw_dbus_call(dbus, mafw_dbus_method(
+				MAFW_PLAYLIST_METHOD_GET_QUOTA,
+				MAFW_DBUS_STRING(client ? client : "")),
+			       MAFW_PLAYLIST_ERROR, errp);
+	dbus_connection_unref(dbus);
+	if (!reply)
+		return FALSE;
+	mafw_dbus_parse(reply,
+			DBUS_TYPE_UINT32, &u.playlists,
+			DBUS_TYPE_UINT32, &u.entries,
+			DBUS_TYPE_UINT64, &u.bytes,
+			DBUS_TYPE_UINT32, &u.requests,
+			DBUS_TYPE_UINT32, &l.playlists,
+			DBUS_TYPE_UINT32, &l.entries,
+			DBUS_TYPE_UINT64, &l.bytes,
+			DBUS_TYPE_UINT32, &l.requests);
+	dbus_message_unref(reply);
+	if (usage)
+		*usage = u;
+	if (limits)
+		*limits = l;
+	return TRUE;
+}
 /* vi: set noexpandtab ts=8 sw=8 cino=t0,(0: */
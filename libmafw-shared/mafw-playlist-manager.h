@@ -28,6 +28,7 @@
 /* Include files */
 #include <glib.h>
 #include <glib-object.h>
+#include <gio/gio.h>
 
 #include <libmafw-shared/mafw-proxy-playlist.h>
 
@@ -50,6 +51,35 @@
  */
 #define MAFW_PLAYLIST_MANAGER_INVALID_IMPORT_ID (~0)
 
+/**
+ * MAFW_PLAYLIST_ERROR_SHARED_BASE:
+ *
+ * The first #MAFW_PLAYLIST_ERROR code reserved for errors of the
+ * playlist daemon which libmafw's #MafwPlaylistError doesn't know.
+ * Codes from here on are ours; those below belong to libmafw, which
+ * may well add new ones after %MAFW_PLAYLIST_ERROR_INVALID_IMPORT_ID.
+ */
+#define MAFW_PLAYLIST_ERROR_SHARED_BASE		1000
+
+/**
+ * MAFW_PLAYLIST_ERROR_QUOTA_EXCEEDED:
+ *
+ * #MAFW_PLAYLIST_ERROR code of requests refused by the playlist daemon
+ * because the client would exceed one of its quotas.
+ */
+#define MAFW_PLAYLIST_ERROR_QUOTA_EXCEEDED \
+	(MAFW_PLAYLIST_ERROR_SHARED_BASE + 0)
+
+/**
+ * MAFW_PLAYLIST_ERROR_NOT_SUPPORTED:
+ *
+ * #MAFW_PLAYLIST_ERROR code of requests the playlist daemon can't serve
+ * on this system or connection, like mirroring a playlist in shared
+ * memory.
+ */
+#define MAFW_PLAYLIST_ERROR_NOT_SUPPORTED \
+	(MAFW_PLAYLIST_ERROR_SHARED_BASE + 1)
+
 
 /* Type definitions */
 typedef struct
@@ -81,6 +111,46 @@ typedef struct _MafwPlaylistManagerItem {
 	gchar *name;
 } MafwPlaylistManagerItem;
 
+/**
+ * MafwPlaylistManagerInfo:
+ * @id: playlist id
+ * @name: a dynamically allocated UTF-8 string.
+ * @size: number of items in the playlist
+ * @repeat: repeat mode of the playlist
+ * @shuffled: whether the playlist is shuffled
+ * @use_count: use count of the playlist
+ * @last_modified: time of the last modification in seconds since the Epoch
+ *
+ * mafw_playlist_manager_list_playlists_full() returns a #GArray
+ * of this structures.
+ */
+typedef struct _MafwPlaylistManagerInfo {
+	guint id;
+	gchar *name;
+	guint size;
+	gboolean repeat;
+	gboolean shuffled;
+	guint use_count;
+	guint64 last_modified;
+} MafwPlaylistManagerInfo;
+
+/**
+ * MafwPlaylistManagerQuota:
+ * @playlists: number of playlists
+ * @entries: total number of their items
+ * @bytes: total length of the object ids of the items
+ * @requests: number of requests being processed
+ *
+ * Resources charged to a client by the playlist daemon, or the limits
+ * of them, see mafw_playlist_manager_get_quota().
+ */
+typedef struct _MafwPlaylistManagerQuota {
+	guint playlists;
+	guint entries;
+	guint64 bytes;
+	guint requests;
+} MafwPlaylistManagerQuota;
+
 /* Function prototypes */
 G_BEGIN_DECLS
 
@@ -112,6 +182,22 @@ extern MafwProxyPlaylist *mafw_playlist_manager_create_playlist(
 					   MafwPlaylistManager *self,
 					   gchar const *name,
 					   GError **errp);
+extern void mafw_playlist_manager_create_playlist_async(
+					   MafwPlaylistManager *self,
+					   gchar const *name,
+					   GAsyncReadyCallback callback,
+					   gpointer user_data);
+extern MafwProxyPlaylist *mafw_playlist_manager_create_playlist_finish(
+					   MafwPlaylistManager *self,
+					   GAsyncResult *res,
+					   GError **errp);
+extern MafwProxyPlaylist *mafw_playlist_manager_create_smart_playlist(
+					   MafwPlaylistManager *self,
+					   gchar const *name,
+					   gchar const *container,
+					   gchar const *filter,
+					   gchar const *sort_criteria,
+					   GError **errp);
 extern gboolean mafw_playlist_manager_destroy_playlist(
 					   MafwPlaylistManager *self,
 					   MafwProxyPlaylist *playlist,
@@ -122,6 +208,16 @@ extern MafwProxyPlaylist *mafw_playlist_manager_dup_playlist(
 					   MafwProxyPlaylist *playlist,
 					   gchar const *new_name,
 					   GError **errp);
+extern void mafw_playlist_manager_dup_playlist_async(
+					   MafwPlaylistManager *self,
+					   MafwProxyPlaylist *playlist,
+					   gchar const *new_name,
+					   GAsyncReadyCallback callback,
+					   gpointer user_data);
+extern MafwProxyPlaylist *mafw_playlist_manager_dup_playlist_finish(
+					   MafwPlaylistManager *self,
+					   GAsyncResult *res,
+					   GError **errp);
 
 extern MafwProxyPlaylist *mafw_playlist_manager_get_playlist(
 					   MafwPlaylistManager *self,
@@ -130,17 +226,63 @@ extern MafwProxyPlaylist *mafw_playlist_manager_get_playlist(
 extern GPtrArray *mafw_playlist_manager_get_playlists(
 					   MafwPlaylistManager *self,
 					   GError **errp);
+extern void mafw_playlist_manager_get_playlists_async(
+					   MafwPlaylistManager *self,
+					   GAsyncReadyCallback callback,
+					   gpointer user_data);
+extern GPtrArray *mafw_playlist_manager_get_playlists_finish(
+					   MafwPlaylistManager *self,
+					   GAsyncResult *res,
+					   GError **errp);
 extern GArray *mafw_playlist_manager_list_playlists(
 					   MafwPlaylistManager *self,
 					   GError **errp);
+extern void mafw_playlist_manager_list_playlists_async(
+					   MafwPlaylistManager *self,
+					   GAsyncReadyCallback callback,
+					   gpointer user_data);
+extern GArray *mafw_playlist_manager_list_playlists_finish(
+					   MafwPlaylistManager *self,
+					   GAsyncResult *res,
+					   GError **errp);
 extern void mafw_playlist_manager_free_list_of_playlists(
 					   GArray *playlist_list);
+extern GArray *mafw_playlist_manager_list_playlists_full(
+					   MafwPlaylistManager *self,
+					   const guint *ids,
+					   guint nids,
+					   GError **errp);
+extern void mafw_playlist_manager_free_list_of_playlists_full(
+					   GArray *playlist_list);
+extern gboolean mafw_playlist_manager_copy_range(MafwPlaylistManager *self,
+					   MafwProxyPlaylist *src,
+					   guint from, guint count,
+					   MafwProxyPlaylist *dst, guint at,
+					   GError **errp);
+extern gboolean mafw_playlist_manager_concat(MafwPlaylistManager *self,
+					   MafwProxyPlaylist **srcs,
+					   guint nsrcs,
+					   MafwProxyPlaylist *dst,
+					   GError **errp);
+extern gboolean mafw_playlist_manager_get_quota(MafwPlaylistManager *self,
+					   const gchar *client,
+					   MafwPlaylistManagerQuota *usage,
+					   MafwPlaylistManagerQuota *limits,
+					   GError **errp);
 extern guint mafw_playlist_manager_import(MafwPlaylistManager *self,
 					   const gchar *playlist,
 					   const gchar *base_uri,
 					   MafwPlaylistManagerImportCb cb,
 					   gpointer user_data,
 					   GError **error);
+extern guint mafw_playlist_manager_import_recursive(
+					   MafwPlaylistManager *self,
+					   const gchar *playlist,
+					   const gchar *base_uri,
+					   gboolean recursive,
+					   MafwPlaylistManagerImportCb cb,
+					   gpointer user_data,
+					   GError **error);
 extern gboolean mafw_playlist_manager_cancel_import(MafwPlaylistManager *self,
 					  guint import_id,
 					  GError **error);
@@ -0,0 +1,802 @@
+/*
+ * This file is a part of MAFW
+ *
+ * Copyright (C) 2007, 2008, 2009 Nokia Corporation, all rights reserved.
+ *
+ * Contact: Visa Smolander <visa.smolander@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+
+/*
+ * In-process playlist store.  With $MAFW_PLAYLIST_EMBEDDED set, the
+ * playlist manager of the process keeps the playlists itself, using the
+ * engine (aplaylist.c) and the files of the playlist daemon, instead of
+ * asking the daemon over D-Bus.  This suits products running a single
+ * UI, and no playlist daemon: the playlists are not shared with other
+ * processes.  The playlist directory is locked, so two processes,
+ * the daemon included, cannot use the same one.
+ *
+ * The functions below do what the request handlers of the daemon do,
+ * and emit the signals of the MafwProxyPlaylist:s and the
+ * MafwPlaylistManager right away, instead of when the D-Bus signals
+ * would arrive.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <libmafw/mafw-errors.h>
+
+#include "common/dbus-interface.h"
+#include "mafw-playlist-daemon/mpd-internal.h"
+#include "mafw-playlist-manager.h"
+#include "mafw-playlist-store.h"
+
+#undef  G_LOG_DOMAIN
+#define G_LOG_DOMAIN		"mafw-playlist-store"
+
+/* Like the playlist daemon does. */
+#define GET_NEXT_N_MAX		256
+
+/* See aplaylist.c.  Hidden, so that they don't clash with the daemon's,
+ * which links with this library too. */
+G_GNUC_INTERNAL gboolean initialize;
+
+/* Our playlists, keyed by their ID. */
+static GTree *By_id;
+/* The same playlists, but keyed by their name. */
+static GTree *By_name;
+/* Highest id given out to our playlists. */
+static guint Last_id = 1;
+
+/* Triggered from aplaylist.c after edit operations have settled on $pls. */
+G_GNUC_INTERNAL void save_me(Pls *pls)
+{
+	gchar *fn;
+
+	if (!pls_ensure_dir())
+		return;
+	fn = pls_path(pls->id);
+	if (pls_save(pls, fn))
+		pls->dirty = FALSE;
+	g_free(fn);
+}
+
+/* Tree traversal callback for save_all(). */
+static gboolean save_dirty(gpointer id, Pls *pls, gpointer unused)
+{
+	if (pls->dirty)
+		save_me(pls);
+	return FALSE;
+}
+
+/* Saves the edits which haven't settled yet at exit. */
+static void save_all(void)
+{
+	g_tree_foreach(By_id, (GTraverseFunc)save_dirty, NULL);
+}
+
+static void playlist_loaded(Pls *pls, gpointer unused)
+{
+	if (Last_id <= pls->id)
+		Last_id = pls->id + 1;
+	g_tree_insert(By_id, GUINT_TO_POINTER(pls->id), pls);
+	g_tree_insert(By_name, g_strdup(pls->name), pls);
+}
+
+/**
+ * playlist_store_enabled:
+ *
+ * Tells whether the playlists are kept in-process, and loads them
+ * the first time it says yes.  If another process, like the playlist
+ * daemon, uses the playlist directory, it complains and says no, so the
+ * playlists are reached on D-Bus instead.
+ */
+gboolean playlist_store_enabled(void)
+{
+	static gint enabled = -1;
+	const gchar *env;
+
+	if (enabled >= 0)
+		return enabled;
+	env = g_getenv("MAFW_PLAYLIST_EMBEDDED");
+	enabled = env && *env && strcmp(env, "0");
+	if (!enabled)
+		return FALSE;
+	if (!pls_lock_dir()) {
+		g_critical("cannot keep playlists in-process in %s, "
+			   "using the playlist daemon", pls_dir());
+		enabled = FALSE;
+		return FALSE;
+	}
+
+	By_id = g_tree_new_full((GCompareDataFunc)pls_cmpids,
+				    NULL, NULL,
+				    (GDestroyNotify)pls_free);
+	By_name = g_tree_new_full((GCompareDataFunc)strcmp, NULL,
+					    (GDestroyNotify)g_free, NULL);
+	pls_load_dir(playlist_loaded, NULL);
+	atexit(save_all);
+	return TRUE;
+}
+
+/* Returns the playlist $id, or NULL and sets $errp if it doesn't
+ * exist. */
+static Pls *lookup(guint id, GError **errp)
+{
+	Pls *pls;
+
+	pls = g_tree_lookup(By_id, GUINT_TO_POINTER(id));
+	if (!pls)
+		g_set_error(errp, MAFW_PLAYLIST_ERROR,
+			    MAFW_PLAYLIST_ERROR_PLAYLIST_NOT_FOUND,
+			    "No such playlist");
+	return pls;
+}
+
+static Pls *lookup_self(MafwProxyPlaylist *self, GError **errp)
+{
+	return lookup(mafw_proxy_playlist_get_id(self), errp);
+}
+
+static gboolean invalid_index(GError **errp)
+{
+	g_set_error(errp, MAFW_PLAYLIST_ERROR,
+		    MAFW_PLAYLIST_ERROR_INVALID_INDEX, "Wrong index");
+	return FALSE;
+}
+
+static void contents_changed(MafwProxyPlaylist *self, guint from,
+			     guint nremove, guint nreplace)
+{
+	g_signal_emit_by_name(self, "contents-changed",
+			      from, nremove, nreplace);
+}
+
+/* Playlist manager operations */
+
+/**
+ * playlist_store_create:
+ * @name:    name of the playlist
+ * @created: set to %TRUE if the playlist didn't exist
+ * @errp:    a #GError to store an error if needed
+ *
+ * Returns the id of the playlist called @name, creating it if needed,
+ * or %MAFW_PROXY_PLAYLIST_INVALID_ID on error.
+ */
+guint playlist_store_create(const gchar *name, gboolean *created,
+			    GError **errp)
+{
+	Pls *pls;
+
+	*created = FALSE;
+	if (!name || !*name) {
+		g_set_error(errp, MAFW_PLAYLIST_ERROR,
+			    MAFW_PLAYLIST_ERROR_INVALID_NAME,
+			    "name cannot be empty");
+		return MAFW_PROXY_PLAYLIST_INVALID_ID;
+	}
+	if (!(pls = g_tree_lookup(By_name, name))) {
+		pls = pls_new(Last_id++, name);
+		g_tree_insert(By_id, GUINT_TO_POINTER(pls->id), pls);
+		g_tree_insert(By_name, g_strdup(pls->name), pls);
+		*created = TRUE;
+	}
+	return pls->id;
+}
+
+/**
+ * playlist_store_destroy:
+ * @id:     a playlist id
+ * @in_use: set to %TRUE if the playlist can't be destroyed because
+ *          its use count is not 0
+ *
+ * Destroys playlist @id and deletes its file.
+ *
+ * Returns: %TRUE if it was destroyed.
+ */
+gboolean playlist_store_destroy(guint id, gboolean *in_use)
+{
+	Pls *pls;
+	gchar *fn;
+
+	*in_use = FALSE;
+	if (!(pls = g_tree_lookup(By_id, GUINT_TO_POINTER(id))))
+		return FALSE;
+	if (pls->use_count != 0) {
+		*in_use = TRUE;
+		return FALSE;
+	}
+
+	/* It's not an error if it hasn't been saved yet. */
+	fn = pls_path(pls->id);
+	if (g_unlink(fn) == -1 && errno != ENOENT)
+		g_warning("error while deleting '%s': %s",
+			  fn, g_strerror(errno));
+	g_free(fn);
+	g_tree_remove(By_name, pls->name);
+	g_tree_remove(By_id, GUINT_TO_POINTER(id));
+	return TRUE;
+}
+
+/**
+ * playlist_store_exists:
+ * @id: a playlist id
+ *
+ * Tells whether playlist @id exists.
+ */
+gboolean playlist_store_exists(guint id)
+{
+	return g_tree_lookup(By_id, GUINT_TO_POINTER(id)) != NULL;
+}
+
+static gboolean append_item(gpointer id, Pls *pls, GArray *items)
+{
+	MafwPlaylistManagerItem item;
+
+	item.id = pls->id;
+	item.name = g_strdup(pls->name);
+	g_array_append_val(items, item);
+	return FALSE;
+}
+
+/**
+ * playlist_store_list:
+ *
+ * Returns a zero-terminated #GArray of #MafwPlaylistManagerItem:s of
+ * all playlists, like mafw_playlist_manager_list_playlists().
+ */
+GArray *playlist_store_list(void)
+{
+	GArray *items;
+
+	items = g_array_new(TRUE, FALSE, sizeof(MafwPlaylistManagerItem));
+	g_tree_foreach(By_id, (GTraverseFunc)append_item, items);
+	return items;
+}
+
+static gboolean append_info(gpointer id, Pls *pls, GArray *infos)
+{
+	MafwPlaylistManagerInfo info;
+
+	info.id = pls->id;
+	info.name = g_strdup(pls->name);
+	info.size = pls->len;
+	info.repeat = pls->repeat;
+	info.shuffled = pls->shuffled;
+	info.use_count = pls->use_count;
+	info.last_modified = pls->mtime;
+	g_array_append_val(infos, info);
+	return FALSE;
+}
+
+/**
+ * playlist_store_list_full:
+ * @ids:  the playlists to list, or %NULL for all
+ * @nids: the number of @ids
+ *
+ * Returns a zero-terminated #GArray of #MafwPlaylistManagerInfo:s,
+ * like mafw_playlist_manager_list_playlists_full().
+ */
+GArray *playlist_store_list_full(const guint *ids, guint nids)
+{
+	GArray *infos;
+	guint i;
+
+	infos = g_array_new(TRUE, FALSE, sizeof(MafwPlaylistManagerInfo));
+	if (!ids) {
+		g_tree_foreach(By_id, (GTraverseFunc)append_info, infos);
+		return infos;
+	}
+	for (i = 0; i < nids; i++) {
+		Pls *pls;
+
+		if ((pls = g_tree_lookup(By_id,
+					 GUINT_TO_POINTER(ids[i]))))
+			append_info(NULL, pls, infos);
+	}
+	return infos;
+}
+
+/**
+ * playlist_store_dup:
+ * @id:       the playlist to copy
+ * @new_name: name of the copy, which must not exist yet
+ * @errp:     a #GError to store an error if needed
+ *
+ * Returns the id of the copy or %MAFW_PROXY_PLAYLIST_INVALID_ID on
+ * error.
+ */
+guint playlist_store_dup(guint id, const gchar *new_name,
+			 GError **errp)
+{
+	Pls *pls, *new_pls;
+
+	if (!new_name || !*new_name) {
+		g_set_error(errp, MAFW_PLAYLIST_ERROR,
+			    MAFW_PLAYLIST_ERROR_INVALID_NAME,
+			    "name cannot be empty");
+		return MAFW_PROXY_PLAYLIST_INVALID_ID;
+	}
+	if (g_tree_lookup(By_name, new_name)) {
+		g_set_error(errp, MAFW_PLAYLIST_ERROR,
+			    MAFW_PLAYLIST_ERROR_INVALID_NAME,
+			    "Playlist already exists");
+		return MAFW_PROXY_PLAYLIST_INVALID_ID;
+	}
+	if (!(pls = g_tree_lookup(By_id, GUINT_TO_POINTER(id)))) {
+		g_set_error(errp, MAFW_PLAYLIST_ERROR,
+			    MAFW_PLAYLIST_ERROR_INVALID_NAME,
+			    "playlist does not exist");
+		return MAFW_PROXY_PLAYLIST_INVALID_ID;
+	}
+
+	new_pls = pls_new(Last_id++, new_name);
+	pls_copy_range(new_pls, 0, pls, 0, pls->len);
+	pls_set_repeat(new_pls, pls->repeat);
+	/* Unlike the daemon, we shuffle the copy anew. */
+	if (pls->shuffled)
+		pls_shuffle(new_pls);
+	g_tree_insert(By_id, GUINT_TO_POINTER(new_pls->id), new_pls);
+	g_tree_insert(By_name, g_strdup(new_pls->name), new_pls);
+	return new_pls->id;
+}
+
+/**
+ * playlist_store_copy_range:
+ * @src:   id of the source playlist
+ * @from:  index of the first item to copy
+ * @count: number of items to copy
+ * @dst:   the destination playlist
+ * @at:    where to insert the items in @dst
+ * @errp:  a #GError to store an error if needed
+ *
+ * Copies items between playlists, like
+ * mafw_playlist_manager_copy_range().
+ */
+gboolean playlist_store_copy_range(guint src, guint from, guint count,
+				   MafwProxyPlaylist *dst, guint at,
+				   GError **errp)
+{
+	Pls *spls, *dpls;
+
+	if (!(spls = lookup(src, errp)) || !(dpls = lookup_self(dst, errp)))
+		return FALSE;
+	if (!pls_copy_range(dpls, at, spls, from, count))
+		return invalid_index(errp);
+	contents_changed(dst, at, 0, count);
+	return TRUE;
+}
+
+/**
+ * playlist_store_concat:
+ * @srcs:  ids of the source playlists
+ * @nsrcs: number of @srcs
+ * @dst:   the destination playlist
+ * @errp:  a #GError to store an error if needed
+ *
+ * Appends the items of @srcs to @dst, like
+ * mafw_playlist_manager_concat().
+ */
+gboolean playlist_store_concat(const guint *srcs, guint nsrcs,
+			       MafwProxyPlaylist *dst, GError **errp)
+{
+	Pls *dpls, **spls;
+	guint i, oldlen, total;
+
+	if (!(dpls = lookup_self(dst, errp)))
+		return FALSE;
+	/* Check all of them first, so that nothing is copied on error.
+	 * $dst may be among the sources, so take its length up front. */
+	spls = g_new(Pls *, nsrcs);
+	oldlen = dpls->len;
+	total = 0;
+	for (i = 0; i < nsrcs; i++) {
+		if (!(spls[i] = lookup(srcs[i], errp))) {
+			g_free(spls);
+			return FALSE;
+		}
+		total += spls[i] == dpls ? oldlen : spls[i]->len;
+	}
+	for (i = 0; i < nsrcs; i++)
+		pls_copy_range(dpls, dpls->len, spls[i], 0,
+			       spls[i] == dpls ? oldlen : spls[i]->len);
+	g_free(spls);
+	if (total)
+		contents_changed(dst, oldlen, 0, total);
+	return TRUE;
+}
+
+/* Playlist operations */
+
+/**
+ * playlist_store_set_name:
+ * @self: a #MafwProxyPlaylist
+ * @name: the new name
+ *
+ * Renames the playlist.  Returns %FALSE if @name is invalid.
+ */
+gboolean playlist_store_set_name(MafwProxyPlaylist *self,
+				 const gchar *name)
+{
+	Pls *pls;
+	gchar *oldname;
+
+	if (!(pls = lookup_self(self, NULL)))
+		return FALSE;
+	if (g_tree_lookup(By_name, name))
+		return FALSE;
+
+	oldname = g_strdup(pls->name);
+	if (pls_set_name(pls, name)) {
+		g_tree_remove(By_name, oldname);
+		g_tree_insert(By_name, g_strdup(pls->name), pls);
+		g_free(oldname);
+		g_object_notify(G_OBJECT(self), "name");
+		return TRUE;
+	}
+	g_free(oldname);
+	return FALSE;
+}
+
+gchar *playlist_store_get_name(MafwProxyPlaylist *self, GError **errp)
+{
+	Pls *pls;
+
+	return (pls = lookup_self(self, errp)) ? g_strdup(pls->name) : NULL;
+}
+
+gboolean playlist_store_set_repeat(MafwProxyPlaylist *self,
+				   gboolean repeat, GError **errp)
+{
+	Pls *pls;
+
+	if (!(pls = lookup_self(self, errp)))
+		return FALSE;
+	pls_set_repeat(pls, repeat);
+	g_object_notify(G_OBJECT(self), "repeat");
+	return TRUE;
+}
+
+gboolean playlist_store_get_repeat(MafwProxyPlaylist *self,
+				   GError **errp)
+{
+	Pls *pls;
+
+	return (pls = lookup_self(self, errp)) ? pls->repeat : FALSE;
+}
+
+/**
+ * playlist_store_shuffle:
+ * @self:    a #MafwProxyPlaylist
+ * @shuffle: whether to shuffle or unshuffle the playlist
+ * @errp:    a #GError to store an error if needed
+ *
+ * Shuffles or unshuffles the playlist.
+ */
+gboolean playlist_store_shuffle(MafwProxyPlaylist *self,
+				gboolean shuffle, GError **errp)
+{
+	Pls *pls;
+
+	if (!(pls = lookup_self(self, errp)))
+		return FALSE;
+	if (shuffle)
+		pls_shuffle(pls);
+	else
+		pls_unshuffle(pls);
+	g_object_notify(G_OBJECT(self), "is-shuffled");
+	return TRUE;
+}
+
+gboolean playlist_store_is_shuffled(MafwProxyPlaylist *self,
+				    GError **errp)
+{
+	Pls *pls;
+
+	return (pls = lookup_self(self, errp)) ? pls_is_shuffled(pls) : FALSE;
+}
+
+/**
+ * playlist_store_use_count:
+ * @self:  a #MafwProxyPlaylist
+ * @delta: +1 or -1
+ * @errp:  a #GError to store an error if needed
+ *
+ * Changes the use count of the playlist.
+ */
+gboolean playlist_store_use_count(MafwProxyPlaylist *self, gint delta,
+				  GError **errp)
+{
+	Pls *pls;
+
+	if (!(pls = lookup_self(self, errp)))
+		return FALSE;
+	pls_set_use_count(pls, pls->use_count + delta);
+	return TRUE;
+}
+
+gboolean playlist_store_insert(MafwProxyPlaylist *self, guint idx,
+			       const gchar **oids, GError **errp)
+{
+	Pls *pls;
+	guint len;
+
+	if (!(pls = lookup_self(self, errp)))
+		return FALSE;
+	len = g_strv_length((gchar **)oids);
+	if (!pls_inserts(pls, idx, oids, len))
+		return invalid_index(errp);
+	contents_changed(self, idx, 0, len);
+	return TRUE;
+}
+
+gboolean playlist_store_append(MafwProxyPlaylist *self,
+			       const gchar **oids, GError **errp)
+{
+	Pls *pls;
+
+	if (!(pls = lookup_self(self, errp)))
+		return FALSE;
+	return playlist_store_insert(self, pls->len, oids, errp);
+}
+
+gboolean playlist_store_remove(MafwProxyPlaylist *self, guint idx,
+			       GError **errp)
+{
+	Pls *pls;
+
+	if (!(pls = lookup_self(self, errp)))
+		return FALSE;
+	if (!pls_remove(pls, idx))
+		return invalid_index(errp);
+	contents_changed(self, idx, 1, 0);
+	return TRUE;
+}
+
+/**
+ * playlist_store_move:
+ * @self: a #MafwProxyPlaylist
+ * @from: index of the item to move
+ * @to:   its new index
+ * @errp: a #GError to store an error if needed
+ *
+ * Moves an item.  Returns %FALSE without setting @errp if an index is
+ * out of range, like the daemon does.
+ */
+gboolean playlist_store_move(MafwProxyPlaylist *self, guint from,
+			     guint to, GError **errp)
+{
+	Pls *pls;
+
+	if (!(pls = lookup_self(self, errp)) || !pls_move(pls, from, to))
+		return FALSE;
+	g_signal_emit_by_name(self, "item-moved", from, to);
+	return TRUE;
+}
+
+gboolean playlist_store_clear(MafwProxyPlaylist *self, GError **errp)
+{
+	Pls *pls;
+	guint oldlen;
+
+	if (!(pls = lookup_self(self, errp)))
+		return FALSE;
+	oldlen = pls->len;
+	pls_clear(pls);
+	contents_changed(self, 0, oldlen, 0);
+	return TRUE;
+}
+
+/**
+ * playlist_store_apply_ops:
+ * @self:    a #MafwProxyPlaylist
+ * @ops:     the operations to apply
+ * @nops:    the number of @ops
+ * @results: where to store the validity of each operation
+ * @errp:    a #GError to store an error if needed
+ *
+ * Applies @ops as a transaction, see mafw_proxy_playlist_apply_batch().
+ *
+ * Returns: %FALSE if the playlist doesn't exist; whether @ops were
+ * applied is told by @results.
+ */
+gboolean playlist_store_apply_ops(MafwProxyPlaylist *self,
+				  const MafwPlaylistStoreOp *ops,
+				  guint nops, gboolean *results,
+				  GError **errp)
+{
+	Pls *pls;
+	PlsOp *plsops;
+	gboolean applied, repeat_changed, shuffle_changed;
+	guint i, oldlen, first;
+
+	if (!(pls = lookup_self(self, errp)))
+		return FALSE;
+
+	plsops = g_new(PlsOp, nops);
+	repeat_changed = shuffle_changed = FALSE;
+	for (i = 0; i < nops; i++) {
+		plsops[i].type = ops[i].type;
+		plsops[i].idx = ops[i].idx;
+		plsops[i].arg = ops[i].arg;
+		plsops[i].oids = ops[i].oids;
+		plsops[i].noids = ops[i].oids
+			? g_strv_length(ops[i].oids) : 0;
+		if (ops[i].type == MAFW_PLAYLIST_OP_SET_REPEAT)
+			repeat_changed = TRUE;
+		else if (ops[i].type == MAFW_PLAYLIST_OP_SHUFFLE
+			 || ops[i].type == MAFW_PLAYLIST_OP_UNSHUFFLE)
+			shuffle_changed = TRUE;
+	}
+	oldlen = pls->len;
+	applied = pls_apply_ops(pls, plsops, nops, results, &first);
+	g_free(plsops);
+	if (!applied)
+		return TRUE;
+
+	if (first != G_MAXUINT)
+		contents_changed(self, first,
+				 oldlen - first, pls->len - first);
+	if (repeat_changed)
+		g_object_notify(G_OBJECT(self), "repeat");
+	if (shuffle_changed)
+		g_object_notify(G_OBJECT(self), "is-shuffled");
+	return TRUE;
+}
+
+/**
+ * playlist_store_get_item:
+ * @self: a #MafwProxyPlaylist
+ * @idx:  visual index of the item
+ * @errp: a #GError to store an error if needed
+ *
+ * Returns the object id of the item, or %NULL if @idx is out of range.
+ */
+gchar *playlist_store_get_item(MafwProxyPlaylist *self, guint idx,
+			       GError **errp)
+{
+	Pls *pls;
+
+	return (pls = lookup_self(self, errp)) ? pls_get_item(pls, idx) : NULL;
+}
+
+/**
+ * playlist_store_get_items:
+ * @self:  a #MafwProxyPlaylist
+ * @first: visual index of the first item
+ * @last:  visual index of the last item
+ * @errp:  a #GError to store an error if needed
+ *
+ * Returns the object ids of the items, like mafw_playlist_get_items().
+ */
+gchar **playlist_store_get_items(MafwProxyPlaylist *self, guint first,
+				 guint last, GError **errp)
+{
+	Pls *pls;
+	gchar **oids;
+	guint i;
+
+	if (!(pls = lookup_self(self, errp)))
+		return NULL;
+	if (!(oids = pls_get_items(pls, first, last))) {
+		invalid_index(errp);
+		return NULL;
+	}
+	/* The strings are owned by $pls, unless it's paged out. */
+	for (i = 0; !pls->pages && oids[i]; i++)
+		oids[i] = g_strdup(oids[i]);
+	return oids;
+}
+
+guint playlist_store_get_size(MafwProxyPlaylist *self, GError **errp)
+{
+	Pls *pls;
+
+	return (pls = lookup_self(self, errp)) ? pls->len : 0;
+}
+
+/**
+ * playlist_store_navigate:
+ * @self:   a #MafwProxyPlaylist
+ * @method: one of the MAFW_PLAYLIST_METHOD_GET_{STARTING,LAST}_INDEX
+ *          and MAFW_PLAYLIST_METHOD_GET_{NEXT,PREV}
+ * @index:  the index to start from, and where to store the result,
+ *          or %NULL
+ * @oid:    where to store the object id found, or %NULL
+ * @errp:   a #GError to store an error if needed
+ *
+ * Moves in playing order.
+ *
+ * Returns: %FALSE if there's no such item.
+ */
+gboolean playlist_store_navigate(MafwProxyPlaylist *self,
+				 const gchar *method, guint *index,
+				 gchar **oid, GError **errp)
+{
+	Pls *pls;
+	gchar *found;
+	guint idx;
+
+	if (!(pls = lookup_self(self, errp)))
+		return FALSE;
+
+	found = NULL;
+	idx = index ? *index : 0;
+	if (!strcmp(method, MAFW_PLAYLIST_METHOD_GET_STARTING_INDEX))
+		pls_get_starting(pls, &idx, &found);
+	else if (!strcmp(method, MAFW_PLAYLIST_METHOD_GET_LAST_INDEX))
+		pls_get_last(pls, &idx, &found);
+	else if (!strcmp(method, MAFW_PLAYLIST_METHOD_GET_NEXT))
+		pls_get_next(pls, &idx, &found);
+	else if (!strcmp(method, MAFW_PLAYLIST_METHOD_GET_PREV))
+		pls_get_prev(pls, &idx, &found);
+	else
+		g_assert_not_reached();
+
+	if (!found)
+		return FALSE;
+	if (index)
+		*index = idx;
+	if (oid)
+		*oid = found;
+	else
+		g_free(found);
+	return TRUE;
+}
+
+/**
+ * playlist_store_get_next_n:
+ * @self:    a #MafwProxyPlaylist
+ * @index:   visual index of the current item
+ * @n:       the number of items wanted
+ * @indices: where to store the visual indices of the items
+ * @errp:    a #GError to store an error if needed
+ *
+ * Returns the items following @index in playing order, like
+ * mafw_proxy_playlist_get_next_n().
+ */
+gchar **playlist_store_get_next_n(MafwProxyPlaylist *self, guint index,
+				  guint n, guint **indices,
+				  GError **errp)
+{
+	Pls *pls;
+	gchar **oids;
+	guint *idxs;
+
+	if (!(pls = lookup_self(self, errp)))
+		return NULL;
+	if (n > GET_NEXT_N_MAX)
+		n = GET_NEXT_N_MAX;
+	idxs = g_new(guint, n);
+	oids = g_new(gchar *, n + 1);
+	pls_get_next_n(pls, index, n, idxs, oids);
+	if (indices)
+		*indices = idxs;
+	else
+		g_free(idxs);
+	return oids;
+}
+
+/* vi: set noexpandtab ts=8 sw=8 cino=t0,(0: */
@@ -0,0 +1,103 @@
+/*
+ * This file is a part of MAFW
+ *
+ * Copyright (C) 2007, 2008, 2009 Nokia Corporation, all rights reserved.
+ *
+ * Contact: Visa Smolander <visa.smolander@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+
+#ifndef MAFW_PLAYLIST_STORE_H
+#define MAFW_PLAYLIST_STORE_H
+
+/* Library-internal, in-process playlist store, which MafwPlaylistManager
+ * and MafwProxyPlaylist use instead of the playlist daemon when
+ * $MAFW_PLAYLIST_EMBEDDED is set.  Not installed. */
+
+#include <glib.h>
+#include "mafw-proxy-playlist.h"
+
+/* An operation of playlist_store_apply_ops(), see PlsOp. */
+typedef struct {
+	guint type;
+	guint idx;
+	guint arg;
+	gchar **oids;
+} MafwPlaylistStoreOp;
+
+gboolean playlist_store_enabled(void);
+
+/* Playlist manager operations */
+guint playlist_store_create(const gchar *name, gboolean *created,
+			    GError **errp);
+gboolean playlist_store_destroy(guint id, gboolean *in_use);
+gboolean playlist_store_exists(guint id);
+GArray *playlist_store_list(void);
+GArray *playlist_store_list_full(const guint *ids, guint nids);
+guint playlist_store_dup(guint id, const gchar *new_name,
+			 GError **errp);
+gboolean playlist_store_copy_range(guint src, guint from, guint count,
+				   MafwProxyPlaylist *dst, guint at,
+				   GError **errp);
+gboolean playlist_store_concat(const guint *srcs, guint nsrcs,
+			       MafwProxyPlaylist *dst, GError **errp);
+
+/* Playlist operations */
+gboolean playlist_store_set_name(MafwProxyPlaylist *self,
+				 const gchar *name);
+gchar *playlist_store_get_name(MafwProxyPlaylist *self,
+			       GError **errp);
+gboolean playlist_store_set_repeat(MafwProxyPlaylist *self,
+				   gboolean repeat, GError **errp);
+gboolean playlist_store_get_repeat(MafwProxyPlaylist *self,
+				   GError **errp);
+gboolean playlist_store_shuffle(MafwProxyPlaylist *self,
+				gboolean shuffle, GError **errp);
+gboolean playlist_store_is_shuffled(MafwProxyPlaylist *self,
+				    GError **errp);
+gboolean playlist_store_use_count(MafwProxyPlaylist *self, gint delta,
+				  GError **errp);
+gboolean playlist_store_insert(MafwProxyPlaylist *self, guint idx,
+			       const gchar **oids, GError **errp);
+gboolean playlist_store_append(MafwProxyPlaylist *self,
+			       const gchar **oids, GError **errp);
+gboolean playlist_store_remove(MafwProxyPlaylist *self, guint idx,
+			       GError **errp);
+gboolean playlist_store_move(MafwProxyPlaylist *self, guint from,
+			     guint to, GError **errp);
+gboolean playlist_store_clear(MafwProxyPlaylist *self, GError **errp);
+gboolean playlist_store_apply_ops(MafwProxyPlaylist *self,
+				  const MafwPlaylistStoreOp *ops,
+				  guint nops, gboolean *results,
+				  GError **errp);
+gchar *playlist_store_get_item(MafwProxyPlaylist *self, guint idx,
+			       GError **errp);
+gchar **playlist_store_get_items(MafwProxyPlaylist *self, guint first,
+				 guint last, GError **errp);
+guint playlist_store_get_size(MafwProxyPlaylist *self, GError **errp);
+gboolean playlist_store_navigate(MafwProxyPlaylist *self,
+				 const gchar *method, guint *index,
+				 gchar **oid, GError **errp);
+gchar **playlist_store_get_next_n(MafwProxyPlaylist *self, guint index,
+				  guint n, guint **indices,
+				  GError **errp);
+
+#endif
+
+/* vi: set noexpandtab ts=8 sw=8 cino=t0,(0: */
@@ -0,0 +1,49 @@
+/*
+ * This file is a part of MAFW
+ *
+ * Copyright (C) 2007, 2008, 2009 Nokia Corporation, all rights reserved.
+ *
+ * Contact: Visa Smolander <visa.smolander@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#ifndef MAFW_PROXY_PLAYLIST_INTERNAL_H
+#define MAFW_PROXY_PLAYLIST_INTERNAL_H
+
+/* Library-internal interface of MafwProxyPlaylist, used by the
+ * MafwPlaylistManager.  Not installed. */
+
+#include "mafw-proxy-playlist.h"
+
+void proxy_playlist_prime_cache(MafwProxyPlaylist *self, guint size,
+				gboolean repeat, gboolean shuffled);
+void proxy_playlist_invalidate_cache(MafwProxyPlaylist *self);
+GObject *proxy_playlist_new_embedded(guint id);
+
+/* Stores the result of a successful @reply in @res, see
+ * proxy_playlist_call_async(). */
+typedef void (*MafwProxyPlaylistParseFunc)(GSimpleAsyncResult *res,
+					   DBusMessage *reply);
+
+void proxy_playlist_call_async(DBusConnection *conn, DBusMessage *msg,
+			       GSimpleAsyncResult *res,
+			       MafwProxyPlaylistParseFunc parse);
+
+#endif
+
+/* vi: set noexpandtab ts=8 sw=8 cino=t0,(0: */
@@ -34,11 +34,15 @@
 
 #include <libmafw/mafw-playlist.h>
 #include <libmafw/mafw-db.h>
+#include <libmafw/mafw-metadata-serializer.h>
 #include "mafw-proxy-playlist.h"
+#include "mafw-proxy-playlist-internal.h"
 #include "mafw-playlist-manager.h"
 #include "mafw-marshal.h"
 #include "common/dbus-interface.h"
 #include "common/mafw-dbus.h"
+#include "common/mafw-mirror.h"
+#include "mafw-playlist-store.h"
 
 #define MAFW_DBUS_DESTINATION	MAFW_PLAYLIST_SERVICE
 #define MAFW_DBUS_INTERFACE	MAFW_PLAYLIST_INTERFACE
@@ -47,8 +51,38 @@ struct _MafwProxyPlaylistPrivate {
 	guint id;
 	DBusConnection *connection;
 	gchar *obj_path;
+	/* Property cache, primed by the playlist manager and invalidated
+	 * by our own edits and the change signals of the daemon. */
+	guint size;
+	gboolean repeat;
+	gboolean shuffled;
+	gboolean size_valid;
+	gboolean repeat_valid;
+	gboolean shuffled_valid;
+	/* Shared memory mirror of the items, see get_mirror().  Until
+	 * it moves past @mirror_stale_gen it may not show our own edits
+	 * yet, which the daemon acknowledges before updating the mirror. */
+	MafwMirror *mirror;
+	gboolean mirror_unsupported;
+	gboolean mirror_behind;
+	guint mirror_stale_gen;
+	/* Asynchronous calls in flight, see async_call(), and how many of
+	 * them edit the items.  @edits_applied tells whether any of those
+	 * succeeded since the last time none was in flight. */
+	guint pending_calls;
+	guint pending_edits;
+	gboolean edits_applied;
+	/* Backed by the in-process store, see mafw-playlist-store.c;
+	 * @connection is NULL then. */
+	gboolean embedded;
 };
 
+/* Signal ids of the window subscription. */
+static guint Signal_window_changed;
+static guint Signal_window_shifted;
+/* Signal id of MafwProxyPlaylist::metadata-cached. */
+static guint Signal_metadata_cached;
+
 #define MAFW_PROXY_PLAYLIST_GET_PRIVATE(o)			\
 	(G_TYPE_INSTANCE_GET_PRIVATE ((o),			\
 				      MAFW_TYPE_PROXY_PLAYLIST,	\
@@ -232,11 +266,14 @@ static void mafw_proxy_playlist_finalize(GObject *object)
 
 	priv = MAFW_PROXY_PLAYLIST_GET_PRIVATE(playlist);
 
-	dbus_connection_unregister_object_path(priv->connection,
-                                               priv->obj_path);
-
-	dbus_connection_unref(priv->connection);
+	if (priv->connection) {
+		dbus_connection_unregister_object_path(priv->connection,
+						       priv->obj_path);
+		dbus_connection_unref(priv->connection);
+	}
 	g_free(priv->obj_path);
+	if (priv->mirror)
+		mafw_mirror_free(priv->mirror);
 }
 
 static void mafw_proxy_playlist_class_init(
@@ -254,6 +291,58 @@ static void mafw_proxy_playlist_class_init(
 	g_object_class_override_property(oclass,
 					 PROP_IS_SHUFFLED, "is-shuffled");
 	oclass -> finalize = mafw_proxy_playlist_finalize;
+
+/**
+ * MafwProxyPlaylist::window-changed:
+ * @first: visual index of the first item changed
+ * @count: number of window positions changed
+ * @oids:  %NULL-terminated array of the new object ids of them, shorter
+ *         than @count if the playlist ends earlier
+ *
+ * Emitted when items of the window set by mafw_proxy_playlist_set_window()
+ * have changed.
+ */
+	Signal_window_changed = g_signal_new(
+		"window-changed", G_TYPE_FROM_CLASS(klass),
+		G_SIGNAL_RUN_FIRST,
+		0, NULL, NULL,
+		mafw_marshal_VOID__UINT_UINT_BOXED,
+		G_TYPE_NONE, 3, G_TYPE_UINT, G_TYPE_UINT, G_TYPE_STRV);
+
+/**
+ * MafwProxyPlaylist::window-shifted:
+ * @first: the new visual index of the first item of the window
+ *
+ * Emitted when items were inserted or removed above the window set by
+ * mafw_proxy_playlist_set_window().  The window keeps showing the same
+ * items, which now start at @first.
+ */
+	Signal_window_shifted = g_signal_new(
+		"window-shifted", G_TYPE_FROM_CLASS(klass),
+		G_SIGNAL_RUN_FIRST,
+		0, NULL, NULL,
+		g_cclosure_marshal_VOID__UINT,
+		G_TYPE_NONE, 1, G_TYPE_UINT);
+
+/**
+ * MafwProxyPlaylist::metadata-cached:
+ * @first:    visual index of the first item concerned
+ * @last:     visual index of the last item concerned
+ * @duration: the new total duration of the playlist, in seconds
+ * @unknown:  number of items whose duration is still unknown
+ *
+ * Emitted when the playlist daemon has fetched the metadata of items
+ * between @first and @last, which can now be had with
+ * mafw_proxy_playlist_get_items_with_metadata().  It's only emitted for
+ * playlists whose items have been asked with metadata.
+ */
+	Signal_metadata_cached = g_signal_new(
+		"metadata-cached", G_TYPE_FROM_CLASS(klass),
+		G_SIGNAL_RUN_FIRST,
+		0, NULL, NULL,
+		mafw_marshal_VOID__UINT_UINT_UINT64_UINT,
+		G_TYPE_NONE, 4, G_TYPE_UINT, G_TYPE_UINT, G_TYPE_UINT64,
+		G_TYPE_UINT);
 }
 
 static void mafw_proxy_playlist_init(MafwProxyPlaylist *self)
@@ -323,6 +412,30 @@ GObject *mafw_proxy_playlist_new(guint id)
 	return G_OBJECT(self);
 }
 
+/* Returns a new playlist object for playlist @id of the in-process store.
+ * See mafw-playlist-store.c. */
+GObject *proxy_playlist_new_embedded(guint id)
+{
+	MafwProxyPlaylist *self;
+
+	self = g_object_new(MAFW_TYPE_PROXY_PLAYLIST, NULL);
+	self->priv->id = id;
+	self->priv->embedded = TRUE;
+	return G_OBJECT(self);
+}
+
+/* Returns TRUE and sets @error if @self is embedded, for the operations
+ * only the playlist daemon implements. */
+static gboolean daemon_only(MafwProxyPlaylist *self, GError **error)
+{
+	if (!self->priv->embedded)
+		return FALSE;
+	g_set_error(error, MAFW_PLAYLIST_ERROR,
+		    MAFW_PLAYLIST_ERROR_NOT_SUPPORTED,
+		    "Not supported by the in-process playlist store");
+	return TRUE;
+}
+
 /*---------------------------------------------------------------------------
   Get ID
   ---------------------------------------------------------------------------*/
@@ -339,6 +452,146 @@ guint mafw_proxy_playlist_get_id(MafwProxyPlaylist *self)
 	return self->priv->id;
 }
 
+/*---------------------------------------------------------------------------
+  Property cache
+  ---------------------------------------------------------------------------*/
+
+/* Fills the property cache of @self with values obtained from the daemon in
+ * some other way, so that the corresponding getters return without D-Bus
+ * traffic until they are invalidated. */
+void proxy_playlist_prime_cache(MafwProxyPlaylist *self, guint size,
+				gboolean repeat, gboolean shuffled)
+{
+	/* The values may predate our calls still in flight. */
+	if (self->priv->pending_calls)
+		return;
+	self->priv->size = size;
+	self->priv->repeat = repeat;
+	self->priv->shuffled = shuffled;
+	self->priv->size_valid = TRUE;
+	self->priv->repeat_valid = TRUE;
+	self->priv->shuffled_valid = TRUE;
+}
+
+/* Returns whether the cached properties of $priv can be trusted.  The
+ * signals invalidating them may have been received already, eg. while
+ * we were blocked in a call, and sit in the queue of the connection
+ * until the main loop dispatches them. */
+static gboolean cache_fresh(MafwProxyPlaylistPrivate *priv)
+{
+	return dbus_connection_get_dispatch_status(priv->connection)
+		== DBUS_DISPATCH_COMPLETE;
+}
+
+/* Forgets all cached properties of @self. */
+void proxy_playlist_invalidate_cache(MafwProxyPlaylist *self)
+{
+	self->priv->size_valid = FALSE;
+	self->priv->repeat_valid = FALSE;
+	self->priv->shuffled_valid = FALSE;
+}
+
+/*---------------------------------------------------------------------------
+  Mirror
+  ---------------------------------------------------------------------------*/
+
+/* Returns the mirror of the playlist, asking the daemon for it if we don't
+ * have one, or NULL if the items must be queried on D-Bus. */
+static MafwMirror *get_mirror(MafwProxyPlaylistPrivate *priv)
+{
+#ifdef DBUS_TYPE_UNIX_FD
+	DBusMessage *reply;
+	dbus_uint32_t size;
+	gint fd;
+
+	if (priv->mirror && mafw_mirror_is_stale(priv->mirror)) {
+		mafw_mirror_free(priv->mirror);
+		priv->mirror = NULL;
+	}
+	if (priv->mirror || priv->mirror_unsupported)
+		return priv->mirror;
+
+	if (!dbus_connection_can_send_type(priv->connection,
+					   DBUS_TYPE_UNIX_FD)) {
+		priv->mirror_unsupported = TRUE;
+		return NULL;
+	}
+	reply = mafw_dbus_call(priv->connection, mafw_dbus_method_full(
+					MAFW_DBUS_DESTINATION,
+					priv->obj_path,
+					MAFW_DBUS_INTERFACE,
+				       MAFW_PLAYLIST_METHOD_GET_MIRROR),
+			       MAFW_PLAYLIST_ERROR, NULL);
+	if (!reply) {
+		/* Older daemon or no memfd, don't ask again. */
+		priv->mirror_unsupported = TRUE;
+		return NULL;
+	}
+	mafw_dbus_parse(reply, DBUS_TYPE_UNIX_FD, &fd,
+			DBUS_TYPE_UINT32, &size);
+	dbus_message_unref(reply);
+	if (!(priv->mirror = mafw_mirror_map(fd, size)))
+		priv->mirror_unsupported = TRUE;
+	return priv->mirror;
+#else
+	return NULL;
+#endif
+}
+
+/* Reads @count items from @first from the mirror, see mafw_mirror_read().
+ * Returns FALSE if they must be queried on D-Bus instead. */
+static gboolean mirror_read(MafwProxyPlaylistPrivate *priv, guint first,
+			    guint count, MafwMirrorState *state,
+			    gchar ***oids)
+{
+	MafwMirror *mirror;
+
+	/* The mirror can't tell which of our pipelined edits it shows. */
+	if (priv->pending_edits)
+		return FALSE;
+	if (!(mirror = get_mirror(priv)))
+		return FALSE;
+	if (!mafw_mirror_read(mirror, first, count, state, oids))
+		return FALSE;
+	if (priv->mirror_behind) {
+		if (state->generation == priv->mirror_stale_gen) {
+			if (oids)
+				g_strfreev(*oids);
+			return FALSE;
+		}
+		priv->mirror_behind = FALSE;
+	}
+	return TRUE;
+}
+
+/* To be called before editing the items: the mirror won't be trusted
+ * until it shows a newer generation than what it has now. */
+static void mirror_expect_change(MafwProxyPlaylistPrivate *priv)
+{
+	MafwMirrorState state;
+
+	if (!priv->mirror || priv->mirror_behind)
+		return;
+	if (mafw_mirror_read(priv->mirror, 0, 0, &state, NULL)) {
+		priv->mirror_stale_gen = state.generation;
+		priv->mirror_behind = TRUE;
+	} else {
+		/* Stale or busy, get_mirror() will sort it out. */
+		mafw_mirror_free(priv->mirror);
+		priv->mirror = NULL;
+	}
+}
+
+/* To be called if an edit announced with mirror_expect_change() failed,
+ * so it won't change the generation.  Left to async_call_done() while
+ * asynchronous edits are in flight, which may change it still. */
+static void mirror_change_failed(MafwProxyPlaylistPrivate *priv)
+{
+	if (priv->pending_edits)
+		return;
+	priv->mirror_behind = FALSE;
+}
+
 /*---------------------------------------------------------------------------
   Set name
   ---------------------------------------------------------------------------*/
@@ -351,8 +604,12 @@ static void mafw_proxy_playlist_set_name(MafwProxyPlaylist *self,
 
 	priv = MAFW_PROXY_PLAYLIST_GET_PRIVATE(playlist);
 
-	g_return_if_fail(priv->connection != NULL);
 	g_return_if_fail(name != NULL);
+	if (priv->embedded) {
+		playlist_store_set_name(self, name);
+		return;
+	}
+	g_return_if_fail(priv->connection != NULL);
 
 	mafw_dbus_send(priv->connection, mafw_dbus_method_full(
 					MAFW_DBUS_DESTINATION,
@@ -375,6 +632,8 @@ static gchar *mafw_proxy_playlist_get_name(MafwProxyPlaylist *self,
 	gchar *retval = NULL;
 
 	priv = MAFW_PROXY_PLAYLIST_GET_PRIVATE(playlist);
+	if (priv->embedded)
+		return playlist_store_get_name(self, error);
 	g_return_val_if_fail(priv->connection != NULL, NULL);
 
 	reply = mafw_dbus_call(priv->connection, mafw_dbus_method_full(
@@ -405,8 +664,13 @@ static void mafw_proxy_playlist_set_repeat(MafwProxyPlaylist *self,
 	MafwProxyPlaylistPrivate *priv;
 
 	priv = MAFW_PROXY_PLAYLIST_GET_PRIVATE(playlist);
+	if (priv->embedded) {
+		playlist_store_set_repeat(self, repeat, NULL);
+		return;
+	}
 	g_return_if_fail(priv->connection != NULL);
 
+	priv->repeat_valid = FALSE;
 	mafw_dbus_send(priv->connection, mafw_dbus_method_full(
 					MAFW_DBUS_DESTINATION,
 					priv->obj_path,
@@ -429,8 +693,13 @@ gboolean mafw_proxy_playlist_get_repeat(MafwProxyPlaylist *self,
 	gboolean retval = FALSE;
 
 	priv = MAFW_PROXY_PLAYLIST_GET_PRIVATE(playlist);
+	if (priv->embedded)
+		return playlist_store_get_repeat(self, error);
 	g_return_val_if_fail(priv->connection != NULL, FALSE);
 
+	if (priv->repeat_valid && cache_fresh(priv))
+		return priv->repeat;
+
 	reply = mafw_dbus_call(priv->connection, mafw_dbus_method_full(
 					MAFW_DBUS_DESTINATION,
 					priv->obj_path,
@@ -463,8 +732,11 @@ gboolean mafw_proxy_playlist_shuffle(MafwPlaylist *self, GError **error)
 	DBusMessage *reply;
 
 	priv = MAFW_PROXY_PLAYLIST_GET_PRIVATE(playlist);
+	if (priv->embedded)
+		return playlist_store_shuffle(playlist, TRUE, error);
 	g_return_val_if_fail(priv->connection != NULL, FALSE);
 
+	priv->shuffled_valid = FALSE;
 	reply = mafw_dbus_call(priv->connection, mafw_dbus_method_full(
 					MAFW_DBUS_DESTINATION,
 					priv->obj_path,
@@ -495,8 +767,13 @@ static gboolean mafw_proxy_playlist_is_shuffled(MafwProxyPlaylist *self,
 	gboolean retval = FALSE;
 
 	priv = MAFW_PROXY_PLAYLIST_GET_PRIVATE(playlist);
+	if (priv->embedded)
+		return playlist_store_is_shuffled(self, error);
 	g_return_val_if_fail(priv->connection != NULL, FALSE);
 
+	if (priv->shuffled_valid && cache_fresh(priv))
+		return priv->shuffled;
+
 	reply = mafw_dbus_call(priv->connection, mafw_dbus_method_full(
 					MAFW_DBUS_DESTINATION,
 					priv->obj_path,
@@ -526,8 +803,12 @@ gboolean mafw_proxy_playlist_unshuffle(MafwPlaylist *self, GError **error)
 	DBusMessage *reply;
 
 	priv = MAFW_PROXY_PLAYLIST_GET_PRIVATE(playlist);
+	if (priv->embedded)
+		return playlist_store_shuffle(playlist, FALSE,
+					      error);
 	g_return_val_if_fail(priv->connection != NULL, FALSE);
 
+	priv->shuffled_valid = FALSE;
 	reply = mafw_dbus_call(priv->connection, mafw_dbus_method_full(
 					MAFW_DBUS_DESTINATION,
 					priv->obj_path,
@@ -558,6 +839,8 @@ static gboolean mafw_proxy_playlist_increment_use_count(MafwPlaylist *self,
 
 	g_return_val_if_fail(self != NULL, FALSE);
 	priv = MAFW_PROXY_PLAYLIST_GET_PRIVATE(playlist);
+	if (priv->embedded)
+		return playlist_store_use_count(playlist, 1, error);
 	g_return_val_if_fail(priv->connection != NULL, FALSE);
 
 	reply = mafw_dbus_call(
@@ -589,6 +872,8 @@ static gboolean mafw_proxy_playlist_decrement_use_count(MafwPlaylist *self,
 	DBusMessage *reply;
 
 	priv = MAFW_PROXY_PLAYLIST_GET_PRIVATE(playlist);
+	if (priv->embedded)
+		return playlist_store_use_count(playlist, -1, error);
 	g_return_val_if_fail(priv->connection != NULL, FALSE);
 
 	reply = mafw_dbus_call(
@@ -622,8 +907,13 @@ gboolean mafw_proxy_playlist_insert_item(MafwPlaylist *self, guint index,
 	const gchar *oids[2] = {objectid, NULL};
 
 	priv = MAFW_PROXY_PLAYLIST_GET_PRIVATE(playlist);
+	if (priv->embedded)
+		return playlist_store_insert(playlist, index, oids,
+					     error);
 	g_return_val_if_fail(priv->connection != NULL, FALSE);
 
+	priv->size_valid = FALSE;
+	mirror_expect_change(priv);
 	reply = mafw_dbus_call(priv->connection, mafw_dbus_method_full(
 					MAFW_DBUS_DESTINATION,
 					priv->obj_path,
@@ -637,6 +927,7 @@ gboolean mafw_proxy_playlist_insert_item(MafwPlaylist *self, guint index,
 		dbus_message_unref(reply);
 		return TRUE;
 	}
+	mirror_change_failed(priv);
 	return FALSE;
 }
 
@@ -649,8 +940,13 @@ gboolean mafw_proxy_playlist_insert_items(MafwPlaylist *self, guint index,
 	DBusMessage *reply;
 
 	priv = MAFW_PROXY_PLAYLIST_GET_PRIVATE(playlist);
+	if (priv->embedded)
+		return playlist_store_insert(playlist, index,
+					     objectids, error);
 	g_return_val_if_fail(priv->connection != NULL, FALSE);
 
+	priv->size_valid = FALSE;
+	mirror_expect_change(priv);
 	reply = mafw_dbus_call(priv->connection, mafw_dbus_method_full(
 					MAFW_DBUS_DESTINATION,
 					priv->obj_path,
@@ -664,6 +960,7 @@ gboolean mafw_proxy_playlist_insert_items(MafwPlaylist *self, guint index,
 		dbus_message_unref(reply);
 		return TRUE;
 	}
+	mirror_change_failed(priv);
 	return FALSE;
 }
 
@@ -677,8 +974,12 @@ gboolean mafw_proxy_playlist_append_item(MafwPlaylist *self,
 	const gchar *oids[2] = {objectid, NULL};
 
 	priv = MAFW_PROXY_PLAYLIST_GET_PRIVATE(playlist);
+	if (priv->embedded)
+		return playlist_store_append(playlist, oids, error);
 	g_return_val_if_fail(priv->connection != NULL, FALSE);
 
+	priv->size_valid = FALSE;
+	mirror_expect_change(priv);
 	reply = mafw_dbus_call(priv->connection, mafw_dbus_method_full(
 					MAFW_DBUS_DESTINATION,
 					priv->obj_path,
@@ -690,6 +991,7 @@ gboolean mafw_proxy_playlist_append_item(MafwPlaylist *self,
 		dbus_message_unref(reply);
 		return TRUE;
 	}
+	mirror_change_failed(priv);
 	return FALSE;
 }
 
@@ -702,8 +1004,13 @@ gboolean mafw_proxy_playlist_append_items(MafwPlaylist *self,
 	DBusMessage *reply;
 
 	priv = MAFW_PROXY_PLAYLIST_GET_PRIVATE(playlist);
+	if (priv->embedded)
+		return playlist_store_append(playlist, objectids,
+					     error);
 	g_return_val_if_fail(priv->connection != NULL, FALSE);
 
+	priv->size_valid = FALSE;
+	mirror_expect_change(priv);
 	reply = mafw_dbus_call(priv->connection, mafw_dbus_method_full(
 					MAFW_DBUS_DESTINATION,
 					priv->obj_path,
@@ -715,6 +1022,7 @@ gboolean mafw_proxy_playlist_append_items(MafwPlaylist *self,
 		dbus_message_unref(reply);
 		return TRUE;
 	}
+	mirror_change_failed(priv);
 	return FALSE;
 }
 
@@ -733,8 +1041,12 @@ gboolean mafw_proxy_playlist_remove_item(MafwPlaylist *self, guint index,
 
 	g_return_val_if_fail(self != NULL, FALSE);
 	priv = MAFW_PROXY_PLAYLIST_GET_PRIVATE(playlist);
+	if (priv->embedded)
+		return playlist_store_remove(playlist, index, error);
 	g_return_val_if_fail(priv->connection != NULL, FALSE);
 
+	priv->size_valid = FALSE;
+	mirror_expect_change(priv);
 	reply = mafw_dbus_call(priv->connection, mafw_dbus_method_full(
 					MAFW_DBUS_DESTINATION,
 					priv->obj_path,
@@ -746,9 +1058,12 @@ gboolean mafw_proxy_playlist_remove_item(MafwPlaylist *self, guint index,
 	if (reply) {
 		mafw_dbus_parse(reply,DBUS_TYPE_BOOLEAN, &retval);
 		dbus_message_unref(reply);
+		if (!retval)
+			mirror_change_failed(priv);
 		return retval;
 	}
 
+	mirror_change_failed(priv);
 	return FALSE;
 }
 
@@ -762,10 +1077,21 @@ gchar *mafw_proxy_playlist_get_item(MafwPlaylist *self, guint index,
 	MafwProxyPlaylist* playlist = MAFW_PROXY_PLAYLIST(self);
 	MafwProxyPlaylistPrivate *priv;
 	DBusMessage *reply;
+	MafwMirrorState state;
+	gchar **oids;
 	gchar *retval = NULL;
 
 	priv = MAFW_PROXY_PLAYLIST_GET_PRIVATE(playlist);
+	if (priv->embedded)
+		return playlist_store_get_item(playlist, index, error);
 	g_return_val_if_fail(priv->connection != NULL, NULL);
+
+	if (mirror_read(priv, index, 1, &state, &oids)) {
+		retval = oids[0];
+		g_free(oids);
+		return retval;
+	}
+
 	reply = mafw_dbus_call(priv->connection, mafw_dbus_method_full(
 					MAFW_DBUS_DESTINATION,
 					priv->obj_path,
@@ -790,10 +1116,27 @@ gchar **mafw_proxy_playlist_get_items(MafwPlaylist *self,
 	MafwProxyPlaylist* playlist = MAFW_PROXY_PLAYLIST(self);
 	MafwProxyPlaylistPrivate *priv;
 	DBusMessage *reply;
+	MafwMirrorState state;
 	gchar **retval = NULL;
 
 	priv = MAFW_PROXY_PLAYLIST_GET_PRIVATE(playlist);
+	if (priv->embedded)
+		return playlist_store_get_items(playlist, first_index,
+						last_index, error);
 	g_return_val_if_fail(priv->connection != NULL, NULL);
+
+	/* An invalid range is left to the daemon to report. */
+	if (first_index <= last_index
+	    && mirror_read(priv, first_index,
+			   last_index - first_index < G_MAXUINT
+			   ? last_index - first_index + 1 : G_MAXUINT,
+			   &state, &retval)) {
+		if (first_index < state.len)
+			return retval;
+		g_strfreev(retval);
+		retval = NULL;
+	}
+
 	reply = mafw_dbus_call(priv->connection, mafw_dbus_method_full(
 					MAFW_DBUS_DESTINATION,
 					priv->obj_path,
@@ -827,6 +1170,9 @@ static gboolean send_method_get_uint_str_params(gboolean send_param,
 	guint retidx;
 
 	priv = MAFW_PROXY_PLAYLIST_GET_PRIVATE(playlist);
+	if (priv->embedded)
+		return playlist_store_navigate(playlist, command,
+					       index, oid, error);
 	g_return_val_if_fail(priv->connection != NULL, FALSE);
 	if (send_param)
 		reply = mafw_dbus_call(priv->connection, mafw_dbus_method_full(
@@ -901,6 +1247,78 @@ gboolean mafw_proxy_playlist_get_prev(MafwPlaylist *playlist,
 			index, oid, error);
 }
 
+/* Returns the object ids in the GET_NEXT_N $reply, and their indices in
+ * $indices if it's not NULL. */
+static gchar **next_n_reply(DBusMessage *reply, guint **indices)
+{
+	dbus_uint32_t *idxs;
+	gchar **oids;
+	gint nidxs;
+
+	mafw_dbus_parse(reply,
+			DBUS_TYPE_ARRAY, DBUS_TYPE_UINT32, &idxs, &nidxs,
+			MAFW_DBUS_TYPE_STRVZ, &oids);
+	if (!oids)
+		oids = g_new0(gchar *, 1);
+	if (indices) {
+		*indices = g_new(guint, nidxs);
+		memcpy(*indices, idxs, nidxs * sizeof(**indices));
+	}
+	return oids;
+}
+
+/**
+ * mafw_proxy_playlist_get_next_n:
+ * @self:    a #MafwProxyPlaylist
+ * @index:   visual index of the current item
+ * @n:       number of items to look ahead
+ * @indices: if not %NULL, set to a newly allocated array of the visual
+ *           indices of the returned items
+ * @error:   return location for a #GError, or %NULL
+ *
+ * Looks ahead the next @n items that would be returned by successive
+ * mafw_playlist_get_next() calls starting from @index, respecting shuffle
+ * and repeat, in one round trip.  Useful for prebuffering.  The shuffled
+ * order is settled by the look-ahead, so later mafw_playlist_get_next()
+ * calls will agree with it.  Less items than @n are returned if the end
+ * of the playlist is reached; the playlist daemon may also limit @n.
+ *
+ * Returns: a %NULL-terminated array of object ids, possibly empty, to be
+ * freed with g_strfreev(), or %NULL in case of error.
+ */
+gchar **mafw_proxy_playlist_get_next_n(MafwProxyPlaylist *self,
+				       guint index, guint n,
+				       guint **indices, GError **error)
+{
+	MafwProxyPlaylistPrivate *priv;
+	DBusMessage *reply;
+	gchar **oids;
+
+	g_return_val_if_fail(MAFW_IS_PROXY_PLAYLIST(self), NULL);
+	priv = MAFW_PROXY_PLAYLIST_GET_PRIVATE(self);
+	if (priv->embedded)
+		return playlist_store_get_next_n(self, index, n,
+						 indices, error);
+	g_return_val_if_fail(priv->connection != NULL, NULL);
+
+	reply = mafw_dbus_call(priv->connection,
+			       mafw_dbus_method_full(
+				       MAFW_DBUS_DESTINATION,
+				       priv->obj_path,
+				       MAFW_DBUS_INTERFACE,
+				       MAFW_PLAYLIST_METHOD_GET_NEXT_N,
+				       MAFW_DBUS_UINT32(index),
+				       MAFW_DBUS_UINT32(n)),
+			       MAFW_PLAYLIST_ERROR, error);
+	if (!reply)
+		return NULL;
+
+	oids = next_n_reply(reply, indices);
+	dbus_message_unref(reply);
+
+	return oids;
+}
+
 /*---------------------------------------------------------------------------
   Move Item
   ---------------------------------------------------------------------------*/
@@ -916,8 +1334,13 @@ gboolean mafw_proxy_playlist_move_item(MafwPlaylist *self, guint from,
 	g_return_val_if_fail(self, FALSE);
 	playlist = MAFW_PROXY_PLAYLIST(self);
 	priv = MAFW_PROXY_PLAYLIST_GET_PRIVATE(playlist);
+	if (priv->embedded)
+		return playlist_store_move(playlist, from, to, error);
 	g_return_val_if_fail(priv->connection != NULL, FALSE);
 
+	/* Moving an item in place doesn't change anything. */
+	if (from != to)
+		mirror_expect_change(priv);
 	reply = mafw_dbus_call(priv->connection, mafw_dbus_method_full(
 					MAFW_DBUS_DESTINATION,
 					priv->obj_path,
@@ -930,9 +1353,12 @@ gboolean mafw_proxy_playlist_move_item(MafwPlaylist *self, guint from,
 	if (reply) {
 		mafw_dbus_parse(reply,DBUS_TYPE_BOOLEAN, &retval);
 		dbus_message_unref(reply);
+		if (!retval)
+			mirror_change_failed(priv);
 		return retval;
 	}
 
+	mirror_change_failed(priv);
 	return FALSE;
 
 }
@@ -946,11 +1372,19 @@ guint mafw_proxy_playlist_get_size(MafwPlaylist *self, GError **error)
 	MafwProxyPlaylist* playlist = MAFW_PROXY_PLAYLIST(self);
 	MafwProxyPlaylistPrivate *priv;
 	DBusMessage *reply;
+	MafwMirrorState state;
 	guint retval = 0;
 
 	priv = MAFW_PROXY_PLAYLIST_GET_PRIVATE(playlist);
+	if (priv->embedded)
+		return playlist_store_get_size(playlist, error);
 	g_return_val_if_fail(priv->connection != NULL, 0);
 
+	if (priv->size_valid && cache_fresh(priv))
+		return priv->size;
+	if (mirror_read(priv, 0, 0, &state, NULL))
+		return state.len;
+
 	reply = mafw_dbus_call(priv->connection, mafw_dbus_method_full(
 					MAFW_DBUS_DESTINATION,
 					priv->obj_path,
@@ -979,8 +1413,12 @@ gboolean mafw_proxy_playlist_clear(MafwPlaylist *self, GError **error)
 	DBusMessage *reply;
 
 	priv = MAFW_PROXY_PLAYLIST_GET_PRIVATE(playlist);
+	if (priv->embedded)
+		return playlist_store_clear(playlist, error);
 	g_return_val_if_fail(priv->connection != NULL, FALSE);
 
+	priv->size_valid = FALSE;
+	mirror_expect_change(priv);
 	reply = mafw_dbus_call(priv->connection, mafw_dbus_method_full(
 					MAFW_DBUS_DESTINATION,
 					priv->obj_path,
@@ -993,9 +1431,2652 @@ gboolean mafw_proxy_playlist_clear(MafwPlaylist *self, GError **error)
 		return TRUE;
 	}
 
+	mirror_change_failed(priv);
+	return FALSE;
+}
+
+/*---------------------------------------------------------------------------
+  Batched operations
+  ---------------------------------------------------------------------------*/
+
+/* One recorded operation, see MAFW_PLAYLIST_OP_* for the meaning of the
+ * fields.  The in-process store takes them as they are. */
+typedef MafwPlaylistStoreOp BatchOp;
+
+struct _MafwProxyPlaylistBatch {
+	GArray *ops;
+};
+
+static void batch_add(MafwProxyPlaylistBatch *batch, guint type,
+		      guint idx, guint arg, const gchar **oids)
+{
+	BatchOp op;
+
+	g_return_if_fail(batch != NULL);
+
+	op.type = type;
+	op.idx = idx;
+	op.arg = arg;
+	op.oids = g_strdupv((gchar **)oids);
+	g_array_append_val(batch->ops, op);
+}
+
+/**
+ * mafw_proxy_playlist_batch_new:
+ *
+ * Creates an empty batch of playlist operations.  Operations are
+ * recorded with the mafw_proxy_playlist_batch_*() functions, and sent to
+ * the playlist daemon with mafw_proxy_playlist_apply_batch().
+ *
+ * Returns: a new #MafwProxyPlaylistBatch, free it with
+ * mafw_proxy_playlist_batch_free().
+ */
+MafwProxyPlaylistBatch *mafw_proxy_playlist_batch_new(void)
+{
+	MafwProxyPlaylistBatch *batch;
+
+	batch = g_new0(MafwProxyPlaylistBatch, 1);
+	batch->ops = g_array_new(FALSE, FALSE, sizeof(BatchOp));
+	return batch;
+}
+
+/**
+ * mafw_proxy_playlist_batch_free:
+ * @batch: a #MafwProxyPlaylistBatch
+ *
+ * Frees @batch and the operations recorded in it.
+ */
+void mafw_proxy_playlist_batch_free(MafwProxyPlaylistBatch *batch)
+{
+	guint i;
+
+	if (!batch)
+		return;
+	for (i = 0; i < batch->ops->len; i++)
+		g_strfreev(g_array_index(batch->ops, BatchOp, i).oids);
+	g_array_free(batch->ops, TRUE);
+	g_free(batch);
+}
+
+/**
+ * mafw_proxy_playlist_batch_insert:
+ * @batch: a #MafwProxyPlaylistBatch
+ * @index: visual index to insert at
+ * @oids:  %NULL-terminated array of object ids
+ *
+ * Records the insertion of @oids at @index.
+ */
+void mafw_proxy_playlist_batch_insert(MafwProxyPlaylistBatch *batch,
+				      guint index, const gchar **oids)
+{
+	batch_add(batch, MAFW_PLAYLIST_OP_INSERT, index, 0, oids);
+}
+
+/**
+ * mafw_proxy_playlist_batch_append:
+ * @batch: a #MafwProxyPlaylistBatch
+ * @oids:  %NULL-terminated array of object ids
+ *
+ * Records appending @oids to the playlist.
+ */
+void mafw_proxy_playlist_batch_append(MafwProxyPlaylistBatch *batch,
+				      const gchar **oids)
+{
+	batch_add(batch, MAFW_PLAYLIST_OP_APPEND, 0, 0, oids);
+}
+
+/**
+ * mafw_proxy_playlist_batch_remove:
+ * @batch: a #MafwProxyPlaylistBatch
+ * @index: visual index of the first item to remove
+ * @count: number of items to remove
+ *
+ * Records the removal of @count items starting at @index.
+ */
+void mafw_proxy_playlist_batch_remove(MafwProxyPlaylistBatch *batch,
+				      guint index, guint count)
+{
+	batch_add(batch, MAFW_PLAYLIST_OP_REMOVE, index, count, NULL);
+}
+
+/**
+ * mafw_proxy_playlist_batch_move:
+ * @batch: a #MafwProxyPlaylistBatch
+ * @from:  visual index of the item to move
+ * @to:    its new visual index
+ *
+ * Records moving an item from @from to @to.
+ */
+void mafw_proxy_playlist_batch_move(MafwProxyPlaylistBatch *batch,
+				    guint from, guint to)
+{
+	batch_add(batch, MAFW_PLAYLIST_OP_MOVE, from, to, NULL);
+}
+
+/**
+ * mafw_proxy_playlist_batch_clear:
+ * @batch: a #MafwProxyPlaylistBatch
+ *
+ * Records the removal of all items.
+ */
+void mafw_proxy_playlist_batch_clear(MafwProxyPlaylistBatch *batch)
+{
+	batch_add(batch, MAFW_PLAYLIST_OP_CLEAR, 0, 0, NULL);
+}
+
+/**
+ * mafw_proxy_playlist_batch_set_repeat:
+ * @batch:  a #MafwProxyPlaylistBatch
+ * @repeat: the new repeat mode
+ *
+ * Records a change of the repeat mode.
+ */
+void mafw_proxy_playlist_batch_set_repeat(MafwProxyPlaylistBatch *batch,
+					  gboolean repeat)
+{
+	batch_add(batch, MAFW_PLAYLIST_OP_SET_REPEAT, 0, repeat != FALSE,
+		  NULL);
+}
+
+/**
+ * mafw_proxy_playlist_batch_shuffle:
+ * @batch: a #MafwProxyPlaylistBatch
+ *
+ * Records shuffling the playlist.
+ */
+void mafw_proxy_playlist_batch_shuffle(MafwProxyPlaylistBatch *batch)
+{
+	batch_add(batch, MAFW_PLAYLIST_OP_SHUFFLE, 0, 0, NULL);
+}
+
+/**
+ * mafw_proxy_playlist_batch_unshuffle:
+ * @batch: a #MafwProxyPlaylistBatch
+ *
+ * Records unshuffling the playlist.
+ */
+void mafw_proxy_playlist_batch_unshuffle(MafwProxyPlaylistBatch *batch)
+{
+	batch_add(batch, MAFW_PLAYLIST_OP_UNSHUFFLE, 0, 0, NULL);
+}
+
+/* Checks the validity flags of the operations of a batch in @res, and
+ * sets @error if any of them failed.  Gives @res to @results if it's
+ * not %NULL. */
+static gboolean batch_results(GArray *res, GArray **results, GError **error)
+{
+	gboolean isok;
+	guint i;
+
+	isok = TRUE;
+	for (i = 0; i < res->len && isok; i++) {
+		if (!g_array_index(res, gboolean, i)) {
+			g_set_error(error, MAFW_PLAYLIST_ERROR,
+				    MAFW_PLAYLIST_ERROR_INVALID_INDEX,
+				    "Operation %d of the batch is invalid", i);
+			isok = FALSE;
+		}
+	}
+	if (results)
+		*results = res;
+	else
+		g_array_free(res, TRUE);
+	return isok;
+}
+
+/* Applies $batch to the in-process store of $self, and returns the
+ * validity flags of its operations, or NULL setting $error. */
+static GArray *batch_apply_embedded(MafwProxyPlaylist *self,
+				    MafwProxyPlaylistBatch *batch,
+				    GError **error)
+{
+	GArray *res;
+
+	res = g_array_sized_new(FALSE, FALSE, sizeof(gboolean),
+				batch->ops->len);
+	g_array_set_size(res, batch->ops->len);
+	if (!playlist_store_apply_ops(self, (BatchOp *)batch->ops->data,
+				      batch->ops->len, (gboolean *)res->data,
+				      error)) {
+		g_array_free(res, TRUE);
+		return NULL;
+	}
+	return res;
+}
+
+/* Prepares the caches of $self for applying $batch on the daemon, and
+ * returns whether it may change the items. */
+static gboolean batch_expect_change(MafwProxyPlaylist *self,
+				    MafwProxyPlaylistBatch *batch)
+{
+	guint i;
+
+	proxy_playlist_invalidate_cache(self);
+	for (i = 0; i < batch->ops->len; i++) {
+		BatchOp *op = &g_array_index(batch->ops, BatchOp, i);
+
+		if (op->type != MAFW_PLAYLIST_OP_SET_REPEAT
+		    && op->type != MAFW_PLAYLIST_OP_SHUFFLE
+		    && op->type != MAFW_PLAYLIST_OP_UNSHUFFLE) {
+			mirror_expect_change(self->priv);
+			return TRUE;
+		}
+	}
 	return FALSE;
 }
 
+/* Returns the APPLY_OPS method call of $batch on $self. */
+static DBusMessage *batch_message(MafwProxyPlaylist *self,
+				  MafwProxyPlaylistBatch *batch)
+{
+	DBusMessage *msg;
+	DBusMessageIter imsg, iary, istr;
+	guint i;
+
+	msg = mafw_dbus_method_full(MAFW_DBUS_DESTINATION,
+				    self->priv->obj_path,
+				    MAFW_DBUS_INTERFACE,
+				    MAFW_PLAYLIST_METHOD_APPLY_OPS);
+	dbus_message_iter_init_append(msg, &imsg);
+	dbus_message_iter_open_container(&imsg, DBUS_TYPE_ARRAY,
+					 "(uuuas)", &iary);
+	for (i = 0; i < batch->ops->len; i++) {
+		BatchOp *op = &g_array_index(batch->ops, BatchOp, i);
+
+		dbus_message_iter_open_container(&iary, DBUS_TYPE_STRUCT,
+						 NULL, &istr);
+		dbus_message_iter_append_basic(&istr, DBUS_TYPE_UINT32,
+					       &op->type);
+		dbus_message_iter_append_basic(&istr, DBUS_TYPE_UINT32,
+					       &op->idx);
+		dbus_message_iter_append_basic(&istr, DBUS_TYPE_UINT32,
+					       &op->arg);
+		mafw_dbus_message_append_array(&istr, DBUS_TYPE_STRING,
+					       op->oids
+					       ? g_strv_length(op->oids) : 0,
+					       op->oids);
+		dbus_message_iter_close_container(&iary, &istr);
+	}
+	dbus_message_iter_close_container(&imsg, &iary);
+	return msg;
+}
+
+/* Returns the validity flags of the operations in the APPLY_OPS
+ * $reply. */
+static GArray *batch_reply(DBusMessage *reply)
+{
+	dbus_bool_t *valid;
+	GArray *res;
+	gint nvalid, i;
+
+	mafw_dbus_parse(reply, DBUS_TYPE_ARRAY, DBUS_TYPE_BOOLEAN,
+			&valid, &nvalid);
+	res = g_array_sized_new(FALSE, FALSE, sizeof(gboolean), nvalid);
+	for (i = 0; i < nvalid; i++) {
+		gboolean v;
+
+		v = valid[i];
+		g_array_append_val(res, v);
+	}
+	return res;
+}
+
+/**
+ * mafw_proxy_playlist_apply_batch:
+ * @self:    a #MafwProxyPlaylist
+ * @batch:   the operations to apply
+ * @results: if not %NULL, set to a newly allocated #GArray of #gboolean,
+ *           telling the validity of each operation
+ * @error:   return location for a #GError, or %NULL
+ *
+ * Applies the operations recorded in @batch in order, in one round trip.
+ * The daemon applies them as a transaction: if any of them is invalid
+ * (e.g. refers to an index out of range at its turn), none is applied.
+ * Listeners receive one #MafwPlaylist::contents-changed covering all the
+ * changes instead of one per operation.
+ *
+ * Returns: %TRUE if the operations were applied.
+ */
+gboolean mafw_proxy_playlist_apply_batch(MafwProxyPlaylist *self,
+					 MafwProxyPlaylistBatch *batch,
+					 GArray **results,
+					 GError **error)
+{
+	MafwProxyPlaylistPrivate *priv;
+	DBusMessage *reply;
+	GArray *res;
+	gboolean isok;
+
+	g_return_val_if_fail(MAFW_IS_PROXY_PLAYLIST(self), FALSE);
+	g_return_val_if_fail(batch != NULL, FALSE);
+	priv = MAFW_PROXY_PLAYLIST_GET_PRIVATE(self);
+
+	if (priv->embedded) {
+		res = batch_apply_embedded(self, batch, error);
+		return res && batch_results(res, results, error);
+	}
+	g_return_val_if_fail(priv->connection != NULL, FALSE);
+
+	batch_expect_change(self, batch);
+	reply = mafw_dbus_call(priv->connection, batch_message(self, batch),
+			       MAFW_PLAYLIST_ERROR, error);
+	if (!reply) {
+		mirror_change_failed(priv);
+		return FALSE;
+	}
+
+	res = batch_reply(reply);
+	dbus_message_unref(reply);
+	isok = batch_results(res, results, error);
+	if (!isok)
+		mirror_change_failed(priv);
+
+	return isok;
+}
+
+/*---------------------------------------------------------------------------
+  Asynchronous operations
+  ---------------------------------------------------------------------------*/
+
+/* Tells whether the edit completing $res changed the items. */
+typedef gboolean (*AsyncAppliedFunc)(GSimpleAsyncResult *res);
+
+/* An asynchronous call on D-Bus, see proxy_playlist_call_async(). */
+typedef struct {
+	GSimpleAsyncResult *res;
+	MafwProxyPlaylistParseFunc parse;
+	/* The playlist the call is counted in, if any, kept alive by
+	 * @res as its source object. */
+	MafwProxyPlaylist *playlist;
+	/* NULL unless the call is an edit of the items. */
+	AsyncAppliedFunc applied;
+} AsyncCall;
+
+/* Uncounts a call on $self which has completed, successfully if $ok.
+ * When the last of a row of edits completes and none of them changed the
+ * items the mirror is trusted again. */
+static void async_call_done(MafwProxyPlaylist *self, gboolean edit,
+			    gboolean ok)
+{
+	MafwProxyPlaylistPrivate *priv;
+
+	priv = self->priv;
+	priv->pending_calls--;
+	if (!edit)
+		return;
+	if (ok)
+		priv->edits_applied = TRUE;
+	if (--priv->pending_edits)
+		return;
+	if (!priv->edits_applied)
+		mirror_change_failed(priv);
+	priv->edits_applied = FALSE;
+}
+
+static void async_call_cb(DBusPendingCall *pending, gpointer udata)
+{
+	AsyncCall *call;
+	DBusMessage *reply;
+	GError *error;
+	gboolean ok;
+
+	call = udata;
+	reply = dbus_pending_call_steal_reply(pending);
+	dbus_pending_call_unref(pending);
+
+	error = mafw_dbus_is_error(reply, MAFW_PLAYLIST_ERROR);
+	if (error)
+		g_simple_async_result_take_error(call->res, error);
+	else if (call->parse)
+		call->parse(call->res, reply);
+	dbus_message_unref(reply);
+
+	if (call->playlist) {
+		ok = !error && (!call->applied || call->applied(call->res));
+		async_call_done(call->playlist, call->applied != NULL, ok);
+	}
+	g_simple_async_result_complete(call->res);
+	g_object_unref(call->res);
+	g_free(call);
+}
+
+/* Sends $msg on $conn and completes $res when the reply arrives, see
+ * proxy_playlist_call_async().  Counts the call in $self if it's
+ * not NULL, as an edit of the items if $applied isn't NULL. */
+static void async_call(MafwProxyPlaylist *self, DBusConnection *conn,
+		       DBusMessage *msg, GSimpleAsyncResult *res,
+		       MafwProxyPlaylistParseFunc parse,
+		       AsyncAppliedFunc applied)
+{
+	DBusPendingCall *pending;
+	AsyncCall *call;
+
+	call = g_new0(AsyncCall, 1);
+	call->res = res;
+	call->parse = parse;
+	call->playlist = self;
+	call->applied = applied;
+	if (self) {
+		self->priv->pending_calls++;
+		if (applied)
+			self->priv->pending_edits++;
+	}
+
+	mafw_dbus_send_async(conn, &pending, msg);
+	dbus_pending_call_set_notify(pending, async_call_cb, call, NULL);
+}
+
+/* Calls $member of the playlist on D-Bus with the arguments following,
+ * for the operations below.  Takes over $res. */
+#define playlist_call_async(self, res, parse, applied, member, ...)	\
+	async_call((self), (self)->priv->connection,			\
+		   mafw_dbus_method_full(MAFW_DBUS_DESTINATION,		\
+					 (self)->priv->obj_path,	\
+					 MAFW_DBUS_INTERFACE,		\
+					 member, ##__VA_ARGS__),	\
+		   (res), (parse), (applied))
+
+/**
+ * proxy_playlist_call_async:
+ * @conn:  the #DBusConnection to use
+ * @msg:   the method call to send, which is unref:ed
+ * @res:   the result to complete when the reply arrives, which is taken
+ *         over
+ * @parse: function to store the result of a successful reply in @res, or
+ *         %NULL
+ *
+ * Sends @msg to the playlist daemon without blocking, and completes @res
+ * with its reply.  Error replies are stored in @res as errors in the
+ * %MAFW_PLAYLIST_ERROR domain.  The playlist daemon replies the calls of a
+ * client in the order it sent them.
+ */
+void proxy_playlist_call_async(DBusConnection *conn, DBusMessage *msg,
+			       GSimpleAsyncResult *res,
+			       MafwProxyPlaylistParseFunc parse)
+{
+	async_call(NULL, conn, msg, res, parse, NULL);
+}
+
+/* Completes $res of an operation done without D-Bus in an idle callback,
+ * like the replies come, taking $error if it failed. */
+static void async_done_in_idle(GSimpleAsyncResult *res, GError *error)
+{
+	if (error)
+		g_simple_async_result_take_error(res, error);
+	g_simple_async_result_complete_in_idle(res);
+	g_object_unref(res);
+}
+
+/* Like mirror_read(), but fails instead of asking the daemon for the
+ * mirror, or while our calls are in flight, whose replies would come
+ * after the result. */
+static gboolean mirror_peek(MafwProxyPlaylistPrivate *priv, guint first,
+			    guint count, MafwMirrorState *state,
+			    gchar ***oids)
+{
+	if (priv->pending_calls || !priv->mirror
+	    || mafw_mirror_is_stale(priv->mirror))
+		return FALSE;
+	return mirror_read(priv, first, count, state, oids);
+}
+
+/* Reply parsers. */
+static void parse_done(GSimpleAsyncResult *res, DBusMessage *reply)
+{
+	g_simple_async_result_set_op_res_gboolean(res, TRUE);
+}
+
+static void parse_boolean(GSimpleAsyncResult *res, DBusMessage *reply)
+{
+	gboolean retval;
+
+	mafw_dbus_parse(reply, DBUS_TYPE_BOOLEAN, &retval);
+	g_simple_async_result_set_op_res_gboolean(res, retval);
+}
+
+static void parse_item(GSimpleAsyncResult *res, DBusMessage *reply)
+{
+	const gchar *oid;
+
+	mafw_dbus_parse(reply, DBUS_TYPE_STRING, &oid);
+	g_simple_async_result_set_op_res_gpointer(res,
+						  *oid ? g_strdup(oid) : NULL,
+						  g_free);
+}
+
+static void parse_items(GSimpleAsyncResult *res, DBusMessage *reply)
+{
+	gchar **oids;
+
+	mafw_dbus_parse(reply, MAFW_DBUS_TYPE_STRVZ, &oids);
+	if (!oids[0]) {
+		g_strfreev(oids);
+		oids = NULL;
+	}
+	g_simple_async_result_set_op_res_gpointer(res, oids,
+						  (GDestroyNotify)g_strfreev);
+}
+
+static void parse_size(GSimpleAsyncResult *res, DBusMessage *reply)
+{
+	guint size;
+
+	mafw_dbus_parse(reply, DBUS_TYPE_UINT32, &size);
+	g_simple_async_result_set_op_res_gssize(res, size);
+}
+
+/* Edits tell their outcome in a boolean. */
+static gboolean edit_applied(GSimpleAsyncResult *res)
+{
+	return g_simple_async_result_get_op_res_gboolean(res);
+}
+
+/* Common part of the _finish() functions: checks that $res is of $tag on
+ * $self, and returns FALSE if it failed, setting $error. */
+static gboolean async_finish(MafwProxyPlaylist *self, GAsyncResult *res,
+			     gpointer tag, GError **error)
+{
+	g_return_val_if_fail(g_simple_async_result_is_valid(res,
+							    G_OBJECT(self),
+							    tag), FALSE);
+	return !g_simple_async_result_propagate_error(
+					G_SIMPLE_ASYNC_RESULT(res), error);
+}
+
+/* Returns the outcome of the edit $res of $tag on $self. */
+static gboolean edit_finish(MafwProxyPlaylist *self, GAsyncResult *res,
+			    gpointer tag, GError **error)
+{
+	return async_finish(self, res, tag, error)
+		&& g_simple_async_result_get_op_res_gboolean(
+					G_SIMPLE_ASYNC_RESULT(res));
+}
+
+/* Starts inserting $oids at $index for $tag. */
+static void insert_async(MafwProxyPlaylist *self, guint index,
+			 const gchar **oids, gpointer tag,
+			 GAsyncReadyCallback callback, gpointer user_data)
+{
+	MafwProxyPlaylistPrivate *priv;
+	GSimpleAsyncResult *res;
+	GError *error = NULL;
+
+	priv = self->priv;
+	res = g_simple_async_result_new(G_OBJECT(self), callback, user_data,
+					tag);
+	if (priv->embedded) {
+		g_simple_async_result_set_op_res_gboolean(res,
+				playlist_store_insert(self, index, oids,
+						      &error));
+		async_done_in_idle(res, error);
+		return;
+	}
+
+	priv->size_valid = FALSE;
+	mirror_expect_change(priv);
+	playlist_call_async(self, res, parse_done, edit_applied,
+			    MAFW_PLAYLIST_METHOD_INSERT_ITEM,
+			    MAFW_DBUS_UINT32(index),
+			    MAFW_DBUS_STRVZ(oids));
+}
+
+/* Starts appending $oids for $tag. */
+static void append_async(MafwProxyPlaylist *self, const gchar **oids,
+			 gpointer tag, GAsyncReadyCallback callback,
+			 gpointer user_data)
+{
+	MafwProxyPlaylistPrivate *priv;
+	GSimpleAsyncResult *res;
+	GError *error = NULL;
+
+	priv = self->priv;
+	res = g_simple_async_result_new(G_OBJECT(self), callback, user_data,
+					tag);
+	if (priv->embedded) {
+		g_simple_async_result_set_op_res_gboolean(res,
+				playlist_store_append(self, oids,
+						      &error));
+		async_done_in_idle(res, error);
+		return;
+	}
+
+	priv->size_valid = FALSE;
+	mirror_expect_change(priv);
+	playlist_call_async(self, res, parse_done, edit_applied,
+			    MAFW_PLAYLIST_METHOD_APPEND_ITEM,
+			    MAFW_DBUS_STRVZ(oids));
+}
+
+/**
+ * mafw_proxy_playlist_insert_item_async:
+ * @self:      a #MafwProxyPlaylist
+ * @index:     visual index to insert at
+ * @objectid:  object id of the item
+ * @callback:  function to call when the item has been inserted
+ * @user_data: data to pass to @callback
+ *
+ * Like mafw_playlist_insert_item(), but returns without waiting for the
+ * playlist daemon.  @callback is called from the main loop, and can get
+ * the outcome with mafw_proxy_playlist_insert_item_finish().
+ *
+ * The asynchronous operations of a playlist complete in the order they
+ * were started, and the daemon applies the edits in that order, so edits
+ * can be issued one after the other without waiting for the previous
+ * ones.  Synchronous calls made meanwhile see the edits in flight
+ * applied.
+ */
+void mafw_proxy_playlist_insert_item_async(MafwProxyPlaylist *self,
+					   guint index,
+					   const gchar *objectid,
+					   GAsyncReadyCallback callback,
+					   gpointer user_data)
+{
+	const gchar *oids[2] = {objectid, NULL};
+
+	g_return_if_fail(MAFW_IS_PROXY_PLAYLIST(self));
+	insert_async(self, index, oids,
+		     mafw_proxy_playlist_insert_item_async,
+		     callback, user_data);
+}
+
+/**
+ * mafw_proxy_playlist_insert_item_finish:
+ * @self:  a #MafwProxyPlaylist
+ * @res:   the #GAsyncResult passed to the callback
+ * @error: return location for a #GError, or %NULL
+ *
+ * Finishes mafw_proxy_playlist_insert_item_async().
+ *
+ * Returns: %TRUE if the item was inserted.
+ */
+gboolean mafw_proxy_playlist_insert_item_finish(MafwProxyPlaylist *self,
+						GAsyncResult *res,
+						GError **error)
+{
+	return edit_finish(self, res, mafw_proxy_playlist_insert_item_async,
+			   error);
+}
+
+/**
+ * mafw_proxy_playlist_insert_items_async:
+ * @self:      a #MafwProxyPlaylist
+ * @index:     visual index to insert at
+ * @objectids: %NULL-terminated array of the object ids of the items
+ * @callback:  function to call when the items have been inserted
+ * @user_data: data to pass to @callback
+ *
+ * Asynchronous version of mafw_playlist_insert_items(), see
+ * mafw_proxy_playlist_insert_item_async().
+ */
+void mafw_proxy_playlist_insert_items_async(MafwProxyPlaylist *self,
+					    guint index,
+					    const gchar **objectids,
+					    GAsyncReadyCallback callback,
+					    gpointer user_data)
+{
+	g_return_if_fail(MAFW_IS_PROXY_PLAYLIST(self));
+	insert_async(self, index, objectids,
+		     mafw_proxy_playlist_insert_items_async,
+		     callback, user_data);
+}
+
+/**
+ * mafw_proxy_playlist_insert_items_finish:
+ * @self:  a #MafwProxyPlaylist
+ * @res:   the #GAsyncResult passed to the callback
+ * @error: return location for a #GError, or %NULL
+ *
+ * Finishes mafw_proxy_playlist_insert_items_async().
+ *
+ * Returns: %TRUE if the items were inserted.
+ */
+gboolean mafw_proxy_playlist_insert_items_finish(MafwProxyPlaylist *self,
+						 GAsyncResult *res,
+						 GError **error)
+{
+	return edit_finish(self, res, mafw_proxy_playlist_insert_items_async,
+			   error);
+}
+
+/**
+ * mafw_proxy_playlist_append_item_async:
+ * @self:      a #MafwProxyPlaylist
+ * @objectid:  object id of the item
+ * @callback:  function to call when the item has been appended
+ * @user_data: data to pass to @callback
+ *
+ * Asynchronous version of mafw_playlist_append_item(), see
+ * mafw_proxy_playlist_insert_item_async().
+ */
+void mafw_proxy_playlist_append_item_async(MafwProxyPlaylist *self,
+					   const gchar *objectid,
+					   GAsyncReadyCallback callback,
+					   gpointer user_data)
+{
+	const gchar *oids[2] = {objectid, NULL};
+
+	g_return_if_fail(MAFW_IS_PROXY_PLAYLIST(self));
+	append_async(self, oids, mafw_proxy_playlist_append_item_async,
+		     callback, user_data);
+}
+
+/**
+ * mafw_proxy_playlist_append_item_finish:
+ * @self:  a #MafwProxyPlaylist
+ * @res:   the #GAsyncResult passed to the callback
+ * @error: return location for a #GError, or %NULL
+ *
+ * Finishes mafw_proxy_playlist_append_item_async().
+ *
+ * Returns: %TRUE if the item was appended.
+ */
+gboolean mafw_proxy_playlist_append_item_finish(MafwProxyPlaylist *self,
+						GAsyncResult *res,
+						GError **error)
+{
+	return edit_finish(self, res, mafw_proxy_playlist_append_item_async,
+			   error);
+}
+
+/**
+ * mafw_proxy_playlist_append_items_async:
+ * @self:      a #MafwProxyPlaylist
+ * @objectids: %NULL-terminated array of the object ids of the items
+ * @callback:  function to call when the items have been appended
+ * @user_data: data to pass to @callback
+ *
+ * Asynchronous version of mafw_playlist_append_items(), see
+ * mafw_proxy_playlist_insert_item_async().
+ */
+void mafw_proxy_playlist_append_items_async(MafwProxyPlaylist *self,
+					    const gchar **objectids,
+					    GAsyncReadyCallback callback,
+					    gpointer user_data)
+{
+	g_return_if_fail(MAFW_IS_PROXY_PLAYLIST(self));
+	append_async(self, objectids,
+		     mafw_proxy_playlist_append_items_async,
+		     callback, user_data);
+}
+
+/**
+ * mafw_proxy_playlist_append_items_finish:
+ * @self:  a #MafwProxyPlaylist
+ * @res:   the #GAsyncResult passed to the callback
+ * @error: return location for a #GError, or %NULL
+ *
+ * Finishes mafw_proxy_playlist_append_items_async().
+ *
+ * Returns: %TRUE if the items were appended.
+ */
+gboolean mafw_proxy_playlist_append_items_finish(MafwProxyPlaylist *self,
+						 GAsyncResult *res,
+						 GError **error)
+{
+	return edit_finish(self, res, mafw_proxy_playlist_append_items_async,
+			   error);
+}
+
+/**
+ * mafw_proxy_playlist_remove_item_async:
+ * @self:      a #MafwProxyPlaylist
+ * @index:     visual index of the item to remove
+ * @callback:  function to call when the item has been removed
+ * @user_data: data to pass to @callback
+ *
+ * Asynchronous version of mafw_playlist_remove_item(), see
+ * mafw_proxy_playlist_insert_item_async().
+ */
+void mafw_proxy_playlist_remove_item_async(MafwProxyPlaylist *self,
+					   guint index,
+					   GAsyncReadyCallback callback,
+					   gpointer user_data)
+{
+	MafwProxyPlaylistPrivate *priv;
+	GSimpleAsyncResult *res;
+	GError *error = NULL;
+
+	g_return_if_fail(MAFW_IS_PROXY_PLAYLIST(self));
+	priv = self->priv;
+	res = g_simple_async_result_new(G_OBJECT(self), callback, user_data,
+					mafw_proxy_playlist_remove_item_async);
+	if (priv->embedded) {
+		g_simple_async_result_set_op_res_gboolean(res,
+				playlist_store_remove(self, index,
+						      &error));
+		async_done_in_idle(res, error);
+		return;
+	}
+
+	priv->size_valid = FALSE;
+	mirror_expect_change(priv);
+	playlist_call_async(self, res, parse_boolean, edit_applied,
+			    MAFW_PLAYLIST_METHOD_REMOVE_ITEM,
+			    DBUS_TYPE_UINT32, index);
+}
+
+/**
+ * mafw_proxy_playlist_remove_item_finish:
+ * @self:  a #MafwProxyPlaylist
+ * @res:   the #GAsyncResult passed to the callback
+ * @error: return location for a #GError, or %NULL
+ *
+ * Finishes mafw_proxy_playlist_remove_item_async().
+ *
+ * Returns: %TRUE if the item was removed.
+ */
+gboolean mafw_proxy_playlist_remove_item_finish(MafwProxyPlaylist *self,
+						GAsyncResult *res,
+						GError **error)
+{
+	return edit_finish(self, res, mafw_proxy_playlist_remove_item_async,
+			   error);
+}
+
+/**
+ * mafw_proxy_playlist_move_item_async:
+ * @self:      a #MafwProxyPlaylist
+ * @from:      visual index of the item to move
+ * @to:        visual index to move it to
+ * @callback:  function to call when the item has been moved
+ * @user_data: data to pass to @callback
+ *
+ * Asynchronous version of mafw_playlist_move_item(), see
+ * mafw_proxy_playlist_insert_item_async().
+ */
+void mafw_proxy_playlist_move_item_async(MafwProxyPlaylist *self,
+					 guint from, guint to,
+					 GAsyncReadyCallback callback,
+					 gpointer user_data)
+{
+	MafwProxyPlaylistPrivate *priv;
+	GSimpleAsyncResult *res;
+	GError *error = NULL;
+
+	g_return_if_fail(MAFW_IS_PROXY_PLAYLIST(self));
+	priv = self->priv;
+	res = g_simple_async_result_new(G_OBJECT(self), callback, user_data,
+					mafw_proxy_playlist_move_item_async);
+	if (priv->embedded) {
+		g_simple_async_result_set_op_res_gboolean(res,
+				playlist_store_move(self, from, to,
+						    &error));
+		async_done_in_idle(res, error);
+		return;
+	}
+
+	if (from != to)
+		mirror_expect_change(priv);
+	playlist_call_async(self, res, parse_boolean, edit_applied,
+			    MAFW_PLAYLIST_METHOD_MOVE,
+			    DBUS_TYPE_UINT32, from,
+			    DBUS_TYPE_UINT32, to);
+}
+
+/**
+ * mafw_proxy_playlist_move_item_finish:
+ * @self:  a #MafwProxyPlaylist
+ * @res:   the #GAsyncResult passed to the callback
+ * @error: return location for a #GError, or %NULL
+ *
+ * Finishes mafw_proxy_playlist_move_item_async().
+ *
+ * Returns: %TRUE if the item was moved.
+ */
+gboolean mafw_proxy_playlist_move_item_finish(MafwProxyPlaylist *self,
+					      GAsyncResult *res,
+					      GError **error)
+{
+	return edit_finish(self, res, mafw_proxy_playlist_move_item_async,
+			   error);
+}
+
+/**
+ * mafw_proxy_playlist_clear_async:
+ * @self:      a #MafwProxyPlaylist
+ * @callback:  function to call when the playlist has been cleared
+ * @user_data: data to pass to @callback
+ *
+ * Asynchronous version of mafw_playlist_clear(), see
+ * mafw_proxy_playlist_insert_item_async().
+ */
+void mafw_proxy_playlist_clear_async(MafwProxyPlaylist *self,
+				     GAsyncReadyCallback callback,
+				     gpointer user_data)
+{
+	MafwProxyPlaylistPrivate *priv;
+	GSimpleAsyncResult *res;
+	GError *error = NULL;
+
+	g_return_if_fail(MAFW_IS_PROXY_PLAYLIST(self));
+	priv = self->priv;
+	res = g_simple_async_result_new(G_OBJECT(self), callback, user_data,
+					mafw_proxy_playlist_clear_async);
+	if (priv->embedded) {
+		g_simple_async_result_set_op_res_gboolean(res,
+				playlist_store_clear(self, &error));
+		async_done_in_idle(res, error);
+		return;
+	}
+
+	priv->size_valid = FALSE;
+	mirror_expect_change(priv);
+	playlist_call_async(self, res, parse_done, edit_applied,
+			    MAFW_PLAYLIST_METHOD_CLEAR);
+}
+
+/**
+ * mafw_proxy_playlist_clear_finish:
+ * @self:  a #MafwProxyPlaylist
+ * @res:   the #GAsyncResult passed to the callback
+ * @error: return location for a #GError, or %NULL
+ *
+ * Finishes mafw_proxy_playlist_clear_async().
+ *
+ * Returns: %TRUE if the playlist was cleared.
+ */
+gboolean mafw_proxy_playlist_clear_finish(MafwProxyPlaylist *self,
+					  GAsyncResult *res,
+					  GError **error)
+{
+	return edit_finish(self, res, mafw_proxy_playlist_clear_async,
+			   error);
+}
+
+/* Starts shuffling or unshuffling $self for $tag. */
+static void shuffle_async(MafwProxyPlaylist *self, gboolean shuffle,
+			  gpointer tag, GAsyncReadyCallback callback,
+			  gpointer user_data)
+{
+	MafwProxyPlaylistPrivate *priv;
+	GSimpleAsyncResult *res;
+	GError *error = NULL;
+
+	priv = self->priv;
+	res = g_simple_async_result_new(G_OBJECT(self), callback, user_data,
+					tag);
+	if (priv->embedded) {
+		g_simple_async_result_set_op_res_gboolean(res,
+				playlist_store_shuffle(self, shuffle,
+						       &error));
+		async_done_in_idle(res, error);
+		return;
+	}
+
+	/* Only the playing order changes, the mirror is unaffected. */
+	priv->shuffled_valid = FALSE;
+	playlist_call_async(self, res, parse_done, NULL,
+			    shuffle ? MAFW_PLAYLIST_METHOD_SHUFFLE
+				    : MAFW_PLAYLIST_METHOD_UNSHUFFLE);
+}
+
+/**
+ * mafw_proxy_playlist_shuffle_async:
+ * @self:      a #MafwProxyPlaylist
+ * @callback:  function to call when the playlist has been shuffled
+ * @user_data: data to pass to @callback
+ *
+ * Asynchronous version of mafw_playlist_shuffle(), see
+ * mafw_proxy_playlist_insert_item_async().
+ */
+void mafw_proxy_playlist_shuffle_async(MafwProxyPlaylist *self,
+				       GAsyncReadyCallback callback,
+				       gpointer user_data)
+{
+	g_return_if_fail(MAFW_IS_PROXY_PLAYLIST(self));
+	shuffle_async(self, TRUE, mafw_proxy_playlist_shuffle_async,
+		      callback, user_data);
+}
+
+/**
+ * mafw_proxy_playlist_shuffle_finish:
+ * @self:  a #MafwProxyPlaylist
+ * @res:   the #GAsyncResult passed to the callback
+ * @error: return location for a #GError, or %NULL
+ *
+ * Finishes mafw_proxy_playlist_shuffle_async().
+ *
+ * Returns: %TRUE if the playlist was shuffled.
+ */
+gboolean mafw_proxy_playlist_shuffle_finish(MafwProxyPlaylist *self,
+					    GAsyncResult *res,
+					    GError **error)
+{
+	return edit_finish(self, res, mafw_proxy_playlist_shuffle_async,
+			   error);
+}
+
+/**
+ * mafw_proxy_playlist_unshuffle_async:
+ * @self:      a #MafwProxyPlaylist
+ * @callback:  function to call when the playlist has been unshuffled
+ * @user_data: data to pass to @callback
+ *
+ * Asynchronous version of mafw_playlist_unshuffle(), see
+ * mafw_proxy_playlist_insert_item_async().
+ */
+void mafw_proxy_playlist_unshuffle_async(MafwProxyPlaylist *self,
+					 GAsyncReadyCallback callback,
+					 gpointer user_data)
+{
+	g_return_if_fail(MAFW_IS_PROXY_PLAYLIST(self));
+	shuffle_async(self, FALSE, mafw_proxy_playlist_unshuffle_async,
+		      callback, user_data);
+}
+
+/**
+ * mafw_proxy_playlist_unshuffle_finish:
+ * @self:  a #MafwProxyPlaylist
+ * @res:   the #GAsyncResult passed to the callback
+ * @error: return location for a #GError, or %NULL
+ *
+ * Finishes mafw_proxy_playlist_unshuffle_async().
+ *
+ * Returns: %TRUE if the playlist was unshuffled.
+ */
+gboolean mafw_proxy_playlist_unshuffle_finish(MafwProxyPlaylist *self,
+					      GAsyncResult *res,
+					      GError **error)
+{
+	return edit_finish(self, res, mafw_proxy_playlist_unshuffle_async,
+			   error);
+}
+
+/**
+ * mafw_proxy_playlist_get_item_async:
+ * @self:      a #MafwProxyPlaylist
+ * @index:     visual index of the item
+ * @callback:  function to call with the item
+ * @user_data: data to pass to @callback
+ *
+ * Asynchronous version of mafw_playlist_get_item(), see
+ * mafw_proxy_playlist_insert_item_async().  The result reflects the edits
+ * started before.  It may come from the memory mapped mirror of the
+ * playlist, but then still in order with the others.
+ */
+void mafw_proxy_playlist_get_item_async(MafwProxyPlaylist *self,
+					guint index,
+					GAsyncReadyCallback callback,
+					gpointer user_data)
+{
+	MafwProxyPlaylistPrivate *priv;
+	GSimpleAsyncResult *res;
+	MafwMirrorState state;
+	GError *error = NULL;
+	gchar **oids;
+
+	g_return_if_fail(MAFW_IS_PROXY_PLAYLIST(self));
+	priv = self->priv;
+	res = g_simple_async_result_new(G_OBJECT(self), callback, user_data,
+					mafw_proxy_playlist_get_item_async);
+	if (priv->embedded) {
+		g_simple_async_result_set_op_res_gpointer(res,
+				playlist_store_get_item(self, index,
+							&error),
+				g_free);
+		async_done_in_idle(res, error);
+	} else if (mirror_peek(priv, index, 1, &state, &oids)) {
+		g_simple_async_result_set_op_res_gpointer(res, oids[0],
+							  g_free);
+		g_free(oids);
+		async_done_in_idle(res, NULL);
+	} else {
+		playlist_call_async(self, res, parse_item, NULL,
+				    MAFW_PLAYLIST_METHOD_GET_ITEM,
+				    DBUS_TYPE_UINT32, index);
+	}
+}
+
+/**
+ * mafw_proxy_playlist_get_item_finish:
+ * @self:  a #MafwProxyPlaylist
+ * @res:   the #GAsyncResult passed to the callback
+ * @error: return location for a #GError, or %NULL
+ *
+ * Finishes mafw_proxy_playlist_get_item_async().
+ *
+ * Returns: the object id of the item, to be g_free()d, or %NULL if there
+ * is no such item or on error.
+ */
+gchar *mafw_proxy_playlist_get_item_finish(MafwProxyPlaylist *self,
+					   GAsyncResult *res,
+					   GError **error)
+{
+	if (!async_finish(self, res, mafw_proxy_playlist_get_item_async,
+			  error))
+		return NULL;
+	return g_strdup(g_simple_async_result_get_op_res_gpointer(
+					G_SIMPLE_ASYNC_RESULT(res)));
+}
+
+/**
+ * mafw_proxy_playlist_get_items_async:
+ * @self:        a #MafwProxyPlaylist
+ * @first_index: visual index of the first item
+ * @last_index:  visual index of the last item
+ * @callback:    function to call with the items
+ * @user_data:   data to pass to @callback
+ *
+ * Asynchronous version of mafw_playlist_get_items(), see
+ * mafw_proxy_playlist_get_item_async().
+ */
+void mafw_proxy_playlist_get_items_async(MafwProxyPlaylist *self,
+					 guint first_index,
+					 guint last_index,
+					 GAsyncReadyCallback callback,
+					 gpointer user_data)
+{
+	MafwProxyPlaylistPrivate *priv;
+	GSimpleAsyncResult *res;
+	MafwMirrorState state;
+	GError *error = NULL;
+	gchar **oids;
+
+	g_return_if_fail(MAFW_IS_PROXY_PLAYLIST(self));
+	priv = self->priv;
+	res = g_simple_async_result_new(G_OBJECT(self), callback, user_data,
+					mafw_proxy_playlist_get_items_async);
+	if (priv->embedded) {
+		g_simple_async_result_set_op_res_gpointer(res,
+				playlist_store_get_items(self,
+							 first_index,
+							 last_index,
+							 &error),
+				(GDestroyNotify)g_strfreev);
+		async_done_in_idle(res, error);
+		return;
+	}
+
+	/* See mafw_proxy_playlist_get_items(). */
+	if (first_index <= last_index
+	    && mirror_peek(priv, first_index,
+			   last_index - first_index < G_MAXUINT
+			   ? last_index - first_index + 1 : G_MAXUINT,
+			   &state, &oids)) {
+		if (first_index < state.len) {
+			g_simple_async_result_set_op_res_gpointer(res, oids,
+					(GDestroyNotify)g_strfreev);
+			async_done_in_idle(res, NULL);
+			return;
+		}
+		g_strfreev(oids);
+	}
+
+	playlist_call_async(self, res, parse_items, NULL,
+			    MAFW_PLAYLIST_METHOD_GET_ITEMS,
+			    DBUS_TYPE_UINT32, first_index,
+			    DBUS_TYPE_UINT32, last_index);
+}
+
+/**
+ * mafw_proxy_playlist_get_items_finish:
+ * @self:  a #MafwProxyPlaylist
+ * @res:   the #GAsyncResult passed to the callback
+ * @error: return location for a #GError, or %NULL
+ *
+ * Finishes mafw_proxy_playlist_get_items_async().
+ *
+ * Returns: a %NULL-terminated array of the object ids, to be freed with
+ * g_strfreev(), or %NULL if there are no such items or on error.
+ */
+gchar **mafw_proxy_playlist_get_items_finish(MafwProxyPlaylist *self,
+					     GAsyncResult *res,
+					     GError **error)
+{
+	if (!async_finish(self, res, mafw_proxy_playlist_get_items_async,
+			  error))
+		return NULL;
+	return g_strdupv(g_simple_async_result_get_op_res_gpointer(
+					G_SIMPLE_ASYNC_RESULT(res)));
+}
+
+/**
+ * mafw_proxy_playlist_get_size_async:
+ * @self:      a #MafwProxyPlaylist
+ * @callback:  function to call with the size
+ * @user_data: data to pass to @callback
+ *
+ * Asynchronous version of mafw_playlist_get_size(), see
+ * mafw_proxy_playlist_get_item_async().
+ */
+void mafw_proxy_playlist_get_size_async(MafwProxyPlaylist *self,
+					GAsyncReadyCallback callback,
+					gpointer user_data)
+{
+	MafwProxyPlaylistPrivate *priv;
+	GSimpleAsyncResult *res;
+	MafwMirrorState state;
+	GError *error = NULL;
+
+	g_return_if_fail(MAFW_IS_PROXY_PLAYLIST(self));
+	priv = self->priv;
+	res = g_simple_async_result_new(G_OBJECT(self), callback, user_data,
+					mafw_proxy_playlist_get_size_async);
+	if (priv->embedded) {
+		g_simple_async_result_set_op_res_gssize(res,
+				playlist_store_get_size(self, &error));
+		async_done_in_idle(res, error);
+	} else if (priv->size_valid && !priv->pending_calls
+		   && cache_fresh(priv)) {
+		g_simple_async_result_set_op_res_gssize(res, priv->size);
+		async_done_in_idle(res, NULL);
+	} else if (mirror_peek(priv, 0, 0, &state, NULL)) {
+		g_simple_async_result_set_op_res_gssize(res, state.len);
+		async_done_in_idle(res, NULL);
+	} else {
+		playlist_call_async(self, res, parse_size, NULL,
+				    MAFW_PLAYLIST_METHOD_GET_SIZE);
+	}
+}
+
+/**
+ * mafw_proxy_playlist_get_size_finish:
+ * @self:  a #MafwProxyPlaylist
+ * @res:   the #GAsyncResult passed to the callback
+ * @error: return location for a #GError, or %NULL
+ *
+ * Finishes mafw_proxy_playlist_get_size_async().
+ *
+ * Returns: the number of items in the playlist, 0 on error.
+ */
+guint mafw_proxy_playlist_get_size_finish(MafwProxyPlaylist *self,
+					  GAsyncResult *res,
+					  GError **error)
+{
+	if (!async_finish(self, res, mafw_proxy_playlist_get_size_async,
+			  error))
+		return 0;
+	return g_simple_async_result_get_op_res_gssize(
+					G_SIMPLE_ASYNC_RESULT(res));
+}
+
+/**
+ * mafw_proxy_playlist_get_repeat_async:
+ * @self:      a #MafwProxyPlaylist
+ * @callback:  function to call with the repeat mode
+ * @user_data: data to pass to @callback
+ *
+ * Asynchronous version of mafw_playlist_get_repeat(), see
+ * mafw_proxy_playlist_get_item_async().
+ */
+void mafw_proxy_playlist_get_repeat_async(MafwProxyPlaylist *self,
+					  GAsyncReadyCallback callback,
+					  gpointer user_data)
+{
+	MafwProxyPlaylistPrivate *priv;
+	GSimpleAsyncResult *res;
+	GError *error = NULL;
+
+	g_return_if_fail(MAFW_IS_PROXY_PLAYLIST(self));
+	priv = self->priv;
+	res = g_simple_async_result_new(G_OBJECT(self), callback, user_data,
+					mafw_proxy_playlist_get_repeat_async);
+	if (priv->embedded) {
+		g_simple_async_result_set_op_res_gboolean(res,
+				playlist_store_get_repeat(self, &error));
+		async_done_in_idle(res, error);
+	} else if (priv->repeat_valid && !priv->pending_calls
+		   && cache_fresh(priv)) {
+		g_simple_async_result_set_op_res_gboolean(res, priv->repeat);
+		async_done_in_idle(res, NULL);
+	} else {
+		playlist_call_async(self, res, parse_boolean, NULL,
+				    MAFW_PLAYLIST_METHOD_GET_REPEAT);
+	}
+}
+
+/**
+ * mafw_proxy_playlist_get_repeat_finish:
+ * @self:  a #MafwProxyPlaylist
+ * @res:   the #GAsyncResult passed to the callback
+ * @error: return location for a #GError, or %NULL
+ *
+ * Finishes mafw_proxy_playlist_get_repeat_async().
+ *
+ * Returns: the repeat mode of the playlist, %FALSE on error.
+ */
+gboolean mafw_proxy_playlist_get_repeat_finish(MafwProxyPlaylist *self,
+					       GAsyncResult *res,
+					       GError **error)
+{
+	return async_finish(self, res, mafw_proxy_playlist_get_repeat_async,
+			    error)
+		&& g_simple_async_result_get_op_res_gboolean(
+					G_SIMPLE_ASYNC_RESULT(res));
+}
+
+/**
+ * mafw_proxy_playlist_is_shuffled_async:
+ * @self:      a #MafwProxyPlaylist
+ * @callback:  function to call with the shuffle state
+ * @user_data: data to pass to @callback
+ *
+ * Asynchronous version of mafw_playlist_is_shuffled(), see
+ * mafw_proxy_playlist_get_item_async().
+ */
+void mafw_proxy_playlist_is_shuffled_async(MafwProxyPlaylist *self,
+					   GAsyncReadyCallback callback,
+					   gpointer user_data)
+{
+	MafwProxyPlaylistPrivate *priv;
+	GSimpleAsyncResult *res;
+	GError *error = NULL;
+
+	g_return_if_fail(MAFW_IS_PROXY_PLAYLIST(self));
+	priv = self->priv;
+	res = g_simple_async_result_new(G_OBJECT(self), callback, user_data,
+					mafw_proxy_playlist_is_shuffled_async);
+	if (priv->embedded) {
+		g_simple_async_result_set_op_res_gboolean(res,
+				playlist_store_is_shuffled(self,
+							   &error));
+		async_done_in_idle(res, error);
+	} else if (priv->shuffled_valid && !priv->pending_calls
+		   && cache_fresh(priv)) {
+		g_simple_async_result_set_op_res_gboolean(res,
+							  priv->shuffled);
+		async_done_in_idle(res, NULL);
+	} else {
+		playlist_call_async(self, res, parse_boolean, NULL,
+				    MAFW_PLAYLIST_METHOD_IS_SHUFFLED);
+	}
+}
+
+/**
+ * mafw_proxy_playlist_is_shuffled_finish:
+ * @self:  a #MafwProxyPlaylist
+ * @res:   the #GAsyncResult passed to the callback
+ * @error: return location for a #GError, or %NULL
+ *
+ * Finishes mafw_proxy_playlist_is_shuffled_async().
+ *
+ * Returns: whether the playlist is shuffled, %FALSE on error.
+ */
+gboolean mafw_proxy_playlist_is_shuffled_finish(MafwProxyPlaylist *self,
+						GAsyncResult *res,
+						GError **error)
+{
+	return async_finish(self, res, mafw_proxy_playlist_is_shuffled_async,
+			    error)
+		&& g_simple_async_result_get_op_res_gboolean(
+					G_SIMPLE_ASYNC_RESULT(res));
+}
+
+static void parse_name(GSimpleAsyncResult *res, DBusMessage *reply)
+{
+	const gchar *name;
+
+	mafw_dbus_parse(reply, DBUS_TYPE_STRING, &name);
+	g_simple_async_result_set_op_res_gpointer(res, g_strdup(name),
+						  g_free);
+}
+
+/**
+ * mafw_proxy_playlist_get_name_async:
+ * @self:      a #MafwProxyPlaylist
+ * @callback:  function to call with the name
+ * @user_data: data to pass to @callback
+ *
+ * Asynchronous version of mafw_playlist_get_name(), see
+ * mafw_proxy_playlist_get_item_async().
+ */
+void mafw_proxy_playlist_get_name_async(MafwProxyPlaylist *self,
+					GAsyncReadyCallback callback,
+					gpointer user_data)
+{
+	MafwProxyPlaylistPrivate *priv;
+	GSimpleAsyncResult *res;
+	GError *error = NULL;
+
+	g_return_if_fail(MAFW_IS_PROXY_PLAYLIST(self));
+	priv = self->priv;
+	res = g_simple_async_result_new(G_OBJECT(self), callback, user_data,
+					mafw_proxy_playlist_get_name_async);
+	if (priv->embedded) {
+		g_simple_async_result_set_op_res_gpointer(res,
+				playlist_store_get_name(self, &error),
+				g_free);
+		async_done_in_idle(res, error);
+	} else {
+		playlist_call_async(self, res, parse_name, NULL,
+				    MAFW_PLAYLIST_METHOD_GET_NAME);
+	}
+}
+
+/**
+ * mafw_proxy_playlist_get_name_finish:
+ * @self:  a #MafwProxyPlaylist
+ * @res:   the #GAsyncResult passed to the callback
+ * @error: return location for a #GError, or %NULL
+ *
+ * Finishes mafw_proxy_playlist_get_name_async().
+ *
+ * Returns: the name of the playlist, to be g_free()d, or %NULL on error.
+ */
+gchar *mafw_proxy_playlist_get_name_finish(MafwProxyPlaylist *self,
+					   GAsyncResult *res,
+					   GError **error)
+{
+	if (!async_finish(self, res, mafw_proxy_playlist_get_name_async,
+			  error))
+		return NULL;
+	return g_strdup(g_simple_async_result_get_op_res_gpointer(
+					G_SIMPLE_ASYNC_RESULT(res)));
+}
+
+/* The item found by a navigation call, see navigate_async(). */
+typedef struct {
+	guint index;
+	gchar *oid;
+} Position;
+
+static void position_free(Position *pos)
+{
+	g_free(pos->oid);
+	g_free(pos);
+}
+
+/* Stores the position in the @reply of a navigation call, or nothing
+ * if there is no such item. */
+static void parse_position(GSimpleAsyncResult *res, DBusMessage *reply)
+{
+	Position *pos;
+	const gchar *oid;
+	guint index;
+
+	mafw_dbus_parse(reply, DBUS_TYPE_UINT32, &index,
+			DBUS_TYPE_STRING, &oid);
+	if (!*oid)
+		return;
+	pos = g_new(Position, 1);
+	pos->index = index;
+	pos->oid = g_strdup(oid);
+	g_simple_async_result_set_op_res_gpointer(res, pos,
+						  (GDestroyNotify)position_free);
+}
+
+/* Starts the navigation $method of the playlist, from $index if
+ * $from_index, for $tag. */
+static void navigate_async(MafwProxyPlaylist *self, const gchar *method,
+			   gboolean from_index, guint index, gpointer tag,
+			   GAsyncReadyCallback callback, gpointer user_data)
+{
+	MafwProxyPlaylistPrivate *priv;
+	GSimpleAsyncResult *res;
+	GError *error = NULL;
+	Position *pos;
+
+	priv = self->priv;
+	res = g_simple_async_result_new(G_OBJECT(self), callback, user_data,
+					tag);
+	if (priv->embedded) {
+		pos = g_new0(Position, 1);
+		pos->index = index;
+		if (playlist_store_navigate(self, method, &pos->index,
+					    &pos->oid, &error))
+			g_simple_async_result_set_op_res_gpointer(res, pos,
+					(GDestroyNotify)position_free);
+		else
+			position_free(pos);
+		async_done_in_idle(res, error);
+	} else if (from_index) {
+		playlist_call_async(self, res, parse_position, NULL,
+				    method, MAFW_DBUS_UINT32(index));
+	} else {
+		playlist_call_async(self, res, parse_position, NULL,
+				    method);
+	}
+}
+
+/* Returns whether navigation $res of $tag found an item, and stores it
+ * in $index and $oid if they're not NULL. */
+static gboolean navigate_finish(MafwProxyPlaylist *self, GAsyncResult *res,
+				gpointer tag, guint *index, gchar **oid,
+				GError **error)
+{
+	Position *pos;
+
+	if (!async_finish(self, res, tag, error))
+		return FALSE;
+	pos = g_simple_async_result_get_op_res_gpointer(
+					G_SIMPLE_ASYNC_RESULT(res));
+	if (!pos)
+		return FALSE;
+	if (index)
+		*index = pos->index;
+	if (oid)
+		*oid = g_strdup(pos->oid);
+	return TRUE;
+}
+
+/**
+ * mafw_proxy_playlist_get_next_async:
+ * @self:      a #MafwProxyPlaylist
+ * @index:     visual index of the current item
+ * @callback:  function to call with the next item
+ * @user_data: data to pass to @callback
+ *
+ * Asynchronous version of mafw_playlist_get_next(), see
+ * mafw_proxy_playlist_insert_item_async().  Renderers can use it to find
+ * the next track at the end of the current one without blocking the
+ * main loop.
+ */
+void mafw_proxy_playlist_get_next_async(MafwProxyPlaylist *self,
+					guint index,
+					GAsyncReadyCallback callback,
+					gpointer user_data)
+{
+	g_return_if_fail(MAFW_IS_PROXY_PLAYLIST(self));
+	navigate_async(self, MAFW_PLAYLIST_METHOD_GET_NEXT, TRUE, index,
+		       mafw_proxy_playlist_get_next_async,
+		       callback, user_data);
+}
+
+/**
+ * mafw_proxy_playlist_get_next_finish:
+ * @self:  a #MafwProxyPlaylist
+ * @res:   the #GAsyncResult passed to the callback
+ * @index: if not %NULL, set to the visual index of the next item
+ * @oid:   if not %NULL, set to the object id of the next item, to be
+ *         g_free()d
+ * @error: return location for a #GError, or %NULL
+ *
+ * Finishes mafw_proxy_playlist_get_next_async().
+ *
+ * Returns: %TRUE if there is a next item.
+ */
+gboolean mafw_proxy_playlist_get_next_finish(MafwProxyPlaylist *self,
+					     GAsyncResult *res,
+					     guint *index, gchar **oid,
+					     GError **error)
+{
+	return navigate_finish(self, res, mafw_proxy_playlist_get_next_async,
+			       index, oid, error);
+}
+
+/**
+ * mafw_proxy_playlist_get_prev_async:
+ * @self:      a #MafwProxyPlaylist
+ * @index:     visual index of the current item
+ * @callback:  function to call with the previous item
+ * @user_data: data to pass to @callback
+ *
+ * Asynchronous version of mafw_playlist_get_prev(), see
+ * mafw_proxy_playlist_get_next_async().
+ */
+void mafw_proxy_playlist_get_prev_async(MafwProxyPlaylist *self,
+					guint index,
+					GAsyncReadyCallback callback,
+					gpointer user_data)
+{
+	g_return_if_fail(MAFW_IS_PROXY_PLAYLIST(self));
+	navigate_async(self, MAFW_PLAYLIST_METHOD_GET_PREV, TRUE, index,
+		       mafw_proxy_playlist_get_prev_async,
+		       callback, user_data);
+}
+
+/**
+ * mafw_proxy_playlist_get_prev_finish:
+ * @self:  a #MafwProxyPlaylist
+ * @res:   the #GAsyncResult passed to the callback
+ * @index: if not %NULL, set to the visual index of the previous item
+ * @oid:   if not %NULL, set to the object id of the previous item, to be
+ *         g_free()d
+ * @error: return location for a #GError, or %NULL
+ *
+ * Finishes mafw_proxy_playlist_get_prev_async().
+ *
+ * Returns: %TRUE if there is a previous item.
+ */
+gboolean mafw_proxy_playlist_get_prev_finish(MafwProxyPlaylist *self,
+					     GAsyncResult *res,
+					     guint *index, gchar **oid,
+					     GError **error)
+{
+	return navigate_finish(self, res, mafw_proxy_playlist_get_prev_async,
+			       index, oid, error);
+}
+
+/**
+ * mafw_proxy_playlist_get_starting_index_async:
+ * @self:      a #MafwProxyPlaylist
+ * @callback:  function to call with the first item
+ * @user_data: data to pass to @callback
+ *
+ * Asynchronous version of mafw_playlist_get_starting_index(), see
+ * mafw_proxy_playlist_get_next_async().
+ */
+void mafw_proxy_playlist_get_starting_index_async(MafwProxyPlaylist *self,
+						  GAsyncReadyCallback callback,
+						  gpointer user_data)
+{
+	g_return_if_fail(MAFW_IS_PROXY_PLAYLIST(self));
+	navigate_async(self, MAFW_PLAYLIST_METHOD_GET_STARTING_INDEX,
+		       FALSE, 0,
+		       mafw_proxy_playlist_get_starting_index_async,
+		       callback, user_data);
+}
+
+/**
+ * mafw_proxy_playlist_get_starting_index_finish:
+ * @self:  a #MafwProxyPlaylist
+ * @res:   the #GAsyncResult passed to the callback
+ * @index: if not %NULL, set to the visual index of the first item to play
+ * @oid:   if not %NULL, set to its object id, to be g_free()d
+ * @error: return location for a #GError, or %NULL
+ *
+ * Finishes mafw_proxy_playlist_get_starting_index_async().
+ *
+ * Returns: %TRUE unless the playlist is empty or on error.
+ */
+gboolean mafw_proxy_playlist_get_starting_index_finish(
+					MafwProxyPlaylist *self,
+					GAsyncResult *res,
+					guint *index, gchar **oid,
+					GError **error)
+{
+	return navigate_finish(self, res,
+			       mafw_proxy_playlist_get_starting_index_async,
+			       index, oid, error);
+}
+
+/**
+ * mafw_proxy_playlist_get_last_index_async:
+ * @self:      a #MafwProxyPlaylist
+ * @callback:  function to call with the last item
+ * @user_data: data to pass to @callback
+ *
+ * Asynchronous version of mafw_playlist_get_last_index(), see
+ * mafw_proxy_playlist_get_next_async().
+ */
+void mafw_proxy_playlist_get_last_index_async(MafwProxyPlaylist *self,
+					      GAsyncReadyCallback callback,
+					      gpointer user_data)
+{
+	g_return_if_fail(MAFW_IS_PROXY_PLAYLIST(self));
+	navigate_async(self, MAFW_PLAYLIST_METHOD_GET_LAST_INDEX,
+		       FALSE, 0, mafw_proxy_playlist_get_last_index_async,
+		       callback, user_data);
+}
+
+/**
+ * mafw_proxy_playlist_get_last_index_finish:
+ * @self:  a #MafwProxyPlaylist
+ * @res:   the #GAsyncResult passed to the callback
+ * @index: if not %NULL, set to the visual index of the last item to play
+ * @oid:   if not %NULL, set to its object id, to be g_free()d
+ * @error: return location for a #GError, or %NULL
+ *
+ * Finishes mafw_proxy_playlist_get_last_index_async().
+ *
+ * Returns: %TRUE unless the playlist is empty or on error.
+ */
+gboolean mafw_proxy_playlist_get_last_index_finish(MafwProxyPlaylist *self,
+						   GAsyncResult *res,
+						   guint *index, gchar **oid,
+						   GError **error)
+{
+	return navigate_finish(self, res,
+			       mafw_proxy_playlist_get_last_index_async,
+			       index, oid, error);
+}
+
+/* Starts changing the use count of the playlist by $delta for $tag. */
+static void use_count_async(MafwProxyPlaylist *self, gint delta,
+			    gpointer tag, GAsyncReadyCallback callback,
+			    gpointer user_data)
+{
+	GSimpleAsyncResult *res;
+	GError *error = NULL;
+
+	res = g_simple_async_result_new(G_OBJECT(self), callback, user_data,
+					tag);
+	if (self->priv->embedded) {
+		g_simple_async_result_set_op_res_gboolean(res,
+				playlist_store_use_count(self, delta,
+							 &error));
+		async_done_in_idle(res, error);
+		return;
+	}
+
+	playlist_call_async(self, res, parse_done, NULL,
+			    delta > 0
+			    ? MAFW_PLAYLIST_METHOD_INCREMENT_USE_COUNT
+			    : MAFW_PLAYLIST_METHOD_DECREMENT_USE_COUNT);
+}
+
+/**
+ * mafw_proxy_playlist_increment_use_count_async:
+ * @self:      a #MafwProxyPlaylist
+ * @callback:  function to call when the use count has been incremented
+ * @user_data: data to pass to @callback
+ *
+ * Asynchronous version of mafw_playlist_increment_use_count(), see
+ * mafw_proxy_playlist_insert_item_async().
+ */
+void mafw_proxy_playlist_increment_use_count_async(MafwProxyPlaylist *self,
+						   GAsyncReadyCallback callback,
+						   gpointer user_data)
+{
+	g_return_if_fail(MAFW_IS_PROXY_PLAYLIST(self));
+	use_count_async(self, 1,
+			mafw_proxy_playlist_increment_use_count_async,
+			callback, user_data);
+}
+
+/**
+ * mafw_proxy_playlist_increment_use_count_finish:
+ * @self:  a #MafwProxyPlaylist
+ * @res:   the #GAsyncResult passed to the callback
+ * @error: return location for a #GError, or %NULL
+ *
+ * Finishes mafw_proxy_playlist_increment_use_count_async().
+ *
+ * Returns: %TRUE if the use count was incremented.
+ */
+gboolean mafw_proxy_playlist_increment_use_count_finish(
+					MafwProxyPlaylist *self,
+					GAsyncResult *res,
+					GError **error)
+{
+	return edit_finish(self, res,
+			   mafw_proxy_playlist_increment_use_count_async,
+			   error);
+}
+
+/**
+ * mafw_proxy_playlist_decrement_use_count_async:
+ * @self:      a #MafwProxyPlaylist
+ * @callback:  function to call when the use count has been decremented
+ * @user_data: data to pass to @callback
+ *
+ * Asynchronous version of mafw_playlist_decrement_use_count(), see
+ * mafw_proxy_playlist_insert_item_async().
+ */
+void mafw_proxy_playlist_decrement_use_count_async(MafwProxyPlaylist *self,
+						   GAsyncReadyCallback callback,
+						   gpointer user_data)
+{
+	g_return_if_fail(MAFW_IS_PROXY_PLAYLIST(self));
+	use_count_async(self, -1,
+			mafw_proxy_playlist_decrement_use_count_async,
+			callback, user_data);
+}
+
+/**
+ * mafw_proxy_playlist_decrement_use_count_finish:
+ * @self:  a #MafwProxyPlaylist
+ * @res:   the #GAsyncResult passed to the callback
+ * @error: return location for a #GError, or %NULL
+ *
+ * Finishes mafw_proxy_playlist_decrement_use_count_async().
+ *
+ * Returns: %TRUE if the use count was decremented.
+ */
+gboolean mafw_proxy_playlist_decrement_use_count_finish(
+					MafwProxyPlaylist *self,
+					GAsyncResult *res,
+					GError **error)
+{
+	return edit_finish(self, res,
+			   mafw_proxy_playlist_decrement_use_count_async,
+			   error);
+}
+
+/* The result of mafw_proxy_playlist_get_next_n_async(). */
+typedef struct {
+	gchar **oids;
+	guint *indices;
+} LookAhead;
+
+static void look_ahead_free(LookAhead *ahead)
+{
+	g_strfreev(ahead->oids);
+	g_free(ahead->indices);
+	g_free(ahead);
+}
+
+static void parse_look_ahead(GSimpleAsyncResult *res, DBusMessage *reply)
+{
+	LookAhead *ahead;
+
+	ahead = g_new0(LookAhead, 1);
+	ahead->oids = next_n_reply(reply, &ahead->indices);
+	g_simple_async_result_set_op_res_gpointer(res, ahead,
+					(GDestroyNotify)look_ahead_free);
+}
+
+/**
+ * mafw_proxy_playlist_get_next_n_async:
+ * @self:      a #MafwProxyPlaylist
+ * @index:     visual index of the current item
+ * @n:         number of items to look ahead
+ * @callback:  function to call with the items
+ * @user_data: data to pass to @callback
+ *
+ * Asynchronous version of mafw_proxy_playlist_get_next_n(), for renderers
+ * to prebuffer at track boundaries without blocking, see
+ * mafw_proxy_playlist_get_next_async().
+ */
+void mafw_proxy_playlist_get_next_n_async(MafwProxyPlaylist *self,
+					  guint index, guint n,
+					  GAsyncReadyCallback callback,
+					  gpointer user_data)
+{
+	GSimpleAsyncResult *res;
+	GError *error = NULL;
+	LookAhead *ahead;
+
+	g_return_if_fail(MAFW_IS_PROXY_PLAYLIST(self));
+	res = g_simple_async_result_new(G_OBJECT(self), callback, user_data,
+					mafw_proxy_playlist_get_next_n_async);
+	if (self->priv->embedded) {
+		ahead = g_new0(LookAhead, 1);
+		ahead->oids = playlist_store_get_next_n(self, index, n,
+							&ahead->indices,
+							&error);
+		if (ahead->oids)
+			g_simple_async_result_set_op_res_gpointer(res, ahead,
+					(GDestroyNotify)look_ahead_free);
+		else
+			look_ahead_free(ahead);
+		async_done_in_idle(res, error);
+		return;
+	}
+
+	playlist_call_async(self, res, parse_look_ahead, NULL,
+			    MAFW_PLAYLIST_METHOD_GET_NEXT_N,
+			    MAFW_DBUS_UINT32(index),
+			    MAFW_DBUS_UINT32(n));
+}
+
+/**
+ * mafw_proxy_playlist_get_next_n_finish:
+ * @self:    a #MafwProxyPlaylist
+ * @res:     the #GAsyncResult passed to the callback
+ * @indices: if not %NULL, set to a newly allocated array of the visual
+ *           indices of the returned items
+ * @error:   return location for a #GError, or %NULL
+ *
+ * Finishes mafw_proxy_playlist_get_next_n_async().
+ *
+ * Returns: a %NULL-terminated array of object ids, possibly empty, to be
+ * freed with g_strfreev(), or %NULL in case of error.
+ */
+gchar **mafw_proxy_playlist_get_next_n_finish(MafwProxyPlaylist *self,
+					      GAsyncResult *res,
+					      guint **indices,
+					      GError **error)
+{
+	LookAhead *ahead;
+
+	if (!async_finish(self, res, mafw_proxy_playlist_get_next_n_async,
+			  error))
+		return NULL;
+	ahead = g_simple_async_result_get_op_res_gpointer(
+					G_SIMPLE_ASYNC_RESULT(res));
+	if (indices) {
+		*indices = g_new(guint, g_strv_length(ahead->oids));
+		memcpy(*indices, ahead->indices,
+		       g_strv_length(ahead->oids) * sizeof(**indices));
+	}
+	return g_strdupv(ahead->oids);
+}
+
+static void parse_batch(GSimpleAsyncResult *res, DBusMessage *reply)
+{
+	g_simple_async_result_set_op_res_gpointer(res, batch_reply(reply),
+					(GDestroyNotify)g_array_unref);
+}
+
+/* The daemon applies a batch entirely or not at all. */
+static gboolean batch_applied(GSimpleAsyncResult *res)
+{
+	GArray *valid;
+	guint i;
+
+	valid = g_simple_async_result_get_op_res_gpointer(res);
+	for (i = 0; i < valid->len; i++)
+		if (!g_array_index(valid, gboolean, i))
+			return FALSE;
+	return TRUE;
+}
+
+/**
+ * mafw_proxy_playlist_apply_batch_async:
+ * @self:      a #MafwProxyPlaylist
+ * @batch:     the operations to apply, which may be freed after the call
+ * @callback:  function to call when the operations have been applied
+ * @user_data: data to pass to @callback
+ *
+ * Asynchronous version of mafw_proxy_playlist_apply_batch(), see
+ * mafw_proxy_playlist_insert_item_async().
+ */
+void mafw_proxy_playlist_apply_batch_async(MafwProxyPlaylist *self,
+					   MafwProxyPlaylistBatch *batch,
+					   GAsyncReadyCallback callback,
+					   gpointer user_data)
+{
+	GSimpleAsyncResult *res;
+	AsyncAppliedFunc applied;
+	GError *error = NULL;
+	GArray *valid;
+
+	g_return_if_fail(MAFW_IS_PROXY_PLAYLIST(self));
+	g_return_if_fail(batch != NULL);
+	res = g_simple_async_result_new(G_OBJECT(self), callback, user_data,
+					mafw_proxy_playlist_apply_batch_async);
+	if (self->priv->embedded) {
+		valid = batch_apply_embedded(self, batch, &error);
+		if (valid)
+			g_simple_async_result_set_op_res_gpointer(res, valid,
+					(GDestroyNotify)g_array_unref);
+		async_done_in_idle(res, error);
+		return;
+	}
+
+	/* Batches only changing the playing order are no edits of the
+	 * items, like mafw_proxy_playlist_shuffle_async(). */
+	applied = batch_expect_change(self, batch) ? batch_applied : NULL;
+	async_call(self, self->priv->connection, batch_message(self, batch),
+		   res, parse_batch, applied);
+}
+
+/**
+ * mafw_proxy_playlist_apply_batch_finish:
+ * @self:    a #MafwProxyPlaylist
+ * @res:     the #GAsyncResult passed to the callback
+ * @results: if not %NULL, set to a newly allocated #GArray of #gboolean,
+ *           telling the validity of each operation
+ * @error:   return location for a #GError, or %NULL
+ *
+ * Finishes mafw_proxy_playlist_apply_batch_async().
+ *
+ * Returns: %TRUE if the operations were applied.
+ */
+gboolean mafw_proxy_playlist_apply_batch_finish(MafwProxyPlaylist *self,
+						GAsyncResult *res,
+						GArray **results,
+						GError **error)
+{
+	GArray *valid, *copy;
+
+	if (!async_finish(self, res, mafw_proxy_playlist_apply_batch_async,
+			  error))
+		return FALSE;
+	valid = g_simple_async_result_get_op_res_gpointer(
+					G_SIMPLE_ASYNC_RESULT(res));
+	copy = g_array_sized_new(FALSE, FALSE, sizeof(gboolean), valid->len);
+	g_array_append_vals(copy, valid->data, valid->len);
+	return batch_results(copy, results, error);
+}
+
+/*---------------------------------------------------------------------------
+  Paged item retrieval
+  ---------------------------------------------------------------------------*/
+
+struct _MafwProxyPlaylistItemsIter {
+	MafwProxyPlaylist *playlist;
+	/* The outstanding get_items_paged call, NULL while in the callback. */
+	DBusPendingCall *pending;
+	/* Cursor: generation of the playlist the pages belong to (0 until
+	 * the first page arrives) and the index of the next page. */
+	guint generation;
+	guint next;
+	guint max_items;
+	guint max_bytes;
+	MafwProxyPlaylistItemsCb callback;
+	gpointer user_data;
+	/* Set when cancelled from the callback. */
+	gboolean cancelled;
+};
+
+static void items_iter_free(MafwProxyPlaylistItemsIter *iter)
+{
+	g_object_unref(iter->playlist);
+	g_free(iter);
+}
+
+static void items_iter_page_cb(DBusPendingCall *pending, gpointer udata);
+
+/* Requests the page at the cursor of $iter. */
+static void items_iter_request(MafwProxyPlaylistItemsIter *iter)
+{
+	MafwProxyPlaylistPrivate *priv;
+
+	priv = MAFW_PROXY_PLAYLIST_GET_PRIVATE(iter->playlist);
+	mafw_dbus_send_async(priv->connection, &iter->pending,
+			     mafw_dbus_method_full(
+				     MAFW_DBUS_DESTINATION,
+				     priv->obj_path,
+				     MAFW_DBUS_INTERFACE,
+				     MAFW_PLAYLIST_METHOD_GET_ITEMS_PAGED,
+				     MAFW_DBUS_UINT32(iter->generation),
+				     MAFW_DBUS_UINT32(iter->next),
+				     MAFW_DBUS_UINT32(iter->max_items),
+				     MAFW_DBUS_UINT32(iter->max_bytes)));
+	dbus_pending_call_set_notify(iter->pending, items_iter_page_cb,
+				     iter, NULL);
+}
+
+static void items_iter_page_cb(DBusPendingCall *pending, gpointer udata)
+{
+	MafwProxyPlaylistItemsIter *iter;
+	DBusMessage *reply;
+	GError *error;
+	gchar **oids;
+	guint first, generation, next;
+	gboolean more;
+
+	iter = udata;
+	g_assert(iter->pending == pending);
+	reply = dbus_pending_call_steal_reply(pending);
+	dbus_pending_call_unref(pending);
+	iter->pending = NULL;
+
+	first = iter->next;
+	error = mafw_dbus_is_error(reply, MAFW_PLAYLIST_ERROR);
+	if (error) {
+		iter->callback(iter->playlist, first, NULL, TRUE,
+			       iter->user_data, error);
+		g_error_free(error);
+		dbus_message_unref(reply);
+		items_iter_free(iter);
+		return;
+	}
+
+	mafw_dbus_parse(reply,
+			DBUS_TYPE_UINT32, &generation,
+			DBUS_TYPE_UINT32, &next,
+			MAFW_DBUS_TYPE_STRVZ, &oids);
+	dbus_message_unref(reply);
+	iter->generation = generation;
+	iter->next = next;
+
+	more = iter->callback(iter->playlist, first, oids,
+			      next == MAFW_PLAYLIST_ITEMS_END,
+			      iter->user_data, NULL);
+	g_strfreev(oids);
+
+	if (more && !iter->cancelled && next != MAFW_PLAYLIST_ITEMS_END)
+		items_iter_request(iter);
+	else
+		items_iter_free(iter);
+}
+
+/**
+ * mafw_proxy_playlist_iter_items:
+ * @self:        a #MafwProxyPlaylist
+ * @first_index: visual index to start from
+ * @max_items:   maximum number of items per page, 0 for no limit
+ * @max_bytes:   maximum size of the object ids of a page in bytes, 0 for
+ *               the default of the playlist daemon
+ * @callback:    function to call with each page
+ * @user_data:   data to pass to @callback
+ *
+ * Retrieves the items of the playlist from @first_index onwards
+ * asynchronously, in pages of limited size, so that huge playlists can be
+ * fetched without building huge messages or blocking the playlist daemon.
+ * The next page is only requested after @callback has returned %TRUE.
+ *
+ * All pages are guaranteed to belong to the same version of the playlist:
+ * if it is modified during the iteration, @callback receives a
+ * %MAFW_PLAYLIST_ERROR_INVALID_INDEX error and the iteration stops.
+ *
+ * Returns: a handle to cancel the iteration with, valid until @callback
+ * stops it, or %NULL with the in-process playlist store, which doesn't
+ * support it.
+ */
+MafwProxyPlaylistItemsIter *mafw_proxy_playlist_iter_items(
+					MafwProxyPlaylist *self,
+					guint first_index,
+					guint max_items,
+					guint max_bytes,
+					MafwProxyPlaylistItemsCb callback,
+					gpointer user_data)
+{
+	MafwProxyPlaylistItemsIter *iter;
+
+	g_return_val_if_fail(MAFW_IS_PROXY_PLAYLIST(self), NULL);
+	g_return_val_if_fail(callback != NULL, NULL);
+	if (self->priv->embedded)
+		return NULL;
+	g_return_val_if_fail(MAFW_PROXY_PLAYLIST_GET_PRIVATE(self)->connection
+			     != NULL, NULL);
+
+	iter = g_new0(MafwProxyPlaylistItemsIter, 1);
+	iter->playlist = g_object_ref(self);
+	iter->next = first_index;
+	iter->max_items = max_items;
+	iter->max_bytes = max_bytes;
+	iter->callback = callback;
+	iter->user_data = user_data;
+	items_iter_request(iter);
+	return iter;
+}
+
+/**
+ * mafw_proxy_playlist_iter_items_cancel:
+ * @iter: the iteration to cancel
+ *
+ * Stops an iteration started by mafw_proxy_playlist_iter_items().  The
+ * callback will not be called anymore.  It can be called from the callback
+ * as well, but it has the same effect as returning %FALSE there.
+ */
+void mafw_proxy_playlist_iter_items_cancel(MafwProxyPlaylistItemsIter *iter)
+{
+	g_return_if_fail(iter != NULL);
+
+	if (!iter->pending) {
+		/* We're in the callback, leave it to items_iter_page_cb(). */
+		iter->cancelled = TRUE;
+		return;
+	}
+	dbus_pending_call_cancel(iter->pending);
+	dbus_pending_call_unref(iter->pending);
+	items_iter_free(iter);
+}
+
+/**
+ * mafw_proxy_playlist_iter_items_get_generation:
+ * @iter: an ongoing mafw_proxy_playlist_iter_items()
+ *
+ * Tells which generation of the playlist the pages delivered so far
+ * belong to.  Call it from the callback; the items of all pages are a
+ * consistent copy of that generation, which can be kept up to date with
+ * mafw_proxy_playlist_sync_since().
+ *
+ * Returns: the generation, or 0 before the first page.
+ */
+guint mafw_proxy_playlist_iter_items_get_generation(
+					MafwProxyPlaylistItemsIter *iter)
+{
+	g_return_val_if_fail(iter != NULL, 0);
+	return iter->generation;
+}
+
+/*---------------------------------------------------------------------------
+  Window subscription
+  ---------------------------------------------------------------------------*/
+
+/**
+ * mafw_proxy_playlist_set_window:
+ * @self:  a #MafwProxyPlaylist
+ * @first: visual index of the first item of the window
+ * @count: number of items in the window, 0 to unsubscribe
+ * @error: return location for a #GError, or %NULL
+ *
+ * Subscribes to the changes of the items between @first and
+ * @first + @count, like the rows a view shows of a long playlist.  Such
+ * changes are then reported by the #MafwProxyPlaylist::window-changed and
+ * #MafwProxyPlaylist::window-shifted signals, which the daemon sends to
+ * this process only, instead of the view having to refetch its rows on
+ * every #MafwPlaylist::contents-changed.  The window replaces any previous
+ * one of @self.
+ *
+ * Returns: a %NULL-terminated array of the current items of the window,
+ * fewer than @count if the playlist ends earlier, or %NULL on error.  Free
+ * it with g_strfreev().
+ */
+gchar **mafw_proxy_playlist_set_window(MafwProxyPlaylist *self,
+				       guint first, guint count,
+				       GError **error)
+{
+	DBusMessage *reply;
+	gchar **oids;
+
+	g_return_val_if_fail(MAFW_IS_PROXY_PLAYLIST(self), NULL);
+	if (daemon_only(self, error))
+		return NULL;
+
+	reply = mafw_dbus_call(self->priv->connection,
+			       mafw_dbus_method_full(
+				       MAFW_DBUS_DESTINATION,
+				       self->priv->obj_path,
+				       MAFW_DBUS_INTERFACE,
+				       MAFW_PLAYLIST_METHOD_SET_WINDOW,
+				       MAFW_DBUS_UINT32(first),
+				       MAFW_DBUS_UINT32(count)),
+			       MAFW_PLAYLIST_ERROR, error);
+	if (!reply)
+		return NULL;
+	mafw_dbus_parse(reply, MAFW_DBUS_TYPE_STRVZ, &oids);
+	dbus_message_unref(reply);
+	if (!oids)
+		oids = g_new0(gchar *, 1);
+	return oids;
+}
+
+static void parse_window(GSimpleAsyncResult *res, DBusMessage *reply)
+{
+	gchar **oids;
+
+	mafw_dbus_parse(reply, MAFW_DBUS_TYPE_STRVZ, &oids);
+	if (!oids)
+		oids = g_new0(gchar *, 1);
+	g_simple_async_result_set_op_res_gpointer(res, oids,
+						  (GDestroyNotify)g_strfreev);
+}
+
+/**
+ * mafw_proxy_playlist_set_window_async:
+ * @self:      a #MafwProxyPlaylist
+ * @first:     visual index of the first item of the window
+ * @count:     number of items in the window, 0 to unsubscribe
+ * @callback:  function to call with the items of the window
+ * @user_data: data to pass to @callback
+ *
+ * Asynchronous version of mafw_proxy_playlist_set_window(), see
+ * mafw_proxy_playlist_insert_item_async().
+ */
+void mafw_proxy_playlist_set_window_async(MafwProxyPlaylist *self,
+					  guint first, guint count,
+					  GAsyncReadyCallback callback,
+					  gpointer user_data)
+{
+	GSimpleAsyncResult *res;
+	GError *error = NULL;
+
+	g_return_if_fail(MAFW_IS_PROXY_PLAYLIST(self));
+	res = g_simple_async_result_new(G_OBJECT(self), callback, user_data,
+					mafw_proxy_playlist_set_window_async);
+	if (daemon_only(self, &error)) {
+		async_done_in_idle(res, error);
+		return;
+	}
+
+	playlist_call_async(self, res, parse_window, NULL,
+			    MAFW_PLAYLIST_METHOD_SET_WINDOW,
+			    MAFW_DBUS_UINT32(first),
+			    MAFW_DBUS_UINT32(count));
+}
+
+/**
+ * mafw_proxy_playlist_set_window_finish:
+ * @self:  a #MafwProxyPlaylist
+ * @res:   the #GAsyncResult passed to the callback
+ * @error: return location for a #GError, or %NULL
+ *
+ * Finishes mafw_proxy_playlist_set_window_async().
+ *
+ * Returns: a %NULL-terminated array of the current items of the window,
+ * or %NULL on error.  Free it with g_strfreev().
+ */
+gchar **mafw_proxy_playlist_set_window_finish(MafwProxyPlaylist *self,
+					      GAsyncResult *res,
+					      GError **error)
+{
+	if (!async_finish(self, res, mafw_proxy_playlist_set_window_async,
+			  error))
+		return NULL;
+	return g_strdupv(g_simple_async_result_get_op_res_gpointer(
+					G_SIMPLE_ASYNC_RESULT(res)));
+}
+
+/*---------------------------------------------------------------------------
+  Cached metadata
+  ---------------------------------------------------------------------------*/
+
+static void metadata_free(GHashTable *md)
+{
+	if (md)
+		mafw_metadata_release(md);
+}
+
+/* A GET_ITEMS_WITH_METADATA reply. */
+typedef struct {
+	gchar **oids;
+	GPtrArray *mds;
+	guint64 duration;
+	guint unknown;
+} ItemsMetadata;
+
+static void items_metadata_free(ItemsMetadata *items)
+{
+	g_strfreev(items->oids);
+	g_ptr_array_free(items->mds, TRUE);
+	g_free(items);
+}
+
+/* Parses the GET_ITEMS_WITH_METADATA $reply. */
+static ItemsMetadata *items_metadata_reply(DBusMessage *reply)
+{
+	DBusMessageIter imsg, iary;
+	ItemsMetadata *items;
+	dbus_uint64_t dur;
+	dbus_uint32_t unk;
+
+	items = g_new0(ItemsMetadata, 1);
+	mafw_dbus_parse(reply, MAFW_DBUS_TYPE_STRVZ, &items->oids);
+	if (!items->oids)
+		items->oids = g_new0(gchar *, 1);
+	items->mds = g_ptr_array_new_with_free_func(
+					(GDestroyNotify)metadata_free);
+	dbus_message_iter_init(reply, &imsg);
+	dbus_message_iter_next(&imsg);
+	for (dbus_message_iter_recurse(&imsg, &iary);
+	     dbus_message_iter_get_arg_type(&iary) == DBUS_TYPE_ARRAY;
+	     dbus_message_iter_next(&iary)) {
+		DBusMessageIter ibytes;
+		const gchar *data;
+		gint len;
+
+		dbus_message_iter_recurse(&iary, &ibytes);
+		dbus_message_iter_get_fixed_array(&ibytes, &data, &len);
+		g_ptr_array_add(items->mds,
+				len > 0 ? mafw_metadata_thaw(data, len)
+					: NULL);
+	}
+	dbus_message_iter_next(&imsg);
+	dbus_message_iter_get_basic(&imsg, &dur);
+	dbus_message_iter_next(&imsg);
+	dbus_message_iter_get_basic(&imsg, &unk);
+	items->duration = dur;
+	items->unknown = unk;
+	return items;
+}
+
+/**
+ * mafw_proxy_playlist_get_items_with_metadata:
+ * @self:        a #MafwProxyPlaylist
+ * @first_index: visual index of the first item to return
+ * @last_index:  visual index of the last item to return
+ * @metadata:    where to store a #GPtrArray of the metadata of the items
+ *               (#GHashTable or %NULL), which frees its elements when
+ *               freed
+ * @duration:    where to store the total duration of the playlist in
+ *               seconds, or %NULL
+ * @unknown:     where to store the number of items whose duration is not
+ *               known yet (thus not included in @duration), or %NULL
+ * @error:       return location for a #GError, or %NULL
+ *
+ * Like mafw_playlist_get_items(), but returns the metadata of the items
+ * too, as cached by the playlist daemon, which saves asking the sources
+ * each time a playlist is shown.  The metadata keys the daemon caches
+ * are configured by its MAFW_PLAYLIST_METADATA_KEYS environment
+ * variable.  The metadata of items not cached yet is %NULL; the daemon
+ * fetches them, then emits #MafwProxyPlaylist::metadata-cached.
+ *
+ * Returns: a %NULL-terminated array of object ids, or %NULL on error.
+ * Free it with g_strfreev().
+ */
+gchar **mafw_proxy_playlist_get_items_with_metadata(MafwProxyPlaylist *self,
+						    guint first_index,
+						    guint last_index,
+						    GPtrArray **metadata,
+						    guint64 *duration,
+						    guint *unknown,
+						    GError **error)
+{
+	ItemsMetadata *items;
+	DBusMessage *reply;
+	gchar **oids;
+
+	g_return_val_if_fail(MAFW_IS_PROXY_PLAYLIST(self), NULL);
+	g_return_val_if_fail(metadata != NULL, NULL);
+	if (daemon_only(self, error))
+		return NULL;
+
+	reply = mafw_dbus_call(self->priv->connection,
+			       mafw_dbus_method_full(
+				       MAFW_DBUS_DESTINATION,
+				       self->priv->obj_path,
+				       MAFW_DBUS_INTERFACE,
+				       MAFW_PLAYLIST_METHOD_GET_ITEMS_WITH_METADATA,
+				       MAFW_DBUS_UINT32(first_index),
+				       MAFW_DBUS_UINT32(last_index)),
+			       MAFW_PLAYLIST_ERROR, error);
+	if (!reply)
+		return NULL;
+
+	items = items_metadata_reply(reply);
+	dbus_message_unref(reply);
+
+	oids = items->oids;
+	*metadata = items->mds;
+	if (duration)
+		*duration = items->duration;
+	if (unknown)
+		*unknown = items->unknown;
+	g_free(items);
+	return oids;
+}
+
+static void parse_items_metadata(GSimpleAsyncResult *res,
+				 DBusMessage *reply)
+{
+	g_simple_async_result_set_op_res_gpointer(res,
+					items_metadata_reply(reply),
+					(GDestroyNotify)items_metadata_free);
+}
+
+/**
+ * mafw_proxy_playlist_get_items_with_metadata_async:
+ * @self:        a #MafwProxyPlaylist
+ * @first_index: visual index of the first item to return
+ * @last_index:  visual index of the last item to return
+ * @callback:    function to call with the items
+ * @user_data:   data to pass to @callback
+ *
+ * Asynchronous version of mafw_proxy_playlist_get_items_with_metadata(),
+ * see mafw_proxy_playlist_get_item_async().
+ */
+void mafw_proxy_playlist_get_items_with_metadata_async(
+					MafwProxyPlaylist *self,
+					guint first_index,
+					guint last_index,
+					GAsyncReadyCallback callback,
+					gpointer user_data)
+{
+	GSimpleAsyncResult *res;
+	GError *error = NULL;
+
+	g_return_if_fail(MAFW_IS_PROXY_PLAYLIST(self));
+	res = g_simple_async_result_new(G_OBJECT(self), callback, user_data,
+			mafw_proxy_playlist_get_items_with_metadata_async);
+	if (daemon_only(self, &error)) {
+		async_done_in_idle(res, error);
+		return;
+	}
+
+	playlist_call_async(self, res, parse_items_metadata, NULL,
+			    MAFW_PLAYLIST_METHOD_GET_ITEMS_WITH_METADATA,
+			    MAFW_DBUS_UINT32(first_index),
+			    MAFW_DBUS_UINT32(last_index));
+}
+
+/**
+ * mafw_proxy_playlist_get_items_with_metadata_finish:
+ * @self:     a #MafwProxyPlaylist
+ * @res:      the #GAsyncResult passed to the callback
+ * @metadata: where to store a #GPtrArray of the metadata of the items,
+ *            see mafw_proxy_playlist_get_items_with_metadata()
+ * @duration: where to store the total duration of the playlist in
+ *            seconds, or %NULL
+ * @unknown:  where to store the number of items whose duration is not
+ *            known yet, or %NULL
+ * @error:    return location for a #GError, or %NULL
+ *
+ * Finishes mafw_proxy_playlist_get_items_with_metadata_async().
+ *
+ * Returns: a %NULL-terminated array of object ids, or %NULL on error.
+ * Free it with g_strfreev().
+ */
+gchar **mafw_proxy_playlist_get_items_with_metadata_finish(
+					MafwProxyPlaylist *self,
+					GAsyncResult *res,
+					GPtrArray **metadata,
+					guint64 *duration,
+					guint *unknown,
+					GError **error)
+{
+	ItemsMetadata *items;
+	GPtrArray *mds;
+	guint i;
+
+	g_return_val_if_fail(metadata != NULL, NULL);
+	if (!async_finish(self, res,
+			  mafw_proxy_playlist_get_items_with_metadata_async,
+			  error))
+		return NULL;
+	items = g_simple_async_result_get_op_res_gpointer(
+					G_SIMPLE_ASYNC_RESULT(res));
+	mds = g_ptr_array_new_with_free_func((GDestroyNotify)metadata_free);
+	for (i = 0; i < items->mds->len; i++) {
+		GHashTable *md;
+
+		md = g_ptr_array_index(items->mds, i);
+		g_ptr_array_add(mds, md ? g_hash_table_ref(md) : NULL);
+	}
+	*metadata = mds;
+	if (duration)
+		*duration = items->duration;
+	if (unknown)
+		*unknown = items->unknown;
+	return g_strdupv(items->oids);
+}
+
+/*---------------------------------------------------------------------------
+  Delta synchronization
+  ---------------------------------------------------------------------------*/
+
+static void change_free(MafwProxyPlaylistChange *change)
+{
+	g_strfreev(change->oids);
+	g_free(change);
+}
+
+/**
+ * mafw_proxy_playlist_sync_since:
+ * @self:       a #MafwProxyPlaylist
+ * @generation: the generation of the playlist the caller's copy of the
+ *              items corresponds to, or 0
+ * @current:    where to store the current generation
+ * @full:       set to %TRUE if the changes since @generation are not known
+ *              anymore, and the caller has to fetch all items again
+ * @error:      return location for a #GError, or %NULL
+ *
+ * Tells how the items of @self have changed since @generation, so that
+ * a copy of them can be brought up to date without refetching it.
+ * Applying the changes in order on the items of @generation yields the
+ * items of @current.  The generation of a copy fetched with
+ * mafw_proxy_playlist_iter_items() is told by
+ * mafw_proxy_playlist_iter_items_get_generation().  Generations remain
+ * valid when the playlist daemon is restarted, so a client can catch up
+ * after reconnecting.
+ *
+ * Returns: a #GPtrArray of #MafwProxyPlaylistChange (empty if @full),
+ * which frees its elements when freed, or %NULL on error.
+ */
+GPtrArray *mafw_proxy_playlist_sync_since(MafwProxyPlaylist *self,
+					  guint generation,
+					  guint *current,
+					  gboolean *full,
+					  GError **error)
+{
+	DBusMessage *reply;
+	DBusMessageIter imsg, iary, istr;
+	GPtrArray *changes;
+	dbus_bool_t dfull;
+	guint cur;
+
+	g_return_val_if_fail(MAFW_IS_PROXY_PLAYLIST(self), NULL);
+	if (daemon_only(self, error))
+		return NULL;
+
+	reply = mafw_dbus_call(self->priv->connection,
+			       mafw_dbus_method_full(
+				       MAFW_DBUS_DESTINATION,
+				       self->priv->obj_path,
+				       MAFW_DBUS_INTERFACE,
+				       MAFW_PLAYLIST_METHOD_SYNC_SINCE,
+				       MAFW_DBUS_UINT32(generation)),
+			       MAFW_PLAYLIST_ERROR, error);
+	if (!reply)
+		return NULL;
+
+	changes = g_ptr_array_new_with_free_func((GDestroyNotify)change_free);
+	dbus_message_iter_init(reply, &imsg);
+	dbus_message_iter_get_basic(&imsg, &cur);
+	dbus_message_iter_next(&imsg);
+	dbus_message_iter_get_basic(&imsg, &dfull);
+	dbus_message_iter_next(&imsg);
+	for (dbus_message_iter_recurse(&imsg, &iary);
+	     dbus_message_iter_get_arg_type(&iary) == DBUS_TYPE_STRUCT;
+	     dbus_message_iter_next(&iary)) {
+		MafwProxyPlaylistChange *change;
+		DBusMessageIter ioids;
+		GPtrArray *oids;
+
+		change = g_new0(MafwProxyPlaylistChange, 1);
+		dbus_message_iter_recurse(&iary, &istr);
+		dbus_message_iter_get_basic(&istr, &change->from);
+		dbus_message_iter_next(&istr);
+		dbus_message_iter_get_basic(&istr, &change->nremove);
+		dbus_message_iter_next(&istr);
+		oids = g_ptr_array_new();
+		for (dbus_message_iter_recurse(&istr, &ioids);
+		     dbus_message_iter_get_arg_type(&ioids)
+			     == DBUS_TYPE_STRING;
+		     dbus_message_iter_next(&ioids)) {
+			const gchar *oid;
+
+			dbus_message_iter_get_basic(&ioids, &oid);
+			g_ptr_array_add(oids, g_strdup(oid));
+		}
+		g_ptr_array_add(oids, NULL);
+		change->oids = (gchar **)g_ptr_array_free(oids, FALSE);
+		g_ptr_array_add(changes, change);
+	}
+	dbus_message_unref(reply);
+
+	if (current)
+		*current = cur;
+	if (full)
+		*full = dfull;
+	return changes;
+}
+
+static void handle_signal_window_changed(MafwProxyPlaylist *self,
+					 DBusMessage *msg)
+{
+	guint first, count;
+	gchar **oids;
+
+	mafw_dbus_parse(msg,
+			DBUS_TYPE_UINT32, &first,
+			DBUS_TYPE_UINT32, &count,
+			MAFW_DBUS_TYPE_STRVZ, &oids);
+	if (!oids)
+		oids = g_new0(gchar *, 1);
+	g_signal_emit(self, Signal_window_changed, 0, first, count, oids);
+	g_strfreev(oids);
+}
+
+static void handle_signal_window_shifted(MafwProxyPlaylist *self,
+					 DBusMessage *msg)
+{
+	guint first;
+
+	mafw_dbus_parse(msg, DBUS_TYPE_UINT32, &first);
+	g_signal_emit(self, Signal_window_shifted, 0, first);
+}
+
+static void handle_signal_metadata_cached(MafwProxyPlaylist *self,
+					  DBusMessage *msg)
+{
+	guint first, last, unknown;
+	guint64 duration;
+
+	mafw_dbus_parse(msg,
+			DBUS_TYPE_UINT32, &first,
+			DBUS_TYPE_UINT32, &last,
+			DBUS_TYPE_UINT64, &duration,
+			DBUS_TYPE_UINT32, &unknown);
+	g_signal_emit(self, Signal_metadata_cached, 0,
+		      first, last, duration, unknown);
+}
+
 /**
  * mafw_proxy_playlist_handle_signal_contents_changed:
  * @self: a MafwProxyPlaylist instance.
@@ -1023,6 +4104,7 @@ static void mafw_proxy_playlist_handle_signal_contents_changed(
 			DBUS_TYPE_UINT32, &nremove,
 			DBUS_TYPE_UINT32, &nreplace);
 
+	self->priv->size_valid = FALSE;
 	g_signal_emit_by_name(self, "contents-changed",
 			      from, nremove, nreplace);
 }
@@ -1047,6 +4129,10 @@ static void mafw_proxy_playlist_handle_signal_property_changed(
 	mafw_dbus_parse(msg,
 			DBUS_TYPE_STRING, &prop);
 
+	if (!strcmp(prop, "repeat"))
+		self->priv->repeat_valid = FALSE;
+	else if (!strcmp(prop, "is-shuffled"))
+		self->priv->shuffled_valid = FALSE;
 	g_object_notify(G_OBJECT(self), prop);
 }
 
@@ -1085,6 +4171,12 @@ static DBusHandlerResult dispatch_message(DBusConnection *conn,
 		mafw_proxy_playlist_handle_signal_property_changed(self, msg);
 	} else if (mafw_dbus_is_signal(msg, MAFW_PLAYLIST_ITEM_MOVED)) {
 		handle_signal_item_moved(self, msg);
+	} else if (mafw_dbus_is_signal(msg, MAFW_PLAYLIST_WINDOW_CHANGED)) {
+		handle_signal_window_changed(self, msg);
+	} else if (mafw_dbus_is_signal(msg, MAFW_PLAYLIST_WINDOW_SHIFTED)) {
+		handle_signal_window_shifted(self, msg);
+	} else if (mafw_dbus_is_signal(msg, MAFW_PLAYLIST_METADATA_CACHED)) {
+		handle_signal_metadata_cached(self, msg);
 	}
 
 	//Let the other apps receive the signal
@@ -26,6 +26,7 @@
 #define MAFW_PROXY_PLAYLIST_H
 
 #include <glib-object.h>
+#include <gio/gio.h>
 #include <libmafw/mafw-playlist.h>
 #include <libmafw/mafw-errors.h>
 #include <dbus/dbus.h>
@@ -97,6 +98,307 @@ struct _MafwProxyPlaylistClass
 GType mafw_proxy_playlist_get_type(void);
 GObject *mafw_proxy_playlist_new(guint id);
 guint mafw_proxy_playlist_get_id(MafwProxyPlaylist *self);
+gchar **mafw_proxy_playlist_get_next_n(MafwProxyPlaylist *self,
+				       guint index, guint n,
+				       guint **indices, GError **error);
+gchar **mafw_proxy_playlist_set_window(MafwProxyPlaylist *self,
+				       guint first, guint count,
+				       GError **error);
+gchar **mafw_proxy_playlist_get_items_with_metadata(MafwProxyPlaylist *self,
+						    guint first_index,
+						    guint last_index,
+						    GPtrArray **metadata,
+						    guint64 *duration,
+						    guint *unknown,
+						    GError **error);
+
+/*----------------------------------------------------------------------------
+  Delta synchronization
+  ----------------------------------------------------------------------------*/
+
+/**
+ * MafwProxyPlaylistChange:
+ * @from:    visual index of the first item changed
+ * @nremove: number of items removed from @from
+ * @oids:    %NULL-terminated array of the object ids inserted in their place
+ *
+ * A change of the items of a shared playlist, see
+ * mafw_proxy_playlist_sync_since().
+ */
+typedef struct {
+	guint from;
+	guint nremove;
+	gchar **oids;
+} MafwProxyPlaylistChange;
+
+GPtrArray *mafw_proxy_playlist_sync_since(MafwProxyPlaylist *self,
+					  guint generation,
+					  guint *current,
+					  gboolean *full,
+					  GError **error);
+
+/*----------------------------------------------------------------------------
+  Batched operations
+  ----------------------------------------------------------------------------*/
+
+/**
+ * MafwProxyPlaylistBatch:
+ *
+ * Opaque list of edit operations to be applied on a shared playlist in
+ * one transaction, see mafw_proxy_playlist_apply_batch().
+ */
+typedef struct _MafwProxyPlaylistBatch MafwProxyPlaylistBatch;
+
+MafwProxyPlaylistBatch *mafw_proxy_playlist_batch_new(void);
+void mafw_proxy_playlist_batch_free(MafwProxyPlaylistBatch *batch);
+void mafw_proxy_playlist_batch_insert(MafwProxyPlaylistBatch *batch,
+				      guint index, const gchar **oids);
+void mafw_proxy_playlist_batch_append(MafwProxyPlaylistBatch *batch,
+				      const gchar **oids);
+void mafw_proxy_playlist_batch_remove(MafwProxyPlaylistBatch *batch,
+				      guint index, guint count);
+void mafw_proxy_playlist_batch_move(MafwProxyPlaylistBatch *batch,
+				    guint from, guint to);
+void mafw_proxy_playlist_batch_clear(MafwProxyPlaylistBatch *batch);
+void mafw_proxy_playlist_batch_set_repeat(MafwProxyPlaylistBatch *batch,
+					  gboolean repeat);
+void mafw_proxy_playlist_batch_shuffle(MafwProxyPlaylistBatch *batch);
+void mafw_proxy_playlist_batch_unshuffle(MafwProxyPlaylistBatch *batch);
+gboolean mafw_proxy_playlist_apply_batch(MafwProxyPlaylist *self,
+					 MafwProxyPlaylistBatch *batch,
+					 GArray **results,
+					 GError **error);
+
+/*----------------------------------------------------------------------------
+  Asynchronous operations
+  ----------------------------------------------------------------------------*/
+
+void mafw_proxy_playlist_insert_item_async(MafwProxyPlaylist *self,
+					   guint index,
+					   const gchar *objectid,
+					   GAsyncReadyCallback callback,
+					   gpointer user_data);
+gboolean mafw_proxy_playlist_insert_item_finish(MafwProxyPlaylist *self,
+						GAsyncResult *res,
+						GError **error);
+void mafw_proxy_playlist_insert_items_async(MafwProxyPlaylist *self,
+					    guint index,
+					    const gchar **objectids,
+					    GAsyncReadyCallback callback,
+					    gpointer user_data);
+gboolean mafw_proxy_playlist_insert_items_finish(MafwProxyPlaylist *self,
+						 GAsyncResult *res,
+						 GError **error);
+void mafw_proxy_playlist_append_item_async(MafwProxyPlaylist *self,
+					   const gchar *objectid,
+					   GAsyncReadyCallback callback,
+					   gpointer user_data);
+gboolean mafw_proxy_playlist_append_item_finish(MafwProxyPlaylist *self,
+						GAsyncResult *res,
+						GError **error);
+void mafw_proxy_playlist_append_items_async(MafwProxyPlaylist *self,
+					    const gchar **objectids,
+					    GAsyncReadyCallback callback,
+					    gpointer user_data);
+gboolean mafw_proxy_playlist_append_items_finish(MafwProxyPlaylist *self,
+						 GAsyncResult *res,
+						 GError **error);
+void mafw_proxy_playlist_remove_item_async(MafwProxyPlaylist *self,
+					   guint index,
+					   GAsyncReadyCallback callback,
+					   gpointer user_data);
+gboolean mafw_proxy_playlist_remove_item_finish(MafwProxyPlaylist *self,
+						GAsyncResult *res,
+						GError **error);
+void mafw_proxy_playlist_move_item_async(MafwProxyPlaylist *self,
+					 guint from, guint to,
+					 GAsyncReadyCallback callback,
+					 gpointer user_data);
+gboolean mafw_proxy_playlist_move_item_finish(MafwProxyPlaylist *self,
+					      GAsyncResult *res,
+					      GError **error);
+void mafw_proxy_playlist_clear_async(MafwProxyPlaylist *self,
+				     GAsyncReadyCallback callback,
+				     gpointer user_data);
+gboolean mafw_proxy_playlist_clear_finish(MafwProxyPlaylist *self,
+					  GAsyncResult *res,
+					  GError **error);
+void mafw_proxy_playlist_shuffle_async(MafwProxyPlaylist *self,
+				       GAsyncReadyCallback callback,
+				       gpointer user_data);
+gboolean mafw_proxy_playlist_shuffle_finish(MafwProxyPlaylist *self,
+					    GAsyncResult *res,
+					    GError **error);
+void mafw_proxy_playlist_unshuffle_async(MafwProxyPlaylist *self,
+					 GAsyncReadyCallback callback,
+					 gpointer user_data);
+gboolean mafw_proxy_playlist_unshuffle_finish(MafwProxyPlaylist *self,
+					      GAsyncResult *res,
+					      GError **error);
+void mafw_proxy_playlist_get_item_async(MafwProxyPlaylist *self,
+					guint index,
+					GAsyncReadyCallback callback,
+					gpointer user_data);
+gchar *mafw_proxy_playlist_get_item_finish(MafwProxyPlaylist *self,
+					   GAsyncResult *res,
+					   GError **error);
+void mafw_proxy_playlist_get_items_async(MafwProxyPlaylist *self,
+					 guint first_index,
+					 guint last_index,
+					 GAsyncReadyCallback callback,
+					 gpointer user_data);
+gchar **mafw_proxy_playlist_get_items_finish(MafwProxyPlaylist *self,
+					     GAsyncResult *res,
+					     GError **error);
+void mafw_proxy_playlist_get_size_async(MafwProxyPlaylist *self,
+					GAsyncReadyCallback callback,
+					gpointer user_data);
+guint mafw_proxy_playlist_get_size_finish(MafwProxyPlaylist *self,
+					  GAsyncResult *res,
+					  GError **error);
+void mafw_proxy_playlist_get_repeat_async(MafwProxyPlaylist *self,
+					  GAsyncReadyCallback callback,
+					  gpointer user_data);
+gboolean mafw_proxy_playlist_get_repeat_finish(MafwProxyPlaylist *self,
+					       GAsyncResult *res,
+					       GError **error);
+void mafw_proxy_playlist_is_shuffled_async(MafwProxyPlaylist *self,
+					   GAsyncReadyCallback callback,
+					   gpointer user_data);
+gboolean mafw_proxy_playlist_is_shuffled_finish(MafwProxyPlaylist *self,
+						GAsyncResult *res,
+						GError **error);
+void mafw_proxy_playlist_get_name_async(MafwProxyPlaylist *self,
+					GAsyncReadyCallback callback,
+					gpointer user_data);
+gchar *mafw_proxy_playlist_get_name_finish(MafwProxyPlaylist *self,
+					   GAsyncResult *res,
+					   GError **error);
+void mafw_proxy_playlist_get_next_async(MafwProxyPlaylist *self,
+					guint index,
+					GAsyncReadyCallback callback,
+					gpointer user_data);
+gboolean mafw_proxy_playlist_get_next_finish(MafwProxyPlaylist *self,
+					     GAsyncResult *res,
+					     guint *index, gchar **oid,
+					     GError **error);
+void mafw_proxy_playlist_get_prev_async(MafwProxyPlaylist *self,
+					guint index,
+					GAsyncReadyCallback callback,
+					gpointer user_data);
+gboolean mafw_proxy_playlist_get_prev_finish(MafwProxyPlaylist *self,
+					     GAsyncResult *res,
+					     guint *index, gchar **oid,
+					     GError **error);
+void mafw_proxy_playlist_get_starting_index_async(MafwProxyPlaylist *self,
+						  GAsyncReadyCallback callback,
+						  gpointer user_data);
+gboolean mafw_proxy_playlist_get_starting_index_finish(
+					MafwProxyPlaylist *self,
+					GAsyncResult *res,
+					guint *index, gchar **oid,
+					GError **error);
+void mafw_proxy_playlist_get_last_index_async(MafwProxyPlaylist *self,
+					      GAsyncReadyCallback callback,
+					      gpointer user_data);
+gboolean mafw_proxy_playlist_get_last_index_finish(MafwProxyPlaylist *self,
+						   GAsyncResult *res,
+						   guint *index, gchar **oid,
+						   GError **error);
+void mafw_proxy_playlist_increment_use_count_async(MafwProxyPlaylist *self,
+						   GAsyncReadyCallback callback,
+						   gpointer user_data);
+gboolean mafw_proxy_playlist_increment_use_count_finish(
+					MafwProxyPlaylist *self,
+					GAsyncResult *res,
+					GError **error);
+void mafw_proxy_playlist_decrement_use_count_async(MafwProxyPlaylist *self,
+						   GAsyncReadyCallback callback,
+						   gpointer user_data);
+gboolean mafw_proxy_playlist_decrement_use_count_finish(
+					MafwProxyPlaylist *self,
+					GAsyncResult *res,
+					GError **error);
+void mafw_proxy_playlist_get_next_n_async(MafwProxyPlaylist *self,
+					  guint index, guint n,
+					  GAsyncReadyCallback callback,
+					  gpointer user_data);
+gchar **mafw_proxy_playlist_get_next_n_finish(MafwProxyPlaylist *self,
+					      GAsyncResult *res,
+					      guint **indices,
+					      GError **error);
+void mafw_proxy_playlist_set_window_async(MafwProxyPlaylist *self,
+					  guint first, guint count,
+					  GAsyncReadyCallback callback,
+					  gpointer user_data);
+gchar **mafw_proxy_playlist_set_window_finish(MafwProxyPlaylist *self,
+					      GAsyncResult *res,
+					      GError **error);
+void mafw_proxy_playlist_get_items_with_metadata_async(
+					MafwProxyPlaylist *self,
+					guint first_index,
+					guint last_index,
+					GAsyncReadyCallback callback,
+					gpointer user_data);
+gchar **mafw_proxy_playlist_get_items_with_metadata_finish(
+					MafwProxyPlaylist *self,
+					GAsyncResult *res,
+					GPtrArray **metadata,
+					guint64 *duration,
+					guint *unknown,
+					GError **error);
+void mafw_proxy_playlist_apply_batch_async(MafwProxyPlaylist *self,
+					   MafwProxyPlaylistBatch *batch,
+					   GAsyncReadyCallback callback,
+					   gpointer user_data);
+gboolean mafw_proxy_playlist_apply_batch_finish(MafwProxyPlaylist *self,
+						GAsyncResult *res,
+						GArray **results,
+						GError **error);
+
+/*----------------------------------------------------------------------------
+  Paged item retrieval
+  ----------------------------------------------------------------------------*/
+
+/**
+ * MafwProxyPlaylistItemsIter:
+ *
+ * Opaque handle of an ongoing mafw_proxy_playlist_iter_items().
+ */
+typedef struct _MafwProxyPlaylistItemsIter MafwProxyPlaylistItemsIter;
+
+/**
+ * MafwProxyPlaylistItemsCb:
+ * @self:        the #MafwProxyPlaylist iterated over
+ * @first_index: visual index of the first item of @oids
+ * @oids:        %NULL-terminated array of object ids of the page, owned by
+ *               the iterator
+ * @last:        %TRUE if there are no more pages
+ * @user_data:   user data passed to mafw_proxy_playlist_iter_items()
+ * @error:       non-%NULL if the page could not be retrieved
+ *
+ * Called for each page of mafw_proxy_playlist_iter_items().  In case of
+ * @error, @oids is %NULL and the iteration stops.
+ *
+ * Returns: %TRUE to continue with the next page, %FALSE to stop.
+ */
+typedef gboolean (*MafwProxyPlaylistItemsCb)(MafwProxyPlaylist *self,
+					     guint first_index,
+					     gchar **oids,
+					     gboolean last,
+					     gpointer user_data,
+					     const GError *error);
+
+MafwProxyPlaylistItemsIter *mafw_proxy_playlist_iter_items(
+					MafwProxyPlaylist *self,
+					guint first_index,
+					guint max_items,
+					guint max_bytes,
+					MafwProxyPlaylistItemsCb callback,
+					gpointer user_data);
+void mafw_proxy_playlist_iter_items_cancel(MafwProxyPlaylistItemsIter *iter);
+guint mafw_proxy_playlist_iter_items_get_generation(
+					MafwProxyPlaylistItemsIter *iter);
 
 #endif
 
@@ -26,6 +26,7 @@
 #include <libmafw/mafw-metadata-serializer.h>
 #include "common/dbus-interface.h"
 #include "common/mafw-dbus.h"
+#include "common/mafw-session.h"
 #include "wrapper.h"
 
 #undef G_LOG_DOMAIN
@@ -34,8 +35,10 @@
 #define MAFW_DBUS_PATH MAFW_OBJECT
 #define MAFW_DBUS_INTERFACE MAFW_EXTENSION_INTERFACE
 
-static GHashTable *source_activators;
-static DBusConnection *conn;
+/* Session registry subsystem of the clients requesting activity. */
+static guint source_activators;
+/* Session registry subsystem of the requests waiting for a reply. */
+static guint requests;
 
 #define SOURCE_REFDATA_NAME "mafw-refcount"
 
@@ -72,162 +75,39 @@ static void _decrease_mafwcount(gpointer object)
 	
 }
 
-static void _unregister_client(gpointer object, const gchar *name);
-
-#define MATCH_STR "type='signal',interface='org.freedesktop.DBus'," \
-			"member='NameOwnerChanged',arg0='%s',arg2=''"
-
-static DBusHandlerResult
-_handle_client_exits(DBusConnection *connection,
-                                     DBusMessage *msg,
-                                     gpointer data)
-{
-	gchar *name, *oldname, *newname;
-
-	if (!source_activators || g_hash_table_size(source_activators) == 0)
-		return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
-	if (!dbus_message_is_signal(msg, DBUS_INTERFACE_DBUS,
-				   "NameOwnerChanged"))
-		return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
-	
-
-	name = oldname = newname = NULL;
-	mafw_dbus_parse(msg,
-			 DBUS_TYPE_STRING, &name,
-			 DBUS_TYPE_STRING, &oldname,
-			 DBUS_TYPE_STRING, &newname);
-	if (*newname && *oldname)
-	{
-		return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
-	}
-
-	if (*newname) {
-		return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
-	} else if (*oldname) {
-		GList *object_list = g_hash_table_lookup(source_activators,
-								name);
-		while(object_list)
-		{
-			gpointer object = object_list->data;
-			_unregister_client(object, name);
-			object_list = g_hash_table_lookup(source_activators,
-								name);
-		}
-	}
-	return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
-}
-
 /**
- * Registers a watch for a client, to get the crash/exit signals
+ * Called by the session registry when a client, which requested activity
+ * from the object, disappears.
  */
-static void _register_watch(const gchar *name)
+static void _client_vanished(const gchar *name, gpointer object, guint count,
+			     gpointer unused)
 {
-	gchar *match_str = g_strdup_printf(MATCH_STR, name);
-	DBusError err;
-
-	dbus_error_init(&err);
-
-	dbus_bus_add_match(conn, match_str, &err);
-	if (dbus_error_is_set(&err))
-	{
-               	g_critical("Unable to add match: %s", match_str);
-		dbus_error_free(&err);
-	}
-	g_free(match_str);
-}
-
-/**
- * Deregisters a watch on dbus, for the given name
- */
-static void _deregister_watch(const gchar *name)
-{
-	gchar *matchstr = NULL;
-	matchstr = g_strdup_printf(MATCH_STR, name);
-	dbus_bus_remove_match(conn, matchstr, NULL);
-	g_free(matchstr);
+	_decrease_mafwcount(object);
 }
 
 /**
- * Registers a client. Registers a watch if needed, and stores the request for
- * the given object if needed.
+ * Registers a client. The session registry watches it if needed, and stores
+ * the request for the given object if needed.
  */
 static gboolean _register_client(gpointer object, const gchar *name)
 {
-	GList *object_list;
-
-	if (!source_activators)
-	{
-		source_activators = g_hash_table_new_full(g_str_hash,
-						g_str_equal,
-						g_free,
-						NULL);
+	if (mafw_session_holds(source_activators, name, object))
+	{// this UI already requested activity
+		return FALSE;
 	}
-	object_list = g_hash_table_lookup(source_activators, name);
-	
-	if (!object_list)
-	{
-		_register_watch(name);
-	}
-	else
-	{
-		if (g_list_find(object_list, object))
-		{// this UI already requested activity
-			return FALSE;
-		}
-	}
-	
-	object_list = g_list_prepend(object_list, object);
-	g_hash_table_insert(source_activators, g_strdup(name), object_list);
-
+	mafw_session_hold(source_activators, name, object);
 	return TRUE;
 }
 
-/**
- * Removes an object from the given list. If needed, deregisters the watch for
- * the client. It removes or updates only the new list for the client
- */
-static void _remove_object_from_list(GList *object_list,
-					gpointer object, const gchar *name)
-{
-	object_list = g_list_remove(object_list, object);
-	if (!object_list)
-	{// There isn't any source, what should be active because of this UI
-		_deregister_watch(name);
-		g_hash_table_remove(source_activators, name);
-	}
-	else
-	{
-		g_hash_table_insert(source_activators, g_strdup(name),
-					object_list);
-	}
-}
-
 /**
  * Unregisters a client for the object.
  */ 
 static void _unregister_client(gpointer object, const gchar *name)
 {
-	GList *object_list;
-
-	if (!source_activators || g_hash_table_size(source_activators) == 0)
-	{
+	if (!mafw_session_release(source_activators, name, object))
+	{// this UI never requested activity
 		return;
 	}
-	object_list = g_hash_table_lookup(source_activators, name);
-
-	if (!object_list)
-	{
-		return;
-	}
-	else
-	{
-		if (!g_list_find(object_list, object))
-		{// this UI never requested activity
-			return;
-		}
-		
-		_remove_object_from_list(object_list, object, name);
-	}
 	_decrease_mafwcount(object);
 }
 
@@ -272,51 +152,49 @@ static DBusHandlerResult handle_set_property(DBusConnection *conn,
 	return DBUS_HANDLER_RESULT_HANDLED;
 }
 
-struct _oblist_finder_data {
-	gpointer extension;
-	GPtrArray *ui_ids;
-};
-
 /**
- * Collects the UIs, which has requested activity from the given extension
+ * Called if the extension has removed from the registry
  */
-static void _find_ext(const gchar *ui_id, GList *ext_list,
-			struct _oblist_finder_data *obl_finder_data)
+void extension_deregister(gpointer comp)
 {
-	if (g_list_find(ext_list, obl_finder_data->extension))
-	{
-		g_ptr_array_add(obl_finder_data->ui_ids, (gpointer)ui_id);
-		
-	}
+	mafw_session_forget(source_activators, comp);
 }
 
 /**
- * Removes the given extension, reffed by the given UI
+ * extension_oci_new:
+ * @conn: the connection @msg arrived on
+ * @msg:  a request to be replied to later
+ *
+ * Like mafw_dbus_oci_new(), but remembers that the sender of @msg waits
+ * for the reply.  To be undone by extension_oci_reply().
  */
-static void _ext_remover(const gchar *ui_id, gpointer comp)
+MafwDBusOpCompletedInfo *extension_oci_new(DBusConnection *conn,
+					   DBusMessage *msg)
 {
-	GList *ext_list = g_hash_table_lookup(source_activators, ui_id);
-	_remove_object_from_list(ext_list, comp, ui_id);
+	MafwDBusOpCompletedInfo *oci;
+
+	oci = mafw_dbus_oci_new(conn, msg);
+	mafw_session_watch(dbus_message_get_sender(msg));
+	mafw_session_hold(requests, dbus_message_get_sender(msg), oci);
+	return oci;
 }
 
 /**
- * Called if the extension has removed from the registry
+ * extension_oci_reply:
+ * @oci:   what extension_oci_new() returned
+ * @reply: the reply to the request of @oci
+ *
+ * Sends @reply unless the client has left the bus since it made the
+ * request, then frees @oci.
  */
-void extension_deregister(gpointer comp)
+void extension_oci_reply(MafwDBusOpCompletedInfo *oci, DBusMessage *reply)
 {
-	struct _oblist_finder_data obl_finder_data = {0};
-	
-	obl_finder_data.extension = comp;
-	obl_finder_data.ui_ids = g_ptr_array_new();
-
-	if (source_activators)
-	{
-		g_hash_table_foreach(source_activators, (GHFunc)_find_ext,
-						&obl_finder_data);
-		g_ptr_array_foreach(obl_finder_data.ui_ids, (GFunc)_ext_remover,
-					comp);
-	}
-	g_ptr_array_free(obl_finder_data.ui_ids, TRUE);
+	if (mafw_session_release(requests, dbus_message_get_sender(oci->msg),
+				 oci))
+		mafw_dbus_send(oci->con, reply);
+	else
+		dbus_message_unref(reply);
+	mafw_dbus_oci_free(oci);
 }
 
 static void get_property_reply(MafwExtension *self, const gchar *prop,
@@ -324,15 +202,13 @@ static void get_property_reply(MafwExtension *self, const gchar *prop,
 			       const GError *err)
 {
 	if (err)
-		mafw_dbus_oci_error(oci, g_error_copy(err));
+		extension_oci_reply(oci, mafw_dbus_gerror(oci->msg, err));
 	else {
-		mafw_dbus_send(oci->con,
-			       mafw_dbus_reply(oci->msg,
-					       MAFW_DBUS_STRING(prop),
-					       MAFW_DBUS_GVALUE(val)));
+		extension_oci_reply(oci, mafw_dbus_reply(oci->msg,
+						MAFW_DBUS_STRING(prop),
+						MAFW_DBUS_GVALUE(val)));
 		g_value_unset(val);
 		g_free(val);
-		mafw_dbus_oci_free(oci);
 	}
 }
 
@@ -344,7 +220,7 @@ static DBusHandlerResult handle_get_property(DBusConnection *conn,
 	MafwDBusOpCompletedInfo *oci;
 
 	mafw_dbus_parse(msg, DBUS_TYPE_STRING, &prop);
-	oci = mafw_dbus_oci_new(conn, msg);
+	oci = extension_oci_new(conn, msg);
 	mafw_extension_get_property(MAFW_EXTENSION(ecomp->comp), prop,
 			       (gpointer)get_property_reply, oci);
 	return DBUS_HANDLER_RESULT_HANDLED;
@@ -482,10 +358,12 @@ void connect_to_extension_signals(gpointer ecomp)
 
 void extension_init(DBusConnection *connection)
 {
-	conn = connection;
-	if (!dbus_connection_add_filter(connection,
-                                        _handle_client_exits,
-                                        NULL, NULL))
-		g_assert_not_reached();
+	mafw_session_init(connection);
+	if (!source_activators)
+		source_activators = mafw_session_add_subsystem(
+							_client_vanished,
+							NULL);
+	if (!requests)
+		requests = mafw_session_add_subsystem(NULL, NULL);
 }
 /* vi: set noexpandtab ts=8 sw=8 cino=t0,(0: */
@@ -65,11 +65,9 @@ static void playback_cb(MafwRenderer *renderer, gpointer user_data,
 	g_assert(oci->msg != NULL);
 
 	if (error == NULL)
-		mafw_dbus_send(oci->con, mafw_dbus_reply(oci->msg));
+		extension_oci_reply(oci, mafw_dbus_reply(oci->msg));
 	else
-		mafw_dbus_send(oci->con, mafw_dbus_gerror(oci->msg, error));
-
-	mafw_dbus_oci_free(oci);
+		extension_oci_reply(oci, mafw_dbus_gerror(oci->msg, error));
 }
 
 /*----------------------------------------------------------------------------
@@ -99,17 +97,15 @@ static void get_status_cb(MafwRenderer *renderer, MafwPlaylist *playlist,
 			playlist_id = MAFW_PROXY_PLAYLIST_INVALID_ID;
 		}
 
-		mafw_dbus_send(oci->con,
-			       mafw_dbus_reply(oci->msg,
-					       MAFW_DBUS_UINT32(playlist_id),
-					       MAFW_DBUS_UINT32(index),
-					       MAFW_DBUS_INT32(state),
-					       MAFW_DBUS_STRING(
+		extension_oci_reply(oci,
+				    mafw_dbus_reply(oci->msg,
+					MAFW_DBUS_UINT32(playlist_id),
+					MAFW_DBUS_UINT32(index),
+					MAFW_DBUS_INT32(state),
+					MAFW_DBUS_STRING(
 						object_id ? object_id : "")));
 	} else
-		mafw_dbus_send(oci->con, mafw_dbus_gerror(oci->msg, error));
-
-	mafw_dbus_oci_free(oci);
+		extension_oci_reply(oci, mafw_dbus_gerror(oci->msg, error));
 }
 
 /*----------------------------------------------------------------------------
@@ -126,10 +122,10 @@ static void set_get_position_cb(MafwRenderer *renderer, gint seconds,
 	g_assert(oci->con != NULL);
 	g_assert(oci->msg != NULL);
 
-	mafw_dbus_send(oci->con, error
-		       ? mafw_dbus_gerror(oci->msg, error)
-		       : mafw_dbus_reply(oci->msg, MAFW_DBUS_UINT32(seconds)));
-	mafw_dbus_oci_free(oci);
+	extension_oci_reply(oci, error
+			    ? mafw_dbus_gerror(oci->msg, error)
+			    : mafw_dbus_reply(oci->msg,
+					      MAFW_DBUS_UINT32(seconds)));
 }
 
 /*----------------------------------------------------------------------------
@@ -150,15 +146,13 @@ static void get_current_metadata_cb(MafwRenderer *renderer,
 	g_assert(oci->msg != NULL);
 
 	if (error == NULL)
-		mafw_dbus_send(oci->con,
-			       mafw_dbus_reply(oci->msg,
-					       MAFW_DBUS_STRING(
-						       object_id ? object_id : ""),
-					       MAFW_DBUS_METADATA(metadata)));
+		extension_oci_reply(oci,
+				    mafw_dbus_reply(oci->msg,
+					MAFW_DBUS_STRING(
+						object_id ? object_id : ""),
+					MAFW_DBUS_METADATA(metadata)));
 	else
-		mafw_dbus_send(oci->con, mafw_dbus_gerror(oci->msg, error));
-
-	mafw_dbus_oci_free(oci);
+		extension_oci_reply(oci, mafw_dbus_gerror(oci->msg, error));
 }
 
 /*----------------------------------------------------------------------------
@@ -181,7 +175,7 @@ DBusHandlerResult handle_renderer_msg(DBusConnection *conn,
 	if (dbus_message_has_member(msg, MAFW_RENDERER_METHOD_PLAY)) {
 
 		MafwDBusOpCompletedInfo *oci;
-		oci = mafw_dbus_oci_new(conn, msg);
+		oci = extension_oci_new(conn, msg);
 		mafw_renderer_play(renderer, playback_cb, oci);
 		return DBUS_HANDLER_RESULT_HANDLED;
 
@@ -192,7 +186,7 @@ DBusHandlerResult handle_renderer_msg(DBusConnection *conn,
 		const gchar* object_id = NULL;
 
 		mafw_dbus_parse(msg, DBUS_TYPE_STRING, &object_id);
-		oci = mafw_dbus_oci_new(conn, msg);
+		oci = extension_oci_new(conn, msg);
 		mafw_renderer_play_object(renderer, object_id,
                                           playback_cb, oci);
 		return DBUS_HANDLER_RESULT_HANDLED;
@@ -204,35 +198,35 @@ DBusHandlerResult handle_renderer_msg(DBusConnection *conn,
 		const gchar* uri = NULL;
 
 		mafw_dbus_parse(msg, DBUS_TYPE_STRING, &uri);
-		oci = mafw_dbus_oci_new(conn, msg);
+		oci = extension_oci_new(conn, msg);
 		mafw_renderer_play_uri(renderer, uri, playback_cb, oci);
 		return DBUS_HANDLER_RESULT_HANDLED;
 
 	} else if (dbus_message_has_member(msg, MAFW_RENDERER_METHOD_STOP)) {
 
 		MafwDBusOpCompletedInfo *oci;
-		oci = mafw_dbus_oci_new(conn, msg);
+		oci = extension_oci_new(conn, msg);
 		mafw_renderer_stop(renderer, playback_cb, oci);
 		return DBUS_HANDLER_RESULT_HANDLED;
 
 	} else if (dbus_message_has_member(msg, MAFW_RENDERER_METHOD_PAUSE)) {
 
 		MafwDBusOpCompletedInfo *oci;
-		oci = mafw_dbus_oci_new(conn, msg);
+		oci = extension_oci_new(conn, msg);
 		mafw_renderer_pause(renderer, playback_cb, oci);
 		return DBUS_HANDLER_RESULT_HANDLED;
 
 	} else if (dbus_message_has_member(msg, MAFW_RENDERER_METHOD_RESUME)) {
 
 		MafwDBusOpCompletedInfo *oci;
-		oci = mafw_dbus_oci_new(conn, msg);
+		oci = extension_oci_new(conn, msg);
 		mafw_renderer_resume(renderer, playback_cb, oci);
 		return DBUS_HANDLER_RESULT_HANDLED;
 
 	} else if (dbus_message_has_member(msg, MAFW_RENDERER_METHOD_NEXT)) {
 
 		MafwDBusOpCompletedInfo *oci;
-		oci = mafw_dbus_oci_new(conn, msg);
+		oci = extension_oci_new(conn, msg);
 		mafw_renderer_next(renderer, playback_cb, oci);
 		return DBUS_HANDLER_RESULT_HANDLED;
 
@@ -240,7 +234,7 @@ DBusHandlerResult handle_renderer_msg(DBusConnection *conn,
                                            MAFW_RENDERER_METHOD_PREVIOUS)) {
 
 		MafwDBusOpCompletedInfo *oci;
-		oci = mafw_dbus_oci_new(conn, msg);
+		oci = extension_oci_new(conn, msg);
 		mafw_renderer_previous(renderer, playback_cb, oci);
 		return DBUS_HANDLER_RESULT_HANDLED;
 
@@ -250,7 +244,7 @@ DBusHandlerResult handle_renderer_msg(DBusConnection *conn,
 		guint index;
 		MafwDBusOpCompletedInfo *oci;
 		mafw_dbus_parse(msg, DBUS_TYPE_UINT32, &index);
-		oci = mafw_dbus_oci_new(conn, msg);
+		oci = extension_oci_new(conn, msg);
 		mafw_renderer_goto_index(renderer, index, playback_cb, oci);
 		return DBUS_HANDLER_RESULT_HANDLED;
 
@@ -258,7 +252,7 @@ DBusHandlerResult handle_renderer_msg(DBusConnection *conn,
                                            MAFW_RENDERER_METHOD_GET_STATUS)) {
 
 		MafwDBusOpCompletedInfo *oci;
-		oci = mafw_dbus_oci_new(conn, msg);
+		oci = extension_oci_new(conn, msg);
 		mafw_renderer_get_status(renderer, get_status_cb, oci);
 		return DBUS_HANDLER_RESULT_HANDLED;
 
@@ -308,7 +302,7 @@ DBusHandlerResult handle_renderer_msg(DBusConnection *conn,
 
 		mafw_dbus_parse(msg, DBUS_TYPE_INT32, &mode, DBUS_TYPE_INT32,
                                 &seconds);
-		oci = mafw_dbus_oci_new(conn, msg);
+		oci = extension_oci_new(conn, msg);
 		mafw_renderer_set_position(renderer, mode, seconds,
                                            set_get_position_cb, oci);
 		return DBUS_HANDLER_RESULT_HANDLED;
@@ -317,7 +311,7 @@ DBusHandlerResult handle_renderer_msg(DBusConnection *conn,
                                            MAFW_RENDERER_METHOD_GET_POSITION)) {
 
 		MafwDBusOpCompletedInfo *oci;
-		oci = mafw_dbus_oci_new(conn, msg);
+		oci = extension_oci_new(conn, msg);
 		mafw_renderer_get_position(renderer, set_get_position_cb, oci);
 		return DBUS_HANDLER_RESULT_HANDLED;
 
@@ -326,7 +320,7 @@ DBusHandlerResult handle_renderer_msg(DBusConnection *conn,
 			   MAFW_RENDERER_METHOD_GET_CURRENT_METADATA)) {
 
 		MafwDBusOpCompletedInfo *oci;
-		oci = mafw_dbus_oci_new(conn, msg);
+		oci = extension_oci_new(conn, msg);
 
 		mafw_renderer_get_current_metadata(renderer,
 						   get_current_metadata_cb,
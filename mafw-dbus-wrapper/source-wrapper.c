@@ -33,6 +33,7 @@
 #include "common/dbus-interface.h"
 #include "common/mafw-util.h"
 #include "common/mafw-dbus.h"
+#include "common/mafw-session.h"
 #include "wrapper.h"
 
 #undef G_LOG_DOMAIN
@@ -57,6 +58,8 @@
 
 struct browse_data {
 	MafwDBusOpCompletedInfo *oci;
+	MafwSource *source;
+	guint browse_id;
 	guint timeout_id;	/* timeout GSource ID */
 	guint timeout_time;	/* The timeout value of the current
                                  * message-array */
@@ -68,6 +71,8 @@ struct browse_data {
 };
 
 static GHashTable *browse_requests;
+/* Session registry subsystem of the clients waiting for browse results. */
+static guint browsing_clients;
 
 static gboolean send_browse_res(struct browse_data *bdat)
 {
@@ -95,10 +100,26 @@ static void free_browse_req(struct browse_data *bdata)
 	if (bdata->message_to_send)
 		dbus_message_unref(bdata->message_to_send);
 	if (bdata->oci)
+	{
+		mafw_session_release(browsing_clients,
+				     dbus_message_get_sender(bdata->oci->msg),
+				     bdata);
 		mafw_dbus_oci_free(bdata->oci);
+	}
+	g_object_unref(bdata->source);
 	g_free(bdata);
 }
 
+/* Called when the client of a browse in progress leaves the bus.  Stops
+ * the source producing results nobody would receive. */
+static void browse_vanished(const gchar *client, struct browse_data *bdata,
+			    guint count, gpointer unused)
+{
+	mafw_source_cancel_browse(bdata->source, bdata->browse_id, NULL);
+	g_hash_table_remove(browse_requests,
+			    GUINT_TO_POINTER(bdata->browse_id));
+}
+
 static void emit_browse_result(MafwSource *self, guint browse_id,
 			       gint remaining_count, guint index,
 			       const gchar *object_id, GHashTable *metadata,
@@ -254,10 +275,9 @@ static void got_metadata(MafwSource *self, const gchar *object_id,
 	info = (MafwDBusOpCompletedInfo *)user_data;
 	g_assert(info != NULL);
 
-	mafw_dbus_send(info->con, error
+	extension_oci_reply(info, error
 		? mafw_dbus_gerror(info->msg, error)
 		: mafw_dbus_reply (info->msg, MAFW_DBUS_METADATA(metadata)));
-	mafw_dbus_oci_free(info);
 }
 
 /* Appends the metadata-results to the reply-msg */
@@ -326,8 +346,7 @@ static void got_metadatas(MafwSource *self,
 	dbus_message_iter_append_basic(&iter_msg, DBUS_TYPE_UINT32, &errcode);
 	dbus_message_iter_append_basic(&iter_msg, DBUS_TYPE_STRING, &err_msg);
 
-	mafw_dbus_send(info->con, replmsg);
-	mafw_dbus_oci_free(info);
+	extension_oci_reply(info, replmsg);
 }
 
 /* Called when ->create_object() finished. */
@@ -339,10 +358,9 @@ static void object_created(MafwSource *src, const gchar *objectid,
 	info = (MafwDBusOpCompletedInfo*) user_data;
 	g_assert(info != NULL);
 
-	mafw_dbus_send(info->con, error
+	extension_oci_reply(info, error
 		? mafw_dbus_gerror(info->msg, error)
 		: mafw_dbus_reply (info->msg, MAFW_DBUS_STRING(objectid)));
-	mafw_dbus_oci_free(info);
 }
 
 /* Called when ->destroy_object() finished. */
@@ -354,10 +372,9 @@ static void object_destroyed(MafwSource *src, const gchar *objectid,
 	info = (MafwDBusOpCompletedInfo*) user_data;
 	g_assert(info != NULL);
 
-	mafw_dbus_send(info->con, error
+	extension_oci_reply(info, error
 	       ? mafw_dbus_gerror(info->msg, error)
 	       : mafw_dbus_reply (info->msg, MAFW_DBUS_STRING(objectid)));
-	mafw_dbus_oci_free(info);
 }
 
 /* Called when ->set_metadata() finished. */
@@ -375,8 +392,8 @@ static void metadata_set(MafwSource *src, const gchar *objectid,
 
 	if (error) {
 		domain_str = g_quark_to_string(error->domain);
-		mafw_dbus_send(
-			info->con,
+		extension_oci_reply(
+			info,
 			mafw_dbus_reply(info->msg,
 					MAFW_DBUS_STRING(objectid),
 					MAFW_DBUS_STRVZ(failed_keys),
@@ -389,9 +406,8 @@ static void metadata_set(MafwSource *src, const gchar *objectid,
 		m = mafw_dbus_reply(info->msg,
 				    MAFW_DBUS_STRING(objectid),
 				    MAFW_DBUS_STRVZ(failed_keys));
-		mafw_dbus_send(info->con, m);
+		extension_oci_reply(info, m);
 	}
-	mafw_dbus_oci_free(info);
 }
 
 /**
@@ -451,6 +467,7 @@ DBusHandlerResult handle_source_msg(DBusConnection *conn,
 		   This is used to route the results to correct
 		   destination. */
 		bdata->oci = mafw_dbus_oci_new(conn, msg);
+		bdata->source = g_object_ref(source);
 		bdata->maxresults = INITIAL_MAX_RESULTS;
 		bdata->timeout_id = g_timeout_add(INITIAL_BROWSE_TIMEOUT,
 						(GSourceFunc)send_browse_res,
@@ -468,18 +485,29 @@ DBusHandlerResult handle_source_msg(DBusConnection *conn,
 					       emit_browse_result, bdata);
 		mafw_filter_free(filter);
 		if (!browse_requests)
+		{
 			browse_requests =
                                 g_hash_table_new_full(
                                         NULL,
                                         NULL,
                                         NULL,
                                         (GDestroyNotify)free_browse_req);
+			browsing_clients = mafw_session_add_subsystem(
+				(MafwSessionVanishedFunc)browse_vanished,
+				NULL);
+		}
 		if (browse_id != MAFW_SOURCE_INVALID_BROWSE_ID)
 		{
 			g_hash_table_replace(browse_requests,
 					     GUINT_TO_POINTER(browse_id),
 					     bdata);
 
+			/* Cancel it if the client leaves meanwhile. */
+			bdata->browse_id = browse_id;
+			mafw_session_watch(dbus_message_get_sender(msg));
+			mafw_session_hold(browsing_clients,
+					  dbus_message_get_sender(msg), bdata);
+
 			/* Send the browse ID */
 			mafw_dbus_send(conn, mafw_dbus_reply(msg,
 					     MAFW_DBUS_UINT32(browse_id)));
@@ -533,7 +561,7 @@ DBusHandlerResult handle_source_msg(DBusConnection *conn,
 		mafw_dbus_parse(msg,
 				DBUS_TYPE_STRING, &objectid,
 				MAFW_DBUS_TYPE_STRVZ, &mkeys);
-		oci = mafw_dbus_oci_new(conn, msg);
+		oci = extension_oci_new(conn, msg);
 		/* TODO: Remove error (NULL) from MafwSource API */
 		mafw_source_get_metadata(source, objectid, mkeys,
 					 got_metadata, oci);
@@ -548,7 +576,7 @@ DBusHandlerResult handle_source_msg(DBusConnection *conn,
 		mafw_dbus_parse(msg,
 				MAFW_DBUS_TYPE_STRVZ, &objectids,
 				MAFW_DBUS_TYPE_STRVZ, &mkeys);
-		oci = mafw_dbus_oci_new(conn, msg);
+		oci = extension_oci_new(conn, msg);
 		/* TODO: Remove error (NULL) from MafwSource API */
 		mafw_source_get_metadatas(source, objectids, mkeys,
 					 got_metadatas, oci);
@@ -564,7 +592,7 @@ DBusHandlerResult handle_source_msg(DBusConnection *conn,
 		mafw_dbus_parse(msg, DBUS_TYPE_STRING, &object_id,
 				MAFW_DBUS_TYPE_METADATA, &metadata);
 
-		oci = mafw_dbus_oci_new(conn, msg);
+		oci = extension_oci_new(conn, msg);
 		/* TODO: Remove error (NULL) from MafwSource API */
 		mafw_source_set_metadata(source, object_id, metadata,
 					 metadata_set, oci);
@@ -582,7 +610,7 @@ DBusHandlerResult handle_source_msg(DBusConnection *conn,
 				DBUS_TYPE_STRING, &parent,
 				MAFW_DBUS_TYPE_METADATA, &metadata);
 
-		oci = mafw_dbus_oci_new(conn, msg);
+		oci = extension_oci_new(conn, msg);
 		/* TODO: Remove error (NULL) from MafwSource API */
 		mafw_source_create_object(source, parent, metadata,
 					  object_created, oci);
@@ -596,7 +624,7 @@ DBusHandlerResult handle_source_msg(DBusConnection *conn,
 		MafwDBusOpCompletedInfo *oci;
 
 		mafw_dbus_parse(msg, DBUS_TYPE_STRING, &objectid);
-		oci = mafw_dbus_oci_new(conn, msg);
+		oci = extension_oci_new(conn, msg);
 		/* TODO: Remove error (NULL) from MafwSource API */
 		mafw_source_destroy_object(source, objectid, object_destroyed,
 					   oci);
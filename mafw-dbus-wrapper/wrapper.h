@@ -26,6 +26,8 @@
 #include <dbus/dbus.h>
 #include <glib.h>
 
+#include "common/mafw-dbus.h"
+
 /**
  * ExportedComponent:
  * @comp:        the component that is exported
@@ -55,6 +57,10 @@ extern void connect_signal(ExportedComponent *ecomp, const gchar *signal,
 			   gpointer handler);
 
 /* extension-wrapper.c */
+extern MafwDBusOpCompletedInfo *extension_oci_new(DBusConnection *conn,
+						  DBusMessage *msg);
+extern void extension_oci_reply(MafwDBusOpCompletedInfo *oci,
+				DBusMessage *reply);
 extern void connect_to_extension_signals(gpointer ecomp);
 extern DBusHandlerResult handle_extension_msg(DBusConnection *conn,
 				       DBusMessage *msg,
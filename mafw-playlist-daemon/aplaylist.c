@@ -25,16 +25,29 @@
 # include "config.h"
 #endif
 #include <errno.h>
+#include <fcntl.h>
 #include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <glib.h>
 #include <glib/gprintf.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
 
+#include "common/dbus-interface.h"
 #include "mpd-internal.h"
 
-#define APLAYLIST_VERSION "2"
+#define APLAYLIST_VERSION "3"
+
+/* Beyond this many items the arrays grow by an eighth at a time. */
+#define PLS_DOUBLE_MAX		(1 << 16)
+
+/* Bounds of the change log of a playlist, see log_change(). */
+#define PLS_LOG_MAX_CHANGES	128
+#define PLS_LOG_MAX_OIDS	2048
 
 extern gboolean initialize;
 
@@ -44,21 +57,48 @@ extern gboolean initialize;
  * mass operations are quick, and user initiated edits shall be preserved
  * maximally. */
 guint Settle_time = 1;
+PlsSaveStats Save_stats;
 
 /* Forward declarations */
 static gboolean ops_settled(Pls *pls);
 
+/* Returns a copy of the $idx:th object id of $pls. */
+static gchar *item(Pls *pls, guint idx)
+{
+	gchar *oid;
+
+	if (!pls->pages)
+		return g_strdup(pls->vidx[idx]);
+	pages_get(pls->pages, idx, 1, &oid);
+	return oid;
+}
+
 /* Check pls is well-formed. That is, both pidx and iidx must contain all
- * indexes in the playlist, exactly once. */
+ * indexes in the playlist, exactly once, and ->bytes must be right. */
 gboolean pls_check(Pls *pls)
 {
 	gboolean isok;
 	guint i;
 	guint *hist_iidx;
         guint *hist_pidx;
+	gsize bytes;
 
 	isok = TRUE;
 
+	bytes = 0;
+	for (i = 0; i < pls->len; ++i) {
+		gchar *oid;
+
+		oid = item(pls, i);
+		bytes += strlen(oid);
+		g_free(oid);
+	}
+	if (bytes != pls->bytes) {
+		g_critical("bytes is %" G_GSIZE_FORMAT " instead of %"
+			   G_GSIZE_FORMAT, pls->bytes, bytes);
+		isok = FALSE;
+	}
+
         if (pls->shuffled) {
                 hist_pidx = g_new0(guint, pls->len);
                 hist_iidx = g_new0(guint, pls->len);
@@ -108,22 +148,21 @@ void pls_dump(Pls *pls, gboolean items)
         }
 
 	g_print("VI PL OID\n");
-        if (pls->shuffled) {
-                for (i = 0; i < pls->len; ++i) {
-                        g_print("%2u %2u %s\n", i, pls->pidx[i], pls->vidx[i]);
-                }
-        } else {
-                for (i = 0; i < pls->len; ++i) {
-                        g_print("%2u %2u %s\n", i, i, pls->vidx[i]);
-                }
-        }
+	for (i = 0; i < pls->len; ++i) {
+		gchar *oid;
+
+		oid = item(pls, i);
+		g_print("%2u %2u %s\n", i,
+			pls->shuffled ? pls->pidx[i] : i, oid);
+		g_free(oid);
+	}
 
 	pls_check(pls);
 }
 
-/* Called to lengthen the dirty timer at each edit operation, anticipating that
- * more edits will happen in the near future. */
-static void i_am_dirty(Pls *pls)
+/* (Re)starts the dirty timer, anticipating that more edits will happen in the
+ * near future. */
+static void restart_dirty_timer(Pls *pls)
 {
 	if (pls->dirty_timer)
 		g_assert(g_source_remove(pls->dirty_timer));
@@ -132,6 +171,85 @@ static void i_am_dirty(Pls *pls)
                                                  (GSourceFunc)ops_settled, pls);
 }
 
+/* Called at each edit operation to record the modification time and lengthen
+ * the dirty timer. */
+static void i_am_dirty(Pls *pls)
+{
+	pls->mtime = time(NULL);
+	restart_dirty_timer(pls);
+}
+
+static void change_free(PlsChange *change)
+{
+	g_strfreev(change->oids);
+	g_free(change);
+}
+
+/* Forgets the change log of $pls, so that deltas can only be computed
+ * from the current generation on. */
+static void log_reset(Pls *pls)
+{
+	PlsChange *change;
+
+	while ((change = g_queue_pop_head(&pls->changes)) != NULL)
+		change_free(change);
+	pls->log_oids = 0;
+	pls->log_since = pls->generation;
+}
+
+/* Called at each operation changing the items of the playlist.  Besides
+ * dirtying it, starts a new generation, invalidating the cursors handed out
+ * by pls_get_items_budget().  Generation 0 is never used.  The caller is
+ * expected to log_change() what it did. */
+static void i_have_changed(Pls *pls)
+{
+	if (!++pls->generation) {
+		/* Generations wrapped, the log cannot be ordered. */
+		pls->generation = 1;
+		log_reset(pls);
+	}
+	i_am_dirty(pls);
+}
+
+/* Records in the change log of $pls that in the current generation,
+ * $nremove items were removed from $from and the $noids $oids were inserted
+ * there.  The log is bounded; the oldest generations are forgotten when it
+ * grows too long, see pls_changes_since(). */
+static void log_change(Pls *pls, guint from, guint nremove,
+		       const gchar *const *oids, guint noids)
+{
+	PlsChange *change;
+	guint i;
+
+	change = g_new(PlsChange, 1);
+	change->generation = pls->generation;
+	change->from = from;
+	change->nremove = nremove;
+	change->oids = g_new(gchar *, noids + 1);
+	for (i = 0; i < noids; i++)
+		change->oids[i] = g_strdup(oids[i]);
+	change->oids[i] = NULL;
+	change->noids = noids;
+	g_queue_push_tail(&pls->changes, change);
+	pls->log_oids += noids;
+
+	while (pls->changes.length > PLS_LOG_MAX_CHANGES
+	       || pls->log_oids > PLS_LOG_MAX_OIDS) {
+		guint oldest;
+
+		/* Drop whole generations only. */
+		change = g_queue_peek_head(&pls->changes);
+		oldest = change->generation;
+		while ((change = g_queue_peek_head(&pls->changes)) != NULL
+		       && change->generation == oldest) {
+			g_queue_pop_head(&pls->changes);
+			pls->log_oids -= change->noids;
+			change_free(change);
+		}
+		pls->log_since = oldest;
+	}
+}
+
 /* Timer callback called when edit operations have settled.  Calls save_me(),
  * which should try to save the playlist, and clear pls->dirty if successful.
  * If it doesn't, the timer will be restarted in the hope maybe it was a
@@ -148,7 +266,7 @@ static gboolean ops_settled(Pls *pls)
 	/* If save_me() succeeded, it should have cleared the dirty flag.  If
 	 * it's still set, we reinstate the timer. */
 	if (pls->dirty)
-		i_am_dirty(pls);
+		restart_dirty_timer(pls);
 	return FALSE;
 }
 
@@ -196,6 +314,11 @@ Pls *pls_new(guint id, const gchar *name)
 	p->dirty = TRUE;
 	p->use_count = 0;
 	p->dirty_timer = 0;
+	p->generation = 1;
+	p->log_since = 1;
+	g_queue_init(&p->changes);
+	p->mtime = time(NULL);
+	g_rw_lock_init(&p->lock);
 	pls_set_name(p, name);
 	return p;
 }
@@ -222,11 +345,21 @@ gboolean pls_set_name(Pls *pls, const gchar *name)
 /* Empties playlist */
 void pls_clear(Pls *pls)
 {
-	guint i;
-
-	for (i = 0; i < pls->len; ++i) {
-		g_free(pls->vidx[i]);
-        }
+	guint i, oldlen;
+
+	oldlen = pls->len;
+	if (pls->packed) {
+		g_free(pls->packed);
+		pls->packed = NULL;
+		pls->packed_len = pls->packed_raw = 0;
+	} else if (pls->pages) {
+		pages_free(pls->pages);
+		pls->pages = NULL;
+	} else {
+		for (i = 0; i < pls->len; ++i) {
+			g_free(pls->vidx[i]);
+		}
+	}
 
 	g_free(pls->vidx);
 	g_free(pls->pidx);
@@ -235,7 +368,9 @@ void pls_clear(Pls *pls)
 	pls->pidx = NULL;
         pls->iidx = NULL;
 	pls->len = pls->poolst = pls->alloc = 0;
-	i_am_dirty(pls);
+	pls->bytes = 0;
+	i_have_changed(pls);
+	log_change(pls, 0, oldlen, NULL, 0);
 }
 
 /* Remove completely playlist */
@@ -251,22 +386,63 @@ void pls_free(Pls *pls)
 		g_free(pls->name);
         }
 
+	g_free(pls->owner);
+	log_reset(pls);
+	g_rw_lock_clear(&pls->lock);
 	g_free(pls);
 }
 
+/* Playlists reaching $Paging_entries items keep their object ids in a
+ * PlsPages with at most $Paging_resident pages in memory, see
+ * pls_set_paging().  0 means never. */
+static guint Paging_entries;
+static guint Paging_resident;
+
+/* Sets the number of items from which playlists are paged out, and how
+ * many pages of each may be in memory.  Playlists paged out stay so
+ * until they are emptied. */
+void pls_set_paging(guint entries, guint resident)
+{
+	Paging_entries = entries;
+	Paging_resident = resident;
+}
+
+/* Moves the object ids of $pls to a PlsPages, or leaves them in
+ * $pls->vidx if the scratch file can't be created. */
+static void page_out(Pls *pls)
+{
+	PlsPages *pages;
+
+	if (!pls_ensure_dir()
+	    || !(pages = pages_new(pls_dir(), Paging_resident)))
+		return;
+	pages_adopt(pages, 0, pls->vidx, pls->len);
+	g_free(pls->vidx);
+	pls->vidx = NULL;
+	pls->pages = pages;
+}
+
 static void maybe_realloc(Pls *pls, guint want_to_add)
 {
 	guint wantsize, s;
 
 	g_assert(pls->alloc >= pls->len);
 	wantsize = pls->len + want_to_add;
+	if (Paging_entries && !pls->pages && wantsize >= Paging_entries)
+		page_out(pls);
 	/* TODO: this could also compact the array if len << alloc. */
 	if (wantsize <= pls->alloc)
 		return;
-	/* min 16 items, otherwise nearest power of 2 */
-	for (s = 16; s < wantsize; s <<= 1);
+	/* min 16 items, otherwise nearest power of 2 up to PLS_DOUBLE_MAX,
+	 * beyond which doubling would waste too much */
+	if (wantsize <= PLS_DOUBLE_MAX)
+		for (s = 16; s < wantsize; s <<= 1);
+	else
+		s = wantsize + wantsize / 8;
 	pls->alloc = s;
-	pls->vidx = g_realloc(pls->vidx, pls->alloc * sizeof(*pls->vidx));
+	if (!pls->pages)
+		pls->vidx = g_realloc(pls->vidx,
+				      pls->alloc * sizeof(*pls->vidx));
         if (pls->shuffled) {
                 pls->pidx = g_realloc(pls->pidx,
                                       pls->alloc * sizeof(*pls->pidx));
@@ -295,13 +471,19 @@ gboolean pls_inserts(Pls *pls, guint idx, const gchar **oids, guint len)
 
 	maybe_realloc(pls, len);
 
-	/* Push vidx up to alloc the new elements */
-	memmove(&pls->vidx[idx + len], &pls->vidx[idx],
-		(pls->len - idx) * sizeof(pls->vidx[0]));
+	if (pls->pages) {
+		pages_insert(pls->pages, idx, oids, len);
+	} else {
+		/* Push vidx up to alloc the new elements */
+		memmove(&pls->vidx[idx + len], &pls->vidx[idx],
+			(pls->len - idx) * sizeof(pls->vidx[0]));
+	}
 
         /* Insert the new elements */
         for (i = 0; i < len; i++) {
-                pls->vidx[idx+i] = g_strdup(oids[i]);
+		if (!pls->pages)
+			pls->vidx[idx+i] = g_strdup(oids[i]);
+		pls->bytes += strlen(oids[i]);
         }
 
         if (pls->shuffled) {
@@ -322,7 +504,8 @@ gboolean pls_inserts(Pls *pls, guint idx, const gchar **oids, guint len)
 
         pls->len += len;
 
-	i_am_dirty(pls);
+	i_have_changed(pls);
+	log_change(pls, idx, 0, oids, len);
 
 	return TRUE;
 }
@@ -340,6 +523,31 @@ gboolean pls_appends(Pls *pls, const gchar **oid, guint len)
 	return pls_inserts(pls, pls->len, oid, len);
 }
 
+/* Insert @count items of @src starting at @from into @dst at @at.  @src
+ * and @dst may be the same playlist.  Returns FALSE if either range is
+ * invalid, copying nothing is fine. */
+gboolean pls_copy_range(Pls *dst, guint at, Pls *src, guint from,
+			guint count)
+{
+	gchar **oids;
+	gboolean ret;
+
+	if (from > src->len || count > src->len - from || at > dst->len)
+		return FALSE;
+	if (!count)
+		return TRUE;
+	if (src != dst && !src->pages)
+		return pls_inserts(dst, at,
+				   (const gchar **)&src->vidx[from], count);
+
+	/* pls_inserts() may move ->vidx, but not the strings; paged
+	 * ones may move anywhere. */
+	oids = pls_get_items(src, from, from + count - 1);
+	ret = pls_inserts(dst, at, (const gchar **)oids, count);
+	pls_items_free(src, oids);
+	return ret;
+}
+
 /* Append oid in playlist */
 gboolean pls_append(Pls *pls, const gchar *oid)
 {
@@ -357,11 +565,16 @@ gboolean pls_remove(Pls *pls, guint idx)
 		return FALSE;
         }
 
-	g_free(pls->vidx[idx]);
+	if (pls->pages) {
+		pls->bytes -= pages_remove(pls->pages, idx, 1);
+	} else {
+		pls->bytes -= strlen(pls->vidx[idx]);
+		g_free(pls->vidx[idx]);
 
-	/* Push the rest downwards */
-	memmove(&pls->vidx[idx], &pls->vidx[idx + 1],
-		(pls->len - idx - 1) * sizeof(pls->vidx[0]));
+		/* Push the rest downwards */
+		memmove(&pls->vidx[idx], &pls->vidx[idx + 1],
+			(pls->len - idx - 1) * sizeof(pls->vidx[0]));
+	}
 
         if (pls->shuffled) {
                 opx = pls->iidx[idx];
@@ -393,7 +606,63 @@ gboolean pls_remove(Pls *pls, guint idx)
 
         pls->len--;
 
-	i_am_dirty(pls);
+	i_have_changed(pls);
+	log_change(pls, idx, 1, NULL, 0);
+
+	return TRUE;
+}
+
+/* Remove $count elements starting at the idx-th one.  Returns @TRUE if
+ * the whole range was valid and has been removed. */
+gboolean pls_removes(Pls *pls, guint idx, guint count)
+{
+	guint i, j, end, npoolst;
+
+	if (!count || idx >= pls->len || count > pls->len - idx) {
+		return FALSE;
+	}
+
+	end = idx + count;
+	if (pls->pages) {
+		pls->bytes -= pages_remove(pls->pages, idx, count);
+	} else {
+		for (i = idx; i < end; i++) {
+			pls->bytes -= strlen(pls->vidx[i]);
+			g_free(pls->vidx[i]);
+		}
+
+		/* Push the rest downwards */
+		memmove(&pls->vidx[idx], &pls->vidx[end],
+			(pls->len - end) * sizeof(pls->vidx[0]));
+	}
+
+        if (pls->shuffled) {
+                /* Drop the removed elements from pidx keeping the order of
+                 * the remaining ones, and renumber those above the range. */
+                npoolst = pls->poolst;
+                for (i = j = 0; i < pls->len; i++) {
+                        if (pls->pidx[i] >= idx && pls->pidx[i] < end) {
+                                if (i < pls->poolst) {
+                                        npoolst--;
+                                }
+                                continue;
+                        }
+                        pls->pidx[j++] = pls->pidx[i] >= end
+                                ? pls->pidx[i] - count
+                                : pls->pidx[i];
+                }
+                pls->poolst = npoolst;
+
+                /* Rebuild iidx */
+                for (i = 0; i < j; i++) {
+                        pls->iidx[pls->pidx[i]] = i;
+                }
+        }
+
+	pls->len -= count;
+
+	i_have_changed(pls);
+	log_change(pls, idx, count, NULL, 0);
 
 	return TRUE;
 }
@@ -444,11 +713,12 @@ gchar *pls_get_item(Pls *pls, guint idx)
 		return NULL;
         }
 
-	return g_strdup(pls->vidx[idx]);
+	return item(pls, idx);
 }
 
 /* Returns a chunk of elements from playlist, starting in fidx and ending in
- * lidx (at most) */
+ * lidx (at most).  The strings are not copied unless the playlist is paged
+ * out, so the result is to be freed with pls_items_free(). */
 gchar **pls_get_items(Pls *pls, guint fidx, guint lidx)
 {
 	GPtrArray *oidarray = NULL;
@@ -465,6 +735,13 @@ gchar **pls_get_items(Pls *pls, guint fidx, guint lidx)
 		lidx = pls->len-1;
         }
 
+	if (pls->pages) {
+		oids = g_new(gchar *, lidx - fidx + 2);
+		pages_get(pls->pages, fidx, lidx - fidx + 1, oids);
+		oids[lidx - fidx + 1] = NULL;
+		return oids;
+	}
+
 	oidarray = g_ptr_array_sized_new(lidx - fidx + 2);
 
         /* Copy chunk playlist */
@@ -480,6 +757,52 @@ gchar **pls_get_items(Pls *pls, guint fidx, guint lidx)
 	return oids;
 }
 
+/* Returns the elements of the playlist from fidx onwards, but at most
+ * $max_items of them, and not more than what fits in $max_bytes (counting
+ * the terminating NULs).  At least one element is returned in any case,
+ * so that the caller can make progress.  0 means no limit.  $next is set
+ * to the index of the first element not returned, or
+ * MAFW_PLAYLIST_ITEMS_END if the end of the playlist has been reached.
+ * Like pls_get_items(), the strings are not copied unless the playlist is
+ * paged out.  Returns NULL if $fidx is beyond the end of the playlist;
+ * $fidx == pls->len yields an empty list. */
+gchar **pls_get_items_budget(Pls *pls, guint fidx, guint max_items,
+			     gsize max_bytes, guint *next)
+{
+	GPtrArray *oidarray;
+	gsize bytes, size;
+	guint i;
+
+	if (fidx > pls->len) {
+		return NULL;
+	}
+
+	if (!max_items || max_items > pls->len - fidx) {
+		max_items = pls->len - fidx;
+	}
+
+	oidarray = g_ptr_array_sized_new(max_items + 1);
+	bytes = 0;
+	for (i = fidx; i < fidx + max_items; i++) {
+		gchar *oid;
+
+		oid = pls->pages ? item(pls, i) : pls->vidx[i];
+		size = strlen(oid) + 1;
+		if (max_bytes && bytes + size > max_bytes && i > fidx) {
+			if (pls->pages) {
+				g_free(oid);
+			}
+			break;
+		}
+		bytes += size;
+		g_ptr_array_add(oidarray, oid);
+	}
+	g_ptr_array_add(oidarray, NULL);
+
+	*next = i < pls->len ? i : MAFW_PLAYLIST_ITEMS_END;
+	return (gchar **)g_ptr_array_free(oidarray, FALSE);
+}
+
 /* Sets the first playable item's visual index, and object id if the list is not
    empty */
 void pls_get_starting(Pls *pls, guint *index, gchar **oid)
@@ -487,14 +810,14 @@ void pls_get_starting(Pls *pls, guint *index, gchar **oid)
 	if (pls->len) {
                 if (!pls->shuffled) {
                         *index = 0;
-                        *oid = g_strdup(pls->vidx[0]);
+                        *oid = item(pls, 0);
                 } else {
                         /* If there are no shuffled elements, shuffle one */
                         if (pls->poolst == 0) {
                                 shuffle_elements(pls, 1);
                         }
                         *index = pls->pidx[0];
-                        *oid = g_strdup(pls->vidx[*index]);
+                        *oid = item(pls, *index);
                 }
         }
 }
@@ -506,12 +829,12 @@ void pls_get_last(Pls *pls, guint *index, gchar **oid)
 	if (pls->len) {
                 if (!pls->shuffled) {
                         *index = pls->len-1;
-                        *oid = g_strdup(pls->vidx[pls->len-1]);
+                        *oid = item(pls, pls->len-1);
                 } else {
                         /* Need to shuffle all elements */
                         shuffle_elements(pls, pls->len);
                         *index = pls->pidx[pls->len-1];
-                        *oid = g_strdup(pls->vidx[*index]);
+                        *oid = item(pls, *index);
                 }
 	}
 }
@@ -531,11 +854,11 @@ gboolean pls_get_next(Pls *pls, guint *index, gchar **oid)
                  * first */
                 if (*index < pls->len-1) {
                         (*index)++;
-                        *oid = g_strdup(pls->vidx[*index]);
+                        *oid = item(pls, *index);
                         return TRUE;
                 } else if (pls->repeat) {
                         *index = 0;
-                        *oid = g_strdup(pls->vidx[0]);
+                        *oid = item(pls, 0);
                         return TRUE;
                 } else {
                         /* Out of range */
@@ -545,7 +868,7 @@ gboolean pls_get_next(Pls *pls, guint *index, gchar **oid)
                 /* Is the next element still shuffled? */
                 if ((pls->iidx[*index]+1) < pls->poolst) {
                         *index = pls->pidx[pls->iidx[*index]+1];
-                        *oid = g_strdup(pls->vidx[*index]);
+                        *oid = item(pls, *index);
                         return TRUE;
                 }
 
@@ -560,11 +883,11 @@ gboolean pls_get_next(Pls *pls, guint *index, gchar **oid)
                 if (pls->poolst < pls->len) {
                         shuffle_elements(pls, 1);
                         *index = pls->pidx[pls->poolst-1];
-                        *oid = g_strdup(pls->vidx[*index]);
+                        *oid = item(pls, *index);
                         return TRUE;
                 } else if (pls->repeat) {
                         *index = pls->pidx[0];
-                        *oid = g_strdup(pls->vidx[*index]);
+                        *oid = item(pls, *index);
                         return TRUE;
                 } else {
                         /* No more elements */
@@ -573,6 +896,30 @@ gboolean pls_get_next(Pls *pls, guint *index, gchar **oid)
         }
 }
 
+/* Looks ahead $n items in play order after the one at visual index $index,
+ * as if pls_get_next() was called $n times, which it does, so the shuffled
+ * order it reveals is committed and later pls_get_next() calls agree with
+ * it.  The visual indices are stored in $indices, the object ids (newly
+ * allocated) in $oids, which must have room for $n + 1 elements and is
+ * %NULL-terminated.  Returns the number of items found, which is less than
+ * $n if the end of the playlist is reached and repeat is off. */
+guint pls_get_next_n(Pls *pls, guint index, guint n,
+		     guint *indices, gchar **oids)
+{
+	guint i;
+
+	for (i = 0; i < n; i++) {
+		oids[i] = NULL;
+		if (!pls_get_next(pls, &index, &oids[i])) {
+			break;
+		}
+		indices[i] = index;
+	}
+	oids[i] = NULL;
+
+	return i;
+}
+
 /* Sets the previous playable item's visual index, and object id if there is
    any, according to the repeat setting. Returns @TRUE if clip is found */
 gboolean pls_get_prev(Pls *pls, guint *index, gchar **oid)
@@ -587,11 +934,11 @@ gboolean pls_get_prev(Pls *pls, guint *index, gchar **oid)
                  * last */
                 if (*index > 0) {
                         (*index)--;
-                        *oid = g_strdup(pls->vidx[*index]);
+                        *oid = item(pls, *index);
                         return TRUE;
                 } else if (pls->repeat) {
                         *index = pls->len-1;
-                        *oid = g_strdup(pls->vidx[*index]);
+                        *oid = item(pls, *index);
                         return TRUE;
                 } else {
                         /* No prev */
@@ -607,7 +954,7 @@ gboolean pls_get_prev(Pls *pls, guint *index, gchar **oid)
                 /* Is there a previous element? */
                 if (pls->iidx[*index] > 0) {
                         *index=pls->pidx[pls->iidx[*index]-1];
-                        *oid = g_strdup(pls->vidx[*index]);
+                        *oid = item(pls, *index);
                         return TRUE;
                 }
 
@@ -636,11 +983,11 @@ void pls_set_repeat(Pls *pls, gboolean repeat)
 	i_am_dirty(pls);
 }
 
-/* Change the refcount */
+/* Change the refcount.  It doesn't count as a modification of the playlist. */
 void pls_set_use_count(Pls *pls, guint use_count)
 {
 	pls->use_count = use_count;
-	i_am_dirty(pls);
+	restart_dirty_timer(pls);
 }
 
 /* Moves a clip from "from" to "to" */
@@ -677,12 +1024,170 @@ gboolean pls_move(Pls *pls, guint from, guint to)
                 mlen = from - to;
         }
 
-        aoid = pls->vidx[from];
-	memmove(&pls->vidx[mdest], &pls->vidx[msrc],
-		mlen * sizeof(pls->vidx[0]));
-        pls->vidx[to] = aoid;
+	if (pls->pages) {
+		aoid = item(pls, from);
+		pages_remove(pls->pages, from, 1);
+		pages_insert(pls->pages, to, (const gchar *const *)&aoid, 1);
+	} else {
+		aoid = pls->vidx[from];
+		memmove(&pls->vidx[mdest], &pls->vidx[msrc],
+			mlen * sizeof(pls->vidx[0]));
+		pls->vidx[to] = aoid;
+	}
 
-	i_am_dirty(pls);
+	i_have_changed(pls);
+	log_change(pls, from, 1, NULL, 0);
+	log_change(pls, to, 0, (const gchar *const *)&aoid, 1);
+	if (pls->pages) {
+		g_free(aoid);
+	}
+	return TRUE;
+}
+
+/* Applies $nops edit operations on $pls in order, as a transaction.  The
+ * operations are validated first against the length the playlist would have
+ * at their turn, and they are applied only if all of them are valid.
+ * $results (if not %NULL) tells the validity of each operation.
+ * $first_changed (if not %NULL) is set to the lowest visual index whose item
+ * may have changed, or G_MAXUINT if the contents are untouched.  Returns
+ * @TRUE if the operations have been applied. */
+gboolean pls_apply_ops(Pls *pls, const PlsOp *ops, guint nops,
+		       gboolean *results, guint *first_changed)
+{
+	guint i, len, first, touched;
+	gboolean isok, valid;
+
+	/* Dry run: only the length of the playlist decides whether an
+	 * operation can be carried out. */
+	isok = TRUE;
+	len = pls->len;
+	first = G_MAXUINT;
+	for (i = 0; i < nops; i++) {
+		const PlsOp *op = &ops[i];
+
+		touched = G_MAXUINT;
+		switch (op->type) {
+		case MAFW_PLAYLIST_OP_INSERT:
+			valid = op->noids > 0 && op->idx <= len;
+			if (valid) {
+				touched = op->idx;
+				len += op->noids;
+			}
+			break;
+		case MAFW_PLAYLIST_OP_APPEND:
+			valid = op->noids > 0;
+			if (valid) {
+				touched = len;
+				len += op->noids;
+			}
+			break;
+		case MAFW_PLAYLIST_OP_REMOVE:
+			valid = op->arg > 0 && op->idx < len &&
+				op->arg <= len - op->idx;
+			if (valid) {
+				touched = op->idx;
+				len -= op->arg;
+			}
+			break;
+		case MAFW_PLAYLIST_OP_MOVE:
+			valid = op->idx < len && op->arg < len;
+			if (valid && op->idx != op->arg) {
+				touched = MIN(op->idx, op->arg);
+			}
+			break;
+		case MAFW_PLAYLIST_OP_CLEAR:
+			valid = TRUE;
+			if (len) {
+				touched = 0;
+				len = 0;
+			}
+			break;
+		case MAFW_PLAYLIST_OP_SET_REPEAT:
+		case MAFW_PLAYLIST_OP_SHUFFLE:
+		case MAFW_PLAYLIST_OP_UNSHUFFLE:
+			valid = TRUE;
+			break;
+		default:
+			valid = FALSE;
+			break;
+		}
+
+		if (results) {
+			results[i] = valid;
+		}
+		if (!valid) {
+			isok = FALSE;
+		} else if (touched < first) {
+			first = touched;
+		}
+	}
+
+	if (first_changed) {
+		*first_changed = isok ? first : G_MAXUINT;
+	}
+	if (!isok) {
+		return FALSE;
+	}
+
+	/* Nothing can fail from now on. */
+	for (i = 0; i < nops; i++) {
+		const PlsOp *op = &ops[i];
+
+		valid = TRUE;
+		switch (op->type) {
+		case MAFW_PLAYLIST_OP_INSERT:
+			valid = pls_inserts(pls, op->idx,
+					    (const gchar **)op->oids,
+					    op->noids);
+			break;
+		case MAFW_PLAYLIST_OP_APPEND:
+			valid = pls_appends(pls, (const gchar **)op->oids,
+					    op->noids);
+			break;
+		case MAFW_PLAYLIST_OP_REMOVE:
+			valid = pls_removes(pls, op->idx, op->arg);
+			break;
+		case MAFW_PLAYLIST_OP_MOVE:
+			valid = pls_move(pls, op->idx, op->arg);
+			break;
+		case MAFW_PLAYLIST_OP_CLEAR:
+			pls_clear(pls);
+			break;
+		case MAFW_PLAYLIST_OP_SET_REPEAT:
+			pls_set_repeat(pls, op->arg != 0);
+			break;
+		case MAFW_PLAYLIST_OP_SHUFFLE:
+			pls_shuffle(pls);
+			break;
+		case MAFW_PLAYLIST_OP_UNSHUFFLE:
+			pls_unshuffle(pls);
+			break;
+		}
+		g_assert(valid);
+	}
+
+	return TRUE;
+}
+
+/* Adds the changes of $pls made after $generation to $changes, oldest first.
+ * The PlsChange:s are owned by $pls.  Returns FALSE if the log doesn't go
+ * back that far, or $generation is not one $pls has had, in which case
+ * the client has to fetch the whole playlist again. */
+gboolean pls_changes_since(Pls *pls, guint generation, GPtrArray *changes)
+{
+	GList *l;
+
+	if (generation == pls->generation)
+		return TRUE;
+	if (!generation || generation < pls->log_since
+	    || generation > pls->generation)
+		return FALSE;
+	for (l = pls->changes.head; l; l = l->next) {
+		PlsChange *change = l->data;
+
+		if (change->generation > generation)
+			g_ptr_array_add(changes, change);
+	}
 	return TRUE;
 }
 
@@ -697,16 +1202,124 @@ gint pls_cmpids(gconstpointer a, gconstpointer b, gpointer unused)
 		return 1;
 }
 
-/* Playlists are saved in flat text files.  First there is a five line header,
+/* Returns how much memory the object ids of $pls take when unpacked. */
+static gsize unpacked_size(Pls *pls)
+{
+	return pls->bytes + pls->len + pls->alloc * sizeof(*pls->vidx);
+}
+
+/*
+ * Packs the object ids of $pls, NUL-terminated one after the other, into
+ * one block compressed with zlib, and frees them and $pls->vidx.  Returns
+ * whether it did, which it doesn't if the block wouldn't be smaller or the
+ * playlist is paged out.
+ * The playlist must be unpacked by pls_unpack() before anything else is
+ * done with it, except pls_free().
+ */
+gboolean pls_pack(Pls *pls)
+{
+	GOutputStream *mem, *out;
+	GConverter *zlib;
+	gboolean ok;
+	gsize size;
+	guint i;
+
+	if (pls->packed || pls->pages || !pls->len)
+		return FALSE;
+
+	mem = g_memory_output_stream_new(NULL, 0, g_realloc, g_free);
+	zlib = G_CONVERTER(g_zlib_compressor_new(G_ZLIB_COMPRESSOR_FORMAT_RAW,
+						 -1));
+	out = g_converter_output_stream_new(mem, zlib);
+	ok = TRUE;
+	for (i = 0; ok && i < pls->len; i++)
+		ok = g_output_stream_write_all(out, pls->vidx[i],
+					       strlen(pls->vidx[i]) + 1,
+					       NULL, NULL, NULL);
+	ok = g_output_stream_close(out, NULL, NULL) && ok;
+
+	size = g_memory_output_stream_get_data_size(
+				G_MEMORY_OUTPUT_STREAM(mem));
+	if (ok && size < unpacked_size(pls)) {
+		pls->packed = g_memory_output_stream_steal_data(
+					G_MEMORY_OUTPUT_STREAM(mem));
+		pls->packed_len = size;
+		pls->packed_raw = pls->bytes + pls->len;
+		for (i = 0; i < pls->len; i++)
+			g_free(pls->vidx[i]);
+		g_free(pls->vidx);
+		pls->vidx = NULL;
+	}
+	g_object_unref(out);
+	g_object_unref(zlib);
+	g_object_unref(mem);
+	return pls->packed != NULL;
+}
+
+/* Undoes pls_pack(). */
+void pls_unpack(Pls *pls)
+{
+	GInputStream *mem, *in;
+	GConverter *zlib;
+	gchar *raw, *p;
+	gsize got;
+	guint i;
+
+	if (!pls->packed)
+		return;
+
+	raw = g_malloc(pls->packed_raw);
+	mem = g_memory_input_stream_new_from_data(pls->packed,
+						  pls->packed_len, NULL);
+	zlib = G_CONVERTER(g_zlib_decompressor_new(
+					G_ZLIB_COMPRESSOR_FORMAT_RAW));
+	in = g_converter_input_stream_new(mem, zlib);
+	if (!g_input_stream_read_all(in, raw, pls->packed_raw, &got,
+				     NULL, NULL)
+	    || got != pls->packed_raw)
+		g_error("playlist %u: packed items are corrupt", pls->id);
+	g_object_unref(in);
+	g_object_unref(zlib);
+	g_object_unref(mem);
+
+	pls->vidx = g_new(gchar *, pls->alloc);
+	for (p = raw, i = 0; i < pls->len; i++) {
+		pls->vidx[i] = g_strdup(p);
+		p += strlen(p) + 1;
+	}
+	g_free(raw);
+	g_free(pls->packed);
+	pls->packed = NULL;
+	pls->packed_len = pls->packed_raw = 0;
+}
+
+/* Frees what pls_get_items() or pls_get_items_budget() returned for $pls. */
+void pls_items_free(Pls *pls, gchar **oids)
+{
+	if (pls->pages) {
+		g_strfreev(oids);
+	} else {
+		g_free(oids);
+	}
+}
+
+/* Returns how much memory packing $pls saves now. */
+gsize pls_pack_savings(Pls *pls)
+{
+	return pls->packed ? unpacked_size(pls) - pls->packed_len : 0;
+}
+
+/* Playlists are saved in flat text files.  First there is a header,
  * consisting of:
  *
- * version: "V" + an integer (last version is 2)
+ * version: "V" + an integer (last version is 3)
  * id: integer > 0
  * name: string, everything until newline
  * repeat: integer, 0 or 1
  * shuffle: integer, 0 or 1
  * length: integer > 0
- * pool start: integer > 0 && <= length
+ * pool start: integer > 0 && <= length (since version 2)
+ * generation: integer > 0 (since version 3)
  *
  * Then items follow, one per line:
  *
@@ -714,21 +1327,12 @@ gint pls_cmpids(gconstpointer a, gconstpointer b, gpointer unused)
  *
  * where pidx is a non-negative integer, equivalent to pidx[n] of the in-core
  * Pls structure, and uuid is a string lasting till the end of the line.
+ *
+ * pls_write() writes this format to $f, returning whether it succeeded.
  */
-gboolean pls_save(Pls *pls, const gchar *fn)
+gboolean pls_write(Pls *pls, FILE *f)
 {
-	FILE *f;
 	guint i;
-	gchar *tmpf;
-	gboolean isok, tmpok;
-
-	/* First write the playlist into a temporary file, then move it over
-	 * the requested filename. */
-	tmpok = isok = FALSE;
-	tmpf = g_strdup_printf("%s.tmp", fn);
-	if (!(f = fopen(tmpf, "w+"))) {
-		goto out1;
-        }
 
 	if (fprintf(f,
 		    "V" APLAYLIST_VERSION "\n"
@@ -737,33 +1341,66 @@ gboolean pls_save(Pls *pls, const gchar *fn)
 		    "%d\n"
                     "%d\n"
 		    "%u\n"
-                    "%u\n",
+                    "%u\n"
+		    "%u\n",
 		    pls->id,
 		    pls->name,
 		    pls->repeat,
 		    pls->shuffled,
 		    pls->len,
-                    pls->poolst) < 0) {
-		goto out2;
+                    pls->poolst,
+		    pls->generation) < 0) {
+		return FALSE;
         }
 
-        if (pls->shuffled) {
-                for (i = 0; i < pls->len; ++i) {
-                        if (fprintf(f, "%u,%s\n",
-                                    pls->pidx[i], pls->vidx[i]) < 0) {
-                                goto out2;
-                        }
-                }
-        } else {
-                for (i = 0; i < pls->len; ++i) {
-                        if (fprintf(f, "%u,%s\n", i, pls->vidx[i]) < 0) {
-                                goto out2;
-                        }
-                }
+	for (i = 0; i < pls->len; ++i) {
+		gchar *oid;
+		gint ret;
+
+		oid = pls->pages ? item(pls, i) : pls->vidx[i];
+		ret = fprintf(f, "%u,%s\n",
+			      pls->shuffled ? pls->pidx[i] : i, oid);
+		if (pls->pages) {
+			g_free(oid);
+		}
+		if (ret < 0) {
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+/* Saves $pls in $fn in the format above. */
+gboolean pls_save(Pls *pls, const gchar *fn)
+{
+	FILE *f;
+	gchar *tmpf;
+	gboolean isok, tmpok;
+	long bytes;
+	gint64 synced;
+
+	/* First write the playlist into a temporary file, then move it over
+	 * the requested filename. */
+	tmpok = isok = FALSE;
+	bytes = -1;
+	tmpf = g_strdup_printf("%s.tmp", fn);
+	if (!(f = fopen(tmpf, "w+"))) {
+		goto out1;
         }
+
+	if (!pls_write(pls, f)) {
+		fclose(f);
+		goto out2;
+	}
 	/* Try to minimize data loss. */
 	fflush(f);
+	bytes = ftell(f);
+	synced = g_get_monotonic_time();
 	fsync(fileno(f));
+	synced = g_get_monotonic_time() - synced;
+	Save_stats.fsync_usec += synced;
+	if (Save_stats.fsync_max_usec < synced)
+		Save_stats.fsync_max_usec = synced;
 	if (fclose(f) != 0) {
 		goto out2;
         }
@@ -779,6 +1416,8 @@ gboolean pls_save(Pls *pls, const gchar *fn)
 	/* XXX: we might need to fsync() the fd of the containing
 	 * directory... See fsync(2). */
 	isok = TRUE;
+	if (bytes > 0)
+		Save_stats.bytes += bytes;
 
 out2:	if (!tmpok) {
 		if (unlink(tmpf) == -1) {
@@ -787,6 +1426,9 @@ out2:	if (!tmpok) {
 	}
 
 out1:	g_free(tmpf);
+	Save_stats.saves++;
+	if (!isok)
+		Save_stats.failures++;
 	return isok;
 }
 
@@ -813,8 +1455,10 @@ Pls *pls_load(const gchar *fn)
 	Pls *p;
 	FILE *f;
 	gint version, id, repeat, shuffled, len, poolst;
+	guint generation;
 	gchar *name;
 	guint i;
+	struct stat st;
 
 	p = NULL;
 	name = NULL;
@@ -832,10 +1476,10 @@ Pls *pls_load(const gchar *fn)
 		goto out1;
         }
 
-	/* Latest version is 2, though this function is able to manage v1 too.
-	 * If format changes in the future, you'll need to change this code, and
-	 * care about backward compatibility. */
-	if (version != 1 && version != 2) {
+	/* Latest version is 3, though this function is able to manage v1 and
+	 * v2 too.  If format changes in the future, you'll need to change this
+	 * code, and care about backward compatibility. */
+	if (version < 1 || version > 3) {
 		goto out1;
         }
 
@@ -874,7 +1518,7 @@ Pls *pls_load(const gchar *fn)
         }
 
         /* Read pool start; version >=2 */
-        if (version == 2) {
+        if (version >= 2) {
                 if (!fgetsnl(buf, sizeof(buf), f) ||
                     sscanf(buf, "%d", &poolst) != 1 ||
                     poolst < 0) {
@@ -886,10 +1530,22 @@ Pls *pls_load(const gchar *fn)
 
         }
 
+	/* Read generation; version >= 3 */
+	generation = 1;
+	if (version >= 3) {
+		if (!fgetsnl(buf, sizeof(buf), f) ||
+		    sscanf(buf, "%u", &generation) != 1 ||
+		    !generation) {
+			goto out2;
+		}
+	}
+
 	p = pls_new(id, name);
 	p->repeat = repeat;
 	p->shuffled = shuffled;
         p->poolst = poolst;
+	/* Clients may sync from the generation saved. */
+	p->generation = p->log_since = generation;
 	maybe_realloc(p, len);
 
         /* Read entries */
@@ -911,7 +1567,12 @@ Pls *pls_load(const gchar *fn)
                         goto out2;
                 }
 
-                p->vidx[i] = oid;
+		p->bytes += strlen(oid);
+		if (p->pages) {
+			pages_adopt(p->pages, i, &oid, 1);
+		} else {
+			p->vidx[i] = oid;
+		}
 
                 if (p->shuffled) {
                         p->pidx[i] = pidx;
@@ -922,6 +1583,8 @@ Pls *pls_load(const gchar *fn)
 	/* We don't really want to detect if the file has more items than
 	 * $len... */
 	p->len = i;
+	if (fstat(fileno(f), &st) == 0)
+		p->mtime = st.st_mtime;
 
 out2:   free(name);
 
@@ -930,4 +1593,160 @@ out1:   fclose(f);
 	return p;
 }
 
+/* Playlist directory */
+
+/* Default location to save playlists. */
+#define DEFAULT_PLS_DIR		".mafw-playlists"
+
+/* Returns the directory where playlists will be saved.  It defaults to
+ * $HOME/DEFAULT_PLS_DIR, but can be overridden via the $MAFW_PLAYLIST_DIR
+ * environment variable.  The returned string points to a static storage and
+ * must not be freed. */
+const gchar *pls_dir(void)
+{
+	static gchar *playlist_dir;
+	const gchar *home, *pld;
+
+	if (playlist_dir)
+		return playlist_dir;
+	pld = g_getenv("MAFW_PLAYLIST_DIR");
+	if (pld) {
+		playlist_dir = g_strdup(pld);
+	} else {
+		home = g_getenv("HOME");
+		if (!home)
+			home = g_get_home_dir();
+		playlist_dir = g_build_filename(home, DEFAULT_PLS_DIR, NULL);
+	}
+	return playlist_dir;
+}
+
+/* Makes sure that the playlist directory exists, returns FALSE if it can't. */
+gboolean pls_ensure_dir(void)
+{
+	if (mkdir(pls_dir(), 0700) == -1 && errno != EEXIST) {
+		g_critical("failed to ensure existence of playlist directory"
+			   ", playlists cannot be saved. %s: (%s)",
+			   pls_dir(), g_strerror(errno));
+		return FALSE;
+	} else
+		return TRUE;
+}
+
+/* Takes an advisory lock on the playlist directory for the rest of our
+ * life, so that the daemon and embedded stores (see mafw-playlist-store.c)
+ * never write the same files.  Returns FALSE if another process holds it
+ * or the directory can't be locked.  Taking it again is a no-op. */
+gboolean pls_lock_dir(void)
+{
+	static gint fd = -1;
+
+	if (fd >= 0)
+		return TRUE;
+	if (!pls_ensure_dir())
+		return FALSE;
+	if ((fd = open(pls_dir(), O_RDONLY)) < 0) {
+		g_critical("failed to open playlist directory %s: %s",
+			   pls_dir(), g_strerror(errno));
+		return FALSE;
+	}
+	if (flock(fd, LOCK_EX | LOCK_NB) < 0) {
+		g_critical("failed to lock playlist directory %s: %s",
+			   pls_dir(), errno == EWOULDBLOCK
+			   ? "used by another process" : g_strerror(errno));
+		close(fd);
+		fd = -1;
+		return FALSE;
+	}
+	fcntl(fd, F_SETFD, FD_CLOEXEC);
+	return TRUE;
+}
+
+/* Returns the name of the file playlist $id is saved in, to be freed. */
+gchar *pls_path(guint id)
+{
+	return g_strdup_printf("%s" G_DIR_SEPARATOR_S "%u", pls_dir(), id);
+}
+
+/* Loads every playlist saved in pls_dir(), handing them to $loaded.
+ * Files with a '.' in their name, like the definitions of smart.c,
+ * are not playlists. */
+void pls_load_dir(PlsLoadedFunc loaded, gpointer udata)
+{
+	GDir *d;
+	const gchar *fn;
+
+	d = g_dir_open(pls_dir(), 0, NULL);
+	if (!d) {
+		if (errno != ENOENT)
+			g_critical("failed to open playlist directory: %s",
+				   g_strerror(errno));
+		return;
+	}
+	/* Handle the case where the final rename() of a previously written
+	 * playlist failed: if $fn ends with '.tmp' do the renaming now, then
+	 * load the playlists. */
+	while ((fn = g_dir_read_name(d))) {
+		gchar *dot;
+
+		if ((dot = strrchr(fn, '.')) && dot != fn) {
+			gchar *nufn;
+			struct stat sb;
+			gint statret;
+
+			if (strcmp(dot, ".tmp"))
+				continue;
+			/* Minor sanity check: we accept only nonempty regular
+			 * files.  Otherwise we try to unlink the file, to avoid
+			 * future hassle. */
+			statret = stat(fn, &sb);
+			if ( statret == -1 ||
+			    ( (statret != -1) && (!S_ISREG(sb.st_mode) ||
+			    				sb.st_size == 0)))
+			{
+				g_unlink(fn);
+				continue;
+			}
+			nufn = g_strndup(fn, dot - fn);
+			rename(fn, nufn);
+			g_free(nufn);
+		}
+	}
+	g_dir_close(d);
+
+	/* The second open should succeed unconditionally... */
+	if (!pls_load_from(pls_dir(), loaded, udata))
+		g_assert_not_reached();
+}
+
+/* Like pls_load_dir(), but loads the playlists saved in $dir, like a
+ * backup, as they are.  Returns FALSE if $dir can't be read. */
+gboolean pls_load_from(const gchar *dir, PlsLoadedFunc loaded, gpointer udata)
+{
+	GDir *d;
+	const gchar *fn;
+
+	if (!(d = g_dir_open(dir, 0, NULL)))
+		return FALSE;
+	initialize = TRUE;
+	while ((fn = g_dir_read_name(d))) {
+		Pls *pls;
+		gchar *fullfn;
+
+		if (strchr(fn, '.'))
+			continue;
+		fullfn = g_build_filename(dir, fn, NULL);
+		pls = pls_load(fullfn);
+		g_free(fullfn);
+		if (!pls) {
+			g_warning("failed to load from: %s", fn);
+			continue;
+		}
+		loaded(pls, udata);
+	}
+	initialize = FALSE;
+	g_dir_close(d);
+	return TRUE;
+}
+
 /* vi: set noexpandtab ts=8 sw=8 cino=t0,(0: */
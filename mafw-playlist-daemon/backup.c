@@ -0,0 +1,434 @@
+/*
+ * This file is a part of MAFW
+ *
+ * Copyright (C) 2007, 2008, 2009 Nokia Corporation, all rights reserved.
+ *
+ * Contact: Visa Smolander <visa.smolander@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+
+#include "common/mafw-dbus.h"
+#include "mpd-internal.h"
+
+#undef G_LOG_DOMAIN
+#define G_LOG_DOMAIN "mafw-playlist-backup"
+
+/*
+ * Hot backups.  backup_start() writes every playlist into a directory
+ * from a thread of its own while the daemon goes on serving requests.
+ * The backup holds the playlists as they were when it was asked for:
+ * their set is fixed then, and a playlist about to be changed before
+ * the writer got to it is copied first by backup_touch(), which is
+ * called by everything changing playlists: cold_lock() for writing,
+ * cold_thaw() and destroying.  The writer copies each playlist in
+ * memory with its lock held for reading, then writes it out with the
+ * locks released.
+ *
+ * A backup is written into "$path.new", which is renamed to $path when
+ * complete, so $path always holds a whole backup.  It has the layout of
+ * pls_dir(), smart playlist definitions included, so pls_load_from()
+ * can read it back.
+ */
+
+/*
+ * A playlist to back up.
+ *
+ * @plid:      its id
+ * @text:      its copy in the format of pls_write(), if it was made by
+ *             backup_touch(), otherwise %NULL
+ * @len:       length of @text
+ * @taken:     whether the writer has got to it
+ * @smart:     its smart playlist definition, or %NULL
+ * @smart_len: length of @smart
+ */
+typedef struct {
+	guint plid;
+	gchar *text;
+	gsize len;
+	gboolean taken;
+	gchar *smart;
+	gsize smart_len;
+} Snapshot;
+
+/*
+ * A backup in progress.
+ *
+ * @oci:    the request, answered when the backup is done
+ * @path:   where to write it
+ * @tmp:    where it's being written
+ * @snaps:  the Snapshot of each playlist
+ * @by_id:  the same, keyed by playlist id
+ * @thread: the writer
+ * @error:  why the backup failed
+ */
+typedef struct {
+	MafwDBusOpCompletedInfo *oci;
+	gchar *path;
+	gchar *tmp;
+	GPtrArray *snaps;
+	GHashTable *by_id;
+	GThread *thread;
+	GError *error;
+} Backup;
+
+/* The backup in progress, set and cleared by the main thread. */
+static Backup *Current;
+/* Protects $Current->error and the Snapshots from backup_touch(). */
+static GMutex Lock;
+
+/* Tells whether $fn is the name of a file a backup consists of. */
+static gboolean backup_file(const gchar *fn)
+{
+	gsize digits;
+
+	digits = strspn(fn, "0123456789");
+	return digits && (!fn[digits] || !strcmp(&fn[digits], ".smart"));
+}
+
+/* Tells whether $dir is a backup, or doesn't exist, so it can be
+ * replaced. */
+static gboolean replaceable(const gchar *dir)
+{
+	GDir *d;
+	const gchar *fn;
+	gboolean ret;
+
+	if (!(d = g_dir_open(dir, 0, NULL)))
+		return !g_file_test(dir, G_FILE_TEST_EXISTS);
+	ret = TRUE;
+	while (ret && (fn = g_dir_read_name(d)))
+		ret = backup_file(fn);
+	g_dir_close(d);
+	return ret;
+}
+
+/* Deletes the backup in $dir, if it exists.  Anything else in $dir is
+ * left alone, and then $dir too. */
+static void remove_dir(const gchar *dir)
+{
+	GDir *d;
+	const gchar *fn;
+
+	if (!(d = g_dir_open(dir, 0, NULL)))
+		return;
+	while ((fn = g_dir_read_name(d))) {
+		gchar *path;
+
+		if (!backup_file(fn))
+			continue;
+		path = g_build_filename(dir, fn, NULL);
+		g_unlink(path);
+		g_free(path);
+	}
+	g_dir_close(d);
+	g_rmdir(dir);
+}
+
+/* Records that $b failed doing $what because of $errno, unless it failed
+ * already. */
+static void fail(Backup *b, const gchar *what)
+{
+	gint saved;
+
+	saved = errno;
+	g_mutex_lock(&Lock);
+	if (!b->error)
+		b->error = g_error_new(G_IO_ERROR,
+				       g_io_error_from_errno(saved),
+				       "%s: %s", what, g_strerror(saved));
+	g_mutex_unlock(&Lock);
+}
+
+/* Tells whether $b has failed. */
+static gboolean failed(Backup *b)
+{
+	gboolean ret;
+
+	g_mutex_lock(&Lock);
+	ret = b->error != NULL;
+	g_mutex_unlock(&Lock);
+	return ret;
+}
+
+/* Returns a copy of $pls in the format of pls_write() and its length in
+ * $len, or %NULL.  The caller keeps $pls from changing meanwhile. */
+static gchar *capture(Pls *pls, gsize *len)
+{
+	FILE *f;
+	gchar *text;
+	gboolean ok;
+
+	text = NULL;
+	if (!(f = open_memstream(&text, len)))
+		return NULL;
+	ok = pls_write(pls, f);
+	if (fclose(f) != 0 || !ok) {
+		free(text);
+		return NULL;
+	}
+	return text;
+}
+
+/* Writes $len bytes of $text into $fn in the directory of $b. */
+static void write_file(Backup *b, const gchar *fn, const gchar *text,
+		       gsize len)
+{
+	FILE *f;
+	gchar *path;
+	gboolean ok;
+
+	path = g_build_filename(b->tmp, fn, NULL);
+	if (!(f = fopen(path, "w"))) {
+		fail(b, path);
+		g_free(path);
+		return;
+	}
+	ok = fwrite(text, 1, len, f) == len && fflush(f) == 0
+		&& fsync(fileno(f)) == 0;
+	if (fclose(f) != 0 || !ok)
+		fail(b, path);
+	g_free(path);
+}
+
+/* Backs up the playlist of $snap. */
+static void write_snapshot(Backup *b, Snapshot *snap)
+{
+	Pls *pls;
+	gchar *text, *fn;
+	gsize len;
+
+	/* Hold off backup_touch() of the playlist until we have our copy,
+	 * unless it has made one already. */
+	playlists_read_lock();
+	pls = g_tree_lookup(Playlists, GUINT_TO_POINTER(snap->plid));
+	if (pls)
+		cold_lock(pls, TRUE);
+	g_mutex_lock(&Lock);
+	text = snap->text;
+	len = snap->len;
+	snap->text = NULL;
+	snap->taken = TRUE;
+	g_mutex_unlock(&Lock);
+	if (!text && pls && !(text = capture(pls, &len))) {
+		errno = ENOMEM;
+		fail(b, "copying a playlist");
+	}
+	if (pls)
+		g_rw_lock_reader_unlock(&pls->lock);
+	playlists_read_unlock();
+
+	if (text) {
+		fn = g_strdup_printf("%u", snap->plid);
+		write_file(b, fn, text, len);
+		g_free(fn);
+		free(text);
+	}
+	if (snap->smart) {
+		fn = g_strdup_printf("%u.smart", snap->plid);
+		write_file(b, fn, snap->smart, snap->smart_len);
+		g_free(fn);
+	}
+}
+
+/* Main thread callback of writer(), answers the request of $b. */
+static gboolean backup_done(Backup *b)
+{
+	guint i;
+
+	g_mutex_lock(&Lock);
+	g_atomic_pointer_set(&Current, NULL);
+	g_mutex_unlock(&Lock);
+	g_thread_join(b->thread);
+
+	if (b->error)
+		g_warning("backup to %s failed: %s", b->path,
+			  b->error->message);
+	mafw_dbus_ack_or_error(b->oci->con, b->oci->msg, b->error);
+	mafw_dbus_oci_free(b->oci);
+	for (i = 0; i < b->snaps->len; i++) {
+		Snapshot *snap;
+
+		snap = b->snaps->pdata[i];
+		free(snap->text);
+		g_free(snap->smart);
+		g_free(snap);
+	}
+	g_ptr_array_free(b->snaps, TRUE);
+	g_hash_table_destroy(b->by_id);
+	g_free(b->path);
+	g_free(b->tmp);
+	g_free(b);
+	return FALSE;
+}
+
+/* Thread function writing the backup $b and putting it in place. */
+static gpointer writer(Backup *b)
+{
+	guint i;
+	gchar *old;
+
+	for (i = 0; i < b->snaps->len && !failed(b); i++)
+		write_snapshot(b, b->snaps->pdata[i]);
+
+	/* Keep the previous backup until this one is in place. */
+	old = g_strconcat(b->path, ".old", NULL);
+	remove_dir(old);
+	if (!failed(b) && rename(b->path, old) == -1 && errno != ENOENT)
+		fail(b, b->path);
+	if (!failed(b) && rename(b->tmp, b->path) == -1) {
+		fail(b, b->tmp);
+		rename(old, b->path);
+	}
+	remove_dir(old);
+	g_free(old);
+	if (failed(b))
+		remove_dir(b->tmp);
+
+	g_idle_add((GSourceFunc)backup_done, b);
+	return NULL;
+}
+
+/* Tree traversal callback adding $pls to the Backup $b. */
+static gboolean add_snapshot(gpointer id, Pls *pls, Backup *b)
+{
+	Snapshot *snap;
+	gchar *fn;
+
+	snap = g_new0(Snapshot, 1);
+	snap->plid = pls->id;
+	/* Definitions don't change, only come and go with their playlist. */
+	if (pls->smart) {
+		fn = smart_path(pls->id);
+		g_file_get_contents(fn, &snap->smart, &snap->smart_len, NULL);
+		g_free(fn);
+	}
+	g_ptr_array_add(b->snaps, snap);
+	g_hash_table_insert(b->by_id, GUINT_TO_POINTER(pls->id), snap);
+	return FALSE;
+}
+
+/**
+ * backup_start:
+ * @con:  the connection of @req
+ * @req:  the request asking for the backup
+ * @path: the directory to back up the playlists into
+ * @err:  where to put the error
+ *
+ * Starts backing up all playlists into @path, replacing what was there,
+ * and answers @req when done.  Only one backup can run at a time.  To
+ * be called from the main thread, with the workers excluded.
+ *
+ * Returns: whether the backup has started; if not @req is to be
+ * answered with @err.
+ */
+gboolean backup_start(DBusConnection *con, DBusMessage *req,
+		      const gchar *path, GError **err)
+{
+	Backup *b;
+
+	if (Current) {
+		g_set_error(err, G_IO_ERROR, G_IO_ERROR_BUSY,
+			    "A backup is in progress already");
+		return FALSE;
+	}
+	if (!g_path_is_absolute(path)) {
+		g_set_error(err, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+			    "Not an absolute path: %s", path);
+		return FALSE;
+	}
+	if (!replaceable(path)) {
+		g_set_error(err, G_IO_ERROR, G_IO_ERROR_EXISTS,
+			    "Not a playlist backup: %s", path);
+		return FALSE;
+	}
+
+	b = g_new0(Backup, 1);
+	b->path = g_strdup(path);
+	b->tmp = g_strconcat(path, ".new", NULL);
+	/* Left behind by a backup interrupted by an exit. */
+	remove_dir(b->tmp);
+	if (g_mkdir(b->tmp, 0700) == -1) {
+		gint saved = errno;
+
+		g_set_error(err, G_IO_ERROR, g_io_error_from_errno(saved),
+			    "%s: %s", b->tmp, g_strerror(saved));
+		g_free(b->tmp);
+		g_free(b->path);
+		g_free(b);
+		return FALSE;
+	}
+	b->snaps = g_ptr_array_new();
+	b->by_id = g_hash_table_new(NULL, NULL);
+	g_tree_foreach(Playlists, (GTraverseFunc)add_snapshot, b);
+	b->oci = mafw_dbus_oci_new(con, req);
+
+	g_atomic_pointer_set(&Current, b);
+	b->thread = g_thread_new("backup", (GThreadFunc)writer, b);
+	return TRUE;
+}
+
+/**
+ * backup_running:
+ *
+ * Tells whether a backup is in progress.  For the main thread.
+ */
+gboolean backup_running(void)
+{
+	return Current != NULL;
+}
+
+/**
+ * backup_touch:
+ * @pls: a playlist
+ *
+ * Notes that @pls may be about to change, so if a backup is in progress
+ * and hasn't got to it yet, copies it.  The caller holds the lock of
+ * @pls for writing or, in the main thread, playlists_lock().
+ */
+void backup_touch(Pls *pls)
+{
+	Snapshot *snap;
+
+	if (!g_atomic_pointer_get(&Current))
+		return;
+	g_mutex_lock(&Lock);
+	if (Current
+	    && (snap = g_hash_table_lookup(Current->by_id,
+					   GUINT_TO_POINTER(pls->id)))
+	    && !snap->taken && !snap->text
+	    && !(snap->text = capture(pls, &snap->len))
+	    && !Current->error)
+		Current->error = g_error_new(G_IO_ERROR, G_IO_ERROR_FAILED,
+					     "Out of memory copying "
+					     "playlist %u", pls->id);
+	g_mutex_unlock(&Lock);
+}
+
+/* vi: set noexpandtab ts=8 sw=8 cino=t0,(0: */
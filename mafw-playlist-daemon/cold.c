@@ -0,0 +1,218 @@
+/*
+ * This file is a part of MAFW
+ *
+ * Copyright (C) 2007, 2008, 2009 Nokia Corporation, all rights reserved.
+ *
+ * Contact: Visa Smolander <visa.smolander@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+#include <stdlib.h>
+#include <glib.h>
+
+#include "mpd-internal.h"
+
+#undef G_LOG_DOMAIN
+#define G_LOG_DOMAIN "mafw-playlist-cold"
+
+/*
+ * Cold playlists.  Playlists not accessed for $MAFW_PLAYLIST_COLD_SECS
+ * seconds (%COLD_DEFAULT_SECS by default, 0 disables) are packed by
+ * pls_pack(), and unpacked when they are accessed next.  Playlists
+ * in use by a renderer, ones waiting to be saved and small ones are
+ * left alone.  Packing drops the metadata totals of the playlist, which
+ * are computed again when asked for.
+ *
+ * Playlists are packed in the main thread with the workers excluded,
+ * and unpacked by whichever thread accesses them first, see
+ * cold_lock().
+ *
+ * Very large playlists are paged out instead, see pages.c: those having
+ * at least $MAFW_PLAYLIST_PAGED_ENTRIES items (%PAGED_DEFAULT_ENTRIES by
+ * default, 0 disables) keep their object ids on disk, with at most
+ * $MAFW_PLAYLIST_PAGED_RESIDENT pages of each in memory.
+ */
+
+/* Environment variable holding the number of seconds. */
+#define COLD_ENV		"MAFW_PLAYLIST_COLD_SECS"
+#define COLD_DEFAULT_SECS	1800
+
+/* Playlists with less object id bytes than this aren't packed. */
+#define COLD_MIN_BYTES		4096
+
+#define PAGED_ENV		"MAFW_PLAYLIST_PAGED_ENTRIES"
+#define PAGED_DEFAULT_ENTRIES	(1 << 18)
+#define PAGED_RESIDENT_ENV	"MAFW_PLAYLIST_PAGED_RESIDENT"
+#define PAGED_DEFAULT_RESIDENT	32
+
+static guint Cold_secs;
+static ColdStats Stats;
+G_LOCK_DEFINE_STATIC(Stats);
+
+/* Returns the current time in monotonic seconds. */
+static gint now(void)
+{
+	return g_get_monotonic_time() / G_USEC_PER_SEC;
+}
+
+/* Unpacks $pls, which the caller has exclusive access to. */
+static void thaw(Pls *pls)
+{
+	gint64 usec;
+
+	usec = g_get_monotonic_time();
+	pls_unpack(pls);
+	usec = g_get_monotonic_time() - usec;
+
+	G_LOCK(Stats);
+	Stats.unpacks++;
+	Stats.unpack_usec += usec;
+	if (Stats.unpack_max_usec < usec)
+		Stats.unpack_max_usec = usec;
+	G_UNLOCK(Stats);
+}
+
+/* Tree traversal callback packing $pls if it's cold since $deadline. */
+static gboolean pack_cb(gpointer id, Pls *pls, gint *deadline)
+{
+	if (!pls->atime) {
+		/* Loaded or created since the last scan. */
+		pls->atime = now();
+		return FALSE;
+	}
+	if (pls->packed || pls->dirty || pls->use_count
+	    || pls->bytes < COLD_MIN_BYTES || pls->atime > *deadline)
+		return FALSE;
+	if (pls_pack(pls)) {
+		mdcache_forget(pls->id);
+		G_LOCK(Stats);
+		Stats.packs++;
+		G_UNLOCK(Stats);
+	}
+	return FALSE;
+}
+
+/* Periodically packs the playlists gone cold. */
+static gboolean scan(gpointer unused)
+{
+	gint deadline;
+
+	deadline = now() - Cold_secs;
+	playlists_lock();
+	g_tree_foreach(Playlists, (GTraverseFunc)pack_cb, &deadline);
+	playlists_unlock();
+	return TRUE;
+}
+
+/**
+ * cold_init:
+ *
+ * Reads the interval and the paging limits from the environment and
+ * starts watching the playlists.  To be called before loading them.
+ */
+void cold_init(void)
+{
+	const gchar *env;
+	guint entries, resident;
+
+	env = g_getenv(COLD_ENV);
+	Cold_secs = env ? strtoul(env, NULL, 10) : COLD_DEFAULT_SECS;
+	if (Cold_secs)
+		g_timeout_add_seconds(MAX(Cold_secs / 4, 1), scan, NULL);
+
+	env = g_getenv(PAGED_ENV);
+	entries = env ? strtoul(env, NULL, 10) : PAGED_DEFAULT_ENTRIES;
+	env = g_getenv(PAGED_RESIDENT_ENV);
+	resident = env ? strtoul(env, NULL, 10) : PAGED_DEFAULT_RESIDENT;
+	pls_set_paging(entries, resident);
+}
+
+/**
+ * cold_lock:
+ * @pls:    a playlist
+ * @reader: whether to lock it for reading only
+ *
+ * Takes the lock of @pls for reading or writing, unpacking it first if
+ * it's packed, and notes it has been accessed.  Writers are assumed to
+ * change @pls, see backup_touch().  To be undone by
+ * g_rw_lock_reader_unlock() or g_rw_lock_writer_unlock().  Can be
+ * called from the workers.
+ */
+void cold_lock(Pls *pls, gboolean reader)
+{
+	for (;;) {
+		if (reader)
+			g_rw_lock_reader_lock(&pls->lock);
+		else
+			g_rw_lock_writer_lock(&pls->lock);
+		g_atomic_int_set(&pls->atime, now());
+		if (!reader) {
+			if (pls->packed)
+				thaw(pls);
+			backup_touch(pls);
+			return;
+		}
+		if (!pls->packed)
+			return;
+
+		/* Unpacking needs the writer lock, and a reader can't
+		 * upgrade.  The playlist can't be packed again meanwhile
+		 * because we hold off the main thread. */
+		g_rw_lock_reader_unlock(&pls->lock);
+		g_rw_lock_writer_lock(&pls->lock);
+		if (pls->packed)
+			thaw(pls);
+		g_rw_lock_writer_unlock(&pls->lock);
+	}
+}
+
+/**
+ * cold_thaw:
+ * @pls: a playlist
+ *
+ * Like cold_lock(), but for the main thread accessing @pls without
+ * taking its lock, maybe to change it.
+ */
+void cold_thaw(Pls *pls)
+{
+	g_atomic_int_set(&pls->atime, now());
+	if (!pls->packed && !backup_running())
+		return;
+	playlists_lock();
+	if (pls->packed)
+		thaw(pls);
+	backup_touch(pls);
+	playlists_unlock();
+}
+
+/**
+ * cold_get_stats:
+ * @stats: where to store the statistics
+ *
+ * Tells the statistics of packing.
+ */
+void cold_get_stats(ColdStats *stats)
+{
+	G_LOCK(Stats);
+	*stats = Stats;
+	G_UNLOCK(Stats);
+}
+
+/* vi: set noexpandtab ts=8 sw=8 cino=t0,(0: */
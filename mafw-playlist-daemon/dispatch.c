@@ -0,0 +1,643 @@
+/*
+ * This file is a part of MAFW
+ *
+ * Copyright (C) 2007, 2008, 2009 Nokia Corporation, all rights reserved.
+ *
+ * Contact: Visa Smolander <visa.smolander@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+#include <string.h>
+#include <glib.h>
+#include <dbus/dbus.h>
+
+#include <libmafw/mafw-errors.h>
+
+#include "common/mafw-dbus.h"
+#include "common/dbus-interface.h"
+#include "libmafw-shared/mafw-playlist-manager.h"
+#include "mpd-internal.h"
+
+/*
+ * Request scheduling.  Requests are divided into classes:
+ *
+ * %DISPATCH_INTERACTIVE: what renderers need at track boundaries,
+ *			  handled at once
+ * %DISPATCH_NORMAL:	  everything else, handled at once as well
+ * %DISPATCH_BULK:	  requests whose cost grows with the size of
+ *			  playlists, queued and handled one per main loop
+ *			  iteration, when there is nothing else to do
+ *
+ * So an interactive request arriving after a bulk one is answered first.
+ * Bulk edits like apply_ops, concat, copy_range and duplicate_playlist
+ * are transactions other clients must not see half done, so each runs
+ * to completion in the iteration that takes it.  Bulk reads (get_items,
+ * get_items_with_metadata, list_playlists_full) are sliced instead: their
+ * handlers build the reply a slice per main loop iteration through
+ * dispatch_slice(), and requests arriving meanwhile are answered in
+ * between.  A read seeing the playlist change between two of its slices
+ * starts over and finishes at once, so that constant editing can't hold
+ * off its reply.  Imports, which are not replied to until finished,
+ * proceed in steps as well, see plparse_read() and browse_next_page().
+ * Requests of a client are still handled in the order it sent them: once
+ * a client has a queued or sliced request, all of its further requests
+ * are queued behind it.  A client can't have more than
+ * quota_limits()->requests requests queued.
+ *
+ * With dispatch_set_threads() the requests reading a single playlist
+ * (see Parallel[]) are handed to a pool of worker threads instead of
+ * being handled in the main loop.  A client has at most one request in
+ * the pool; until it is answered the client's further requests are
+ * queued as above.  The locking rules are:
+ *
+ * -- Only the main thread changes the playlist maps.  It holds
+ *    $Playlists_lock for writing meanwhile (see playlists_lock()), and
+ *    workers hold it for reading while they handle a request.
+ * -- Each Pls has its own lock, taken by handle_playlist_request() for
+ *    reading or writing depending on dispatch_reads_only().  Lazy
+ *    shuffling makes navigation a writer.
+ * -- Requests to the manager object are handled with $Playlists_lock
+ *    held, excluding all workers, since they may touch any playlist.
+ */
+
+/*
+ * A queued request.
+ *
+ * @msg:    the request
+ * @klass:  its class
+ * @queued: when it was queued, in monotonic microseconds
+ */
+typedef struct {
+	DBusMessage *msg;
+	guint klass;
+	gint64 queued;
+} Deferred;
+
+/*
+ * A request answered in slices, see dispatch_slice().
+ *
+ * @msg:  the request
+ * @func: builds the next slice of the reply
+ * @data: passed to @func
+ * @free: frees @data when done, or %NULL
+ */
+typedef struct {
+	DBusMessage *msg;
+	DispatchSliceFunc func;
+	gpointer data;
+	GDestroyNotify free;
+} Slice;
+
+static const gchar *const Interactive[] = {
+	MAFW_PLAYLIST_METHOD_GET_NEXT,
+	MAFW_PLAYLIST_METHOD_GET_NEXT_N,
+	MAFW_PLAYLIST_METHOD_GET_PREV,
+	MAFW_PLAYLIST_METHOD_GET_STARTING_INDEX,
+	MAFW_PLAYLIST_METHOD_GET_LAST_INDEX,
+	MAFW_PLAYLIST_METHOD_GET_ITEM,
+	MAFW_PLAYLIST_METHOD_GET_SIZE,
+	MAFW_PLAYLIST_METHOD_SET_WINDOW,
+	NULL
+};
+
+static const gchar *const Bulk[] = {
+	MAFW_PLAYLIST_METHOD_GET_ITEMS,
+	MAFW_PLAYLIST_METHOD_GET_ITEMS_WITH_METADATA,
+	MAFW_PLAYLIST_METHOD_APPLY_OPS,
+	MAFW_PLAYLIST_METHOD_DUP_PLAYLIST,
+	MAFW_PLAYLIST_METHOD_COPY_RANGE,
+	MAFW_PLAYLIST_METHOD_CONCAT,
+	MAFW_PLAYLIST_METHOD_LIST_PLAYLISTS_FULL,
+	MAFW_PLAYLIST_METHOD_RESTORE_FROM,
+	NULL
+};
+
+/* Playlist requests which don't change the playlist. */
+static const gchar *const Readers[] = {
+	MAFW_PLAYLIST_METHOD_GET_NAME,
+	MAFW_PLAYLIST_METHOD_GET_REPEAT,
+	MAFW_PLAYLIST_METHOD_IS_SHUFFLED,
+	MAFW_PLAYLIST_METHOD_GET_ITEM,
+	MAFW_PLAYLIST_METHOD_GET_ITEMS,
+	MAFW_PLAYLIST_METHOD_GET_ITEMS_PAGED,
+	MAFW_PLAYLIST_METHOD_GET_SIZE,
+	MAFW_PLAYLIST_METHOD_SYNC_SINCE,
+	NULL
+};
+
+/* Playlist requests which may be handled by the workers: $Readers and
+ * the navigation ones, which only touch the shuffle order. */
+static const gchar *const Parallel[] = {
+	MAFW_PLAYLIST_METHOD_GET_STARTING_INDEX,
+	MAFW_PLAYLIST_METHOD_GET_LAST_INDEX,
+	MAFW_PLAYLIST_METHOD_GET_NEXT,
+	MAFW_PLAYLIST_METHOD_GET_NEXT_N,
+	MAFW_PLAYLIST_METHOD_GET_PREV,
+	NULL
+};
+
+static DBusConnection *Connection;
+/* The queued requests, in arrival order. */
+static GQueue Queue = G_QUEUE_INIT;
+/* Sender => number of its requests queued or in $Pool */
+static GHashTable *Pending;
+/* Senders having a request in $Pool or $Slices. */
+static GHashTable *Busy;
+/* The idle source handling $Queue. */
+static guint Queue_handler;
+/* The queued request being handled in the main thread. */
+static DBusMessage *Handling;
+/* The Slice dispatch_slice() started for $Handling. */
+static Slice *Started;
+/* The Slice:s in progress, taking turns. */
+static GQueue Slices = G_QUEUE_INIT;
+/* The idle source handling $Slices. */
+static guint Slices_handler;
+static DispatchStats Stats[DISPATCH_NCLASSES];
+
+/* The workers, %NULL if requests are handled by the main loop only. */
+static GThreadPool *Pool;
+static GRWLock Playlists_lock;
+/* Nesting depth of playlists_lock(). */
+static guint Playlists_locked;
+
+static gboolean member_in(const gchar *member, const gchar *const *list)
+{
+	for (; *list; list++)
+		if (!strcmp(member, *list))
+			return TRUE;
+	return FALSE;
+}
+
+/**
+ * dispatch_class:
+ * @msg: a request
+ *
+ * Returns the DISPATCH_* of @msg.
+ */
+guint dispatch_class(DBusMessage *msg)
+{
+	const gchar *member;
+
+	member = dbus_message_get_member(msg);
+	if (member_in(member, Interactive))
+		return DISPATCH_INTERACTIVE;
+	if (member_in(member, Bulk))
+		return DISPATCH_BULK;
+	return DISPATCH_NORMAL;
+}
+
+/**
+ * dispatch_reads_only:
+ * @msg: a request to a playlist
+ *
+ * Returns whether @msg can be handled with the playlist locked for
+ * reading only.
+ */
+gboolean dispatch_reads_only(DBusMessage *msg)
+{
+	return member_in(dbus_message_get_member(msg), Readers);
+}
+
+/* Tells whether $msg is to be handled by a worker. */
+static gboolean is_parallel(DBusMessage *msg)
+{
+	const gchar *path, *member;
+
+	if (!Pool)
+		return FALSE;
+	path = dbus_message_get_path(msg);
+	if (!path || !strcmp(path, MAFW_PLAYLIST_PATH))
+		return FALSE;
+	member = dbus_message_get_member(msg);
+	return member_in(member, Readers) || member_in(member, Parallel);
+}
+
+/**
+ * playlists_lock:
+ *
+ * Excludes the workers until the matching playlists_unlock(), so the
+ * playlist maps and any playlist can be changed.  To be called from the
+ * main thread only; calls may be nested.
+ */
+void playlists_lock(void)
+{
+	if (!Playlists_locked++)
+		g_rw_lock_writer_lock(&Playlists_lock);
+}
+
+/**
+ * playlists_unlock:
+ *
+ * Undoes a playlists_lock().
+ */
+void playlists_unlock(void)
+{
+	g_assert(Playlists_locked > 0);
+	if (!--Playlists_locked)
+		g_rw_lock_writer_unlock(&Playlists_lock);
+}
+
+/**
+ * playlists_read_lock:
+ *
+ * Holds off the main thread from changing the playlist maps, like the
+ * workers do while handling a request.  For threads other than the main
+ * one; the playlists themselves need their own lock.
+ */
+void playlists_read_lock(void)
+{
+	g_rw_lock_reader_lock(&Playlists_lock);
+}
+
+/**
+ * playlists_read_unlock:
+ *
+ * Undoes a playlists_read_lock().
+ */
+void playlists_read_unlock(void)
+{
+	g_rw_lock_reader_unlock(&Playlists_lock);
+}
+
+/* Replies to $msg if it was not understood.  libdbus does this when the
+ * message function returns NOT_YET_HANDLED, but we may be past that. */
+static void unknown_method(DBusMessage *msg)
+{
+	DBusMessage *reply;
+
+	reply = dbus_message_new_error_printf(
+		msg, DBUS_ERROR_UNKNOWN_METHOD,
+		"Method \"%s\" with signature \"%s\" on interface "
+		"\"%s\" doesn't exist",
+		dbus_message_get_member(msg),
+		dbus_message_get_signature(msg),
+		dbus_message_get_interface(msg));
+	dbus_connection_send(Connection, reply, NULL);
+	dbus_message_unref(reply);
+}
+
+static void update_stats(guint klass, gint64 queued)
+{
+	DispatchStats *stats;
+	gint64 delay;
+
+	stats = &Stats[klass];
+	stats->handled++;
+	if (queued) {
+		delay = g_get_monotonic_time() - queued;
+		stats->deferred++;
+		stats->total_delay += delay;
+		if (delay > stats->max_delay)
+			stats->max_delay = delay;
+	}
+}
+
+/* Handles $msg in the main thread. */
+static void handle(DBusMessage *msg, guint klass, gint64 queued)
+{
+	const gchar *path;
+	DBusHandlerResult ret;
+	gint64 started;
+
+	update_stats(klass, queued);
+	started = g_get_monotonic_time();
+	path = dbus_message_get_path(msg);
+	if (!path || !strcmp(path, MAFW_PLAYLIST_PATH)) {
+		playlists_lock();
+		ret = handle_request(Connection, msg, NULL);
+		playlists_unlock();
+	} else
+		ret = handle_request(Connection, msg, NULL);
+	if (ret == DBUS_HANDLER_RESULT_NOT_YET_HANDLED)
+		unknown_method(msg);
+	stats_request(ret == DBUS_HANDLER_RESULT_HANDLED
+		      ? dbus_message_get_member(msg) : NULL,
+		      g_get_monotonic_time() - started);
+}
+
+/* Forgets that the sender of $msg has a request queued or in $Pool. */
+static void request_done(DBusMessage *msg)
+{
+	const gchar *sender;
+	guint n;
+
+	sender = dbus_message_get_sender(msg);
+	n = GPOINTER_TO_UINT(g_hash_table_lookup(Pending, sender));
+	if (n > 1)
+		g_hash_table_insert(Pending, g_strdup(sender),
+				    GUINT_TO_POINTER(n - 1));
+	else
+		g_hash_table_remove(Pending, sender);
+}
+
+static gboolean handle_queued(gpointer unused);
+
+/* Main thread callback of work(), and the end of a Slice. */
+static gboolean work_done(DBusMessage *msg)
+{
+	g_hash_table_remove(Busy, dbus_message_get_sender(msg));
+	request_done(msg);
+	dbus_message_unref(msg);
+	/* The sender's next request may be waiting. */
+	if (!g_queue_is_empty(&Queue) && !Queue_handler)
+		Queue_handler = g_idle_add(handle_queued, NULL);
+	return FALSE;
+}
+
+/* Worker thread function, handles $msg and notifies the main thread. */
+static void work(DBusMessage *msg, gpointer unused)
+{
+	DBusHandlerResult ret;
+	gint64 started;
+
+	started = g_get_monotonic_time();
+	playlists_read_lock();
+	ret = handle_playlist_request(Connection, msg,
+				      dbus_message_get_path(msg));
+	if (ret == DBUS_HANDLER_RESULT_NOT_YET_HANDLED)
+		unknown_method(msg);
+	playlists_read_unlock();
+	stats_request(ret == DBUS_HANDLER_RESULT_HANDLED
+		      ? dbus_message_get_member(msg) : NULL,
+		      g_get_monotonic_time() - started);
+	g_idle_add_full(G_PRIORITY_DEFAULT, (GSourceFunc)work_done, msg, NULL);
+}
+
+/* Hands $msg over to a worker. */
+static void submit(DBusMessage *msg, guint klass, gint64 queued)
+{
+	update_stats(klass, queued);
+	g_hash_table_insert(Busy, g_strdup(dbus_message_get_sender(msg)),
+			    GUINT_TO_POINTER(TRUE));
+	g_thread_pool_push(Pool, dbus_message_ref(msg), NULL);
+}
+
+/* Builds the next slice of the reply of the first of $Slices, and lets
+ * the next one have its turn. */
+static gboolean handle_slices(gpointer unused)
+{
+	Slice *slice;
+
+	slice = g_queue_pop_head(&Slices);
+	if (!slice->func(Connection, slice->msg, slice->data)) {
+		g_queue_push_tail(&Slices, slice);
+		return TRUE;
+	}
+
+	if (slice->free)
+		slice->free(slice->data);
+	work_done(slice->msg);
+	g_free(slice);
+	if (g_queue_is_empty(&Slices)) {
+		Slices_handler = 0;
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/* Queues the $Started Slice.  Its sender waits for it like for a request
+ * in $Pool. */
+static void keep_slicing(void)
+{
+	g_hash_table_insert(Busy,
+			    g_strdup(dbus_message_get_sender(Started->msg)),
+			    GUINT_TO_POINTER(TRUE));
+	g_queue_push_tail(&Slices, Started);
+	Started = NULL;
+	if (!Slices_handler)
+		Slices_handler = g_idle_add(handle_slices, NULL);
+}
+
+/* Handles the oldest queued request whose sender is not $Busy. */
+static gboolean handle_queued(gpointer unused)
+{
+	Deferred *def;
+	GList *link;
+
+	for (link = Queue.head; link; link = link->next) {
+		def = link->data;
+		if (!g_hash_table_lookup(Busy,
+					 dbus_message_get_sender(def->msg)))
+			break;
+	}
+	if (!link) {
+		/* work_done() will restart us. */
+		Queue_handler = 0;
+		return FALSE;
+	}
+	g_queue_delete_link(&Queue, link);
+
+	if (is_parallel(def->msg)) {
+		submit(def->msg, def->klass, def->queued);
+	} else {
+		Handling = def->msg;
+		handle(def->msg, def->klass, def->queued);
+		Handling = NULL;
+		if (Started)
+			keep_slicing();
+		else
+			request_done(def->msg);
+	}
+	dbus_message_unref(def->msg);
+	g_free(def);
+
+	if (g_queue_is_empty(&Queue)) {
+		Queue_handler = 0;
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/**
+ * dispatch_request:
+ *
+ * The message function of the daemon's object path.  Handles or queues
+ * a request according to its class.
+ */
+DBusHandlerResult dispatch_request(DBusConnection *con, DBusMessage *msg,
+				   void *unused)
+{
+	const gchar *iface, *sender;
+	Deferred *def;
+	guint klass, n;
+	DBusHandlerResult ret;
+
+	iface = dbus_message_get_interface(msg);
+	if (iface && !strcmp(iface, MAFW_PLAYLIST_STATS_INTERFACE)) {
+		playlists_lock();
+		ret = stats_handle(con, msg);
+		playlists_unlock();
+		return ret;
+	}
+
+	/* Signals and foreign messages are none of our business. */
+	if (dbus_message_get_type(msg) != DBUS_MESSAGE_TYPE_METHOD_CALL
+	    || !iface || strcmp(iface, MAFW_PLAYLIST_INTERFACE)
+	    || !dbus_message_get_member(msg)
+	    || !(sender = dbus_message_get_sender(msg))) {
+		playlists_lock();
+		ret = handle_request(con, msg, NULL);
+		playlists_unlock();
+		return ret;
+	}
+
+	Connection = con;
+	if (!Pending) {
+		Pending = g_hash_table_new_full(g_str_hash, g_str_equal,
+						g_free, NULL);
+		Busy = g_hash_table_new_full(g_str_hash, g_str_equal,
+					     g_free, NULL);
+	}
+
+	klass = dispatch_class(msg);
+	n = GPOINTER_TO_UINT(g_hash_table_lookup(Pending, sender));
+	if (quota_limits()->requests && n >= quota_limits()->requests) {
+		mafw_dbus_send(con, mafw_dbus_error(
+				msg, MAFW_PLAYLIST_ERROR,
+				MAFW_PLAYLIST_ERROR_QUOTA_EXCEEDED,
+				"Too many requests in progress"));
+		return DBUS_HANDLER_RESULT_HANDLED;
+	}
+	if (!n && is_parallel(msg)) {
+		g_hash_table_insert(Pending, g_strdup(sender),
+				    GUINT_TO_POINTER(1));
+		submit(msg, klass, 0);
+		return DBUS_HANDLER_RESULT_HANDLED;
+	}
+	if (!n && klass != DISPATCH_BULK) {
+		handle(msg, klass, 0);
+		return DBUS_HANDLER_RESULT_HANDLED;
+	}
+
+	def = g_new(Deferred, 1);
+	def->msg = dbus_message_ref(msg);
+	def->klass = klass;
+	def->queued = g_get_monotonic_time();
+	g_queue_push_tail(&Queue, def);
+	g_hash_table_insert(Pending, g_strdup(sender),
+			    GUINT_TO_POINTER(n + 1));
+	if (!Queue_handler)
+		Queue_handler = g_idle_add(handle_queued, NULL);
+	return DBUS_HANDLER_RESULT_HANDLED;
+}
+
+/**
+ * dispatch_pending:
+ * @client: unique bus name of a client
+ *
+ * Returns the number of requests of @client queued or being handled by
+ * a worker.
+ */
+guint dispatch_pending(const gchar *client)
+{
+	return Pending
+		? GPOINTER_TO_UINT(g_hash_table_lookup(Pending, client)) : 0;
+}
+
+/**
+ * dispatch_can_slice:
+ * @msg: the request being handled
+ *
+ * Tells whether the reply to @msg may be built in slices with
+ * dispatch_slice(): it's a queued request, and being handled in the main
+ * thread.  Otherwise it has to be answered at once.
+ */
+gboolean dispatch_can_slice(DBusMessage *msg)
+{
+	/* Workers mustn't even look at $Handling. */
+	return !is_parallel(msg) && msg == Handling && !Started;
+}
+
+/**
+ * dispatch_slice:
+ * @msg:  the request being handled, for which dispatch_can_slice() is
+ *        %TRUE
+ * @func: function building the next slice of the reply
+ * @data: data to pass to @func
+ * @free: function to free @data with when done, or %NULL
+ *
+ * Leaves @msg unanswered for now, and calls @func in the following main
+ * loop iterations, one slice per iteration, until it returns %TRUE
+ * having replied.  Other requests are handled in between, except the
+ * further ones of the sender of @msg.  @func is called without any
+ * lock held, and it's up to it to notice if what it reads has changed
+ * since its previous slice.
+ */
+void dispatch_slice(DBusMessage *msg, DispatchSliceFunc func,
+		    gpointer data, GDestroyNotify free)
+{
+	g_assert(dispatch_can_slice(msg));
+	Started = g_new(Slice, 1);
+	Started->msg = dbus_message_ref(msg);
+	Started->func = func;
+	Started->data = data;
+	Started->free = free;
+}
+
+/**
+ * dispatch_set_threads:
+ * @nthreads: number of worker threads, 0 to handle everything in the
+ *            main loop
+ *
+ * Sets up the worker pool.  To be called before the first request, and
+ * with dbus_threads_init_default() called before connecting to the bus.
+ */
+void dispatch_set_threads(guint nthreads)
+{
+	GError *err;
+
+	g_assert(!Pool);
+	if (!nthreads)
+		return;
+	err = NULL;
+	Pool = g_thread_pool_new((GFunc)work, NULL, nthreads, TRUE, &err);
+	if (!Pool)
+		g_error("g_thread_pool_new: %s", err->message);
+}
+
+/**
+ * dispatch_stop_threads:
+ *
+ * Waits for the requests in the worker pool to be handled and stops the
+ * workers.  Their results are delivered to the main loop as usual, so
+ * it should be iterated once more if the daemon doesn't exit.
+ */
+void dispatch_stop_threads(void)
+{
+	if (!Pool)
+		return;
+	g_thread_pool_free(Pool, FALSE, TRUE);
+	Pool = NULL;
+}
+
+/**
+ * dispatch_get_stats:
+ * @klass: one of DISPATCH_*
+ *
+ * Returns the statistics of the requests of @klass handled so far.
+ */
+const DispatchStats *dispatch_get_stats(guint klass)
+{
+	g_assert(klass < DISPATCH_NCLASSES);
+	return &Stats[klass];
+}
+
+/* vi: set noexpandtab ts=8 sw=8 cino=t0,(0: */
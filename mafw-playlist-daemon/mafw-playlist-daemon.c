@@ -84,11 +84,13 @@ int main(int argc, char *argv[])
 	DBusError dbe;
 	DBusConnection *dbus;
 	gboolean opt_daemonize, opt_kill, opt_stayalive;
+	guint opt_threads;
 
 	/* Parse the command line. */
 	opt_daemonize = opt_kill = FALSE;
 	opt_stayalive = TRUE;
-	while ((optchar = getopt(argc, argv, "dfk")) != EOF)
+	opt_threads = 0;
+	while ((optchar = getopt(argc, argv, "dfkj:")) != EOF)
 		switch (optchar) {
 		case 'd':
 			/* Go to the background. */
@@ -105,8 +107,12 @@ int main(int argc, char *argv[])
 			opt_kill      = TRUE;
 			opt_stayalive = FALSE;
 			break;
+		case 'j':
+			/* Handle reading requests in worker threads. */
+			opt_threads = atoi(optarg);
+			break;
 		default:
-			printf("usage: %s [-dkf]\n", argv[0]);
+			printf("usage: %s [-dkf] [-j threads]\n", argv[0]);
 			exit(1);
 		}
 
@@ -114,6 +120,8 @@ int main(int argc, char *argv[])
 	mafw_log_init(opt_daemonize ? ":warning" : ":info");
 
 	/* Hook on D-BUS. */
+	if (opt_threads && !dbus_threads_init_default())
+		g_error("dbus_threads_init_default: out of memory");
 	dbus_error_init(&dbe);
 	dbus = dbus_bus_get(DBUS_BUS_SESSION, &dbe);
 	if (dbus_error_is_set(&dbe))
@@ -123,6 +131,8 @@ int main(int argc, char *argv[])
 
 	if (opt_daemonize && daemon(1, 0) < 0)
 		g_error("daemon(): %m");
+	/* Threads don't survive daemon(). */
+	dispatch_set_threads(opt_threads);
 
 	/* Stop the loop on SIGTERM and SIGINT. */
 	signal(SIGTERM, sigh);
@@ -137,6 +147,7 @@ int main(int argc, char *argv[])
 		g_main_context_iteration(g_main_loop_get_context(Loop), TRUE);
 	}
 	g_debug("terminating playlist daemon");
+	dispatch_stop_threads();
 	save_all_playlists();
 	return 0;
 }
@@ -0,0 +1,135 @@
+/*
+ * This file is a part of MAFW
+ *
+ * Copyright (C) 2007, 2008, 2009 Nokia Corporation, all rights reserved.
+ *
+ * Contact: Visa Smolander <visa.smolander@nokia.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ *
+ */
+
+/*
+ * mafw-playlist-stats -- prints the runtime statistics of the playlist
+ * daemon.
+ *
+ * Usage: mafw-playlist-stats [<prefix>]...
+ *
+ * Prints "key value" lines sorted by key, or only the keys starting
+ * with either of the <prefix>es.  See stats.c for the keys.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+#include <dbus/dbus.h>
+
+#include <libmafw/mafw-errors.h>
+
+#include "common/mafw-dbus.h"
+#include "common/dbus-interface.h"
+
+/* Tells whether to print $key. */
+static gboolean wanted(const gchar *key, gchar **prefixes)
+{
+	if (!*prefixes)
+		return TRUE;
+	for (; *prefixes; prefixes++)
+		if (g_str_has_prefix(key, *prefixes))
+			return TRUE;
+	return FALSE;
+}
+
+/* Collects the "key value" lines of the a{st} $reply into $lines. */
+static void collect(DBusMessage *reply, gchar **prefixes, GPtrArray *lines)
+{
+	DBusMessageIter imsg, iary, ient;
+	const gchar *key;
+	dbus_uint64_t val;
+
+	dbus_message_iter_init(reply, &imsg);
+	if (dbus_message_iter_get_arg_type(&imsg) != DBUS_TYPE_ARRAY)
+		return;
+	for (dbus_message_iter_recurse(&imsg, &iary);
+	     dbus_message_iter_get_arg_type(&iary) == DBUS_TYPE_DICT_ENTRY;
+	     dbus_message_iter_next(&iary)) {
+		dbus_message_iter_recurse(&iary, &ient);
+		dbus_message_iter_get_basic(&ient, &key);
+		dbus_message_iter_next(&ient);
+		dbus_message_iter_get_basic(&ient, &val);
+		if (wanted(key, prefixes))
+			g_ptr_array_add(lines, g_strdup_printf(
+					"%s %" G_GUINT64_FORMAT, key,
+					(guint64)val));
+	}
+}
+
+static gint cmplines(gconstpointer a, gconstpointer b)
+{
+	return strcmp(*(const gchar **)a, *(const gchar **)b);
+}
+
+/* The main function */
+int main(int argc, char *argv[])
+{
+	DBusError dbe;
+	DBusConnection *dbus;
+	DBusMessage *reply;
+	GPtrArray *lines;
+	GError *err;
+	guint i;
+
+	if (argc > 1 && argv[1][0] == '-') {
+		printf("usage: %s [prefix]...\n", argv[0]);
+		exit(1);
+	}
+
+	dbus_error_init(&dbe);
+	dbus = dbus_bus_get(DBUS_BUS_SESSION, &dbe);
+	if (dbus_error_is_set(&dbe)) {
+		fprintf(stderr, "dbus_bus_get: %s\n", dbe.message);
+		exit(1);
+	}
+
+	err = NULL;
+	reply = mafw_dbus_call(dbus, mafw_dbus_method_full(
+				MAFW_PLAYLIST_SERVICE, MAFW_PLAYLIST_PATH,
+				MAFW_PLAYLIST_STATS_INTERFACE,
+				MAFW_PLAYLIST_STATS_METHOD_GET),
+			       MAFW_PLAYLIST_ERROR, &err);
+	if (!reply) {
+		fprintf(stderr, "%s: %s\n", argv[0], err->message);
+		exit(1);
+	}
+
+	lines = g_ptr_array_new();
+	collect(reply, &argv[1], lines);
+	g_ptr_array_sort(lines, cmplines);
+	for (i = 0; i < lines->len; i++) {
+		puts(lines->pdata[i]);
+		g_free(lines->pdata[i]);
+	}
+	g_ptr_array_free(lines, TRUE);
+	dbus_message_unref(reply);
+	dbus_connection_unref(dbus);
+	return 0;
+}
+
+/* vi: set noexpandtab ts=8 sw=8 cino=t0,(0: */
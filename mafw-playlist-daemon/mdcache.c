@@ -0,0 +1,608 @@
+/*
+ * This file is a part of MAFW
+ *
+ * Copyright (C) 2007, 2008, 2009 Nokia Corporation, all rights reserved.
+ *
+ * Contact: Visa Smolander <visa.smolander@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+#include <string.h>
+#include <glib.h>
+#include <glib-object.h>
+#include <dbus/dbus.h>
+
+#include <libmafw/mafw.h>
+
+#include "common/mafw-dbus.h"
+#include "common/dbus-interface.h"
+#include "mpd-internal.h"
+
+#undef G_LOG_DOMAIN
+#define G_LOG_DOMAIN "mafw-playlist-mdcache"
+
+/*
+ * Metadata cache.  With $MAFW_PLAYLIST_METADATA_KEYS set to a comma
+ * separated list of metadata keys (like "title,artist,uri") the daemon
+ * keeps a record of those keys for the items of the playlists, so that
+ * UIs can get them along with the object ids by get_items_with_metadata
+ * instead of asking the sources each time.  The duration is always
+ * cached, for the totals.
+ *
+ * Records are fetched lazily, when the items are first asked for,
+ * from the sources found in the registry.  Until then the items have
+ * an empty record.  When the records arrive, a metadata_cached signal
+ * tells the range of the playlist concerned.  A record is dropped and
+ * refetched when its source emits MafwSource::metadata-changed.  At
+ * most $MDCACHE_MAX_RECORDS records are kept, the least recently used
+ * ones are evicted.
+ *
+ * The totals of a playlist are computed when they are first asked for,
+ * then maintained on each change of the playlist.  They include the
+ * items whose record has been evicted since.
+ *
+ * All of this happens in the main thread.
+ */
+
+/* Environment variable holding the keys to cache. */
+#define MDCACHE_ENV		"MAFW_PLAYLIST_METADATA_KEYS"
+
+/* The most records kept. */
+#define MDCACHE_MAX_RECORDS	4096
+
+/* The most object ids asked from a source at once. */
+#define MDCACHE_BATCH		64
+
+/*
+ * @oid:      object id of the item
+ * @metadata: the cached keys, %NULL until fetched
+ * @link:     in $Lru once fetched
+ */
+typedef struct {
+	gchar *oid;
+	GHashTable *metadata;
+	GList *link;
+} Record;
+
+/*
+ * Totals of a playlist.
+ *
+ * @durations: duration of each item in seconds (gint), -1 if unknown yet
+ * @duration:  sum of the known durations
+ * @unknown:   number of items whose duration is not known yet
+ */
+typedef struct {
+	GArray *durations;
+	guint64 duration;
+	guint unknown;
+} Totals;
+
+/* The keys to cache, %NULL if disabled. */
+static gchar **Keys;
+/* Object id => Record */
+static GHashTable *Records;
+/* Records fetched, least recently used first. */
+static GQueue Lru = G_QUEUE_INIT;
+/* Playlist id => Totals */
+static GHashTable *Totals_by_plid;
+/* Source uuid => MafwSource whose metadata-changed is connected. */
+static GHashTable *Sources;
+static DBusConnection *Connection;
+
+static void fetch(gchar **oids, guint n);
+
+static void record_free(Record *rec)
+{
+	if (rec->link)
+		g_queue_delete_link(&Lru, rec->link);
+	if (rec->metadata)
+		mafw_metadata_release(rec->metadata);
+	g_free(rec->oid);
+	g_free(rec);
+}
+
+static void totals_free(Totals *tot)
+{
+	g_array_free(tot->durations, TRUE);
+	g_free(tot);
+}
+
+/* Returns the duration recorded in $rec, or -1 if it isn't fetched. */
+static gint record_duration(const Record *rec)
+{
+	GValue *val;
+
+	if (!rec || !rec->metadata)
+		return -1;
+	val = mafw_metadata_first(rec->metadata, MAFW_METADATA_KEY_DURATION);
+	return val && G_VALUE_HOLDS_INT(val) ? MAX(g_value_get_int(val), 0)
+					     : 0;
+}
+
+/* Sets the $i:th duration of $tot. */
+static void totals_set(Totals *tot, guint i, gint duration)
+{
+	gint *d;
+
+	d = &g_array_index(tot->durations, gint, i);
+	if (*d < 0)
+		tot->unknown--;
+	else
+		tot->duration -= *d;
+	*d = duration;
+	if (*d < 0)
+		tot->unknown++;
+	else
+		tot->duration += *d;
+}
+
+/* Sends metadata_cached about the $first..$last items of $plid. */
+static void send_cached(guint plid, guint first, guint last,
+			const Totals *tot)
+{
+	gchar *path;
+
+	path = g_strdup_printf("%s/%u", MAFW_PLAYLIST_PATH, plid);
+	stats_signal(MAFW_PLAYLIST_METADATA_CACHED);
+	mafw_dbus_send(Connection,
+		       mafw_dbus_signal_full(NULL, path,
+					     MAFW_PLAYLIST_INTERFACE,
+					     MAFW_PLAYLIST_METADATA_CACHED,
+					     MAFW_DBUS_UINT32(first),
+					     MAFW_DBUS_UINT32(last),
+					     MAFW_DBUS_UINT64(tot->duration),
+					     MAFW_DBUS_UINT32(tot->unknown)));
+	g_free(path);
+}
+
+/* Updates the totals with the records just fetched, which are keyed
+ * by their object ids in $done, and tells the clients. */
+static void records_arrived(GHashTable *done)
+{
+	GList *plids, *l;
+
+	plids = g_hash_table_get_keys(Totals_by_plid);
+	for (l = plids; l; l = l->next) {
+		Totals *tot;
+		Pls *pls;
+		guint i, first, last;
+
+		tot = g_hash_table_lookup(Totals_by_plid, l->data);
+		if (!(pls = g_tree_lookup(Playlists, l->data)))
+			continue;
+		first = G_MAXUINT;
+		last = 0;
+		for (i = 0; i < pls->len; i++) {
+			Record *rec;
+			gchar *oid;
+
+			oid = pls_get_item(pls, i);
+			rec = g_hash_table_lookup(done, oid);
+			g_free(oid);
+			if (!rec)
+				continue;
+			totals_set(tot, i, record_duration(rec));
+			if (first == G_MAXUINT)
+				first = i;
+			last = i;
+		}
+		if (first != G_MAXUINT)
+			send_cached(pls->id, first, last, tot);
+	}
+	g_list_free(plids);
+}
+
+/* Called with the records of the %NULL-terminated $oids. */
+static void got_metadatas(MafwSource *src, GHashTable *metadatas,
+			  gchar **oids, const GError *error)
+{
+	GHashTable *done;
+	gchar **oid;
+
+	done = g_hash_table_new(g_str_hash, g_str_equal);
+	for (oid = oids; *oid; oid++) {
+		GHashTable *md;
+		Record *rec;
+
+		if (!(rec = g_hash_table_lookup(Records, *oid))
+		    || rec->metadata)
+			continue;
+		md = metadatas ? g_hash_table_lookup(metadatas, *oid) : NULL;
+		if (!md && error) {
+			/* Try again next time it's asked for. */
+			g_hash_table_remove(Records, *oid);
+			continue;
+		}
+		rec->metadata = md ? g_hash_table_ref(md)
+				   : mafw_metadata_new();
+		g_queue_push_tail(&Lru, rec);
+		rec->link = Lru.tail;
+		g_hash_table_insert(done, rec->oid, rec);
+	}
+	if (error)
+		g_debug("get_metadatas: %s", error->message);
+
+	if (g_hash_table_size(done))
+		records_arrived(done);
+	g_hash_table_unref(done);
+
+	while (Lru.length > MDCACHE_MAX_RECORDS) {
+		Record *rec = g_queue_peek_head(&Lru);
+
+		g_hash_table_remove(Records, rec->oid);
+	}
+	g_strfreev(oids);
+}
+
+/* MafwSource::metadata-changed, drops the record of $oid and fetches
+ * it again. */
+static void metadata_changed(MafwSource *src, const gchar *oid,
+			     gpointer unused)
+{
+	Record *rec;
+	gchar *dup;
+
+	if (!(rec = g_hash_table_lookup(Records, oid)) || !rec->metadata)
+		return;
+	g_hash_table_remove(Records, oid);
+	dup = g_strdup(oid);
+	fetch(&dup, 1);
+	g_free(dup);
+}
+
+/* MafwRegistry::source-removed, forgets $src. */
+static void source_removed(MafwRegistry *reg, MafwSource *src,
+			   gpointer unused)
+{
+	const gchar *uuid;
+
+	uuid = mafw_extension_get_uuid(MAFW_EXTENSION(src));
+	if (!g_hash_table_lookup(Sources, uuid))
+		return;
+	g_signal_handlers_disconnect_by_func(src, metadata_changed, NULL);
+	g_hash_table_remove(Sources, uuid);
+}
+
+/* Returns the source $uuid, watching its changes. */
+static MafwSource *get_source(const gchar *uuid)
+{
+	MafwSource *src;
+
+	if ((src = g_hash_table_lookup(Sources, uuid)))
+		return src;
+	src = MAFW_SOURCE(mafw_registry_get_extension_by_uuid(
+			mafw_registry_get_instance(), uuid));
+	if (!src)
+		return NULL;
+	g_signal_connect(src, "metadata-changed",
+			 G_CALLBACK(metadata_changed), NULL);
+	g_hash_table_insert(Sources, g_strdup(uuid), g_object_ref(src));
+	return src;
+}
+
+/* Sends the object ids collected in $batch to $src. */
+static void fetch_batch(MafwSource *src, GPtrArray *batch)
+{
+	gchar **oids;
+
+	g_ptr_array_add(batch, NULL);
+	oids = (gchar **)g_ptr_array_free(batch, FALSE);
+	mafw_source_get_metadatas(src, (const gchar **)oids,
+				  (const gchar *const *)Keys,
+				  (MafwSourceMetadataResultsCb)got_metadatas,
+				  oids);
+}
+
+/* Asks the sources for the records of the $n $oids not cached yet. */
+static void fetch(gchar **oids, guint n)
+{
+	GHashTable *batches;
+	GList *uuids, *l;
+	guint i;
+
+	/* Source uuid => GPtrArray of object ids */
+	batches = g_hash_table_new_full(g_str_hash, g_str_equal,
+					g_free, NULL);
+	for (i = 0; i < n; i++) {
+		GPtrArray *batch;
+		MafwSource *src;
+		Record *rec;
+		gchar *uuid;
+
+		if (g_hash_table_lookup(Records, oids[i]))
+			continue;
+		if (!mafw_source_split_objectid(oids[i], &uuid, NULL))
+			continue;
+		if (!(src = get_source(uuid))) {
+			g_free(uuid);
+			continue;
+		}
+
+		rec = g_new0(Record, 1);
+		rec->oid = g_strdup(oids[i]);
+		g_hash_table_insert(Records, rec->oid, rec);
+
+		if (!(batch = g_hash_table_lookup(batches, uuid))) {
+			batch = g_ptr_array_new();
+			g_hash_table_insert(batches, g_strdup(uuid), batch);
+		}
+		g_ptr_array_add(batch, g_strdup(oids[i]));
+		if (batch->len == MDCACHE_BATCH) {
+			g_hash_table_remove(batches, uuid);
+			fetch_batch(src, batch);
+		}
+		g_free(uuid);
+	}
+
+	uuids = g_hash_table_get_keys(batches);
+	for (l = uuids; l; l = l->next)
+		fetch_batch(g_hash_table_lookup(Sources, l->data),
+			    g_hash_table_lookup(batches, l->data));
+	g_list_free(uuids);
+	g_hash_table_destroy(batches);
+}
+
+/* Like fetch(), for the $n items of $pls from $first on.  Takes them
+ * a batch at a time, so paged out playlists aren't read in at once. */
+static void fetch_items(Pls *pls, guint first, guint n)
+{
+	gchar **oids;
+	guint i, k;
+
+	for (i = 0; i < n; i += k) {
+		k = MIN(n - i, MDCACHE_BATCH);
+		oids = pls_get_items(pls, first + i, first + i + k - 1);
+		fetch(oids, k);
+		pls_items_free(pls, oids);
+	}
+}
+
+/**
+ * mdcache_init:
+ * @con: the connection to send metadata_cached on
+ *
+ * Reads the keys to cache from the environment.  To be called after
+ * the registry has been set up.
+ */
+void mdcache_init(DBusConnection *con)
+{
+	const gchar *env;
+	GPtrArray *keys;
+	gchar **items, **item;
+	gboolean duration;
+
+	if (Keys || !(env = g_getenv(MDCACHE_ENV)) || !*env)
+		return;
+
+	keys = g_ptr_array_new();
+	duration = FALSE;
+	items = g_strsplit(env, ",", 0);
+	for (item = items; *item; item++) {
+		g_strstrip(*item);
+		if (!**item) {
+			g_free(*item);
+			continue;
+		}
+		if (!strcmp(*item, MAFW_METADATA_KEY_DURATION))
+			duration = TRUE;
+		g_ptr_array_add(keys, *item);
+	}
+	g_free(items);
+	if (!duration)
+		g_ptr_array_add(keys, g_strdup(MAFW_METADATA_KEY_DURATION));
+	g_ptr_array_add(keys, NULL);
+	Keys = (gchar **)g_ptr_array_free(keys, FALSE);
+
+	Records = g_hash_table_new_full(g_str_hash, g_str_equal, NULL,
+					(GDestroyNotify)record_free);
+	Totals_by_plid = g_hash_table_new_full(NULL, NULL, NULL,
+					       (GDestroyNotify)totals_free);
+	Sources = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+					g_object_unref);
+	Connection = con;
+	g_signal_connect(mafw_registry_get_instance(), "source-removed",
+			 G_CALLBACK(source_removed), NULL);
+}
+
+/**
+ * mdcache_enabled:
+ *
+ * Tells whether metadata is cached at all.
+ */
+gboolean mdcache_enabled(void)
+{
+	return Keys != NULL;
+}
+
+/**
+ * mdcache_fetch:
+ * @pls:   a playlist
+ * @first: visual index of the first item
+ * @last:  visual index of the last item, < @pls->len
+ *
+ * Starts fetching the records of the given items of @pls which aren't
+ * cached or being fetched already.
+ */
+void mdcache_fetch(Pls *pls, guint first, guint last)
+{
+	g_return_if_fail(Keys != NULL);
+	fetch_items(pls, first, last - first + 1);
+}
+
+/**
+ * mdcache_lookup:
+ * @pls: a playlist
+ * @idx: visual index of an item of @pls
+ *
+ * Returns the cached record of the @idx:th item of @pls, or %NULL if
+ * it isn't known yet.  The record is owned by the cache.
+ */
+GHashTable *mdcache_lookup(Pls *pls, guint idx)
+{
+	Record *rec;
+	gchar *oid;
+
+	g_return_val_if_fail(Keys != NULL, NULL);
+	oid = pls_get_item(pls, idx);
+	rec = g_hash_table_lookup(Records, oid);
+	g_free(oid);
+	if (!rec)
+		return NULL;
+	if (rec->link) {
+		g_queue_unlink(&Lru, rec->link);
+		g_queue_push_tail_link(&Lru, rec->link);
+	}
+	return rec->metadata;
+}
+
+/**
+ * mdcache_totals:
+ * @pls:      a playlist
+ * @duration: where to store the sum of the durations known, in seconds
+ * @unknown:  where to store the number of items whose duration isn't
+ *            known yet
+ *
+ * Tells the totals of @pls, starting to maintain them if they weren't.
+ */
+void mdcache_totals(Pls *pls, guint64 *duration, guint *unknown)
+{
+	Totals *tot;
+
+	g_return_if_fail(Keys != NULL);
+	if (!(tot = g_hash_table_lookup(Totals_by_plid,
+					GUINT_TO_POINTER(pls->id)))) {
+		guint i;
+
+		tot = g_new0(Totals, 1);
+		tot->durations = g_array_sized_new(FALSE, FALSE, sizeof(gint),
+						   pls->len);
+		g_array_set_size(tot->durations, pls->len);
+		for (i = 0; i < pls->len; i++) {
+			gchar *oid;
+			gint d;
+
+			oid = pls_get_item(pls, i);
+			d = record_duration(g_hash_table_lookup(Records, oid));
+			g_free(oid);
+			g_array_index(tot->durations, gint, i) = d;
+			if (d < 0)
+				tot->unknown++;
+			else
+				tot->duration += d;
+		}
+		g_hash_table_insert(Totals_by_plid, GUINT_TO_POINTER(pls->id),
+				    tot);
+		if (tot->unknown)
+			fetch_items(pls, 0, pls->len);
+	}
+	*duration = tot->duration;
+	*unknown = tot->unknown;
+}
+
+/**
+ * mdcache_forget:
+ * @plid: id of a playlist being destroyed
+ *
+ * Stops maintaining the totals of @plid.
+ */
+void mdcache_forget(guint plid)
+{
+	if (Totals_by_plid)
+		g_hash_table_remove(Totals_by_plid, GUINT_TO_POINTER(plid));
+}
+
+/**
+ * mdcache_contents_changed:
+ * @plid:     the playlist changed
+ * @from:     the first index changed
+ * @nremove:  number of items removed from @from
+ * @nreplace: number of items inserted in their place
+ *
+ * Updates the totals of @plid.  To be called after the playlist has
+ * been changed.
+ */
+void mdcache_contents_changed(guint plid, guint from,
+			      guint nremove, guint nreplace)
+{
+	Totals *tot;
+	Pls *pls;
+	guint i;
+
+	if (!Totals_by_plid
+	    || !(tot = g_hash_table_lookup(Totals_by_plid,
+					   GUINT_TO_POINTER(plid))))
+		return;
+	if (!(pls = g_tree_lookup(Playlists, GUINT_TO_POINTER(plid)))
+	    || from + nremove > tot->durations->len
+	    || tot->durations->len - nremove + nreplace != pls->len) {
+		/* Lost track, start over when asked next time. */
+		mdcache_forget(plid);
+		return;
+	}
+
+	for (i = from; i < from + nremove; i++)
+		totals_set(tot, i, 0);
+	g_array_remove_range(tot->durations, from, nremove);
+	if (!nreplace)
+		return;
+
+	g_array_set_size(tot->durations, tot->durations->len + nreplace);
+	memmove(&g_array_index(tot->durations, gint, from + nreplace),
+		&g_array_index(tot->durations, gint, from),
+		(pls->len - from - nreplace) * sizeof(gint));
+	for (i = from; i < from + nreplace; i++) {
+		gchar *oid;
+		gint d;
+
+		g_array_index(tot->durations, gint, i) = 0;
+		oid = pls_get_item(pls, i);
+		d = record_duration(g_hash_table_lookup(Records, oid));
+		g_free(oid);
+		totals_set(tot, i, d);
+	}
+	fetch_items(pls, from, nreplace);
+}
+
+/**
+ * mdcache_item_moved:
+ * @plid: the playlist changed
+ * @from: the original index of the item moved
+ * @to:   its new index
+ *
+ * Like mdcache_contents_changed(), but for a move.
+ */
+void mdcache_item_moved(guint plid, guint from, guint to)
+{
+	Totals *tot;
+	gint d;
+
+	if (!Totals_by_plid
+	    || !(tot = g_hash_table_lookup(Totals_by_plid,
+					   GUINT_TO_POINTER(plid)))
+	    || from >= tot->durations->len || to >= tot->durations->len)
+		return;
+
+	/* The totals themselves stay. */
+	d = g_array_index(tot->durations, gint, from);
+	g_array_remove_index(tot->durations, from);
+	g_array_insert_val(tot->durations, to, d);
+}
+
+/* vi: set noexpandtab ts=8 sw=8 cino=t0,(0: */
@@ -0,0 +1,185 @@
+/*
+ * This file is a part of MAFW
+ *
+ * Copyright (C) 2007, 2008, 2009 Nokia Corporation, all rights reserved.
+ *
+ * Contact: Visa Smolander <visa.smolander@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+#include <glib.h>
+#include <dbus/dbus.h>
+
+#include <libmafw/mafw-errors.h>
+
+#include "common/mafw-dbus.h"
+#include "common/mafw-mirror.h"
+#include "common/dbus-interface.h"
+#include "libmafw-shared/mafw-playlist-manager.h"
+#include "mpd-internal.h"
+
+#undef G_LOG_DOMAIN
+#define G_LOG_DOMAIN "mafw-playlist-mirror"
+
+/*
+ * Shared memory mirrors of the playlists, see common/mafw-mirror.h.
+ * A playlist is mirrored once a client asks for it with get_mirror,
+ * and from then on the mirror is updated after each change of the
+ * playlist, before the change is signalled, patching the items changed.
+ * When the items outgrow the segment a bigger one replaces it, and
+ * the clients holding the old one find it stale and ask again.
+ * Playlists paged out (see pages.c) are not mirrored.
+ *
+ * All of this happens in the main thread, with the playlist locked
+ * for writing or the workers excluded otherwise.
+ */
+
+/* Playlist id => MafwMirror */
+static GHashTable *Mirrors;
+
+static void mirror_state(Pls *pls, MafwMirrorState *state)
+{
+	state->len = pls->len;
+	state->generation = pls->generation;
+	state->flags = (pls->repeat ? MAFW_MIRROR_REPEAT : 0)
+		| (pls->shuffled ? MAFW_MIRROR_SHUFFLED : 0);
+}
+
+/* Publishes $pls in its mirror, replacing it if it's too small.
+ * Returns the mirror, or NULL if it couldn't be created or $pls is
+ * paged out. */
+static MafwMirror *publish(Pls *pls)
+{
+	MafwMirrorState state;
+	MafwMirror *mirror;
+
+	if (pls->pages) {
+		g_hash_table_remove(Mirrors, GUINT_TO_POINTER(pls->id));
+		return NULL;
+	}
+
+	mirror_state(pls, &state);
+	mirror = g_hash_table_lookup(Mirrors, GUINT_TO_POINTER(pls->id));
+	if (mirror && mafw_mirror_publish(mirror, pls->vidx, &state))
+		return mirror;
+
+	/* The old mirror is marked stale by its destroy notify. */
+	g_hash_table_remove(Mirrors, GUINT_TO_POINTER(pls->id));
+	mirror = mafw_mirror_create(mafw_mirror_size_for(pls->vidx,
+							 pls->len));
+	if (!mirror)
+		return NULL;
+	if (!mafw_mirror_publish(mirror, pls->vidx, &state)) {
+		mafw_mirror_free(mirror);
+		return NULL;
+	}
+	g_hash_table_insert(Mirrors, GUINT_TO_POINTER(pls->id), mirror);
+	return mirror;
+}
+
+/**
+ * mirror_get:
+ * @con: the connection @msg came on
+ * @msg: a get_mirror request
+ * @pls: the playlist it's addressed to
+ *
+ * Replies the mirror of @pls, creating it if needed.
+ */
+void mirror_get(DBusConnection *con, DBusMessage *msg, Pls *pls)
+{
+#ifdef DBUS_TYPE_UNIX_FD
+	DBusMessage *reply;
+	MafwMirror *mirror;
+	dbus_uint32_t size;
+	gint fd;
+
+	if (!mafw_mirror_supported()
+	    || !dbus_connection_can_send_type(con, DBUS_TYPE_UNIX_FD))
+		goto unsupported;
+
+	if (!Mirrors)
+		Mirrors = g_hash_table_new_full(
+			NULL, NULL, NULL, (GDestroyNotify)mafw_mirror_free);
+	if (!(mirror = g_hash_table_lookup(Mirrors,
+					   GUINT_TO_POINTER(pls->id)))
+	    && !(mirror = publish(pls)))
+		goto unsupported;
+
+	/* The fd is duplicated into the message. */
+	fd = mafw_mirror_get_fd(mirror);
+	size = mafw_mirror_get_size(mirror);
+	reply = dbus_message_new_method_return(msg);
+	dbus_message_append_args(reply,
+				 DBUS_TYPE_UNIX_FD, &fd,
+				 DBUS_TYPE_UINT32, &size,
+				 DBUS_TYPE_INVALID);
+	mafw_dbus_send(con, reply);
+	return;
+unsupported:
+#endif
+	mafw_dbus_send(con, mafw_dbus_error(msg, MAFW_PLAYLIST_ERROR,
+					    MAFW_PLAYLIST_ERROR_NOT_SUPPORTED,
+					    "Mirrors are not supported"));
+}
+
+/**
+ * mirror_update:
+ * @plid:     a playlist changed
+ * @from:     visual index of the first item changed
+ * @nremove:  number of items removed at @from
+ * @nreplace: number of items inserted in their place
+ *
+ * Brings the mirror of @plid, if any, up to date by patching the items
+ * changed, or publishing them all if the patch doesn't fit.
+ */
+void mirror_update(guint plid, guint from, guint nremove, guint nreplace)
+{
+	MafwMirrorState state;
+	MafwMirror *mirror;
+	Pls *pls;
+
+	if (!Mirrors
+	    || !(mirror = g_hash_table_lookup(Mirrors,
+					      GUINT_TO_POINTER(plid)))
+	    || !(pls = g_tree_lookup(Playlists, GUINT_TO_POINTER(plid))))
+		return;
+	if (!pls->pages) {
+		mirror_state(pls, &state);
+		if (mafw_mirror_patch(mirror, pls->vidx, from, nremove,
+				      nreplace, &state))
+			return;
+	}
+	if (!publish(pls) && !pls->pages)
+		g_warning("couldn't mirror playlist %u", plid);
+}
+
+/**
+ * mirror_forget:
+ * @plid: id of a playlist being destroyed
+ *
+ * Drops the mirror of @plid, marking it stale.
+ */
+void mirror_forget(guint plid)
+{
+	if (Mirrors)
+		g_hash_table_remove(Mirrors, GUINT_TO_POINTER(plid));
+}
+
+/* vi: set noexpandtab ts=8 sw=8 cino=t0,(0: */
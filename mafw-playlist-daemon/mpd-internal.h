@@ -26,6 +26,8 @@
 
 /* Internal declarations for MPD. */
 
+#include <stdio.h>
+#include <time.h>
 #include <glib.h>
 #include <dbus/dbus.h>
 
@@ -33,6 +35,28 @@
 
 extern guint Settle_time;
 
+/*
+ * Playlist saving statistics.
+ *
+ * @saves:          number of pls_save() calls
+ * @failures:       how many of them failed
+ * @bytes:          total size of the files written
+ * @fsync_usec:     total time spent in fsync()
+ * @fsync_max_usec: the longest fsync()
+ */
+typedef struct {
+	guint64 saves;
+	guint64 failures;
+	guint64 bytes;
+	guint64 fsync_usec;
+	guint64 fsync_max_usec;
+} PlsSaveStats;
+
+extern PlsSaveStats Save_stats;
+
+/* Out-of-core object ids, see pages.c. */
+typedef struct _PlsPages PlsPages;
+
 /*
  * Array based playlist storage.
  *
@@ -58,6 +82,24 @@ extern guint Settle_time;
  * @dirty_timer: each time the playlist is dirtied, a timer is started (or
  *               elongated), and when it expires, triggers save_me().  This
  *               variable stores its id.
+ * @generation:  incremented whenever the items of the playlist change,
+ *               never 0.  Used to validate paging cursors.
+ * @mtime:       time of the last modification
+ * @lock:        taken by request handlers, see dispatch.c
+ * @bytes:       total length of the object ids
+ * @owner:       the client charged for the playlist, see quota.c
+ * @changes:     PlsChange:s of the recent generations, oldest first
+ * @log_since:   @changes has every change after this generation
+ * @log_oids:    number of object ids in @changes
+ * @smart:       the items are maintained by smart.c, clients can't edit them
+ * @packed:      the object ids compressed by pls_pack(), %NULL if they are
+ *               in @vidx, which is %NULL meanwhile
+ * @packed_len:  size of @packed
+ * @packed_raw:  size of the object ids before packing, with their NULs
+ * @atime:       when the playlist was last accessed, in monotonic
+ *               seconds, see cold.c
+ * @pages:       the object ids of a very large playlist, %NULL if they
+ *               are in @vidx, which is %NULL meanwhile, see pls_set_paging()
  */
 typedef struct {
 	guint id;
@@ -73,8 +115,57 @@ typedef struct {
         gint *iidx;
 	gboolean dirty;
 	guint dirty_timer;
+	guint generation;
+	time_t mtime;
+	GRWLock lock;
+	gsize bytes;
+	gchar *owner;
+	GQueue changes;
+	guint log_since;
+	guint log_oids;
+	gboolean smart;
+	gpointer packed;
+	gsize packed_len;
+	gsize packed_raw;
+	gint atime;
+	PlsPages *pages;
 } Pls;
 
+/*
+ * A change of the items of a playlist: @nremove items were removed from
+ * @from and @oids were inserted in their place.
+ *
+ * @generation: the generation the change produced
+ * @from:       visual index of the first item changed
+ * @nremove:    number of items removed
+ * @oids:       %NULL-terminated array of the object ids inserted
+ * @noids:      length of @oids
+ */
+typedef struct {
+	guint generation;
+	guint from;
+	guint nremove;
+	gchar **oids;
+	guint noids;
+} PlsChange;
+
+/*
+ * One edit operation of a batch, see pls_apply_ops().
+ *
+ * @type:  one of MAFW_PLAYLIST_OP_*
+ * @idx:   visual index the operation refers to
+ * @arg:   count for REMOVE, destination for MOVE, mode for SET_REPEAT
+ * @oids:  object ids to insert (not owned)
+ * @noids: length of @oids
+ */
+typedef struct {
+	guint type;
+	guint idx;
+	guint arg;
+	gchar **oids;
+	guint noids;
+} PlsOp;
+
 extern gboolean pls_check(Pls *pls);
 extern void pls_dump(Pls *pls, gboolean items);
 extern Pls *pls_new(guint id, const gchar *name);
@@ -83,31 +174,237 @@ extern void pls_clear(Pls *pls);
 extern void pls_free(Pls *pls);
 extern gboolean pls_append(Pls *pls, const gchar *oid);
 extern gboolean pls_appends(Pls *pls, const gchar **oid, guint len);
+extern gboolean pls_copy_range(Pls *dst, guint at, Pls *src, guint from,
+			       guint count);
 extern gboolean pls_inserts(Pls *pls, guint idx, const gchar **oids, guint len);
 gboolean pls_insert(Pls *pls, guint idx, const gchar *oid);
 extern gboolean pls_remove(Pls *pls, guint idx);
+extern gboolean pls_removes(Pls *pls, guint idx, guint count);
+extern gboolean pls_apply_ops(Pls *pls, const PlsOp *ops, guint nops,
+			      gboolean *results, guint *first_changed);
 extern void pls_shuffle(Pls *pls);
 extern void pls_unshuffle(Pls *pls);
 extern gchar *pls_get_item(Pls *pls, guint idx);
 extern gchar **pls_get_items(Pls *pls, guint fidx, guint lidx);
+extern gchar **pls_get_items_budget(Pls *pls, guint fidx, guint max_items,
+				    gsize max_bytes, guint *next);
 void pls_get_starting(Pls *pls, guint *index, gchar **oid);
 void pls_get_last(Pls *pls, guint *index, gchar **oid);
 gboolean pls_get_next(Pls *pls, guint *index, gchar **oid);
+extern guint pls_get_next_n(Pls *pls, guint index, guint n,
+			    guint *indices, gchar **oids);
 gboolean pls_get_prev(Pls *pls, guint *index, gchar **oid);
 extern gboolean pls_is_shuffled(Pls *pls);
 extern void pls_set_repeat(Pls *pls, gboolean repeat);
 extern void pls_set_use_count(Pls *pls, guint use_count);
 extern gboolean pls_move(Pls *pls, guint from, guint to);
+extern gboolean pls_changes_since(Pls *pls, guint generation,
+				  GPtrArray *changes);
 extern gint pls_cmpids(gconstpointer a, gconstpointer b, gpointer unused);
+extern gboolean pls_pack(Pls *pls);
+extern void pls_unpack(Pls *pls);
+extern gsize pls_pack_savings(Pls *pls);
+extern void pls_set_paging(guint entries, guint resident);
+extern void pls_items_free(Pls *pls, gchar **oids);
+extern gboolean pls_write(Pls *pls, FILE *f);
 extern gboolean pls_save(Pls *pls, const gchar *fn);
 extern Pls *pls_load(const gchar *fn);
 
+typedef void (*PlsLoadedFunc)(Pls *pls, gpointer udata);
+
+extern const gchar *pls_dir(void);
+extern gboolean pls_ensure_dir(void);
+extern gboolean pls_lock_dir(void);
+extern gchar *pls_path(guint id);
+extern void pls_load_dir(PlsLoadedFunc loaded, gpointer udata);
+extern gboolean pls_load_from(const gchar *dir, PlsLoadedFunc loaded,
+			      gpointer udata);
+
 extern void init_pl_wrapper(DBusConnection *connection);
 
+/* From plparse.c: */
+typedef struct _Plparse Plparse;
+typedef void (*PlparseEntryFunc)(const gchar *uri, gpointer udata);
+
+extern Plparse *plparse_open(const gchar *uri, const gchar *base);
+extern gboolean plparse_read(Plparse *p, guint max, PlparseEntryFunc entry,
+			     gpointer udata, GError **err);
+extern void plparse_close(Plparse *p);
+
+/* From dispatch.c: */
+enum {
+	DISPATCH_INTERACTIVE,
+	DISPATCH_NORMAL,
+	DISPATCH_BULK,
+	DISPATCH_NCLASSES
+};
+
+/*
+ * Request statistics of a dispatch class.
+ *
+ * @handled:     number of requests handled
+ * @deferred:    how many of them were queued first
+ * @total_delay: total time they spent in the queue, in microseconds
+ * @max_delay:   the longest time one spent in the queue
+ */
+typedef struct {
+	guint64 handled;
+	guint64 deferred;
+	gint64 total_delay;
+	gint64 max_delay;
+} DispatchStats;
+
+/* Builds the next slice of the reply to $msg, returns TRUE when it has
+ * replied.  See dispatch_slice(). */
+typedef gboolean (*DispatchSliceFunc)(DBusConnection *conn, DBusMessage *msg,
+				      gpointer data);
+
+extern guint dispatch_class(DBusMessage *msg);
+extern gboolean dispatch_reads_only(DBusMessage *msg);
+extern void playlists_lock(void);
+extern void playlists_unlock(void);
+extern void playlists_read_lock(void);
+extern void playlists_read_unlock(void);
+extern DBusHandlerResult dispatch_request(DBusConnection *con,
+					  DBusMessage *msg, void *unused);
+extern guint dispatch_pending(const gchar *client);
+extern gboolean dispatch_can_slice(DBusMessage *msg);
+extern void dispatch_slice(DBusMessage *msg, DispatchSliceFunc func,
+			   gpointer data, GDestroyNotify free);
+extern void dispatch_set_threads(guint nthreads);
+extern void dispatch_stop_threads(void);
+extern const DispatchStats *dispatch_get_stats(guint klass);
+
+/* From quota.c: */
+
+/*
+ * Resources charged to a client, or the limits of them.
+ *
+ * @playlists: number of playlists
+ * @entries:   total number of their items
+ * @bytes:     total length of the object ids of the items
+ * @requests:  number of requests being processed
+ */
+typedef struct {
+	guint playlists;
+	guint entries;
+	guint64 bytes;
+	guint requests;
+} Quota;
+
+extern void quota_init(void);
+extern const Quota *quota_limits(void);
+extern void quota_usage(const gchar *client, Quota *usage);
+extern void quota_own(Pls *pls, const gchar *client);
+extern void quota_disown(Pls *pls);
+extern gboolean quota_admit(const gchar *client, Pls *pls, guint playlists,
+			    guint entries, guint64 bytes, GError **err);
+extern void quota_update(Pls *pls, guint oldlen, guint64 oldbytes);
+extern guint64 quota_strv_bytes(gchar *const *oids, guint n);
+
+/* From window.c: */
+extern void window_set(DBusConnection *con, const gchar *client, Pls *pls,
+		       guint first, guint count);
+extern void window_forget(guint plid);
+extern void window_contents_changed(guint plid, guint from,
+				    guint nremove, guint nreplace);
+extern void window_item_moved(guint plid, guint from, guint to);
+
+/* From mdcache.c: */
+extern void mdcache_init(DBusConnection *con);
+extern gboolean mdcache_enabled(void);
+extern void mdcache_fetch(Pls *pls, guint first, guint last);
+extern GHashTable *mdcache_lookup(Pls *pls, guint idx);
+extern void mdcache_totals(Pls *pls, guint64 *duration, guint *unknown);
+extern void mdcache_forget(guint plid);
+extern void mdcache_contents_changed(guint plid, guint from,
+				     guint nremove, guint nreplace);
+extern void mdcache_item_moved(guint plid, guint from, guint to);
+
+/* From mirror.c: */
+extern void mirror_get(DBusConnection *con, DBusMessage *msg, Pls *pls);
+extern void mirror_update(guint plid, guint from, guint nremove,
+			  guint nreplace);
+extern void mirror_forget(guint plid);
+
+/* From cold.c: */
+
+/*
+ * Statistics of packing cold playlists.
+ *
+ * @packs:         number of playlists packed
+ * @unpacks:       how many of them were unpacked since
+ * @unpack_usec:   total time spent unpacking
+ * @unpack_max_usec: the longest unpacking
+ */
+typedef struct {
+	guint64 packs;
+	guint64 unpacks;
+	guint64 unpack_usec;
+	guint64 unpack_max_usec;
+} ColdStats;
+
+extern void cold_init(void);
+extern void cold_lock(Pls *pls, gboolean reader);
+extern void cold_thaw(Pls *pls);
+extern void cold_get_stats(ColdStats *stats);
+
+/* From pages.c: */
+
+/*
+ * Statistics of the out-of-core playlists.
+ *
+ * @resident:    number of pages in memory
+ * @faults:      number of pages read in
+ * @writebacks:  number of pages written back
+ * @compactions: number of times a scratch file was compacted
+ */
+typedef struct {
+	guint64 resident;
+	guint64 faults;
+	guint64 writebacks;
+	guint64 compactions;
+} PagesStats;
+
+extern PlsPages *pages_new(const gchar *dir, guint resident);
+extern void pages_free(PlsPages *store);
+extern void pages_adopt(PlsPages *store, guint idx, gchar **oids, guint n);
+extern void pages_insert(PlsPages *store, guint idx, const gchar *const *oids,
+			 guint n);
+extern gsize pages_remove(PlsPages *store, guint idx, guint n);
+extern void pages_get(PlsPages *store, guint from, guint n, gchar **oids);
+extern guint pages_count(PlsPages *store);
+extern void pages_get_stats(PagesStats *stats);
+
+/* From backup.c: */
+extern gboolean backup_start(DBusConnection *con, DBusMessage *req,
+			     const gchar *path, GError **err);
+extern gboolean backup_running(void);
+extern void backup_touch(Pls *pls);
+
+/* From smart.c: */
+extern void smart_init(void);
+extern gboolean smart_check(const gchar *container, const gchar *filter,
+			    GError **err);
+extern void smart_add(Pls *pls, const gchar *container, const gchar *filter,
+		      const gchar *sort);
+extern void smart_demand(Pls *pls, guint idx);
+extern void smart_forget(guint plid);
+extern gchar *smart_path(guint plid);
+extern void smart_restore(guint plid);
+
+/* From stats.c: */
+extern void stats_request(const gchar *member, gint64 usec);
+extern void stats_signal(const gchar *member);
+extern void stats_import(guint entries, gint64 usec, gboolean ok);
+extern DBusHandlerResult stats_handle(DBusConnection *con, DBusMessage *msg);
+
 /* From mafw-playlist-daemon.c: */
 extern void save_me(Pls *pls);
 
 /* From playlist-wrapper.c: */
+extern void send_contents_changed(guint plid, guint from,
+				  guint nremove, guint nreplace);
 extern DBusHandlerResult handle_playlist_request(DBusConnection *con,
 						 DBusMessage *msg,
                                                  const gchar *path);
@@ -117,6 +414,8 @@ extern GMainLoop *Loop;
 extern GTree *Playlists;
 extern GTree *Playlists_by_name;
 
+extern DBusHandlerResult handle_request(DBusConnection *con,
+					DBusMessage *req, void *unused);
 extern void init_playlist_wrapper(DBusConnection *dbus,
 				  gboolean opt_stayalive,
 				  gboolean opt_kill);
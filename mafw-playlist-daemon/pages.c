@@ -0,0 +1,644 @@
+/*
+ * This file is a part of MAFW
+ *
+ * Copyright (C) 2007, 2008, 2009 Nokia Corporation, all rights reserved.
+ *
+ * Contact: Visa Smolander <visa.smolander@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+#include <errno.h>
+#include <unistd.h>
+#include <string.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "mpd-internal.h"
+
+#undef G_LOG_DOMAIN
+#define G_LOG_DOMAIN "mafw-playlist-pages"
+
+/*
+ * Out-of-core storage of the object ids of very large playlists.  The
+ * entries are kept in pages of at most %PAGE_ENTRIES, whose images live
+ * in an unlinked scratch file in the playlist directory.  A page is read
+ * in when an entry of it is accessed, and at most $resident pages of a
+ * store are in memory at a time: the least recently used one is written
+ * back, if it has changed, and dropped to make room.  The page directory
+ * locates the entries, and takes a few dozen bytes per page.
+ *
+ * A page written back goes to the end of the file, leaving its former
+ * image as garbage, and the file is compacted when garbage makes up most
+ * of it.
+ *
+ * Stores have their own lock, so any number of threads may read them.
+ * Strings are always returned copied, since the page they are in may be
+ * dropped by the next access.
+ */
+
+/* Number of entries a page can hold. */
+#define PAGE_ENTRIES		1024
+
+/* The file is compacted when it has at least this much garbage, and
+ * more than live images. */
+#define COMPACT_MIN_BYTES	(1 << 20)
+
+/*
+ * A page of entries.
+ *
+ * @first:      index of its first entry, valid below PlsPages.valid
+ * @count:      number of its entries
+ * @bytes:      size of the entries with their NULs
+ * @offset:     where its image is in the file, -1 if it has none
+ * @disk_bytes: size of the image
+ * @oids:       the entries if the page is resident, otherwise %NULL
+ * @dirty:      whether the entries differ from the image
+ * @link:       in PlsPages.lru if the page is resident
+ */
+typedef struct {
+	guint first;
+	guint count;
+	gsize bytes;
+	goffset offset;
+	gsize disk_bytes;
+	gchar **oids;
+	gboolean dirty;
+	GList link;
+} Page;
+
+/*
+ * @lock:     protects everything below
+ * @dir:      directory of the scratch file
+ * @fd:       the scratch file
+ * @end:      size of the scratch file
+ * @garbage:  bytes of the file not belonging to any page
+ * @pages:    the Page:s in order
+ * @valid:    the Page.first of this many $pages are right
+ * @lru:      the resident pages, the most recently used first
+ * @resident: maximal length of $lru
+ */
+struct _PlsPages {
+	GMutex lock;
+	gchar *dir;
+	gint fd;
+	goffset end;
+	goffset garbage;
+	GPtrArray *pages;
+	guint valid;
+	GQueue lru;
+	guint resident;
+};
+
+static PagesStats Stats;
+G_LOCK_DEFINE_STATIC(Stats);
+
+/* Creates an unlinked scratch file in $dir, returns its descriptor or -1. */
+static gint scratch_file(const gchar *dir)
+{
+	gchar *fn;
+	gint fd;
+
+	fn = g_build_filename(dir, ".pages-XXXXXX", NULL);
+	if ((fd = g_mkstemp(fn)) < 0)
+		g_warning("can't create '%s': %s", fn, g_strerror(errno));
+	else
+		g_unlink(fn);
+	g_free(fn);
+	return fd;
+}
+
+/* Writes $len bytes of $buf at $offset of $fd, returns whether it could. */
+static gboolean write_at(gint fd, const gchar *buf, gsize len, goffset offset)
+{
+	gssize n;
+
+	while (len) {
+		if ((n = pwrite(fd, buf, len, offset)) < 0) {
+			if (errno == EINTR)
+				continue;
+			return FALSE;
+		}
+		buf += n;
+		len -= n;
+		offset += n;
+	}
+	return TRUE;
+}
+
+/* Reads $len bytes at $offset of $fd into $buf, returns whether it could. */
+static gboolean read_at(gint fd, gchar *buf, gsize len, goffset offset)
+{
+	gssize n;
+
+	while (len) {
+		if ((n = pread(fd, buf, len, offset)) <= 0) {
+			if (n < 0 && errno == EINTR)
+				continue;
+			return FALSE;
+		}
+		buf += n;
+		len -= n;
+		offset += n;
+	}
+	return TRUE;
+}
+
+/* Copies the live images to a new scratch file, dropping the garbage.
+ * Stays with the old file if it can't. */
+static void compact(PlsPages *store)
+{
+	goffset end;
+	gchar *buf;
+	gint fd;
+	guint i;
+
+	if ((fd = scratch_file(store->dir)) < 0)
+		return;
+
+	end = 0;
+	for (i = 0; i < store->pages->len; i++) {
+		Page *page = g_ptr_array_index(store->pages, i);
+		gboolean ok;
+
+		if (page->offset < 0)
+			continue;
+		buf = g_malloc(page->disk_bytes);
+		ok = read_at(store->fd, buf, page->disk_bytes, page->offset)
+			&& write_at(fd, buf, page->disk_bytes, end);
+		g_free(buf);
+		if (!ok) {
+			g_warning("compacting pages failed: %s",
+				  g_strerror(errno));
+			close(fd);
+			return;
+		}
+		end += page->disk_bytes;
+	}
+
+	/* Nothing can fail from now on. */
+	end = 0;
+	for (i = 0; i < store->pages->len; i++) {
+		Page *page = g_ptr_array_index(store->pages, i);
+
+		if (page->offset < 0)
+			continue;
+		page->offset = end;
+		end += page->disk_bytes;
+	}
+	close(store->fd);
+	store->fd = fd;
+	store->end = end;
+	store->garbage = 0;
+
+	G_LOCK(Stats);
+	Stats.compactions++;
+	G_UNLOCK(Stats);
+}
+
+/* Forgets the image of $page. */
+static void drop_image(PlsPages *store, Page *page)
+{
+	if (page->offset < 0)
+		return;
+	store->garbage += page->disk_bytes;
+	page->offset = -1;
+	page->disk_bytes = 0;
+}
+
+/* Writes back $page if it's dirty and drops its entries.  Returns FALSE
+ * and leaves it resident if it couldn't be written. */
+static gboolean evict(PlsPages *store, Page *page)
+{
+	guint i;
+
+	if (page->dirty) {
+		gchar *buf, *p;
+		gboolean ok;
+
+		buf = p = g_malloc(page->bytes);
+		for (i = 0; i < page->count; i++)
+			p = g_stpcpy(p, page->oids[i]) + 1;
+		ok = write_at(store->fd, buf, page->bytes, store->end);
+		g_free(buf);
+		if (!ok) {
+			g_warning("writing back a page failed: %s",
+				  g_strerror(errno));
+			return FALSE;
+		}
+		drop_image(store, page);
+		page->offset = store->end;
+		page->disk_bytes = page->bytes;
+		page->dirty = FALSE;
+		store->end += page->bytes;
+
+		G_LOCK(Stats);
+		Stats.writebacks++;
+		G_UNLOCK(Stats);
+	}
+
+	for (i = 0; i < page->count; i++)
+		g_free(page->oids[i]);
+	g_free(page->oids);
+	page->oids = NULL;
+	g_queue_unlink(&store->lru, &page->link);
+
+	G_LOCK(Stats);
+	Stats.resident--;
+	G_UNLOCK(Stats);
+
+	if (store->garbage >= COMPACT_MIN_BYTES
+	    && store->garbage > store->end - store->garbage)
+		compact(store);
+	return TRUE;
+}
+
+/* Evicts the least recently used pages until at most $resident are left,
+ * except $keep. */
+static void trim(PlsPages *store, Page *keep)
+{
+	GList *l, *prev;
+
+	for (l = store->lru.tail; l && store->lru.length > store->resident;
+	     l = prev) {
+		prev = l->prev;
+		if (l->data != keep)
+			evict(store, l->data);
+	}
+}
+
+/* Makes $page resident and the most recently used one. */
+static void load(PlsPages *store, Page *page)
+{
+	gchar *buf, *p;
+	guint i;
+
+	if (page->oids) {
+		g_queue_unlink(&store->lru, &page->link);
+		g_queue_push_head_link(&store->lru, &page->link);
+		return;
+	}
+
+	page->oids = g_new(gchar *, PAGE_ENTRIES);
+	if (page->offset >= 0) {
+		buf = g_malloc(page->disk_bytes);
+		if (!read_at(store->fd, buf, page->disk_bytes, page->offset))
+			g_error("reading a page failed: %s",
+				g_strerror(errno));
+		for (p = buf, i = 0; i < page->count; i++) {
+			page->oids[i] = g_strdup(p);
+			p += strlen(p) + 1;
+		}
+		g_free(buf);
+
+		G_LOCK(Stats);
+		Stats.faults++;
+		G_UNLOCK(Stats);
+	}
+	g_queue_push_head_link(&store->lru, &page->link);
+
+	G_LOCK(Stats);
+	Stats.resident++;
+	G_UNLOCK(Stats);
+
+	trim(store, page);
+}
+
+/* Inserts a new empty resident page at $pos of the directory. */
+static Page *page_new(PlsPages *store, guint pos)
+{
+	Page *page;
+
+	page = g_new0(Page, 1);
+	page->offset = -1;
+	page->link.data = page;
+	g_ptr_array_add(store->pages, NULL);
+	memmove(&store->pages->pdata[pos + 1], &store->pages->pdata[pos],
+		(store->pages->len - pos - 1) * sizeof(gpointer));
+	store->pages->pdata[pos] = page;
+	store->valid = MIN(store->valid, pos);
+	load(store, page);
+	return page;
+}
+
+/* Removes the page at $pos of the directory. */
+static void page_free(PlsPages *store, guint pos)
+{
+	Page *page;
+	guint i;
+
+	page = g_ptr_array_index(store->pages, pos);
+	if (page->oids) {
+		for (i = 0; i < page->count; i++)
+			g_free(page->oids[i]);
+		g_free(page->oids);
+		g_queue_unlink(&store->lru, &page->link);
+
+		G_LOCK(Stats);
+		Stats.resident--;
+		G_UNLOCK(Stats);
+	}
+	drop_image(store, page);
+	g_ptr_array_remove_index(store->pages, pos);
+	store->valid = MIN(store->valid, pos);
+	g_free(page);
+}
+
+/* Returns the position of the page holding the $idx:th entry, and the
+ * index of the entry within the page in $at.  $idx may be the number of
+ * entries, which is located past the last entry of the last page. */
+static guint locate(PlsPages *store, guint idx, guint *at)
+{
+	Page *page;
+	guint lo, hi, mid;
+
+	for (; store->valid < store->pages->len; store->valid++) {
+		Page *prev;
+
+		page = g_ptr_array_index(store->pages, store->valid);
+		if (store->valid) {
+			prev = g_ptr_array_index(store->pages,
+						 store->valid - 1);
+			page->first = prev->first + prev->count;
+		} else
+			page->first = 0;
+	}
+
+	/* The last page whose first entry is not after $idx. */
+	lo = 0;
+	hi = store->pages->len;
+	while (hi - lo > 1) {
+		mid = (lo + hi) / 2;
+		page = g_ptr_array_index(store->pages, mid);
+		if (page->first <= idx)
+			lo = mid;
+		else
+			hi = mid;
+	}
+	page = g_ptr_array_index(store->pages, lo);
+	*at = idx - page->first;
+	return lo;
+}
+
+/* Appends $oid, which is taken over, after the entries of the page at
+ * *$pos, or to a new page after it if it's full.  *$pos is updated to
+ * the page it went into. */
+static void put(PlsPages *store, guint *pos, gchar *oid)
+{
+	Page *page;
+
+	page = g_ptr_array_index(store->pages, *pos);
+	if (page->count == PAGE_ENTRIES)
+		page = page_new(store, ++*pos);
+	else
+		load(store, page);
+	page->oids[page->count++] = oid;
+	page->bytes += strlen(oid) + 1;
+	page->dirty = TRUE;
+	store->valid = MIN(store->valid, *pos + 1);
+}
+
+/**
+ * pages_new:
+ * @dir:      where to keep the scratch file
+ * @resident: how many pages may be in memory at a time
+ *
+ * Creates an empty store, or returns %NULL if the scratch file can't be
+ * created.
+ */
+PlsPages *pages_new(const gchar *dir, guint resident)
+{
+	PlsPages *store;
+	gint fd;
+
+	if ((fd = scratch_file(dir)) < 0)
+		return NULL;
+	store = g_new0(PlsPages, 1);
+	g_mutex_init(&store->lock);
+	store->dir = g_strdup(dir);
+	store->fd = fd;
+	store->pages = g_ptr_array_new();
+	g_queue_init(&store->lru);
+	store->resident = MAX(resident, 1);
+	return store;
+}
+
+/**
+ * pages_free:
+ * @store: a store
+ *
+ * Frees @store and its scratch file.
+ */
+void pages_free(PlsPages *store)
+{
+	while (store->pages->len)
+		page_free(store, store->pages->len - 1);
+	g_ptr_array_free(store->pages, TRUE);
+	close(store->fd);
+	g_free(store->dir);
+	g_mutex_clear(&store->lock);
+	g_free(store);
+}
+
+/**
+ * pages_adopt:
+ * @store: a store
+ * @idx:   where to insert, at most the number of entries of @store
+ * @oids:  entries to insert, taken over
+ * @n:     length of @oids
+ *
+ * Inserts the @n entries of @oids at @idx of @store.  @oids itself is
+ * not taken.
+ */
+void pages_adopt(PlsPages *store, guint idx, gchar **oids, guint n)
+{
+	gchar **tail;
+	Page *page;
+	guint pos, at, ntail, i;
+
+	if (!n)
+		return;
+
+	g_mutex_lock(&store->lock);
+	if (!store->pages->len)
+		page_new(store, 0);
+	pos = locate(store, idx, &at);
+	page = g_ptr_array_index(store->pages, pos);
+	load(store, page);
+
+	if (page->count + n <= PAGE_ENTRIES) {
+		memmove(&page->oids[at + n], &page->oids[at],
+			(page->count - at) * sizeof(gchar *));
+		for (i = 0; i < n; i++) {
+			page->oids[at + i] = oids[i];
+			page->bytes += strlen(oids[i]) + 1;
+		}
+		page->count += n;
+		page->dirty = TRUE;
+		store->valid = MIN(store->valid, pos + 1);
+		g_mutex_unlock(&store->lock);
+		return;
+	}
+
+	/* Cut the page at $at, then append the new entries and the ones
+	 * cut, filling up pages as needed. */
+	ntail = page->count - at;
+	tail = g_new(gchar *, ntail + 1);
+	memcpy(tail, &page->oids[at], ntail * sizeof(gchar *));
+	for (i = 0; i < ntail; i++)
+		page->bytes -= strlen(tail[i]) + 1;
+	page->count = at;
+	page->dirty = TRUE;
+	for (i = 0; i < n; i++)
+		put(store, &pos, oids[i]);
+	for (i = 0; i < ntail; i++)
+		put(store, &pos, tail[i]);
+	g_free(tail);
+	g_mutex_unlock(&store->lock);
+}
+
+/**
+ * pages_insert:
+ * @store: a store
+ * @idx:   where to insert, at most the number of entries of @store
+ * @oids:  entries to insert
+ * @n:     length of @oids
+ *
+ * Like pages_adopt(), but inserts copies of @oids.
+ */
+void pages_insert(PlsPages *store, guint idx, const gchar *const *oids,
+		  guint n)
+{
+	gchar **copies;
+	guint i;
+
+	copies = g_new(gchar *, n + 1);
+	for (i = 0; i < n; i++)
+		copies[i] = g_strdup(oids[i]);
+	pages_adopt(store, idx, copies, n);
+	g_free(copies);
+}
+
+/**
+ * pages_remove:
+ * @store: a store
+ * @idx:   index of the first entry to remove
+ * @n:     number of entries to remove, which must exist
+ *
+ * Removes @n entries of @store from @idx on.  Returns the total length
+ * of the entries removed.
+ */
+gsize pages_remove(PlsPages *store, guint idx, guint n)
+{
+	Page *page;
+	guint pos, at, k, i;
+	gsize removed;
+
+	removed = 0;
+	g_mutex_lock(&store->lock);
+	while (n) {
+		pos = locate(store, idx, &at);
+		page = g_ptr_array_index(store->pages, pos);
+		k = MIN(n, page->count - at);
+		if (!at && k == page->count) {
+			/* No need to read it in. */
+			removed += page->bytes - page->count;
+			page_free(store, pos);
+			n -= k;
+			continue;
+		}
+
+		load(store, page);
+		for (i = at; i < at + k; i++) {
+			gsize len;
+
+			len = strlen(page->oids[i]);
+			removed += len;
+			page->bytes -= len + 1;
+			g_free(page->oids[i]);
+		}
+		memmove(&page->oids[at], &page->oids[at + k],
+			(page->count - at - k) * sizeof(gchar *));
+		page->count -= k;
+		page->dirty = TRUE;
+		store->valid = MIN(store->valid, pos + 1);
+		n -= k;
+	}
+	g_mutex_unlock(&store->lock);
+	return removed;
+}
+
+/**
+ * pages_get:
+ * @store: a store
+ * @from:  index of the first entry
+ * @n:     number of entries, which must exist
+ * @oids:  where to store copies of the entries
+ *
+ * Copies @n entries of @store from @from on.
+ */
+void pages_get(PlsPages *store, guint from, guint n, gchar **oids)
+{
+	Page *page;
+	guint pos, at;
+
+	if (!n)
+		return;
+	g_mutex_lock(&store->lock);
+	pos = locate(store, from, &at);
+	while (n) {
+		page = g_ptr_array_index(store->pages, pos++);
+		load(store, page);
+		for (; at < page->count && n; at++, n--)
+			*oids++ = g_strdup(page->oids[at]);
+		at = 0;
+	}
+	g_mutex_unlock(&store->lock);
+}
+
+/**
+ * pages_count:
+ * @store: a store
+ *
+ * Returns the number of pages of @store.
+ */
+guint pages_count(PlsPages *store)
+{
+	guint n;
+
+	g_mutex_lock(&store->lock);
+	n = store->pages->len;
+	g_mutex_unlock(&store->lock);
+	return n;
+}
+
+/**
+ * pages_get_stats:
+ * @stats: where to store the statistics
+ *
+ * Tells the statistics of all stores.
+ */
+void pages_get_stats(PagesStats *stats)
+{
+	G_LOCK(Stats);
+	*stats = Stats;
+	G_UNLOCK(Stats);
+}
+
+/* vi: set noexpandtab ts=8 sw=8 cino=t0,(0: */
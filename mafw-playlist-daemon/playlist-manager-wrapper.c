@@ -34,6 +34,7 @@
 
 #include <glib.h>
 #include <glib/gstdio.h>
+#include <gio/gio.h>
 
 #include <libmafw/mafw-errors.h>
 #include <libmafw/mafw-source.h>
@@ -43,6 +44,7 @@
 #include "libmafw-shared/mafw-shared.h"
 #include "common/dbus-interface.h"
 #include "common/mafw-dbus.h"
+#include "common/mafw-session.h"
 #include "mpd-internal.h"
 
 /* Standard definitions */
@@ -55,9 +57,6 @@
 #define MAFW_DBUS_PATH		MAFW_PLAYLIST_PATH
 #define MAFW_DBUS_INTERFACE	MAFW_PLAYLIST_INTERFACE
 
-/* Default location to save playlists. */
-#define DEFAULT_PLS_DIR		".mafw-playlists"
-
 /* Globals. */
 GMainLoop *Loop;
 
@@ -90,39 +89,142 @@ static gboolean append_pls(guint id, Pls *pls, DBusMessageIter *iter)
 	return FALSE;
 }
 
-/* Returns the directory where playlists will be saved.  It defaults to
- * $HOME/DEFAULT_PLS_DIR, but can be overridden via the $MAFW_PLAYLIST_DIR
- * environment variable.  The returned string points to a static storage and
- * must not be freed. */
-static const gchar *playlist_dir(void)
+/* Like append_pls(), but adds all properties of the playlist.  Used to
+ * construct the reply to list_playlists_full requests. */
+static gboolean append_pls_full(guint id, Pls *pls, DBusMessageIter *iter)
 {
-	static gchar *playlist_dir;
-	const gchar *home, *pld;
+	DBusMessageIter istr;
+	dbus_bool_t repeat, shuffled;
+	dbus_uint64_t mtime;
+
+	repeat = pls->repeat;
+	shuffled = pls->shuffled;
+	mtime = pls->mtime;
+	dbus_message_iter_open_container(iter, DBUS_TYPE_STRUCT, NULL, &istr);
+	dbus_message_iter_append_basic(&istr,  DBUS_TYPE_UINT32, &pls->id);
+	dbus_message_iter_append_basic(&istr,  DBUS_TYPE_STRING, &pls->name);
+	dbus_message_iter_append_basic(&istr,  DBUS_TYPE_UINT32, &pls->len);
+	dbus_message_iter_append_basic(&istr,  DBUS_TYPE_BOOLEAN, &repeat);
+	dbus_message_iter_append_basic(&istr,  DBUS_TYPE_BOOLEAN, &shuffled);
+	dbus_message_iter_append_basic(&istr,  DBUS_TYPE_UINT32,
+				       &pls->use_count);
+	dbus_message_iter_append_basic(&istr,  DBUS_TYPE_UINT64, &mtime);
+	dbus_message_iter_close_container(iter, &istr);
+	return FALSE;
+}
+
+/* The most playlists a list_playlists(_full) reply gets per main loop
+ * iteration, see pls_list_slice(). */
+#define PLS_LIST_SLICE 256
+
+/*
+ * A list_playlists(_full) reply being built.
+ *
+ * @reply:  the reply
+ * @imsg:   its iterator
+ * @iary:   the iterator of the array of playlists in it
+ * @append: append_pls() or append_pls_full()
+ * @ids:    the playlists to list
+ * @next:   the index of the first of @ids not listed yet
+ * @whole:  whether to list all the remaining @ids at once
+ */
+typedef struct {
+	DBusMessage *reply;
+	DBusMessageIter imsg, iary;
+	GTraverseFunc append;
+	GArray *ids;
+	guint next;
+	gboolean whole;
+} PlsList;
+
+static gboolean collect_id(gpointer id, Pls *pls, GArray *ids)
+{
+	guint plid;
+
+	plid = GPOINTER_TO_UINT(id);
+	g_array_append_val(ids, plid);
+	return FALSE;
+}
 
-	if (playlist_dir)
-		return playlist_dir;
-	pld = g_getenv("MAFW_PLAYLIST_DIR");
-	if (pld) {
-		playlist_dir = g_strdup(pld);
+/* Starts the reply to the list_playlists(_full) $req. */
+static PlsList *pls_list_new(DBusMessage *req)
+{
+	PlsList *list;
+	const gchar *sig;
+
+	list = g_new0(PlsList, 1);
+	if (!strcmp(dbus_message_get_member(req),
+		    MAFW_PLAYLIST_METHOD_LIST_PLAYLISTS_FULL)) {
+		list->append = (GTraverseFunc)append_pls_full;
+		sig = "(usubbut)";
+	} else {
+		list->append = (GTraverseFunc)append_pls;
+		sig = "(us)";
+	}
+	list->reply = mafw_dbus_reply(req);
+	dbus_message_iter_init_append(list->reply, &list->imsg);
+	dbus_message_iter_open_container(&list->imsg, DBUS_TYPE_ARRAY,
+					 sig, &list->iary);
+
+	list->ids = g_array_new(FALSE, FALSE, sizeof(guint));
+	if (dbus_message_get_signature(req)[0] != '\0') {
+		guint nids;
+		guint *ids;
+
+		/* Retrieve information about the playlists
+		 * whose ID are specified in the array. */
+		mafw_dbus_parse(req, DBUS_TYPE_ARRAY,
+				 DBUS_TYPE_UINT32, &ids, &nids);
+		g_array_append_vals(list->ids, ids, nids);
 	} else {
-		home = g_getenv("HOME");
-		if (!home)
-			home = g_get_home_dir();
-		playlist_dir = g_build_filename(home, DEFAULT_PLS_DIR, NULL);
+		/* Return information about all known playlists. */
+		g_tree_foreach(Playlists, (GTraverseFunc)collect_id,
+			       list->ids);
 	}
-	return playlist_dir;
+	list->whole = !dispatch_can_slice(req);
+	return list;
 }
 
-/* Makes sure that the playlist directory exists, returns FALSE if it can't. */
-static gboolean ensure_playlist_dir(void)
+static void pls_list_free(PlsList *list)
 {
-	if (mkdir(playlist_dir(), 0700) == -1 && errno != EEXIST) {
-		g_critical("failed to ensure existence of playlist directory"
-			   ", playlists cannot be saved. %s: (%s)",
-			   playlist_dir(), g_strerror(errno));
+	if (list->reply)
+		dbus_message_unref(list->reply);
+	g_array_free(list->ids, TRUE);
+	g_free(list);
+}
+
+/* Adds the next PLS_LIST_SLICE playlists of $list to the reply, or all
+ * the rest if $list->whole, and sends it to $req when done.  Returns
+ * whether it has.  The playlists listed are the ones existing when $req
+ * arrived, minus those destroyed meanwhile. */
+static gboolean pls_list_slice(DBusConnection *con, DBusMessage *req,
+			       PlsList *list)
+{
+	guint end;
+
+	end = list->ids->len;
+	if (!list->whole && end - list->next > PLS_LIST_SLICE)
+		end = list->next + PLS_LIST_SLICE;
+	for (; list->next < end; list->next++) {
+		guint id;
+		Pls *pls;
+
+		id = g_array_index(list->ids, guint, list->next);
+		pls = g_tree_lookup(Playlists, GUINT_TO_POINTER(id));
+		/* It may happen that there's no playlist with
+		 * the given id; for example when the playlist
+		 * manager's (or someone else's) idea of
+		 * playlists is outdated. */
+		if (pls)
+			list->append(GUINT_TO_POINTER(id), pls, &list->iary);
+	}
+	if (list->next < list->ids->len)
 		return FALSE;
-	} else
-		return TRUE;
+
+	dbus_message_iter_close_container(&list->imsg, &list->iary);
+	mafw_dbus_send(con, list->reply);
+	list->reply = NULL;
+	return TRUE;
 }
 
 /* Triggered from aplaylist.c after edit operations have settled on $pls. */
@@ -130,12 +232,15 @@ void save_me(Pls *pls)
 {
 	gchar *fn;
 
-	if (!ensure_playlist_dir())
+	if (!pls_ensure_dir())
 		return;
-	fn = g_strdup_printf("%s" G_DIR_SEPARATOR_S "%u",
-			     playlist_dir(), pls->id);
+	cold_thaw(pls);
+	fn = pls_path(pls->id);
+	/* Workers may be shuffling it lazily. */
+	g_rw_lock_reader_lock(&pls->lock);
 	if (pls_save(pls, fn))
 		pls->dirty = FALSE;
+	g_rw_lock_reader_unlock(&pls->lock);
 	g_free(fn);
 }
 
@@ -152,82 +257,153 @@ void save_all_playlists(void)
 	g_tree_foreach(Playlists, (GTraverseFunc)save_pls_cb, NULL);
 }
 
-static void load_playlists(void)
+/* Adds $pls loaded by pls_load_dir() to our playlists. */
+static void playlist_loaded(Pls *pls, gpointer unused)
 {
-	GDir *d;
-	const gchar *fn;
+	/* We cannot issue lower playlist id:s than any existing. */
+	if (Last_id <= pls->id)
+		Last_id = pls->id + 1;
+	g_tree_insert(Playlists, GUINT_TO_POINTER(pls->id), pls);
+	g_tree_insert(Playlists_by_name, g_strdup(pls->name), pls);
+}
 
-	d = g_dir_open(playlist_dir(), 0, NULL);
-	if (!d) {
-		if (errno != ENOENT)
-			g_critical("failed to open playlist directory: %s",
-				   g_strerror(errno));
-		return;
-	}
-	/* Handle the case where the final rename() of a previously written
-	 * playlist failed: if $fn ends with '.tmp' do the renaming now, then
-	 * load the playlists. */
-	while ((fn = g_dir_read_name(d))) {
-		gchar *dot;
-
-		if ((dot = strrchr(fn, '.')) && dot != fn) {
-			gchar *nufn;
-			struct stat sb;
-			gint statret;
-
-			if (strcmp(dot, ".tmp"))
-				continue;
-			/* Minor sanity check: we accept only nonempty regular
-			 * files.  Otherwise we try to unlink the file, to avoid
-			 * future hassle. */
-			statret = stat(fn, &sb);
-			if ( statret == -1 ||
-			    ( (statret != -1) && (!S_ISREG(sb.st_mode) ||
-			    				sb.st_size == 0)))
-			{
-				g_unlink(fn);
-				continue;
-			}
-			nufn = g_strndup(fn, dot - fn);
-			rename(fn, nufn);
-			g_free(nufn);
+/* Tree traversal callback adding $pls to $all. */
+static gboolean collect_pls(gpointer id, Pls *pls, GPtrArray *all)
+{
+	g_ptr_array_add(all, pls);
+	return FALSE;
+}
+
+/* pls_load_from() callback adding $pls to $restored. */
+static void playlist_restored(Pls *pls, GPtrArray *restored)
+{
+	g_ptr_array_add(restored, pls);
+}
+
+/* Copies the smart playlist definition of $plid from the backup in $dir,
+ * if it has one, and starts maintaining it. */
+static void restore_smart(const gchar *dir, guint plid)
+{
+	gchar *fn, *path, *data;
+	gsize len;
+	GError *err = NULL;
+
+	fn = g_strdup_printf("%u.smart", plid);
+	path = g_build_filename(dir, fn, NULL);
+	if (g_file_get_contents(path, &data, &len, NULL)) {
+		g_free(path);
+		path = smart_path(plid);
+		if (g_file_set_contents(path, data, len, &err)) {
+			smart_restore(plid);
+		} else {
+			g_critical("failed to save %s: %s", path,
+				   err->message);
+			g_error_free(err);
 		}
+		g_free(data);
+	}
+	g_free(path);
+	g_free(fn);
+}
+
+/* Replaces all our playlists with those backed up in $dir.  Playlists
+ * in use stay so if the backup has them. */
+static gboolean restore_from(const gchar *dir, GError **err)
+{
+	GPtrArray *old, *restored;
+	guint i;
+
+	if (backup_running()) {
+		g_set_error(err, G_IO_ERROR, G_IO_ERROR_BUSY,
+			    "A backup is in progress");
+		return FALSE;
+	}
+	restored = g_ptr_array_new();
+	if (!pls_load_from(dir, (PlsLoadedFunc)playlist_restored, restored)) {
+		g_set_error(err, G_IO_ERROR, G_IO_ERROR_NOT_FOUND,
+			    "Cannot read %s", dir);
+		g_ptr_array_free(restored, TRUE);
+		return FALSE;
 	}
-	g_dir_close(d);
 
-	/* The second open should succeed unconditionally... */
-	d = g_dir_open(playlist_dir(), 0, NULL);
-	g_assert(d);
-	initialize = TRUE;
-	while ((fn = g_dir_read_name(d))) {
+	/* Forget the current playlists, but keep them until we know
+	 * which are in use. */
+	old = g_ptr_array_new();
+	g_tree_foreach(Playlists, (GTraverseFunc)collect_pls, old);
+	for (i = 0; i < old->len; i++) {
 		Pls *pls;
-		gchar *fullfn;
+		gchar *fn;
+
+		pls = old->pdata[i];
+		fn = pls_path(pls->id);
+		if (g_unlink(fn) == -1 && errno != ENOENT)
+			g_warning("error while deleting '%s': %s",
+				  fn, g_strerror(errno));
+		g_free(fn);
+		quota_disown(pls);
+		smart_forget(pls->id);
+		window_forget(pls->id);
+		mdcache_forget(pls->id);
+		mirror_forget(pls->id);
+		g_tree_remove(Playlists_by_name, pls->name);
+		g_tree_steal(Playlists, GUINT_TO_POINTER(pls->id));
+	}
 
-		fullfn = g_build_filename(playlist_dir(), fn, NULL);
-		pls = pls_load(fullfn);
-		g_free(fullfn);
-		if (!pls) {
-			g_warning("failed to load from: %s", fn);
+	for (i = 0; i < restored->len; i++) {
+		Pls *pls;
+
+		pls = restored->pdata[i];
+		if (g_tree_lookup(Playlists, GUINT_TO_POINTER(pls->id))
+		    || g_tree_lookup(Playlists_by_name, pls->name)) {
+			g_warning("playlist %u (%s) is duplicated in %s",
+				  pls->id, pls->name, dir);
+			pls_free(pls);
 			continue;
 		}
-		/* We cannot issue lower playlist id:s than any existing. */
-		if (Last_id <= pls->id)
-			Last_id = pls->id + 1;
-		g_tree_insert(Playlists, GUINT_TO_POINTER(pls->id), pls);
-		g_tree_insert(Playlists_by_name, g_strdup(pls->name), pls);
+		playlist_loaded(pls, NULL);
+		save_me(pls);
+		restore_smart(dir, pls->id);
 	}
-	initialize = FALSE;
-	g_dir_close(d);
+
+	for (i = 0; i < old->len; i++) {
+		Pls *pls, *new_pls;
+
+		pls = old->pdata[i];
+		new_pls = g_tree_lookup(Playlists, GUINT_TO_POINTER(pls->id));
+		if (new_pls)
+			new_pls->use_count = pls->use_count;
+		pls_free(pls);
+	}
+	g_ptr_array_free(old, TRUE);
+	g_ptr_array_free(restored, TRUE);
+	return TRUE;
+}
+
+/* Returns the total length of the $count object ids of $pls from $from. */
+static guint64 range_bytes(Pls *pls, guint from, guint count)
+{
+	gchar **oids;
+	guint64 bytes;
+
+	if (!count)
+		return 0;
+	oids = pls_get_items(pls, from, from + count - 1);
+	bytes = quota_strv_bytes(oids, count);
+	pls_items_free(pls, oids);
+	return bytes;
 }
 
 static void signal_playlist_created(DBusConnection *con, guint new_id)
 {
+	stats_signal(MAFW_PLAYLIST_SIGNAL_PLAYLIST_CREATED);
 	mafw_dbus_send(con, mafw_dbus_signal(
                                MAFW_PLAYLIST_SIGNAL_PLAYLIST_CREATED,
                                MAFW_DBUS_UINT32(new_id)));
 }
 
 static GHashTable *import_requests;
+/* Session registry subsystem of the clients waiting for an import. */
+static guint Importers;
 
 static guint get_next_import_id(void)
 {
@@ -235,41 +411,218 @@ static guint get_next_import_id(void)
 	return ++next_id;
 }
 
+/* Send a progress notification every this many imported entries. */
+#define IMPORT_PROGRESS_STEP	500
+/* Number of lines plparse_read() processes before the entries found are
+ * passed to the main thread. */
+#define IMPORT_NATIVE_STEP	256
+/* Number of items to browse at once when importing a container. */
+#define IMPORT_BROWSE_PAGE	1000
+
+/*
+ * @oids:     object ids collected but not added to the playlist yet
+ * @count:    number of entries collected so far
+ * @reported: @count at the last progress notification
+ * @pls_id:   id of the playlist being filled, 0 until it is created
+ * @announced: playlist_created has been sent about @pls_id
+ * @recursive: import the items of the subcontainers too
+ * @container: object id of the container being browsed
+ * @skip:     index of the first item of the browse page being received
+ * @page_items: number of items received in the current page
+ * @parser:   the parser of a file import in progress
+ * @native:   the parser of a local M3U or PLS file, used instead of @parser
+ * @native_chunks: GPtrArray:s of object ids parsed by the worker thread
+ *             running @native, not collected yet
+ * @native_id: the idle source collecting @native_chunks, locked by
+ *             %Native_chunks
+ * @parse_cancel: cancels the parsing of @parser or @native
+ * @started:  when the import was requested, for the statistics
+ */
 struct plparse_data {
 	gchar *pl_uri;
 	gchar *base;
 	MafwDBusOpCompletedInfo *oci;
 	guint import_id;
-	GList *urilist;
-	gboolean list_from_browse;
+	GPtrArray *oids;
+	guint count;
+	guint reported;
+	guint pls_id;
+	gboolean announced;
+	gboolean recursive;
+	gchar *container;
 	MafwSource *source;
 	guint browse_id;
+	guint skip;
+	guint page_items;
+	TotemPlParser *parser;
+	Plparse *native;
+	GAsyncQueue *native_chunks;
+	guint native_id;
+	GCancellable *parse_cancel;
 	gboolean cancel;
+	gint64 started;
 };
 
+G_LOCK_DEFINE_STATIC(Native_chunks);
+
+static void free_chunk(GPtrArray *chunk)
+{
+	g_ptr_array_foreach(chunk, (GFunc)g_free, NULL);
+	g_ptr_array_free(chunk, TRUE);
+}
+
 static void free_plparse_data(struct plparse_data *pl_dat)
 {
-	GList *cur_item = pl_dat->urilist;
 	if (pl_dat->pl_uri)
 		g_free(pl_dat->pl_uri);
 	if (pl_dat->base)
 		g_free(pl_dat->base);
+	g_free(pl_dat->container);
 	if (pl_dat->oci)
-		mafw_dbus_oci_free(pl_dat->oci);
-	while(cur_item)
 	{
-		g_free(cur_item->data);
-		cur_item = g_list_delete_link(cur_item, cur_item);
+		mafw_session_release(Importers,
+				     dbus_message_get_sender(pl_dat->oci->msg),
+				     pl_dat);
+		mafw_dbus_oci_free(pl_dat->oci);
+	}
+	if (pl_dat->parser) {
+		/* The parser may outlive us while it's finishing an
+		 * asynchronous parse, don't let it call us back. */
+		g_signal_handlers_disconnect_by_data(pl_dat->parser, pl_dat);
+		g_object_unref(pl_dat->parser);
+	}
+	if (pl_dat->native_id)
+		g_source_remove(pl_dat->native_id);
+	if (pl_dat->native)
+		plparse_close(pl_dat->native);
+	if (pl_dat->native_chunks) {
+		GPtrArray *chunk;
+
+		while ((chunk = g_async_queue_try_pop(pl_dat->native_chunks)))
+			free_chunk(chunk);
+		g_async_queue_unref(pl_dat->native_chunks);
 	}
+	if (pl_dat->parse_cancel)
+		g_object_unref(pl_dat->parse_cancel);
+	g_ptr_array_foreach(pl_dat->oids, (GFunc)g_free, NULL);
+	g_ptr_array_free(pl_dat->oids, TRUE);
 	g_free(pl_dat);
 }
 
-static void import_done(struct plparse_data *pl_dat, const GError *err)
+/* Collects @oid (taking ownership) and reports the progress of the import
+ * to the requester every %IMPORT_PROGRESS_STEP entries. */
+static void import_add(struct plparse_data *pl_dat, gchar *oid)
+{
+	g_ptr_array_add(pl_dat->oids, oid);
+	pl_dat->count++;
+	if (pl_dat->count - pl_dat->reported < IMPORT_PROGRESS_STEP)
+		return;
+	pl_dat->reported = pl_dat->count;
+	mafw_dbus_send(pl_dat->oci->con, mafw_dbus_method_full(
+				dbus_message_get_sender(pl_dat->oci->msg),
+				MAFW_PLAYLIST_PATH,
+				MAFW_PLAYLIST_INTERFACE,
+				MAFW_PLAYLIST_METHOD_PLAYLIST_IMPORT_PROGRESS,
+				MAFW_DBUS_UINT32(pl_dat->import_id),
+				MAFW_DBUS_UINT32(pl_dat->reported)));
+}
+
+/* Creates the playlist for the import, named after the imported uri. */
+static Pls *import_new_playlist(struct plparse_data *pl_dat)
 {
-	GList  *cur_uri = pl_dat->urilist;
 	Pls *new_pl;
 	gint count = 0;
 	gchar *temp;
+
+	temp = g_strdup(pl_dat->pl_uri);
+	while (g_tree_lookup(Playlists_by_name, temp) != NULL)
+	{
+		count++;
+		g_free(temp);
+
+		temp = g_strdup_printf("%s (%d)", pl_dat->pl_uri, count);
+	}
+
+	new_pl = pls_new(Last_id++, temp);
+	g_free(temp);
+	quota_own(new_pl, dbus_message_get_sender(pl_dat->oci->msg));
+	playlists_lock();
+	g_tree_insert(Playlists, GUINT_TO_POINTER(new_pl->id), new_pl);
+	g_tree_insert(Playlists_by_name, g_strdup(new_pl->name), new_pl);
+	playlists_unlock();
+	pl_dat->pls_id = new_pl->id;
+	return new_pl;
+}
+
+/* Tells whether the requester may add the collected object ids to @pls,
+ * or to a new playlist if it's %NULL. */
+static gboolean import_admit(struct plparse_data *pl_dat, Pls *pls,
+			     GError **err)
+{
+	return quota_admit(dbus_message_get_sender(pl_dat->oci->msg), pls,
+			   pls ? 0 : 1, pl_dat->oids->len,
+			   quota_strv_bytes((gchar **)pl_dat->oids->pdata,
+					    pl_dat->oids->len),
+			   err);
+}
+
+/* Appends the collected object ids to @pls.  Once the playlist has been
+ * announced its clients are told about the new items. */
+static void import_flush(struct plparse_data *pl_dat, Pls *pls)
+{
+	guint oldlen, newlen;
+	guint64 oldbytes;
+
+	if (!pl_dat->oids->len)
+		return;
+	/* pls_appends() copies the ids. */
+	playlists_lock();
+	cold_thaw(pls);
+	oldlen = pls->len;
+	oldbytes = pls->bytes;
+	pls_appends(pls, (const gchar **)pl_dat->oids->pdata,
+		    pl_dat->oids->len);
+	quota_update(pls, oldlen, oldbytes);
+	newlen = pls->len;
+	if (!pl_dat->announced) {
+		mirror_update(pls->id, oldlen, 0, newlen - oldlen);
+		mdcache_contents_changed(pls->id, oldlen, 0, newlen - oldlen);
+	}
+	playlists_unlock();
+	g_ptr_array_foreach(pl_dat->oids, (GFunc)g_free, NULL);
+	g_ptr_array_set_size(pl_dat->oids, 0);
+
+	/* This does what the branch above does, and more. */
+	if (pl_dat->announced)
+		send_contents_changed(pls->id, oldlen, 0, newlen - oldlen);
+}
+
+/* Returns the playlist created by import_new_playlist() unless it has
+ * been destroyed meanwhile. */
+static Pls *import_get_playlist(struct plparse_data *pl_dat)
+{
+	return g_tree_lookup(Playlists, GUINT_TO_POINTER(pl_dat->pls_id));
+}
+
+/* Finishes the import.  If the playlist has been created early and an
+ * error occurs, it is left with the entries imported so far. */
+static void import_done(struct plparse_data *pl_dat, const GError *err)
+{
+	Pls *new_pl;
+	gboolean created;
+	GError *quota_err = NULL;
+
+	if (!err && pl_dat->pls_id && !import_get_playlist(pl_dat))
+	{
+		GError *gone = NULL;
+
+		g_set_error(&gone, MAFW_PLAYLIST_ERROR,
+			    MAFW_PLAYLIST_ERROR_PLAYLIST_NOT_FOUND,
+			    "Imported playlist was destroyed");
+		import_done(pl_dat, gone);
+		g_error_free(gone);
+		return;
+	}
 	if (err)
 	{
 		const gchar *domain_str;
@@ -285,42 +638,26 @@ static void import_done(struct plparse_data *pl_dat, const GError *err)
 				MAFW_DBUS_STRING(domain_str),
 				MAFW_DBUS_INT32(err->code),
 				MAFW_DBUS_STRING(err->message)));
+		stats_import(pl_dat->count,
+			     g_get_monotonic_time() - pl_dat->started, FALSE);
 		g_hash_table_remove(import_requests,
 				    GUINT_TO_POINTER(pl_dat->import_id));
 		free_plparse_data(pl_dat);
 		return;
 	}
-	temp = g_strdup(pl_dat->pl_uri);
-	while (g_tree_lookup(Playlists_by_name, temp) != NULL)
-	{
-		count++;
-		g_free(temp);
-
-		temp = g_strdup_printf("%s (%d)", pl_dat->pl_uri, count);
-	}
-
-	new_pl = pls_new(Last_id++, temp);
-	g_free(temp);
-	g_tree_insert(Playlists, GUINT_TO_POINTER(new_pl->id), new_pl);
-	g_tree_insert(Playlists_by_name, g_strdup(new_pl->name), new_pl);
 
-	while (cur_uri)
+	created = pl_dat->pls_id != 0;
+	new_pl = created ? import_get_playlist(pl_dat) : NULL;
+	if (!import_admit(pl_dat, new_pl, &quota_err))
 	{
-		gchar *new_oid;
-		if (!pl_dat->list_from_browse)
-		{
-			new_oid = mafw_source_create_objectid(cur_uri->data);
-			pls_append(new_pl, new_oid);
-			g_free(new_oid);
-		}
-		else
-		{
-			pls_append(new_pl, cur_uri->data);
-		}
-		g_free(cur_uri->data);
-		cur_uri = g_list_delete_link(cur_uri, cur_uri);
+		import_done(pl_dat, quota_err);
+		g_error_free(quota_err);
+		return;
 	}
-	pl_dat->urilist = NULL;
+	if (!created)
+		new_pl = import_new_playlist(pl_dat);
+	import_flush(pl_dat, new_pl);
+
 	/* Inform the proxy about the new playlist */
 	mafw_dbus_send(pl_dat->oci->con, mafw_dbus_method_full(
 				dbus_message_get_sender(pl_dat->oci->msg),
@@ -331,48 +668,217 @@ static void import_done(struct plparse_data *pl_dat, const GError *err)
 				MAFW_DBUS_UINT32(new_pl->id)));
 
 	/* signal pl-created */
-	signal_playlist_created(pl_dat->oci->con, new_pl->id);
+	if (!created)
+		signal_playlist_created(pl_dat->oci->con, new_pl->id);
+	stats_import(pl_dat->count, g_get_monotonic_time() - pl_dat->started,
+		     TRUE);
 	g_hash_table_remove(import_requests,
 				    GUINT_TO_POINTER(pl_dat->import_id));
 	free_plparse_data(pl_dat);
 }
 
 
+/* Called in the main context, even though the parsing itself runs in
+ * a worker thread. */
 static void plparser_entry_parsed_cb(TotemPlParser *parser, gchar *uri,
 				     gpointer metadata,
 				     struct plparse_data *pl_dat)
 {
-	pl_dat->urilist = g_list_append(pl_dat->urilist, g_strdup(uri));
+	if (!g_cancellable_is_cancelled(pl_dat->parse_cancel))
+		import_add(pl_dat, mafw_source_create_objectid(uri));
+}
+
+static void plparser_parsed_cb(TotemPlParser *parser, GAsyncResult *res,
+			       struct plparse_data *pl_dat)
+{
+	TotemPlParserResult result;
+	GError *err = NULL;
+
+	result = totem_pl_parser_parse_finish(parser, res, &err);
+	if (g_cancellable_is_cancelled(pl_dat->parse_cancel)) {
+		if (!err)
+			g_set_error(&err, G_IO_ERROR, G_IO_ERROR_CANCELLED,
+				    "Import cancelled");
+	} else if (result != TOTEM_PL_PARSER_RESULT_SUCCESS) {
+		g_clear_error(&err);
+		g_set_error(&err, MAFW_PLAYLIST_ERROR,
+			    MAFW_PLAYLIST_ERROR_IMPORT_FAILED,
+			    "Playlist parsing failed.");
+	}
+	import_done(pl_dat, err);
+	if (err)
+		g_error_free(err);
+}
+
+static void native_entry_parsed_cb(const gchar *uri, GPtrArray *chunk)
+{
+	g_ptr_array_add(chunk, mafw_source_create_objectid(uri));
+}
+
+/* Collects the object ids the parser thread has found so far. */
+static gboolean native_collect(struct plparse_data *pl_dat)
+{
+	GPtrArray *chunk;
+	guint i;
+
+	G_LOCK(Native_chunks);
+	pl_dat->native_id = 0;
+	G_UNLOCK(Native_chunks);
+	while ((chunk = g_async_queue_try_pop(pl_dat->native_chunks))) {
+		if (g_cancellable_is_cancelled(pl_dat->parse_cancel)) {
+			free_chunk(chunk);
+			continue;
+		}
+		for (i = 0; i < chunk->len; i++)
+			import_add(pl_dat, chunk->pdata[i]);
+		g_ptr_array_free(chunk, TRUE);
+	}
+	return FALSE;
 }
 
-static gboolean import_from_file(struct plparse_data *pl_dat, GError **err)
+/* Reads the local playlist file in a worker thread, because even a
+ * single read() may take long on a network file system.  The entries
+ * are passed to the main thread every %IMPORT_NATIVE_STEP lines. */
+static void native_parse_thread(GSimpleAsyncResult *res, GObject *unused,
+				GCancellable *cancel)
 {
-	TotemPlParser *parser = totem_pl_parser_new ();
-	gboolean retval = TRUE;
+	struct plparse_data *pl_dat;
+	GPtrArray *chunk;
+	GError *err = NULL;
+	gboolean more;
+
+	pl_dat = g_async_result_get_user_data(G_ASYNC_RESULT(res));
+	do {
+		chunk = g_ptr_array_new();
+		more = plparse_read(pl_dat->native, IMPORT_NATIVE_STEP,
+				    (PlparseEntryFunc)native_entry_parsed_cb,
+				    chunk, &err);
+		if (!chunk->len) {
+			g_ptr_array_free(chunk, TRUE);
+			continue;
+		}
+		g_async_queue_push(pl_dat->native_chunks, chunk);
+		G_LOCK(Native_chunks);
+		if (!pl_dat->native_id)
+			pl_dat->native_id = g_idle_add_full(
+				G_PRIORITY_DEFAULT,
+				(GSourceFunc)native_collect, pl_dat, NULL);
+		G_UNLOCK(Native_chunks);
+	} while (more && !g_cancellable_is_cancelled(cancel));
+	if (err)
+		g_simple_async_result_take_error(res, err);
+}
+
+/* Called in the main thread when native_parse_thread() has finished. */
+static void native_parsed_cb(GObject *unused, GAsyncResult *res,
+			     struct plparse_data *pl_dat)
+{
+	GError *err = NULL;
+
+	/* Collect what's left before it's too late. */
+	G_LOCK(Native_chunks);
+	if (pl_dat->native_id)
+		g_source_remove(pl_dat->native_id);
+	G_UNLOCK(Native_chunks);
+	native_collect(pl_dat);
+
+	if (g_cancellable_is_cancelled(pl_dat->parse_cancel)) {
+		g_set_error(&err, G_IO_ERROR, G_IO_ERROR_CANCELLED,
+			    "Import cancelled");
+	} else if (g_simple_async_result_propagate_error(
+				G_SIMPLE_ASYNC_RESULT(res), &err)) {
+		g_clear_error(&err);
+		g_set_error(&err, MAFW_PLAYLIST_ERROR,
+			    MAFW_PLAYLIST_ERROR_IMPORT_FAILED,
+			    "Playlist parsing failed.");
+	}
+	import_done(pl_dat, err);
+	if (err)
+		g_error_free(err);
+}
+
+/* Parses the playlist file without blocking the daemon meanwhile.
+ * Local M3U and PLS files are read by plparse, anything else by
+ * totem-pl-parser, both in a worker thread.  The result is reported by
+ * import_done(). */
+static void import_from_file(struct plparse_data *pl_dat)
+{
+	pl_dat->parse_cancel = g_cancellable_new();
+
+	pl_dat->native = plparse_open(pl_dat->pl_uri, pl_dat->base);
+	if (pl_dat->native) {
+		GSimpleAsyncResult *res;
+
+		pl_dat->native_chunks = g_async_queue_new();
+		res = g_simple_async_result_new(NULL,
+						(GAsyncReadyCallback)
+						native_parsed_cb,
+						pl_dat, import_from_file);
+		g_simple_async_result_run_in_thread(res, native_parse_thread,
+						    G_PRIORITY_DEFAULT,
+						    pl_dat->parse_cancel);
+		g_object_unref(res);
+		return;
+	}
 
-	g_object_set (parser, "recurse", FALSE, "disable-unsafe", TRUE, NULL);
+	pl_dat->parser = totem_pl_parser_new();
 
-	g_signal_connect(parser, "entry-parsed",
+	g_object_set(pl_dat->parser, "recurse", FALSE,
+		     "disable-unsafe", TRUE, NULL);
+
+	g_signal_connect(pl_dat->parser, "entry-parsed",
 				(GCallback)plparser_entry_parsed_cb,
 				pl_dat);
 
-	if (totem_pl_parser_parse_with_base (parser, pl_dat->pl_uri,
-						pl_dat->base, FALSE)
-			!= TOTEM_PL_PARSER_RESULT_SUCCESS)
-	{
-		g_set_error(err, MAFW_PLAYLIST_ERROR,
-					  MAFW_PLAYLIST_ERROR_IMPORT_FAILED,
-					  "Playlist parsing failed.");
-		retval = FALSE;
-	}
-	else
-		import_done(pl_dat, NULL);
+	totem_pl_parser_parse_with_base_async(pl_dat->parser,
+					      pl_dat->pl_uri, pl_dat->base,
+					      FALSE, pl_dat->parse_cancel,
+					      (GAsyncReadyCallback)
+					      plparser_parsed_cb,
+					      pl_dat);
+}
+
+static void browse_res_cb(MafwSource *self, guint browse_id,
+					 gint remaining_count, guint index,
+					 const gchar *object_id,
+					 GHashTable *metadata,
+					 struct plparse_data *pl_data,
+					 const GError *error);
 
-	g_object_unref (parser);
+/* Requests the next page of the container being imported. */
+static void browse_next_page(struct plparse_data *pl_data)
+{
+	pl_data->page_items = 0;
+	pl_data->browse_id = mafw_source_browse(pl_data->source,
+			pl_data->container, pl_data->recursive,
+			NULL, NULL,
+			pl_data->recursive
+				? MAFW_SOURCE_LIST(MAFW_METADATA_KEY_MIME)
+				: MAFW_SOURCE_NO_KEYS,
+			pl_data->skip, IMPORT_BROWSE_PAGE,
+			(MafwSourceBrowseResultCb)browse_res_cb,
+			pl_data);
+}
+
+/* Returns whether @metadata describes a container. */
+static gboolean is_container(GHashTable *metadata)
+{
+	GValue *mime;
 
-	return retval;
+	mime = metadata ? mafw_metadata_first(metadata,
+					      MAFW_METADATA_KEY_MIME) : NULL;
+	return mime && G_VALUE_HOLDS_STRING(mime)
+		&& !strcmp(g_value_get_string(mime),
+			   MAFW_METADATA_VALUE_MIME_CONTAINER);
 }
 
+/*
+ * Containers are browsed in pages of %IMPORT_BROWSE_PAGE items.  If there
+ * is more than one page, the playlist is created with the first one and
+ * each following page is appended as soon as it is complete, so only one
+ * page is kept in memory.  Recursive imports skip the subcontainers
+ * themselves and take only their items.
+ */
 static void browse_res_cb(MafwSource *self, guint browse_id,
 					 gint remaining_count, guint index,
 					 const gchar *object_id,
@@ -380,19 +886,54 @@ static void browse_res_cb(MafwSource *self, guint browse_id,
 					 struct plparse_data *pl_data,
 					 const GError *error)
 {
+	Pls *pls;
+	GError *quota_err = NULL;
+
 	if (!error)
 	{
-		if (object_id) {
-			pl_data->urilist = g_list_append(pl_data->urilist,
-							 g_strdup(object_id));
+		if (object_id)
+		{
+			if (!pl_data->recursive || !is_container(metadata))
+				import_add(pl_data, g_strdup(object_id));
+			pl_data->page_items++;
 		}
 		if (remaining_count)
 		{
 			return;
 		}
+		if (pl_data->page_items == IMPORT_BROWSE_PAGE)
+		{/* there may be more */
+			pls = pl_data->pls_id
+				? import_get_playlist(pl_data) : NULL;
+			/* If it has been destroyed, import_done()
+			 * reports it. */
+			if (pls || !pl_data->pls_id)
+			{
+				if (!import_admit(pl_data, pls, &quota_err))
+				{
+					error = quota_err;
+					goto out;
+				}
+				if (!pls)
+					pls = import_new_playlist(pl_data);
+				import_flush(pl_data, pls);
+				if (!pl_data->announced)
+				{
+					signal_playlist_created(
+						pl_data->oci->con, pls->id);
+					pl_data->announced = TRUE;
+				}
+				pl_data->skip += pl_data->page_items;
+				browse_next_page(pl_data);
+				return;
+			}
+		}
 	}
 
+out:	pl_data->source = NULL;
 	import_done(pl_data, error);
+	if (quota_err)
+		g_error_free(quota_err);
 	g_object_unref(self);
 }
 
@@ -403,7 +944,6 @@ static void mdata_res_cb(MafwSource *self,
 				   const GError *error)
 {
 	GValue *cur_value;
-	GError *err = NULL;
 	const gchar *mime_type = NULL;
 	gboolean got_uri = FALSE;
 
@@ -445,28 +985,19 @@ static void mdata_res_cb(MafwSource *self,
 	if (!got_uri || (mime_type && !strcmp(mime_type,
 			MAFW_METADATA_VALUE_MIME_CONTAINER)))
 	{/* it is a container.... browse it */
-		plp_data->list_from_browse = TRUE;
 		plp_data->source = self;
-		plp_data->browse_id = mafw_source_browse(self, object_id,
-			FALSE,
-			NULL, NULL,
-			MAFW_SOURCE_NO_KEYS,
-			0, 0, (MafwSourceBrowseResultCb)browse_res_cb,
-			plp_data);
+		plp_data->container = g_strdup(object_id);
+		browse_next_page(plp_data);
 	}
 	else
 	{/* it is a simple file */
 		g_object_unref(self);
-		if (!import_from_file(plp_data, &err))
-		{/* error during parse? */
-			import_done(plp_data, err);
-			g_error_free(err);
-			return;
-		}
+		import_from_file(plp_data);
 	}
 }
 
 static guint import_playlist(const gchar *pl, const gchar *base,
+			gboolean recursive,
 			MafwDBusOpCompletedInfo *oci,GError **err)
 {
 	gchar *src_uuid;
@@ -475,6 +1006,9 @@ static guint import_playlist(const gchar *pl, const gchar *base,
 	struct plparse_data *pl_dat = g_new0(struct plparse_data, 1);
 
 	import_id = pl_dat->import_id = get_next_import_id();
+	pl_dat->started = g_get_monotonic_time();
+	pl_dat->oids = g_ptr_array_new();
+	pl_dat->recursive = recursive;
 	pl_dat->oci = oci;
 	pl_dat->pl_uri = g_strdup(pl);
 	if (base && base[0])
@@ -482,6 +1016,17 @@ static guint import_playlist(const gchar *pl, const gchar *base,
 		pl_dat->base = g_strdup(base);
 	}
 
+	if (!import_requests) {
+		import_requests = g_hash_table_new_full(NULL,
+							NULL,
+							NULL,
+							NULL);
+	}
+	/* Cancel it if the client leaves meanwhile. */
+	mafw_session_watch(dbus_message_get_sender(oci->msg));
+	mafw_session_hold(Importers, dbus_message_get_sender(oci->msg),
+			  pl_dat);
+
 	/* Check whether pl is an object-id */
 	if (mafw_source_split_objectid(pl, &src_uuid, NULL))
 	{
@@ -490,13 +1035,6 @@ static guint import_playlist(const gchar *pl, const gchar *base,
 		{
 			g_object_ref(src);
 
-			if (!import_requests) {
-				import_requests = g_hash_table_new_full(NULL,
-							      		NULL,
-							      		NULL,
-							      		NULL);
-			}
-
 			g_hash_table_replace(import_requests,
 						GUINT_TO_POINTER(import_id),
 						pl_dat);
@@ -520,16 +1058,54 @@ static guint import_playlist(const gchar *pl, const gchar *base,
 	}
 	else
 	{
-		if (import_from_file(pl_dat, err))
-			return import_id;
+		g_hash_table_replace(import_requests,
+				     GUINT_TO_POINTER(import_id), pl_dat);
+		import_from_file(pl_dat);
+		return import_id;
 	}
 
 	free_plparse_data(pl_dat);
 	return ~0;
 }
 
+/* Stops the import of $pl_dat.  The client is told about it, like about
+ * any failed import, unless it is waiting for the metadata of the
+ * imported object. */
+static void import_cancel(struct plparse_data *pl_dat)
+{
+	if (pl_dat->source != NULL)
+	{/* browse is ongoing.... cancel it, no more
+	   results will come. */
+		MafwSource *src = pl_dat->source;
+		GError *err = NULL;
+
+		mafw_source_cancel_browse(src, pl_dat->browse_id, NULL);
+		g_set_error(&err, G_IO_ERROR, G_IO_ERROR_CANCELLED,
+			    "Import cancelled");
+		import_done(pl_dat, err);
+		g_error_free(err);
+		g_object_unref(src);
+	}
+	else if (pl_dat->parse_cancel != NULL)
+	{/* parsing a file, plparser_parsed_cb() reports */
+		g_cancellable_cancel(pl_dat->parse_cancel);
+	}
+	else
+	{/* waiting for get_metadata-cb only... */
+		pl_dat->cancel = TRUE;
+	}
+}
+
+/* Called when a client leaves the bus with an import in progress. */
+static void importer_vanished(const gchar *client,
+			      struct plparse_data *pl_dat,
+			      guint count, gpointer unused)
+{
+	import_cancel(pl_dat);
+}
+
 /* D-BUS filter to process a request to the daemon. */
-static DBusHandlerResult request(DBusConnection *con, DBusMessage *req,
+DBusHandlerResult handle_request(DBusConnection *con, DBusMessage *req,
 				 void *unused)
 {
 	DBusMessage *reply;
@@ -581,7 +1157,16 @@ static DBusHandlerResult request(DBusConnection *con, DBusMessage *req,
 		}
 		pls = g_tree_lookup(Playlists_by_name, name);
 		if (!pls) {
+			GError *err = NULL;
+
+			if (!quota_admit(dbus_message_get_sender(req), NULL,
+					 1, 0, 0, &err)) {
+				reply = mafw_dbus_gerror(req, err);
+				g_error_free(err);
+				goto out;
+			}
 			pls = pls_new(Last_id++, name);
+			quota_own(pls, dbus_message_get_sender(req));
 			g_tree_insert(Playlists, GUINT_TO_POINTER(pls->id),
                                       pls);
 			g_tree_insert(Playlists_by_name, g_strdup(pls->name),
@@ -594,6 +1179,36 @@ static DBusHandlerResult request(DBusConnection *con, DBusMessage *req,
 			signal_playlist_created(con, pls->id);
 		}
 		reply = mafw_dbus_reply(req, MAFW_DBUS_UINT32(pls->id));
+	} else if (!strcmp(member,
+			   MAFW_PLAYLIST_METHOD_CREATE_SMART_PLAYLIST)) {
+		const gchar *name, *container, *filter, *sort;
+		GError *err = NULL;
+		Pls *pls;
+
+		mafw_dbus_parse(req, DBUS_TYPE_STRING, &name,
+				DBUS_TYPE_STRING, &container,
+				DBUS_TYPE_STRING, &filter,
+				DBUS_TYPE_STRING, &sort);
+		if (*name == '\0' || g_tree_lookup(Playlists_by_name, name)) {
+			reply = mafw_dbus_error(req, MAFW_PLAYLIST_ERROR,
+					MAFW_PLAYLIST_ERROR_INVALID_NAME,
+					"name is empty or taken");
+			goto out;
+		}
+		if (!smart_check(container, filter, &err)
+		    || !quota_admit(dbus_message_get_sender(req), NULL,
+				    1, 0, 0, &err)) {
+			reply = mafw_dbus_gerror(req, err);
+			g_error_free(err);
+			goto out;
+		}
+		pls = pls_new(Last_id++, name);
+		quota_own(pls, dbus_message_get_sender(req));
+		g_tree_insert(Playlists, GUINT_TO_POINTER(pls->id), pls);
+		g_tree_insert(Playlists_by_name, g_strdup(pls->name), pls);
+		smart_add(pls, container, filter, sort);
+		signal_playlist_created(con, pls->id);
+		reply = mafw_dbus_reply(req, MAFW_DBUS_UINT32(pls->id));
 	} else if (!strcmp(member, MAFW_PLAYLIST_METHOD_DESTROY_PLAYLIST)) {
 		guint id;
 		Pls *pls;
@@ -609,6 +1224,8 @@ static DBusHandlerResult request(DBusConnection *con, DBusMessage *req,
 				/* Destroy playlists that are being used is not
 				 * allowed, so send a signal to inform about
 				 * that */
+				stats_signal(
+				MAFW_PLAYLIST_SIGNAL_PLAYLIST_DESTRUCTION_FAILED);
 				mafw_dbus_send(
 					con,
 					mafw_dbus_signal(
@@ -623,19 +1240,25 @@ static DBusHandlerResult request(DBusConnection *con, DBusMessage *req,
 
 				gchar *fn;
 
-				fn = g_strdup_printf("%s"
-                                                     G_DIR_SEPARATOR_S "%u",
-						     playlist_dir(), pls->id);
+				fn = pls_path(pls->id);
 				if (g_unlink(fn) == -1 && errno != ENOENT)
 					g_warning(
                                                 "error while deleting '%s': %s",
                                                 fn, g_strerror(errno));
 				g_free(fn);
+				backup_touch(pls);
+				quota_disown(pls);
+				smart_forget(pls->id);
+				window_forget(pls->id);
+				mdcache_forget(pls->id);
+				mirror_forget(pls->id);
 				g_assert(g_tree_remove(Playlists_by_name,
                                                        pls->name));
 				g_assert(g_tree_remove(
                                                  Playlists,
                                                  GUINT_TO_POINTER(pls->id)));
+				stats_signal(
+					MAFW_PLAYLIST_SIGNAL_PLAYLIST_DESTROYED);
 				mafw_dbus_send(
 					con,
 					mafw_dbus_signal(
@@ -648,6 +1271,7 @@ static DBusHandlerResult request(DBusConnection *con, DBusMessage *req,
                 Pls *pls, *new_pls;
                 int i;
 		guint src_id;
+		GError *err = NULL;
 
                 mafw_dbus_parse(req, DBUS_TYPE_UINT32, &src_id,
 					DBUS_TYPE_STRING, &new_name);
@@ -678,17 +1302,31 @@ static DBusHandlerResult request(DBusConnection *con, DBusMessage *req,
                                          "playlist does not exist");
                         goto out;
 		 }
+		cold_thaw(pls);
+		if (!quota_admit(dbus_message_get_sender(req), NULL, 1,
+				 pls->len, pls->bytes, &err)) {
+			reply = mafw_dbus_gerror(req, err);
+			g_error_free(err);
+			goto out;
+		}
 		/* copy the plst*/
                 new_pls = pls_new(Last_id++, new_name);
+		if (pls->pages) {
+			/* This pages out the copy as well. */
+			pls_copy_range(new_pls, 0, pls, 0, pls->len);
+		} else {
+			new_pls->alloc = pls->alloc;
+			new_pls->len = pls->len;
+			new_pls->vidx = g_realloc(new_pls->vidx,
+						  new_pls->alloc *
+						  sizeof(*new_pls->vidx));
+			for (i = 0; i < pls->len; ++i) {
+				new_pls->vidx[i] = g_strdup(pls->vidx[i]);
+			}
+			new_pls->bytes = pls->bytes;
+		}
                 new_pls->shuffled = pls->shuffled;
-                new_pls->alloc = pls->alloc ;
-                new_pls->len = pls->len ;
 		new_pls->poolst = new_pls->poolst;
-                new_pls->vidx = g_realloc(new_pls->vidx, new_pls->alloc *
-                                          sizeof(*new_pls->vidx));
-                for (i = 0; i < pls->len; ++i) {
-                         new_pls->vidx[i] = g_strdup(pls->vidx[i]);
-                }
 
                 if (new_pls->shuffled) {
                         new_pls->pidx =
@@ -706,6 +1344,7 @@ static DBusHandlerResult request(DBusConnection *con, DBusMessage *req,
                 }
 
                 pls_set_repeat(new_pls, pls->repeat);
+		quota_own(new_pls, dbus_message_get_sender(req));
                 g_tree_insert(Playlists, GUINT_TO_POINTER(new_pls->id),
 				new_pls);
                 g_tree_insert(Playlists_by_name, g_strdup(new_pls->name),
@@ -717,53 +1356,203 @@ static DBusHandlerResult request(DBusConnection *con, DBusMessage *req,
                  * until it receives the reply to its method call.
                  */
         	reply = mafw_dbus_reply(req, MAFW_DBUS_UINT32(new_pls->id));
-	}else if (!strcmp(member, MAFW_PLAYLIST_METHOD_LIST_PLAYLISTS)) {
-		DBusMessageIter imsg, iary;
-
-		reply = mafw_dbus_reply(req);
-		dbus_message_iter_init_append(reply, &imsg);
-		dbus_message_iter_open_container(&imsg, DBUS_TYPE_ARRAY,
-						 "(us)", &iary);
-		if (dbus_message_get_signature(req)[0] != '\0') {
-			guint nids, i;
-			guint *ids;
-
-			/* Retrieve information about the playlists
-			 * whose ID are specified in the array. */
-			mafw_dbus_parse(req, DBUS_TYPE_ARRAY,
-					 DBUS_TYPE_UINT32, &ids, &nids);
-
-			for (i = 0; i < nids; i++) {
-				Pls *pls;
-
-				pls = g_tree_lookup(Playlists,
-						    GUINT_TO_POINTER(ids[i]));
-				/* It may happen that there's no playlist with
-				 * the given id; for example when the playlist
-				 * manager's (or someone else's) idea of
-				 * playlists is outdated. */
-				if (pls)
-					append_pls(ids[i], pls, &iary);
-			}
+	}else if (!strcmp(member, MAFW_PLAYLIST_METHOD_LIST_PLAYLISTS) ||
+		  !strcmp(member, MAFW_PLAYLIST_METHOD_LIST_PLAYLISTS_FULL)) {
+		PlsList *list;
+
+		list = pls_list_new(req);
+		if (pls_list_slice(con, req, list))
+			pls_list_free(list);
+		else
+			dispatch_slice(req, (DispatchSliceFunc)pls_list_slice,
+				       list, (GDestroyNotify)pls_list_free);
+	} else if (!strcmp(member, MAFW_PLAYLIST_METHOD_COPY_RANGE)) {
+		guint src_id, from, count, dst_id, at, oldlen;
+		guint64 oldbytes;
+		Pls *src, *dst;
+		GError *err = NULL;
+
+		mafw_dbus_parse(req, DBUS_TYPE_UINT32, &src_id,
+				DBUS_TYPE_UINT32, &from,
+				DBUS_TYPE_UINT32, &count,
+				DBUS_TYPE_UINT32, &dst_id,
+				DBUS_TYPE_UINT32, &at);
+		src = g_tree_lookup(Playlists, GUINT_TO_POINTER(src_id));
+		dst = g_tree_lookup(Playlists, GUINT_TO_POINTER(dst_id));
+		if (!src || !dst) {
+			reply = mafw_dbus_error(req, MAFW_PLAYLIST_ERROR,
+					MAFW_PLAYLIST_ERROR_PLAYLIST_NOT_FOUND,
+					"playlist does not exist");
+			goto out;
+		}
+		if (dst->smart) {
+			reply = mafw_dbus_error(req, MAFW_PLAYLIST_ERROR,
+					MAFW_PLAYLIST_ERROR_NOT_SUPPORTED,
+					"smart playlists cannot be edited");
+			goto out;
+		}
+		cold_thaw(src);
+		cold_thaw(dst);
+		if (from <= src->len && count <= src->len - from
+		    && !quota_admit(dbus_message_get_sender(req), dst, 0,
+				    count, range_bytes(src, from, count),
+				    &err)) {
+			reply = mafw_dbus_gerror(req, err);
+			g_error_free(err);
+			goto out;
+		}
+		oldlen = dst->len;
+		oldbytes = dst->bytes;
+		if (!pls_copy_range(dst, at, src, from, count)) {
+			reply = mafw_dbus_error(req, MAFW_PLAYLIST_ERROR,
+					MAFW_PLAYLIST_ERROR_INVALID_INDEX,
+					"Wrong index");
+		} else {
+			quota_update(dst, oldlen, oldbytes);
+			reply = mafw_dbus_reply(req);
+			if (count)
+				send_contents_changed(dst_id, at, 0, count);
+		}
+	} else if (!strcmp(member, MAFW_PLAYLIST_METHOD_CONCAT)) {
+		guint *src_ids, nsrcs, dst_id, i, oldlen, entries;
+		guint64 oldbytes, bytes;
+		Pls *dst;
+		GPtrArray *srcs;
+		GError *err = NULL;
+
+		mafw_dbus_parse(req, DBUS_TYPE_ARRAY, DBUS_TYPE_UINT32,
+				&src_ids, &nsrcs,
+				DBUS_TYPE_UINT32, &dst_id);
+		dst = g_tree_lookup(Playlists, GUINT_TO_POINTER(dst_id));
+
+		/* Look up every source before changing anything. */
+		srcs = g_ptr_array_sized_new(nsrcs);
+		for (i = 0; i < nsrcs; i++) {
+			Pls *src;
+
+			src = g_tree_lookup(Playlists,
+					    GUINT_TO_POINTER(src_ids[i]));
+			if (!src)
+				break;
+			g_ptr_array_add(srcs, src);
+		}
+
+		entries = 0;
+		bytes = 0;
+		for (i = 0; i < srcs->len; i++) {
+			entries += ((Pls *)srcs->pdata[i])->len;
+			bytes += ((Pls *)srcs->pdata[i])->bytes;
+		}
+
+		if (!dst || srcs->len < nsrcs) {
+			reply = mafw_dbus_error(req, MAFW_PLAYLIST_ERROR,
+					MAFW_PLAYLIST_ERROR_PLAYLIST_NOT_FOUND,
+					"playlist does not exist");
+		} else if (dst->smart) {
+			reply = mafw_dbus_error(req, MAFW_PLAYLIST_ERROR,
+					MAFW_PLAYLIST_ERROR_NOT_SUPPORTED,
+					"smart playlists cannot be edited");
+		} else if (!quota_admit(dbus_message_get_sender(req), dst, 0,
+					entries, bytes, &err)) {
+			reply = mafw_dbus_gerror(req, err);
+			g_error_free(err);
 		} else {
-			/* Return information about all known playlists. */
-			g_tree_foreach(Playlists,
-				       (GTraverseFunc)append_pls, &iary);
+			/* A source may be @dst itself, so copy the lengths
+			 * in advance. */
+			guint *lens;
+
+			lens = g_new(guint, nsrcs);
+			for (i = 0; i < nsrcs; i++) {
+				cold_thaw(srcs->pdata[i]);
+				lens[i] = ((Pls *)srcs->pdata[i])->len;
+			}
+			cold_thaw(dst);
+			oldlen = dst->len;
+			oldbytes = dst->bytes;
+			for (i = 0; i < nsrcs; i++)
+				pls_copy_range(dst, dst->len, srcs->pdata[i],
+					       0, lens[i]);
+			g_free(lens);
+			quota_update(dst, oldlen, oldbytes);
+
+			reply = mafw_dbus_reply(req);
+			if (dst->len > oldlen)
+				send_contents_changed(dst_id, oldlen, 0,
+						      dst->len - oldlen);
+		}
+		g_ptr_array_free(srcs, TRUE);
+	} else if (!strcmp(member, MAFW_PLAYLIST_METHOD_GET_QUOTA)) {
+		const gchar *client;
+		const Quota *limits;
+		Quota usage;
+
+		mafw_dbus_parse(req, DBUS_TYPE_STRING, &client);
+		if (!*client)
+			client = dbus_message_get_sender(req);
+		memset(&usage, 0, sizeof(usage));
+		if (client) {
+			quota_usage(client, &usage);
+			usage.requests = dispatch_pending(client);
+		}
+		limits = quota_limits();
+		reply = mafw_dbus_reply(req,
+				MAFW_DBUS_UINT32(usage.playlists),
+				MAFW_DBUS_UINT32(usage.entries),
+				MAFW_DBUS_UINT64(usage.bytes),
+				MAFW_DBUS_UINT32(usage.requests),
+				MAFW_DBUS_UINT32(limits->playlists),
+				MAFW_DBUS_UINT32(limits->entries),
+				MAFW_DBUS_UINT64(limits->bytes),
+				MAFW_DBUS_UINT32(limits->requests));
+	} else if (!strcmp(member, MAFW_PLAYLIST_METHOD_BACKUP_TO)) {
+		const gchar *path;
+		GError *err = NULL;
+
+		/* Answered by backup.c when the backup is done. */
+		mafw_dbus_parse(req, DBUS_TYPE_STRING, &path);
+		if (!backup_start(con, req, path, &err))
+			mafw_dbus_ack_or_error(con, req, err);
+		return DBUS_HANDLER_RESULT_HANDLED;
+	} else if (!strcmp(member, MAFW_PLAYLIST_METHOD_RESTORE_FROM)) {
+		const gchar *path;
+		GError *err = NULL;
+
+		mafw_dbus_parse(req, DBUS_TYPE_STRING, &path);
+		if (restore_from(path, &err)) {
+			stats_signal(MAFW_PLAYLIST_SIGNAL_PLAYLISTS_RESTORED);
+			mafw_dbus_send(con, mafw_dbus_signal(
+					MAFW_PLAYLIST_SIGNAL_PLAYLISTS_RESTORED));
 		}
-		dbus_message_iter_close_container(&imsg, &iary);
+		mafw_dbus_ack_or_error(con, req, err);
+		return DBUS_HANDLER_RESULT_HANDLED;
 	} else if (!strcmp(member, MAFW_PLAYLIST_METHOD_IMPORT_PLAYLIST)) {
 		gchar *pl, *base;
+		dbus_bool_t recursive;
 		guint import_id;
 		GError *err = NULL;
 		MafwDBusOpCompletedInfo *oci;
 
+		if (!quota_admit(dbus_message_get_sender(req), NULL, 1, 0, 0,
+				 &err))
+		{
+			reply = mafw_dbus_gerror(req, err);
+			g_error_free(err);
+			goto out;
+		}
+
 		/* Store the message and pass as user data to browse().
 		   This is used to route the results to correct
 		   destination. */
 		oci = mafw_dbus_oci_new(con, req);
-		mafw_dbus_parse(req, DBUS_TYPE_STRING, &pl,
-				DBUS_TYPE_STRING, &base);
-		import_id = import_playlist(pl, base, oci, &err);
+		recursive = FALSE;
+		if (mafw_dbus_count_args(req) > 2)
+			mafw_dbus_parse(req, DBUS_TYPE_STRING, &pl,
+					DBUS_TYPE_STRING, &base,
+					DBUS_TYPE_BOOLEAN, &recursive);
+		else
+			mafw_dbus_parse(req, DBUS_TYPE_STRING, &pl,
+					DBUS_TYPE_STRING, &base);
+		import_id = import_playlist(pl, base, recursive, oci, &err);
 		if (err)
 		{
 			reply =  mafw_dbus_gerror(req, err);
@@ -784,17 +1573,7 @@ static DBusHandlerResult request(DBusConnection *con, DBusMessage *req,
 			pl_dat = g_hash_table_lookup(import_requests,
 				  		GUINT_TO_POINTER(import_id));
 		if (pl_dat)
-		{
-			if (pl_dat->source != NULL)
-			{/* browse is ongoing.... cancel it */
-				mafw_source_cancel_browse(pl_dat->source,
-						pl_dat->browse_id, NULL);
-			}
-			else
-			{/* waiting for get_metadata-cb only... */
-				pl_dat->cancel = TRUE;
-			}
-		}
+			import_cancel(pl_dat);
 		else
 		{
 			g_set_error(&err, MAFW_PLAYLIST_ERROR,
@@ -829,10 +1608,16 @@ void init_playlist_wrapper(DBusConnection *dbus, gboolean opt_stayalive,
 	DBusObjectPathVTable path_vtable;
 
 	memset(&path_vtable, 0, sizeof(DBusObjectPathVTable));
-	path_vtable.message_function = request;
+	path_vtable.message_function = dispatch_request;
 
 	dbus_error_init(&dbe);
 
+	mafw_session_init(dbus);
+	if (!Importers)
+		Importers = mafw_session_add_subsystem(
+				(MafwSessionVanishedFunc)importer_vanished,
+				NULL);
+
 	/* Demand our name. */
 	name_acquired = FALSE;
 	do {
@@ -869,7 +1654,9 @@ void init_playlist_wrapper(DBusConnection *dbus, gboolean opt_stayalive,
 		} /* while */
 	} while (!name_acquired);
 
-	/* Set up playlist storage. */
+	/* Set up playlist storage, which is ours alone. */
+	if (!pls_lock_dir())
+		g_error("cannot use the playlist directory %s", pls_dir());
 	Playlists = g_tree_new_full((GCompareDataFunc)pls_cmpids,
 				    NULL, NULL,
 				    (GDestroyNotify)pls_free);
@@ -879,8 +1666,9 @@ void init_playlist_wrapper(DBusConnection *dbus, gboolean opt_stayalive,
 	Playlists_by_name = g_tree_new_full((GCompareDataFunc)strcmp, NULL,
 					    (GDestroyNotify)g_free, NULL);
 
-	/* Load existing playlists. */
-	load_playlists();
+	/* Load existing playlists, paging out the big ones. */
+	cold_init();
+	pls_load_dir(playlist_loaded, NULL);
 	dbus_bus_add_match(dbus, "type='signal',"
                           "interface='" MAFW_PLAYLIST_INTERFACE "'",
                           &dbe);
@@ -898,6 +1686,7 @@ void init_playlist_wrapper(DBusConnection *dbus, gboolean opt_stayalive,
                          NULL);
 	if (!mafw_shared_init(Reg, &gerr))
 		g_error("Error during discover init: %s", gerr->message);
+	smart_init();
 }
 
 /* vi: set noexpandtab ts=8 sw=8 cino=t0,(0: */
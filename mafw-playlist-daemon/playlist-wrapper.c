@@ -32,10 +32,13 @@
 #include <dbus/dbus-glib-lowlevel.h>
 
 #include <libmafw/mafw-errors.h>
+#include <libmafw/mafw-metadata-serializer.h>
 
 #include "common/mafw-dbus.h"
 #include "common/dbus-interface.h"
+#include "common/mafw-session.h"
 #include "libmafw-shared/mafw-proxy-playlist.h"
+#include "libmafw-shared/mafw-playlist-manager.h"
 
 #include "mpd-internal.h"
 
@@ -49,6 +52,7 @@ static void send_item_moved(guint plid, guint from, guint to)
 	DBusConnection* conn = NULL;
 	DBusMessage *msg = NULL;
 	gchar *path;
+	guint first, count;
 
 	conn = dbus_bus_get(DBUS_BUS_SESSION, NULL);
 	g_assert(conn != NULL);
@@ -65,14 +69,22 @@ static void send_item_moved(guint plid, guint from, guint to)
 				 DBUS_TYPE_UINT32, &to,
 				 DBUS_TYPE_INVALID);
 
+	stats_signal(MAFW_PLAYLIST_ITEM_MOVED);
+	/* The items between $from and $to have shifted by one. */
+	first = MIN(from, to);
+	count = MAX(from, to) - first + 1;
+	mirror_update(plid, first, count, count);
+	window_item_moved(plid, from, to);
+	mdcache_item_moved(plid, from, to);
+
 	/* Send the message */
 	mafw_dbus_send(conn, msg);
 	dbus_connection_unref(conn);
 	g_free(path);
 }
 
-static void send_contents_changed(guint plid, guint from,
-				  guint nremove, guint nreplace)
+void send_contents_changed(guint plid, guint from,
+			   guint nremove, guint nreplace)
 {
 	DBusConnection* conn = NULL;
 	DBusMessage *msg = NULL;
@@ -95,6 +107,11 @@ static void send_contents_changed(guint plid, guint from,
 				 DBUS_TYPE_UINT32, &nreplace,
 				 DBUS_TYPE_INVALID);
 
+	stats_signal(MAFW_PLAYLIST_CONTENTS_CHANGED);
+	mirror_update(plid, from, nremove, nreplace);
+	window_contents_changed(plid, from, nremove, nreplace);
+	mdcache_contents_changed(plid, from, nremove, nreplace);
+
 	/* Send the message */
 	mafw_dbus_send(conn, msg);
 	dbus_connection_unref(conn);
@@ -121,195 +138,494 @@ static void send_property_changed(guint32 plid, const gchar *property)
 				 DBUS_TYPE_STRING, &property,
 				 DBUS_TYPE_INVALID);
 
+	stats_signal(MAFW_PLAYLIST_PROPERTY_CHANGED);
+	mirror_update(plid, 0, 0, 0);
+
 	/* Send the message */
 	mafw_dbus_send(conn, msg);
 	dbus_connection_unref(conn);
 	g_free(path);
 }
 
-#define MATCH_STR "type='signal',interface='org.freedesktop.DBus'," \
-			"member='NameOwnerChanged',arg0='%s',arg2=''"
-/** Hash table to store which client increased the use-count */
-static GHashTable *_usecount_holders;
+/* Session registry subsystem of the use counts held by clients. */
+static guint Usecount_holders;
+
+/* Called when a client vanishes with use counts of $pls held. */
+static void usecount_holder_vanished(const gchar *client, Pls *pls,
+				     guint count, gpointer unused)
+{
+	g_rw_lock_writer_lock(&pls->lock);
+	pls->use_count -= MIN(count, pls->use_count);
+	pls_set_use_count(pls, pls->use_count);
+	g_rw_lock_writer_unlock(&pls->lock);
+}
 
 /**
- * Removes a dbus-match registered for a client, and removes it's list from
- * the _usecount_holders hash-table
+ * Register the use count holders with the session registry
  */
-static void _unregister_requestor(DBusConnection *conn, const gchar *requestor)
+void init_pl_wrapper(DBusConnection *connection)
 {
-	gchar *matchstr = NULL;
-	
-	if (!_usecount_holders)
-		return;
+	mafw_session_init(connection);
+	quota_init();
+	mdcache_init(connection);
+	if (!Usecount_holders)
+		Usecount_holders = mafw_session_add_subsystem(
+				(MafwSessionVanishedFunc)usecount_holder_vanished,
+				NULL);
+}
+
+/* Upper limit of the size of a get_items_paged page, in bytes of object ids,
+ * well below the maximal D-Bus message size. */
+#define GET_ITEMS_PAGE_MAX_BYTES (256 * 1024)
+
+/* The most items get_items and get_items_with_metadata read per main loop
+ * iteration, see items_read(). */
+#define ITEMS_SLICE 1024
+
+/* The most items get_next_n looks ahead. */
+#define GET_NEXT_N_MAX 256
+
+/* Signature of the apply_ops argument. */
+#define APPLY_OPS_SIGNATURE "a(uuuas)"
 
-	matchstr = g_strdup_printf(MATCH_STR, requestor);
-	dbus_bus_remove_match(conn, matchstr, NULL);
-	g_hash_table_remove(_usecount_holders, requestor);
-	g_free(matchstr);
-	return;
+/* Parses the operation list of an apply_ops request into a #GArray of PlsOp.
+ * The object ids point into $msg, only the arrays holding them need to be
+ * freed, see free_ops(). */
+static GArray *parse_ops(DBusMessage *msg)
+{
+	DBusMessageIter imsg, iary, istr, ioids;
+	GArray *ops;
+
+	ops = g_array_new(FALSE, TRUE, sizeof(PlsOp));
+	dbus_message_iter_init(msg, &imsg);
+	dbus_message_iter_recurse(&imsg, &iary);
+	while (dbus_message_iter_get_arg_type(&iary) == DBUS_TYPE_STRUCT) {
+		GPtrArray *oids;
+		PlsOp op;
+
+		dbus_message_iter_recurse(&iary, &istr);
+		dbus_message_iter_get_basic(&istr, &op.type);
+		dbus_message_iter_next(&istr);
+		dbus_message_iter_get_basic(&istr, &op.idx);
+		dbus_message_iter_next(&istr);
+		dbus_message_iter_get_basic(&istr, &op.arg);
+		dbus_message_iter_next(&istr);
+
+		oids = g_ptr_array_new();
+		dbus_message_iter_recurse(&istr, &ioids);
+		while (dbus_message_iter_get_arg_type(&ioids) ==
+		       DBUS_TYPE_STRING) {
+			gchar *oid;
+
+			dbus_message_iter_get_basic(&ioids, &oid);
+			g_ptr_array_add(oids, oid);
+			dbus_message_iter_next(&ioids);
+		}
+		op.noids = oids->len;
+		op.oids = (gchar **)g_ptr_array_free(oids, FALSE);
+
+		g_array_append_val(ops, op);
+		dbus_message_iter_next(&iary);
+	}
+	return ops;
 }
 
-/**
- * Removes a Pls pointer from the client's list, and unregisters the client
- * if the list is empty after this
- */
-static void _remove_usecount_holder(DBusConnection *connection,
-					const gchar *requestor, Pls *pls)
+static void free_ops(GArray *ops)
 {
-	GList *pllist = NULL;
+	guint i;
+
+	for (i = 0; i < ops->len; i++)
+		g_free(g_array_index(ops, PlsOp, i).oids);
+	g_array_free(ops, TRUE);
+}
 
-	if (!_usecount_holders)
+/* Applies a batch of operations on $pls atomically, replies the validity of
+ * each, and sends one consolidated change notification. */
+static void handle_apply_ops(DBusConnection *conn, DBusMessage *msg,
+			     Pls *pls)
+{
+	GArray *ops;
+	gboolean *results;
+	gboolean applied, repeat_changed, shuffle_changed;
+	guint i, oldlen, first, entries;
+	guint64 bytes;
+	GError *err = NULL;
+
+	if (!dbus_message_has_signature(msg, APPLY_OPS_SIGNATURE)) {
+		mafw_dbus_send(conn,
+			       dbus_message_new_error(msg,
+						      DBUS_ERROR_INVALID_ARGS,
+						      "Malformed operation list"));
 		return;
+	}
+
+	ops = parse_ops(msg);
+	entries = 0;
+	bytes = 0;
+	for (i = 0; i < ops->len; i++) {
+		const PlsOp *op = &g_array_index(ops, PlsOp, i);
 
-	pllist = g_hash_table_lookup(_usecount_holders, requestor);
-	pllist = g_list_remove(pllist, pls);
-	
-	if (!pllist)
-	{
-		_unregister_requestor(connection, requestor);
+		entries += op->noids;
+		bytes += quota_strv_bytes(op->oids, op->noids);
+	}
+	if (!quota_admit(dbus_message_get_sender(msg), pls, 0,
+			 entries, bytes, &err)) {
+		mafw_dbus_send(conn, mafw_dbus_gerror(msg, err));
+		g_error_free(err);
+		free_ops(ops);
 		return;
 	}
-	
-	g_hash_table_replace(_usecount_holders, g_strdup(requestor), pllist);
+
+	results = g_new0(gboolean, ops->len);
+	oldlen = pls->len;
+	applied = pls_apply_ops(pls, (PlsOp *)ops->data, ops->len,
+				results, &first);
+	mafw_dbus_send(conn, mafw_dbus_reply(msg,
+					     DBUS_TYPE_ARRAY,
+					     DBUS_TYPE_BOOLEAN,
+					     results, ops->len));
+	if (!applied)
+		/* Nothing has changed, the reply tells what was wrong. */
+		goto out;
+
+	repeat_changed = shuffle_changed = FALSE;
+	for (i = 0; i < ops->len; i++) {
+		switch (g_array_index(ops, PlsOp, i).type) {
+		case MAFW_PLAYLIST_OP_SET_REPEAT:
+			repeat_changed = TRUE;
+			break;
+		case MAFW_PLAYLIST_OP_SHUFFLE:
+		case MAFW_PLAYLIST_OP_UNSHUFFLE:
+			shuffle_changed = TRUE;
+			break;
+		}
+	}
+
+	/* Items below $first are untouched, everything above may have
+	 * been replaced. */
+	if (first != G_MAXUINT)
+		send_contents_changed(pls->id, first,
+				      oldlen - first, pls->len - first);
+	if (repeat_changed)
+		send_property_changed(pls->id, "repeat");
+	if (shuffle_changed)
+		send_property_changed(pls->id, "is-shuffled");
+
+out:	g_free(results);
+	free_ops(ops);
 }
 
-/**
- * Extracts the client from the message, and removes the Pls pointer from it's
- * list
- */
-static void _remove_usecount_holder_by_msg(DBusConnection *connection,
-						DBusMessage *msg, Pls *pls)
+/* Replies the changes of $pls since the generation the client knows,
+ * or tells it to refetch everything. */
+static void handle_sync_since(DBusConnection *conn, DBusMessage *msg,
+			      Pls *pls)
 {
-	const gchar *requestor = dbus_message_get_sender(msg);
+	DBusMessage *reply;
+	DBusMessageIter imsg, iary, istr, ioids;
+	GPtrArray *changes;
+	guint generation, i, j;
+	dbus_bool_t full;
+
+	mafw_dbus_parse(msg, DBUS_TYPE_UINT32, &generation);
+	changes = g_ptr_array_new();
+	full = !pls_changes_since(pls, generation, changes);
 
-	_remove_usecount_holder(connection, requestor, pls);
+	reply = mafw_dbus_reply(msg,
+				MAFW_DBUS_UINT32(pls->generation),
+				MAFW_DBUS_BOOLEAN(full));
+	dbus_message_iter_init_append(reply, &imsg);
+	dbus_message_iter_open_container(&imsg, DBUS_TYPE_ARRAY, "(uuas)",
+					 &iary);
+	for (i = 0; i < changes->len; i++) {
+		const PlsChange *change = changes->pdata[i];
+
+		dbus_message_iter_open_container(&iary, DBUS_TYPE_STRUCT,
+						 NULL, &istr);
+		dbus_message_iter_append_basic(&istr, DBUS_TYPE_UINT32,
+					       &change->from);
+		dbus_message_iter_append_basic(&istr, DBUS_TYPE_UINT32,
+					       &change->nremove);
+		dbus_message_iter_open_container(&istr, DBUS_TYPE_ARRAY, "s",
+						 &ioids);
+		for (j = 0; j < change->noids; j++)
+			dbus_message_iter_append_basic(&ioids,
+						       DBUS_TYPE_STRING,
+						       &change->oids[j]);
+		dbus_message_iter_close_container(&istr, &ioids);
+		dbus_message_iter_close_container(&iary, &istr);
+	}
+	dbus_message_iter_close_container(&imsg, &iary);
+	mafw_dbus_send(conn, reply);
+	g_ptr_array_free(changes, TRUE);
 }
 
-/**
- * Handles the NameOwnerChanged signals, and unregisters a client if needed.
- * This will decrease the use-count, if a registered client disappears.
+/*
+ * A get_items or get_items_with_metadata reply being built, see
+ * items_read().
+ *
+ * @plid:       the playlist read
+ * @generation: the generation of the playlist read so far
+ * @first:      the first item asked for
+ * @last:       the last one asked for, maybe beyond the playlist
+ * @next:       the first item not read yet
+ * @whole:      whether to read all remaining items at once
+ * @oids:       the object ids read so far
+ * @mds:        their frozen metadata (GByteArray, or %NULL if not cached),
+ *              %NULL for get_items
+ * @duration:   for get_items_with_metadata, the total duration of the
+ *              playlist
+ * @unknown:    and the number of its items of unknown duration
  */
-static DBusHandlerResult
-handle_usecount_holder_msgs(DBusConnection *conn,
-                                     DBusMessage *msg,
-                                     gpointer data)
-{
-	gchar *name, *oldname, *newname;
+typedef struct {
+	guint plid;
+	guint generation;
+	guint first, last, next;
+	gboolean whole;
+	GPtrArray *oids;
+	GPtrArray *mds;
+	guint64 duration;
+	guint unknown;
+} ItemsRead;
 
-	if (!_usecount_holders)
-		return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
-	if (!dbus_message_is_signal(msg, DBUS_INTERFACE_DBUS,
-				   "NameOwnerChanged"))
-		return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
-	
+static void frozen_free(GByteArray *frozen)
+{
+	if (frozen)
+		g_byte_array_free(frozen, TRUE);
+}
 
-	name = oldname = newname = NULL;
-	mafw_dbus_parse(msg,
-			 DBUS_TYPE_STRING, &name,
-			 DBUS_TYPE_STRING, &oldname,
-			 DBUS_TYPE_STRING, &newname);
-	if (*newname && *oldname)
-		return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+static void items_read_free(ItemsRead *rd)
+{
+	g_ptr_array_free(rd->oids, TRUE);
+	if (rd->mds)
+		g_ptr_array_free(rd->mds, TRUE);
+	g_free(rd);
+}
 
-	if (*newname) {
-		return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
-	} else if (*oldname) {
-		GList *pllist = g_hash_table_lookup(_usecount_holders, oldname);
-		
-		if (pllist)
-		{
-			while(pllist)
-			{
-				Pls *pls = pllist->data;
-
-				pls->use_count--;
-				pls_set_use_count(pls, pls->use_count);
-				pllist = g_list_remove(pllist, pls);
-			}
-			_unregister_requestor(conn, oldname);
-		}
+/* Notes the totals of $pls in $rd, and starts fetching the metadata of the
+ * items of $rd not cached yet. */
+static void items_read_totals(ItemsRead *rd, Pls *pls)
+{
+	rd->duration = 0;
+	rd->unknown = pls->len;
+	if (mdcache_enabled()) {
+		mdcache_totals(pls, &rd->duration, &rd->unknown);
+		mdcache_fetch(pls, rd->first, MIN(rd->last, pls->len - 1));
 	}
-	return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
 }
 
-/**
- * Add a dbus-filter
- */
-void init_pl_wrapper(DBusConnection *connection)
-{	
-	if (!dbus_connection_add_filter(connection,
-                                        handle_usecount_holder_msgs,
-                                        NULL, NULL))
-		g_assert_not_reached();
+/* Returns the cached metadata of the $idx:th item of $pls frozen, or NULL
+ * if it's not cached. */
+static GByteArray *item_metadata(Pls *pls, guint idx)
+{
+	GHashTable *md;
+
+	md = mdcache_enabled() ? mdcache_lookup(pls, idx) : NULL;
+	return md && g_hash_table_size(md)
+		? mafw_metadata_freeze_bary(md) : NULL;
 }
 
-/**
- * If a client has increased a playlist's use-count, this will store the client's
- * request in the _usecount_holders hash-table.
- */
-static void _store_usecount_holder(DBusConnection *connection, DBusMessage *msg,
-					Pls *pls)
+/* Sends $rd to $msg. */
+static void items_read_reply(DBusConnection *conn, DBusMessage *msg,
+			     ItemsRead *rd)
 {
-	GList *pllist = NULL;
-	gchar *requestor = g_strdup(dbus_message_get_sender(msg));
-
-	if (!_usecount_holders)
-	{
-		_usecount_holders = g_hash_table_new_full(g_str_hash,
-							g_str_equal,
-							(GDestroyNotify)g_free,
-							NULL);
+	DBusMessage *reply;
+	DBusMessageIter imsg, iary;
+	guint i;
+
+	reply = mafw_dbus_reply(msg,
+				DBUS_TYPE_ARRAY, DBUS_TYPE_STRING,
+				rd->oids->pdata, rd->oids->len);
+	if (!rd->mds) {
+		mafw_dbus_send(conn, reply);
+		return;
 	}
-	else
-		pllist = g_hash_table_lookup(_usecount_holders, requestor);
 
-	if (!pllist)
-	{/* Adding match */
-		gchar *match_str = g_strdup_printf(MATCH_STR, requestor);
-		DBusError err;
+	dbus_message_iter_init_append(reply, &imsg);
+	dbus_message_iter_open_container(&imsg, DBUS_TYPE_ARRAY, "ay",
+					 &iary);
+	for (i = 0; i < rd->mds->len; i++) {
+		DBusMessageIter ibytes;
+		GByteArray *frozen;
 
-		dbus_error_init(&err);
-		
-		dbus_bus_add_match(connection, match_str, &err);
-		if (dbus_error_is_set(&err))
-		{
-                	g_critical("Unable to add match: %s", match_str);
-			dbus_error_free(&err);
+		dbus_message_iter_open_container(&iary, DBUS_TYPE_ARRAY, "y",
+						 &ibytes);
+		frozen = g_ptr_array_index(rd->mds, i);
+		if (frozen)
+			dbus_message_iter_append_fixed_array(&ibytes,
+							     DBUS_TYPE_BYTE,
+							     &frozen->data,
+							     frozen->len);
+		dbus_message_iter_close_container(&iary, &ibytes);
+	}
+	dbus_message_iter_close_container(&imsg, &iary);
+	dbus_message_iter_append_basic(&imsg, DBUS_TYPE_UINT64,
+				       &rd->duration);
+	dbus_message_iter_append_basic(&imsg, DBUS_TYPE_UINT32,
+				       &rd->unknown);
+	mafw_dbus_send(conn, reply);
+}
+
+/* Reads the next ITEMS_SLICE items of $rd from $pls, or all the rest if
+ * $rd->whole, and replies $msg when done.  Returns whether it has. */
+static gboolean items_read_step(DBusConnection *conn, DBusMessage *msg,
+				ItemsRead *rd, Pls *pls)
+{
+	gchar **oids;
+	guint end, i;
+
+	if (rd->generation != pls->generation) {
+		/* The items have changed since the previous slice.  Start
+		 * over, and don't give edits a chance to interrupt us
+		 * again. */
+		rd->generation = pls->generation;
+		rd->next = rd->first;
+		rd->whole = TRUE;
+		g_ptr_array_set_size(rd->oids, 0);
+		if (rd->mds)
+			g_ptr_array_set_size(rd->mds, 0);
+		if (rd->first >= pls->len) {
+			mafw_dbus_send(conn,
+				mafw_dbus_error(msg, MAFW_PLAYLIST_ERROR,
+					MAFW_PLAYLIST_ERROR_INVALID_INDEX,
+					"Wrong index"));
+			return TRUE;
 		}
-		g_free(match_str);
+		if (rd->mds)
+			items_read_totals(rd, pls);
 	}
-	
-	pllist = g_list_prepend(pllist, pls);
-	
-	g_hash_table_replace(_usecount_holders, requestor, pllist);
+
+	end = MIN(rd->last, pls->len - 1);
+	if (!rd->whole && end - rd->next >= ITEMS_SLICE)
+		end = rd->next + ITEMS_SLICE - 1;
+	oids = pls_get_items(pls, rd->next, end);
+	for (i = 0; oids[i]; i++)
+		g_ptr_array_add(rd->oids, g_strdup(oids[i]));
+	pls_items_free(pls, oids);
+	if (rd->mds)
+		for (i = rd->next; i <= end; i++)
+			g_ptr_array_add(rd->mds, item_metadata(pls, i));
+	rd->next = end + 1;
+
+	if (rd->next <= MIN(rd->last, pls->len - 1))
+		return FALSE;
+	items_read_reply(conn, msg, rd);
+	return TRUE;
 }
 
-DBusHandlerResult handle_playlist_request(DBusConnection *conn,
-                                          DBusMessage *msg,
-                                          const gchar *path)
+/* The DispatchSliceFunc of items_read(). */
+static gboolean items_read_slice(DBusConnection *conn, DBusMessage *msg,
+				 ItemsRead *rd)
 {
-	const gchar *member;
-	guint plid;
+	gboolean reader, done;
 	Pls *pls;
 
-	/* Object path should look like: "/com/nokia/mafw/playlist/<ID>" */
-	plid = atoi(path + sizeof(MAFW_PLAYLIST_PATH));
-	if (plid == MAFW_PROXY_PLAYLIST_INVALID_ID) {
-		g_warning("Not a valid playlist id");
-		return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
-	}
-	pls = g_tree_lookup(Playlists, GUINT_TO_POINTER(plid));
+	pls = g_tree_lookup(Playlists, GUINT_TO_POINTER(rd->plid));
 	if (!pls) {
-		mafw_dbus_send(
-			conn, mafw_dbus_error(
-				msg, MAFW_PLAYLIST_ERROR,
+		mafw_dbus_send(conn,
+			mafw_dbus_error(msg, MAFW_PLAYLIST_ERROR,
 				MAFW_PLAYLIST_ERROR_PLAYLIST_NOT_FOUND,
 				"No such playlist"));
-		return DBUS_HANDLER_RESULT_HANDLED;
+		return TRUE;
 	}
 
+	/* Locked like by handle_playlist_request(). */
+	reader = dispatch_reads_only(msg);
+	cold_lock(pls, reader);
+	done = items_read_step(conn, msg, rd, pls);
+	if (reader)
+		g_rw_lock_reader_unlock(&pls->lock);
+	else
+		g_rw_lock_writer_unlock(&pls->lock);
+	return done;
+}
+
+/* Replies $msg the $first..$last items of $pls, with their cached
+ * metadata and the totals of the playlist if $metadata.  $first must be
+ * in the playlist.  Long ranges are read in slices if the dispatcher
+ * lets us, see dispatch_slice(). */
+static void items_read(DBusConnection *conn, DBusMessage *msg, guint plid,
+		       Pls *pls, guint first, guint last, gboolean metadata)
+{
+	ItemsRead *rd;
+
+	rd = g_new0(ItemsRead, 1);
+	rd->plid = plid;
+	rd->generation = pls->generation;
+	rd->first = rd->next = first;
+	rd->last = last;
+	rd->whole = !dispatch_can_slice(msg);
+	rd->oids = g_ptr_array_new_with_free_func(g_free);
+	if (metadata) {
+		rd->mds = g_ptr_array_new_with_free_func(
+					(GDestroyNotify)frozen_free);
+		items_read_totals(rd, pls);
+	}
+
+	if (items_read_step(conn, msg, rd, pls))
+		items_read_free(rd);
+	else
+		dispatch_slice(msg, (DispatchSliceFunc)items_read_slice, rd,
+			       (GDestroyNotify)items_read_free);
+}
+
+/* Replies the items of $pls asked by the get_items or
+ * get_items_with_metadata $msg. */
+static void handle_get_items(DBusConnection *conn, DBusMessage *msg,
+			     guint plid, Pls *pls, gboolean metadata)
+{
+	guint first, last;
+
+	mafw_dbus_parse(msg,
+			DBUS_TYPE_UINT32, &first,
+			DBUS_TYPE_UINT32, &last);
+	smart_demand(pls, last);
+	if (first >= pls->len || last < first) {
+		mafw_dbus_send(conn,
+			mafw_dbus_error(msg, MAFW_PLAYLIST_ERROR,
+				MAFW_PLAYLIST_ERROR_INVALID_INDEX,
+				"Wrong index"));
+		return;
+	}
+	items_read(conn, msg, plid, pls, first, last, metadata);
+}
+
+/* Requests editing the items of a playlist, refused for smart ones. */
+static const gchar *const Edits[] = {
+	MAFW_PLAYLIST_METHOD_INSERT_ITEM,
+	MAFW_PLAYLIST_METHOD_APPEND_ITEM,
+	MAFW_PLAYLIST_METHOD_REMOVE_ITEM,
+	MAFW_PLAYLIST_METHOD_MOVE,
+	MAFW_PLAYLIST_METHOD_CLEAR,
+	MAFW_PLAYLIST_METHOD_APPLY_OPS,
+	NULL
+};
+
+/* Tells whether $member is one of $Edits. */
+static gboolean is_edit(const gchar *member)
+{
+	const gchar *const *edit;
+
+	for (edit = Edits; *edit; edit++)
+		if (!strcmp(member, *edit))
+			return TRUE;
+	return FALSE;
+}
+
+/* Handles $msg addressed to $pls, which is locked by the caller. */
+static DBusHandlerResult handle_pls_request(DBusConnection *conn,
+					    DBusMessage *msg,
+					    guint plid, Pls *pls)
+{
+	const gchar *member;
+
 	member = dbus_message_get_member(msg);
+	if (pls->smart && is_edit(member)) {
+		mafw_dbus_send(conn,
+			mafw_dbus_error(msg, MAFW_PLAYLIST_ERROR,
+				MAFW_PLAYLIST_ERROR_NOT_SUPPORTED,
+				"Smart playlists cannot be edited"));
+		return DBUS_HANDLER_RESULT_HANDLED;
+	}
 	if (!strcmp(member, MAFW_PLAYLIST_METHOD_SET_NAME)) {
 		gchar *name, *oldname;
 
@@ -373,13 +689,15 @@ DBusHandlerResult handle_playlist_request(DBusConnection *conn,
 	} else if (!strcmp(member, MAFW_PLAYLIST_METHOD_INCREMENT_USE_COUNT)) {
 		pls->use_count++;
 		pls_set_use_count(pls, pls->use_count);
-		_store_usecount_holder(conn, msg, pls);
+		mafw_session_hold(Usecount_holders,
+				  dbus_message_get_sender(msg), pls);
 		mafw_dbus_ack_or_error(conn, msg, NULL);
 		return DBUS_HANDLER_RESULT_HANDLED;
 	} else if (!strcmp(member, MAFW_PLAYLIST_METHOD_DECREMENT_USE_COUNT)) {
 		pls->use_count--;
 		pls_set_use_count(pls, pls->use_count);
-		_remove_usecount_holder_by_msg(conn, msg, pls);
+		mafw_session_release(Usecount_holders,
+				     dbus_message_get_sender(msg), pls);
 		mafw_dbus_ack_or_error(conn, msg, NULL);
 		return DBUS_HANDLER_RESULT_HANDLED;
 	} else if (!strcmp(member, MAFW_PLAYLIST_METHOD_INSERT_ITEM)) {
@@ -392,6 +710,12 @@ DBusHandlerResult handle_playlist_request(DBusConnection *conn,
 				DBUS_TYPE_UINT32, &index,
 				DBUS_TYPE_ARRAY, DBUS_TYPE_STRING,
                         	&objectids, &len);
+		if (!quota_admit(dbus_message_get_sender(msg), pls, 0, len,
+				 quota_strv_bytes(objectids, len), &err)) {
+			mafw_dbus_ack_or_error(conn, msg, err);
+			g_strfreev(objectids);
+			return DBUS_HANDLER_RESULT_HANDLED;
+		}
 		if (!pls_inserts(pls, index, (const gchar **)objectids, len))
 			err = g_error_new(MAFW_PLAYLIST_ERROR,
 					  MAFW_PLAYLIST_ERROR_INVALID_INDEX,
@@ -407,6 +731,12 @@ DBusHandlerResult handle_playlist_request(DBusConnection *conn,
 
 		mafw_dbus_parse(msg, DBUS_TYPE_ARRAY, DBUS_TYPE_STRING,
                         	&objectids, &len);
+		if (!quota_admit(dbus_message_get_sender(msg), pls, 0, len,
+				 quota_strv_bytes(objectids, len), &err)) {
+			mafw_dbus_ack_or_error(conn, msg, err);
+			g_strfreev(objectids);
+			return DBUS_HANDLER_RESULT_HANDLED;
+		}
 		if (!pls_appends(pls, (const gchar **)objectids, len))
 			err = g_error_new(MAFW_PLAYLIST_ERROR,
 					  MAFW_PLAYLIST_ERROR_INVALID_INDEX,
@@ -438,6 +768,7 @@ DBusHandlerResult handle_playlist_request(DBusConnection *conn,
 		guint index;
 
 		mafw_dbus_parse(msg, DBUS_TYPE_UINT32, &index);
+		smart_demand(pls, index);
 		oid = pls_get_item(pls, index);
 		if (oid) {
 			mafw_dbus_send(conn,
@@ -453,30 +784,43 @@ DBusHandlerResult handle_playlist_request(DBusConnection *conn,
 		}
 		return DBUS_HANDLER_RESULT_HANDLED;
 	}  else if (!strcmp(member, MAFW_PLAYLIST_METHOD_GET_ITEMS)) {
-		gchar **oids = NULL;
-		guint start_index, end_index;
-		GError *error = NULL;
+		handle_get_items(conn, msg, plid, pls, FALSE);
+		return DBUS_HANDLER_RESULT_HANDLED;
+	} else if (!strcmp(member, MAFW_PLAYLIST_METHOD_GET_ITEMS_PAGED)) {
+		gchar **oids;
+		guint generation, start_index, max_items, max_bytes, next;
 
-		mafw_dbus_parse(msg, DBUS_TYPE_UINT32, &start_index,
-					DBUS_TYPE_UINT32, &end_index);
-		oids = pls_get_items(pls, start_index, end_index);
-		if (oids)
-		{
+		mafw_dbus_parse(msg,
+				DBUS_TYPE_UINT32, &generation,
+				DBUS_TYPE_UINT32, &start_index,
+				DBUS_TYPE_UINT32, &max_items,
+				DBUS_TYPE_UINT32, &max_bytes);
+		if (generation && generation != pls->generation) {
 			mafw_dbus_send(conn,
-				mafw_dbus_reply(
-					msg,
-					MAFW_DBUS_STRVZ(oids)));
-			g_free(oids);
-		}
-		else
-		{
-			error = g_error_new(MAFW_PLAYLIST_ERROR,
-					    MAFW_PLAYLIST_ERROR_INVALID_INDEX,
-					    "Wrong index");
-			mafw_dbus_send(conn, mafw_dbus_gerror(msg, error));
-			g_error_free(error);
+				mafw_dbus_error(msg, MAFW_PLAYLIST_ERROR,
+					MAFW_PLAYLIST_ERROR_INVALID_INDEX,
+					"Playlist changed since the last page"));
+			return DBUS_HANDLER_RESULT_HANDLED;
 		}
+		if (!max_bytes || max_bytes > GET_ITEMS_PAGE_MAX_BYTES)
+			max_bytes = GET_ITEMS_PAGE_MAX_BYTES;
 
+		oids = pls_get_items_budget(pls, start_index, max_items,
+					    max_bytes, &next);
+		smart_demand(pls, next);
+		if (oids) {
+			mafw_dbus_send(conn,
+				mafw_dbus_reply(msg,
+					MAFW_DBUS_UINT32(pls->generation),
+					MAFW_DBUS_UINT32(next),
+					MAFW_DBUS_STRVZ(oids)));
+			pls_items_free(pls, oids);
+		} else {
+			mafw_dbus_send(conn,
+				mafw_dbus_error(msg, MAFW_PLAYLIST_ERROR,
+					MAFW_PLAYLIST_ERROR_INVALID_INDEX,
+					"Wrong index"));
+		}
 		return DBUS_HANDLER_RESULT_HANDLED;
 	} else if (!strcmp(member, MAFW_PLAYLIST_METHOD_GET_STARTING_INDEX)) {
 		gchar *oid = NULL;
@@ -498,6 +842,7 @@ DBusHandlerResult handle_playlist_request(DBusConnection *conn,
 		guint index;
 
 		pls_get_last(pls, &index, &oid);
+		smart_demand(pls, pls->len);
 		if (!oid) {
 			oid = g_strdup("");
 		}
@@ -513,6 +858,7 @@ DBusHandlerResult handle_playlist_request(DBusConnection *conn,
 		guint index;
 
 		mafw_dbus_parse(msg, DBUS_TYPE_UINT32, &index);
+		smart_demand(pls, index + 1);
 		pls_get_next(pls, &index, &oid);
 		if (!oid) {
 			oid = g_strdup("");
@@ -524,6 +870,28 @@ DBusHandlerResult handle_playlist_request(DBusConnection *conn,
 					MAFW_DBUS_STRING(oid)));
 		g_free(oid);
 		return DBUS_HANDLER_RESULT_HANDLED;
+	} else if (!strcmp(member, MAFW_PLAYLIST_METHOD_GET_NEXT_N)) {
+		gchar **oids;
+		guint *indices;
+		guint index, n, found;
+
+		mafw_dbus_parse(msg, DBUS_TYPE_UINT32, &index,
+				DBUS_TYPE_UINT32, &n);
+		if (n > GET_NEXT_N_MAX)
+			n = GET_NEXT_N_MAX;
+		smart_demand(pls, index + n);
+		indices = g_new(guint, n);
+		oids = g_new(gchar *, n + 1);
+		found = pls_get_next_n(pls, index, n, indices, oids);
+		mafw_dbus_send(conn,
+				mafw_dbus_reply(
+					msg,
+					DBUS_TYPE_ARRAY, DBUS_TYPE_UINT32,
+					indices, found,
+					MAFW_DBUS_STRVZ(oids)));
+		g_free(indices);
+		g_strfreev(oids);
+		return DBUS_HANDLER_RESULT_HANDLED;
 	} else if (!strcmp(member, MAFW_PLAYLIST_METHOD_GET_PREV)) {
 		gchar *oid = NULL;
 		guint index;
@@ -573,7 +941,86 @@ DBusHandlerResult handle_playlist_request(DBusConnection *conn,
 		mafw_dbus_ack_or_error(conn, msg, NULL);
 		send_contents_changed(plid, 0, oldlen, 0);
 		return DBUS_HANDLER_RESULT_HANDLED;
+	} else if (!strcmp(member, MAFW_PLAYLIST_METHOD_APPLY_OPS)) {
+		handle_apply_ops(conn, msg, pls);
+		return DBUS_HANDLER_RESULT_HANDLED;
+	} else if (!strcmp(member, MAFW_PLAYLIST_METHOD_SYNC_SINCE)) {
+		handle_sync_since(conn, msg, pls);
+		return DBUS_HANDLER_RESULT_HANDLED;
+	} else if (!strcmp(member,
+			    MAFW_PLAYLIST_METHOD_GET_ITEMS_WITH_METADATA)) {
+		handle_get_items(conn, msg, plid, pls, TRUE);
+		return DBUS_HANDLER_RESULT_HANDLED;
+	} else if (!strcmp(member, MAFW_PLAYLIST_METHOD_GET_MIRROR)) {
+		mirror_get(conn, msg, pls);
+		return DBUS_HANDLER_RESULT_HANDLED;
+	} else if (!strcmp(member, MAFW_PLAYLIST_METHOD_SET_WINDOW)) {
+		gchar **oids;
+		guint first, count, n;
+
+		mafw_dbus_parse(msg,
+				DBUS_TYPE_UINT32, &first,
+				DBUS_TYPE_UINT32, &count);
+		/* It's an interactive request, keep it small. */
+		if (count > MAFW_PLAYLIST_WINDOW_MAX)
+			count = MAFW_PLAYLIST_WINDOW_MAX;
+		window_set(conn, dbus_message_get_sender(msg), pls,
+			   first, count);
+		if (count)
+			smart_demand(pls, first + MIN(count - 1,
+						      G_MAXUINT - first));
+		n = first < pls->len ? MIN(count, pls->len - first) : 0;
+		oids = n ? pls_get_items(pls, first, first + n - 1) : NULL;
+		mafw_dbus_send(conn,
+			       mafw_dbus_reply(msg,
+					       DBUS_TYPE_ARRAY,
+					       DBUS_TYPE_STRING,
+					       oids, n));
+		if (oids)
+			pls_items_free(pls, oids);
+		return DBUS_HANDLER_RESULT_HANDLED;
 	}
 	return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
 }
+
+DBusHandlerResult handle_playlist_request(DBusConnection *conn,
+                                          DBusMessage *msg,
+                                          const gchar *path)
+{
+	DBusHandlerResult ret;
+	gboolean reader;
+	guint plid, oldlen;
+	guint64 oldbytes;
+	Pls *pls;
+
+	/* Object path should look like: "/com/nokia/mafw/playlist/<ID>" */
+	plid = atoi(path + sizeof(MAFW_PLAYLIST_PATH));
+	if (plid == MAFW_PROXY_PLAYLIST_INVALID_ID) {
+		g_warning("Not a valid playlist id");
+		return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+	}
+	pls = g_tree_lookup(Playlists, GUINT_TO_POINTER(plid));
+	if (!pls) {
+		mafw_dbus_send(
+			conn, mafw_dbus_error(
+				msg, MAFW_PLAYLIST_ERROR,
+				MAFW_PLAYLIST_ERROR_PLAYLIST_NOT_FOUND,
+				"No such playlist"));
+		return DBUS_HANDLER_RESULT_HANDLED;
+	}
+
+	/* Request handlers may run in parallel, see dispatch.c. */
+	reader = dispatch_reads_only(msg);
+	cold_lock(pls, reader);
+	oldlen = pls->len;
+	oldbytes = pls->bytes;
+	ret = handle_pls_request(conn, msg, plid, pls);
+	quota_update(pls, oldlen, oldbytes);
+	if (reader)
+		g_rw_lock_reader_unlock(&pls->lock);
+	else
+		g_rw_lock_writer_unlock(&pls->lock);
+	return ret;
+}
+
 /* vi: set noexpandtab ts=8 sw=8 cino=t0,(0: */
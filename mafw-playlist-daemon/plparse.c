@@ -0,0 +1,235 @@
+/*
+ * This file is a part of MAFW
+ *
+ * Copyright (C) 2007, 2008, 2009 Nokia Corporation, all rights reserved.
+ *
+ * Contact: Visa Smolander <visa.smolander@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+#include <string.h>
+#include <glib.h>
+#include <gio/gio.h>
+
+#include "mpd-internal.h"
+
+/*
+ * Streaming parser for the common, simple kinds of local playlist files:
+ * plain and extended M3U and PLS.  Anything else (remote files, other
+ * formats, playlists inside playlists) is left to totem-pl-parser.
+ * The entries are resolved to URIs the same way totem-pl-parser does,
+ * so the object ids made of them are identical.
+ *
+ * plparse_open() only looks at the name of the file, the file is opened
+ * and read by plparse_read(), which may block on slow file systems; it's
+ * to be called from a worker thread.
+ */
+
+typedef enum {
+	PLPARSE_M3U,
+	PLPARSE_PLS,
+} PlparseFormat;
+
+/*
+ * @format: the syntax of the file
+ * @fname:  the file to read
+ * @chan:   the file being read, %NULL until the first plparse_read()
+ * @dir:    relative paths are resolved against this
+ */
+struct _Plparse {
+	PlparseFormat format;
+	gchar *fname;
+	GIOChannel *chan;
+	GFile *dir;
+};
+
+/* Returns whether @s starts with an URI scheme followed by "://". */
+static gboolean is_uri(const gchar *s)
+{
+	const gchar *p;
+
+	if (!g_ascii_isalpha(*s))
+		return FALSE;
+	for (p = s + 1; g_ascii_isalnum(*p) || strchr("+-.", *p); p++)
+		/* skip the scheme */;
+	return *p == ':' && p[1] == '/' && p[2] == '/';
+}
+
+/* Returns whether @fname ends in @ext, ignoring case. */
+static gboolean has_ext(const gchar *fname, const gchar *ext)
+{
+	gsize lf, le;
+
+	lf = strlen(fname);
+	le = strlen(ext);
+	return lf > le && !g_ascii_strcasecmp(fname + lf - le, ext);
+}
+
+/**
+ * plparse_open:
+ * @uri:  URI or absolute path of the playlist file
+ * @base: if not %NULL or empty, relative entries are resolved against it
+ *        rather than the directory of the playlist
+ *
+ * Returns a new parser for @uri if it names a local M3U or PLS file,
+ * otherwise %NULL.  The file itself is not touched yet.
+ */
+Plparse *plparse_open(const gchar *uri, const gchar *base)
+{
+	Plparse *p;
+	PlparseFormat format;
+	gchar *fname, *hostname;
+
+	hostname = NULL;
+	if (g_path_is_absolute(uri))
+		fname = g_strdup(uri);
+	else if (!(fname = g_filename_from_uri(uri, &hostname, NULL)))
+		return NULL;
+	if (hostname) {
+		g_free(hostname);
+		g_free(fname);
+		return NULL;
+	}
+
+	if (has_ext(fname, ".m3u") || has_ext(fname, ".m3u8")) {
+		format = PLPARSE_M3U;
+	} else if (has_ext(fname, ".pls")) {
+		format = PLPARSE_PLS;
+	} else {
+		g_free(fname);
+		return NULL;
+	}
+
+	p = g_new0(Plparse, 1);
+	p->format = format;
+	p->fname = fname;
+	if (base && base[0]) {
+		p->dir = g_file_new_for_uri(base);
+	} else {
+		GFile *file;
+
+		file = g_file_new_for_path(fname);
+		p->dir = g_file_get_parent(file);
+		g_object_unref(file);
+	}
+	return p;
+}
+
+/* Returns the URI of the playlist entry @entry, or %NULL. */
+static gchar *resolve(Plparse *p, const gchar *entry)
+{
+	GFile *file;
+	gchar *uri;
+
+	if (!entry[0])
+		return NULL;
+	if (is_uri(entry))
+		return g_strdup(entry);
+	if (g_path_is_absolute(entry))
+		return g_filename_to_uri(entry, NULL, NULL);
+	if (!p->dir)
+		return NULL;
+	file = g_file_resolve_relative_path(p->dir, entry);
+	uri = g_file_get_uri(file);
+	g_object_unref(file);
+	return uri;
+}
+
+/* Returns the entry in @line, pointing into @line, or %NULL. */
+static gchar *get_entry(Plparse *p, gchar *line)
+{
+	g_strstrip(line);
+	if (p->format == PLPARSE_M3U) {
+		/* #EXTM3U, #EXTINF and comments */
+		return line[0] != '#' ? line : NULL;
+	} else {
+		gchar *s;
+
+		/* FileN=<entry>, anything else is metadata. */
+		if (g_ascii_strncasecmp(line, "file", 4))
+			return NULL;
+		for (s = line + 4; g_ascii_isdigit(*s); s++)
+			/* skip the number */;
+		if (s == line + 4 || *s != '=')
+			return NULL;
+		return g_strchug(s + 1);
+	}
+}
+
+/**
+ * plparse_read:
+ * @p:     a parser returned by plparse_open()
+ * @max:   the maximum number of lines to process
+ * @entry: called with the URI of each entry found
+ * @udata: passed to @entry
+ * @err:   location for a #GError
+ *
+ * Reads the next @max lines of the playlist, opening it the first time.
+ * It blocks while reading, and it's not to be called from different
+ * threads at the same time.
+ *
+ * Returns: %TRUE if there is more to read.  %FALSE is returned at the end
+ * of file or on error, which is the case if @err is set.
+ */
+gboolean plparse_read(Plparse *p, guint max, PlparseEntryFunc entry,
+		      gpointer udata, GError **err)
+{
+	gchar *line, *ent, *uri;
+	GIOStatus status;
+
+	if (!p->chan) {
+		if (!(p->chan = g_io_channel_new_file(p->fname, "r", err)))
+			return FALSE;
+		/* Read bytes, the entries are file names or URIs. */
+		g_io_channel_set_encoding(p->chan, NULL, NULL);
+	}
+	for (; max > 0; max--) {
+		status = g_io_channel_read_line(p->chan, &line, NULL, NULL,
+						err);
+		if (status == G_IO_STATUS_EOF || status == G_IO_STATUS_ERROR)
+			return FALSE;
+		if (status != G_IO_STATUS_NORMAL)
+			continue;
+		if ((ent = get_entry(p, line)) && (uri = resolve(p, ent))) {
+			entry(uri, udata);
+			g_free(uri);
+		}
+		g_free(line);
+	}
+	return TRUE;
+}
+
+/**
+ * plparse_close:
+ * @p: a parser returned by plparse_open()
+ *
+ * Closes the playlist file and frees @p.
+ */
+void plparse_close(Plparse *p)
+{
+	if (p->chan)
+		g_io_channel_unref(p->chan);
+	g_free(p->fname);
+	if (p->dir)
+		g_object_unref(p->dir);
+	g_free(p);
+}
+
+/* vi: set noexpandtab ts=8 sw=8 cino=t0,(0: */
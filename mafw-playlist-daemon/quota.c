@@ -0,0 +1,280 @@
+/*
+ * This file is a part of MAFW
+ *
+ * Copyright (C) 2007, 2008, 2009 Nokia Corporation, all rights reserved.
+ *
+ * Contact: Visa Smolander <visa.smolander@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+
+#include <libmafw/mafw-errors.h>
+
+#include "common/mafw-session.h"
+#include "libmafw-shared/mafw-playlist-manager.h"
+#include "mpd-internal.h"
+
+/*
+ * Per-client quotas.  Each playlist is charged to a client, its owner,
+ * which is the one creating it.  Playlists loaded from disk and those
+ * whose owner has left the bus are orphans, and are adopted by the next
+ * client adding items to them.  A request which would take its payer
+ * over one of its limits fails with %MAFW_PLAYLIST_ERROR_QUOTA_EXCEEDED.
+ *
+ * The limits are read from $MAFW_PLAYLIST_QUOTA, which looks like
+ * "playlists=50,entries=100000,bytes=10000000,requests=16".  Missing or
+ * zero limits are not enforced.  If no limit is set ownership isn't
+ * tracked at all.
+ *
+ * All of this happens in the main thread.
+ */
+
+/* Environment variable holding the limits. */
+#define QUOTA_ENV	"MAFW_PLAYLIST_QUOTA"
+
+static Quota Limits;
+static gboolean Enabled;
+/* Client => Quota, the resources charged to it. */
+static GHashTable *Usage;
+/* Session registry subsystem of the playlist owners. */
+static guint Owners;
+
+/* Called when the owner of $pls leaves the bus. */
+static void owner_vanished(const gchar *client, Pls *pls,
+			   guint count, gpointer unused)
+{
+	quota_disown(pls);
+}
+
+/**
+ * quota_init:
+ *
+ * Reads the limits from the environment.  To be called after
+ * mafw_session_init().
+ */
+void quota_init(void)
+{
+	const gchar *env;
+	gchar **items, **item;
+
+	memset(&Limits, 0, sizeof(Limits));
+	if (!(env = g_getenv(QUOTA_ENV)))
+		return;
+
+	items = g_strsplit(env, ",", 0);
+	for (item = items; *item; item++) {
+		gchar *val;
+
+		if (!(val = strchr(*item, '='))) {
+			g_warning("%s: ignoring '%s'", QUOTA_ENV, *item);
+			continue;
+		}
+		*val++ = '\0';
+		if (!strcmp(*item, "playlists"))
+			Limits.playlists = strtoul(val, NULL, 10);
+		else if (!strcmp(*item, "entries"))
+			Limits.entries = strtoul(val, NULL, 10);
+		else if (!strcmp(*item, "bytes"))
+			Limits.bytes = g_ascii_strtoull(val, NULL, 10);
+		else if (!strcmp(*item, "requests"))
+			Limits.requests = strtoul(val, NULL, 10);
+		else
+			g_warning("%s: unknown limit '%s'", QUOTA_ENV, *item);
+	}
+	g_strfreev(items);
+
+	Enabled = Limits.playlists || Limits.entries || Limits.bytes
+		|| Limits.requests;
+	if (Enabled && !Usage) {
+		Usage = g_hash_table_new_full(g_str_hash, g_str_equal,
+					      g_free, g_free);
+		Owners = mafw_session_add_subsystem(
+				(MafwSessionVanishedFunc)owner_vanished, NULL);
+	}
+}
+
+/**
+ * quota_limits:
+ *
+ * Returns the limits, zero fields are not enforced.
+ */
+const Quota *quota_limits(void)
+{
+	return &Limits;
+}
+
+/**
+ * quota_usage:
+ * @client: unique bus name of a client
+ * @usage:  where to store what @client is charged for
+ *
+ * Fills @usage, except the number of requests, which is up to
+ * dispatch.c.
+ */
+void quota_usage(const gchar *client, Quota *usage)
+{
+	Quota *charged;
+
+	memset(usage, 0, sizeof(*usage));
+	if (Usage && (charged = g_hash_table_lookup(Usage, client)))
+		*usage = *charged;
+}
+
+/* Returns what $client is charged for, creating an empty entry. */
+static Quota *usage_of(const gchar *client)
+{
+	Quota *charged;
+
+	if (!(charged = g_hash_table_lookup(Usage, client))) {
+		charged = g_new0(Quota, 1);
+		g_hash_table_insert(Usage, g_strdup(client), charged);
+	}
+	return charged;
+}
+
+/**
+ * quota_own:
+ * @pls:    a playlist without owner
+ * @client: the new owner
+ *
+ * Charges @pls to @client.
+ */
+void quota_own(Pls *pls, const gchar *client)
+{
+	Quota *charged;
+
+	if (!Enabled || !client)
+		return;
+	g_assert(!pls->owner);
+	pls->owner = g_strdup(client);
+	charged = usage_of(client);
+	charged->playlists++;
+	charged->entries += pls->len;
+	charged->bytes += pls->bytes;
+	mafw_session_hold(Owners, client, pls);
+}
+
+/**
+ * quota_disown:
+ * @pls: a playlist
+ *
+ * Makes @pls an orphan.  Must be called before @pls is freed.
+ */
+void quota_disown(Pls *pls)
+{
+	Quota *charged;
+
+	if (!pls->owner)
+		return;
+	charged = usage_of(pls->owner);
+	charged->playlists--;
+	charged->entries -= pls->len;
+	charged->bytes -= pls->bytes;
+	if (!charged->playlists)
+		g_hash_table_remove(Usage, pls->owner);
+	mafw_session_forget(Owners, pls);
+	g_free(pls->owner);
+	pls->owner = NULL;
+}
+
+/**
+ * quota_admit:
+ * @client:    the client making the request
+ * @pls:       the playlist the request adds items to, or %NULL if it
+ *             creates a new one
+ * @playlists: number of playlists the request creates
+ * @entries:   number of items it adds
+ * @bytes:     total length of their object ids
+ * @err:       where to store %MAFW_PLAYLIST_ERROR_QUOTA_EXCEEDED
+ *
+ * Tells whether the payer of the request stays within its limits if
+ * the request is carried out.  The payer is the owner of @pls, or
+ * @client, which adopts @pls if it's an orphan.
+ *
+ * Returns: %TRUE if the request may go on.
+ */
+gboolean quota_admit(const gchar *client, Pls *pls, guint playlists,
+		     guint entries, guint64 bytes, GError **err)
+{
+	Quota usage;
+	const gchar *what;
+
+	if (!Enabled || !client)
+		return TRUE;
+	if (pls && !pls->owner)
+		quota_own(pls, client);
+
+	quota_usage(pls ? pls->owner : client, &usage);
+	if (Limits.playlists && usage.playlists + playlists > Limits.playlists)
+		what = "playlists";
+	else if (Limits.entries && usage.entries + entries > Limits.entries)
+		what = "entries";
+	else if (Limits.bytes && usage.bytes + bytes > Limits.bytes)
+		what = "bytes";
+	else
+		return TRUE;
+	g_set_error(err, MAFW_PLAYLIST_ERROR,
+		    MAFW_PLAYLIST_ERROR_QUOTA_EXCEEDED,
+		    "Quota of %s exceeded", what);
+	return FALSE;
+}
+
+/**
+ * quota_update:
+ * @pls:      a playlist which may have changed
+ * @oldlen:   its previous length
+ * @oldbytes: its previous size of object ids
+ *
+ * Updates what the owner of @pls is charged for.
+ */
+void quota_update(Pls *pls, guint oldlen, guint64 oldbytes)
+{
+	Quota *charged;
+
+	/* Workers call us too, but they don't change anything. */
+	if ((pls->len == oldlen && pls->bytes == oldbytes) || !pls->owner)
+		return;
+	charged = usage_of(pls->owner);
+	charged->entries += pls->len - oldlen;
+	charged->bytes += pls->bytes - oldbytes;
+}
+
+/**
+ * quota_strv_bytes:
+ * @oids: object ids
+ * @n:    length of @oids
+ *
+ * Returns the total length of @oids.
+ */
+guint64 quota_strv_bytes(gchar *const *oids, guint n)
+{
+	guint64 bytes;
+	guint i;
+
+	bytes = 0;
+	for (i = 0; i < n; i++)
+		bytes += strlen(oids[i]);
+	return bytes;
+}
+
+/* vi: set noexpandtab ts=8 sw=8 cino=t0,(0: */
@@ -0,0 +1,679 @@
+/*
+ * This file is a part of MAFW
+ *
+ * Copyright (C) 2007, 2008, 2009 Nokia Corporation, all rights reserved.
+ *
+ * Contact: Visa Smolander <visa.smolander@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <glib-object.h>
+
+#include <libmafw/mafw.h>
+
+#include "common/dbus-interface.h"
+#include "libmafw-shared/mafw-playlist-manager.h"
+#include "mpd-internal.h"
+
+#undef G_LOG_DOMAIN
+#define G_LOG_DOMAIN "mafw-playlist-smart"
+
+/*
+ * Smart playlists.  A smart playlist is defined by a container, a filter
+ * and sort criteria, and holds what browsing the container with them
+ * returns.  Its items are kept in the Pls like those of any playlist,
+ * but they are only fetched when they are asked for: the container is
+ * browsed in pages of %SMART_PAGE items, and the next page is fetched
+ * when a client reads the last one fetched so far.  Clients learn about
+ * the new items from the usual contents_changed signal.
+ *
+ * When the source emits MafwSource::container-changed for the container
+ * the pages fetched are browsed again, one by one, and only those whose
+ * items differ are replaced, each with one contents_changed.  A short
+ * page ends the playlist, dropping the items after it.
+ *
+ * The definition is saved next to the playlist, in "<id>.smart".  After
+ * a restart the items saved are served as they are until the first read,
+ * which refreshes them.  Clients cannot edit the items of a smart
+ * playlist, but may shuffle and repeat it.
+ *
+ * All of this happens in the main thread, except smart_demand().
+ */
+
+/* The number of items browsed at once. */
+#define SMART_PAGE		64
+
+/* Key file group of the definitions. */
+#define SMART_GROUP		"smart"
+
+/*
+ * @plid:      the playlist
+ * @container: object id of the container browsed
+ * @filter:    the filter as given, "" if none
+ * @sort:      the sort criteria as given, "" if none
+ * @parsed:    @filter parsed, %NULL if none
+ * @uuid:      the source of @container
+ * @browsing:  a page is being browsed
+ * @browse_id: of the page being browsed, if known yet
+ * @skip:      index of the first item of the page being browsed
+ * @page:      object ids of the page being browsed
+ * @refreshing: the pages fetched are being browsed again
+ * @stale:     the pages fetched are to be browsed again
+ * @complete:  every item has been fetched
+ * @demand:    the highest index read by the clients
+ */
+typedef struct {
+	guint plid;
+	gchar *container;
+	gchar *filter;
+	gchar *sort;
+	MafwFilter *parsed;
+	gchar *uuid;
+	gboolean browsing;
+	guint browse_id;
+	guint skip;
+	GPtrArray *page;
+	gboolean refreshing;
+	gboolean stale;
+	gboolean complete;
+	guint demand;
+} Smart;
+
+/* Playlist id => Smart */
+static GHashTable *Smarts;
+/* Source uuid => MafwSource whose container-changed is connected. */
+static GHashTable *Sources;
+
+/* Playlist id => the highest index read + 1, guarded by $Demand_lock. */
+static GMutex Demand_lock;
+static GHashTable *Demands;
+static guint Demand_handler;
+
+static void pump(Smart *sm);
+
+static void page_clear(GPtrArray *page)
+{
+	g_ptr_array_foreach(page, (GFunc)g_free, NULL);
+	g_ptr_array_set_size(page, 0);
+}
+
+static void smart_free(Smart *sm)
+{
+	page_clear(sm->page);
+	g_ptr_array_free(sm->page, TRUE);
+	if (sm->parsed)
+		mafw_filter_free(sm->parsed);
+	g_free(sm->container);
+	g_free(sm->filter);
+	g_free(sm->sort);
+	g_free(sm->uuid);
+	g_free(sm);
+}
+
+/**
+ * smart_path:
+ * @plid: a playlist id
+ *
+ * Returns the name of the file holding the definition of @plid if it's a
+ * smart playlist, to be freed.
+ */
+gchar *smart_path(guint plid)
+{
+	gchar *fn, *path;
+
+	fn = pls_path(plid);
+	path = g_strconcat(fn, ".smart", NULL);
+	g_free(fn);
+	return path;
+}
+
+/* Writes the definition of $sm to disk. */
+static void smart_save(const Smart *sm)
+{
+	GKeyFile *kf;
+	GError *err = NULL;
+	gchar *fn, *data;
+	gsize len;
+
+	if (!pls_ensure_dir())
+		return;
+	kf = g_key_file_new();
+	g_key_file_set_string(kf, SMART_GROUP, "container", sm->container);
+	g_key_file_set_string(kf, SMART_GROUP, "filter", sm->filter);
+	g_key_file_set_string(kf, SMART_GROUP, "sort", sm->sort);
+	data = g_key_file_to_data(kf, &len, NULL);
+	fn = smart_path(sm->plid);
+	if (!g_file_set_contents(fn, data, len, &err)) {
+		g_critical("failed to save %s: %s", fn, err->message);
+		g_error_free(err);
+	}
+	g_free(fn);
+	g_free(data);
+	g_key_file_free(kf);
+}
+
+/* Replaces the $nremove items of $pls from $at with $page, unless they
+ * are the same already. */
+static void replace(Pls *pls, guint at, guint nremove, GPtrArray *page)
+{
+	guint i, oldlen;
+	guint64 oldbytes;
+
+	cold_thaw(pls);
+	if (nremove == page->len) {
+		for (i = 0; i < nremove; i++) {
+			gchar *oid;
+			gboolean same;
+
+			oid = pls_get_item(pls, at + i);
+			same = !strcmp(oid, page->pdata[i]);
+			g_free(oid);
+			if (!same)
+				break;
+		}
+		if (i == nremove)
+			return;
+	}
+
+	playlists_lock();
+	oldlen = pls->len;
+	oldbytes = pls->bytes;
+	if (nremove)
+		pls_removes(pls, at, nremove);
+	if (page->len)
+		pls_inserts(pls, at, (const gchar **)page->pdata, page->len);
+	quota_update(pls, oldlen, oldbytes);
+	playlists_unlock();
+	send_contents_changed(pls->id, at, nremove, page->len);
+}
+
+/* Called when the page being browsed is complete, or failed. */
+static void page_done(Smart *sm, const GError *error)
+{
+	guint at, nremove;
+	Pls *pls;
+
+	sm->browsing = FALSE;
+	sm->browse_id = MAFW_SOURCE_INVALID_BROWSE_ID;
+	if (!(pls = g_tree_lookup(Playlists, GUINT_TO_POINTER(sm->plid))))
+		return;
+	if (error) {
+		g_debug("browsing %s: %s", sm->container, error->message);
+		if (sm->refreshing) {
+			/* Try again at the next read. */
+			sm->refreshing = FALSE;
+			sm->stale = TRUE;
+		}
+		page_clear(sm->page);
+		return;
+	}
+
+	at = MIN(sm->skip, pls->len);
+	nremove = sm->page->len < SMART_PAGE
+		? pls->len - at : MIN(SMART_PAGE, pls->len - at);
+	replace(pls, at, nremove, sm->page);
+
+	if (sm->page->len < SMART_PAGE) {
+		sm->complete = TRUE;
+		sm->refreshing = FALSE;
+	} else {
+		/* There may be more, even if there weren't before. */
+		sm->complete = FALSE;
+		if (sm->refreshing && at + SMART_PAGE < pls->len) {
+			page_clear(sm->page);
+			sm->skip = at + SMART_PAGE;
+			pump(sm);
+			return;
+		}
+		sm->refreshing = FALSE;
+	}
+	page_clear(sm->page);
+	pump(sm);
+}
+
+/* MafwSourceBrowseResultCb of the pages. */
+static void browse_cb(MafwSource *src, guint browse_id,
+		      gint remaining_count, guint index,
+		      const gchar *object_id, GHashTable *metadata,
+		      gpointer plid, const GError *error)
+{
+	Smart *sm;
+
+	sm = g_hash_table_lookup(Smarts, plid);
+	if (!sm || !sm->browsing
+	    || (sm->browse_id != MAFW_SOURCE_INVALID_BROWSE_ID
+		&& sm->browse_id != browse_id))
+		return;
+	if (!error && object_id)
+		g_ptr_array_add(sm->page, g_strdup(object_id));
+	if (!error && remaining_count)
+		return;
+	page_done(sm, error);
+}
+
+/* MafwSource::container-changed, refreshes the playlists of $oid. */
+static void container_changed(MafwSource *src, const gchar *oid,
+			      gpointer unused)
+{
+	GList *smarts, *l;
+
+	smarts = g_hash_table_get_values(Smarts);
+	for (l = smarts; l; l = l->next) {
+		Smart *sm = l->data;
+
+		if (strcmp(sm->container, oid))
+			continue;
+		sm->stale = TRUE;
+		pump(sm);
+	}
+	g_list_free(smarts);
+}
+
+/* Returns the source $uuid, watching its changes. */
+static MafwSource *get_source(const gchar *uuid)
+{
+	MafwSource *src;
+
+	if ((src = g_hash_table_lookup(Sources, uuid)))
+		return src;
+	src = MAFW_SOURCE(mafw_registry_get_extension_by_uuid(
+			mafw_registry_get_instance(), uuid));
+	if (!src)
+		return NULL;
+	g_signal_connect(src, "container-changed",
+			 G_CALLBACK(container_changed), NULL);
+	g_hash_table_insert(Sources, g_strdup(uuid), g_object_ref(src));
+	return src;
+}
+
+/* Starts browsing the page of $sm from $sm->skip.  Returns whether it
+ * could. */
+static gboolean browse_page(Smart *sm)
+{
+	MafwSource *src;
+	guint browse_id;
+
+	if (!(src = get_source(sm->uuid)))
+		return FALSE;
+	sm->browsing = TRUE;
+	sm->browse_id = MAFW_SOURCE_INVALID_BROWSE_ID;
+	browse_id = mafw_source_browse(src, sm->container, FALSE, sm->parsed,
+				       *sm->sort ? sm->sort : NULL,
+				       MAFW_SOURCE_NO_KEYS,
+				       sm->skip, SMART_PAGE,
+				       (MafwSourceBrowseResultCb)browse_cb,
+				       GUINT_TO_POINTER(sm->plid));
+	/* The source may have answered already. */
+	if (sm->browsing)
+		sm->browse_id = browse_id;
+	return TRUE;
+}
+
+/* Starts whatever browsing $sm needs next, if any. */
+static void pump(Smart *sm)
+{
+	Pls *pls;
+
+	if (sm->browsing)
+		return;
+	if (!(pls = g_tree_lookup(Playlists, GUINT_TO_POINTER(sm->plid))))
+		return;
+
+	if (sm->refreshing) {
+		if (!browse_page(sm)) {
+			sm->refreshing = FALSE;
+			sm->stale = TRUE;
+		}
+		return;
+	}
+	if (sm->stale && pls->len) {
+		/* Before browsing, in case the source answers at once. */
+		sm->skip = 0;
+		sm->stale = FALSE;
+		sm->refreshing = TRUE;
+		if (!browse_page(sm)) {
+			sm->refreshing = FALSE;
+			sm->stale = TRUE;
+		}
+		return;
+	}
+	sm->stale = FALSE;
+
+	/* Stay a page ahead of the clients. */
+	if (!sm->complete && sm->demand + SMART_PAGE >= pls->len) {
+		sm->skip = pls->len;
+		browse_page(sm);
+	}
+}
+
+/* Idle callback handing the reads noted by smart_demand() to pump(). */
+static gboolean demands_cb(gpointer unused)
+{
+	GHashTable *demands;
+	GList *plids, *l;
+
+	g_mutex_lock(&Demand_lock);
+	demands = Demands;
+	Demands = NULL;
+	Demand_handler = 0;
+	g_mutex_unlock(&Demand_lock);
+
+	plids = g_hash_table_get_keys(demands);
+	for (l = plids; l; l = l->next) {
+		Smart *sm;
+		guint want;
+
+		if (!(sm = g_hash_table_lookup(Smarts, l->data)))
+			continue;
+		want = GPOINTER_TO_UINT(g_hash_table_lookup(demands,
+							    l->data)) - 1;
+		sm->demand = MAX(sm->demand, want);
+		pump(sm);
+	}
+	g_list_free(plids);
+	g_hash_table_destroy(demands);
+	return FALSE;
+}
+
+/* MafwRegistry::source-added, fetches the pages waiting for $src. */
+static void source_added(MafwRegistry *reg, MafwSource *src,
+			 gpointer unused)
+{
+	const gchar *uuid;
+	GList *smarts, *l;
+
+	uuid = mafw_extension_get_uuid(MAFW_EXTENSION(src));
+	smarts = g_hash_table_get_values(Smarts);
+	for (l = smarts; l; l = l->next) {
+		Smart *sm = l->data;
+
+		if (!strcmp(sm->uuid, uuid))
+			pump(sm);
+	}
+	g_list_free(smarts);
+}
+
+/* MafwRegistry::source-removed, forgets $src and the pages being
+ * browsed from it. */
+static void source_removed(MafwRegistry *reg, MafwSource *src,
+			   gpointer unused)
+{
+	const gchar *uuid;
+	GList *smarts, *l;
+
+	uuid = mafw_extension_get_uuid(MAFW_EXTENSION(src));
+	if (!g_hash_table_lookup(Sources, uuid))
+		return;
+	smarts = g_hash_table_get_values(Smarts);
+	for (l = smarts; l; l = l->next) {
+		Smart *sm = l->data;
+
+		if (strcmp(sm->uuid, uuid) || !sm->browsing)
+			continue;
+		sm->browsing = FALSE;
+		sm->browse_id = MAFW_SOURCE_INVALID_BROWSE_ID;
+		sm->refreshing = FALSE;
+		sm->stale = TRUE;
+		page_clear(sm->page);
+	}
+	g_list_free(smarts);
+	g_signal_handlers_disconnect_by_func(src, container_changed, NULL);
+	g_hash_table_remove(Sources, uuid);
+}
+
+/* Returns a new Smart of $plid, or %NULL if the definition is invalid. */
+static Smart *smart_new(guint plid, const gchar *container,
+			const gchar *filter, const gchar *sort)
+{
+	MafwFilter *parsed;
+	Smart *sm;
+	gchar *uuid;
+
+	parsed = NULL;
+	if (*filter && !(parsed = mafw_filter_parse(filter)))
+		return NULL;
+	if (!mafw_source_split_objectid(container, &uuid, NULL)) {
+		if (parsed)
+			mafw_filter_free(parsed);
+		return NULL;
+	}
+
+	sm = g_new0(Smart, 1);
+	sm->plid = plid;
+	sm->container = g_strdup(container);
+	sm->filter = g_strdup(filter);
+	sm->sort = g_strdup(sort);
+	sm->parsed = parsed;
+	sm->uuid = uuid;
+	sm->browse_id = MAFW_SOURCE_INVALID_BROWSE_ID;
+	sm->page = g_ptr_array_new();
+	return sm;
+}
+
+/* Loads the definition in $fn, if it belongs to an existing playlist. */
+static void smart_load(const gchar *fn)
+{
+	GKeyFile *kf;
+	gchar *container, *filter, *sort, *path, *end;
+	Smart *sm;
+	Pls *pls;
+	guint plid;
+
+	path = g_build_filename(pls_dir(), fn, NULL);
+	plid = strtoul(fn, &end, 10);
+	if (strcmp(end, ".smart")
+	    || !(pls = g_tree_lookup(Playlists, GUINT_TO_POINTER(plid)))) {
+		/* Its playlist was never saved. */
+		g_unlink(path);
+		g_free(path);
+		return;
+	}
+
+	kf = g_key_file_new();
+	sm = NULL;
+	if (g_key_file_load_from_file(kf, path, 0, NULL)) {
+		container = g_key_file_get_string(kf, SMART_GROUP,
+						  "container", NULL);
+		filter = g_key_file_get_string(kf, SMART_GROUP,
+					       "filter", NULL);
+		sort = g_key_file_get_string(kf, SMART_GROUP, "sort", NULL);
+		if (container && filter && sort)
+			sm = smart_new(plid, container, filter, sort);
+		g_free(container);
+		g_free(filter);
+		g_free(sort);
+	}
+	g_key_file_free(kf);
+
+	if (!sm) {
+		g_warning("failed to load from: %s", fn);
+	} else {
+		sm->stale = TRUE;
+		pls->smart = TRUE;
+		g_hash_table_insert(Smarts, GUINT_TO_POINTER(plid), sm);
+	}
+	g_free(path);
+}
+
+/**
+ * smart_init:
+ *
+ * Loads the definitions of the smart playlists.  To be called after the
+ * playlists have been loaded and the registry has been set up.
+ */
+void smart_init(void)
+{
+	const gchar *fn;
+	GDir *d;
+
+	Smarts = g_hash_table_new_full(NULL, NULL, NULL,
+				       (GDestroyNotify)smart_free);
+	Sources = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+					g_object_unref);
+	g_signal_connect(mafw_registry_get_instance(), "source-added",
+			 G_CALLBACK(source_added), NULL);
+	g_signal_connect(mafw_registry_get_instance(), "source-removed",
+			 G_CALLBACK(source_removed), NULL);
+
+	if (!(d = g_dir_open(pls_dir(), 0, NULL)))
+		return;
+	while ((fn = g_dir_read_name(d)))
+		if (g_str_has_suffix(fn, ".smart"))
+			smart_load(fn);
+	g_dir_close(d);
+}
+
+/**
+ * smart_restore:
+ * @plid: id of a playlist restored from a backup
+ *
+ * Loads the definition of @plid from pls_dir(), if it has one, like
+ * smart_init() does.
+ */
+void smart_restore(guint plid)
+{
+	gchar *fn, *path;
+
+	path = smart_path(plid);
+	if (g_file_test(path, G_FILE_TEST_EXISTS)) {
+		fn = g_path_get_basename(path);
+		smart_load(fn);
+		g_free(fn);
+	}
+	g_free(path);
+}
+
+/**
+ * smart_check:
+ * @container: object id of a container
+ * @filter:    a filter string, or ""
+ * @err:       where to put the error
+ *
+ * Tells whether a smart playlist can be defined with @container and
+ * @filter.
+ */
+gboolean smart_check(const gchar *container, const gchar *filter,
+		     GError **err)
+{
+	MafwFilter *parsed;
+	gchar *uuid;
+
+	if (!mafw_source_split_objectid(container, &uuid, NULL)) {
+		g_set_error(err, MAFW_PLAYLIST_ERROR,
+			    MAFW_PLAYLIST_ERROR_NOT_SUPPORTED,
+			    "Not an object id: %s", container);
+		return FALSE;
+	}
+	g_free(uuid);
+	if (*filter) {
+		if (!(parsed = mafw_filter_parse(filter))) {
+			g_set_error(err, MAFW_PLAYLIST_ERROR,
+				    MAFW_PLAYLIST_ERROR_NOT_SUPPORTED,
+				    "Invalid filter: %s", filter);
+			return FALSE;
+		}
+		mafw_filter_free(parsed);
+	}
+	return TRUE;
+}
+
+/**
+ * smart_add:
+ * @pls:       a new, empty playlist
+ * @container: object id of the container to browse
+ * @filter:    the filter to browse with, or ""
+ * @sort:      the sort criteria to browse with, or ""
+ *
+ * Makes @pls a smart playlist and starts fetching its first page.  The
+ * definition must have passed smart_check().
+ */
+void smart_add(Pls *pls, const gchar *container, const gchar *filter,
+	       const gchar *sort)
+{
+	Smart *sm;
+
+	sm = smart_new(pls->id, container, filter, sort);
+	g_return_if_fail(sm != NULL);
+	pls->smart = TRUE;
+	g_hash_table_insert(Smarts, GUINT_TO_POINTER(pls->id), sm);
+	smart_save(sm);
+	save_me(pls);
+	pump(sm);
+}
+
+/**
+ * smart_demand:
+ * @pls: a playlist
+ * @idx: the highest index being read
+ *
+ * Notes that a client reads @pls up to @idx, so if it's a smart playlist
+ * its further pages may need fetching, or its pages refreshing.  Can be
+ * called from the workers; the fetching starts in the main loop.
+ */
+void smart_demand(Pls *pls, guint idx)
+{
+	gpointer plid, old;
+
+	if (!pls->smart)
+		return;
+	plid = GUINT_TO_POINTER(pls->id);
+	g_mutex_lock(&Demand_lock);
+	if (!Demands)
+		Demands = g_hash_table_new(NULL, NULL);
+	old = g_hash_table_lookup(Demands, plid);
+	if (GPOINTER_TO_UINT(old) < idx + 1)
+		g_hash_table_insert(Demands, plid, GUINT_TO_POINTER(idx + 1));
+	if (!Demand_handler)
+		Demand_handler = g_idle_add(demands_cb, NULL);
+	g_mutex_unlock(&Demand_lock);
+}
+
+/**
+ * smart_forget:
+ * @plid: id of a playlist being destroyed
+ *
+ * Stops maintaining @plid if it's a smart playlist and deletes its
+ * definition.
+ */
+void smart_forget(guint plid)
+{
+	Smart *sm;
+	gchar *fn;
+
+	if (!Smarts
+	    || !(sm = g_hash_table_lookup(Smarts, GUINT_TO_POINTER(plid))))
+		return;
+	if (sm->browsing && sm->browse_id != MAFW_SOURCE_INVALID_BROWSE_ID) {
+		MafwSource *src;
+
+		if ((src = g_hash_table_lookup(Sources, sm->uuid)))
+			mafw_source_cancel_browse(src, sm->browse_id, NULL);
+	}
+	fn = smart_path(plid);
+	g_unlink(fn);
+	g_free(fn);
+	g_hash_table_remove(Smarts, GUINT_TO_POINTER(plid));
+}
+
+/* vi: set noexpandtab ts=8 sw=8 cino=t0,(0: */
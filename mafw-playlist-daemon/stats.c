@@ -0,0 +1,317 @@
+/*
+ * This file is a part of MAFW
+ *
+ * Copyright (C) 2007, 2008, 2009 Nokia Corporation, all rights reserved.
+ *
+ * Contact: Visa Smolander <visa.smolander@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+#include <string.h>
+#include <glib.h>
+#include <dbus/dbus.h>
+
+#include "common/mafw-dbus.h"
+#include "common/dbus-interface.h"
+#include "mpd-internal.h"
+
+/*
+ * Runtime statistics, served on %MAFW_PLAYLIST_STATS_INTERFACE.  Only
+ * counters are kept, everything else is computed when asked, so it's
+ * cheap enough to be always on.  The report is a flat dictionary of
+ * "dotted.key" => number, see mafw-playlist-stats.
+ */
+
+/* Upper limits of the latency histogram buckets, in microseconds. */
+static const struct {
+	gint64 below;
+	const gchar *name;
+} Buckets[] = {
+	{ 10,		"lt10us"  },
+	{ 100,		"lt100us" },
+	{ 1000,		"lt1ms"   },
+	{ 10000,	"lt10ms"  },
+	{ 100000,	"lt100ms" },
+	{ G_MAXINT64,	"ge100ms" },
+};
+
+/*
+ * Statistics of a request method.
+ *
+ * @calls: number of requests handled
+ * @usec:  total time spent handling them
+ * @hist:  number of requests by handling time, see $Buckets
+ */
+typedef struct {
+	guint64 calls;
+	guint64 usec;
+	guint64 hist[G_N_ELEMENTS(Buckets)];
+} MethodStats;
+
+/* Workers update the statistics too. */
+G_LOCK_DEFINE_STATIC(Methods);
+/* Member name => MethodStats */
+static GHashTable *Methods;
+/* Member name => number of the signals sent */
+static GHashTable *Signals;
+
+static guint64 Imports, Imports_failed, Import_entries, Import_usec;
+
+/**
+ * stats_request:
+ * @member: the method called, %NULL if it was not understood
+ * @usec:   how long it took to handle the request
+ *
+ * Records a request.  The requests not understood are counted together
+ * as "unknown", so that clients can't grow the table at will.
+ * Thread-safe.
+ */
+void stats_request(const gchar *member, gint64 usec)
+{
+	MethodStats *ms;
+	guint i;
+
+	if (!member)
+		member = "unknown";
+	G_LOCK(Methods);
+	if (!Methods)
+		Methods = g_hash_table_new_full(g_str_hash, g_str_equal,
+						g_free, g_free);
+	if (!(ms = g_hash_table_lookup(Methods, member))) {
+		ms = g_new0(MethodStats, 1);
+		g_hash_table_insert(Methods, g_strdup(member), ms);
+	}
+	ms->calls++;
+	ms->usec += usec;
+	for (i = 0; usec >= Buckets[i].below; i++)
+		;
+	ms->hist[i]++;
+	G_UNLOCK(Methods);
+}
+
+/**
+ * stats_signal:
+ * @member: the signal sent
+ *
+ * Records a signal.  Thread-safe.
+ */
+void stats_signal(const gchar *member)
+{
+	guint64 n;
+
+	G_LOCK(Methods);
+	if (!Signals)
+		Signals = g_hash_table_new_full(g_str_hash, g_str_equal,
+						g_free, NULL);
+	n = GPOINTER_TO_SIZE(g_hash_table_lookup(Signals, member));
+	g_hash_table_insert(Signals, g_strdup(member),
+			    GSIZE_TO_POINTER(n + 1));
+	G_UNLOCK(Methods);
+}
+
+/**
+ * stats_import:
+ * @entries: number of entries imported
+ * @usec:    how long the import took
+ * @ok:      whether it succeeded
+ *
+ * Records a finished import.
+ */
+void stats_import(guint entries, gint64 usec, gboolean ok)
+{
+	Imports++;
+	if (!ok)
+		Imports_failed++;
+	Import_entries += entries;
+	Import_usec += usec;
+}
+
+/* Appends a "$key" => $val entry to the dictionary at $iary. */
+static void add(DBusMessageIter *iary, const gchar *key, guint64 val)
+{
+	DBusMessageIter ient;
+	dbus_uint64_t v;
+
+	v = val;
+	dbus_message_iter_open_container(iary, DBUS_TYPE_DICT_ENTRY,
+					 NULL, &ient);
+	dbus_message_iter_append_basic(&ient, DBUS_TYPE_STRING, &key);
+	dbus_message_iter_append_basic(&ient, DBUS_TYPE_UINT64, &v);
+	dbus_message_iter_close_container(iary, &ient);
+}
+
+/* Like add(), but the key is printf()-formatted. */
+static void addf(DBusMessageIter *iary, guint64 val, const gchar *fmt, ...)
+	G_GNUC_PRINTF(3, 4);
+static void addf(DBusMessageIter *iary, guint64 val, const gchar *fmt, ...)
+{
+	va_list args;
+	gchar *key;
+
+	va_start(args, fmt);
+	key = g_strdup_vprintf(fmt, args);
+	va_end(args);
+	add(iary, key, val);
+	g_free(key);
+}
+
+static void add_method(const gchar *member, const MethodStats *ms,
+		       DBusMessageIter *iary)
+{
+	guint i;
+
+	addf(iary, ms->calls, "method.%s.calls", member);
+	addf(iary, ms->usec, "method.%s.usec", member);
+	for (i = 0; i < G_N_ELEMENTS(Buckets); i++)
+		addf(iary, ms->hist[i], "method.%s.%s", member,
+		     Buckets[i].name);
+}
+
+static void add_signal(const gchar *member, gpointer n,
+		       DBusMessageIter *iary)
+{
+	addf(iary, GPOINTER_TO_SIZE(n), "signal.%s", member);
+}
+
+/* Tree traversal callback adding the sizes of $pls. */
+static gboolean add_playlist(gpointer id, Pls *pls, gpointer *args)
+{
+	DBusMessageIter *iary = args[0];
+	guint *ndirty = args[1];
+	guint *npacked = args[2];
+	guint64 *saved = args[3];
+	gsize slot;
+
+	/* Every allocated item has a vidx slot unless the playlist is
+	 * paged out, and a pidx and an iidx one if it is shuffled. */
+	slot = pls->pages ? 0 : sizeof(*pls->vidx);
+	if (pls->shuffled)
+		slot += sizeof(*pls->pidx) + sizeof(*pls->iidx);
+	addf(iary, pls->len, "playlist.%u.len", pls->id);
+	addf(iary, pls->alloc, "playlist.%u.alloc", pls->id);
+	addf(iary, (pls->alloc - pls->len) * slot,
+	     "playlist.%u.waste", pls->id);
+	addf(iary, pls->bytes, "playlist.%u.bytes", pls->id);
+	addf(iary, pls->packed_len, "playlist.%u.packed", pls->id);
+	addf(iary, pls->pages ? pages_count(pls->pages) : 0,
+	     "playlist.%u.pages", pls->id);
+	if (pls->dirty)
+		(*ndirty)++;
+	if (pls->packed) {
+		(*npacked)++;
+		*saved += pls_pack_savings(pls);
+	}
+	return FALSE;
+}
+
+/* Builds the reply to get_stats. */
+static DBusMessage *report(DBusMessage *req)
+{
+	DBusMessage *reply;
+	DBusMessageIter imsg, iary;
+	const DispatchStats *ds;
+	static const gchar *const classes[] = {
+		"interactive", "normal", "bulk",
+	};
+	ColdStats cs;
+	PagesStats ps;
+	gpointer args[4];
+	guint ndirty, npacked, i;
+	guint64 saved;
+
+	reply = mafw_dbus_reply(req);
+	dbus_message_iter_init_append(reply, &imsg);
+	dbus_message_iter_open_container(&imsg, DBUS_TYPE_ARRAY, "{st}",
+					 &iary);
+
+	G_LOCK(Methods);
+	if (Methods)
+		g_hash_table_foreach(Methods, (GHFunc)add_method, &iary);
+	if (Signals)
+		g_hash_table_foreach(Signals, (GHFunc)add_signal, &iary);
+	G_UNLOCK(Methods);
+
+	for (i = 0; i < DISPATCH_NCLASSES; i++) {
+		ds = dispatch_get_stats(i);
+		addf(&iary, ds->handled, "dispatch.%s.handled", classes[i]);
+		addf(&iary, ds->deferred, "dispatch.%s.deferred", classes[i]);
+		addf(&iary, ds->total_delay, "dispatch.%s.delay_usec",
+		     classes[i]);
+		addf(&iary, ds->max_delay, "dispatch.%s.max_delay_usec",
+		     classes[i]);
+	}
+
+	ndirty = npacked = 0;
+	saved = 0;
+	args[0] = &iary;
+	args[1] = &ndirty;
+	args[2] = &npacked;
+	args[3] = &saved;
+	/* Workers may be unpacking playlists. */
+	playlists_lock();
+	g_tree_foreach(Playlists, (GTraverseFunc)add_playlist, args);
+	playlists_unlock();
+	add(&iary, "playlists", g_tree_nnodes(Playlists));
+	add(&iary, "save.dirty", ndirty);
+	add(&iary, "save.count", Save_stats.saves);
+	add(&iary, "save.failed", Save_stats.failures);
+	add(&iary, "save.bytes", Save_stats.bytes);
+	add(&iary, "save.fsync_usec", Save_stats.fsync_usec);
+	add(&iary, "save.fsync_max_usec", Save_stats.fsync_max_usec);
+
+	cold_get_stats(&cs);
+	add(&iary, "cold.packed", npacked);
+	add(&iary, "cold.bytes_saved", saved);
+	add(&iary, "cold.packs", cs.packs);
+	add(&iary, "cold.unpacks", cs.unpacks);
+	add(&iary, "cold.unpack_usec", cs.unpack_usec);
+	add(&iary, "cold.unpack_max_usec", cs.unpack_max_usec);
+
+	pages_get_stats(&ps);
+	add(&iary, "pages.resident", ps.resident);
+	add(&iary, "pages.faults", ps.faults);
+	add(&iary, "pages.writebacks", ps.writebacks);
+	add(&iary, "pages.compactions", ps.compactions);
+
+	add(&iary, "import.count", Imports);
+	add(&iary, "import.failed", Imports_failed);
+	add(&iary, "import.entries", Import_entries);
+	add(&iary, "import.usec", Import_usec);
+
+	dbus_message_iter_close_container(&imsg, &iary);
+	return reply;
+}
+
+/**
+ * stats_handle:
+ *
+ * Handles a request to %MAFW_PLAYLIST_STATS_INTERFACE.  Called in the
+ * main thread.
+ */
+DBusHandlerResult stats_handle(DBusConnection *con, DBusMessage *msg)
+{
+	if (dbus_message_get_type(msg) != DBUS_MESSAGE_TYPE_METHOD_CALL
+	    || !dbus_message_has_member(msg, MAFW_PLAYLIST_STATS_METHOD_GET))
+		return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+	mafw_dbus_send(con, report(msg));
+	return DBUS_HANDLER_RESULT_HANDLED;
+}
+
+/* vi: set noexpandtab ts=8 sw=8 cino=t0,(0: */
@@ -0,0 +1,290 @@
+/*
+ * This file is a part of MAFW
+ *
+ * Copyright (C) 2007, 2008, 2009 Nokia Corporation, all rights reserved.
+ *
+ * Contact: Visa Smolander <visa.smolander@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+#include <string.h>
+#include <glib.h>
+#include <dbus/dbus.h>
+
+#include <libmafw/mafw-errors.h>
+
+#include "common/mafw-dbus.h"
+#include "common/mafw-session.h"
+#include "common/dbus-interface.h"
+#include "mpd-internal.h"
+
+/*
+ * Window subscriptions.  A client showing a part of a big playlist can
+ * subscribe to that part, its window, with set_window, and then it's
+ * told only about the changes affecting the window, with the new
+ * object ids included.  Insertions and removals above the window make
+ * it follow its items, which is reported with a single window_shifted
+ * signal.  These signals are unicast; the usual broadcast signals are
+ * sent anyway.
+ *
+ * A client has at most one window per playlist.  All of this happens
+ * in the main thread.
+ */
+
+/*
+ * @client: unique bus name of the subscriber
+ * @plid:   the playlist
+ * @first:  visual index of the first item of the window
+ * @count:  size of the window
+ */
+typedef struct {
+	gchar *client;
+	guint plid;
+	guint first;
+	guint count;
+} Window;
+
+static DBusConnection *Connection;
+/* Playlist id => GSList of Window:s */
+static GHashTable *Windows;
+/* Session registry subsystem of the subscribers. */
+static guint Subscribers;
+
+static void window_free(Window *win)
+{
+	g_free(win->client);
+	g_free(win);
+}
+
+/* Unlinks and frees $win. */
+static void unsubscribe(Window *win)
+{
+	GSList *wins;
+
+	wins = g_hash_table_lookup(Windows, GUINT_TO_POINTER(win->plid));
+	wins = g_slist_remove(wins, win);
+	if (wins)
+		g_hash_table_insert(Windows, GUINT_TO_POINTER(win->plid),
+				    wins);
+	else
+		g_hash_table_remove(Windows, GUINT_TO_POINTER(win->plid));
+	window_free(win);
+}
+
+/* Called when the subscriber of $win leaves the bus. */
+static void subscriber_vanished(const gchar *client, Window *win,
+				guint count, gpointer unused)
+{
+	unsubscribe(win);
+}
+
+/* Returns the index after $win, or G_MAXUINT if it reaches beyond. */
+static guint window_end(const Window *win)
+{
+	return win->count > G_MAXUINT - win->first
+		? G_MAXUINT : win->first + win->count;
+}
+
+/* Sends the window signal $member with the following arguments to the
+ * subscriber of $win. */
+#define window_signal(win, member, ...)					\
+	do {								\
+		gchar *__path;						\
+									\
+		__path = g_strdup_printf("%s/%u", MAFW_PLAYLIST_PATH,	\
+					 (win)->plid);			\
+		stats_signal(member);					\
+		mafw_dbus_send(Connection, mafw_dbus_signal_full(	\
+				(win)->client, __path,			\
+				MAFW_PLAYLIST_INTERFACE, member,	\
+				__VA_ARGS__));				\
+		g_free(__path);						\
+	} while (0)
+
+/* Tells the subscriber of $win that $count items from $at on have
+ * changed.  $at and $count must be within $win. */
+static void send_changed(Window *win, Pls *pls, guint at, guint count)
+{
+	gchar **oids;
+	guint n;
+
+	n = at < pls->len ? MIN(count, pls->len - at) : 0;
+	oids = n ? pls_get_items(pls, at, at + n - 1) : NULL;
+	window_signal(win, MAFW_PLAYLIST_WINDOW_CHANGED,
+		      MAFW_DBUS_UINT32(at), MAFW_DBUS_UINT32(count),
+		      DBUS_TYPE_ARRAY, DBUS_TYPE_STRING, oids, n);
+	if (oids)
+		pls_items_free(pls, oids);
+}
+
+/**
+ * window_set:
+ * @con:    the connection to send the window signals on
+ * @client: unique bus name of the subscriber
+ * @pls:    the playlist
+ * @first:  visual index of the first item of the window
+ * @count:  size of the window, 0 to unsubscribe
+ *
+ * Subscribes @client to the changes of the given part of @pls, or
+ * updates its existing subscription.
+ */
+void window_set(DBusConnection *con, const gchar *client, Pls *pls,
+		guint first, guint count)
+{
+	GSList *wins, *l;
+	Window *win;
+
+	Connection = con;
+	if (!Windows) {
+		Windows = g_hash_table_new(NULL, NULL);
+		Subscribers = mafw_session_add_subsystem(
+			(MafwSessionVanishedFunc)subscriber_vanished, NULL);
+	}
+
+	win = NULL;
+	wins = g_hash_table_lookup(Windows, GUINT_TO_POINTER(pls->id));
+	for (l = wins; l; l = l->next)
+		if (!strcmp(((Window *)l->data)->client, client)) {
+			win = l->data;
+			break;
+		}
+
+	if (!count) {
+		if (win) {
+			mafw_session_release(Subscribers, client, win);
+			unsubscribe(win);
+		}
+		return;
+	}
+	if (!win) {
+		win = g_new0(Window, 1);
+		win->client = g_strdup(client);
+		win->plid = pls->id;
+		g_hash_table_insert(Windows, GUINT_TO_POINTER(pls->id),
+				    g_slist_prepend(wins, win));
+		mafw_session_hold(Subscribers, client, win);
+	}
+	win->first = first;
+	win->count = count;
+}
+
+/**
+ * window_forget:
+ * @plid: id of a playlist being destroyed
+ *
+ * Drops the subscriptions to @plid.
+ */
+void window_forget(guint plid)
+{
+	GSList *wins, *l;
+
+	if (!Windows)
+		return;
+	wins = g_hash_table_lookup(Windows, GUINT_TO_POINTER(plid));
+	g_hash_table_remove(Windows, GUINT_TO_POINTER(plid));
+	for (l = wins; l; l = l->next) {
+		mafw_session_forget(Subscribers, l->data);
+		window_free(l->data);
+	}
+	g_slist_free(wins);
+}
+
+/**
+ * window_contents_changed:
+ * @plid:     the playlist changed
+ * @from:     the first index changed
+ * @nremove:  number of items removed from @from
+ * @nreplace: number of items inserted in their place
+ *
+ * Notifies the subscribers whose window is affected by the change.
+ * To be called after the playlist has been changed.
+ */
+void window_contents_changed(guint plid, guint from,
+			     guint nremove, guint nreplace)
+{
+	GSList *l;
+	Pls *pls;
+
+	if (!Windows
+	    || !(l = g_hash_table_lookup(Windows, GUINT_TO_POINTER(plid)))
+	    || !(pls = g_tree_lookup(Playlists, GUINT_TO_POINTER(plid))))
+		return;
+
+	for (; l; l = l->next) {
+		Window *win = l->data;
+		guint end, at;
+
+		end = window_end(win);
+		if (from >= end)
+			continue;
+		if (from + nremove <= win->first) {
+			/* Everything removed was above the window, which
+			 * follows its items. */
+			if (nremove == nreplace)
+				continue;
+			win->first = win->first - nremove + nreplace;
+			window_signal(win, MAFW_PLAYLIST_WINDOW_SHIFTED,
+				      MAFW_DBUS_UINT32(win->first));
+			continue;
+		}
+
+		/* The window stays in place.  If the length has changed,
+		 * everything after $from has moved. */
+		at = MAX(from, win->first);
+		if (nremove == nreplace)
+			end = MIN(end, from + nreplace);
+		send_changed(win, pls, at, end - at);
+	}
+}
+
+/**
+ * window_item_moved:
+ * @plid: the playlist changed
+ * @from: the original index of the item moved
+ * @to:   its new index
+ *
+ * Like window_contents_changed(), but for a move.
+ */
+void window_item_moved(guint plid, guint from, guint to)
+{
+	GSList *l;
+	Pls *pls;
+	guint lo, hi;
+
+	if (!Windows
+	    || !(l = g_hash_table_lookup(Windows, GUINT_TO_POINTER(plid)))
+	    || !(pls = g_tree_lookup(Playlists, GUINT_TO_POINTER(plid))))
+		return;
+
+	/* Items between $from and $to (inclusive) have moved. */
+	lo = MIN(from, to);
+	hi = MAX(from, to) + 1;
+	for (; l; l = l->next) {
+		Window *win = l->data;
+		guint at, end;
+
+		at = MAX(lo, win->first);
+		end = MIN(hi, window_end(win));
+		if (at < end)
+			send_changed(win, pls, at, end - at);
+	}
+}
+
+/* vi: set noexpandtab ts=8 sw=8 cino=t0,(0: */
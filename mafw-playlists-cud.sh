@@ -1,5 +1,20 @@
 #!/bin/sh
 
+# Restoring an empty backup clears the playlists of the running daemon.
+empty=`mktemp -d` || exit 1
+chmod 755 "$empty"
+if [ -f /tmp/session_bus_address.user ]; then
+	. /tmp/session_bus_address.user
+fi
+if su user -c "dbus-send --session --print-reply --reply-timeout=600000 \
+	--dest=com.nokia.mafw.playlist /com/nokia/mafw/playlist \
+	com.nokia.mafw.playlist.restore_from string:$empty" > /dev/null 2>&1
+then
+	rmdir "$empty"
+	exit 0
+fi
+rmdir "$empty"
+
 # stop the playlist daemon
 /usr/sbin/dsmetool -U user -k /usr/bin/mafw-playlist-daemon
 
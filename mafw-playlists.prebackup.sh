@@ -1,5 +1,14 @@
 #!/bin/sh
 
+# Ask the running daemon for a consistent copy, so playback goes on;
+# copy the files if it can't be reached.
+if [ -f /tmp/session_bus_address.user ]; then
+	. /tmp/session_bus_address.user
+fi
+su user -c "dbus-send --session --print-reply --reply-timeout=600000 \
+	--dest=com.nokia.mafw.playlist /com/nokia/mafw/playlist \
+	com.nokia.mafw.playlist.backup_to \
+	string:/home/user/.mafw-playlists.backup" > /dev/null 2>&1 && exit 0
+
 rm -r /home/user/.mafw-playlists.backup
 cp -R /home/user/.mafw-playlists /home/user/.mafw-playlists.backup
-
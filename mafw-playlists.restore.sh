@@ -1,6 +1,19 @@
 #!/bin/sh
 
 if [ -e /home/user/.mafw-playlists.backup ] ; then
+	if [ -f /tmp/session_bus_address.user ]; then
+		. /tmp/session_bus_address.user
+	fi
+	# Let the daemon replace its playlists without restarting.
+	if su user -c "dbus-send --session --print-reply \
+		--reply-timeout=600000 \
+		--dest=com.nokia.mafw.playlist /com/nokia/mafw/playlist \
+		com.nokia.mafw.playlist.restore_from \
+		string:/home/user/.mafw-playlists.backup" > /dev/null 2>&1
+	then
+		rm -r /home/user/.mafw-playlists.backup
+		exit 0
+	fi
 	/usr/sbin/dsmetool -U user -k /usr/bin/mafw-playlist-daemon
 	rm -r /home/user/.mafw-playlists
 	mv /home/user/.mafw-playlists.backup /home/user/.mafw-playlists
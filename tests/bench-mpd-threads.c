@@ -0,0 +1,160 @@
+/*
+ * This file is a part of MAFW
+ *
+ * Copyright (C) 2007, 2008, 2009 Nokia Corporation, all rights reserved.
+ *
+ * Contact: Visa Smolander <visa.smolander@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+/*
+ * Measures how the throughput of reading requests to a running playlist
+ * daemon scales with the number of clients.  Start the daemon with
+ * "mafw-playlist-daemon -f" for the single-threaded baseline, or with
+ * "mafw-playlist-daemon -f -j N" to handle them in N worker threads.
+ *
+ * Usage: bench-mpd-threads [clients] [requests-per-client]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <glib.h>
+#include <dbus/dbus.h>
+#include <libmafw/mafw-errors.h>
+
+#include "common/dbus-interface.h"
+#include "common/mafw-dbus.h"
+
+#define NAME		"bench-mpd-threads"
+#define NITEMS		1000
+#define PAGE		100
+
+static gchar *Path;
+static guint Nrequests;
+
+/* Sends $msg and returns the reply, failing on error. */
+static DBusMessage *call(DBusConnection *con, DBusMessage *msg)
+{
+	DBusMessage *reply;
+	GError *err = NULL;
+
+	reply = mafw_dbus_call(con, msg, MAFW_PLAYLIST_ERROR, &err);
+	if (!reply)
+		g_error("%s", err->message);
+	return reply;
+}
+
+/* Thread function of a client: reads pages of the playlist. */
+static gpointer client(gpointer unused)
+{
+	DBusConnection *con;
+	DBusError dbe;
+	guint i;
+
+	dbus_error_init(&dbe);
+	con = dbus_bus_get_private(DBUS_BUS_SESSION, &dbe);
+	if (!con)
+		g_error("dbus_bus_get_private: %s", dbe.message);
+	for (i = 0; i < Nrequests; i++) {
+		guint from;
+
+		from = (i * PAGE) % NITEMS;
+		dbus_message_unref(call(con, mafw_dbus_method_full(
+			MAFW_PLAYLIST_SERVICE, Path, MAFW_PLAYLIST_INTERFACE,
+			MAFW_PLAYLIST_METHOD_GET_ITEMS,
+			MAFW_DBUS_UINT32(from),
+			MAFW_DBUS_UINT32(from + PAGE - 1))));
+	}
+	dbus_connection_close(con);
+	dbus_connection_unref(con);
+	return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+	DBusConnection *con;
+	DBusMessage *reply;
+	DBusError dbe;
+	GThread **clients;
+	GTimer *timer;
+	gchar **oids;
+	guint nclients, plid, i;
+	gdouble elapsed;
+
+	nclients = argc > 1 ? atoi(argv[1]) : 4;
+	Nrequests = argc > 2 ? atoi(argv[2]) : 2000;
+	if (!nclients || !Nrequests) {
+		printf("usage: %s [clients] [requests-per-client]\n", argv[0]);
+		return 1;
+	}
+
+	dbus_threads_init_default();
+	dbus_error_init(&dbe);
+	con = dbus_bus_get(DBUS_BUS_SESSION, &dbe);
+	if (!con)
+		g_error("dbus_bus_get: %s", dbe.message);
+
+	/* Set up a playlist of NITEMS. */
+	reply = call(con, mafw_dbus_method_full(
+			MAFW_PLAYLIST_SERVICE, MAFW_PLAYLIST_PATH,
+			MAFW_PLAYLIST_INTERFACE,
+			MAFW_PLAYLIST_METHOD_CREATE_PLAYLIST,
+			MAFW_DBUS_STRING(NAME)));
+	mafw_dbus_parse(reply, DBUS_TYPE_UINT32, &plid);
+	dbus_message_unref(reply);
+	Path = g_strdup_printf(MAFW_PLAYLIST_PATH "/%u", plid);
+
+	oids = g_new0(gchar *, NITEMS + 1);
+	for (i = 0; i < NITEMS; i++)
+		oids[i] = g_strdup_printf("mocksource::bench-item-%u", i);
+	dbus_message_unref(call(con, mafw_dbus_method_full(
+			MAFW_PLAYLIST_SERVICE, Path, MAFW_PLAYLIST_INTERFACE,
+			MAFW_PLAYLIST_METHOD_CLEAR)));
+	dbus_message_unref(call(con, mafw_dbus_method_full(
+			MAFW_PLAYLIST_SERVICE, Path, MAFW_PLAYLIST_INTERFACE,
+			MAFW_PLAYLIST_METHOD_APPEND_ITEM,
+			MAFW_DBUS_STRVZ(oids))));
+	g_strfreev(oids);
+
+	/* Hammer it. */
+	clients = g_new(GThread *, nclients);
+	timer = g_timer_new();
+	for (i = 0; i < nclients; i++)
+		clients[i] = g_thread_new(NAME, client, NULL);
+	for (i = 0; i < nclients; i++)
+		g_thread_join(clients[i]);
+	elapsed = g_timer_elapsed(timer, NULL);
+	printf("%u clients x %u get_items of %u: %.3fs, %.0f requests/s\n",
+	       nclients, Nrequests, PAGE, elapsed,
+	       nclients * Nrequests / elapsed);
+
+	/* There is no reply to this. */
+	mafw_dbus_send(con, mafw_dbus_method_full(
+			MAFW_PLAYLIST_SERVICE, MAFW_PLAYLIST_PATH,
+			MAFW_PLAYLIST_INTERFACE,
+			MAFW_PLAYLIST_METHOD_DESTROY_PLAYLIST,
+			MAFW_DBUS_UINT32(plid)));
+	dbus_connection_flush(con);
+	g_timer_destroy(timer);
+	g_free(clients);
+	g_free(Path);
+	return 0;
+}
+
+/* vi: set noexpandtab ts=8 sw=8 cino=t0,(0: */
@@ -0,0 +1,132 @@
+/*
+ * This file is a part of MAFW
+ *
+ * Copyright (C) 2007, 2008, 2009 Nokia Corporation, all rights reserved.
+ *
+ * Contact: Visa Smolander <visa.smolander@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+/*
+ * Compares the speed of the native M3U parser of the playlist daemon
+ * with totem-pl-parser, and checks that they produce the same object
+ * ids.  Usage: bench-plparse [number-of-entries]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <libmafw/mafw-source.h>
+#include <totem-pl-parser.h>
+
+#include "../mafw-playlist-daemon/mpd-internal.h"
+
+static void native_entry(const gchar *uri, GPtrArray *oids)
+{
+	g_ptr_array_add(oids, mafw_source_create_objectid(uri));
+}
+
+static void totem_entry(TotemPlParser *parser, const gchar *uri,
+			gpointer metadata, GPtrArray *oids)
+{
+	g_ptr_array_add(oids, mafw_source_create_objectid(uri));
+}
+
+static gdouble run_native(const gchar *uri, GPtrArray *oids)
+{
+	GTimer *timer;
+	Plparse *p;
+	gdouble elapsed;
+
+	timer = g_timer_new();
+	p = plparse_open(uri, NULL);
+	g_assert(p);
+	while (plparse_read(p, 256, (PlparseEntryFunc)native_entry, oids,
+			    NULL))
+		/* until EOF */;
+	plparse_close(p);
+	elapsed = g_timer_elapsed(timer, NULL);
+	g_timer_destroy(timer);
+	return elapsed;
+}
+
+static gdouble run_totem(const gchar *uri, GPtrArray *oids)
+{
+	GTimer *timer;
+	TotemPlParser *parser;
+	gdouble elapsed;
+
+	timer = g_timer_new();
+	parser = totem_pl_parser_new();
+	g_object_set(parser, "recurse", FALSE, "disable-unsafe", TRUE, NULL);
+	g_signal_connect(parser, "entry-parsed", G_CALLBACK(totem_entry),
+			 oids);
+	totem_pl_parser_parse_with_base(parser, uri, NULL, FALSE);
+	g_object_unref(parser);
+	elapsed = g_timer_elapsed(timer, NULL);
+	g_timer_destroy(timer);
+	return elapsed;
+}
+
+int main(int argc, char *argv[])
+{
+	GPtrArray *noids, *toids;
+	GString *contents;
+	gchar *fname, *uri;
+	gdouble tnative, ttotem;
+	guint n, i, diffs;
+
+	g_type_init();
+	n = argc > 1 ? atoi(argv[1]) : 50000;
+
+	contents = g_string_new("#EXTM3U\n");
+	for (i = 0; i < n; i++)
+		g_string_append_printf(contents,
+				       "#EXTINF:%u,Artist %u - Title %u\n"
+				       "%s/music/album %u/track %u.mp3\n",
+				       i, i / 10, i, i % 2 ? "" : "..",
+				       i / 10, i);
+	fname = g_build_filename(g_get_tmp_dir(), "bench-plparse.m3u", NULL);
+	g_file_set_contents(fname, contents->str, contents->len, NULL);
+	g_string_free(contents, TRUE);
+	uri = g_filename_to_uri(fname, NULL, NULL);
+
+	noids = g_ptr_array_new();
+	toids = g_ptr_array_new();
+	tnative = run_native(uri, noids);
+	ttotem = run_totem(uri, toids);
+
+	diffs = 0;
+	for (i = 0; i < MIN(noids->len, toids->len); i++)
+		if (strcmp(noids->pdata[i], toids->pdata[i]))
+			diffs++;
+	printf("entries: native %u, totem-pl-parser %u, differing %u\n",
+	       noids->len, toids->len, diffs);
+	printf("native:          %.3f s\n", tnative);
+	printf("totem-pl-parser: %.3f s\n", ttotem);
+
+	g_unlink(fname);
+	g_free(fname);
+	g_free(uri);
+	return noids->len != toids->len || diffs;
+}
+
+/* vi: set noexpandtab ts=8 sw=8 cino=t0,(0: */
@@ -164,6 +164,9 @@ static GQueue Expected_messages = G_QUEUE_INIT;
 static GQueue Replies = G_QUEUE_INIT;
 /* Incoming messages. */
 static GQueue Incoming_messages = G_QUEUE_INIT;
+/* The next message sent is to be kept in $Captured instead of checked. */
+static gboolean Capturing;
+static DBusMessage *Captured;
 
 /* The handler function, its data and free func,
  * as set by dbus_connection_add_filter. */
@@ -230,6 +233,10 @@ void mockbus_reset(void)
 	g_queue_clear(&Replies);
 	g_queue_foreach(&Incoming_messages, (GFunc)dbus_message_unref, NULL);
 	g_queue_clear(&Incoming_messages);
+	Capturing = FALSE;
+	if (Captured)
+		dbus_message_unref(Captured);
+	Captured = NULL;
 
 	for (t = Handlers; t; t = t->next) {
 		MockbusHandler *h = (MockbusHandler *)t->data;
@@ -278,6 +285,7 @@ void mockbus_finish(void)
 	}
 	ck_assert_msg(!stored_notify.pending,
 		      "A reply was not set, but async method sent");
+	ck_assert_msg(!Capturing, "MOCKBUS: nothing was sent to capture");
 }
 
 /*
@@ -296,6 +304,29 @@ void mockbus_expect(DBusMessage *msg)
 	g_queue_push_tail(&Expected_messages, msg);
 }
 
+/*
+ * Makes the next message sent be kept for mockbus_captured() rather than
+ * checked against the expectations, for messages whose contents can't be
+ * told in advance.
+ */
+void mockbus_capture(void)
+{
+	Capturing = TRUE;
+}
+
+/*
+ * Returns the message kept after mockbus_capture(), to be unref'd, or
+ * %NULL if none has been sent since.
+ */
+DBusMessage *mockbus_captured(void)
+{
+	DBusMessage *msg;
+
+	msg = Captured;
+	Captured = NULL;
+	return msg;
+}
+
 /*
  * Inserts @msg into the incoming queue, dispatched to filters.
  */
@@ -517,6 +548,11 @@ static void ckmsg(DBusMessage *m)
 {
 	DBusMessage *emsg;
 
+	if (Capturing) {
+		Capturing = FALSE;
+		Captured = dbus_message_ref(m);
+		return;
+	}
  	emsg = g_queue_pop_head(&Expected_messages);
 
 	ck_assert_msg(emsg != NULL, "MOCKBUS: this message was unexpected: %s",
@@ -713,6 +749,27 @@ void dbus_connection_close(DBusConnection *connection)
 		    "MOCKBUS: invalid connection");
 }
 
+/* The mock bus cannot pass file descriptors, so the proxies won't try to
+ * map playlist mirrors. */
+dbus_bool_t dbus_connection_can_send_type(DBusConnection *connection,
+					  int type)
+{
+	ck_assert_msg(connection == Mockbus_conn || connection == Mockbus_bus,
+		    "MOCKBUS: invalid connection");
+	return FALSE;
+}
+
+/* Messages are `received' by mockbus_incoming() and dispatched by
+ * mockbus_deliver(). */
+DBusDispatchStatus dbus_connection_get_dispatch_status(
+						DBusConnection *connection)
+{
+	ck_assert_msg(connection == Mockbus_conn || connection == Mockbus_bus,
+		    "MOCKBUS: invalid connection");
+	return g_queue_is_empty(&Incoming_messages)
+		? DBUS_DISPATCH_COMPLETE : DBUS_DISPATCH_DATA_REMAINS;
+}
+
 dbus_bool_t dbus_connection_send(DBusConnection *connection,
 				 DBusMessage *message,
 				 dbus_uint32_t *client_serial)
@@ -990,8 +1047,26 @@ dbus_uint32_t dbus_message_get_serial(DBusMessage *message)
 }
 
 const char *msg_sender_id = ":1.103";
+/* Data slot of the sender set by mockbus_set_sender(). */
+static dbus_int32_t Sender_slot = -1;
+
+/*
+ * Makes @msg come from @sender rather than $msg_sender_id, for tests
+ * with more than one client.
+ */
+void mockbus_set_sender(DBusMessage *msg, const gchar *sender)
+{
+	if (Sender_slot == -1)
+		dbus_message_allocate_data_slot(&Sender_slot);
+	dbus_message_set_data(msg, Sender_slot, g_strdup(sender), g_free);
+}
 
 const char *dbus_message_get_sender(DBusMessage *message)
 {
+	const char *sender;
+
+	if (Sender_slot != -1
+	    && (sender = dbus_message_get_data(message, Sender_slot)))
+		return sender;
 	return msg_sender_id;
 }
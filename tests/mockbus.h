@@ -39,6 +39,9 @@ extern gboolean mockbus_deliver(DBusConnection *conn);
 extern void mockbus_finish(void);
 extern void mockbus_error(GQuark domain, guint code, const gchar *message);
 extern void mockbus_send_stored_reply(void);
+extern void mockbus_set_sender(DBusMessage *msg, const gchar *sender);
+extern void mockbus_capture(void);
+extern DBusMessage *mockbus_captured(void);
 
 /*
  * Similar to mafw_dbus_reply().
@@ -59,7 +59,25 @@ static guint browse(MafwSource* self,
 {
 	MockedSource* ms = MOCKED_SOURCE(self);
 
-	if (callback != NULL)
+	ms->browse_skip = skip_count;
+	if (callback != NULL && ms->items)
+	{
+		guint i, n;
+
+		n = skip_count < ms->items->len
+			? MIN(item_count, ms->items->len - skip_count) : 0;
+		ms->browse_called++;
+		if (!n)
+			callback(self, 1408, 0, 0, NULL, NULL, user_data,
+				 NULL);
+		for (i = 0; i < n; i++)
+			callback(self, 1408, n - i - 1, skip_count + i,
+				 ms->items->pdata[skip_count + i], NULL,
+				 user_data, NULL);
+		quit_main_loop(self, G_STRFUNC);
+		return 1408;
+	}
+	else if (callback != NULL)
 	{
 		GHashTable* md = mafw_metadata_new();
 		mafw_metadata_add_str(md, "title", "Easy");
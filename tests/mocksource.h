@@ -47,6 +47,10 @@ typedef struct {
 	guint repeat_browse;
 	gboolean dont_send_last;
 	gboolean activate_state;
+	/* If set, browse() serves these object ids, as many as asked
+	 * from the skip count, instead of "testobject". */
+	GPtrArray *items;
+	guint browse_skip;
 } MockedSource;
 
 extern GType mocked_source_get_type(void);
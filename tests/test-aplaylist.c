@@ -22,9 +22,14 @@
  *
  */
 #include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <unistd.h>
+#include <sys/file.h>
 #include <string.h>
+#include <glib/gstdio.h>
 #include <checkmore.h>
+#include "common/dbus-interface.h"
 #include "mafw-playlist-daemon/mpd-internal.h"
 
 gboolean initialize = FALSE;
@@ -407,6 +412,489 @@ START_TEST(test_move)
 }
 END_TEST
 
+START_TEST(test_removes)
+{
+	Pls *p = Playlist;
+
+	ck_assert(!pls_removes(p, 0, 1));
+	pls_append(p, "a");
+	pls_append(p, "b");
+	pls_append(p, "c");
+	pls_append(p, "d");
+	ck_assert(!pls_removes(p, 0, 0));
+	ck_assert(!pls_removes(p, 4, 1));
+	ck_assert(!pls_removes(p, 2, 3));
+	ck_assert(pls_removes(p, 1, 2));
+	assert_pls(p, APLS({0, "a"},
+			   {1, "d"}));
+	ck_assert(pls_removes(p, 0, 2));
+	assert_pls(p, EPLS);
+
+	/* Shuffled */
+	pls_free(p);
+	Playlist = p = mkpls(APLS({3, "xyzzy"},
+				  {1, "is"},
+				  {0, "true"},
+				  {2, "magic"}));
+	ck_assert(pls_removes(p, 1, 2));
+	assert_pls(p, APLS({1, "xyzzy"},
+			   {0, "magic"}));
+	ck_assert(pls_check(p));
+}
+END_TEST
+
+START_TEST(test_copy_range)
+{
+	Pls *p = Playlist, *q;
+
+	pls_append(p, "a");
+	pls_append(p, "b");
+	pls_append(p, "c");
+	q = pls_new(2, "other");
+	pls_append(q, "x");
+
+	ck_assert(!pls_copy_range(q, 0, p, 1, 3));
+	ck_assert(!pls_copy_range(q, 0, p, 4, 0));
+	ck_assert(!pls_copy_range(q, 2, p, 0, 1));
+	ck_assert(pls_copy_range(q, 0, p, 3, 0));
+	ck_assert(pls_copy_range(q, 1, p, 1, 2));
+	assert_pls(q, APLS({0, "x"},
+			   {1, "b"},
+			   {2, "c"}));
+	assert_pls(p, APLS({0, "a"},
+			   {1, "b"},
+			   {2, "c"}));
+
+	/* Within the same playlist */
+	ck_assert(pls_copy_range(p, 1, p, 0, 3));
+	assert_pls(p, APLS({0, "a"},
+			   {1, "a"},
+			   {2, "b"},
+			   {3, "c"},
+			   {4, "b"},
+			   {5, "c"}));
+	ck_assert(pls_check(p));
+	pls_free(q);
+}
+END_TEST
+
+START_TEST(test_pack)
+{
+	Pls *p = Playlist, *q;
+	gchar *oid;
+	guint i, len;
+	gsize bytes;
+
+	ck_assert(!pls_pack(p));
+	for (i = 0; i < 500; i++) {
+		oid = g_strdup_printf("localtagfs::music/songs/%u", i);
+		pls_append(p, oid);
+		g_free(oid);
+	}
+	pls_shuffle(p);
+	len = p->len;
+	bytes = p->bytes;
+
+	ck_assert(pls_pack(p));
+	ck_assert(p->packed && !p->vidx);
+	ck_assert(pls_pack_savings(p) > 0);
+	ck_assert(!pls_pack(p));
+	ck_assert(p->len == len && p->bytes == bytes);
+
+	pls_unpack(p);
+	ck_assert(!p->packed && pls_pack_savings(p) == 0);
+	ck_assert(pls_check(p));
+	for (i = 0; i < 500; i++) {
+		oid = g_strdup_printf("localtagfs::music/songs/%u", i);
+		ck_assert_str_eq(p->vidx[i], oid);
+		g_free(oid);
+	}
+
+	/* A packed playlist can be freed as it is. */
+	q = pls_new(2, "other");
+	pls_append(q, "a");
+	ck_assert(pls_pack(q));
+	pls_free(q);
+}
+END_TEST
+
+/* Inserts $n items named $fmt after their index at $idx of $p and $ref. */
+static void paged_inserts(Pls *p, GPtrArray *ref, guint idx, guint n,
+			  const gchar *fmt)
+{
+	gchar **oids;
+	guint i;
+
+	oids = g_new0(gchar *, n + 1);
+	for (i = 0; i < n; i++) {
+		oids[i] = g_strdup_printf(fmt, i);
+		g_ptr_array_add(ref, NULL);
+	}
+	memmove(&ref->pdata[idx + n], &ref->pdata[idx],
+		(ref->len - idx - n) * sizeof(gpointer));
+	for (i = 0; i < n; i++)
+		ref->pdata[idx + i] = g_strdup(oids[i]);
+	ck_assert(pls_inserts(p, idx, (const gchar **)oids, n));
+	g_strfreev(oids);
+}
+
+/* Checks that $p has the items of $ref. */
+static void assert_paged(Pls *p, GPtrArray *ref)
+{
+	gchar **oids;
+	guint i;
+
+	ck_assert(p->pages && !p->vidx);
+	ck_assert(pls_check(p));
+	ck_assert_int_eq(p->len, ref->len);
+	oids = pls_get_items(p, 0, p->len - 1);
+	for (i = 0; i < ref->len; i++)
+		ck_assert_str_eq(oids[i], ref->pdata[i]);
+	ck_assert(!oids[i]);
+	pls_items_free(p, oids);
+}
+
+START_TEST(test_paged)
+{
+	PagesStats stats;
+	GPtrArray *ref;
+	gchar *oid, **oids;
+	guint i, idx, next;
+	Pls *p, *q;
+
+	g_setenv("MAFW_PLAYLIST_DIR", "testaplaylist", TRUE);
+	/* Page out from 100 items on, keeping 2 pages in memory. */
+	pls_set_paging(100, 2);
+	ref = g_ptr_array_new_with_free_func(g_free);
+	p = pls_new(1, "paged");
+
+	paged_inserts(p, ref, 0, 5000, "localtagfs::music/songs/%u");
+	assert_paged(p, ref);
+	ck_assert(!pls_pack(p));
+
+	/* Cutting and filling up pages. */
+	paged_inserts(p, ref, 2500, 3000, "localtagfs::music/new/%u");
+	paged_inserts(p, ref, 8000, 1, "localtagfs::music/last");
+	assert_paged(p, ref);
+
+	/* Removing across pages. */
+	ck_assert(pls_removes(p, 1000, 2500));
+	g_ptr_array_remove_range(ref, 1000, 2500);
+	ck_assert(pls_remove(p, 0));
+	g_ptr_array_remove_index(ref, 0);
+	assert_paged(p, ref);
+
+	/* Moving both ways. */
+	ck_assert(pls_move(p, 10, 4000));
+	oid = g_ptr_array_index(ref, 10);
+	ref->pdata[10] = NULL;
+	g_ptr_array_remove_index(ref, 10);
+	g_ptr_array_add(ref, NULL);
+	memmove(&ref->pdata[4001], &ref->pdata[4000],
+		(ref->len - 4001) * sizeof(gpointer));
+	ref->pdata[4000] = oid;
+	assert_paged(p, ref);
+
+	/* Copying within. */
+	oids = pls_get_items(p, 2000, 2699);
+	ck_assert(pls_copy_range(p, 100, p, 2000, 700));
+	g_ptr_array_set_size(ref, ref->len + 700);
+	memmove(&ref->pdata[800], &ref->pdata[100],
+		(ref->len - 800) * sizeof(gpointer));
+	for (i = 0; i < 700; i++)
+		ref->pdata[100 + i] = g_strdup(oids[i]);
+	pls_items_free(p, oids);
+	assert_paged(p, ref);
+
+	oids = pls_get_items_budget(p, ref->len - 3, 0, 0, &next);
+	ck_assert_str_eq(oids[2], ref->pdata[ref->len - 1]);
+	ck_assert(next == MAFW_PLAYLIST_ITEMS_END);
+	pls_items_free(p, oids);
+
+	/* Navigation in shuffled order. */
+	pls_shuffle(p);
+	oid = NULL;
+	pls_get_starting(p, &idx, &oid);
+	for (i = 1; i < p->len; i++) {
+		ck_assert_str_eq(oid, ref->pdata[idx]);
+		g_free(oid);
+		ck_assert(pls_get_next(p, &idx, &oid));
+	}
+	ck_assert_str_eq(oid, ref->pdata[idx]);
+	g_free(oid);
+
+	/* The saved playlist is paged out again when loaded. */
+	ck_assert(pls_save(p, "paged.mp"));
+	q = pls_load("paged.mp");
+	ck_assert(q != NULL);
+	ck_assert(q->shuffled && q->poolst == p->poolst);
+	assert_paged(q, ref);
+	pls_free(q);
+
+	pages_get_stats(&stats);
+	ck_assert(stats.faults > 0 && stats.writebacks > 0);
+
+	pls_clear(p);
+	ck_assert(!p->pages && !p->len && !p->bytes);
+	pls_free(p);
+	g_ptr_array_free(ref, TRUE);
+	pls_set_paging(0, 0);
+}
+END_TEST
+
+/* Applies the changes of $p since $generation on $mirror. */
+static gboolean replay_changes(Pls *p, guint generation, GPtrArray *mirror)
+{
+	GPtrArray *changes;
+	guint i, j;
+
+	changes = g_ptr_array_new();
+	if (!pls_changes_since(p, generation, changes)) {
+		g_ptr_array_free(changes, TRUE);
+		return FALSE;
+	}
+	for (i = 0; i < changes->len; i++) {
+		const PlsChange *change = changes->pdata[i];
+
+		ck_assert(change->generation > generation);
+		g_ptr_array_remove_range(mirror, change->from,
+					 change->nremove);
+		for (j = 0; j < change->noids; j++) {
+			g_ptr_array_add(mirror, NULL);
+			memmove(&mirror->pdata[change->from + j + 1],
+				&mirror->pdata[change->from + j],
+				(mirror->len - change->from - j - 1)
+				* sizeof(gpointer));
+			mirror->pdata[change->from + j] = change->oids[j];
+		}
+	}
+	g_ptr_array_free(changes, TRUE);
+	return TRUE;
+}
+
+/* Checks that $mirror has the same items as $p. */
+static void assert_mirror(Pls *p, GPtrArray *mirror)
+{
+	guint i;
+
+	ck_assert_int_eq(mirror->len, p->len);
+	for (i = 0; i < p->len; i++)
+		ck_assert_str_eq(mirror->pdata[i], p->vidx[i]);
+}
+
+START_TEST(test_changes_since)
+{
+	static const gchar *abc[] = { "a", "b", "c" };
+	Pls *p = Playlist;
+	GPtrArray *mirror, *changes;
+	guint gen, i;
+	gchar oid[16];
+
+	mirror = g_ptr_array_new();
+	gen = p->generation;
+	ck_assert(replay_changes(p, gen, mirror));
+	ck_assert(!replay_changes(p, 0, mirror));
+	ck_assert(!replay_changes(p, gen + 1, mirror));
+
+	pls_appends(p, abc, 3);
+	pls_insert(p, 1, "x");
+	pls_move(p, 0, 3);
+	pls_remove(p, 2);
+	pls_shuffle(p);
+	pls_removes(p, 0, 2);
+	pls_append(p, "y");
+	ck_assert(replay_changes(p, gen, mirror));
+	assert_mirror(p, mirror);
+
+	/* Nothing has changed since. */
+	gen = p->generation;
+	changes = g_ptr_array_new();
+	ck_assert(pls_changes_since(p, gen, changes));
+	ck_assert(!changes->len);
+	g_ptr_array_free(changes, TRUE);
+
+	/* Syncing from the middle. */
+	pls_clear(p);
+	pls_appends(p, abc, 3);
+	ck_assert(replay_changes(p, gen, mirror));
+	assert_mirror(p, mirror);
+
+	/* The log is bounded. */
+	gen = p->generation;
+	for (i = 0; i < 1000; i++) {
+		sprintf(oid, "item_%u", i);
+		pls_append(p, oid);
+	}
+	ck_assert(!replay_changes(p, gen, mirror));
+	g_ptr_array_set_size(mirror, 0);
+	for (i = 0; i < p->len; i++)
+		g_ptr_array_add(mirror, p->vidx[i]);
+	gen = p->generation;
+	pls_remove(p, 0);
+	ck_assert(replay_changes(p, gen, mirror));
+	assert_mirror(p, mirror);
+
+	g_ptr_array_free(mirror, TRUE);
+}
+END_TEST
+
+START_TEST(test_apply_ops)
+{
+	static gchar *abc[] = { "a", "b", "c" };
+	static gchar *xy[] = { "x", "y" };
+	/* Each operation sees the effect of the previous ones. */
+	static PlsOp good[] = {
+		{ MAFW_PLAYLIST_OP_APPEND, 0, 0, abc, 3 },
+		{ MAFW_PLAYLIST_OP_INSERT, 3, 0, xy, 2 },
+		{ MAFW_PLAYLIST_OP_MOVE, 4, 0, NULL, 0 },
+		{ MAFW_PLAYLIST_OP_REMOVE, 2, 2, NULL, 0 },
+	};
+	static PlsOp bad[] = {
+		{ MAFW_PLAYLIST_OP_REMOVE, 0, 1, NULL, 0 },
+		{ MAFW_PLAYLIST_OP_SET_REPEAT, 0, 1, NULL, 0 },
+		{ MAFW_PLAYLIST_OP_MOVE, 2, 0, NULL, 0 },
+		{ MAFW_PLAYLIST_OP_INSERT, 1, 0, abc, 3 },
+	};
+	static PlsOp mixed[] = {
+		{ MAFW_PLAYLIST_OP_SET_REPEAT, 0, 1, NULL, 0 },
+		{ MAFW_PLAYLIST_OP_SHUFFLE, 0, 0, NULL, 0 },
+		{ MAFW_PLAYLIST_OP_REMOVE, 1, 2, NULL, 0 },
+	};
+	Pls *p = Playlist;
+	gboolean results[4];
+	guint first;
+
+	ck_assert(pls_apply_ops(p, good, G_N_ELEMENTS(good),
+				results, &first));
+	ck_assert(results[0] && results[1] && results[2] && results[3]);
+	ck_assert_uint_eq(first, 0);
+	assert_pls(p, APLS({0, "y"},
+			   {1, "a"},
+			   {2, "x"}));
+
+	/* A single invalid operation leaves the playlist untouched. */
+	ck_assert(!pls_apply_ops(p, bad, G_N_ELEMENTS(bad),
+				 results, &first));
+	ck_assert(results[0] && results[1] && !results[2] && results[3]);
+	ck_assert_uint_eq(first, G_MAXUINT);
+	ck_assert(!p->repeat);
+	assert_pls(p, APLS({0, "y"},
+			   {1, "a"},
+			   {2, "x"}));
+
+	/* Property changes can be mixed with edits. */
+	ck_assert(pls_apply_ops(p, mixed, G_N_ELEMENTS(mixed),
+				NULL, &first));
+	ck_assert_uint_eq(first, 1);
+	ck_assert(p->repeat);
+	ck_assert(pls_is_shuffled(p));
+	ck_assert(pls_check(p));
+	assert_pls(p, APLS({-1, "y"}));
+}
+END_TEST
+
+START_TEST(test_get_items_budget)
+{
+	Pls *p = Playlist;
+	gchar **oids;
+	guint next, gen;
+
+	oids = pls_get_items_budget(p, 0, 0, 0, &next);
+	ck_assert(oids && !oids[0]);
+	ck_assert_uint_eq(next, MAFW_PLAYLIST_ITEMS_END);
+	g_free(oids);
+	ck_assert(!pls_get_items_budget(p, 1, 0, 0, &next));
+
+	gen = p->generation;
+	pls_append(p, "aaa");
+	pls_append(p, "bbb");
+	pls_append(p, "ccc");
+	pls_append(p, "ddd");
+	ck_assert(p->generation != gen);
+
+	/* Item limit */
+	oids = pls_get_items_budget(p, 0, 3, 0, &next);
+	ck_assert_uint_eq(g_strv_length(oids), 3);
+	ck_assert_uint_eq(next, 3);
+	g_free(oids);
+
+	/* Byte limit: each item takes 4 bytes. */
+	oids = pls_get_items_budget(p, 1, 0, 9, &next);
+	ck_assert_uint_eq(g_strv_length(oids), 2);
+	ck_assert(!strcmp(oids[0], "bbb") && !strcmp(oids[1], "ccc"));
+	ck_assert_uint_eq(next, 3);
+	g_free(oids);
+
+	/* At least one item is returned. */
+	oids = pls_get_items_budget(p, 3, 0, 1, &next);
+	ck_assert_uint_eq(g_strv_length(oids), 1);
+	ck_assert_uint_eq(next, MAFW_PLAYLIST_ITEMS_END);
+	g_free(oids);
+
+	/* Only changes to the items start a new generation. */
+	gen = p->generation;
+	pls_set_repeat(p, TRUE);
+	pls_shuffle(p);
+	ck_assert_uint_eq(p->generation, gen);
+	pls_move(p, 0, 1);
+	ck_assert(p->generation != gen);
+}
+END_TEST
+
+/* Frees the strings of a %NULL-terminated array, but not the array. */
+static void free_oids(gchar **oids)
+{
+	guint i;
+
+	for (i = 0; oids[i]; i++)
+		g_free(oids[i]);
+}
+
+START_TEST(test_get_next_n)
+{
+	Pls *p = Playlist;
+	gchar *oids[8], *oid;
+	guint indices[7], i, idx;
+
+	ck_assert_uint_eq(pls_get_next_n(p, 0, 3, indices, oids), 0);
+	ck_assert(!oids[0]);
+
+	pls_append(p, "a");
+	pls_append(p, "b");
+	pls_append(p, "c");
+	ck_assert_uint_eq(pls_get_next_n(p, 0, 7, indices, oids), 2);
+	ck_assert(!strcmp(oids[0], "b") && !strcmp(oids[1], "c"));
+	ck_assert(indices[0] == 1 && indices[1] == 2);
+	ck_assert(!oids[2]);
+	free_oids(oids);
+
+	/* Repeat wraps around as many times as needed. */
+	pls_set_repeat(p, TRUE);
+	ck_assert_uint_eq(pls_get_next_n(p, 1, 7, indices, oids), 7);
+	ck_assert(!strcmp(oids[0], "c") && !strcmp(oids[1], "a"));
+	ck_assert(indices[4] == 0 && indices[6] == 2);
+	free_oids(oids);
+
+	/* The shuffled look-ahead is what get_next will say. */
+	pls_append(p, "d");
+	pls_append(p, "e");
+	pls_set_repeat(p, FALSE);
+	pls_shuffle(p);
+	pls_get_starting(p, &idx, &oid);
+	g_free(oid);
+	ck_assert_uint_eq(pls_get_next_n(p, idx, 7, indices, oids), 4);
+	ck_assert(pls_check(p));
+	for (i = 0; i < 4; i++) {
+		ck_assert(pls_get_next(p, &idx, &oid));
+		ck_assert_uint_eq(idx, indices[i]);
+		ck_assert(!strcmp(oid, oids[i]));
+		g_free(oid);
+	}
+	ck_assert(!pls_get_next(p, &idx, &oid));
+	free_oids(oids);
+}
+END_TEST
+
 START_TEST(test_shuffle_empty)
 {
 	Pls *p = Playlist;
@@ -593,6 +1081,13 @@ START_TEST(test_dirty)
 	pls_move(p, 0, 1);
 	ck_assert(p->dirty);
 
+	/* Edits update the modification time, the use count doesn't. */
+	p->mtime = 0;
+	pls_set_use_count(p, 1);
+	ck_assert(p->mtime == 0);
+	pls_set_repeat(p, FALSE);
+	ck_assert(p->mtime != 0);
+
 	pls_free(p);
 }
 END_TEST
@@ -603,6 +1098,7 @@ START_TEST(test_save)
 	Pls *p1, *p2;
 	gint i;
 	gchar name[16];
+	PlsSaveStats before;
 
 	unlink("tale.mp");
 	p1 = pls_new(44, "tale");
@@ -611,20 +1107,115 @@ START_TEST(test_save)
 		pls_append(p1, name);
 	}
 	ck_assert(p1->dirty);
+	before = Save_stats;
 	ck_assert(pls_save(p1, "tale.mp"));
+	ck_assert(Save_stats.saves == before.saves + 1);
+	ck_assert(Save_stats.failures == before.failures);
+	ck_assert(Save_stats.bytes > before.bytes);
 	p2 = pls_load("tale.mp");
 	ck_assert(p2 != NULL);
 	ck_assert(p2->id == p1->id);
 	ck_assert(!strcmp(p2->name, p1->name));
+	ck_assert(p2->bytes == p1->bytes);
 	ck_assert(p2->repeat == p1->repeat);
 	ck_assert(p2->shuffled == p1->shuffled);
 	ck_assert(p2->len == p1->len);
+	ck_assert(p2->generation == p1->generation);
 	ck_assert(p2->dirty);
 	pls_free(p1);
 	pls_free(p2);
 }
 END_TEST
 
+/* pls_load_from() callback collecting $pls into $loaded. */
+static void collect_loaded(Pls *pls, GPtrArray *loaded)
+{
+	g_ptr_array_add(loaded, pls);
+}
+
+/* Backups are written by pls_write() and read by pls_load_from(). */
+START_TEST(test_load_from)
+{
+	Pls *p1, *p2;
+	FILE *f;
+	GPtrArray *loaded;
+	gchar *saved, *written;
+	guint i;
+
+	g_mkdir("backup.d", 0700);
+	p1 = pls_new(12, "twelve");
+	pls_append(p1, "item_a");
+	pls_append(p1, "item_b");
+	pls_shuffle(p1);
+	p2 = pls_new(13, "thirteen");
+
+	/* Same as what pls_save() writes. */
+	ck_assert(pls_save(p1, "backup.d/12"));
+	ck_assert((f = fopen("backup.d/13", "w")) != NULL);
+	ck_assert(pls_write(p2, f));
+	fclose(f);
+	ck_assert((f = fopen("written", "w")) != NULL);
+	ck_assert(pls_write(p1, f));
+	fclose(f);
+	ck_assert(g_file_get_contents("backup.d/12", &saved, NULL, NULL));
+	ck_assert(g_file_get_contents("written", &written, NULL, NULL));
+	ck_assert(!strcmp(saved, written));
+	g_free(saved);
+	g_free(written);
+	unlink("written");
+	/* Not playlists. */
+	g_file_set_contents("backup.d/12.smart", "[smart]\n", -1, NULL);
+
+	loaded = g_ptr_array_new();
+	ck_assert(!pls_load_from("no-such-backup.d",
+				 (PlsLoadedFunc)collect_loaded, loaded));
+	ck_assert(pls_load_from("backup.d",
+				(PlsLoadedFunc)collect_loaded, loaded));
+	ck_assert_int_eq(loaded->len, 2);
+	for (i = 0; i < loaded->len; i++) {
+		Pls *p;
+
+		p = loaded->pdata[i];
+		if (p->id == 12) {
+			ck_assert(!strcmp(p->name, "twelve"));
+			ck_assert(p->len == 2);
+			ck_assert(p->shuffled);
+		} else {
+			ck_assert(p->id == 13);
+			ck_assert(!strcmp(p->name, "thirteen"));
+			ck_assert(p->len == 0);
+		}
+		pls_free(p);
+	}
+	g_ptr_array_free(loaded, TRUE);
+
+	unlink("backup.d/12");
+	unlink("backup.d/13");
+	unlink("backup.d/12.smart");
+	g_rmdir("backup.d");
+	pls_free(p1);
+	pls_free(p2);
+}
+END_TEST
+
+/* The playlist directory can be locked only once. */
+START_TEST(test_lock_dir)
+{
+	gint fd;
+
+	g_setenv("MAFW_PLAYLIST_DIR", "testlockdir", TRUE);
+	ck_assert(pls_lock_dir());
+	ck_assert(pls_lock_dir());
+
+	/* Like another process would try. */
+	ck_assert((fd = open("testlockdir", O_RDONLY)) >= 0);
+	ck_assert(flock(fd, LOCK_EX | LOCK_NB) < 0);
+	ck_assert(errno == EWOULDBLOCK);
+	close(fd);
+	g_rmdir("testlockdir");
+}
+END_TEST
+
 START_TEST(stress_persist)
 {
 #ifndef __ARMEL__
@@ -929,6 +1520,8 @@ int main(void)
 	if (1) tcase_add_test(tc, test_create);
 	if (1) tcase_add_test(tc, test_dirty);
 	if (1) tcase_add_test(tc, test_save);
+	if (1) tcase_add_test(tc, test_load_from);
+	if (1) tcase_add_test(tc, test_lock_dir);
 	if (1) tcase_add_test(tc, stress_persist);
 	if (1) tcase_add_test(tc, fuzz_load);
 	/* The following two tests take longer time. */
@@ -942,6 +1535,14 @@ int main(void)
 	if (1) tcase_add_test(tc, test_insert);
 	if (1) tcase_add_test(tc, test_remove);
 	if (1) tcase_add_test(tc, test_move);
+	if (1) tcase_add_test(tc, test_removes);
+	if (1) tcase_add_test(tc, test_copy_range);
+	if (1) tcase_add_test(tc, test_pack);
+	if (1) tcase_add_test(tc, test_paged);
+	if (1) tcase_add_test(tc, test_changes_since);
+	if (1) tcase_add_test(tc, test_apply_ops);
+	if (1) tcase_add_test(tc, test_get_items_budget);
+	if (1) tcase_add_test(tc, test_get_next_n);
 	if (1) tcase_add_test(tc, test_iterator);
 	if (1) tcase_add_test(tc, test_shuffle_empty);
 	if (1) tcase_add_test(tc, test_shuffle);
@@ -0,0 +1,349 @@
+/*
+ * This file is a part of MAFW
+ *
+ * Copyright (C) 2007, 2008, 2009 Nokia Corporation, all rights reserved.
+ *
+ * Contact: Visa Smolander <visa.smolander@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#include <string.h>
+
+#include <check.h>
+#include <glib.h>
+#include <dbus/dbus.h>
+#include <libmafw/mafw-errors.h>
+
+#include <checkmore.h>
+#include "common/dbus-interface.h"
+#include "common/mafw-dbus.h"
+#include "libmafw-shared/mafw-playlist-manager.h"
+#include "libmafw-shared/mafw-shared.h"
+#include "../mafw-playlist-daemon/mpd-internal.h"
+#include "mockbus.h"
+
+/* Playlists will be stored in PLS_DIR. */
+#define PLS_DIR		"testdispatch"
+
+#define CLIENT_A	":1.103"
+#define CLIENT_B	":1.104"
+
+/* A request to playlist 1 from @sender. */
+#define pl_request(sender, ...)						\
+	with_sender(mafw_dbus_method_full(MAFW_PLAYLIST_SERVICE,	\
+					  MAFW_PLAYLIST_PATH "/1",	\
+					  MAFW_PLAYLIST_INTERFACE,	\
+					  __VA_ARGS__), sender)
+
+static const gchar *Oids[] = {"test::a", NULL};
+
+static DBusMessage *with_sender(DBusMessage *msg, const gchar *sender)
+{
+	mockbus_set_sender(msg, sender);
+	return msg;
+}
+
+/* Starts the daemon with playlist 1 holding $Oids. */
+static void start_daemon(void)
+{
+	Pls *pls;
+
+	mockbus_reset();
+	mockbus_expect(mafw_dbus_method_full(
+			       DBUS_SERVICE_DBUS,
+			       DBUS_PATH_DBUS,
+			       DBUS_INTERFACE_DBUS,
+			       "RequestName",
+			       MAFW_DBUS_STRING(MAFW_PLAYLIST_SERVICE),
+			       MAFW_DBUS_UINT32(4)));
+	mockbus_reply(MAFW_DBUS_UINT32(1));
+	mock_services(NULL);
+	mafw_shared_deinit();
+	init_playlist_wrapper(dbus_bus_get(DBUS_BUS_SESSION, NULL),
+			      TRUE, FALSE);
+
+	pls = pls_new(1, "test");
+	pls_appends(pls, Oids, 1);
+	g_tree_insert(Playlists, GUINT_TO_POINTER(pls->id), pls);
+	g_tree_insert(Playlists_by_name, g_strdup(pls->name), pls);
+}
+
+/* Lets the daemon handle its queued requests. */
+static void run_queue(void)
+{
+	while (g_main_context_iteration(NULL, FALSE))
+		/* */;
+}
+
+START_TEST(test_classes)
+{
+	DBusMessage *items_a, *size_a, *size_b;
+
+	start_daemon();
+	items_a = pl_request(CLIENT_A, MAFW_PLAYLIST_METHOD_GET_ITEMS,
+			     MAFW_DBUS_UINT32(0), MAFW_DBUS_UINT32(0));
+	size_a = pl_request(CLIENT_A, MAFW_PLAYLIST_METHOD_GET_SIZE);
+	size_b = pl_request(CLIENT_B, MAFW_PLAYLIST_METHOD_GET_SIZE);
+
+	/* The interactive request of B overtakes the bulk one of A, but
+	 * A's own interactive request waits for its bulk one. */
+	mockbus_expect(mafw_dbus_reply(size_b, MAFW_DBUS_UINT32(1)));
+	mockbus_expect(mafw_dbus_reply(items_a, MAFW_DBUS_STRVZ(Oids)));
+	mockbus_expect(mafw_dbus_reply(size_a, MAFW_DBUS_UINT32(1)));
+	mockbus_incoming(items_a);
+	mockbus_incoming(size_a);
+	mockbus_incoming(size_b);
+	mockbus_deliver(NULL);
+	mockbus_deliver(NULL);
+	ck_assert_uint_eq(dispatch_pending(CLIENT_A), 2);
+	mockbus_deliver(NULL);
+	ck_assert_uint_eq(dispatch_pending(CLIENT_B), 0);
+	run_queue();
+	mockbus_finish();
+
+	ck_assert_uint_eq(dispatch_pending(CLIENT_A), 0);
+	ck_assert_uint_eq(dispatch_get_stats(DISPATCH_BULK)->deferred, 1);
+	ck_assert_uint_eq(
+		dispatch_get_stats(DISPATCH_INTERACTIVE)->deferred, 1);
+	ck_assert_uint_eq(
+		dispatch_get_stats(DISPATCH_INTERACTIVE)->handled, 2);
+}
+END_TEST
+
+START_TEST(test_quota)
+{
+	DBusMessage *items_a, *size_a, *size_b;
+
+	g_setenv("MAFW_PLAYLIST_QUOTA", "requests=1", TRUE);
+	start_daemon();
+	quota_init();
+	items_a = pl_request(CLIENT_A, MAFW_PLAYLIST_METHOD_GET_ITEMS,
+			     MAFW_DBUS_UINT32(0), MAFW_DBUS_UINT32(0));
+	size_a = pl_request(CLIENT_A, MAFW_PLAYLIST_METHOD_GET_SIZE);
+	size_b = pl_request(CLIENT_B, MAFW_PLAYLIST_METHOD_GET_SIZE);
+
+	/* A has one request queued already, B none. */
+	mockbus_expect(mafw_dbus_error(size_a, MAFW_PLAYLIST_ERROR,
+				       MAFW_PLAYLIST_ERROR_QUOTA_EXCEEDED,
+				       "Too many requests in progress"));
+	mockbus_expect(mafw_dbus_reply(size_b, MAFW_DBUS_UINT32(1)));
+	mockbus_expect(mafw_dbus_reply(items_a, MAFW_DBUS_STRVZ(Oids)));
+	mockbus_incoming(items_a);
+	mockbus_incoming(size_a);
+	mockbus_incoming(size_b);
+	mockbus_deliver(NULL);
+	mockbus_deliver(NULL);
+	mockbus_deliver(NULL);
+	run_queue();
+	mockbus_finish();
+
+	/* The quota is free again. */
+	size_a = pl_request(CLIENT_A, MAFW_PLAYLIST_METHOD_GET_SIZE);
+	mockbus_expect(mafw_dbus_reply(size_a, MAFW_DBUS_UINT32(1)));
+	mockbus_incoming(size_a);
+	mockbus_deliver(NULL);
+	mockbus_finish();
+	g_unsetenv("MAFW_PLAYLIST_QUOTA");
+}
+END_TEST
+
+START_TEST(test_malformed)
+{
+	DBusMessage *c;
+
+	start_daemon();
+	/* Not an operation list at all. */
+	c = pl_request(CLIENT_A, MAFW_PLAYLIST_METHOD_APPLY_OPS,
+		       MAFW_DBUS_UINT32(0));
+	mockbus_expect(dbus_message_new_error(c, DBUS_ERROR_INVALID_ARGS,
+					      "Malformed operation list"));
+	mockbus_incoming(c);
+	mockbus_deliver(NULL);
+	run_queue();
+	mockbus_finish();
+}
+END_TEST
+
+START_TEST(test_huge_window)
+{
+	const gchar *oids[] = {"test::b", NULL};
+	const gchar *none[] = {NULL};
+	DBusMessage *c;
+	GPtrArray *many;
+	Pls *pls;
+	guint i;
+
+	start_daemon();
+
+	/* The window reaches beyond G_MAXUINT, yet it still covers the
+	 * end of the playlist. */
+	c = pl_request(CLIENT_A, MAFW_PLAYLIST_METHOD_SET_WINDOW,
+		       MAFW_DBUS_UINT32(1), MAFW_DBUS_UINT32(G_MAXUINT));
+	mockbus_expect(mafw_dbus_reply(c, MAFW_DBUS_STRVZ(none)));
+	mockbus_incoming(c);
+	mockbus_deliver(NULL);
+	c = pl_request(CLIENT_B, MAFW_PLAYLIST_METHOD_APPEND_ITEM,
+		       MAFW_DBUS_STRVZ(oids));
+	mockbus_expect(mafw_dbus_reply(c));
+	mockbus_expect(mafw_dbus_signal_full(CLIENT_A,
+					     MAFW_PLAYLIST_PATH "/1",
+					     MAFW_PLAYLIST_INTERFACE,
+					     MAFW_PLAYLIST_WINDOW_SHIFTED,
+					     MAFW_DBUS_UINT32(2)));
+	mockbus_expect(mafw_dbus_signal_full(NULL, MAFW_PLAYLIST_PATH "/1",
+					     MAFW_PLAYLIST_INTERFACE,
+					     MAFW_PLAYLIST_CONTENTS_CHANGED,
+					     MAFW_DBUS_UINT32(1),
+					     MAFW_DBUS_UINT32(1),
+					     MAFW_DBUS_UINT32(0),
+					     MAFW_DBUS_UINT32(1)));
+	mockbus_incoming(c);
+	mockbus_deliver(NULL);
+	run_queue();
+	mockbus_finish();
+
+	/* Nor can a window be larger than MAFW_PLAYLIST_WINDOW_MAX. */
+	pls = g_tree_lookup(Playlists, GUINT_TO_POINTER(1));
+	many = g_ptr_array_new_with_free_func(g_free);
+	for (i = 0; i < MAFW_PLAYLIST_WINDOW_MAX + 10; i++)
+		g_ptr_array_add(many, g_strdup_printf("test::%u", i));
+	pls_clear(pls);
+	pls_appends(pls, (const gchar **)many->pdata, many->len);
+	g_ptr_array_set_size(many, MAFW_PLAYLIST_WINDOW_MAX);
+	g_ptr_array_add(many, NULL);
+	c = pl_request(CLIENT_B, MAFW_PLAYLIST_METHOD_SET_WINDOW,
+		       MAFW_DBUS_UINT32(0), MAFW_DBUS_UINT32(G_MAXUINT));
+	mockbus_expect(mafw_dbus_reply(c, MAFW_DBUS_STRVZ(
+					       (const gchar **)many->pdata)));
+	mockbus_incoming(c);
+	mockbus_deliver(NULL);
+
+	/* Far beyond the end. */
+	c = pl_request(CLIENT_B, MAFW_PLAYLIST_METHOD_SET_WINDOW,
+		       MAFW_DBUS_UINT32(G_MAXUINT),
+		       MAFW_DBUS_UINT32(G_MAXUINT));
+	mockbus_expect(mafw_dbus_reply(c, MAFW_DBUS_STRVZ(none)));
+	mockbus_incoming(c);
+	mockbus_deliver(NULL);
+	run_queue();
+	mockbus_finish();
+	g_ptr_array_free(many, TRUE);
+}
+END_TEST
+
+START_TEST(test_sliced)
+{
+	const gchar *oids[] = {"test::x", NULL};
+	DBusMessage *items_a, *size_b, *insert_b;
+	GPtrArray *many, *shifted;
+	guint64 handled;
+	Pls *pls;
+	guint i;
+
+	start_daemon();
+	pls = g_tree_lookup(Playlists, GUINT_TO_POINTER(1));
+	many = g_ptr_array_new_with_free_func(g_free);
+	for (i = 0; i < 3000; i++)
+		g_ptr_array_add(many, g_strdup_printf("test::%u", i));
+	pls_clear(pls);
+	pls_appends(pls, (const gchar **)many->pdata, many->len);
+	g_ptr_array_add(many, NULL);
+
+	/* B's request arriving after A's long read has started is answered
+	 * before it. */
+	items_a = pl_request(CLIENT_A, MAFW_PLAYLIST_METHOD_GET_ITEMS,
+			     MAFW_DBUS_UINT32(0), MAFW_DBUS_UINT32(G_MAXUINT));
+	size_b = pl_request(CLIENT_B, MAFW_PLAYLIST_METHOD_GET_SIZE);
+	mockbus_expect(mafw_dbus_reply(size_b, MAFW_DBUS_UINT32(3000)));
+	mockbus_expect(mafw_dbus_reply(items_a, MAFW_DBUS_STRVZ(
+					       (const gchar **)many->pdata)));
+	handled = dispatch_get_stats(DISPATCH_BULK)->handled;
+	mockbus_incoming(items_a);
+	mockbus_deliver(NULL);
+	while (dispatch_get_stats(DISPATCH_BULK)->handled == handled)
+		g_main_context_iteration(NULL, TRUE);
+	ck_assert_uint_eq(dispatch_pending(CLIENT_A), 1);
+	mockbus_incoming(size_b);
+	mockbus_deliver(NULL);
+	run_queue();
+	mockbus_finish();
+	ck_assert_uint_eq(dispatch_pending(CLIENT_A), 0);
+
+	/* An edit between two slices restarts the read, which returns the
+	 * items after the edit only. */
+	items_a = pl_request(CLIENT_A, MAFW_PLAYLIST_METHOD_GET_ITEMS,
+			     MAFW_DBUS_UINT32(0), MAFW_DBUS_UINT32(G_MAXUINT));
+	insert_b = pl_request(CLIENT_B, MAFW_PLAYLIST_METHOD_INSERT_ITEM,
+			      MAFW_DBUS_UINT32(0), MAFW_DBUS_STRVZ(oids));
+	shifted = g_ptr_array_new();
+	g_ptr_array_add(shifted, "test::x");
+	for (i = 0; i < 3000; i++)
+		g_ptr_array_add(shifted, many->pdata[i]);
+	g_ptr_array_add(shifted, NULL);
+	mockbus_expect(mafw_dbus_reply(insert_b));
+	mockbus_expect(mafw_dbus_signal_full(NULL, MAFW_PLAYLIST_PATH "/1",
+					     MAFW_PLAYLIST_INTERFACE,
+					     MAFW_PLAYLIST_CONTENTS_CHANGED,
+					     MAFW_DBUS_UINT32(1),
+					     MAFW_DBUS_UINT32(0),
+					     MAFW_DBUS_UINT32(0),
+					     MAFW_DBUS_UINT32(1)));
+	mockbus_expect(mafw_dbus_reply(items_a, MAFW_DBUS_STRVZ(
+					       (const gchar **)shifted->pdata)));
+	handled = dispatch_get_stats(DISPATCH_BULK)->handled;
+	mockbus_incoming(items_a);
+	mockbus_deliver(NULL);
+	while (dispatch_get_stats(DISPATCH_BULK)->handled == handled)
+		g_main_context_iteration(NULL, TRUE);
+	mockbus_incoming(insert_b);
+	mockbus_deliver(NULL);
+	run_queue();
+	mockbus_finish();
+	g_ptr_array_free(shifted, TRUE);
+	g_ptr_array_free(many, TRUE);
+}
+END_TEST
+
+/*****************************************************************************
+ * Test case management
+ *****************************************************************************/
+
+static Suite *dispatch_suite(void)
+{
+	Suite *suite;
+
+	suite = suite_create("Request dispatching");
+	if (1)	checkmore_add_tcase(suite, "Classes", test_classes);
+	if (1)	checkmore_add_tcase(suite, "Quota", test_quota);
+	if (1)	checkmore_add_tcase(suite, "Malformed", test_malformed);
+	if (1)	checkmore_add_tcase(suite, "Huge window", test_huge_window);
+	if (1)	checkmore_add_tcase(suite, "Sliced reads", test_sliced);
+	return suite;
+}
+
+/*****************************************************************************
+ * Test case execution
+ *****************************************************************************/
+
+int main(void)
+{
+	g_setenv("MAFW_PLAYLIST_DIR", PLS_DIR, TRUE);
+	return checkmore_run(srunner_create(dispatch_suite()), FALSE);
+}
+
+/* vi: set noexpandtab ts=8 sw=8 cino=t0,(0: */
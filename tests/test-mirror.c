@@ -0,0 +1,221 @@
+/*
+ * This file is a part of MAFW
+ *
+ * Copyright (C) 2007, 2008, 2009 Nokia Corporation, all rights reserved.
+ *
+ * Contact: Visa Smolander <visa.smolander@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <glib.h>
+
+#include <checkmore.h>
+#include "common/mafw-mirror.h"
+
+static gchar *Oids[] = { "alpha", "beta", "gamma", "delta", NULL };
+
+/* Publishes $Oids in a new mirror and maps it for reading into $reader.
+ * Returns the writer side. */
+static MafwMirror *publish(MafwMirror **reader, guint generation)
+{
+	MafwMirrorState state = { 4, generation, MAFW_MIRROR_REPEAT };
+	MafwMirror *writer;
+
+	writer = mafw_mirror_create(mafw_mirror_size_for(Oids, 4));
+	ck_assert(writer != NULL);
+	ck_assert(mafw_mirror_publish(writer, Oids, &state));
+	*reader = mafw_mirror_map(dup(mafw_mirror_get_fd(writer)),
+				  mafw_mirror_get_size(writer));
+	ck_assert(*reader != NULL);
+	return writer;
+}
+
+START_TEST(test_read)
+{
+	MafwMirror *writer, *reader;
+	MafwMirrorState state;
+	gchar **oids;
+
+	if (!mafw_mirror_supported())
+		return;
+	writer = publish(&reader, 7);
+
+	ck_assert(mafw_mirror_read(reader, 0, 0, &state, NULL));
+	ck_assert(state.len == 4);
+	ck_assert(state.generation == 7);
+	ck_assert(state.flags == MAFW_MIRROR_REPEAT);
+
+	ck_assert(mafw_mirror_read(reader, 1, 2, &state, &oids));
+	ck_assert(g_strv_length(oids) == 2);
+	ck_assert_str_eq(oids[0], "beta");
+	ck_assert_str_eq(oids[1], "gamma");
+	g_strfreev(oids);
+
+	/* Reading past the end is cut short. */
+	ck_assert(mafw_mirror_read(reader, 2, G_MAXUINT, &state, &oids));
+	ck_assert(g_strv_length(oids) == 2);
+	ck_assert_str_eq(oids[1], "delta");
+	g_strfreev(oids);
+	ck_assert(mafw_mirror_read(reader, 4, 1, &state, &oids));
+	ck_assert(oids[0] == NULL);
+	g_strfreev(oids);
+
+	mafw_mirror_free(reader);
+	mafw_mirror_free(writer);
+}
+END_TEST
+
+START_TEST(test_update)
+{
+	MafwMirror *writer, *reader;
+	MafwMirrorState state = { 2, 8, MAFW_MIRROR_SHUFFLED };
+	gchar *big[] = { NULL, NULL };
+	gchar **oids;
+
+	if (!mafw_mirror_supported())
+		return;
+	writer = publish(&reader, 7);
+
+	/* Updates in place are seen by the reader. */
+	ck_assert(mafw_mirror_publish(writer, &Oids[2], &state));
+	ck_assert(mafw_mirror_read(reader, 0, 10, &state, &oids));
+	ck_assert(state.len == 2);
+	ck_assert(state.generation == 8);
+	ck_assert(state.flags == MAFW_MIRROR_SHUFFLED);
+	ck_assert_str_eq(oids[0], "gamma");
+	ck_assert_str_eq(oids[1], "delta");
+	g_strfreev(oids);
+
+	/* What doesn't fit is refused, and the mirror is left alone. */
+	big[0] = g_strnfill(mafw_mirror_get_size(writer), 'x');
+	state.len = 1;
+	state.generation = 9;
+	ck_assert(!mafw_mirror_publish(writer, big, &state));
+	ck_assert(mafw_mirror_read(reader, 0, 0, &state, NULL));
+	ck_assert(state.generation == 8);
+	g_free(big[0]);
+
+#ifdef F_SEAL_FUTURE_WRITE
+	/* The readers can't map it writable. */
+	ck_assert(mmap(NULL, mafw_mirror_get_size(writer),
+		       PROT_READ | PROT_WRITE, MAP_SHARED,
+		       mafw_mirror_get_fd(writer), 0) == MAP_FAILED);
+#endif
+
+	/* Freeing the writer abandons the mirror. */
+	ck_assert(!mafw_mirror_is_stale(reader));
+	mafw_mirror_free(writer);
+	ck_assert(mafw_mirror_is_stale(reader));
+	ck_assert(!mafw_mirror_read(reader, 0, 0, &state, NULL));
+	mafw_mirror_free(reader);
+}
+END_TEST
+
+/* Asserts that $reader holds $expected at $generation. */
+static void check_items(MafwMirror *reader, gchar **expected,
+			guint generation)
+{
+	MafwMirrorState state;
+	gchar **oids;
+	guint i;
+
+	ck_assert(mafw_mirror_read(reader, 0, G_MAXUINT, &state, &oids));
+	ck_assert(state.generation == generation);
+	ck_assert(state.len == g_strv_length(expected));
+	ck_assert(g_strv_length(oids) == state.len);
+	for (i = 0; i < state.len; i++)
+		ck_assert_str_eq(oids[i], expected[i]);
+	g_strfreev(oids);
+}
+
+START_TEST(test_patch)
+{
+	MafwMirror *writer, *reader;
+	MafwMirrorState state = { 5, 8, 0 };
+	gchar *appended[] = { "alpha", "beta", "gamma", "delta", "epsilon",
+			      NULL };
+	gchar *removed[] = { "alpha", "gamma", "delta", "epsilon", NULL };
+	gchar *replaced[] = { "zeta", "eta", "gamma", "delta", "epsilon",
+			      NULL };
+	gchar *big[] = { "zeta", "eta", "gamma", "delta", "epsilon", NULL,
+			 NULL };
+
+	if (!mafw_mirror_supported())
+		return;
+	writer = publish(&reader, 7);
+
+	ck_assert(mafw_mirror_patch(writer, appended, 4, 0, 1, &state));
+	check_items(reader, appended, 8);
+
+	state.len = 4;
+	state.generation = 9;
+	ck_assert(mafw_mirror_patch(writer, removed, 1, 1, 0, &state));
+	check_items(reader, removed, 9);
+
+	state.len = 5;
+	state.generation = 10;
+	ck_assert(mafw_mirror_patch(writer, replaced, 0, 1, 2, &state));
+	check_items(reader, replaced, 10);
+
+	/* Only the properties. */
+	state.flags = MAFW_MIRROR_SHUFFLED;
+	state.generation = 11;
+	ck_assert(mafw_mirror_patch(writer, replaced, 0, 0, 0, &state));
+	check_items(reader, replaced, 11);
+	ck_assert(mafw_mirror_read(reader, 0, 0, &state, NULL));
+	ck_assert(state.flags == MAFW_MIRROR_SHUFFLED);
+
+	/* Changes not matching the mirror are refused. */
+	state.len = 7;
+	state.generation = 12;
+	ck_assert(!mafw_mirror_patch(writer, replaced, 0, 1, 1, &state));
+	state.len = 5;
+	ck_assert(!mafw_mirror_patch(writer, replaced, 6, 0, 0, &state));
+	check_items(reader, replaced, 11);
+
+	/* So are the ones which don't fit, but the whole still may. */
+	big[5] = g_strnfill(mafw_mirror_get_size(writer) * 3 / 4, 'x');
+	state.len = 6;
+	ck_assert(!mafw_mirror_patch(writer, big, 5, 0, 1, &state));
+	check_items(reader, replaced, 11);
+	ck_assert(mafw_mirror_publish(writer, big, &state));
+	check_items(reader, big, 12);
+	g_free(big[5]);
+
+	mafw_mirror_free(reader);
+	mafw_mirror_free(writer);
+}
+END_TEST
+
+int main(void)
+{
+	Suite *suite;
+	TCase *tc;
+
+	suite = suite_create("mafw-mirror");
+	tc = checkmore_add_tcase(suite, "Mirror", test_read);
+	tcase_add_test(tc, test_update);
+	tcase_add_test(tc, test_patch);
+	return checkmore_run(srunner_create(suite), TRUE);
+}
+
+/* vi: set noexpandtab ts=8 sw=8 cino=t0,(0: */
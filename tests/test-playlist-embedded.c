@@ -0,0 +1,253 @@
+/*
+ * This file is a part of MAFW
+ *
+ * Copyright (C) 2007, 2008, 2009 Nokia Corporation, all rights reserved.
+ *
+ * Contact: Visa Smolander <visa.smolander@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+#include <check.h>
+#include <checkmore.h>
+
+#include <libmafw/mafw-playlist.h>
+
+#include "libmafw-shared/mafw-playlist-manager.h"
+
+/* Tests the in-process playlist store, without a playlist daemon. */
+
+#define PLAYLIST_DIR		"testplaylistembedded"
+
+static guint Created, Destroyed, Changed, Moved, Notified;
+static guint Last_from, Last_nremove, Last_nreplace;
+
+static void created(MafwPlaylistManager *manager, MafwPlaylist *playlist)
+{
+	Created++;
+}
+
+static void destroyed(MafwPlaylistManager *manager, MafwPlaylist *playlist)
+{
+	Destroyed++;
+}
+
+static void contents_changed(MafwPlaylist *playlist, guint from,
+			     guint nremove, guint nreplace)
+{
+	Changed++;
+	Last_from = from;
+	Last_nremove = nremove;
+	Last_nreplace = nreplace;
+}
+
+static void item_moved(MafwPlaylist *playlist, guint from, guint to)
+{
+	Moved++;
+}
+
+static void notified(GObject *playlist, GParamSpec *pspec)
+{
+	Notified++;
+}
+
+static MafwPlaylist *new_playlist(const gchar *name)
+{
+	MafwPlaylist *playlist;
+
+	playlist = MAFW_PLAYLIST(mafw_playlist_manager_create_playlist(
+					mafw_playlist_manager_get(),
+					name, NULL));
+	ck_assert(playlist != NULL);
+	g_signal_connect(playlist, "contents-changed",
+			 G_CALLBACK(contents_changed), NULL);
+	g_signal_connect(playlist, "item-moved",
+			 G_CALLBACK(item_moved), NULL);
+	g_signal_connect(playlist, "notify", G_CALLBACK(notified), NULL);
+	return playlist;
+}
+
+START_TEST(test_edit)
+{
+	MafwPlaylistManager *manager;
+	MafwPlaylist *playlist;
+	GError *err;
+	gchar **items;
+	gchar *oid;
+	guint idx;
+	const gchar *oids[] = { "b", "c", "d", NULL };
+
+	manager = mafw_playlist_manager_get();
+	g_signal_connect(manager, "playlist-created",
+			 G_CALLBACK(created), NULL);
+	g_signal_connect(manager, "playlist-destroyed",
+			 G_CALLBACK(destroyed), NULL);
+
+	/* Signals are emitted right away. */
+	playlist = new_playlist("edit");
+	ck_assert(Created == 1);
+	ck_assert(MAFW_PLAYLIST(mafw_playlist_manager_create_playlist(
+				manager, "edit", NULL)) == playlist);
+	g_object_unref(playlist);
+	ck_assert(Created == 1);
+
+	ck_assert(mafw_playlist_append_item(playlist, "a", NULL));
+	ck_assert(Changed == 1);
+	ck_assert(mafw_playlist_append_items(playlist, oids, NULL));
+	ck_assert(Changed == 2);
+	ck_assert(Last_from == 1 && Last_nremove == 0 && Last_nreplace == 3);
+	ck_assert(mafw_playlist_get_size(playlist, NULL) == 4);
+
+	err = NULL;
+	ck_assert(!mafw_playlist_insert_item(playlist, 9, "x", &err));
+	ck_assert(err && err->code == MAFW_PLAYLIST_ERROR_INVALID_INDEX);
+	g_error_free(err);
+	ck_assert(Changed == 2);
+
+	ck_assert(mafw_playlist_move_item(playlist, 0, 3, NULL));
+	ck_assert(Moved == 1);
+	ck_assert((items = mafw_playlist_get_items(playlist, 0, 9, NULL)));
+	ck_assert(g_strv_length(items) == 4);
+	ck_assert_str_eq(items[0], "b");
+	ck_assert_str_eq(items[3], "a");
+	g_strfreev(items);
+
+	ck_assert(mafw_playlist_remove_item(playlist, 0, NULL));
+	ck_assert(Last_from == 0 && Last_nremove == 1 && Last_nreplace == 0);
+	ck_assert((oid = mafw_playlist_get_item(playlist, 0, NULL)));
+	ck_assert_str_eq(oid, "c");
+	g_free(oid);
+	ck_assert(mafw_playlist_get_item(playlist, 3, NULL) == NULL);
+
+	/* Playing order */
+	Notified = 0;
+	mafw_playlist_set_repeat(playlist, TRUE);
+	ck_assert(Notified == 1);
+	ck_assert(mafw_playlist_get_repeat(playlist));
+	idx = 2;
+	ck_assert(mafw_playlist_get_next(playlist, &idx, &oid, NULL));
+	ck_assert(idx == 0);
+	ck_assert_str_eq(oid, "c");
+	g_free(oid);
+	ck_assert(mafw_playlist_shuffle(playlist, NULL));
+	ck_assert(Notified == 2);
+	ck_assert(mafw_playlist_is_shuffled(playlist));
+	ck_assert(mafw_playlist_unshuffle(playlist, NULL));
+	ck_assert(!mafw_playlist_is_shuffled(playlist));
+
+	ck_assert(mafw_playlist_clear(playlist, NULL));
+	ck_assert(Last_from == 0 && Last_nremove == 3 && Last_nreplace == 0);
+	ck_assert(mafw_playlist_get_size(playlist, NULL) == 0);
+
+	/* Only the destruction of playlists someone holds is told. */
+	g_object_ref(playlist);
+	ck_assert(mafw_playlist_manager_destroy_playlist(
+				manager, MAFW_PROXY_PLAYLIST(playlist), NULL));
+	ck_assert(Destroyed == 1);
+	ck_assert(mafw_playlist_manager_get_playlist(
+				manager, 1, NULL) == NULL);
+	g_object_unref(playlist);
+}
+END_TEST
+
+START_TEST(test_manager)
+{
+	MafwPlaylistManager *manager;
+	MafwPlaylist *src, *dst, *srcs[2];
+	GArray *list;
+	GError *err;
+	gchar **items;
+	const gchar *oids[] = { "a", "b", NULL };
+
+	manager = mafw_playlist_manager_get();
+	src = new_playlist("src");
+	ck_assert(mafw_playlist_append_items(src, oids, NULL));
+
+	/* The copy has the same items. */
+	dst = MAFW_PLAYLIST(mafw_playlist_manager_dup_playlist(
+				manager, MAFW_PROXY_PLAYLIST(src),
+				"dst", NULL));
+	ck_assert(dst != NULL);
+	ck_assert(mafw_playlist_get_size(dst, NULL) == 2);
+	err = NULL;
+	ck_assert(!mafw_playlist_manager_dup_playlist(
+				manager, MAFW_PROXY_PLAYLIST(src),
+				"dst", &err));
+	ck_assert(err && err->code == MAFW_PLAYLIST_ERROR_INVALID_NAME);
+	g_error_free(err);
+
+	ck_assert(mafw_playlist_manager_copy_range(
+				manager, MAFW_PROXY_PLAYLIST(src), 1, 1,
+				MAFW_PROXY_PLAYLIST(dst), 0, NULL));
+	srcs[0] = src;
+	srcs[1] = dst;
+	ck_assert(mafw_playlist_manager_concat(
+				manager, (MafwProxyPlaylist **)srcs, 2,
+				MAFW_PROXY_PLAYLIST(dst), NULL));
+	ck_assert((items = mafw_playlist_get_items(dst, 0, 99, NULL)));
+	ck_assert(g_strv_length(items) == 8);
+	ck_assert_str_eq(items[0], "b");
+	ck_assert_str_eq(items[3], "a");
+	ck_assert_str_eq(items[5], "b");
+	g_strfreev(items);
+
+	ck_assert((list = mafw_playlist_manager_list_playlists_full(
+				manager, NULL, 0, NULL)));
+	ck_assert(list->len == 2);
+	ck_assert_str_eq(g_array_index(list, MafwPlaylistManagerInfo,
+				       1).name, "dst");
+	ck_assert(g_array_index(list, MafwPlaylistManagerInfo,
+				1).size == 8);
+	mafw_playlist_manager_free_list_of_playlists_full(list);
+
+	/* What needs the daemon is refused. */
+	err = NULL;
+	ck_assert(!mafw_playlist_manager_get_quota(manager, NULL,
+						   NULL, NULL, &err));
+	ck_assert(err && err->code == MAFW_PLAYLIST_ERROR_NOT_SUPPORTED);
+	g_error_free(err);
+	err = NULL;
+	ck_assert(!mafw_proxy_playlist_set_window(MAFW_PROXY_PLAYLIST(dst),
+						  0, 10, &err));
+	ck_assert(err && err->code == MAFW_PLAYLIST_ERROR_NOT_SUPPORTED);
+	g_error_free(err);
+
+	g_object_unref(src);
+	g_object_unref(dst);
+}
+END_TEST
+
+int main(void)
+{
+	Suite *suite;
+	TCase *tc;
+
+	system("test -d '" PLAYLIST_DIR "' && rm -rf '" PLAYLIST_DIR "'");
+	g_setenv("MAFW_PLAYLIST_DIR", PLAYLIST_DIR, TRUE);
+	g_setenv("MAFW_PLAYLIST_EMBEDDED", "1", TRUE);
+
+	suite = suite_create("MafwPlaylistManager embedded");
+	tc = checkmore_add_tcase(suite, "Embedded", test_edit);
+	tcase_add_test(tc, test_manager);
+	return checkmore_run(srunner_create(suite), FALSE);
+}
+
+/* vi: set noexpandtab ts=8 sw=8 cino=t0,(0: */
@@ -449,7 +449,8 @@ START_TEST(test_get_playlists)
 
 	manager = mafw_playlist_manager_get();
 
-	mockbus_expect(mafw_dbus_method(MAFW_PLAYLIST_METHOD_LIST_PLAYLISTS));
+	mockbus_expect(mafw_dbus_method(
+				MAFW_PLAYLIST_METHOD_LIST_PLAYLISTS_FULL));
 	mockbus_error(MAFW_PLAYLIST_ERROR,
 		      MAFW_PLAYLIST_ERROR_PLAYLIST_NOT_FOUND, "Hihi");
 	error = NULL;
@@ -459,8 +460,9 @@ START_TEST(test_get_playlists)
 	g_error_free(error);
 
 	/* Does manager accept the empty reply? */
-	mockbus_expect(mafw_dbus_method(MAFW_PLAYLIST_METHOD_LIST_PLAYLISTS));
-	mockbus_reply(MAFW_DBUS_AST("us"));
+	mockbus_expect(mafw_dbus_method(
+				MAFW_PLAYLIST_METHOD_LIST_PLAYLISTS_FULL));
+	mockbus_reply(MAFW_DBUS_AST("usubbut"));
 	error = NULL;
 	list = mafw_playlist_manager_get_playlists(manager, &error);
 	ck_assert(list);
@@ -485,17 +487,33 @@ START_TEST(test_get_playlists)
 
 	/* Return the two playlists we created plus one more.
 	 * See if the objects are the same. */
-	mockbus_expect(mafw_dbus_method(MAFW_PLAYLIST_METHOD_LIST_PLAYLISTS));
-	mockbus_reply(MAFW_DBUS_AST("us",
+	mockbus_expect(mafw_dbus_method(
+				MAFW_PLAYLIST_METHOD_LIST_PLAYLISTS_FULL));
+	mockbus_reply(MAFW_DBUS_AST("usubbut",
 		MAFW_DBUS_STRUCT(
 			MAFW_DBUS_UINT32(101),
-			MAFW_DBUS_STRING("Entyem-pentyem")),
+			MAFW_DBUS_STRING("Entyem-pentyem"),
+			MAFW_DBUS_UINT32(0),
+			MAFW_DBUS_BOOLEAN(FALSE),
+			MAFW_DBUS_BOOLEAN(FALSE),
+			MAFW_DBUS_UINT32(0),
+			MAFW_DBUS_UINT64((dbus_uint64_t)0)),
 		MAFW_DBUS_STRUCT(
 			MAFW_DBUS_UINT32(404),
-			MAFW_DBUS_STRING("Etyepetyelepetye")),
+			MAFW_DBUS_STRING("Etyepetyelepetye"),
+			MAFW_DBUS_UINT32(0),
+			MAFW_DBUS_BOOLEAN(FALSE),
+			MAFW_DBUS_BOOLEAN(FALSE),
+			MAFW_DBUS_UINT32(0),
+			MAFW_DBUS_UINT64((dbus_uint64_t)0)),
 		MAFW_DBUS_STRUCT(
 			MAFW_DBUS_UINT32(303),
-			MAFW_DBUS_STRING("Ratata"))));
+			MAFW_DBUS_STRING("Ratata"),
+			MAFW_DBUS_UINT32(7),
+			MAFW_DBUS_BOOLEAN(TRUE),
+			MAFW_DBUS_BOOLEAN(FALSE),
+			MAFW_DBUS_UINT32(1),
+			MAFW_DBUS_UINT64((dbus_uint64_t)1234567890))));
 	list = mafw_playlist_manager_get_playlists(manager, NULL);
 	ck_assert(list);
 	ck_assert(list->len == 3);
@@ -503,6 +521,118 @@ START_TEST(test_get_playlists)
 	ck_assert(list->pdata[1] == playlist2);
 	ck_assert(mafw_proxy_playlist_get_id(list->pdata[2]) == 303);
 
+	/* The properties came with the list, no D-BUS traffic expected. */
+	ck_assert_uint_eq(mafw_playlist_get_size(list->pdata[2], NULL), 7);
+	ck_assert(mafw_playlist_get_repeat(list->pdata[2]) == TRUE);
+	ck_assert_uint_eq(mafw_playlist_get_size(list->pdata[0], NULL), 0);
+
+	/* A change signal invalidates the cached size.  The cache is not
+	 * trusted while the signal waits to be dispatched either. */
+	mockbus_incoming(mafw_dbus_signal_full(NULL, MAFW_PLAYLIST_PATH "/303",
+					       MAFW_PLAYLIST_INTERFACE,
+					       MAFW_PLAYLIST_CONTENTS_CHANGED,
+					       MAFW_DBUS_UINT32(303),
+					       MAFW_DBUS_UINT32(7),
+					       MAFW_DBUS_UINT32(0),
+					       MAFW_DBUS_UINT32(1)));
+	mockbus_expect(mafw_dbus_method_full(MAFW_PLAYLIST_SERVICE,
+					     MAFW_PLAYLIST_PATH "/303",
+					     MAFW_PLAYLIST_INTERFACE,
+					     MAFW_PLAYLIST_METHOD_GET_SIZE));
+	mockbus_reply(MAFW_DBUS_UINT32(8));
+	ck_assert_uint_eq(mafw_playlist_get_size(list->pdata[2], NULL), 8);
+	mockbus_deliver(NULL);
+	mockbus_expect(mafw_dbus_method_full(MAFW_PLAYLIST_SERVICE,
+					     MAFW_PLAYLIST_PATH "/303",
+					     MAFW_PLAYLIST_INTERFACE,
+					     MAFW_PLAYLIST_METHOD_GET_SIZE));
+	mockbus_reply(MAFW_DBUS_UINT32(8));
+	ck_assert_uint_eq(mafw_playlist_get_size(list->pdata[2], NULL), 8);
+	ck_assert(mafw_playlist_get_repeat(list->pdata[2]) == TRUE);
+
+	mockbus_finish();
+}
+END_TEST /* }}} */
+
+/* Queues the error an older daemon replies to LIST_PLAYLISTS_FULL. */
+static void reply_unknown_method(void)
+{
+	DBusMessage *msg;
+
+	msg = dbus_message_new(DBUS_MESSAGE_TYPE_ERROR);
+	dbus_message_set_error_name(msg, DBUS_ERROR_UNKNOWN_METHOD);
+	mockbus_reply_msg(msg);
+}
+
+/* Stores the playlists mafw_playlist_manager_get_playlists_async() got
+ * in *@list. */
+static void got_playlists(GObject *manager, GAsyncResult *res,
+			  gpointer list)
+{
+	GError *error = NULL;
+
+	*(GPtrArray **)list = mafw_playlist_manager_get_playlists_finish(
+				MAFW_PLAYLIST_MANAGER(manager), res, &error);
+	ck_assert(!error);
+}
+
+/* Test mafw_playlist_manager_get_playlists() with a daemon without
+ * LIST_PLAYLISTS_FULL. {{{ */
+START_TEST(test_get_playlists_old_daemon)
+{
+	MafwPlaylistManager *manager;
+	GPtrArray *list;
+
+	mockbus_expect(mafw_dbus_method_full(DBUS_SERVICE_DBUS, DBUS_PATH_DBUS,
+                                             DBUS_INTERFACE_DBUS,
+                                             "StartServiceByName",
+                                             MAFW_DBUS_STRING(MAFW_PLAYLIST_SERVICE),
+                                             MAFW_DBUS_UINT32(0)));
+	mockbus_reply(MAFW_DBUS_UINT32(0));
+
+	manager = mafw_playlist_manager_get();
+
+	/* It falls back to listing the ids. */
+	mockbus_expect(mafw_dbus_method(
+				MAFW_PLAYLIST_METHOD_LIST_PLAYLISTS_FULL));
+	reply_unknown_method();
+	mockbus_expect(mafw_dbus_method(MAFW_PLAYLIST_METHOD_LIST_PLAYLISTS));
+	mockbus_reply(MAFW_DBUS_AST("us",
+		MAFW_DBUS_STRUCT(
+			MAFW_DBUS_UINT32(101),
+			MAFW_DBUS_STRING("Entyem-pentyem"))));
+	list = mafw_playlist_manager_get_playlists(manager, NULL);
+	ck_assert(list);
+	ck_assert_uint_eq(list->len, 1);
+	ck_assert_uint_eq(mafw_proxy_playlist_get_id(list->pdata[0]), 101);
+
+	/* Nothing has been cached. */
+	mockbus_expect(mafw_dbus_method_full(MAFW_PLAYLIST_SERVICE,
+					     MAFW_PLAYLIST_PATH "/101",
+					     MAFW_PLAYLIST_INTERFACE,
+					     MAFW_PLAYLIST_METHOD_GET_SIZE));
+	mockbus_reply(MAFW_DBUS_UINT32(5));
+	ck_assert_uint_eq(mafw_playlist_get_size(list->pdata[0], NULL), 5);
+
+	/* The same without blocking. */
+	mockbus_expect(mafw_dbus_method(
+				MAFW_PLAYLIST_METHOD_LIST_PLAYLISTS_FULL));
+	reply_unknown_method();
+	mockbus_expect(mafw_dbus_method(MAFW_PLAYLIST_METHOD_LIST_PLAYLISTS));
+	mockbus_reply(MAFW_DBUS_AST("us",
+		MAFW_DBUS_STRUCT(
+			MAFW_DBUS_UINT32(101),
+			MAFW_DBUS_STRING("Entyem-pentyem")),
+		MAFW_DBUS_STRUCT(
+			MAFW_DBUS_UINT32(404),
+			MAFW_DBUS_STRING("Etyepetyelepetye"))));
+	list = NULL;
+	mafw_playlist_manager_get_playlists_async(manager, got_playlists,
+						  &list);
+	ck_assert(list);
+	ck_assert_uint_eq(list->len, 2);
+	ck_assert_uint_eq(mafw_proxy_playlist_get_id(list->pdata[1]), 404);
+
 	mockbus_finish();
 }
 END_TEST /* }}} */
@@ -583,6 +713,183 @@ START_TEST(test_list_playlists)
 }
 END_TEST /* }}} */
 
+/* Test mafw_playlist_manager_list_playlists_full(). {{{ */
+START_TEST(test_list_playlists_full)
+{
+	GError *error;
+	MafwPlaylistManager *manager;
+	MafwProxyPlaylist *playlist;
+	MafwPlaylistManagerInfo *info;
+	GArray *list;
+
+	mockbus_expect(mafw_dbus_method_full(DBUS_SERVICE_DBUS, DBUS_PATH_DBUS,
+                                             DBUS_INTERFACE_DBUS,
+                                             "StartServiceByName",
+                                             MAFW_DBUS_STRING(MAFW_PLAYLIST_SERVICE),
+                                             MAFW_DBUS_UINT32(0)));
+	mockbus_reply(MAFW_DBUS_UINT32(0));
+
+	manager = mafw_playlist_manager_get();
+
+	mockbus_expect(mafw_dbus_method(
+				MAFW_PLAYLIST_METHOD_LIST_PLAYLISTS_FULL));
+	mockbus_error(MAFW_PLAYLIST_ERROR,
+		      MAFW_PLAYLIST_ERROR_PLAYLIST_NOT_FOUND, "Hihi");
+	error = NULL;
+	list = mafw_playlist_manager_list_playlists_full(manager, NULL, 0,
+							 &error);
+	ck_assert(!list);
+	ck_assert(error);
+	g_error_free(error);
+
+	/* A reply we don't understand is an error too. */
+	mockbus_expect(mafw_dbus_method(
+				MAFW_PLAYLIST_METHOD_LIST_PLAYLISTS_FULL));
+	mockbus_reply(MAFW_DBUS_AST("us"));
+	error = NULL;
+	list = mafw_playlist_manager_list_playlists_full(manager, NULL, 0,
+							 &error);
+	ck_assert(!list);
+	ck_assert(g_error_matches(error, MAFW_PLAYLIST_ERROR,
+				  MAFW_PLAYLIST_ERROR_NOT_SUPPORTED));
+	g_error_free(error);
+
+	/* Make the manager know about 101. */
+	mockbus_expect(mafw_dbus_method(MAFW_PLAYLIST_METHOD_LIST_PLAYLISTS,
+					MAFW_DBUS_C_ARRAY(UINT32,
+							  dbus_uint32_t,
+							  101)));
+	mockbus_reply(MAFW_DBUS_AST("us",
+		MAFW_DBUS_STRUCT(
+			MAFW_DBUS_UINT32(101),
+			MAFW_DBUS_STRING("Entyem-pentyem"))));
+	playlist = mafw_playlist_manager_get_playlist(manager, 101, NULL);
+	ck_assert(playlist);
+
+	/* Ask for a subset, 404 doesn't exist. */
+	mockbus_expect(mafw_dbus_method(
+				MAFW_PLAYLIST_METHOD_LIST_PLAYLISTS_FULL,
+				MAFW_DBUS_C_ARRAY(UINT32, dbus_uint32_t,
+						  101, 404)));
+	mockbus_reply(MAFW_DBUS_AST("usubbut",
+		MAFW_DBUS_STRUCT(
+			MAFW_DBUS_UINT32(101),
+			MAFW_DBUS_STRING("Entyem-pentyem"),
+			MAFW_DBUS_UINT32(3),
+			MAFW_DBUS_BOOLEAN(FALSE),
+			MAFW_DBUS_BOOLEAN(TRUE),
+			MAFW_DBUS_UINT32(2),
+			MAFW_DBUS_UINT64((dbus_uint64_t)1234567890))));
+	error = NULL;
+	list = mafw_playlist_manager_list_playlists_full(
+					manager, (guint[]){ 101, 404 }, 2,
+					&error);
+	ck_assert(list);
+	ck_assert(!error);
+	ck_assert_uint_eq(list->len, 1);
+	info = &g_array_index(list, MafwPlaylistManagerInfo, 0);
+	ck_assert_uint_eq(info->id, 101);
+	ck_assert_str_eq(info->name, "Entyem-pentyem");
+	ck_assert_uint_eq(info->size, 3);
+	ck_assert(!info->repeat);
+	ck_assert(info->shuffled);
+	ck_assert_uint_eq(info->use_count, 2);
+	ck_assert(info->last_modified == 1234567890);
+	mafw_playlist_manager_free_list_of_playlists_full(list);
+	mafw_playlist_manager_free_list_of_playlists_full(NULL);
+
+	/* The known playlist has been primed; no D-BUS traffic. */
+	ck_assert_uint_eq(mafw_playlist_get_size(MAFW_PLAYLIST(playlist),
+						 NULL), 3);
+	ck_assert(!mafw_playlist_get_repeat(MAFW_PLAYLIST(playlist)));
+
+	/* Until we change it. */
+	mockbus_expect(mafw_dbus_method_full(MAFW_PLAYLIST_SERVICE,
+					     MAFW_PLAYLIST_PATH "/101",
+					     MAFW_PLAYLIST_INTERFACE,
+					     MAFW_PLAYLIST_METHOD_CLEAR));
+	mockbus_reply();
+	mockbus_expect(mafw_dbus_method_full(MAFW_PLAYLIST_SERVICE,
+					     MAFW_PLAYLIST_PATH "/101",
+					     MAFW_PLAYLIST_INTERFACE,
+					     MAFW_PLAYLIST_METHOD_GET_SIZE));
+	mockbus_reply(MAFW_DBUS_UINT32(0));
+	ck_assert(mafw_playlist_clear(MAFW_PLAYLIST(playlist), NULL));
+	ck_assert_uint_eq(mafw_playlist_get_size(MAFW_PLAYLIST(playlist),
+						 NULL), 0);
+	g_object_unref(playlist);
+
+	mockbus_finish();
+}
+END_TEST /* }}} */
+
+/* Test mafw_playlist_manager_get_quota(). {{{ */
+START_TEST(test_get_quota)
+{
+	GError *error;
+	MafwPlaylistManager *manager;
+	MafwPlaylistManagerQuota usage, limits;
+
+	mockbus_expect(mafw_dbus_method_full(DBUS_SERVICE_DBUS, DBUS_PATH_DBUS,
+                                             DBUS_INTERFACE_DBUS,
+                                             "StartServiceByName",
+                                             MAFW_DBUS_STRING(MAFW_PLAYLIST_SERVICE),
+                                             MAFW_DBUS_UINT32(0)));
+	mockbus_reply(MAFW_DBUS_UINT32(0));
+
+	manager = mafw_playlist_manager_get();
+
+	/* Our own quota. */
+	mockbus_expect(mafw_dbus_method(MAFW_PLAYLIST_METHOD_GET_QUOTA,
+					MAFW_DBUS_STRING("")));
+	mockbus_reply(MAFW_DBUS_UINT32(2),
+		      MAFW_DBUS_UINT32(30),
+		      MAFW_DBUS_UINT64((dbus_uint64_t)400),
+		      MAFW_DBUS_UINT32(1),
+		      MAFW_DBUS_UINT32(5),
+		      MAFW_DBUS_UINT32(0),
+		      MAFW_DBUS_UINT64((dbus_uint64_t)5000000000ULL),
+		      MAFW_DBUS_UINT32(16));
+	error = NULL;
+	ck_assert(mafw_playlist_manager_get_quota(manager, NULL,
+						  &usage, &limits, &error));
+	ck_assert(!error);
+	ck_assert_uint_eq(usage.playlists, 2);
+	ck_assert_uint_eq(usage.entries, 30);
+	ck_assert(usage.bytes == 400);
+	ck_assert_uint_eq(usage.requests, 1);
+	ck_assert_uint_eq(limits.playlists, 5);
+	ck_assert_uint_eq(limits.entries, 0);
+	ck_assert(limits.bytes == 5000000000ULL);
+	ck_assert_uint_eq(limits.requests, 16);
+
+	/* Someone else's, and an error. */
+	mockbus_expect(mafw_dbus_method(MAFW_PLAYLIST_METHOD_GET_QUOTA,
+					MAFW_DBUS_STRING(":1.42")));
+	mockbus_error(MAFW_PLAYLIST_ERROR,
+		      MAFW_PLAYLIST_ERROR_QUOTA_EXCEEDED, "Too many");
+	error = NULL;
+	ck_assert(!mafw_playlist_manager_get_quota(manager, ":1.42",
+						   &usage, NULL, &error));
+	ck_assert(error);
+	ck_assert_int_eq(error->code, MAFW_PLAYLIST_ERROR_QUOTA_EXCEEDED);
+	g_error_free(error);
+
+	mockbus_finish();
+}
+END_TEST /* }}} */
+
+/* Stores the playlist mafw_playlist_manager_dup_playlist_async() made
+ * in *@dup. */
+static void duplicated(GObject *manager, GAsyncResult *res, gpointer dup)
+{
+	GError *error = NULL;
+
+	*(MafwProxyPlaylist **)dup = mafw_playlist_manager_dup_playlist_finish(
+				MAFW_PLAYLIST_MANAGER(manager), res, &error);
+	ck_assert(!error);
+}
+
 /* Test mafw_playlist_manager_dup_playlist(). {{{ */
 START_TEST(test_dup_playlist)
 {
@@ -635,6 +942,19 @@ GError *error;
 	ck_assert(!playlist2);
 	g_error_free(error);
 
+	/* The same without blocking. */
+	mockbus_expect(mafw_dbus_method(MAFW_PLAYLIST_METHOD_DUP_PLAYLIST,
+					MAFW_DBUS_UINT32(101),
+					MAFW_DBUS_STRING("newname")));
+	mockbus_reply(MAFW_DBUS_UINT32(303));
+	playlist2 = NULL;
+	mafw_playlist_manager_dup_playlist_async(manager, playlist1,
+						 "newname", duplicated,
+						 &playlist2);
+	ck_assert(playlist2);
+	ck_assert_uint_eq(mafw_proxy_playlist_get_id(playlist2), 303);
+	g_object_unref(playlist2);
+
 	mockbus_finish();
 }
 END_TEST /* }}} */
@@ -909,7 +1229,10 @@ if (1)	tcase_add_test(tc, test_playlist_created);
 if (1)	tcase_add_test(tc, test_playlist_destroyed);
 if (1)	tcase_add_test(tc, test_get_playlist);
 if (1)	tcase_add_test(tc, test_get_playlists);
+if (1)	tcase_add_test(tc, test_get_playlists_old_daemon);
 if (1)	tcase_add_test(tc, test_list_playlists);
+if (1)	tcase_add_test(tc, test_list_playlists_full);
+if (1)	tcase_add_test(tc, test_get_quota);
 if (1)	tcase_add_test(tc, test_dup_playlist);
 if (1)	tcase_add_test(tc, test_import_playlist);
 if (1)	tcase_add_test(tc, test_crash);
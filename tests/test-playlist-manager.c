@@ -378,6 +378,60 @@ START_TEST(test_dup_playlists)
 }
 END_TEST /* }}} */
 
+/* Test *_create_smart_playlist(). {{{ */
+START_TEST(test_smart_playlist)
+{
+	MafwPlaylistManager *manager;
+	MafwProxyPlaylist *playlist;
+	GError *err = NULL;
+	gchar *name;
+
+	/* The source doesn't exist, so nothing is browsed and the playlist
+	 * stays empty. */
+	manager = mafw_playlist_manager_get();
+	name = g_strdup_printf("%.8X", g_random_int());
+	playlist = mafw_playlist_manager_create_smart_playlist(manager, name,
+						"nosuchsource::music",
+						"(artist=foo)", "+title",
+						&err);
+	ck_assert(playlist);
+	ck_assert(!err);
+	ck_assert(mafw_playlist_get_size(MAFW_PLAYLIST(playlist), NULL) == 0);
+
+	/* The name is taken. */
+	ck_assert(!mafw_playlist_manager_create_smart_playlist(manager, name,
+						"nosuchsource::music",
+						NULL, NULL, &err));
+	ck_assert(err && err->code == MAFW_PLAYLIST_ERROR_INVALID_NAME);
+	g_clear_error(&err);
+
+	/* Bad definitions. */
+	ck_assert(!mafw_playlist_manager_create_smart_playlist(manager,
+						"smart bad container",
+						"not an object id",
+						NULL, NULL, &err));
+	ck_assert(err && err->code == MAFW_PLAYLIST_ERROR_NOT_SUPPORTED);
+	g_clear_error(&err);
+	ck_assert(!mafw_playlist_manager_create_smart_playlist(manager,
+						"smart bad filter",
+						"nosuchsource::music",
+						"(artist=", NULL, &err));
+	ck_assert(err && err->code == MAFW_PLAYLIST_ERROR_NOT_SUPPORTED);
+	g_clear_error(&err);
+
+	/* Its items cannot be edited, but it can be repeated. */
+	ck_assert(!mafw_playlist_append_item(MAFW_PLAYLIST(playlist),
+					     "src::item", &err));
+	ck_assert(err && err->code == MAFW_PLAYLIST_ERROR_NOT_SUPPORTED);
+	g_clear_error(&err);
+	mafw_playlist_set_repeat(MAFW_PLAYLIST(playlist), TRUE);
+	ck_assert(mafw_playlist_get_repeat(MAFW_PLAYLIST(playlist)));
+
+	mafw_playlist_manager_destroy_playlist(manager, playlist, NULL);
+	g_free(name);
+}
+END_TEST /* }}} */
+
 /* Test *_create_playlist() and *_destroy_playlist() and the signals. {{{ */
 /* Misc {{{ */
 /* Prints some information about $playlist; used to monitor the activities
@@ -784,6 +838,7 @@ int main(int argc, char const *argv[])
 	tcase_add_test(tc, test_get_playlists);
 	tcase_add_test(tc, test_like_a_little_angel);
 	tcase_add_test(tc, test_dup_playlists);
+	tcase_add_test(tc, test_smart_playlist);
 	tcase_set_timeout(tc, timeout);
 	suite_add_tcase(suite, tc);
 
@@ -24,6 +24,7 @@
 
 #include <checkmore.h>
 #include <string.h>
+#include <glib/gstdio.h>
 #include "mockbus.h"
 #include "mocksource.h"
 #include "common/dbus-interface.h"
@@ -53,25 +54,49 @@ static gchar *test_uri_list[] = { "file://test1/test1.pls",
 static gchar **uril;
 
 static gboolean return_parser_error;
-
-TotemPlParserResult
-totem_pl_parser_parse_with_base (TotemPlParser *parser, const char *url,
-				 const char *base, gboolean fallback)
+/* Complete the parsing from an idle callback rather than at once. */
+static gboolean defer_parse;
+
+void
+totem_pl_parser_parse_with_base_async (TotemPlParser *parser, const char *url,
+				       const char *base, gboolean fallback,
+				       GCancellable *cancellable,
+				       GAsyncReadyCallback callback,
+				       gpointer user_data)
 {
+	GSimpleAsyncResult *res;
+	TotemPlParserResult result;
 	gint i = 0;
 
+	res = g_simple_async_result_new(G_OBJECT(parser), callback, user_data,
+				totem_pl_parser_parse_with_base_async);
 	if (return_parser_error)
-		return TOTEM_PL_PARSER_RESULT_UNHANDLED;
-	if (uril)
+		result = TOTEM_PL_PARSER_RESULT_UNHANDLED;
+	else
 	{
-		while (uril[i])
+		result = TOTEM_PL_PARSER_RESULT_SUCCESS;
+		while (uril && uril[i])
 		{
 			g_signal_emit_by_name(parser, "entry-parsed", uril[i],
 						NULL);
 			i++;
 		}
 	}
-	return TOTEM_PL_PARSER_RESULT_SUCCESS;
+	g_simple_async_result_set_op_res_gpointer(res,
+					GINT_TO_POINTER(result), NULL);
+	if (defer_parse)
+		g_simple_async_result_complete_in_idle(res);
+	else
+		g_simple_async_result_complete(res);
+	g_object_unref(res);
+}
+
+TotemPlParserResult
+totem_pl_parser_parse_finish (TotemPlParser *parser, GAsyncResult *res,
+			      GError **error)
+{
+	return GPOINTER_TO_INT(g_simple_async_result_get_op_res_gpointer(
+					G_SIMPLE_ASYNC_RESULT(res)));
 }
 
 START_TEST(test_import_source)
@@ -83,6 +108,7 @@ START_TEST(test_import_source)
 	Pls *pls;
 	DBusMessage *replmsg;
 	DBusMessageIter iter_array, iter_msg;
+	guint i;
 
 
 	metadata = mockbus_mkmeta(MAFW_METADATA_KEY_URI, "http://test.test",
@@ -149,7 +175,7 @@ START_TEST(test_import_source)
 				 MAFW_DBUS_STRING(""),
 				 MAFW_DBUS_STRVZ(MAFW_SOURCE_NO_KEYS),
 				 MAFW_DBUS_UINT32(0),
-				 MAFW_DBUS_UINT32(0)));
+				 MAFW_DBUS_UINT32(1000)));
 	mockbus_reply_msg(mafw_dbus_reply(mdata, MAFW_DBUS_METADATA(metadata)));
 	mockbus_reply_msg(mafw_dbus_reply(browse, MAFW_DBUS_UINT32(3)));
 	mockbus_expect(mafw_dbus_reply(c, MAFW_DBUS_UINT32(2)));
@@ -222,7 +248,7 @@ START_TEST(test_import_source)
 				 MAFW_DBUS_STRING(""),
 				 MAFW_DBUS_STRVZ(MAFW_SOURCE_NO_KEYS),
 				 MAFW_DBUS_UINT32(0),
-				 MAFW_DBUS_UINT32(0)));
+				 MAFW_DBUS_UINT32(1000)));
 	mockbus_reply_msg(mafw_dbus_reply(mdata, MAFW_DBUS_METADATA(metadata)));
 	mockbus_reply_msg(mafw_dbus_reply(browse, MAFW_DBUS_UINT32(4)));
 	mockbus_expect(mafw_dbus_reply(c, MAFW_DBUS_UINT32(3)));
@@ -368,6 +394,56 @@ START_TEST(test_import_source)
 	ck_assert(!strcmp(oid, "urisource::file://test3/test3.pls"));
 	g_free(oid);
 
+	/* A long playlist file reports its progress every 500 entries. */
+	uril = g_new0(gchar *, 1001);
+	for (i = 0; i < 1000; i++)
+		uril[i] = g_strdup_printf("file://test/%u.mp3", i);
+	mockbus_incoming(c = mafw_dbus_method_full(MAFW_PLAYLIST_SERVICE,
+				  MAFW_PLAYLIST_PATH,
+				  MAFW_PLAYLIST_INTERFACE,
+				  MAFW_PLAYLIST_METHOD_IMPORT_PLAYLIST,
+				  MAFW_DBUS_STRING("file://test/long.m3u"),
+				  MAFW_DBUS_STRING("")));
+	mockbus_expect(mafw_dbus_method_full(
+				"dummy.service.name",
+				MAFW_PLAYLIST_PATH,
+				MAFW_PLAYLIST_INTERFACE,
+				MAFW_PLAYLIST_METHOD_PLAYLIST_IMPORT_PROGRESS,
+				MAFW_DBUS_UINT32(7),
+				MAFW_DBUS_UINT32(500)));
+	mockbus_expect(mafw_dbus_method_full(
+				"dummy.service.name",
+				MAFW_PLAYLIST_PATH,
+				MAFW_PLAYLIST_INTERFACE,
+				MAFW_PLAYLIST_METHOD_PLAYLIST_IMPORT_PROGRESS,
+				MAFW_DBUS_UINT32(7),
+				MAFW_DBUS_UINT32(1000)));
+	mockbus_expect(mafw_dbus_method_full(
+				"dummy.service.name",
+				MAFW_PLAYLIST_PATH,
+				MAFW_PLAYLIST_INTERFACE,
+				MAFW_PLAYLIST_METHOD_PLAYLIST_IMPORTED,
+				MAFW_DBUS_UINT32(7),
+				MAFW_DBUS_UINT32(4)));
+	mockbus_expect(mafw_dbus_signal_full(
+                               NULL, MAFW_PLAYLIST_PATH,
+                               MAFW_PLAYLIST_INTERFACE,
+                               MAFW_PLAYLIST_SIGNAL_PLAYLIST_CREATED,
+                               MAFW_DBUS_UINT32(4)));
+	mockbus_expect(mafw_dbus_reply(c, MAFW_DBUS_UINT32(7)));
+
+	mockbus_deliver(NULL);
+	mockbus_finish();
+
+	pls = g_tree_lookup(Playlists, GUINT_TO_POINTER(4));
+	ck_assert(pls);
+	ck_assert_int_eq(pls->len, 1000);
+	oid = pls_get_item(pls, 999);
+	ck_assert(!strcmp(oid, "urisource::file://test/999.mp3"));
+	g_free(oid);
+	g_strfreev(uril);
+	uril = NULL;
+
 	/* Cancel a non-existing request */
 	mockbus_incoming(c = mafw_dbus_method_full(MAFW_PLAYLIST_SERVICE,
 				  MAFW_PLAYLIST_PATH,
@@ -388,11 +464,21 @@ START_TEST(test_import_source)
 				  MAFW_PLAYLIST_METHOD_IMPORT_PLAYLIST,
 				  MAFW_DBUS_STRING("file://test/test.pls"),
 				  MAFW_DBUS_STRING("")));
-	mockbus_expect(mafw_dbus_error(c, MAFW_PLAYLIST_ERROR,
-					MAFW_PLAYLIST_ERROR_IMPORT_FAILED,
-					"Playlist parsing failed."));
+	mockbus_expect(mafw_dbus_method_full(
+				"dummy.service.name",
+				MAFW_PLAYLIST_PATH,
+				MAFW_PLAYLIST_INTERFACE,
+				MAFW_PLAYLIST_METHOD_PLAYLIST_IMPORTED,
+				MAFW_DBUS_UINT32(8),
+				MAFW_DBUS_STRING(
+					g_quark_to_string(MAFW_PLAYLIST_ERROR)),
+				MAFW_DBUS_INT32(
+					MAFW_PLAYLIST_ERROR_IMPORT_FAILED),
+				MAFW_DBUS_STRING("Playlist parsing failed.")));
+	mockbus_expect(mafw_dbus_reply(c, MAFW_DBUS_UINT32(8)));
 	mockbus_deliver(NULL);
 	mockbus_finish();
+	return_parser_error = FALSE;
 
 	return;
 }
@@ -503,7 +589,7 @@ START_TEST(test_cancel_import)
 				 MAFW_DBUS_STRING(""),
 				 MAFW_DBUS_STRVZ(MAFW_SOURCE_NO_KEYS),
 				 MAFW_DBUS_UINT32(0),
-				 MAFW_DBUS_UINT32(0)));
+				 MAFW_DBUS_UINT32(1000)));
 	mockbus_reply_msg(mafw_dbus_reply(mdata, MAFW_DBUS_METADATA(metadata)));
 	mockbus_reply_msg(mafw_dbus_reply(browse, MAFW_DBUS_UINT32(4)));
 	mockbus_expect(mafw_dbus_reply(c, MAFW_DBUS_UINT32(2)));
@@ -523,6 +609,15 @@ START_TEST(test_cancel_import)
                                              MAFW_SOURCE_METHOD_CANCEL_BROWSE,
                                              MAFW_DBUS_UINT32(4)));
 	mockbus_reply_msg(mafw_dbus_reply(cancel_browse));
+	mockbus_expect(mafw_dbus_method_full(
+				"dummy.service.name",
+				MAFW_PLAYLIST_PATH,
+				MAFW_PLAYLIST_INTERFACE,
+				MAFW_PLAYLIST_METHOD_PLAYLIST_IMPORTED,
+				MAFW_DBUS_UINT32(2),
+				MAFW_DBUS_STRING(g_quark_to_string(G_IO_ERROR)),
+				MAFW_DBUS_INT32(G_IO_ERROR_CANCELLED),
+				MAFW_DBUS_STRING("Import cancelled")));
 	mockbus_expect(mafw_dbus_reply(c));
 
 	/* First browse OK */
@@ -565,7 +660,7 @@ START_TEST(test_cancel_import)
 				 MAFW_DBUS_STRING(""),
 				 MAFW_DBUS_STRVZ(MAFW_SOURCE_NO_KEYS),
 				 MAFW_DBUS_UINT32(0),
-				 MAFW_DBUS_UINT32(0)));
+				 MAFW_DBUS_UINT32(1000)));
 	mockbus_reply_msg(mafw_dbus_reply(mdata, MAFW_DBUS_METADATA(metadata)));
 	mockbus_reply_msg(mafw_dbus_reply(browse, MAFW_DBUS_UINT32(4)));
 	mockbus_expect(mafw_dbus_reply(c, MAFW_DBUS_UINT32(3)));
@@ -591,6 +686,15 @@ START_TEST(test_cancel_import)
                                              MAFW_SOURCE_METHOD_CANCEL_BROWSE,
                                              MAFW_DBUS_UINT32(4)));
 	mockbus_reply_msg(mafw_dbus_reply(cancel_browse));
+	mockbus_expect(mafw_dbus_method_full(
+				"dummy.service.name",
+				MAFW_PLAYLIST_PATH,
+				MAFW_PLAYLIST_INTERFACE,
+				MAFW_PLAYLIST_METHOD_PLAYLIST_IMPORTED,
+				MAFW_DBUS_UINT32(3),
+				MAFW_DBUS_STRING(g_quark_to_string(G_IO_ERROR)),
+				MAFW_DBUS_INT32(G_IO_ERROR_CANCELLED),
+				MAFW_DBUS_STRING("Import cancelled")));
 	mockbus_expect(mafw_dbus_reply(c));
 
 	replmsg = append_browse_res(NULL, &iter_msg, &iter_array, 4, 2, 1,
@@ -605,14 +709,360 @@ START_TEST(test_cancel_import)
 	mafw_metadata_release(metadata);
 	mockbus_finish();
 
+	/* Cancel a file import while it is being parsed */
+	uril = test_uri_list;
+	defer_parse = TRUE;
+	mockbus_incoming(c = mafw_dbus_method_full(MAFW_PLAYLIST_SERVICE,
+				  MAFW_PLAYLIST_PATH,
+				  MAFW_PLAYLIST_INTERFACE,
+				  MAFW_PLAYLIST_METHOD_IMPORT_PLAYLIST,
+				  MAFW_DBUS_STRING("file://test/test.pls"),
+				  MAFW_DBUS_STRING("")));
+	mockbus_expect(mafw_dbus_reply(c, MAFW_DBUS_UINT32(4)));
+	mockbus_deliver(NULL);
+
+	mockbus_incoming(c = mafw_dbus_method_full(MAFW_PLAYLIST_SERVICE,
+				  MAFW_PLAYLIST_PATH,
+				  MAFW_PLAYLIST_INTERFACE,
+				  MAFW_PLAYLIST_METHOD_CANCEL_IMPORT,
+				  MAFW_DBUS_UINT32(4)));
+	mockbus_expect(mafw_dbus_reply(c));
+	mockbus_deliver(NULL);
+
+	mockbus_expect(mafw_dbus_method_full(
+				"dummy.service.name",
+				MAFW_PLAYLIST_PATH,
+				MAFW_PLAYLIST_INTERFACE,
+				MAFW_PLAYLIST_METHOD_PLAYLIST_IMPORTED,
+				MAFW_DBUS_UINT32(4),
+				MAFW_DBUS_STRING(g_quark_to_string(G_IO_ERROR)),
+				MAFW_DBUS_INT32(G_IO_ERROR_CANCELLED),
+				MAFW_DBUS_STRING("Import cancelled")));
+	while (g_main_context_iteration(NULL, FALSE));
+	mockbus_finish();
+	defer_parse = FALSE;
+
 	return;
 }
 END_TEST
 
+START_TEST(test_import_paged)
+{
+	DBusMessage *c, *mdata, *browse;
+	GHashTable *metadata, *container;
+	extern GTree *Playlists;
+	DBusMessage *replmsg;
+	DBusMessageIter iter_array, iter_msg;
+	Pls *pls;
+	gchar *oid;
+	guint i;
+
+	metadata = mockbus_mkmeta(MAFW_METADATA_KEY_URI, "http://test.test",
+                                  MAFW_METADATA_KEY_MIME,
+                                  MAFW_METADATA_VALUE_MIME_CONTAINER,
+                                  NULL);
+	container = mockbus_mkmeta(MAFW_METADATA_KEY_MIME,
+				   MAFW_METADATA_VALUE_MIME_CONTAINER,
+				   NULL);
+
+	mockbus_reset();
+	mockbus_expect(mafw_dbus_method_full(
+			       DBUS_SERVICE_DBUS,
+			       DBUS_PATH_DBUS,
+			       DBUS_INTERFACE_DBUS,
+			       "RequestName",
+			       MAFW_DBUS_STRING(MAFW_PLAYLIST_SERVICE),
+			       MAFW_DBUS_UINT32(4)
+			       ));
+	mockbus_reply(MAFW_DBUS_UINT32(1));
+	mock_services(NULL);
+	mafw_shared_deinit();
+	init_playlist_wrapper(dbus_bus_get(0, NULL), TRUE, FALSE);
+	mock_appearing_extension(FAKE_SOURCE_SERVICE, TRUE);
+	mock_empty_props(FAKE_SOURCE_SERVICE, FAKE_SOURCE_OBJECT);
+
+	/* Recursive import of a container of 1002 items */
+	mockbus_incoming(c = mafw_dbus_method_full(MAFW_PLAYLIST_SERVICE,
+				  MAFW_PLAYLIST_PATH,
+				  MAFW_PLAYLIST_INTERFACE,
+				  MAFW_PLAYLIST_METHOD_IMPORT_PLAYLIST,
+				  MAFW_DBUS_STRING(FAKE_SOURCE_NAME "::"),
+				  MAFW_DBUS_STRING(""),
+				  MAFW_DBUS_BOOLEAN(TRUE)));
+	mockbus_expect(mdata =
+                       mafw_dbus_method_full(
+                               FAKE_SOURCE_SERVICE,
+                               FAKE_SOURCE_OBJECT,
+                               MAFW_SOURCE_INTERFACE,
+                               MAFW_SOURCE_METHOD_GET_METADATA,
+                               MAFW_DBUS_STRING(FAKE_SOURCE_NAME "::"),
+                               MAFW_DBUS_STRVZ(
+                                       MAFW_SOURCE_LIST(
+                                               MAFW_METADATA_KEY_URI,
+                                               MAFW_METADATA_KEY_MIME))));
+	mockbus_expect(browse = mafw_dbus_method_full(FAKE_SOURCE_SERVICE,
+				 FAKE_SOURCE_OBJECT,
+				 MAFW_SOURCE_INTERFACE,
+				 MAFW_SOURCE_METHOD_BROWSE,
+				 MAFW_DBUS_STRING(FAKE_SOURCE_NAME "::"),
+				 MAFW_DBUS_BOOLEAN(TRUE),
+				 MAFW_DBUS_STRING(""),
+				 MAFW_DBUS_STRING(""),
+				 MAFW_DBUS_STRVZ(MAFW_SOURCE_LIST(
+						 MAFW_METADATA_KEY_MIME)),
+				 MAFW_DBUS_UINT32(0),
+				 MAFW_DBUS_UINT32(1000)));
+	mockbus_reply_msg(mafw_dbus_reply(mdata, MAFW_DBUS_METADATA(metadata)));
+	mockbus_reply_msg(mafw_dbus_reply(browse, MAFW_DBUS_UINT32(4)));
+	mockbus_expect(mafw_dbus_reply(c, MAFW_DBUS_UINT32(1)));
+	mockbus_deliver(NULL);
+	mockbus_deliver(NULL);
+
+	/* A full first page, whose first item is a subcontainer.
+	 * The playlist is created and the next page is requested. */
+	replmsg = NULL;
+	for (i = 0; i < 1000; i++) {
+		oid = g_strdup_printf("test::oid%u", i);
+		replmsg = append_browse_res(replmsg, &iter_msg, &iter_array,
+					    4, 999 - i, i, oid,
+					    i ? NULL : container, "", 0, "");
+		g_free(oid);
+	}
+	dbus_message_iter_close_container(&iter_msg, &iter_array);
+	mockbus_incoming(replmsg);
+
+	mockbus_expect(mafw_dbus_method_full(
+				"dummy.service.name",
+				MAFW_PLAYLIST_PATH,
+				MAFW_PLAYLIST_INTERFACE,
+				MAFW_PLAYLIST_METHOD_PLAYLIST_IMPORT_PROGRESS,
+				MAFW_DBUS_UINT32(1),
+				MAFW_DBUS_UINT32(500)));
+	mockbus_expect(mafw_dbus_signal_full(
+                               NULL, MAFW_PLAYLIST_PATH,
+                               MAFW_PLAYLIST_INTERFACE,
+                               MAFW_PLAYLIST_SIGNAL_PLAYLIST_CREATED,
+                               MAFW_DBUS_UINT32(1)));
+	mockbus_expect(browse = mafw_dbus_method_full(FAKE_SOURCE_SERVICE,
+				 FAKE_SOURCE_OBJECT,
+				 MAFW_SOURCE_INTERFACE,
+				 MAFW_SOURCE_METHOD_BROWSE,
+				 MAFW_DBUS_STRING(FAKE_SOURCE_NAME "::"),
+				 MAFW_DBUS_BOOLEAN(TRUE),
+				 MAFW_DBUS_STRING(""),
+				 MAFW_DBUS_STRING(""),
+				 MAFW_DBUS_STRVZ(MAFW_SOURCE_LIST(
+						 MAFW_METADATA_KEY_MIME)),
+				 MAFW_DBUS_UINT32(1000),
+				 MAFW_DBUS_UINT32(1000)));
+	mockbus_reply_msg(mafw_dbus_reply(browse, MAFW_DBUS_UINT32(5)));
+	mockbus_deliver(NULL);
+
+	pls = g_tree_lookup(Playlists, GUINT_TO_POINTER(1));
+	ck_assert(pls);
+	ck_assert_int_eq(pls->len, 999);
+
+	/* The last, partial page finishes the import. */
+	replmsg = append_browse_res(NULL, &iter_msg, &iter_array, 5, 1, 1000,
+				"test::oid1000", NULL, "", 0, "");
+	replmsg = append_browse_res(replmsg, &iter_msg, &iter_array, 5, 0,
+				1001, "test::oid1001", NULL, "", 0, "");
+	dbus_message_iter_close_container(&iter_msg, &iter_array);
+	mockbus_incoming(replmsg);
+
+	mockbus_expect(mafw_dbus_method_full(
+				"dummy.service.name",
+				MAFW_PLAYLIST_PATH,
+				MAFW_PLAYLIST_INTERFACE,
+				MAFW_PLAYLIST_METHOD_PLAYLIST_IMPORT_PROGRESS,
+				MAFW_DBUS_UINT32(1),
+				MAFW_DBUS_UINT32(1000)));
+	/* The playlist has been announced, so it's told to grow. */
+	mockbus_expect(mafw_dbus_signal_full(
+			       NULL, MAFW_PLAYLIST_PATH "/1",
+			       MAFW_PLAYLIST_INTERFACE,
+			       MAFW_PLAYLIST_CONTENTS_CHANGED,
+			       MAFW_DBUS_UINT32(1),
+			       MAFW_DBUS_UINT32(999),
+			       MAFW_DBUS_UINT32(0),
+			       MAFW_DBUS_UINT32(2)));
+	mockbus_expect(mafw_dbus_method_full(
+				"dummy.service.name",
+				MAFW_PLAYLIST_PATH,
+				MAFW_PLAYLIST_INTERFACE,
+				MAFW_PLAYLIST_METHOD_PLAYLIST_IMPORTED,
+				MAFW_DBUS_UINT32(1),
+				MAFW_DBUS_UINT32(1)));
+	mockbus_deliver(NULL);
+	mockbus_finish();
+
+	ck_assert_int_eq(pls->len, 1001);
+	oid = pls_get_item(pls, 0);
+	ck_assert_str_eq(oid, "test::oid1");
+	g_free(oid);
+	oid = pls_get_item(pls, 1000);
+	ck_assert_str_eq(oid, "test::oid1001");
+	g_free(oid);
+
+	mafw_metadata_release(metadata);
+	mafw_metadata_release(container);
+}
+END_TEST
+
+/* Imports @fname (relative to the cwd) and returns the new playlist. */
+static Pls *import_native(const gchar *fname, const gchar *contents,
+			  guint import_id)
+{
+	extern GTree *Playlists;
+	DBusMessage *c;
+	gchar *cwd, *path, *uri;
+
+	ck_assert(g_file_set_contents(fname, contents, -1, NULL));
+	cwd = g_get_current_dir();
+	path = g_build_filename(cwd, fname, NULL);
+	uri = g_filename_to_uri(path, NULL, NULL);
+	g_free(cwd);
+
+	mockbus_incoming(c = mafw_dbus_method_full(MAFW_PLAYLIST_SERVICE,
+				  MAFW_PLAYLIST_PATH,
+				  MAFW_PLAYLIST_INTERFACE,
+				  MAFW_PLAYLIST_METHOD_IMPORT_PLAYLIST,
+				  MAFW_DBUS_STRING(uri),
+				  MAFW_DBUS_STRING("")));
+	mockbus_expect(mafw_dbus_reply(c, MAFW_DBUS_UINT32(import_id)));
+	mockbus_deliver(NULL);
+
+	/* The playlist ids follow the import ids in this test. */
+	mockbus_expect(mafw_dbus_method_full(
+				"dummy.service.name",
+				MAFW_PLAYLIST_PATH,
+				MAFW_PLAYLIST_INTERFACE,
+				MAFW_PLAYLIST_METHOD_PLAYLIST_IMPORTED,
+				MAFW_DBUS_UINT32(import_id),
+				MAFW_DBUS_UINT32(import_id)));
+	mockbus_expect(mafw_dbus_signal_full(
+                               NULL, MAFW_PLAYLIST_PATH,
+                               MAFW_PLAYLIST_INTERFACE,
+                               MAFW_PLAYLIST_SIGNAL_PLAYLIST_CREATED,
+                               MAFW_DBUS_UINT32(import_id)));
+	/* The file is read in a worker thread. */
+	while (!g_tree_lookup(Playlists, GUINT_TO_POINTER(import_id)))
+		g_main_context_iteration(NULL, TRUE);
+	while (g_main_context_iteration(NULL, FALSE));
+	mockbus_finish();
+
+	g_unlink(fname);
+	g_free(path);
+	g_free(uri);
+	return g_tree_lookup(Playlists, GUINT_TO_POINTER(import_id));
+}
+
+/* Checks that @pls contains the URIs @uris, in this order. */
+static void check_native(Pls *pls, const gchar *const *uris)
+{
+	guint i;
+
+	ck_assert(pls);
+	for (i = 0; uris[i]; i++) {
+		gchar *oid, *expected;
+
+		expected = mafw_source_create_objectid(uris[i]);
+		oid = pls_get_item(pls, i);
+		ck_assert_str_eq(oid, expected);
+		g_free(oid);
+		g_free(expected);
+	}
+	ck_assert_int_eq(pls->len, i);
+}
+
+START_TEST(test_import_native)
+{
+	gchar *cwd, *rel;
+
+	mockbus_reset();
+	mockbus_expect(mafw_dbus_method_full(
+			       DBUS_SERVICE_DBUS,
+			       DBUS_PATH_DBUS,
+			       DBUS_INTERFACE_DBUS,
+			       "RequestName",
+			       MAFW_DBUS_STRING(MAFW_PLAYLIST_SERVICE),
+			       MAFW_DBUS_UINT32(4)
+			       ));
+	mockbus_reply(MAFW_DBUS_UINT32(1));
+	mock_services(NULL);
+	mafw_shared_deinit();
+	init_playlist_wrapper(dbus_bus_get(0, NULL), TRUE, FALSE);
+
+	/* totem-pl-parser is mocked, it must not be reached. */
+	return_parser_error = TRUE;
+	cwd = g_get_current_dir();
+	rel = g_strdup_printf("file://%s/sub/b%%20c.mp3", cwd);
+
+	/* Extended M3U, relative and absolute paths and URIs */
+	{
+		const gchar *uris[] = {
+			"file:///music/a.mp3",
+			rel,
+			"http://radio.test/stream",
+			NULL
+		};
+
+		check_native(import_native("plimport.m3u",
+					   "#EXTM3U\r\n"
+					   "#EXTINF:123,Artist - A\r\n"
+					   "/music/a.mp3\r\n"
+					   "\r\n"
+					   "sub/b c.mp3\r\n"
+					   "# comment\r\n"
+					   "http://radio.test/stream\r\n",
+					   1), uris);
+	}
+
+	/* PLS, only the FileN keys make entries */
+	{
+		const gchar *uris[] = {
+			"http://radio.test/stream",
+			"file:///music/a.mp3",
+			rel,
+			NULL
+		};
+
+		check_native(import_native("plimport.pls",
+					   "[playlist]\n"
+					   "File1=http://radio.test/stream\n"
+					   "Title1=Radio\n"
+					   "Length1=-1\n"
+					   "file2=/music/a.mp3\n"
+					   "File3=sub/b c.mp3\n"
+					   "NumberOfEntries=3\n"
+					   "Version=2\n",
+					   2), uris);
+	}
+
+	/* Plain M3U without a trailing newline */
+	{
+		const gchar *uris[] = {
+			"file:///music/a.mp3",
+			"file:///music/d.ogg",
+			NULL
+		};
+
+		check_native(import_native("plimport.M3U",
+					   "/music/a.mp3\n/music/d.ogg",
+					   3), uris);
+	}
+
+	g_free(rel);
+	g_free(cwd);
+	return_parser_error = FALSE;
+}
+END_TEST
+
 static Suite *pluginwrapper_suite(void)
 {
 	Suite *suite;
-	TCase *tc_import_src, *tc_cancel_import ;
+	TCase *tc_import_src, *tc_cancel_import, *tc_import_native;
+	TCase *tc_import_paged;
 
 	suite = suite_create("Playlist-mngr-wrapper-import");
 	if (1){ tc_import_src = checkmore_add_tcase(suite, "Import source",
@@ -623,6 +1073,14 @@ static Suite *pluginwrapper_suite(void)
 			    test_cancel_import);
 		tcase_set_timeout(tc_cancel_import, 60);
 	}
+	if (1){ tc_import_paged = checkmore_add_tcase(suite, "Import paged",
+			    test_import_paged);
+		tcase_set_timeout(tc_import_paged, 60);
+	}
+	if (1){ tc_import_native = checkmore_add_tcase(suite, "Import native",
+			    test_import_native);
+		tcase_set_timeout(tc_import_native, 60);
+	}
 	/*valgrind needs more time to execute*/
 
 
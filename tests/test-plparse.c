@@ -0,0 +1,171 @@
+/*
+ * This file is a part of MAFW
+ *
+ * Copyright (C) 2007, 2008, 2009 Nokia Corporation, all rights reserved.
+ *
+ * Contact: Visa Smolander <visa.smolander@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+
+/*
+ * Checks that the native playlist parser of the daemon makes the same
+ * object ids of the same files as totem-pl-parser, which is used for
+ * everything the native parser doesn't handle.
+ */
+
+#include <string.h>
+
+#include <check.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <libmafw/mafw-source.h>
+#include <totem-pl-parser.h>
+
+#include <checkmore.h>
+#include "../mafw-playlist-daemon/mpd-internal.h"
+
+/* The playlist files are written in PLS_DIR. */
+#define PLS_DIR		"testplparse"
+
+static void native_entry(const gchar *uri, GPtrArray *oids)
+{
+	g_ptr_array_add(oids, mafw_source_create_objectid(uri));
+}
+
+static void totem_entry(TotemPlParser *parser, const gchar *uri,
+			gpointer metadata, GPtrArray *oids)
+{
+	g_ptr_array_add(oids, mafw_source_create_objectid(uri));
+}
+
+/* Writes $contents to $fname in PLS_DIR, parses it with both parsers and
+ * checks that they agree.  Returns the number of entries. */
+static guint compare(const gchar *fname, const gchar *contents)
+{
+	GPtrArray *noids, *toids;
+	TotemPlParser *parser;
+	gchar *cwd, *path, *uri;
+	Plparse *p;
+	guint i, n;
+
+	cwd = g_get_current_dir();
+	path = g_build_filename(cwd, PLS_DIR, fname, NULL);
+	uri = g_filename_to_uri(path, NULL, NULL);
+	g_free(cwd);
+	ck_assert(g_file_set_contents(path, contents, -1, NULL));
+
+	noids = g_ptr_array_new_with_free_func(g_free);
+	p = plparse_open(uri, NULL);
+	ck_assert(p);
+	while (plparse_read(p, 16, (PlparseEntryFunc)native_entry, noids,
+			    NULL))
+		/* until EOF */;
+	plparse_close(p);
+
+	toids = g_ptr_array_new_with_free_func(g_free);
+	parser = totem_pl_parser_new();
+	g_object_set(parser, "recurse", FALSE, "disable-unsafe", TRUE, NULL);
+	g_signal_connect(parser, "entry-parsed", G_CALLBACK(totem_entry),
+			 toids);
+	ck_assert_int_eq(totem_pl_parser_parse_with_base(parser, uri, NULL,
+							 FALSE),
+			 TOTEM_PL_PARSER_RESULT_SUCCESS);
+	g_object_unref(parser);
+
+	ck_assert_uint_eq(noids->len, toids->len);
+	for (i = 0; i < noids->len; i++)
+		ck_assert_str_eq(noids->pdata[i], toids->pdata[i]);
+	n = noids->len;
+
+	g_ptr_array_free(noids, TRUE);
+	g_ptr_array_free(toids, TRUE);
+	g_unlink(path);
+	g_free(path);
+	g_free(uri);
+	return n;
+}
+
+/* The files test-plmngr-import imports natively. */
+START_TEST(test_fixtures)
+{
+	ck_assert_uint_eq(compare("plimport.m3u",
+				  "#EXTM3U\r\n"
+				  "#EXTINF:123,Artist - A\r\n"
+				  "/music/a.mp3\r\n"
+				  "\r\n"
+				  "sub/b c.mp3\r\n"
+				  "# comment\r\n"
+				  "http://radio.test/stream\r\n"), 3);
+	ck_assert_uint_eq(compare("plimport.pls",
+				  "[playlist]\n"
+				  "File1=http://radio.test/stream\n"
+				  "Title1=Radio\n"
+				  "Length1=-1\n"
+				  "file2=/music/a.mp3\n"
+				  "File3=sub/b c.mp3\n"
+				  "NumberOfEntries=3\n"
+				  "Version=2\n"), 3);
+	ck_assert_uint_eq(compare("plimport.M3U",
+				  "/music/a.mp3\n/music/d.ogg"), 2);
+}
+END_TEST
+
+/* A longer one, read in several chunks, going up the tree too. */
+START_TEST(test_long)
+{
+	GString *contents;
+	guint i;
+
+	contents = g_string_new("#EXTM3U\n");
+	for (i = 0; i < 1000; i++)
+		g_string_append_printf(contents,
+				       "#EXTINF:%u,Artist %u - Title %u\n"
+				       "%s/music/album %u/track %u.mp3\n",
+				       i, i / 10, i, i % 2 ? "" : "..",
+				       i / 10, i);
+	ck_assert_uint_eq(compare("long.m3u", contents->str), 1000);
+	g_string_free(contents, TRUE);
+}
+END_TEST
+
+/*****************************************************************************
+ * Test case management
+ *****************************************************************************/
+
+static Suite *plparse_suite(void)
+{
+	Suite *suite;
+
+	suite = suite_create("Native playlist parser");
+	if (1)	checkmore_add_tcase(suite, "Fixtures", test_fixtures);
+	if (1)	checkmore_add_tcase(suite, "Long", test_long);
+	return suite;
+}
+
+/*****************************************************************************
+ * Test case execution
+ *****************************************************************************/
+
+int main(void)
+{
+	g_mkdir(PLS_DIR, 0755);
+	return checkmore_run(srunner_create(plparse_suite()), FALSE);
+}
+
+/* vi: set noexpandtab ts=8 sw=8 cino=t0,(0: */
@@ -27,6 +27,8 @@
 #include <string.h>
 #include <signal.h>
 #include <libmafw/mafw-playlist.h>
+#include <libmafw/mafw-metadata.h>
+#include <libmafw/mafw-metadata-serializer.h>
 
 #include <glib.h>
 #include <check.h>
@@ -607,6 +609,791 @@ START_TEST(test_usecount)
 }
 END_TEST
 
+START_TEST(test_batch)
+{
+	MafwProxyPlaylist *pl = NULL;
+	MafwProxyPlaylistBatch *batch;
+	GError *err = NULL;
+	GArray *results = NULL;
+	const gchar *oids[] = {"test::a", "test::b", NULL};
+
+	mockbus_reset();
+
+	mockbus_expect(mafw_dbus_method(
+			       MAFW_PLAYLIST_METHOD_APPLY_OPS,
+			       MAFW_DBUS_AST("uuuas",
+				MAFW_DBUS_STRUCT(
+					MAFW_DBUS_UINT32(MAFW_PLAYLIST_OP_APPEND),
+					MAFW_DBUS_UINT32(0),
+					MAFW_DBUS_UINT32(0),
+					MAFW_DBUS_STRVZ(oids)),
+				MAFW_DBUS_STRUCT(
+					MAFW_DBUS_UINT32(MAFW_PLAYLIST_OP_MOVE),
+					MAFW_DBUS_UINT32(1),
+					MAFW_DBUS_UINT32(0),
+					MAFW_DBUS_STRVZ(NULL)),
+				MAFW_DBUS_STRUCT(
+					MAFW_DBUS_UINT32(MAFW_PLAYLIST_OP_REMOVE),
+					MAFW_DBUS_UINT32(0),
+					MAFW_DBUS_UINT32(5),
+					MAFW_DBUS_STRVZ(NULL)))));
+	mockbus_reply(MAFW_DBUS_C_ARRAY(BOOLEAN, dbus_bool_t,
+					TRUE, TRUE, FALSE));
+
+	pl = MAFW_PROXY_PLAYLIST(mafw_proxy_playlist_new(1));
+	ck_assert_msg(pl != NULL, "Failed to create MafwProxyPlaylist");
+
+	batch = mafw_proxy_playlist_batch_new();
+	mafw_proxy_playlist_batch_append(batch, oids);
+	mafw_proxy_playlist_batch_move(batch, 1, 0);
+	mafw_proxy_playlist_batch_remove(batch, 0, 5);
+	ck_assert(!mafw_proxy_playlist_apply_batch(pl, batch, &results, &err));
+	ck_assert(err != NULL);
+	ck_assert(err->code == MAFW_PLAYLIST_ERROR_INVALID_INDEX);
+	g_error_free(err);
+	err = NULL;
+	ck_assert_uint_eq(results->len, 3);
+	ck_assert(g_array_index(results, gboolean, 0));
+	ck_assert(g_array_index(results, gboolean, 1));
+	ck_assert(!g_array_index(results, gboolean, 2));
+	g_array_free(results, TRUE);
+	mafw_proxy_playlist_batch_free(batch);
+
+	/* An empty batch is a valid one. */
+	mockbus_expect(mafw_dbus_method(
+			       MAFW_PLAYLIST_METHOD_APPLY_OPS,
+			       MAFW_DBUS_AST("uuuas")));
+	mockbus_reply(DBUS_TYPE_ARRAY, DBUS_TYPE_BOOLEAN, NULL, 0);
+	batch = mafw_proxy_playlist_batch_new();
+	ck_assert(mafw_proxy_playlist_apply_batch(pl, batch, NULL, &err));
+	ck_assert(!err);
+	mafw_proxy_playlist_batch_free(batch);
+
+	g_object_unref(pl);
+
+	mockbus_finish();
+}
+END_TEST
+
+START_TEST(test_get_next_n)
+{
+	MafwProxyPlaylist *pl = NULL;
+	GError *err = NULL;
+	const gchar *next[] = {"test::c", "test::a", NULL};
+	gchar **oids;
+	guint *indices;
+
+	mockbus_reset();
+	pl = MAFW_PROXY_PLAYLIST(mafw_proxy_playlist_new(1));
+	ck_assert_msg(pl != NULL, "Failed to create MafwProxyPlaylist");
+
+	mockbus_expect(mafw_dbus_method(
+			       MAFW_PLAYLIST_METHOD_GET_NEXT_N,
+			       MAFW_DBUS_UINT32(1),
+			       MAFW_DBUS_UINT32(2)));
+	mockbus_reply(MAFW_DBUS_C_ARRAY(UINT32, dbus_uint32_t, 2, 0),
+		      MAFW_DBUS_STRVZ(next));
+	oids = mafw_proxy_playlist_get_next_n(pl, 1, 2, &indices, &err);
+	ck_assert(!err);
+	ck_assert(oids && g_strv_length(oids) == 2);
+	ck_assert(!strcmp(oids[0], "test::c") && !strcmp(oids[1], "test::a"));
+	ck_assert(indices[0] == 2 && indices[1] == 0);
+	g_strfreev(oids);
+	g_free(indices);
+
+	/* At the end of the playlist. */
+	mockbus_expect(mafw_dbus_method(
+			       MAFW_PLAYLIST_METHOD_GET_NEXT_N,
+			       MAFW_DBUS_UINT32(2),
+			       MAFW_DBUS_UINT32(5)));
+	mockbus_reply(DBUS_TYPE_ARRAY, DBUS_TYPE_UINT32, NULL, 0,
+		      MAFW_DBUS_STRVZ(NULL));
+	oids = mafw_proxy_playlist_get_next_n(pl, 2, 5, NULL, &err);
+	ck_assert(!err);
+	ck_assert(oids && !oids[0]);
+	g_strfreev(oids);
+
+	mockbus_expect(mafw_dbus_method(
+			       MAFW_PLAYLIST_METHOD_GET_NEXT_N,
+			       MAFW_DBUS_UINT32(0),
+			       MAFW_DBUS_UINT32(1)));
+	mockbus_error(MAFW_PLAYLIST_ERROR, MAFW_PLAYLIST_ERROR_PLAYLIST_NOT_FOUND,
+		      "testproblem");
+	ck_assert(!mafw_proxy_playlist_get_next_n(pl, 0, 1, NULL, &err));
+	ck_assert(err);
+	g_error_free(err);
+
+	g_object_unref(pl);
+
+	mockbus_finish();
+}
+END_TEST
+
+START_TEST(test_sync_since)
+{
+	MafwProxyPlaylist *pl = NULL;
+	GError *err = NULL;
+	const gchar *xy[] = {"test::x", "test::y", NULL};
+	MafwProxyPlaylistChange *change;
+	GPtrArray *changes;
+	guint current;
+	gboolean full;
+
+	mockbus_reset();
+	pl = MAFW_PROXY_PLAYLIST(mafw_proxy_playlist_new(1));
+	ck_assert_msg(pl != NULL, "Failed to create MafwProxyPlaylist");
+
+	mockbus_expect(mafw_dbus_method(
+			       MAFW_PLAYLIST_METHOD_SYNC_SINCE,
+			       MAFW_DBUS_UINT32(5)));
+	mockbus_reply(MAFW_DBUS_UINT32(7),
+		      MAFW_DBUS_BOOLEAN(FALSE),
+		      MAFW_DBUS_AST("uuas",
+			MAFW_DBUS_STRUCT(
+				MAFW_DBUS_UINT32(1),
+				MAFW_DBUS_UINT32(2),
+				MAFW_DBUS_STRVZ(xy)),
+			MAFW_DBUS_STRUCT(
+				MAFW_DBUS_UINT32(0),
+				MAFW_DBUS_UINT32(1),
+				MAFW_DBUS_STRVZ(NULL))));
+	changes = mafw_proxy_playlist_sync_since(pl, 5, &current, &full,
+						 &err);
+	ck_assert(!err);
+	ck_assert(changes && changes->len == 2);
+	ck_assert(current == 7 && !full);
+	change = changes->pdata[0];
+	ck_assert(change->from == 1 && change->nremove == 2);
+	ck_assert(g_strv_length(change->oids) == 2);
+	ck_assert(!strcmp(change->oids[0], "test::x"));
+	change = changes->pdata[1];
+	ck_assert(change->from == 0 && change->nremove == 1);
+	ck_assert(!change->oids[0]);
+	g_ptr_array_free(changes, TRUE);
+
+	/* Too old. */
+	mockbus_expect(mafw_dbus_method(
+			       MAFW_PLAYLIST_METHOD_SYNC_SINCE,
+			       MAFW_DBUS_UINT32(1)));
+	mockbus_reply(MAFW_DBUS_UINT32(7),
+		      MAFW_DBUS_BOOLEAN(TRUE),
+		      MAFW_DBUS_AST("uuas"));
+	changes = mafw_proxy_playlist_sync_since(pl, 1, &current, &full,
+						 &err);
+	ck_assert(!err);
+	ck_assert(changes && !changes->len);
+	ck_assert(current == 7 && full);
+	g_ptr_array_free(changes, TRUE);
+
+	mockbus_expect(mafw_dbus_method(
+			       MAFW_PLAYLIST_METHOD_SYNC_SINCE,
+			       MAFW_DBUS_UINT32(7)));
+	mockbus_error(MAFW_PLAYLIST_ERROR,
+		      MAFW_PLAYLIST_ERROR_PLAYLIST_NOT_FOUND, "testproblem");
+	ck_assert(!mafw_proxy_playlist_sync_since(pl, 7, NULL, NULL, &err));
+	ck_assert(err);
+	g_error_free(err);
+
+	g_object_unref(pl);
+	mockbus_finish();
+}
+END_TEST
+
+static GString *Cached_events;
+
+static void metadata_cached(MafwProxyPlaylist *pl, guint first, guint last,
+			    guint64 duration, guint unknown)
+{
+	g_string_append_printf(Cached_events, "%u-%u %" G_GUINT64_FORMAT
+			       " %u;", first, last, duration, unknown);
+}
+
+START_TEST(test_items_with_metadata)
+{
+	MafwProxyPlaylist *pl = NULL;
+	GError *err = NULL;
+	const gchar *items[] = {"test::a", "test::b", NULL};
+	DBusMessage *reply;
+	DBusMessageIter imsg, iary, ibytes;
+	GHashTable *md;
+	GByteArray *frozen;
+	GPtrArray *mds;
+	GValue *val;
+	gchar **oids;
+	guint64 duration;
+	guint unknown;
+
+	mockbus_reset();
+	Cached_events = g_string_new("");
+	pl = MAFW_PROXY_PLAYLIST(mafw_proxy_playlist_new(1));
+	ck_assert_msg(pl != NULL, "Failed to create MafwProxyPlaylist");
+	g_signal_connect(pl, "metadata-cached", G_CALLBACK(metadata_cached),
+			 NULL);
+
+	/* The first item is cached, the second one isn't yet. */
+	md = mockbus_mkmeta(MAFW_METADATA_KEY_TITLE, "Alpha", NULL);
+	frozen = mafw_metadata_freeze_bary(md);
+	reply = mafw_dbus_reply((void *)0x1, MAFW_DBUS_STRVZ(items));
+	dbus_message_iter_init_append(reply, &imsg);
+	dbus_message_iter_open_container(&imsg, DBUS_TYPE_ARRAY, "ay", &iary);
+	dbus_message_iter_open_container(&iary, DBUS_TYPE_ARRAY, "y",
+					 &ibytes);
+	dbus_message_iter_append_fixed_array(&ibytes, DBUS_TYPE_BYTE,
+					     &frozen->data, frozen->len);
+	dbus_message_iter_close_container(&iary, &ibytes);
+	dbus_message_iter_open_container(&iary, DBUS_TYPE_ARRAY, "y",
+					 &ibytes);
+	dbus_message_iter_close_container(&iary, &ibytes);
+	dbus_message_iter_close_container(&imsg, &iary);
+	duration = 180;
+	unknown = 1;
+	dbus_message_iter_append_basic(&imsg, DBUS_TYPE_UINT64, &duration);
+	dbus_message_iter_append_basic(&imsg, DBUS_TYPE_UINT32, &unknown);
+	g_byte_array_free(frozen, TRUE);
+	mafw_metadata_release(md);
+
+	mockbus_expect(mafw_dbus_method(
+			       MAFW_PLAYLIST_METHOD_GET_ITEMS_WITH_METADATA,
+			       MAFW_DBUS_UINT32(0),
+			       MAFW_DBUS_UINT32(1)));
+	mockbus_reply_msg(reply);
+	duration = unknown = 0;
+	oids = mafw_proxy_playlist_get_items_with_metadata(pl, 0, 1, &mds,
+							   &duration,
+							   &unknown, &err);
+	ck_assert(!err);
+	ck_assert(oids && g_strv_length(oids) == 2);
+	ck_assert(!strcmp(oids[0], "test::a") && !strcmp(oids[1], "test::b"));
+	ck_assert(mds->len == 2);
+	ck_assert(mds->pdata[0] && !mds->pdata[1]);
+	val = mafw_metadata_first(mds->pdata[0], MAFW_METADATA_KEY_TITLE);
+	ck_assert(val && !strcmp(g_value_get_string(val), "Alpha"));
+	ck_assert(duration == 180 && unknown == 1);
+	g_ptr_array_free(mds, TRUE);
+	g_strfreev(oids);
+
+	mockbus_incoming(mafw_dbus_signal(MAFW_PLAYLIST_METADATA_CACHED,
+					  MAFW_DBUS_UINT32(1),
+					  MAFW_DBUS_UINT32(1),
+					  MAFW_DBUS_UINT64(420),
+					  MAFW_DBUS_UINT32(0)));
+	mockbus_deliver(mafw_dbus_session(NULL));
+	ck_assert_str_eq(Cached_events->str, "1-1 420 0;");
+
+	mockbus_expect(mafw_dbus_method(
+			       MAFW_PLAYLIST_METHOD_GET_ITEMS_WITH_METADATA,
+			       MAFW_DBUS_UINT32(5),
+			       MAFW_DBUS_UINT32(9)));
+	mockbus_error(MAFW_PLAYLIST_ERROR,
+		      MAFW_PLAYLIST_ERROR_INVALID_INDEX, "testproblem");
+	ck_assert(!mafw_proxy_playlist_get_items_with_metadata(pl, 5, 9, &mds,
+							       NULL, NULL,
+							       &err));
+	ck_assert(err);
+	g_error_free(err);
+
+	g_object_unref(pl);
+	g_string_free(Cached_events, TRUE);
+	mockbus_finish();
+}
+END_TEST
+
+static GString *Window_events;
+
+static void window_changed(MafwProxyPlaylist *pl, guint first, guint count,
+			   gchar **oids)
+{
+	guint i;
+
+	g_string_append_printf(Window_events, "changed %u+%u:", first, count);
+	for (i = 0; oids[i]; i++)
+		g_string_append_printf(Window_events, " %s", oids[i]);
+	g_string_append(Window_events, ";");
+}
+
+static void window_shifted(MafwProxyPlaylist *pl, guint first)
+{
+	g_string_append_printf(Window_events, "shifted %u;", first);
+}
+
+START_TEST(test_window)
+{
+	MafwProxyPlaylist *pl = NULL;
+	GError *err = NULL;
+	const gchar *items[] = {"test::a", "test::b", NULL};
+	const gchar *changed[] = {"test::x", NULL};
+	gchar **oids;
+
+	mockbus_reset();
+	Window_events = g_string_new("");
+	pl = MAFW_PROXY_PLAYLIST(mafw_proxy_playlist_new(1));
+	ck_assert_msg(pl != NULL, "Failed to create MafwProxyPlaylist");
+	g_signal_connect(pl, "window-changed", G_CALLBACK(window_changed),
+			 NULL);
+	g_signal_connect(pl, "window-shifted", G_CALLBACK(window_shifted),
+			 NULL);
+
+	mockbus_expect(mafw_dbus_method(
+			       MAFW_PLAYLIST_METHOD_SET_WINDOW,
+			       MAFW_DBUS_UINT32(10),
+			       MAFW_DBUS_UINT32(20)));
+	mockbus_reply(MAFW_DBUS_STRVZ(items));
+	oids = mafw_proxy_playlist_set_window(pl, 10, 20, &err);
+	ck_assert(!err);
+	ck_assert(oids && g_strv_length(oids) == 2);
+	ck_assert(!strcmp(oids[0], "test::a") && !strcmp(oids[1], "test::b"));
+	g_strfreev(oids);
+
+	mockbus_incoming(mafw_dbus_signal(MAFW_PLAYLIST_WINDOW_CHANGED,
+					  MAFW_DBUS_UINT32(11),
+					  MAFW_DBUS_UINT32(1),
+					  MAFW_DBUS_STRVZ(changed)));
+	mockbus_deliver(mafw_dbus_session(NULL));
+	mockbus_incoming(mafw_dbus_signal(MAFW_PLAYLIST_WINDOW_SHIFTED,
+					  MAFW_DBUS_UINT32(13)));
+	mockbus_deliver(mafw_dbus_session(NULL));
+	ck_assert_str_eq(Window_events->str,
+			 "changed 11+1: test::x;shifted 13;");
+
+	/* Unsubscribing. */
+	mockbus_expect(mafw_dbus_method(
+			       MAFW_PLAYLIST_METHOD_SET_WINDOW,
+			       MAFW_DBUS_UINT32(0),
+			       MAFW_DBUS_UINT32(0)));
+	mockbus_reply(MAFW_DBUS_STRVZ(NULL));
+	oids = mafw_proxy_playlist_set_window(pl, 0, 0, &err);
+	ck_assert(!err);
+	ck_assert(oids && !oids[0]);
+	g_strfreev(oids);
+
+	mockbus_expect(mafw_dbus_method(
+			       MAFW_PLAYLIST_METHOD_SET_WINDOW,
+			       MAFW_DBUS_UINT32(0),
+			       MAFW_DBUS_UINT32(5)));
+	mockbus_error(MAFW_PLAYLIST_ERROR,
+		      MAFW_PLAYLIST_ERROR_PLAYLIST_NOT_FOUND, "testproblem");
+	ck_assert(!mafw_proxy_playlist_set_window(pl, 0, 5, &err));
+	ck_assert(err);
+	g_error_free(err);
+
+	g_object_unref(pl);
+	g_string_free(Window_events, TRUE);
+	mockbus_finish();
+}
+END_TEST
+
+static GString *Paged_items;
+
+static gboolean got_page(MafwProxyPlaylist *pl, guint first_index,
+			 gchar **oids, gboolean last, gpointer user_data,
+			 const GError *error)
+{
+	guint i;
+
+	if (error) {
+		ck_assert(!oids);
+		ck_assert(error->code == MAFW_PLAYLIST_ERROR_INVALID_INDEX);
+		g_string_append(Paged_items, "[error]");
+		return TRUE;
+	}
+	g_string_append_printf(Paged_items, "%u:", first_index);
+	for (i = 0; oids && oids[i]; i++)
+		g_string_append_printf(Paged_items, " %s", oids[i]);
+	g_string_append(Paged_items, last ? "." : ";");
+	return GPOINTER_TO_UINT(user_data) > 0;
+}
+
+START_TEST(test_paged_items)
+{
+	MafwProxyPlaylist *pl = NULL;
+	const gchar *page1[] = {"test::a", "test::b", NULL};
+	const gchar *page2[] = {"test::c", NULL};
+
+	mockbus_reset();
+	Paged_items = g_string_new("");
+	pl = MAFW_PROXY_PLAYLIST(mafw_proxy_playlist_new(1));
+	ck_assert_msg(pl != NULL, "Failed to create MafwProxyPlaylist");
+
+	/* The cursor is passed on. */
+	mockbus_expect(mafw_dbus_method(
+			       MAFW_PLAYLIST_METHOD_GET_ITEMS_PAGED,
+			       MAFW_DBUS_UINT32(0),
+			       MAFW_DBUS_UINT32(0),
+			       MAFW_DBUS_UINT32(2),
+			       MAFW_DBUS_UINT32(0)));
+	mockbus_reply(MAFW_DBUS_UINT32(7),
+		      MAFW_DBUS_UINT32(2),
+		      MAFW_DBUS_STRVZ(page1));
+	mockbus_expect(mafw_dbus_method(
+			       MAFW_PLAYLIST_METHOD_GET_ITEMS_PAGED,
+			       MAFW_DBUS_UINT32(7),
+			       MAFW_DBUS_UINT32(2),
+			       MAFW_DBUS_UINT32(2),
+			       MAFW_DBUS_UINT32(0)));
+	mockbus_reply(MAFW_DBUS_UINT32(7),
+		      MAFW_DBUS_UINT32(MAFW_PLAYLIST_ITEMS_END),
+		      MAFW_DBUS_STRVZ(page2));
+	ck_assert(mafw_proxy_playlist_iter_items(pl, 0, 2, 0, got_page,
+						 GUINT_TO_POINTER(1)));
+	ck_assert_str_eq(Paged_items->str, "0: test::a test::b;2: test::c.");
+
+	/* The callback can stop the iteration. */
+	g_string_truncate(Paged_items, 0);
+	mockbus_expect(mafw_dbus_method(
+			       MAFW_PLAYLIST_METHOD_GET_ITEMS_PAGED,
+			       MAFW_DBUS_UINT32(0),
+			       MAFW_DBUS_UINT32(1),
+			       MAFW_DBUS_UINT32(0),
+			       MAFW_DBUS_UINT32(100)));
+	mockbus_reply(MAFW_DBUS_UINT32(7),
+		      MAFW_DBUS_UINT32(2),
+		      MAFW_DBUS_STRVZ(page2));
+	ck_assert(mafw_proxy_playlist_iter_items(pl, 1, 0, 100, got_page,
+						 GUINT_TO_POINTER(0)));
+	ck_assert_str_eq(Paged_items->str, "1: test::c;");
+
+	/* Errors end the iteration. */
+	g_string_truncate(Paged_items, 0);
+	mockbus_expect(mafw_dbus_method(
+			       MAFW_PLAYLIST_METHOD_GET_ITEMS_PAGED,
+			       MAFW_DBUS_UINT32(0),
+			       MAFW_DBUS_UINT32(5),
+			       MAFW_DBUS_UINT32(0),
+			       MAFW_DBUS_UINT32(0)));
+	mockbus_error(MAFW_PLAYLIST_ERROR, MAFW_PLAYLIST_ERROR_INVALID_INDEX,
+		      "Wrong index");
+	ck_assert(mafw_proxy_playlist_iter_items(pl, 5, 0, 0, got_page,
+						 GUINT_TO_POINTER(1)));
+	ck_assert_str_eq(Paged_items->str, "[error]");
+
+	g_string_free(Paged_items, TRUE);
+	g_object_unref(pl);
+
+	mockbus_finish();
+}
+END_TEST
+
+static GString *Async_results;
+
+/* Notes the outcome of an edit of test_async(). */
+static void edited(GObject *pl, GAsyncResult *res, gpointer finish)
+{
+	gboolean (*finish_fn)(MafwProxyPlaylist *, GAsyncResult *, GError **);
+	GError *err = NULL;
+
+	finish_fn = finish;
+	if (finish_fn(MAFW_PROXY_PLAYLIST(pl), res, &err)) {
+		ck_assert(!err);
+		g_string_append(Async_results, "ok;");
+	} else if (err) {
+		ck_assert(err->domain == MAFW_PLAYLIST_ERROR);
+		g_string_append(Async_results, "error;");
+		g_error_free(err);
+	} else {
+		g_string_append(Async_results, "failed;");
+	}
+}
+
+static void got_items(GObject *pl, GAsyncResult *res, gpointer unused)
+{
+	GError *err = NULL;
+	gchar **oids;
+	guint i;
+
+	oids = mafw_proxy_playlist_get_items_finish(MAFW_PROXY_PLAYLIST(pl),
+						    res, &err);
+	ck_assert(!err);
+	for (i = 0; oids && oids[i]; i++)
+		g_string_append_printf(Async_results, "%s ", oids[i]);
+	g_string_append(Async_results, ";");
+	g_strfreev(oids);
+}
+
+static void got_size(GObject *pl, GAsyncResult *res, gpointer unused)
+{
+	GError *err = NULL;
+
+	g_string_append_printf(Async_results, "size %u;",
+			       mafw_proxy_playlist_get_size_finish(
+					MAFW_PROXY_PLAYLIST(pl), res, &err));
+	ck_assert(!err);
+}
+
+/* Notes the item a navigation call of test_async() found. */
+static void got_position(GObject *pl, GAsyncResult *res, gpointer finish)
+{
+	gboolean (*finish_fn)(MafwProxyPlaylist *, GAsyncResult *,
+			      guint *, gchar **, GError **);
+	GError *err = NULL;
+	gchar *oid;
+	guint idx;
+
+	finish_fn = finish;
+	if (finish_fn(MAFW_PROXY_PLAYLIST(pl), res, &idx, &oid, &err)) {
+		g_string_append_printf(Async_results, "%u %s;", idx, oid);
+		g_free(oid);
+	} else {
+		g_string_append(Async_results, "none;");
+	}
+	ck_assert(!err);
+}
+
+static void got_repeat(GObject *pl, GAsyncResult *res, gpointer unused)
+{
+	GError *err = NULL;
+
+	g_string_append_printf(Async_results, "repeat %d;",
+			       mafw_proxy_playlist_get_repeat_finish(
+					MAFW_PROXY_PLAYLIST(pl), res, &err));
+	ck_assert(!err);
+}
+
+static void got_batch(GObject *pl, GAsyncResult *res, gpointer unused)
+{
+	GError *err = NULL;
+	GArray *results;
+	guint i;
+
+	ck_assert(!mafw_proxy_playlist_apply_batch_finish(
+				MAFW_PROXY_PLAYLIST(pl), res, &results, &err));
+	ck_assert(err && err->code == MAFW_PLAYLIST_ERROR_INVALID_INDEX);
+	g_error_free(err);
+	g_string_append(Async_results, "batch");
+	for (i = 0; i < results->len; i++)
+		g_string_append_printf(Async_results, " %d",
+				       g_array_index(results, gboolean, i));
+	g_string_append(Async_results, ";");
+	g_array_free(results, TRUE);
+}
+
+static void got_next_n(GObject *pl, GAsyncResult *res, gpointer unused)
+{
+	GError *err = NULL;
+	guint *indices;
+	gchar **oids;
+	guint i;
+
+	oids = mafw_proxy_playlist_get_next_n_finish(MAFW_PROXY_PLAYLIST(pl),
+						     res, &indices, &err);
+	ck_assert(!err);
+	g_string_append(Async_results, "next");
+	for (i = 0; oids[i]; i++)
+		g_string_append_printf(Async_results, " %u %s",
+				       indices[i], oids[i]);
+	g_string_append(Async_results, ";");
+	g_strfreev(oids);
+	g_free(indices);
+}
+
+static void got_window(GObject *pl, GAsyncResult *res, gpointer unused)
+{
+	GError *err = NULL;
+	gchar **oids;
+	guint i;
+
+	oids = mafw_proxy_playlist_set_window_finish(MAFW_PROXY_PLAYLIST(pl),
+						     res, &err);
+	ck_assert(!err);
+	g_string_append(Async_results, "window");
+	for (i = 0; oids[i]; i++)
+		g_string_append_printf(Async_results, " %s", oids[i]);
+	g_string_append(Async_results, ";");
+	g_strfreev(oids);
+}
+
+static void got_metadata(GObject *pl, GAsyncResult *res, gpointer unused)
+{
+	GError *err = NULL;
+	GPtrArray *mds;
+	gchar **oids;
+	guint64 duration;
+	guint unknown;
+
+	oids = mafw_proxy_playlist_get_items_with_metadata_finish(
+					MAFW_PROXY_PLAYLIST(pl), res, &mds,
+					&duration, &unknown, &err);
+	ck_assert(!err);
+	g_string_append_printf(Async_results, "%u items %u md %u s %u;",
+			       g_strv_length(oids), mds->len,
+			       (guint)duration, unknown);
+	g_ptr_array_free(mds, TRUE);
+	g_strfreev(oids);
+}
+
+START_TEST(test_async)
+{
+	MafwProxyPlaylist *pl = NULL;
+	const gchar *oids[] = {"test::a", "test::b", NULL};
+	const gchar *oid[] = {"test::a", NULL};
+	MafwProxyPlaylistBatch *batch;
+	DBusMessageIter imsg, iary, ibytes;
+	DBusMessage *reply;
+	dbus_uint64_t duration;
+	dbus_uint32_t unknown;
+	guint i;
+
+	mockbus_reset();
+	Async_results = g_string_new("");
+	pl = MAFW_PROXY_PLAYLIST(mafw_proxy_playlist_new(1));
+	ck_assert_msg(pl != NULL, "Failed to create MafwProxyPlaylist");
+
+	/* Edits complete with their replies, in order. */
+	mockbus_expect(mafw_dbus_method(
+			       MAFW_PLAYLIST_METHOD_INSERT_ITEM,
+			       MAFW_DBUS_UINT32(0),
+			       MAFW_DBUS_STRVZ(oids)));
+	mockbus_reply(MAFW_DBUS_BOOLEAN(TRUE));
+	mockbus_expect(mafw_dbus_method(
+			       MAFW_PLAYLIST_METHOD_REMOVE_ITEM,
+			       MAFW_DBUS_UINT32(5)));
+	mockbus_reply(MAFW_DBUS_BOOLEAN(FALSE));
+	mockbus_expect(mafw_dbus_method(
+			       MAFW_PLAYLIST_METHOD_MOVE,
+			       MAFW_DBUS_UINT32(0),
+			       MAFW_DBUS_UINT32(1)));
+	mockbus_error(MAFW_PLAYLIST_ERROR, MAFW_PLAYLIST_ERROR_INVALID_INDEX,
+		      "testproblem");
+	mafw_proxy_playlist_insert_items_async(pl, 0, oids, edited,
+				mafw_proxy_playlist_insert_items_finish);
+	mafw_proxy_playlist_remove_item_async(pl, 5, edited,
+				mafw_proxy_playlist_remove_item_finish);
+	mafw_proxy_playlist_move_item_async(pl, 0, 1, edited,
+				mafw_proxy_playlist_move_item_finish);
+	ck_assert_str_eq(Async_results->str, "ok;failed;error;");
+
+	/* A slow reply. */
+	g_string_truncate(Async_results, 0);
+	mockbus_expect(mafw_dbus_method(
+			       MAFW_PLAYLIST_METHOD_APPEND_ITEM,
+			       MAFW_DBUS_STRVZ(oid)));
+	mafw_proxy_playlist_append_item_async(pl, "test::a", edited,
+				mafw_proxy_playlist_append_item_finish);
+	ck_assert_str_eq(Async_results->str, "");
+	mockbus_reply();
+	mockbus_send_stored_reply();
+	ck_assert_str_eq(Async_results->str, "ok;");
+
+	/* Queries. */
+	g_string_truncate(Async_results, 0);
+	mockbus_expect(mafw_dbus_method(
+			       MAFW_PLAYLIST_METHOD_GET_ITEMS,
+			       MAFW_DBUS_UINT32(0),
+			       MAFW_DBUS_UINT32(1)));
+	mockbus_reply(MAFW_DBUS_STRVZ(oids));
+	mockbus_expect(mafw_dbus_method(
+			       MAFW_PLAYLIST_METHOD_GET_ITEMS,
+			       MAFW_DBUS_UINT32(7),
+			       MAFW_DBUS_UINT32(9)));
+	mockbus_reply(MAFW_DBUS_STRVZ(NULL));
+	mockbus_expect(mafw_dbus_method(MAFW_PLAYLIST_METHOD_GET_SIZE));
+	mockbus_reply(MAFW_DBUS_UINT32(3));
+	mafw_proxy_playlist_get_items_async(pl, 0, 1, got_items, NULL);
+	mafw_proxy_playlist_get_items_async(pl, 7, 9, got_items, NULL);
+	mafw_proxy_playlist_get_size_async(pl, got_size, NULL);
+	ck_assert_str_eq(Async_results->str,
+			 "test::a test::b ;;size 3;");
+
+	/* Navigation, as renderers do at track boundaries. */
+	g_string_truncate(Async_results, 0);
+	mockbus_expect(mafw_dbus_method(
+			       MAFW_PLAYLIST_METHOD_GET_NEXT,
+			       MAFW_DBUS_UINT32(0)));
+	mockbus_reply(MAFW_DBUS_UINT32(1), MAFW_DBUS_STRING("test::b"));
+	mockbus_expect(mafw_dbus_method(
+			       MAFW_PLAYLIST_METHOD_GET_PREV,
+			       MAFW_DBUS_UINT32(0)));
+	mockbus_reply(MAFW_DBUS_UINT32(0), MAFW_DBUS_STRING(""));
+	mockbus_expect(mafw_dbus_method(
+			       MAFW_PLAYLIST_METHOD_GET_STARTING_INDEX));
+	mockbus_reply(MAFW_DBUS_UINT32(0), MAFW_DBUS_STRING("test::a"));
+	mockbus_expect(mafw_dbus_method(MAFW_PLAYLIST_METHOD_GET_REPEAT));
+	mockbus_reply(MAFW_DBUS_BOOLEAN(TRUE));
+	mafw_proxy_playlist_get_next_async(pl, 0, got_position,
+				mafw_proxy_playlist_get_next_finish);
+	mafw_proxy_playlist_get_prev_async(pl, 0, got_position,
+				mafw_proxy_playlist_get_prev_finish);
+	mafw_proxy_playlist_get_starting_index_async(pl, got_position,
+				mafw_proxy_playlist_get_starting_index_finish);
+	mafw_proxy_playlist_get_repeat_async(pl, got_repeat, NULL);
+	ck_assert_str_eq(Async_results->str,
+			 "1 test::b;none;0 test::a;repeat 1;");
+
+	/* Batches, look-ahead, windows, metadata and the use count too. */
+	g_string_truncate(Async_results, 0);
+	mockbus_expect(mafw_dbus_method(
+			       MAFW_PLAYLIST_METHOD_APPLY_OPS,
+			       MAFW_DBUS_AST("uuuas",
+				MAFW_DBUS_STRUCT(
+					MAFW_DBUS_UINT32(MAFW_PLAYLIST_OP_APPEND),
+					MAFW_DBUS_UINT32(0),
+					MAFW_DBUS_UINT32(0),
+					MAFW_DBUS_STRVZ(oid)),
+				MAFW_DBUS_STRUCT(
+					MAFW_DBUS_UINT32(MAFW_PLAYLIST_OP_REMOVE),
+					MAFW_DBUS_UINT32(0),
+					MAFW_DBUS_UINT32(5),
+					MAFW_DBUS_STRVZ(NULL)))));
+	mockbus_reply(MAFW_DBUS_C_ARRAY(BOOLEAN, dbus_bool_t, TRUE, FALSE));
+	mockbus_expect(mafw_dbus_method(
+			       MAFW_PLAYLIST_METHOD_GET_NEXT_N,
+			       MAFW_DBUS_UINT32(0),
+			       MAFW_DBUS_UINT32(2)));
+	mockbus_reply(MAFW_DBUS_C_ARRAY(UINT32, dbus_uint32_t, 1, 0),
+		      MAFW_DBUS_STRVZ(oids));
+	mockbus_expect(mafw_dbus_method(
+			       MAFW_PLAYLIST_METHOD_SET_WINDOW,
+			       MAFW_DBUS_UINT32(0),
+			       MAFW_DBUS_UINT32(2)));
+	mockbus_reply(MAFW_DBUS_STRVZ(oids));
+	mockbus_expect(mafw_dbus_method(
+			       MAFW_PLAYLIST_METHOD_GET_ITEMS_WITH_METADATA,
+			       MAFW_DBUS_UINT32(0),
+			       MAFW_DBUS_UINT32(1)));
+	reply = mafw_dbus_reply((void *)0x1, MAFW_DBUS_STRVZ(oids));
+	dbus_message_iter_init_append(reply, &imsg);
+	dbus_message_iter_open_container(&imsg, DBUS_TYPE_ARRAY, "ay", &iary);
+	for (i = 0; i < 2; i++) {
+		dbus_message_iter_open_container(&iary, DBUS_TYPE_ARRAY, "y",
+						 &ibytes);
+		dbus_message_iter_close_container(&iary, &ibytes);
+	}
+	dbus_message_iter_close_container(&imsg, &iary);
+	duration = 60;
+	unknown = 2;
+	dbus_message_iter_append_basic(&imsg, DBUS_TYPE_UINT64, &duration);
+	dbus_message_iter_append_basic(&imsg, DBUS_TYPE_UINT32, &unknown);
+	mockbus_reply_msg(reply);
+	mockbus_expect(mafw_dbus_method(
+			       MAFW_PLAYLIST_METHOD_INCREMENT_USE_COUNT));
+	mockbus_reply();
+	mockbus_expect(mafw_dbus_method(
+			       MAFW_PLAYLIST_METHOD_DECREMENT_USE_COUNT));
+	mockbus_error(MAFW_PLAYLIST_ERROR,
+		      MAFW_PLAYLIST_ERROR_PLAYLIST_NOT_FOUND, "testproblem");
+	batch = mafw_proxy_playlist_batch_new();
+	mafw_proxy_playlist_batch_append(batch, oid);
+	mafw_proxy_playlist_batch_remove(batch, 0, 5);
+	mafw_proxy_playlist_apply_batch_async(pl, batch, got_batch, NULL);
+	mafw_proxy_playlist_batch_free(batch);
+	mafw_proxy_playlist_get_next_n_async(pl, 0, 2, got_next_n, NULL);
+	mafw_proxy_playlist_set_window_async(pl, 0, 2, got_window, NULL);
+	mafw_proxy_playlist_get_items_with_metadata_async(pl, 0, 1,
+							  got_metadata, NULL);
+	mafw_proxy_playlist_increment_use_count_async(pl, edited,
+			mafw_proxy_playlist_increment_use_count_finish);
+	mafw_proxy_playlist_decrement_use_count_async(pl, edited,
+			mafw_proxy_playlist_decrement_use_count_finish);
+	ck_assert_str_eq(Async_results->str,
+			 "batch 1 0;next 1 test::a 0 test::b;"
+			 "window test::a test::b;2 items 2 md 60 s 2;"
+			 "ok;error;");
+
+	g_string_free(Async_results, TRUE);
+	g_object_unref(pl);
+	mockbus_finish();
+}
+END_TEST
+
 /*****************************************************************************
  * Test case management
  *****************************************************************************/
@@ -626,6 +1413,14 @@ static Suite *mafw_proxy_playlist_suite_new(void)
 	if (1)	checkmore_add_tcase(suite, "Signals", test_signals);
 	if (1)	checkmore_add_tcase(suite, "Iterator", test_iterator);
 	if (1)	checkmore_add_tcase(suite, "Use count", test_usecount);
+	if (1)	checkmore_add_tcase(suite, "Batch", test_batch);
+	if (1)	checkmore_add_tcase(suite, "Paged items", test_paged_items);
+	if (1)	checkmore_add_tcase(suite, "Look-ahead", test_get_next_n);
+	if (1)	checkmore_add_tcase(suite, "Window", test_window);
+	if (1)	checkmore_add_tcase(suite, "Items with metadata",
+				    test_items_with_metadata);
+	if (1)	checkmore_add_tcase(suite, "Sync since", test_sync_since);
+	if (1)	checkmore_add_tcase(suite, "Asynchronous", test_async);
 
 	return suite;
 }
@@ -0,0 +1,206 @@
+/*
+ * This file is a part of MAFW
+ *
+ * Copyright (C) 2007, 2008, 2009 Nokia Corporation, all rights reserved.
+ *
+ * Contact: Visa Smolander <visa.smolander@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#include <string.h>
+
+#include <check.h>
+#include <glib.h>
+#include <dbus/dbus.h>
+
+#include <checkmore.h>
+#include "common/mafw-dbus.h"
+#include "common/mafw-session.h"
+#include "mockbus.h"
+
+#define MATCH_STR "type='signal',interface='org.freedesktop.DBus'," \
+			"member='NameOwnerChanged',arg0='%s',arg2=''"
+
+/* Records the vanished resources as "client/resource/count/subsystem;" */
+static GString *Vanished;
+
+static void vanished(const gchar *client, gpointer resource, guint count,
+		     gpointer subsys)
+{
+	g_string_append_printf(Vanished, "%s/%d/%u/%s;", client,
+			       GPOINTER_TO_INT(resource), count,
+			       (const gchar *)subsys);
+}
+
+static void expect_remove_match(const gchar *client)
+{
+	gchar *matchstr;
+
+	matchstr = g_strdup_printf(MATCH_STR, client);
+	mockbus_expect(mafw_dbus_method_full(DBUS_SERVICE_DBUS,
+					     DBUS_PATH_DBUS,
+					     DBUS_INTERFACE_DBUS,
+					     "RemoveMatch",
+					     MAFW_DBUS_STRING(matchstr)));
+	g_free(matchstr);
+}
+
+static void client_vanishes(const gchar *client)
+{
+	mockbus_incoming(mafw_dbus_signal_full(NULL, DBUS_PATH_DBUS,
+					       DBUS_INTERFACE_DBUS,
+					       "NameOwnerChanged",
+					       MAFW_DBUS_STRING(client),
+					       MAFW_DBUS_STRING(client),
+					       MAFW_DBUS_STRING("")));
+	mockbus_deliver(NULL);
+}
+
+START_TEST(test_hold_release)
+{
+	guint a, b;
+	gpointer r1 = GINT_TO_POINTER(1);
+
+	mockbus_reset();
+	mafw_session_init(dbus_bus_get(DBUS_BUS_SESSION, NULL));
+	a = mafw_session_add_subsystem(vanished, "a");
+	b = mafw_session_add_subsystem(vanished, "b");
+	ck_assert(a && b && a != b);
+
+	ck_assert_uint_eq(mafw_session_hold(a, ":1.1", r1), 1);
+	ck_assert_uint_eq(mafw_session_hold(a, ":1.1", r1), 2);
+	ck_assert_uint_eq(mafw_session_hold(b, ":1.1", r1), 1);
+	ck_assert_uint_eq(mafw_session_holds(a, ":1.1", r1), 2);
+	ck_assert_uint_eq(mafw_session_holds(a, ":1.2", r1), 0);
+
+	ck_assert(mafw_session_release(a, ":1.1", r1));
+	ck_assert_uint_eq(mafw_session_holds(a, ":1.1", r1), 1);
+	ck_assert(!mafw_session_release(a, ":1.2", r1));
+	ck_assert(mafw_session_release(b, ":1.1", r1));
+	ck_assert(!mafw_session_release(b, ":1.1", r1));
+
+	/* The client is unwatched with its last resource. */
+	expect_remove_match(":1.1");
+	ck_assert(mafw_session_release(a, ":1.1", r1));
+	ck_assert_uint_eq(mafw_session_holds(a, ":1.1", r1), 0);
+
+	mockbus_finish();
+}
+END_TEST
+
+START_TEST(test_vanish)
+{
+	guint a, b;
+	gpointer r1 = GINT_TO_POINTER(1), r2 = GINT_TO_POINTER(2);
+
+	mockbus_reset();
+	mafw_session_init(dbus_bus_get(DBUS_BUS_SESSION, NULL));
+	a = mafw_session_add_subsystem(vanished, "a");
+	b = mafw_session_add_subsystem(vanished, "b");
+	Vanished = g_string_new("");
+
+	mafw_session_hold(a, ":1.3", r1);
+	mafw_session_hold(a, ":1.3", r1);
+	mafw_session_hold(b, ":1.3", r2);
+	mafw_session_hold(b, ":1.4", r2);
+
+	/* Unknown clients are ignored. */
+	client_vanishes(":1.5");
+	ck_assert_str_eq(Vanished->str, "");
+
+	expect_remove_match(":1.3");
+	client_vanishes(":1.3");
+	ck_assert(!strcmp(Vanished->str, ":1.3/1/2/a;:1.3/2/1/b;") ||
+		  !strcmp(Vanished->str, ":1.3/2/1/b;:1.3/1/2/a;"));
+	ck_assert_uint_eq(mafw_session_holds(a, ":1.3", r1), 0);
+	ck_assert_uint_eq(mafw_session_holds(b, ":1.4", r2), 1);
+
+	g_string_free(Vanished, TRUE);
+	mockbus_finish();
+}
+END_TEST
+
+START_TEST(test_forget)
+{
+	guint a;
+	gpointer r1 = GINT_TO_POINTER(1), r2 = GINT_TO_POINTER(2);
+
+	mockbus_reset();
+	mafw_session_init(dbus_bus_get(DBUS_BUS_SESSION, NULL));
+	a = mafw_session_add_subsystem(vanished, "a");
+	Vanished = g_string_new("");
+
+	mafw_session_hold(a, ":1.6", r1);
+	mafw_session_hold(a, ":1.7", r1);
+	mafw_session_hold(a, ":1.7", r2);
+
+	/* Forgetting $r1 leaves :1.6 without resources. */
+	expect_remove_match(":1.6");
+	mafw_session_forget(a, r1);
+	ck_assert_uint_eq(mafw_session_holds(a, ":1.6", r1), 0);
+	ck_assert_uint_eq(mafw_session_holds(a, ":1.7", r1), 0);
+	ck_assert_uint_eq(mafw_session_holds(a, ":1.7", r2), 1);
+	ck_assert_str_eq(Vanished->str, "");
+
+	g_string_free(Vanished, TRUE);
+	mockbus_finish();
+}
+END_TEST
+
+START_TEST(test_watch)
+{
+	guint a;
+	gpointer r1 = GINT_TO_POINTER(1);
+
+	mockbus_reset();
+	mafw_session_init(dbus_bus_get(DBUS_BUS_SESSION, NULL));
+	a = mafw_session_add_subsystem(vanished, "a");
+	Vanished = g_string_new("");
+
+	/* A watched client stays watched without resources. */
+	mafw_session_watch(":1.8");
+	mafw_session_watch(":1.8");
+	mafw_session_hold(a, ":1.8", r1);
+	ck_assert(mafw_session_release(a, ":1.8", r1));
+	mafw_session_hold(a, ":1.8", r1);
+
+	/* Until it vanishes. */
+	expect_remove_match(":1.8");
+	client_vanishes(":1.8");
+	ck_assert_str_eq(Vanished->str, ":1.8/1/1/a;");
+	ck_assert_uint_eq(mafw_session_holds(a, ":1.8", r1), 0);
+
+	g_string_free(Vanished, TRUE);
+	mockbus_finish();
+}
+END_TEST
+
+int main(void)
+{
+	Suite *suite;
+	TCase *tc;
+
+	suite = suite_create("mafw-session");
+	tc = checkmore_add_tcase(suite, "Session registry", test_hold_release);
+	tcase_add_test(tc, test_vanish);
+	tcase_add_test(tc, test_forget);
+	tcase_add_test(tc, test_watch);
+	return checkmore_run(srunner_create(suite), FALSE);
+}
+
+/* vi: set noexpandtab ts=8 sw=8 cino=t0,(0: */
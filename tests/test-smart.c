@@ -0,0 +1,322 @@
+/*
+ * This file is a part of MAFW
+ *
+ * Copyright (C) 2007, 2008, 2009 Nokia Corporation, all rights reserved.
+ *
+ * Contact: Visa Smolander <visa.smolander@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#include <string.h>
+
+#include <check.h>
+#include <glib.h>
+#include <dbus/dbus.h>
+#include <libmafw/mafw.h>
+
+#include <checkmore.h>
+#include "common/dbus-interface.h"
+#include "common/mafw-dbus.h"
+#include "libmafw-shared/mafw-playlist-manager.h"
+#include "libmafw-shared/mafw-shared.h"
+#include "../mafw-playlist-daemon/mpd-internal.h"
+#include "mockbus.h"
+#include "mocksource.h"
+
+/* Playlists will be stored in PLS_DIR. */
+#define PLS_DIR		"testsmart"
+
+#define CONTAINER	"mocksource::albums"
+
+/* The size of the pages smart.c browses. */
+#define PAGE		64
+
+/* The smart playlist every test creates. */
+#define PLID		1
+
+/* A request to the smart playlist. */
+#define pl_request(...)							\
+	mafw_dbus_method_full(MAFW_PLAYLIST_SERVICE,			\
+			      MAFW_PLAYLIST_PATH "/1",			\
+			      MAFW_PLAYLIST_INTERFACE,			\
+			      __VA_ARGS__)
+
+static MockedSource *Source;
+
+/* Sets the contents of the container to $n items, "mocksource::<i>"
+ * except for $odd, which is "mocksource::odd", unless it's %G_MAXUINT. */
+static void set_items(guint n, guint odd)
+{
+	guint i;
+
+	if (Source->items)
+		g_ptr_array_free(Source->items, TRUE);
+	Source->items = g_ptr_array_new_with_free_func(g_free);
+	for (i = 0; i < n; i++)
+		g_ptr_array_add(Source->items, i == odd
+				? g_strdup("mocksource::odd")
+				: g_strdup_printf("mocksource::%u", i));
+}
+
+static void expect_contents_changed(guint from, guint nremove,
+				    guint nreplace)
+{
+	mockbus_expect(mafw_dbus_signal_full(NULL, MAFW_PLAYLIST_PATH "/1",
+					     MAFW_PLAYLIST_INTERFACE,
+					     MAFW_PLAYLIST_CONTENTS_CHANGED,
+					     MAFW_DBUS_UINT32(PLID),
+					     MAFW_DBUS_UINT32(from),
+					     MAFW_DBUS_UINT32(nremove),
+					     MAFW_DBUS_UINT32(nreplace)));
+}
+
+/* Lets the daemon handle its queued requests and demands. */
+static void run_queue(void)
+{
+	while (g_main_context_iteration(NULL, FALSE))
+		/* */;
+}
+
+/* Starts the daemon with the mock source serving $n items, and creates
+ * the smart playlist of them, expecting its first two pages fetched. */
+static Pls *start_daemon(guint n)
+{
+	DBusMessage *c;
+
+	mockbus_reset();
+	mockbus_expect(mafw_dbus_method_full(
+			       DBUS_SERVICE_DBUS,
+			       DBUS_PATH_DBUS,
+			       DBUS_INTERFACE_DBUS,
+			       "RequestName",
+			       MAFW_DBUS_STRING(MAFW_PLAYLIST_SERVICE),
+			       MAFW_DBUS_UINT32(4)));
+	mockbus_reply(MAFW_DBUS_UINT32(1));
+	mock_services(NULL);
+	mafw_shared_deinit();
+	init_playlist_wrapper(dbus_bus_get(DBUS_BUS_SESSION, NULL),
+			      TRUE, FALSE);
+
+	Source = mocked_source_new("mocksource", "mocksource", NULL);
+	Source->dont_quit = TRUE;
+	set_items(n, G_MAXUINT);
+	mafw_registry_add_extension(mafw_registry_get_instance(),
+				    MAFW_EXTENSION(Source));
+
+	mockbus_incoming(c = mafw_dbus_method_full(MAFW_PLAYLIST_SERVICE,
+				  MAFW_PLAYLIST_PATH,
+				  MAFW_PLAYLIST_INTERFACE,
+				  MAFW_PLAYLIST_METHOD_CREATE_SMART_PLAYLIST,
+				  MAFW_DBUS_STRING("smart"),
+				  MAFW_DBUS_STRING(CONTAINER),
+				  MAFW_DBUS_STRING(""),
+				  MAFW_DBUS_STRING("")));
+	/* A page ahead of the clients, who haven't read anything. */
+	expect_contents_changed(0, 0, MIN(n, PAGE));
+	if (n > PAGE)
+		expect_contents_changed(PAGE, 0, MIN(n - PAGE, PAGE));
+	mockbus_expect(mafw_dbus_signal_full(
+			       NULL, MAFW_PLAYLIST_PATH,
+			       MAFW_PLAYLIST_INTERFACE,
+			       MAFW_PLAYLIST_SIGNAL_PLAYLIST_CREATED,
+			       MAFW_DBUS_UINT32(PLID)));
+	mockbus_expect(mafw_dbus_reply(c, MAFW_DBUS_UINT32(PLID)));
+	mockbus_deliver(NULL);
+	run_queue();
+	mockbus_finish();
+
+	return g_tree_lookup(Playlists, GUINT_TO_POINTER(PLID));
+}
+
+/* Reads item $idx of the smart playlist, expecting $oid.  The pages it
+ * makes necessary are fetched by run_queue(). */
+static void read_item(guint idx, const gchar *oid)
+{
+	DBusMessage *c;
+
+	mockbus_incoming(c = pl_request(MAFW_PLAYLIST_METHOD_GET_ITEM,
+					MAFW_DBUS_UINT32(idx)));
+	mockbus_expect(mafw_dbus_reply(c, MAFW_DBUS_STRING(oid)));
+	mockbus_deliver(NULL);
+}
+
+static void check_item(Pls *pls, guint idx, const gchar *oid)
+{
+	gchar *item;
+
+	item = pls_get_item(pls, idx);
+	ck_assert_str_eq(item, oid);
+	g_free(item);
+}
+
+START_TEST(test_fetch)
+{
+	Pls *pls;
+
+	pls = start_daemon(150);
+	ck_assert(pls);
+	ck_assert(pls->smart);
+	ck_assert_uint_eq(pls->len, 2 * PAGE);
+	ck_assert_int_eq(Source->browse_called, 2);
+	check_item(pls, PAGE, "mocksource::64");
+
+	/* Reading within the first page needs nothing more. */
+	read_item(10, "mocksource::10");
+	run_queue();
+	ck_assert_int_eq(Source->browse_called, 2);
+
+	/* Reading the second page fetches the third, which is short. */
+	read_item(100, "mocksource::100");
+	expect_contents_changed(2 * PAGE, 0, 150 - 2 * PAGE);
+	run_queue();
+	mockbus_finish();
+	ck_assert_int_eq(Source->browse_called, 3);
+	ck_assert_uint_eq(Source->browse_skip, 2 * PAGE);
+	ck_assert_uint_eq(pls->len, 150);
+	check_item(pls, 149, "mocksource::149");
+
+	/* There is nothing more to fetch. */
+	read_item(149, "mocksource::149");
+	run_queue();
+	mockbus_finish();
+	ck_assert_int_eq(Source->browse_called, 3);
+}
+END_TEST
+
+START_TEST(test_refresh)
+{
+	Pls *pls;
+
+	pls = start_daemon(150);
+	read_item(100, "mocksource::100");
+	expect_contents_changed(2 * PAGE, 0, 150 - 2 * PAGE);
+	run_queue();
+	mockbus_finish();
+	Source->browse_called = 0;
+
+	/* Only the page which changed is replaced, though every page is
+	 * browsed again. */
+	set_items(150, 3);
+	expect_contents_changed(0, PAGE, PAGE);
+	g_signal_emit_by_name(Source, "container-changed", CONTAINER);
+	run_queue();
+	mockbus_finish();
+	ck_assert_int_eq(Source->browse_called, 3);
+	ck_assert_uint_eq(pls->len, 150);
+	check_item(pls, 3, "mocksource::odd");
+	check_item(pls, 4, "mocksource::4");
+
+	/* Other containers don't matter. */
+	g_signal_emit_by_name(Source, "container-changed",
+			      "mocksource::artists");
+	run_queue();
+	ck_assert_int_eq(Source->browse_called, 3);
+
+	/* A short page ends the playlist.  The first page is the same,
+	 * the second replaces the rest. */
+	set_items(100, 3);
+	expect_contents_changed(PAGE, 150 - PAGE, 100 - PAGE);
+	g_signal_emit_by_name(Source, "container-changed", CONTAINER);
+	run_queue();
+	mockbus_finish();
+	ck_assert_int_eq(Source->browse_called, 5);
+	ck_assert_uint_eq(pls->len, 100);
+	check_item(pls, 99, "mocksource::99");
+
+	/* Emptying the container empties the playlist. */
+	set_items(0, G_MAXUINT);
+	expect_contents_changed(0, 100, 0);
+	g_signal_emit_by_name(Source, "container-changed", CONTAINER);
+	run_queue();
+	mockbus_finish();
+	ck_assert_uint_eq(pls->len, 0);
+}
+END_TEST
+
+START_TEST(test_edit)
+{
+	const gchar *const oids[] = { "test::a", NULL };
+	DBusMessage *c;
+	Pls *pls;
+
+	pls = start_daemon(10);
+	ck_assert_uint_eq(pls->len, 10);
+
+	mockbus_incoming(c = pl_request(MAFW_PLAYLIST_METHOD_APPEND_ITEM,
+					MAFW_DBUS_STRVZ(oids)));
+	mockbus_expect(mafw_dbus_error(c, MAFW_PLAYLIST_ERROR,
+				       MAFW_PLAYLIST_ERROR_NOT_SUPPORTED,
+				       "Smart playlists cannot be edited"));
+	mockbus_deliver(NULL);
+	run_queue();
+
+	mockbus_incoming(c = pl_request(MAFW_PLAYLIST_METHOD_CLEAR));
+	mockbus_expect(mafw_dbus_error(c, MAFW_PLAYLIST_ERROR,
+				       MAFW_PLAYLIST_ERROR_NOT_SUPPORTED,
+				       "Smart playlists cannot be edited"));
+	mockbus_deliver(NULL);
+	run_queue();
+
+	/* Nor can it be copied to. */
+	mockbus_incoming(c = mafw_dbus_method_full(MAFW_PLAYLIST_SERVICE,
+				  MAFW_PLAYLIST_PATH,
+				  MAFW_PLAYLIST_INTERFACE,
+				  MAFW_PLAYLIST_METHOD_COPY_RANGE,
+				  MAFW_DBUS_UINT32(PLID),
+				  MAFW_DBUS_UINT32(0),
+				  MAFW_DBUS_UINT32(1),
+				  MAFW_DBUS_UINT32(PLID),
+				  MAFW_DBUS_UINT32(0)));
+	mockbus_expect(mafw_dbus_error(c, MAFW_PLAYLIST_ERROR,
+				       MAFW_PLAYLIST_ERROR_NOT_SUPPORTED,
+				       "smart playlists cannot be edited"));
+	mockbus_deliver(NULL);
+	run_queue();
+	mockbus_finish();
+
+	ck_assert_uint_eq(pls->len, 10);
+	check_item(pls, 0, "mocksource::0");
+}
+END_TEST
+
+/*****************************************************************************
+ * Test case management
+ *****************************************************************************/
+
+static Suite *smart_suite(void)
+{
+	Suite *suite;
+
+	suite = suite_create("Smart playlists");
+	if (1)	checkmore_add_tcase(suite, "Fetching", test_fetch);
+	if (1)	checkmore_add_tcase(suite, "Refreshing", test_refresh);
+	if (1)	checkmore_add_tcase(suite, "Editing", test_edit);
+	return suite;
+}
+
+/*****************************************************************************
+ * Test case execution
+ *****************************************************************************/
+
+int main(void)
+{
+	g_setenv("MAFW_PLAYLIST_DIR", PLS_DIR, TRUE);
+	return checkmore_run(srunner_create(smart_suite()), FALSE);
+}
+
+/* vi: set noexpandtab ts=8 sw=8 cino=t0,(0: */
@@ -806,6 +806,68 @@ START_TEST(test_activate_settings)
 }
 END_TEST
 
+/* Browses of clients leaving the bus are cancelled. */
+START_TEST(test_client_vanishes)
+{
+	MockedSource *source;
+	GHashTable *metadata;
+	DBusMessage *c, *replmsg;
+	DBusMessageIter iter_array, iter_msg;
+	gchar *matchstr;
+	gint i;
+
+	metadata = mockbus_mkmeta("title", "Easy", NULL);
+	mockbus_reset();
+	wrapper_init();
+
+	source = mocked_source_new("mocksource", "mocksource", Loop);
+	mock_appearing_extension(FAKE_SOURCE_SERVICE, FALSE);
+	mafw_registry_add_extension(mafw_registry_get_instance(),
+				    MAFW_EXTENSION(source));
+
+	source->repeat_browse = 25;
+	source->dont_send_last = TRUE;
+	msg_sender_id = ":1.103";
+	mockbus_incoming(c = mafw_dbus_method(MAFW_SOURCE_METHOD_BROWSE,
+				      MAFW_DBUS_STRING("testobject"),
+				      MAFW_DBUS_BOOLEAN(FALSE),
+				      MAFW_DBUS_STRING(""),
+				      MAFW_DBUS_STRING(""),
+				      MAFW_DBUS_C_STRVZ("title", "artist"),
+				      MAFW_DBUS_UINT32(0),
+				      MAFW_DBUS_UINT32(11)));
+	replmsg = NULL;
+	for (i = 0; i < 25; i++)
+		replmsg = append_browse_res(replmsg, &iter_msg, &iter_array,
+					    1408, -1, 0, "testobject",
+					    metadata, "", 0, "");
+	dbus_message_iter_close_container(&iter_msg, &iter_array);
+	mockbus_expect(replmsg);
+	mockbus_expect(mafw_dbus_reply(c, MAFW_DBUS_UINT32(1408)));
+	mockbus_deliver(NULL);
+	ck_assert(source->cancel_browse_called == 0);
+
+	mockbus_incoming(mafw_dbus_signal_full(NULL, DBUS_PATH_DBUS,
+					       DBUS_INTERFACE_DBUS,
+					       "NameOwnerChanged",
+					       MAFW_DBUS_STRING(msg_sender_id),
+					       MAFW_DBUS_STRING(msg_sender_id),
+					       MAFW_DBUS_STRING("")));
+	matchstr = g_strdup_printf(MATCH_STR, msg_sender_id);
+	mockbus_expect(mafw_dbus_method_full(DBUS_SERVICE_DBUS,
+					     DBUS_PATH_DBUS,
+					     DBUS_INTERFACE_DBUS,
+					     "RemoveMatch",
+					     MAFW_DBUS_STRING(matchstr)));
+	g_free(matchstr);
+	mockbus_deliver(NULL);
+	ck_assert(source->cancel_browse_called == 1);
+
+	mockbus_finish();
+	mafw_metadata_release(metadata);
+}
+END_TEST
+
 START_TEST(test_source_errors)
 {
 	ErrorSource *source;
@@ -906,6 +968,7 @@ static Suite *source_wrapper_suite(void)
 {
 	Suite *suite;
 	TCase *tc_export_unexport, *tc_source_wrapper, *tc_activate, *tc_source_errors;
+	TCase *tc_vanish;
 
 	suite = suite_create("Source Wrapper");
 if(1) {	tc_export_unexport = checkmore_add_tcase(suite,
@@ -918,6 +981,9 @@ if(1) {	tc_source_wrapper = checkmore_add_tcase(suite, "Source wrapper",
 if(1) {	tc_activate = checkmore_add_tcase(suite, "Extension activate settings",
                                                 test_activate_settings);
 	tcase_set_timeout(tc_activate, 60); }
+if(1) {	tc_vanish = checkmore_add_tcase(suite, "Vanishing client",
+					test_client_vanishes);
+	tcase_set_timeout(tc_vanish, 60); }
 
 if(1) {	tc_source_errors = checkmore_add_tcase(suite, "Source errors",
 			    test_source_errors);
@@ -0,0 +1,256 @@
+/*
+ * This file is a part of MAFW
+ *
+ * Copyright (C) 2007, 2008, 2009 Nokia Corporation, all rights reserved.
+ *
+ * Contact: Visa Smolander <visa.smolander@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <check.h>
+#include <glib.h>
+#include <dbus/dbus.h>
+#include <libmafw/mafw-errors.h>
+
+#include <checkmore.h>
+#include "common/dbus-interface.h"
+#include "common/mafw-dbus.h"
+#include "libmafw-shared/mafw-playlist-manager.h"
+#include "libmafw-shared/mafw-shared.h"
+#include "../mafw-playlist-daemon/mpd-internal.h"
+#include "mockbus.h"
+
+/* The command line tool, to be run by the tests. */
+int stats_main(int argc, char *argv[]);
+#define main stats_main
+#include "../mafw-playlist-daemon/mafw-playlist-stats.c"
+#undef main
+
+/* Playlists will be stored in PLS_DIR. */
+#define PLS_DIR		"teststats"
+
+#define CLIENT		":1.103"
+
+/* A request to playlist 1. */
+#define pl_request(...)							\
+	with_sender(mafw_dbus_method_full(MAFW_PLAYLIST_SERVICE,	\
+					  MAFW_PLAYLIST_PATH "/1",	\
+					  MAFW_PLAYLIST_INTERFACE,	\
+					  __VA_ARGS__))
+
+#define stats_request()							\
+	mafw_dbus_method_full(MAFW_PLAYLIST_SERVICE,			\
+			      MAFW_PLAYLIST_PATH,			\
+			      MAFW_PLAYLIST_STATS_INTERFACE,		\
+			      MAFW_PLAYLIST_STATS_METHOD_GET)
+
+static const gchar *Oids[] = {"test::a", NULL};
+
+static DBusMessage *with_sender(DBusMessage *msg)
+{
+	mockbus_set_sender(msg, CLIENT);
+	return msg;
+}
+
+/* Starts the daemon with playlist 1 holding $Oids. */
+static void start_daemon(void)
+{
+	Pls *pls;
+
+	mockbus_reset();
+	mockbus_expect(mafw_dbus_method_full(
+			       DBUS_SERVICE_DBUS,
+			       DBUS_PATH_DBUS,
+			       DBUS_INTERFACE_DBUS,
+			       "RequestName",
+			       MAFW_DBUS_STRING(MAFW_PLAYLIST_SERVICE),
+			       MAFW_DBUS_UINT32(4)));
+	mockbus_reply(MAFW_DBUS_UINT32(1));
+	mock_services(NULL);
+	mafw_shared_deinit();
+	init_playlist_wrapper(dbus_bus_get(DBUS_BUS_SESSION, NULL),
+			      TRUE, FALSE);
+
+	pls = pls_new(1, "test");
+	pls_appends(pls, Oids, 1);
+	g_tree_insert(Playlists, GUINT_TO_POINTER(pls->id), pls);
+	g_tree_insert(Playlists_by_name, g_strdup(pls->name), pls);
+}
+
+/* Lets the daemon handle its queued requests. */
+static void run_queue(void)
+{
+	while (g_main_context_iteration(NULL, FALSE))
+		/* */;
+}
+
+/* Sends the nonexistent method $member to the daemon, expecting it to
+ * be refused. */
+static void bogus_request(const gchar *member)
+{
+	DBusMessage *c;
+
+	mockbus_incoming(c = pl_request(member));
+	mockbus_expect(dbus_message_new_error_printf(
+			       c, DBUS_ERROR_UNKNOWN_METHOD,
+			       "Method \"%s\" with signature \"\" on interface "
+			       "\"%s\" doesn't exist", member,
+			       MAFW_PLAYLIST_INTERFACE));
+	mockbus_deliver(NULL);
+	run_queue();
+}
+
+/* Asks the daemon for its statistics. */
+static DBusMessage *get_stats(void)
+{
+	DBusMessage *reply;
+
+	mockbus_incoming(stats_request());
+	mockbus_capture();
+	mockbus_deliver(NULL);
+	reply = mockbus_captured();
+	ck_assert(reply);
+	ck_assert_int_eq(dbus_message_get_type(reply),
+			 DBUS_MESSAGE_TYPE_METHOD_RETURN);
+	return reply;
+}
+
+/* Returns the value of $key in the statistics $reply, or -1 if it's
+ * missing. */
+static gint64 stat_value(DBusMessage *reply, const gchar *key)
+{
+	DBusMessageIter imsg, iary, ient;
+	const gchar *k;
+	dbus_uint64_t val;
+
+	ck_assert_str_eq(dbus_message_get_signature(reply), "a{st}");
+	dbus_message_iter_init(reply, &imsg);
+	for (dbus_message_iter_recurse(&imsg, &iary);
+	     dbus_message_iter_get_arg_type(&iary) == DBUS_TYPE_DICT_ENTRY;
+	     dbus_message_iter_next(&iary)) {
+		dbus_message_iter_recurse(&iary, &ient);
+		dbus_message_iter_get_basic(&ient, &k);
+		if (strcmp(k, key))
+			continue;
+		dbus_message_iter_next(&ient);
+		dbus_message_iter_get_basic(&ient, &val);
+		return val;
+	}
+	return -1;
+}
+
+/* Makes some requests, known and unknown. */
+static void make_requests(void)
+{
+	DBusMessage *c;
+
+	mockbus_incoming(c = pl_request(MAFW_PLAYLIST_METHOD_GET_SIZE));
+	mockbus_expect(mafw_dbus_reply(c, MAFW_DBUS_UINT32(1)));
+	mockbus_deliver(NULL);
+	run_queue();
+	bogus_request("no_such_method");
+	bogus_request("nor_this_one");
+	mockbus_finish();
+}
+
+START_TEST(test_methods)
+{
+	DBusMessage *reply;
+
+	start_daemon();
+	make_requests();
+
+	/* Unknown methods share a bucket rather than getting one each. */
+	reply = get_stats();
+	ck_assert_int_eq(stat_value(reply, "method.get_size.calls"), 1);
+	ck_assert_int_eq(stat_value(reply, "method.unknown.calls"), 2);
+	ck_assert_int_eq(stat_value(reply, "method.no_such_method.calls"), -1);
+	ck_assert_int_eq(stat_value(reply, "method.nor_this_one.calls"), -1);
+	ck_assert_int_eq(stat_value(reply, "playlists"), 1);
+	dbus_message_unref(reply);
+	mockbus_finish();
+}
+END_TEST
+
+START_TEST(test_cli)
+{
+	gchar *argv[] = {
+		"mafw-playlist-stats", "method.unknown.calls", "playlists",
+		NULL,
+	};
+	gchar out[128];
+	FILE *tmp;
+	int saved;
+	gsize n;
+
+	start_daemon();
+	make_requests();
+
+	/* Let the tool ask what the daemon answers. */
+	mockbus_expect(stats_request());
+	mockbus_reply_msg(get_stats());
+
+	tmp = tmpfile();
+	ck_assert(tmp);
+	fflush(stdout);
+	saved = dup(STDOUT_FILENO);
+	dup2(fileno(tmp), STDOUT_FILENO);
+	ck_assert_int_eq(stats_main(G_N_ELEMENTS(argv) - 1, argv), 0);
+	fflush(stdout);
+	dup2(saved, STDOUT_FILENO);
+	close(saved);
+	mockbus_finish();
+
+	rewind(tmp);
+	n = fread(out, 1, sizeof(out) - 1, tmp);
+	out[n] = '\0';
+	fclose(tmp);
+	ck_assert_str_eq(out, "method.unknown.calls 2\nplaylists 1\n");
+}
+END_TEST
+
+/*****************************************************************************
+ * Test case management
+ *****************************************************************************/
+
+static Suite *stats_suite(void)
+{
+	Suite *suite;
+
+	suite = suite_create("Statistics");
+	if (1)	checkmore_add_tcase(suite, "Methods", test_methods);
+	if (1)	checkmore_add_tcase(suite, "Command line", test_cli);
+	return suite;
+}
+
+/*****************************************************************************
+ * Test case execution
+ *****************************************************************************/
+
+int main(void)
+{
+	g_setenv("MAFW_PLAYLIST_DIR", PLS_DIR, TRUE);
+	return checkmore_run(srunner_create(stats_suite()), FALSE);
+}
+
+/* vi: set noexpandtab ts=8 sw=8 cino=t0,(0: */